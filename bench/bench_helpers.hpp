@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "engine/physical_operator.hpp"
+#include "test_helpers.hpp"
+
+namespace toydb::bench {
+
+// Rows per benchmark input, large enough that the data does not fit the caches
+constexpr int64_t BENCH_ROWS = 1 << 22;
+
+constexpr int64_t BENCH_BATCH_SIZE = 8192;
+
+/**
+ * @brief Two INT64 columns a (id 1) and b (id 2) with uniform values in [0, 100), split into
+ * views of BENCH_BATCH_SIZE rows. A comparison against the constant k selects about k% of the rows.
+ */
+class IntTable {
+    test::ColumnBufferStorage storage_;
+    std::vector<RowVector> batches_;
+
+public:
+    explicit IntTable(int64_t rows = BENCH_ROWS) {
+        RowVector table;
+        table.addColumn(storage_.createIntColumn(test::data_helpers::randomInts(0, 99, rows, 1), 1, "a"));
+        table.addColumn(storage_.createIntColumn(test::data_helpers::randomInts(0, 99, rows, 2), 2, "b"));
+        table.setRowCount(rows);
+        for (int64_t offset = 0; offset < rows; offset += BENCH_BATCH_SIZE) {
+            batches_.push_back(table.slice(offset, std::min(BENCH_BATCH_SIZE, rows - offset)));
+        }
+    }
+
+    const std::vector<RowVector>& getBatches() const noexcept { return batches_; }
+};
+
+/**
+ * @brief Shared by all benchmarks of a binary, generating it takes longer than most benchmarks
+ */
+inline const IntTable& getIntTable() {
+    static const IntTable table;
+    return table;
+}
+
+}  // namespace toydb::bench
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "bench_helpers.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/nested_loop_join.hpp"
+
+using namespace toydb;
+using namespace toydb::bench;
+using namespace toydb::test;
+
+namespace {
+
+std::vector<int64_t> batchSizes(int64_t rows) {
+    std::vector<int64_t> sizes;
+    for (int64_t offset = 0; offset < rows; offset += BENCH_BATCH_SIZE) {
+        sizes.push_back(std::min(BENCH_BATCH_SIZE, rows - offset));
+    }
+    return sizes;
+}
+
+}  // namespace
+
+// range(0) build rows with unique keys, probed by BENCH_ROWS rows of which about half match
+static void BM_HashJoin(benchmark::State& state) {
+    int64_t buildRows = state.range(0);
+    ColumnBufferStorage storage;
+    auto build = MockOperatorBuilder(&storage)
+                         .addInt64Column(1, "build_key", data_helpers::intSequence(0, buildRows))
+                         .withBatchSizes(batchSizes(buildRows))
+                         .build();
+    auto probe = MockOperatorBuilder(&storage)
+                         .addInt64Column(2, "probe_key", data_helpers::randomInts(0, buildRows * 2 - 1, BENCH_ROWS))
+                         .withBatchSizes(batchSizes(BENCH_ROWS))
+                         .build();
+
+    int64_t rows = 0;
+    for (auto _ : state) {
+        HashJoinExec join(build.get(), probe.get(),
+                          std::make_unique<ColumnRefExpr>(ColumnId(1, "build_key"), DataType::getInt64()),
+                          std::make_unique<ColumnRefExpr>(ColumnId(2, "probe_key"), DataType::getInt64()));
+        join.initialize();
+        benchmark::DoNotOptimize(drainOperator(join));
+        rows += buildRows + BENCH_ROWS;
+    }
+    state.SetItemsProcessed(rows);
+}
+BENCHMARK(BM_HashJoin)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+// Compares all pairs, so both sides are kept small
+static void BM_NestedLoopJoin(benchmark::State& state) {
+    constexpr int64_t buildRows = 1 << 10;
+    constexpr int64_t probeRows = 1 << 14;
+    ColumnBufferStorage storage;
+    auto build = MockOperatorBuilder(&storage)
+                         .addInt64Column(1, "build_key", data_helpers::intSequence(0, buildRows))
+                         .withBatchSizes(batchSizes(buildRows))
+                         .build();
+    auto probe = MockOperatorBuilder(&storage)
+                         .addInt64Column(2, "probe_key", data_helpers::randomInts(0, buildRows * 2 - 1, probeRows))
+                         .withBatchSizes(batchSizes(probeRows))
+                         .build();
+
+    int64_t pairs = 0;
+    for (auto _ : state) {
+        NestedLoopJoinExec join(build.get(), probe.get(),
+                                std::make_unique<CompareExpr>(
+                                        CompareOp::EQUAL, DataType::getInt64(),
+                                        std::make_unique<ColumnRefExpr>(ColumnId(1, "build_key"), DataType::getInt64()),
+                                        std::make_unique<ColumnRefExpr>(ColumnId(2, "probe_key"), DataType::getInt64())));
+        join.initialize();
+        benchmark::DoNotOptimize(drainOperator(join));
+        pairs += buildRows * probeRows;
+    }
+    state.SetItemsProcessed(pairs);
+}
+BENCHMARK(BM_NestedLoopJoin)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include "parser/parser.hpp"
+
+using namespace toydb;
+using namespace toydb::parser;
+
+namespace {
+
+constexpr std::string_view QUERIES[] = {
+        "SELECT id, name FROM users",
+        "SELECT id FROM users WHERE users.age > 20 AND users.name = 'bob' OR users.id < 100",
+        "SELECT name, AVG(age) FROM users WHERE users.age > 20 GROUP BY name",
+        "SELECT id FROM users ORDER BY age LIMIT 10",
+};
+
+}  // namespace
+
+// range(0) indexes QUERIES
+static void BM_ParseQuery(benchmark::State& state) {
+    std::string_view query = QUERIES[state.range(0)];
+    state.SetLabel(std::string(query));
+    for (auto _ : state) {
+        Parser parser(query);
+        auto result = parser.parseQuery();
+        if (!result) {
+            state.SkipWithError("Query failed to parse");
+            return;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(query.size()));
+}
+BENCHMARK(BM_ParseQuery)->DenseRange(0, std::size(QUERIES) - 1);
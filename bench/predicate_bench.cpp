@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "bench_helpers.hpp"
+#include "engine/fused_predicate.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/predicate_result.hpp"
+
+using namespace toydb;
+using namespace toydb::bench;
+
+namespace {
+
+std::unique_ptr<PredicateExpr> columnLessThan(uint64_t colId, const std::string& name, int64_t constant) {
+    return std::make_unique<CompareExpr>(CompareOp::LESS, DataType::getInt64(),
+                                         std::make_unique<ColumnRefExpr>(ColumnId(colId, name), DataType::getInt64()),
+                                         std::make_unique<ConstantExpr>(DataType::getInt64(), constant));
+}
+
+void evaluateAll(benchmark::State& state, const PredicateExpr& predicate) {
+    const auto& batches = getIntTable().getBatches();
+    PredicateResultVector result;
+    PredicateScratch scratch;
+    int64_t rows = 0;
+    for (auto _ : state) {
+        for (const RowVector& batch : batches) {
+            scratch.reset();
+            predicate.evaluateInto(batch, result, scratch);
+            benchmark::DoNotOptimize(result);
+            rows += batch.getRowCount();
+        }
+    }
+    state.SetItemsProcessed(rows);
+}
+
+}  // namespace
+
+// a < k, range(0) is the selectivity in percent
+static void BM_CompareConstant(benchmark::State& state) {
+    auto predicate = columnLessThan(1, "a", state.range(0));
+    predicate->initializeIndexMap();
+    evaluateAll(state, *predicate);
+}
+BENCHMARK(BM_CompareConstant)->Arg(1)->Arg(10)->Arg(50)->Arg(90);
+
+static void BM_CompareColumns(benchmark::State& state) {
+    CompareExpr predicate(CompareOp::LESS, DataType::getInt64(),
+                          std::make_unique<ColumnRefExpr>(ColumnId(1, "a"), DataType::getInt64()),
+                          std::make_unique<ColumnRefExpr>(ColumnId(2, "b"), DataType::getInt64()));
+    predicate.initializeIndexMap();
+    evaluateAll(state, predicate);
+}
+BENCHMARK(BM_CompareColumns);
+
+// a < k AND b < k, selects about (k%)^2 of the rows
+static void BM_LogicalAnd(benchmark::State& state) {
+    LogicalExpr predicate(CompareOp::AND, columnLessThan(1, "a", state.range(0)), columnLessThan(2, "b", state.range(0)));
+    predicate.initializeIndexMap();
+    evaluateAll(state, predicate);
+}
+BENCHMARK(BM_LogicalAnd)->Arg(1)->Arg(10)->Arg(50)->Arg(90);
+
+static void BM_LogicalOr(benchmark::State& state) {
+    LogicalExpr predicate(CompareOp::OR, columnLessThan(1, "a", state.range(0)), columnLessThan(2, "b", state.range(0)));
+    predicate.initializeIndexMap();
+    evaluateAll(state, predicate);
+}
+BENCHMARK(BM_LogicalOr)->Arg(1)->Arg(10)->Arg(50)->Arg(90);
+
+// Same conjunction as BM_LogicalAnd, evaluated by the fused kernel
+static void BM_FusedAnd(benchmark::State& state) {
+    LogicalExpr predicate(CompareOp::AND, columnLessThan(1, "a", state.range(0)), columnLessThan(2, "b", state.range(0)));
+    predicate.initializeIndexMap();
+    auto fused = FusedPredicate::compile(predicate);
+    if (!fused) {
+        state.SkipWithError("Predicate can't be fused");
+        return;
+    }
+
+    const auto& batches = getIntTable().getBatches();
+    PredicateResultVector result;
+    int64_t rows = 0;
+    for (auto _ : state) {
+        for (const RowVector& batch : batches) {
+            fused->evaluateInto(batch, result);
+            benchmark::DoNotOptimize(result);
+            rows += batch.getRowCount();
+        }
+    }
+    state.SetItemsProcessed(rows);
+}
+BENCHMARK(BM_FusedAnd)->Arg(1)->Arg(10)->Arg(50)->Arg(90);
+
+namespace {
+
+BitmaskResult randomBitmask(int64_t size, int seed) {
+    BitmaskResult bitmask(size);
+    auto values = test::data_helpers::randomInts(0, 2, size, seed);
+    for (int64_t i = 0; i < size; ++i) {
+        bitmask.set(i, values[i] == 0 ? PredicateValue::TRUE
+                       : values[i] == 1 ? PredicateValue::FALSE : PredicateValue::NULL_VALUE);
+    }
+    return bitmask;
+}
+
+}  // namespace
+
+// range(0) is the number of rows of the bitmasks
+static void BM_BitmaskAnd(benchmark::State& state) {
+    BitmaskResult left = randomBitmask(state.range(0), 1);
+    BitmaskResult right = randomBitmask(state.range(0), 2);
+    for (auto _ : state) {
+        left.combineAnd(right);
+        benchmark::DoNotOptimize(left);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BitmaskAnd)->Arg(BENCH_BATCH_SIZE)->Arg(BENCH_ROWS);
+
+static void BM_BitmaskOr(benchmark::State& state) {
+    BitmaskResult left = randomBitmask(state.range(0), 1);
+    BitmaskResult right = randomBitmask(state.range(0), 2);
+    for (auto _ : state) {
+        left.combineOr(right);
+        benchmark::DoNotOptimize(left);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BitmaskOr)->Arg(BENCH_BATCH_SIZE)->Arg(BENCH_ROWS);
+
+static void BM_BitmaskNegate(benchmark::State& state) {
+    BitmaskResult bitmask = randomBitmask(state.range(0), 1);
+    for (auto _ : state) {
+        bitmask.negate();
+        benchmark::DoNotOptimize(bitmask);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BitmaskNegate)->Arg(BENCH_BATCH_SIZE)->Arg(BENCH_ROWS);
+
+static void BM_BitmaskCount(benchmark::State& state) {
+    BitmaskResult bitmask = randomBitmask(state.range(0), 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bitmask.count());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BitmaskCount)->Arg(BENCH_BATCH_SIZE)->Arg(BENCH_ROWS);
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "bench_helpers.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "storage/catalog.hpp"
+#include "storage/csv_data_file_reader.hpp"
+
+using namespace toydb;
+using namespace toydb::bench;
+
+namespace {
+
+constexpr int64_t CSV_ROWS = 1 << 20;
+
+/**
+ * @brief Schema of width columns cycling through INT64, DOUBLE and STRING
+ */
+Schema csvSchema(int64_t width) {
+    Schema schema;
+    const DataType types[] = {DataType::getInt64(), DataType::getDouble(), DataType::getString()};
+    for (int64_t i = 0; i < width; ++i) {
+        std::string name = "c" + std::to_string(i);
+        schema.addColumn(ColumnId(static_cast<uint64_t>(i + 1), name), ColumnMetadata{name, types[i % 3], true});
+    }
+    return schema;
+}
+
+/**
+ * @brief Write a CSV file of CSV_ROWS rows with width columns, unless it exists from an earlier run
+ */
+std::filesystem::path csvFile(int64_t width) {
+    auto path = std::filesystem::temp_directory_path() / ("toydb_bench_" + std::to_string(width) + ".csv");
+    if (std::filesystem::exists(path)) {
+        return path;
+    }
+
+    auto ints = test::data_helpers::randomInts(-1000000, 1000000, CSV_ROWS);
+    auto doubles = test::data_helpers::randomDoubles(-1000.0, 1000.0, CSV_ROWS);
+    auto strings = test::data_helpers::stringSequence("value_", CSV_ROWS);
+
+    std::ofstream out(path);
+    for (int64_t i = 0; i < width; ++i) {
+        out << (i > 0 ? "," : "") << 'c' << i;
+    }
+    out << '\n';
+    for (int64_t row = 0; row < CSV_ROWS; ++row) {
+        for (int64_t i = 0; i < width; ++i) {
+            out << (i > 0 ? "," : "");
+            switch (i % 3) {
+                case 0: out << ints[row]; break;
+                case 1: out << doubles[row]; break;
+                default: out << strings[row]; break;
+            }
+        }
+        out << '\n';
+    }
+    return path;
+}
+
+}  // namespace
+
+// range(0) is the number of columns
+static void BM_CsvReadBatch(benchmark::State& state) {
+    int64_t width = state.range(0);
+    Schema schema = csvSchema(width);
+    auto path = csvFile(width);
+    CsvDataFileReader reader(path, schema, TableId(1, "bench"));
+
+    std::vector<ColumnDescriptor> columns;
+    for (const ColumnId& id : schema.getColumnIds()) {
+        columns.push_back({id, schema.getColumn(id)->type});
+    }
+    memory::BufferManager bufferManager;
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch = allocator.allocateBatch(columns);
+    int64_t batchRows = BatchAllocator::rowsPerBuffer(columns);
+
+    int64_t rows = 0;
+    for (auto _ : state) {
+        reader.reset();
+        while (int64_t count = reader.readBatch(batch, batchRows)) {
+            rows += count;
+        }
+    }
+    state.SetItemsProcessed(rows);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+}
+BENCHMARK(BM_CsvReadBatch)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
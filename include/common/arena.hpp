@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace toydb {
+
+/**
+ * @brief Bump allocator for objects that all die together, e.g. the nodes of a query's AST.
+ *
+ * Objects are placed in 4KB blocks, objects that don't fit a block get their own. They are never
+ * freed one by one: the arena destroys them in reverse order of creation when it is destroyed.
+ */
+class Arena {
+private:
+    static constexpr size_t BLOCK_SIZE = 4 * 1024;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    std::vector<Block> blocks_;
+    size_t used_ = 0;  // bytes used in the last block
+    // Only for objects that are not trivially destructible
+    std::vector<Destructor> destructors_;
+
+public:
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+            it->destroy(it->object);
+        }
+    }
+
+    /**
+     * @brief Uninitialized memory, valid until the arena is destroyed
+     */
+    void* allocate(size_t size, size_t alignment) {
+        if (!blocks_.empty()) {
+            size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= blocks_.back().size) {
+                used_ = offset + size;
+                return blocks_.back().data.get() + offset;
+            }
+        }
+
+        // New blocks are aligned for any fundamental type
+        size_t blockSize = std::max(BLOCK_SIZE, size);
+        blocks_.push_back({std::make_unique<std::byte[]>(blockSize), blockSize});
+        used_ = size;
+        return blocks_.back().data.get();
+    }
+
+    /**
+     * @brief Construct an object in the arena
+     */
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            // Reserved first, so that registering the constructed object can't throw
+            destructors_.reserve(destructors_.size() + 1);
+        }
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors_.push_back({[](void* p) { static_cast<T*>(p)->~T(); }, object});
+        }
+        return object;
+    }
+
+    size_t getBlockCount() const noexcept {
+        return blocks_.size();
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace toydb {
+
+/**
+ * @brief Instruction set a kernel is compiled for. The x86 levels include the ones before them.
+ */
+enum class SimdLevel : uint8_t {
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512,  // AVX-512 F, BW, VL and DQ, as on every AVX-512 server part
+    NEON,
+};
+
+std::string_view toString(SimdLevel level) noexcept;
+
+/**
+ * @brief Parse the name toString returns
+ */
+std::optional<SimdLevel> parseSimdLevel(std::string_view name) noexcept;
+
+/**
+ * @brief Whether the host CPU and OS support the level, detected with cpuid on x86 and the
+ *        hardware capabilities on ARM. SCALAR is always supported.
+ */
+bool isSupported(SimdLevel level) noexcept;
+
+/**
+ * @brief The best level the host supports. Detected once, the result is cached.
+ */
+SimdLevel detectSimdLevel() noexcept;
+
+}  // namespace toydb
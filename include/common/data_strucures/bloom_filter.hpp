@@ -0,0 +1,66 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace toydb {
+
+/**
+ * @brief Blocked Bloom filter over 64-bit hashes.
+ *
+ * Every hash sets HASH_BITS bits within a single 64-bit word, so a lookup reads one word instead
+ * of HASH_BITS cache lines. The low bits of the hash select the word, the top bits select the
+ * bits within it. With BITS_PER_KEY bits per inserted key the false positive rate is below 1%.
+ * There are no false negatives.
+ */
+class BlockedBloomFilter {
+public:
+    static constexpr int64_t BITS_PER_KEY = 16;
+    static constexpr int HASH_BITS = 4;
+
+private:
+    std::vector<uint64_t> words_;
+    uint64_t wordMask_;
+
+    static uint64_t bitMask(uint64_t hash) noexcept {
+        uint64_t mask = 0;
+        for (int i = 0; i < HASH_BITS; ++i) {
+            mask |= uint64_t{1} << ((hash >> (64 - 6 * (i + 1))) & 63);
+        }
+        return mask;
+    }
+
+public:
+    /**
+     * @param expectedKeys Number of keys that will be inserted, determines the size of the filter
+     */
+    explicit BlockedBloomFilter(int64_t expectedKeys) {
+        uint64_t bits = static_cast<uint64_t>(expectedKeys > 0 ? expectedKeys : 1) * BITS_PER_KEY;
+        size_t wordCount = std::bit_ceil(static_cast<size_t>((bits + 63) / 64));
+        words_.assign(wordCount, 0);
+        wordMask_ = wordCount - 1;
+    }
+
+    /**
+     * @param hash Hash of the key, all bits must be well mixed (e.g. hashMix)
+     */
+    void insert(uint64_t hash) noexcept {
+        words_[hash & wordMask_] |= bitMask(hash);
+    }
+
+    /**
+     * @brief False if the key was never inserted, true if it may have been
+     */
+    bool mayContain(uint64_t hash) const noexcept {
+        uint64_t mask = bitMask(hash);
+        return (words_[hash & wordMask_] & mask) == mask;
+    }
+
+    size_t getWordCount() const noexcept {
+        return words_.size();
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include "common/assert.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue without locks (Vyukov's array queue).
+ *
+ * Every slot carries a sequence number telling producers and consumers whether it is free for
+ * the current lap around the ring. An operation claims a position with a single CAS on the
+ * head or tail counter; it never waits for another thread unless the queue is full or empty,
+ * in which case it fails instead.
+ */
+template<typename T>
+class LockFreeQueue {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    // Keep the counters on separate cache lines, producers and consumers update them concurrently
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_ {0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_ {0};
+
+public:
+    /**
+     * @brief Create a queue for up to capacity elements, capacity must be a power of two
+     */
+    explicit LockFreeQueue(size_t capacity) : slots_(std::make_unique<Slot[]>(capacity)), mask_(capacity - 1) {
+        tdb_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "Queue capacity {} is not a power of two", capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /**
+     * @brief Append a value
+     * @return false if the queue is full, value is left untouched in that case
+     */
+    bool tryPush(T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value.emplace(std::move(value));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the value of the previous lap
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPush(T&& value) {
+        return tryPush(value);
+    }
+
+    /**
+     * @brief Remove the oldest value
+     * @return false if the queue is empty
+     */
+    bool tryPop(T& out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(*slot.value);
+                    slot.value.reset();
+                    slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // No producer has filled the slot for this lap yet
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t getCapacity() const noexcept {
+        return mask_ + 1;
+    }
+
+    /**
+     * @brief Number of queued values. Only a snapshot while other threads use the queue
+     */
+    size_t sizeApprox() const noexcept {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "common/assert.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Tournament tree for k-way merging: finds the smallest head among k sorted sources.
+ *
+ * Every inner node keeps the loser of the match played there, the overall winner is kept
+ * separately. After the winning source advanced, only the path from its leaf to the root is
+ * replayed, which takes log2(k) comparisons with no data movement other than swapping indices.
+ *
+ * less(a, b) compares the current heads of sources a and b. Exhausted sources must compare
+ * greater than all others, so that they sink to the leaves.
+ */
+template<typename Less>
+class LoserTree {
+private:
+    size_t sourceCount_;
+    // tree_[0] is the winner, tree_[1..k-1] the losers of the inner nodes. Node n has the
+    // children 2n and 2n+1, nodes n >= k are the leaves of source n - k.
+    std::vector<size_t> tree_;
+    Less less_;
+
+    size_t build(size_t node) {
+        if (node >= sourceCount_) {
+            return node - sourceCount_;
+        }
+        size_t left = build(2 * node);
+        size_t right = build(2 * node + 1);
+        if (less_(right, left)) {
+            tree_[node] = left;
+            return right;
+        }
+        tree_[node] = right;
+        return left;
+    }
+
+public:
+    LoserTree(size_t sourceCount, Less less) : sourceCount_(sourceCount), tree_(sourceCount), less_(std::move(less)) {
+        tdb_assert(sourceCount > 0, "Loser tree needs at least one source");
+        tree_[0] = build(1);
+    }
+
+    /**
+     * @brief Source with the smallest head
+     */
+    size_t top() const noexcept {
+        return tree_[0];
+    }
+
+    /**
+     * @brief Restore the tree after the head of top() changed
+     */
+    void replay() {
+        size_t winner = tree_[0];
+        for (size_t node = (winner + sourceCount_) / 2; node >= 1; node /= 2) {
+            if (less_(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+};
+
+}  // namespace toydb
@@ -46,6 +46,12 @@ class SQLRuntimeException : public SQLException {
         : SQLException(message, std::move(originQuerySQL)) {}
 };
 
+class MemoryBudgetExceededError : public SQLRuntimeException {
+   public:
+    explicit MemoryBudgetExceededError(const std::string& message)
+        : SQLRuntimeException("Memory budget exceeded: " + message) {}
+};
+
 class NotYetImplementedError : public SQLException {
    public:
     explicit NotYetImplementedError(const std::string& feature, std::optional<std::string> originQuerySQL = std::nullopt)
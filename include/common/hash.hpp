@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace toydb {
+
+/**
+ * @brief Finalizer of MurmurHash3. Cheap, and every input bit affects every output bit,
+ * which matters because hash tables index buckets with the low bits.
+ */
+inline uint64_t hashMix(uint64_t key) noexcept {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+inline uint64_t hashInt64(int64_t value) noexcept {
+    return hashMix(static_cast<uint64_t>(value));
+}
+
+/**
+ * @brief Hash a double such that values comparing equal (0.0 and -0.0) hash equal
+ */
+inline uint64_t hashDouble(double value) noexcept {
+    if (value == 0.0) {
+        value = 0.0;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return hashMix(bits);
+}
+
+/**
+ * @brief Hash a byte sequence, consuming 8 bytes per step
+ */
+inline uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0) noexcept {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        hash = hashMix(hash ^ word);
+        bytes += 8;
+        length -= 8;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes, length);
+    return hashMix(hash ^ tail);
+}
+
+/**
+ * @brief Combine two hashes, e.g. for multi-column keys
+ */
+inline uint64_t hashCombine(uint64_t seed, uint64_t hash) noexcept {
+    return hashMix(seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+}  // namespace toydb
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace toydb {
+
+/**
+ * @brief HyperLogLog sketch estimating the number of distinct values of a multiset.
+ *
+ * Values are added by their 64-bit hash. The first PRECISION bits of a hash select a register,
+ * which keeps the highest position of the first set bit among the remaining bits. Sketches of
+ * different parts of the data can be merged, e.g. those of the files of a table. The standard
+ * error of the estimate is about 1.04 / sqrt(REGISTER_COUNT), around 3%.
+ */
+class HyperLogLog {
+public:
+    static constexpr int PRECISION = 10;
+    static constexpr size_t REGISTER_COUNT = size_t{1} << PRECISION;
+
+private:
+    std::vector<uint8_t> registers_;
+
+public:
+    HyperLogLog() : registers_(REGISTER_COUNT, 0) {}
+
+    /**
+     * @param hash Hash of the value, all bits must be well mixed (e.g. hashMix)
+     */
+    void addHash(uint64_t hash) noexcept {
+        size_t index = static_cast<size_t>(hash >> (64 - PRECISION));
+        uint64_t rest = hash << PRECISION;
+        uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - PRECISION + 1)
+                                 : static_cast<uint8_t>(std::countl_zero(rest) + 1);
+        registers_[index] = std::max(registers_[index], rank);
+    }
+
+    void merge(const HyperLogLog& other) noexcept {
+        for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+        }
+    }
+
+    double estimate() const noexcept {
+        constexpr double m = static_cast<double>(REGISTER_COUNT);
+        const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t rank : registers_) {
+            sum += std::ldexp(1.0, -rank);
+            zeros += rank == 0;
+        }
+
+        double estimate = alpha * m * m / sum;
+        if (estimate <= 2.5 * m && zeros > 0) {
+            // Linear counting is more accurate while many registers are still empty
+            return m * std::log(m / static_cast<double>(zeros));
+        }
+        return estimate;
+    }
+
+    /**
+     * @brief Append the registers to out, one byte per register
+     */
+    void appendTo(std::string& out) const {
+        out.append(reinterpret_cast<const char*>(registers_.data()), REGISTER_COUNT);
+    }
+
+    /**
+     * @return nullopt if the bytes are not a sketch written by appendTo()
+     */
+    static std::optional<HyperLogLog> fromBytes(std::string_view bytes) {
+        if (bytes.size() != REGISTER_COUNT) {
+            return std::nullopt;
+        }
+        HyperLogLog sketch;
+        std::copy(bytes.begin(), bytes.end(), sketch.registers_.begin());
+        return sketch;
+    }
+
+    /**
+     * @brief The registers as a hex string, two characters per register
+     */
+    std::string toHex() const {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(REGISTER_COUNT * 2);
+        for (uint8_t rank : registers_) {
+            hex.push_back(digits[rank >> 4]);
+            hex.push_back(digits[rank & 0xf]);
+        }
+        return hex;
+    }
+
+    /**
+     * @return nullopt if the string is not a sketch written by toHex()
+     */
+    static std::optional<HyperLogLog> fromHex(std::string_view hex) {
+        if (hex.size() != REGISTER_COUNT * 2) {
+            return std::nullopt;
+        }
+
+        auto digit = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        };
+
+        HyperLogLog sketch;
+        for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+            int high = digit(hex[2 * i]);
+            int low = digit(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return std::nullopt;
+            }
+            sketch.registers_[i] = static_cast<uint8_t>(high << 4 | low);
+        }
+        return sketch;
+    }
+};
+
+}  // namespace toydb
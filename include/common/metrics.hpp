@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace toydb {
+
+namespace metrics {
+
+/**
+ * @brief Name and value pairs distinguishing the metrics of a family, e.g. {"format", "csv"}
+ */
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Counters and histograms are split into shards, every thread updates the one it was
+ * assigned on its first update. Threads on different shards don't share cache lines.
+ */
+constexpr size_t SHARD_COUNT = 16;
+
+size_t currentShard() noexcept;
+
+/**
+ * @brief Monotonically increasing count, e.g. of rows scanned. Incrementing is a relaxed atomic add
+ * on the shard of the calling thread, reading sums all shards.
+ */
+class Counter {
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value {0};
+    };
+
+    std::array<Shard, SHARD_COUNT> shards_;
+
+public:
+    void increment(uint64_t amount = 1) noexcept {
+        shards_[currentShard()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const noexcept {
+        uint64_t total = 0;
+        for (const Shard& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+/**
+ * @brief Distribution of observed values, e.g. query latencies, counted in buckets with fixed
+ * upper bounds. Observing is a few relaxed atomic adds on the shard of the calling thread.
+ */
+class Histogram {
+private:
+    struct alignas(64) Shard {
+        // One count per bound, the last one counts the values above all bounds
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<double> sum {0.0};
+    };
+
+    std::vector<double> bounds_;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+public:
+    struct Snapshot {
+        std::vector<double> bounds;
+        // Not cumulative, one more than bounds
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0;
+        double sum = 0.0;
+
+        /**
+         * @brief Estimate of the q-quantile (0 <= q <= 1), interpolated linearly within its bucket
+         */
+        double quantile(double q) const noexcept;
+    };
+
+    /**
+     * @param bounds Upper bounds of the buckets, ascending
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value) noexcept;
+
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Bounds start, start * factor, ... with count bounds
+     */
+    static std::vector<double> exponentialBounds(double start, double factor, size_t count);
+};
+
+/**
+ * @brief Named metrics exported in the Prometheus text format.
+ *
+ * Metrics are registered once, usually into a static reference next to the code updating them,
+ * and live as long as the registry. Registering a name and labels again returns the existing
+ * metric. Gauges are read from a function when the metrics are exported, e.g. the bytes a pool
+ * currently holds. Thread-safe.
+ */
+class MetricsRegistry {
+private:
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Metric {
+        Labels labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> gauge;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<Metric> metrics;
+    };
+
+    mutable std::mutex mutex_;
+    // In order of registration
+    std::vector<Family> families_;
+
+    Metric& getOrAdd(const std::string& name, const std::string& help, Type type, const Labels& labels);
+
+public:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    /**
+     * @brief The registry of the engine's own metrics
+     */
+    static MetricsRegistry& global();
+
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+
+    /**
+     * @param bounds Used if the histogram is new
+     */
+    Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                         const Labels& labels = {});
+
+    /**
+     * @brief Register a gauge, or replace the function of an existing one. The function is called
+     *        while exporting and must stay valid until it is replaced.
+     */
+    void gauge(const std::string& name, const std::string& help, std::function<double()> read,
+               const Labels& labels = {});
+
+    /**
+     * @brief All metrics in the Prometheus text exposition format (version 0.0.4)
+     */
+    void exportPrometheus(std::ostream& os) const;
+
+    std::string exportPrometheus() const;
+
+    /**
+     * @brief Replace the file with the exported metrics, atomically so that a scraper (e.g. the
+     *        node exporter's textfile collector) never sees a partial file
+     * @return false if the file could not be written
+     */
+    bool writeTextFile(const std::filesystem::path& path) const;
+};
+
+}  // namespace metrics
+}  // namespace toydb
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "common/hash.hpp"
+
+namespace toydb {
+
+/**
+ * @brief KLL sketch estimating the quantiles of a multiset of doubles.
+ *
+ * Values are kept in a stack of compactors. A value at level h stands for 2^h values of the
+ * input. Once a level is full, it is sorted and every other value, starting at a random offset,
+ * is promoted to the next level. Levels below the top one have 2/3 of the capacity of the level
+ * above, so the sketch retains O(K) values however large the input is. Sketches of different
+ * parts of the data can be merged. The rank error is about 1.7 / K, below 1% for the default K.
+ */
+class KllSketch {
+public:
+    static constexpr uint32_t K = 200;
+    static constexpr uint32_t MIN_CAPACITY = 8;
+
+private:
+    std::vector<std::vector<double>> levels_;
+    uint64_t count_ = 0;
+    // Drives the choice of the values promoted by a compaction
+    uint64_t random_;
+
+public:
+    explicit KllSketch(uint64_t seed = 0) : levels_(1), random_(seed) {}
+
+    void add(double value) {
+        levels_[0].push_back(value);
+        ++count_;
+        if (levels_[0].size() >= capacity(0)) {
+            compress();
+        }
+    }
+
+    void merge(const KllSketch& other) {
+        if (other.levels_.size() > levels_.size()) {
+            levels_.resize(other.levels_.size());
+        }
+        for (size_t h = 0; h < other.levels_.size(); ++h) {
+            levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+        }
+        count_ += other.count_;
+        compress();
+    }
+
+    /**
+     * @brief Number of values added, including those of merged sketches
+     */
+    uint64_t count() const noexcept {
+        return count_;
+    }
+
+    /**
+     * @brief Number of values kept by the sketch
+     */
+    size_t retainedCount() const noexcept {
+        size_t retained = 0;
+        for (const auto& level : levels_) {
+            retained += level.size();
+        }
+        return retained;
+    }
+
+    /**
+     * @brief Estimated value at the given fraction of the sorted input, 0 is the minimum and 1 the maximum
+     * @return NaN if no value was added
+     */
+    double quantile(double fraction) const {
+        if (count_ == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        std::vector<std::pair<double, uint64_t>> weighted;
+        weighted.reserve(retainedCount());
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            for (double value : levels_[h]) {
+                weighted.emplace_back(value, uint64_t{1} << h);
+            }
+        }
+        std::sort(weighted.begin(), weighted.end());
+
+        // Nearest rank, compactions keep the total weight equal to the count
+        double clamped = std::clamp(fraction, 0.0, 1.0);
+        auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped * static_cast<double>(count_))));
+        uint64_t cumulative = 0;
+        for (const auto& [value, weight] : weighted) {
+            cumulative += weight;
+            if (cumulative >= rank) {
+                return value;
+            }
+        }
+        return weighted.back().first;
+    }
+
+    /**
+     * @brief Append the sketch to out, see fromBytes()
+     */
+    void appendTo(std::string& out) const {
+        append(out, count_);
+        append(out, random_);
+        append(out, static_cast<uint32_t>(levels_.size()));
+        for (const auto& level : levels_) {
+            append(out, static_cast<uint32_t>(level.size()));
+            out.append(reinterpret_cast<const char*>(level.data()), level.size() * sizeof(double));
+        }
+    }
+
+    /**
+     * @return nullopt if the bytes are not a sketch written by appendTo()
+     */
+    static std::optional<KllSketch> fromBytes(std::string_view bytes) {
+        KllSketch sketch;
+        uint32_t levelCount = 0;
+        if (!consume(bytes, sketch.count_) || !consume(bytes, sketch.random_) || !consume(bytes, levelCount) ||
+            levelCount == 0) {
+            return std::nullopt;
+        }
+
+        sketch.levels_.resize(levelCount);
+        for (auto& level : sketch.levels_) {
+            uint32_t size = 0;
+            if (!consume(bytes, size) || bytes.size() < size * sizeof(double)) {
+                return std::nullopt;
+            }
+            level.resize(size);
+            std::memcpy(level.data(), bytes.data(), size * sizeof(double));
+            bytes.remove_prefix(size * sizeof(double));
+        }
+        return bytes.empty() ? std::optional(std::move(sketch)) : std::nullopt;
+    }
+
+private:
+    size_t capacity(size_t level) const noexcept {
+        auto depth = static_cast<double>(levels_.size() - 1 - level);
+        auto scaled = static_cast<size_t>(std::ceil(K * std::pow(2.0 / 3.0, depth)));
+        return std::max<size_t>(scaled, MIN_CAPACITY);
+    }
+
+    /**
+     * @brief Compact every full level into the one above it
+     */
+    void compress() {
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            if (levels_[h].size() < capacity(h)) {
+                continue;
+            }
+            if (h + 1 == levels_.size()) {
+                levels_.emplace_back();
+            }
+
+            std::vector<double>& level = levels_[h];
+            std::vector<double>& next = levels_[h + 1];
+            std::sort(level.begin(), level.end());
+            // An odd value stays behind, so that the promoted values weigh exactly as much as the compacted ones
+            size_t kept = level.size() % 2;
+            random_ += 0x9e3779b97f4a7c15ULL;
+            size_t offset = hashMix(random_) & 1;
+            for (size_t i = kept + offset; i < level.size(); i += 2) {
+                next.push_back(level[i]);
+            }
+            level.resize(kept);
+        }
+    }
+
+    template<typename T>
+    static void append(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static bool consume(std::string_view& bytes, T& value) {
+        if (bytes.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        bytes.remove_prefix(sizeof(T));
+        return true;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "common/cpu_features.hpp"
+#include "common/types.hpp"
+
+namespace toydb::simd {
+
+/**
+ * @brief Compares count <= 64 values with a constant.
+ * @return One bit per value that satisfies the comparison, bits past count are zero
+ */
+template<typename T, typename C>
+using CompareWordFn = uint64_t (*)(const T* values, C constant, int64_t count);
+
+/**
+ * @brief Three-valued AND/OR of two bitmask results (see BitmaskResult) over whole words,
+ *        the result is written to the A planes
+ */
+using CombineWordsFn = void (*)(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB, const uint64_t* nullB,
+                                int64_t words);
+
+// Number of comparison operators, EQUAL to LESS_EQUAL
+inline constexpr size_t COMPARE_OP_COUNT = 6;
+
+/**
+ * @brief The kernels compiled for one SimdLevel. Every level computes exactly the same results.
+ *
+ * The kernels are compiled for each level with function target attributes, so the library is built
+ * without -march flags and runs on any CPU of its architecture. The table for the host is selected
+ * once, see getKernels().
+ */
+struct KernelTable {
+    SimdLevel level;
+
+    // Indexed by CompareOp. INT32 and INT64 columns are compared in the int64_t domain.
+    CompareWordFn<int32_t, int64_t> compareInt32[COMPARE_OP_COUNT];
+    CompareWordFn<int64_t, int64_t> compareInt64[COMPARE_OP_COUNT];
+    CompareWordFn<double, double> compareDouble[COMPARE_OP_COUNT];
+
+    CombineWordsFn combineAnd;
+    CombineWordsFn combineOr;
+
+    /**
+     * @brief First separator or double quote of a CSV line in [p, end), end if there is none
+     */
+    const char* (*findSpecial)(const char* p, const char* end, char separator);
+
+    /**
+     * @brief out[i] = hashInt64(values[i]) for i in [0, count)
+     */
+    void (*hashInt64)(const int64_t* values, int64_t count, uint64_t* out);
+};
+
+/**
+ * @brief Initializer of a KernelTable comparison array from a kernel template on the CompareOp
+ */
+#define TDB_COMPARE_KERNELS(kernel)                                                                        \
+    {kernel<CompareOp::EQUAL>, kernel<CompareOp::NOT_EQUAL>, kernel<CompareOp::GREATER>, kernel<CompareOp::LESS>, \
+     kernel<CompareOp::GREATER_EQUAL>, kernel<CompareOp::LESS_EQUAL>}
+
+/**
+ * @brief Kernels of the best level the host supports, selected on first use. TOYDB_SIMD=<level>
+ *        (scalar, sse4.2, avx2, avx512, neon) selects a lower level instead.
+ */
+const KernelTable& getKernels() noexcept;
+
+/**
+ * @brief Kernels of a level, nullptr if they are not compiled for this architecture or the host
+ *        doesn't support them
+ */
+const KernelTable* getKernels(SimdLevel level) noexcept;
+
+/**
+ * @brief Portable implementations, the SCALAR level and the tails of the vectorized kernels
+ */
+namespace scalar {
+
+template<CompareOp Op, typename T>
+inline bool compare(T left, T right) noexcept {
+    if constexpr (Op == CompareOp::EQUAL) {
+        return left == right;
+    } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+        return left != right;
+    } else if constexpr (Op == CompareOp::GREATER) {
+        return left > right;
+    } else if constexpr (Op == CompareOp::LESS) {
+        return left < right;
+    } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+        return left >= right;
+    } else {
+        static_assert(Op == CompareOp::LESS_EQUAL, "Not a comparison operator");
+        return left <= right;
+    }
+}
+
+template<CompareOp Op, typename T, typename C>
+inline uint64_t compareWord(const T* values, C constant, int64_t count) noexcept {
+    uint64_t word = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        word |= static_cast<uint64_t>(compare<Op, C>(static_cast<C>(values[i]), constant)) << i;
+    }
+    return word;
+}
+
+/**
+ * @brief Whether an int64_t constant can be compared with int32_t values in 32-bit lanes
+ */
+inline bool fitsInt32(int64_t constant) noexcept {
+    return constant >= INT32_MIN && constant <= INT32_MAX;
+}
+
+inline void combineAnd(uint64_t& ta, uint64_t& na, uint64_t tb, uint64_t nb) noexcept {
+    // FALSE if either side is FALSE, TRUE if both are TRUE, NULL otherwise
+    uint64_t anyFalse = (~ta & ~na) | (~tb & ~nb);
+    na = (na | nb) & ~anyFalse;
+    ta &= tb;
+}
+
+inline void combineOr(uint64_t& ta, uint64_t& na, uint64_t tb, uint64_t nb) noexcept {
+    // TRUE if either side is TRUE, FALSE if both are FALSE, NULL otherwise
+    ta |= tb;
+    na = (na | nb) & ~ta;
+}
+
+/**
+ * @brief findSpecial 8 bytes at a time in a general purpose register
+ */
+inline const char* findSpecial(const char* p, const char* end, char separator) noexcept {
+    if constexpr (std::endian::native == std::endian::little) {
+        constexpr uint64_t lows = 0x0101010101010101ULL;
+        constexpr uint64_t highs = 0x8080808080808080ULL;
+        const uint64_t separators = lows * static_cast<uint8_t>(separator);
+        const uint64_t quotes = lows * static_cast<uint8_t>('"');
+
+        for (; end - p >= 8; p += 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            // The high bit of a byte is set where the byte equals the separator or a quote
+            uint64_t sepBytes = word ^ separators;
+            uint64_t quoteBytes = word ^ quotes;
+            uint64_t matches = (((sepBytes - lows) & ~sepBytes) | ((quoteBytes - lows) & ~quoteBytes)) & highs;
+            if (matches) {
+                return p + std::countr_zero(matches) / 8;
+            }
+        }
+    }
+
+    while (p < end && *p != separator && *p != '"') {
+        ++p;
+    }
+    return p;
+}
+
+}  // namespace scalar
+
+namespace detail {
+
+// Tables of the vectorized levels, each is compiled for its architecture only
+#if defined(__x86_64__)
+const KernelTable* getSse42Kernels() noexcept;
+const KernelTable* getAvx2Kernels() noexcept;
+const KernelTable* getAvx512Kernels() noexcept;
+#elif defined(__aarch64__)
+const KernelTable* getNeonKernels() noexcept;
+#endif
+
+}  // namespace detail
+
+}  // namespace toydb::simd
@@ -2,10 +2,15 @@
 
 #include <fmt/base.h>
 #include <fmt/format.h>
+#include <algorithm>
+#include <compare>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <concepts>
 
 namespace toydb {
@@ -27,20 +32,115 @@ inline std::string toString(CompareOp op) noexcept {
     }
 }
 
+/**
+ * @brief APPROX_COUNT_DISTINCT and APPROX_QUANTILE are estimated with mergeable sketches
+ */
+enum class AggregateFunction { COUNT_STAR, COUNT, SUM, AVG, MIN, MAX, APPROX_COUNT_DISTINCT, APPROX_QUANTILE };
+
+inline std::string toString(AggregateFunction function) noexcept {
+    switch (function) {
+        case AggregateFunction::COUNT_STAR: return "COUNT(*)";
+        case AggregateFunction::COUNT: return "COUNT";
+        case AggregateFunction::SUM: return "SUM";
+        case AggregateFunction::AVG: return "AVG";
+        case AggregateFunction::MIN: return "MIN";
+        case AggregateFunction::MAX: return "MAX";
+        case AggregateFunction::APPROX_COUNT_DISTINCT: return "APPROX_COUNT_DISTINCT";
+        case AggregateFunction::APPROX_QUANTILE: return "APPROX_QUANTILE";
+        default: return "UNKNOWN";
+    }
+}
+
+enum class SampleMethod { BERNOULLI, SYSTEM };
+
+inline std::string toString(SampleMethod method) noexcept {
+    switch (method) {
+        case SampleMethod::BERNOULLI: return "BERNOULLI";
+        case SampleMethod::SYSTEM: return "SYSTEM";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief TABLESAMPLE clause of a table. BERNOULLI keeps every row with the given probability,
+ * SYSTEM whole files or batches of rows, which is cheaper but less uniform.
+ */
+struct TableSample {
+    SampleMethod method;
+    // Percentage of the rows to keep, in [0, 100]
+    double percent;
+    // Seed of REPEATABLE (seed), a random seed is chosen if not set
+    std::optional<uint64_t> seed;
+
+    /**
+     * @brief Whether a row, batch or file drawn with a uniform random number is part of the sample
+     */
+    bool keeps(uint64_t random) const noexcept {
+        return static_cast<double>(random >> 11) * 0x1p-53 * 100.0 < percent;
+    }
+
+    bool operator==(const TableSample&) const = default;
+};
+
+enum class ArithmeticOp { ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO };
+
+inline std::string toString(ArithmeticOp op) noexcept {
+    switch (op) {
+        case ArithmeticOp::ADD: return "+";
+        case ArithmeticOp::SUBTRACT: return "-";
+        case ArithmeticOp::MULTIPLY: return "*";
+        case ArithmeticOp::DIVIDE: return "/";
+        case ArithmeticOp::MODULO: return "%";
+        default: return "UNKNOWN";
+    }
+}
+
+enum class ScalarFunction { UPPER, LOWER, LENGTH, SUBSTR, CONCAT };
+
+inline std::string toString(ScalarFunction function) noexcept {
+    switch (function) {
+        case ScalarFunction::UPPER: return "UPPER";
+        case ScalarFunction::LOWER: return "LOWER";
+        case ScalarFunction::LENGTH: return "LENGTH";
+        case ScalarFunction::SUBSTR: return "SUBSTR";
+        case ScalarFunction::CONCAT: return "CONCAT";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief Immutable name shared by all copies of an id, so that copying ids (e.g. with every column
+ * of a batch) does not allocate
+ */
+class SharedName {
+private:
+    std::shared_ptr<const std::string> name_;
+
+public:
+    SharedName() = default;
+    explicit SharedName(std::string name)
+        : name_(name.empty() ? nullptr : std::make_shared<const std::string>(std::move(name))) {}
+
+    const std::string& get() const noexcept {
+        static const std::string empty;
+        return name_ ? *name_ : empty;
+    }
+};
+
 /**
  * @brief Table identifier with a unique ID and human-readable name
  */
 class TableId {
 private:
     uint64_t id_;
-    std::string name_;
+    SharedName name_;
 
 public:
     TableId() : id_(0), name_() {}
     TableId(uint64_t id, std::string name) : id_(id), name_(std::move(name)) {}
 
     uint64_t getId() const noexcept { return id_; }
-    const std::string& getName() const noexcept { return name_; }
+    const std::string& getName() const noexcept { return name_.get(); }
 
     bool operator==(const TableId& other) const noexcept { return id_ == other.id_; }
     bool operator!=(const TableId& other) const noexcept { return id_ != other.id_; }
@@ -59,7 +159,7 @@ struct TableIdHash {
 class ColumnId {
 private:
     uint64_t id_;
-    std::string name_;
+    SharedName name_;
     TableId tableId_;
 
 public:
@@ -70,7 +170,7 @@ public:
         : id_(id), name_(std::move(name)) {}
 
     uint64_t getId() const noexcept { return id_; }
-    const std::string& getName() const noexcept { return name_; }
+    const std::string& getName() const noexcept { return name_.get(); }
     const TableId& getTableId() const noexcept { return tableId_; }
 
     bool operator==(const ColumnId& other) const noexcept { return id_ == other.id_; }
@@ -132,7 +232,91 @@ using db_int32 = int32_t;
 using db_int64 = int64_t;
 using db_bool = bool;
 using db_double = double;
-using db_string = char[256];
+
+/**
+ * @brief String value in the "German string" layout.
+ *
+ * Every value occupies 16 bytes: the length, a 4 character prefix, and either the remaining
+ * characters of strings up to INLINE_LENGTH characters or a pointer to all characters. The
+ * characters of long strings are not owned by the value, columns keep them in a StringHeap.
+ * Comparisons look at the length and prefix first, which decides most of them without
+ * following the pointer.
+ */
+class alignas(8) db_string {
+public:
+    static constexpr uint32_t INLINE_LENGTH = 12;
+    static constexpr uint32_t PREFIX_LENGTH = 4;
+
+    db_string() noexcept = default;
+
+    /**
+     * @brief Create a value for the characters. Long strings reference the characters,
+     * which must outlive the value.
+     */
+    static db_string fromView(std::string_view value) noexcept {
+        db_string result;
+        result.length_ = static_cast<uint32_t>(value.size());
+        if (value.empty()) {
+            return result;
+        }
+        if (value.size() <= INLINE_LENGTH) {
+            std::memcpy(result.chars_, value.data(), value.size());
+        } else {
+            std::memcpy(result.chars_, value.data(), PREFIX_LENGTH);
+            const char* pointer = value.data();
+            std::memcpy(result.chars_ + PREFIX_LENGTH, &pointer, sizeof(pointer));
+        }
+        return result;
+    }
+
+    uint32_t size() const noexcept {
+        return length_;
+    }
+
+    bool isInline() const noexcept {
+        return length_ <= INLINE_LENGTH;
+    }
+
+    const char* data() const noexcept {
+        if (isInline()) {
+            return chars_;
+        }
+        const char* pointer;
+        std::memcpy(&pointer, chars_ + PREFIX_LENGTH, sizeof(pointer));
+        return pointer;
+    }
+
+    std::string_view view() const noexcept {
+        return std::string_view(data(), length_);
+    }
+
+    friend bool operator==(const db_string& left, const db_string& right) noexcept {
+        // Length and prefix
+        if (std::memcmp(&left, &right, 8) != 0) {
+            return false;
+        }
+        if (left.isInline()) {
+            // Unused inline characters are zero
+            return std::memcmp(left.chars_ + PREFIX_LENGTH, right.chars_ + PREFIX_LENGTH, 8) == 0;
+        }
+        return std::memcmp(left.data() + PREFIX_LENGTH, right.data() + PREFIX_LENGTH, left.length_ - PREFIX_LENGTH) == 0;
+    }
+
+    friend std::strong_ordering operator<=>(const db_string& left, const db_string& right) noexcept {
+        size_t prefixLength = std::min<size_t>(PREFIX_LENGTH, std::min(left.length_, right.length_));
+        int cmp = std::memcmp(left.chars_, right.chars_, prefixLength);
+        if (cmp != 0) {
+            return cmp < 0 ? std::strong_ordering::less : std::strong_ordering::greater;
+        }
+        return left.view() <=> right.view();
+    }
+
+private:
+    uint32_t length_ = 0;
+    char chars_[12] = {};
+};
+
+static_assert(sizeof(db_string) == 16);
 
 template<typename T>
 concept is_db_type =
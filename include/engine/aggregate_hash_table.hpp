@@ -0,0 +1,1225 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "common/hash.hpp"
+#include "common/hyperloglog.hpp"
+#include "common/logging.hpp"
+#include "common/quantile_sketch.hpp"
+#include "common/types.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/spill.hpp"
+#include "engine/string_heap.hpp"
+
+namespace toydb {
+
+/**
+ * @brief An aggregate function applied to an input column, producing the output column
+ */
+struct AggregateSpec {
+    AggregateFunction function;
+    // Ignored for COUNT(*)
+    ColumnId input;
+    DataType inputType;
+    ColumnId output;
+    // Fraction of the sorted input estimated by APPROX_QUANTILE, e.g. 0.5 for the median
+    double quantile = 0.5;
+
+    /**
+     * @brief COUNT and APPROX_COUNT_DISTINCT are INT64, SUM keeps the input's domain (INT64 or
+     * DOUBLE), AVG and APPROX_QUANTILE are DOUBLE and MIN/MAX have the input type
+     * @throws InternalSQLError if the function is not defined for the input type
+     */
+    DataType getResultType() const {
+        bool numeric = inputType.isIntegral() || inputType == DataType::getDouble();
+        switch (function) {
+            case AggregateFunction::COUNT_STAR:
+            case AggregateFunction::COUNT:
+                return DataType::getInt64();
+            case AggregateFunction::SUM:
+                if (!numeric) {
+                    break;
+                }
+                return inputType == DataType::getDouble() ? DataType::getDouble() : DataType::getInt64();
+            case AggregateFunction::AVG:
+            case AggregateFunction::APPROX_QUANTILE:
+                if (!numeric) {
+                    break;
+                }
+                return DataType::getDouble();
+            case AggregateFunction::APPROX_COUNT_DISTINCT:
+                if (!numeric && inputType != DataType::getString()) {
+                    break;
+                }
+                return DataType::getInt64();
+            case AggregateFunction::MIN:
+            case AggregateFunction::MAX:
+                if (inputType == DataType::getNullConst()) {
+                    break;
+                }
+                return inputType;
+        }
+        throw InternalSQLError(toString(function) + " is not defined for " + inputType.toString());
+    }
+};
+
+/**
+ * @brief Hash table of groups and their partial aggregates.
+ *
+ * Batches are consumed column at a time: the keys of all selected rows are hashed per key column,
+ * every row is mapped to its group, and each aggregate is updated in a tight loop over the
+ * values of its input column. Groups are stored column-wise as well. NULL keys form a group of
+ * their own, NULL inputs are ignored by all aggregates except COUNT(*). APPROX_COUNT_DISTINCT keeps
+ * a HyperLogLog and APPROX_QUANTILE a KllSketch per group, which are merged like the other states.
+ *
+ * Tables filled by different threads can be merged, tables of other nodes through their exported
+ * partial states (see exportPartialStates). Once the estimated size of a table exceeds
+ * its memory budget, or the buffer pool is under pressure (see BufferManager::shouldSpill), all
+ * of its groups are written to SPILL_PARTITION_COUNT files partitioned by the high bits of their
+ * hash, and the table starts over empty. The same group may then be spilled several times with
+ * different partial states. When results are emitted, the partitions are loaded one at a time
+ * and their partial states are merged again.
+ */
+class AggregateHashTable {
+private:
+    // Values are stored and compared in a common domain per type
+    enum class Domain {
+        NONE,
+        INTEGRAL,
+        DOUBLE,
+        STRING,
+    };
+
+    struct KeyColumn {
+        DataType type;
+        Domain domain;
+        std::vector<uint8_t> nulls;
+        std::vector<int64_t> ints;
+        std::vector<double> doubles;
+        std::vector<db_string> strings;
+    };
+
+    // State of one aggregate for all groups. count is the number of non-null inputs, and tells
+    // MIN/MAX whether a value has been set. Only the sketch aggregates keep sketches.
+    struct AggregateColumn {
+        AggregateFunction function;
+        Domain domain;
+        std::vector<int64_t> counts;
+        std::vector<int64_t> ints;
+        std::vector<double> doubles;
+        std::vector<db_string> strings;
+        std::vector<HyperLogLog> distinctSketches;
+        std::vector<KllSketch> quantileSketches;
+    };
+
+    // Spill file of a partition, created when the first group is spilled to it
+    struct SpillPartition {
+        std::unique_ptr<SpillFile> file;
+        int64_t groupCount = 0;
+    };
+
+    // Reads the groups of exported partial states like a SpillReader reads a spill file
+    struct RecordReader {
+        std::string_view bytes;
+
+        bool read(void* data, size_t size) {
+            if (bytes.size() < size) {
+                throw SQLRuntimeException("Partial aggregate states are truncated");
+            }
+            std::memcpy(data, bytes.data(), size);
+            bytes.remove_prefix(size);
+            return true;
+        }
+    };
+
+    static constexpr int64_t EMPTY_SLOT = -1;
+    static constexpr uint64_t NULL_HASH = 0x9e3779b97f4a7c15ULL;
+    // Groups read back from a spill file before they are merged
+    static constexpr int64_t LOAD_BATCH_GROUPS = 1024;
+
+    std::vector<ColumnDescriptor> groupBy_;
+    std::vector<AggregateSpec> aggregates_;
+    memory::BufferManager* bufferManager_;
+    size_t memoryBudget_;
+    size_t bytesPerGroup_ = 0;
+
+    // Groups
+    std::vector<KeyColumn> keys_;
+    std::vector<AggregateColumn> states_;
+    std::vector<uint64_t> groupHashes_;
+    int64_t groupCount_ = 0;
+    StringHeap stringHeap_;
+
+    // Open addressing with linear probing, slots hold group indices
+    std::vector<int64_t> slots_;
+    uint64_t slotMask_ = 0;
+
+    // Per batch scratch: selected rows, their hashes and groups
+    std::vector<int64_t> rows_;
+    std::vector<uint64_t> hashes_;
+    std::vector<int64_t> groups_;
+    std::vector<int64_t> keyIndices_;
+    std::vector<int64_t> inputIndices_;
+
+    std::vector<SpillPartition> partitions_;
+    int64_t spillCount_ = 0;
+
+    // Emission state
+    bool finished_ = false;
+    size_t nextPartition_ = 0;
+    int64_t emitGroup_ = 0;
+    std::shared_ptr<const BatchSchema> outputSchema_;
+    BatchAllocator outputAllocator_;
+
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+    static constexpr size_t SPILL_PARTITION_COUNT = 16;
+
+    AggregateHashTable(std::vector<ColumnDescriptor> groupBy, std::vector<AggregateSpec> aggregates,
+                       memory::BufferManager* bufferManager, size_t memoryBudget = DEFAULT_MEMORY_BUDGET)
+        : groupBy_(std::move(groupBy)),
+          aggregates_(std::move(aggregates)),
+          bufferManager_(bufferManager),
+          memoryBudget_(memoryBudget),
+          outputAllocator_(bufferManager) {
+        bytesPerGroup_ = sizeof(uint64_t) + 2 * sizeof(int64_t);
+        std::vector<ColumnDescriptor> outputSchema;
+        for (const ColumnDescriptor& key : groupBy_) {
+            Domain domain = domainOf(key.type);
+            keys_.push_back({key.type, domain, {}, {}, {}, {}});
+            outputSchema.push_back(key);
+            bytesPerGroup_ += 1 + valueSize(domain);
+        }
+        for (const AggregateSpec& spec : aggregates_) {
+            DataType resultType = spec.getResultType();
+            Domain domain = stateDomain(spec);
+            states_.push_back({spec.function, domain, {}, {}, {}, {}, {}, {}});
+            outputSchema.push_back({spec.output, resultType});
+            bytesPerGroup_ += sizeof(int64_t) + valueSize(domain) + sketchSize(spec.function);
+        }
+        outputSchema_ = BatchSchema::make(std::move(outputSchema));
+        resetSlots(16);
+    }
+
+    AggregateHashTable(const AggregateHashTable&) = delete;
+    AggregateHashTable& operator=(const AggregateHashTable&) = delete;
+
+    /**
+     * @brief Group keys followed by one column per aggregate
+     */
+    const std::vector<ColumnDescriptor>& getOutputSchema() const noexcept {
+        return outputSchema_->getColumns();
+    }
+
+    /**
+     * @brief Number of groups held in memory
+     */
+    int64_t getGroupCount() const noexcept {
+        return groupCount_;
+    }
+
+    /**
+     * @brief How often the groups in memory were written to the spill partitions
+     */
+    int64_t getSpillCount() const noexcept {
+        return spillCount_;
+    }
+
+    /**
+     * @brief Estimated size of the groups in memory, checked against the memory budget
+     */
+    size_t getMemoryUsage() const noexcept {
+        return static_cast<size_t>(groupCount_) * bytesPerGroup_ + slots_.size() * sizeof(int64_t) +
+               stringHeap_.getAllocatedBytes();
+    }
+
+    /**
+     * @brief Add the selected rows of a batch to their groups
+     * @throws SQLRuntimeException if an integer SUM overflows
+     */
+    void consume(const RowVector& batch) {
+        tdb_assert(!finished_, "Cannot consume rows after results were emitted");
+
+        rows_.clear();
+        batch.forEachSelectedRow([this](int64_t row) { rows_.push_back(row); });
+        if (rows_.empty()) {
+            return;
+        }
+
+        resolveInputColumns(batch);
+
+        hashes_.assign(rows_.size(), 0);
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            hashKeyColumn(batch.getColumn(keyIndices_[k]));
+        }
+
+        groups_.resize(rows_.size());
+        for (size_t i = 0; i < rows_.size(); ++i) {
+            int64_t row = rows_[i];
+            groups_[i] = findOrInsert(
+                hashes_[i], [&](int64_t group) { return keysEqual(group, batch, row); },
+                [&] { appendKeys(batch, row); });
+        }
+
+        for (size_t a = 0; a < aggregates_.size(); ++a) {
+            updateAggregate(a, batch);
+        }
+
+        spillIfOverBudget();
+    }
+
+    /**
+     * @brief Merge the groups of another table with the same groups and aggregates into this
+     * one. The other table is left empty.
+     * @throws SQLRuntimeException if an integer SUM overflows
+     */
+    void merge(AggregateHashTable& other) {
+        tdb_assert(!finished_ && !other.finished_, "Cannot merge tables after results were emitted");
+        tdb_assert(other.keys_.size() == keys_.size() && other.states_.size() == states_.size(),
+                   "Merged aggregate tables differ in their layout");
+
+        mergeGroups(other);
+        other.clearGroups();
+
+        // Spilled partial states are merged when the partitions are loaded
+        for (size_t p = 0; p < other.partitions_.size(); ++p) {
+            SpillPartition& src = other.partitions_[p];
+            if (src.groupCount == 0) {
+                continue;
+            }
+            SpillPartition& dst = partition(p);
+            auto reader = src.file->openReader();
+            for (std::string_view block = reader->nextBlock(); !block.empty(); block = reader->nextBlock()) {
+                dst.file->write(block);
+            }
+            dst.groupCount += src.groupCount;
+            reader.reset();
+            src.file.reset();
+            src.groupCount = 0;
+        }
+
+        spillIfOverBudget();
+    }
+
+    /**
+     * @brief Produce the next batch of results, which stays valid until the next call. The
+     * first call finishes the aggregation: no more rows can be consumed afterwards.
+     * @return Number of rows, 0 once all groups were emitted
+     */
+    int64_t emit(RowVector& out) {
+        if (!finished_) {
+            finish();
+        }
+
+        outputAllocator_.reset();
+        outputAllocator_.allocateBatch(outputSchema_, out);
+        int64_t capacity = BatchAllocator::rowsPerBuffer(outputSchema_->getColumns());
+        int64_t rowCount = 0;
+
+        while (rowCount < capacity) {
+            if (emitGroup_ == groupCount_ && !loadNextPartition()) {
+                break;
+            }
+            int64_t n = std::min(capacity - rowCount, groupCount_ - emitGroup_);
+            writeGroups(out, rowCount, emitGroup_, n);
+            rowCount += n;
+            emitGroup_ += n;
+        }
+
+        if (rowCount == 0) {
+            out.clear();
+            return 0;
+        }
+        out.setRowCount(rowCount);
+        return rowCount;
+    }
+
+    /**
+     * @brief Finish the aggregation and pass the partial states of all groups to out instead of
+     * emitting results, in chunks of about chunkSize bytes. A table with the same groups and
+     * aggregates merges them with mergePartialStates(), e.g. the coordinator of a cluster.
+     * @return Number of groups passed to out
+     */
+    int64_t exportPartialStates(const std::function<void(std::string_view)>& out, size_t chunkSize) {
+        tdb_assert(!finished_, "Cannot export partial states after results were emitted");
+        finish();
+
+        // Spilled groups are merged per partition first, so that every group is sent once
+        int64_t exported = 0;
+        std::string chunk;
+        do {
+            for (int64_t group = 0; group < groupCount_; ++group) {
+                writeGroup(chunk, group);
+                if (chunk.size() >= chunkSize) {
+                    out(chunk);
+                    chunk.clear();
+                }
+            }
+            exported += groupCount_;
+        } while (loadNextPartition());
+
+        if (!chunk.empty()) {
+            out(chunk);
+        }
+        return exported;
+    }
+
+    /**
+     * @brief Merge groups passed to the output of exportPartialStates() of another table
+     * @throws SQLRuntimeException if the states end within a group, or an integer SUM overflows
+     */
+    void mergePartialStates(std::string_view states) {
+        tdb_assert(!finished_, "Cannot merge partial states after results were emitted");
+
+        AggregateHashTable loaded(groupBy_, aggregates_, bufferManager_, std::numeric_limits<size_t>::max());
+        RecordReader in {states};
+        std::string buffer;
+        while (!in.bytes.empty()) {
+            loaded.readGroup(in, buffer);
+            if (loaded.groupCount_ == LOAD_BATCH_GROUPS) {
+                mergeGroups(loaded);
+                loaded.clearGroups();
+            }
+        }
+        mergeGroups(loaded);
+        spillIfOverBudget();
+    }
+
+private:
+    static Domain domainOf(DataType type) {
+        if (type.isIntegral()) {
+            return Domain::INTEGRAL;
+        } else if (type == DataType::getDouble()) {
+            return Domain::DOUBLE;
+        } else if (type == DataType::getString()) {
+            return Domain::STRING;
+        }
+        throw InternalSQLError("Cannot aggregate values of type " + type.toString());
+    }
+
+    static Domain stateDomain(const AggregateSpec& spec) {
+        switch (spec.function) {
+            case AggregateFunction::COUNT_STAR:
+            case AggregateFunction::COUNT:
+            case AggregateFunction::APPROX_COUNT_DISTINCT:
+            case AggregateFunction::APPROX_QUANTILE:
+                return Domain::NONE;
+            case AggregateFunction::AVG:
+                return Domain::DOUBLE;
+            case AggregateFunction::SUM:
+            case AggregateFunction::MIN:
+            case AggregateFunction::MAX:
+                return domainOf(spec.inputType);
+        }
+        tdb_unreachable("Unknown aggregate function");
+    }
+
+    static size_t valueSize(Domain domain) noexcept {
+        switch (domain) {
+            case Domain::NONE:
+                return 0;
+            case Domain::INTEGRAL:
+            case Domain::DOUBLE:
+                return 8;
+            case Domain::STRING:
+                return sizeof(db_string);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Estimated size of the sketch a group keeps for the function, 0 if it keeps none.
+     *        Quantile sketches are counted at the size they grow to for large groups.
+     */
+    static size_t sketchSize(AggregateFunction function) noexcept {
+        switch (function) {
+            case AggregateFunction::APPROX_COUNT_DISTINCT:
+                return sizeof(HyperLogLog) + HyperLogLog::REGISTER_COUNT;
+            case AggregateFunction::APPROX_QUANTILE:
+                return sizeof(KllSketch) + 2 * KllSketch::K * sizeof(double);
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     * @brief Hash of a non-null value, the same as the catalog statistics use for their distinct
+     *        sketches. Integral values hash equal across their types.
+     */
+    template<is_db_type T>
+    static uint64_t hashValue(const T& value) noexcept {
+        if constexpr (std::is_same_v<T, db_string>) {
+            std::string_view view = value.view();
+            return hashBytes(view.data(), view.size());
+        } else if constexpr (std::is_same_v<T, db_double>) {
+            return hashDouble(value);
+        } else if constexpr (std::is_same_v<T, db_bool>) {
+            return hashInt64(value ? 1 : 0);
+        } else {
+            return hashInt64(static_cast<int64_t>(value));
+        }
+    }
+
+    static int64_t readIntegral(const ColumnBuffer& col, int64_t row) {
+        switch (col.type.getType()) {
+            case DataType::Type::INT32:
+                return col.getEntry<db_int32>(row);
+            case DataType::Type::INT64:
+                return col.getEntry<db_int64>(row);
+            case DataType::Type::BOOL:
+                return col.getEntry<db_bool>(row) ? 1 : 0;
+            default:
+                tdb_unreachable("Not an integral type");
+        }
+    }
+
+    void resolveInputColumns(const RowVector& batch) {
+        keyIndices_.clear();
+        for (const ColumnDescriptor& key : groupBy_) {
+            int64_t index = batch.getColumnIndex(key.columnId);
+            if (index == -1) {
+                throw InternalSQLError("Group column " + key.columnId.getName() + " is not produced by the aggregate input");
+            }
+            tdb_assert(batch.getColumn(index).type == key.type, "Group column {} has the wrong type", key.columnId.getName());
+            keyIndices_.push_back(index);
+        }
+
+        inputIndices_.clear();
+        for (const AggregateSpec& spec : aggregates_) {
+            int64_t index = -1;
+            if (spec.function != AggregateFunction::COUNT_STAR) {
+                index = batch.getColumnIndex(spec.input);
+                if (index == -1) {
+                    throw InternalSQLError("Aggregate input " + spec.input.getName() + " is not produced by the aggregate input");
+                }
+                tdb_assert(batch.getColumn(index).type == spec.inputType, "Aggregate input {} has the wrong type", spec.input.getName());
+            }
+            inputIndices_.push_back(index);
+        }
+    }
+
+    template<is_db_type T>
+    void hashValues(const ColumnBuffer& col) {
+        std::span<T> values = col.getDataAs<T>();
+        for (size_t i = 0; i < rows_.size(); ++i) {
+            int64_t row = rows_[i];
+            uint64_t hash = col.isNull(row) ? NULL_HASH : hashValue(values[static_cast<size_t>(row)]);
+            hashes_[i] = hashCombine(hashes_[i], hash);
+        }
+    }
+
+    void hashKeyColumn(const ColumnBuffer& col) {
+        switch (col.type.getType()) {
+            case DataType::Type::INT32:
+                hashValues<db_int32>(col);
+                break;
+            case DataType::Type::INT64:
+                hashValues<db_int64>(col);
+                break;
+            case DataType::Type::BOOL:
+                hashValues<db_bool>(col);
+                break;
+            case DataType::Type::DOUBLE:
+                hashValues<db_double>(col);
+                break;
+            case DataType::Type::STRING:
+                hashValues<db_string>(col);
+                break;
+            default:
+                tdb_unreachable("Unsupported group column type");
+        }
+    }
+
+    void resetSlots(size_t slotCount) {
+        slots_.assign(slotCount, EMPTY_SLOT);
+        slotMask_ = slotCount - 1;
+    }
+
+    // Keep the load factor at most 0.5
+    void grow() {
+        resetSlots(slots_.size() * 2);
+        for (int64_t group = 0; group < groupCount_; ++group) {
+            size_t slot = groupHashes_[static_cast<size_t>(group)] & slotMask_;
+            while (slots_[slot] != EMPTY_SLOT) {
+                slot = (slot + 1) & slotMask_;
+            }
+            slots_[slot] = group;
+        }
+    }
+
+    /**
+     * @brief Find the group with the given hash for which equals(group) holds, or call insert()
+     * to append the keys of a new group
+     */
+    template<typename Equals, typename Insert>
+    int64_t findOrInsert(uint64_t hash, Equals&& equals, Insert&& insert) {
+        size_t slot = hash & slotMask_;
+        while (true) {
+            int64_t group = slots_[slot];
+            if (group == EMPTY_SLOT) {
+                group = groupCount_;
+                insert();
+                groupHashes_.push_back(hash);
+                appendStates();
+                ++groupCount_;
+                slots_[slot] = group;
+
+                if (static_cast<size_t>(groupCount_) * 2 > slots_.size()) {
+                    grow();
+                }
+                return group;
+            }
+            if (groupHashes_[static_cast<size_t>(group)] == hash && equals(group)) {
+                return group;
+            }
+            slot = (slot + 1) & slotMask_;
+        }
+    }
+
+    db_string ownString(const db_string& value) {
+        return value.isInline() ? value : stringHeap_.makeString(value.view());
+    }
+
+    bool keysEqual(int64_t group, const RowVector& batch, int64_t row) const {
+        size_t g = static_cast<size_t>(group);
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            const KeyColumn& key = keys_[k];
+            const ColumnBuffer& col = batch.getColumn(keyIndices_[k]);
+            bool isNull = col.isNull(row);
+            if (isNull != (key.nulls[g] != 0)) {
+                return false;
+            }
+            if (isNull) {
+                continue;
+            }
+
+            switch (key.domain) {
+                case Domain::INTEGRAL:
+                    if (readIntegral(col, row) != key.ints[g]) return false;
+                    break;
+                case Domain::DOUBLE:
+                    if (col.getEntry<db_double>(row) != key.doubles[g]) return false;
+                    break;
+                case Domain::STRING:
+                    if (!(col.getEntry<db_string>(row) == key.strings[g])) return false;
+                    break;
+                case Domain::NONE:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    bool keysEqual(int64_t group, const AggregateHashTable& other, int64_t otherGroup) const {
+        size_t g = static_cast<size_t>(group);
+        size_t og = static_cast<size_t>(otherGroup);
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            const KeyColumn& key = keys_[k];
+            const KeyColumn& otherKey = other.keys_[k];
+            if (key.nulls[g] != otherKey.nulls[og]) {
+                return false;
+            }
+            if (key.nulls[g]) {
+                continue;
+            }
+
+            switch (key.domain) {
+                case Domain::INTEGRAL:
+                    if (key.ints[g] != otherKey.ints[og]) return false;
+                    break;
+                case Domain::DOUBLE:
+                    if (key.doubles[g] != otherKey.doubles[og]) return false;
+                    break;
+                case Domain::STRING:
+                    if (!(key.strings[g] == otherKey.strings[og])) return false;
+                    break;
+                case Domain::NONE:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    void appendKeys(const RowVector& batch, int64_t row) {
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            KeyColumn& key = keys_[k];
+            const ColumnBuffer& col = batch.getColumn(keyIndices_[k]);
+            bool isNull = col.isNull(row);
+            key.nulls.push_back(isNull ? 1 : 0);
+
+            switch (key.domain) {
+                case Domain::INTEGRAL:
+                    key.ints.push_back(isNull ? 0 : readIntegral(col, row));
+                    break;
+                case Domain::DOUBLE:
+                    key.doubles.push_back(isNull ? 0.0 : col.getEntry<db_double>(row));
+                    break;
+                case Domain::STRING:
+                    key.strings.push_back(isNull ? db_string() : ownString(col.getEntry<db_string>(row)));
+                    break;
+                case Domain::NONE:
+                    break;
+            }
+        }
+    }
+
+    void appendKeys(const AggregateHashTable& other, int64_t otherGroup) {
+        size_t og = static_cast<size_t>(otherGroup);
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            KeyColumn& key = keys_[k];
+            const KeyColumn& otherKey = other.keys_[k];
+            key.nulls.push_back(otherKey.nulls[og]);
+
+            switch (key.domain) {
+                case Domain::INTEGRAL:
+                    key.ints.push_back(otherKey.ints[og]);
+                    break;
+                case Domain::DOUBLE:
+                    key.doubles.push_back(otherKey.doubles[og]);
+                    break;
+                case Domain::STRING:
+                    key.strings.push_back(ownString(otherKey.strings[og]));
+                    break;
+                case Domain::NONE:
+                    break;
+            }
+        }
+    }
+
+    void appendStates() {
+        for (AggregateColumn& state : states_) {
+            state.counts.push_back(0);
+            if (state.function == AggregateFunction::APPROX_COUNT_DISTINCT) {
+                state.distinctSketches.emplace_back();
+            } else if (state.function == AggregateFunction::APPROX_QUANTILE) {
+                state.quantileSketches.emplace_back();
+            }
+            switch (state.domain) {
+                case Domain::INTEGRAL:
+                    state.ints.push_back(0);
+                    break;
+                case Domain::DOUBLE:
+                    state.doubles.push_back(0.0);
+                    break;
+                case Domain::STRING:
+                    state.strings.emplace_back();
+                    break;
+                case Domain::NONE:
+                    break;
+            }
+        }
+    }
+
+    void updateAggregate(size_t a, const RowVector& batch) {
+        const AggregateSpec& spec = aggregates_[a];
+        AggregateColumn& state = states_[a];
+
+        if (spec.function == AggregateFunction::COUNT_STAR) {
+            for (int64_t group : groups_) {
+                ++state.counts[static_cast<size_t>(group)];
+            }
+            return;
+        }
+
+        const ColumnBuffer& col = batch.getColumn(inputIndices_[a]);
+        switch (col.type.getType()) {
+            case DataType::Type::INT32:
+                updateTyped<db_int32>(spec.function, state, col);
+                break;
+            case DataType::Type::INT64:
+                updateTyped<db_int64>(spec.function, state, col);
+                break;
+            case DataType::Type::BOOL:
+                updateTyped<db_bool>(spec.function, state, col);
+                break;
+            case DataType::Type::DOUBLE:
+                updateTyped<db_double>(spec.function, state, col);
+                break;
+            case DataType::Type::STRING:
+                updateTyped<db_string>(spec.function, state, col);
+                break;
+            default:
+                tdb_unreachable("Unsupported aggregate input type");
+        }
+    }
+
+    /**
+     * @brief Update one aggregate with the values of its input column. The function is resolved
+     * outside of the loop over the rows.
+     */
+    template<is_db_type T>
+    void updateTyped(AggregateFunction function, AggregateColumn& state, const ColumnBuffer& col) {
+        std::span<T> values = col.getDataAs<T>();
+        bool mayBeNull = col.getNullBitmap().data() != nullptr;
+
+        auto forEachValue = [&](auto&& update) {
+            for (size_t i = 0; i < rows_.size(); ++i) {
+                int64_t row = rows_[i];
+                if (mayBeNull && col.isNull(row)) {
+                    continue;
+                }
+                update(static_cast<size_t>(groups_[i]), values[static_cast<size_t>(row)]);
+            }
+        };
+
+        constexpr bool isString = std::is_same_v<T, db_string>;
+        constexpr bool isDouble = std::is_same_v<T, db_double>;
+
+        switch (function) {
+            case AggregateFunction::COUNT:
+                forEachValue([&](size_t g, const T&) { ++state.counts[g]; });
+                break;
+            case AggregateFunction::SUM:
+                if constexpr (isDouble) {
+                    forEachValue([&](size_t g, T value) { ++state.counts[g]; state.doubles[g] += value; });
+                } else if constexpr (!isString) {
+                    forEachValue([&](size_t g, T value) {
+                        ++state.counts[g];
+                        if (__builtin_add_overflow(state.ints[g], static_cast<int64_t>(value), &state.ints[g])) {
+                            throw SQLRuntimeException("Integer overflow in SUM");
+                        }
+                    });
+                }
+                break;
+            case AggregateFunction::AVG:
+                if constexpr (!isString) {
+                    forEachValue([&](size_t g, T value) { ++state.counts[g]; state.doubles[g] += static_cast<double>(value); });
+                }
+                break;
+            case AggregateFunction::MIN:
+            case AggregateFunction::MAX: {
+                bool isMin = function == AggregateFunction::MIN;
+                if constexpr (isString) {
+                    forEachValue([&](size_t g, const db_string& value) {
+                        if (state.counts[g] == 0 || (isMin ? value < state.strings[g] : state.strings[g] < value)) {
+                            state.strings[g] = ownString(value);
+                        }
+                        ++state.counts[g];
+                    });
+                } else if constexpr (isDouble) {
+                    forEachValue([&](size_t g, T value) {
+                        if (state.counts[g] == 0 || (isMin ? value < state.doubles[g] : value > state.doubles[g])) {
+                            state.doubles[g] = value;
+                        }
+                        ++state.counts[g];
+                    });
+                } else {
+                    forEachValue([&](size_t g, T value) {
+                        auto v = static_cast<int64_t>(value);
+                        if (state.counts[g] == 0 || (isMin ? v < state.ints[g] : v > state.ints[g])) {
+                            state.ints[g] = v;
+                        }
+                        ++state.counts[g];
+                    });
+                }
+                break;
+            }
+            case AggregateFunction::APPROX_COUNT_DISTINCT:
+                forEachValue([&](size_t g, const T& value) {
+                    ++state.counts[g];
+                    state.distinctSketches[g].addHash(hashValue(value));
+                });
+                break;
+            case AggregateFunction::APPROX_QUANTILE:
+                if constexpr (!isString) {
+                    forEachValue([&](size_t g, T value) {
+                        ++state.counts[g];
+                        state.quantileSketches[g].add(static_cast<double>(value));
+                    });
+                }
+                break;
+            case AggregateFunction::COUNT_STAR:
+                tdb_unreachable("COUNT(*) has no input column");
+        }
+    }
+
+    /**
+     * @brief Combine the partial states of otherGroup into group
+     */
+    void combineStates(int64_t group, const AggregateHashTable& other, int64_t otherGroup) {
+        size_t g = static_cast<size_t>(group);
+        size_t og = static_cast<size_t>(otherGroup);
+
+        for (size_t a = 0; a < aggregates_.size(); ++a) {
+            AggregateColumn& state = states_[a];
+            const AggregateColumn& otherState = other.states_[a];
+            int64_t otherCount = otherState.counts[og];
+            if (otherCount == 0) {
+                continue;
+            }
+
+            AggregateFunction function = aggregates_[a].function;
+            if (function == AggregateFunction::APPROX_COUNT_DISTINCT) {
+                state.distinctSketches[g].merge(otherState.distinctSketches[og]);
+            } else if (function == AggregateFunction::APPROX_QUANTILE) {
+                state.quantileSketches[g].merge(otherState.quantileSketches[og]);
+            } else if (function == AggregateFunction::MIN || function == AggregateFunction::MAX) {
+                bool isMin = function == AggregateFunction::MIN;
+                bool replace = state.counts[g] == 0;
+                switch (state.domain) {
+                    case Domain::INTEGRAL:
+                        replace = replace || (isMin ? otherState.ints[og] < state.ints[g] : otherState.ints[og] > state.ints[g]);
+                        if (replace) state.ints[g] = otherState.ints[og];
+                        break;
+                    case Domain::DOUBLE:
+                        replace = replace || (isMin ? otherState.doubles[og] < state.doubles[g] : otherState.doubles[og] > state.doubles[g]);
+                        if (replace) state.doubles[g] = otherState.doubles[og];
+                        break;
+                    case Domain::STRING:
+                        replace = replace || (isMin ? otherState.strings[og] < state.strings[g] : state.strings[g] < otherState.strings[og]);
+                        if (replace) state.strings[g] = ownString(otherState.strings[og]);
+                        break;
+                    case Domain::NONE:
+                        break;
+                }
+            } else if (state.domain == Domain::INTEGRAL) {
+                if (__builtin_add_overflow(state.ints[g], otherState.ints[og], &state.ints[g])) {
+                    throw SQLRuntimeException("Integer overflow in " + toString(function));
+                }
+            } else if (state.domain == Domain::DOUBLE) {
+                state.doubles[g] += otherState.doubles[og];
+            }
+            state.counts[g] += otherCount;
+        }
+    }
+
+    void mergeGroups(const AggregateHashTable& other) {
+        for (int64_t og = 0; og < other.groupCount_; ++og) {
+            int64_t group = findOrInsert(
+                other.groupHashes_[static_cast<size_t>(og)], [&](int64_t g) { return keysEqual(g, other, og); },
+                [&] { appendKeys(other, og); });
+            combineStates(group, other, og);
+        }
+    }
+
+    void clearGroups() {
+        for (KeyColumn& key : keys_) {
+            key.nulls.clear();
+            key.ints.clear();
+            key.doubles.clear();
+            key.strings.clear();
+        }
+        for (AggregateColumn& state : states_) {
+            state.counts.clear();
+            state.ints.clear();
+            state.doubles.clear();
+            state.strings.clear();
+            state.distinctSketches.clear();
+            state.quantileSketches.clear();
+        }
+        groupHashes_.clear();
+        groupCount_ = 0;
+        stringHeap_.reset();
+        resetSlots(16);
+    }
+
+    // Spill partitions are selected by the high bits, the slots by the low bits of the hash
+    static size_t partitionOf(uint64_t hash) noexcept {
+        return static_cast<size_t>(hash >> 60);
+    }
+    static_assert(SPILL_PARTITION_COUNT == 16, "partitionOf uses the top 4 bits of the hash");
+
+    SpillPartition& partition(size_t index) {
+        if (partitions_.empty()) {
+            partitions_.resize(SPILL_PARTITION_COUNT);
+        }
+        SpillPartition& spilled = partitions_[index];
+        if (!spilled.file) {
+            spilled.file = std::make_unique<SpillFile>("aggregate");
+        }
+        return spilled;
+    }
+
+    void spillIfOverBudget() {
+        if (bufferManager_->shouldSpill(getMemoryUsage(), memoryBudget_) && groupCount_ > 0) {
+            spill();
+        }
+    }
+
+    /**
+     * @brief Write all groups to the spill partitions and clear the table
+     */
+    void spill() {
+        Logger::debug("AggregateHashTable: spilling {} groups ({} bytes)", groupCount_, getMemoryUsage());
+
+        std::string record;
+        for (int64_t group = 0; group < groupCount_; ++group) {
+            SpillPartition& spilled = partition(partitionOf(groupHashes_[static_cast<size_t>(group)]));
+            record.clear();
+            writeGroup(record, group);
+            spilled.file->write(record);
+            ++spilled.groupCount;
+        }
+
+        clearGroups();
+        ++spillCount_;
+    }
+
+    template<typename T>
+    static void writeValue(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename Reader, typename T>
+    static bool readValue(Reader& in, T& value) {
+        return in.read(&value, sizeof(T));
+    }
+
+    static void writeBytes(std::string& out, std::string_view bytes) {
+        writeValue(out, static_cast<uint32_t>(bytes.size()));
+        out.append(bytes);
+    }
+
+    /**
+     * @brief Read bytes written by writeBytes into buffer
+     */
+    template<typename Reader>
+    static std::string_view readBytes(Reader& in, std::string& buffer) {
+        uint32_t length = 0;
+        readValue(in, length);
+        buffer.resize(length);
+        in.read(buffer.data(), length);
+        return buffer;
+    }
+
+    static void writeString(std::string& out, const db_string& value) {
+        writeBytes(out, value.view());
+    }
+
+    template<typename Reader>
+    db_string readString(Reader& in, std::string& buffer) {
+        std::string_view bytes = readBytes(in, buffer);
+        return bytes.size() > db_string::INLINE_LENGTH ? stringHeap_.makeString(bytes) : db_string::fromView(bytes);
+    }
+
+    static void writeSketch(std::string& out, const AggregateColumn& state, size_t g) {
+        std::string sketch;
+        if (state.function == AggregateFunction::APPROX_COUNT_DISTINCT) {
+            state.distinctSketches[g].appendTo(sketch);
+        } else if (state.function == AggregateFunction::APPROX_QUANTILE) {
+            state.quantileSketches[g].appendTo(sketch);
+        } else {
+            return;
+        }
+        writeBytes(out, sketch);
+    }
+
+    template<typename Reader>
+    static void readSketch(Reader& in, AggregateColumn& state, std::string& buffer) {
+        if (state.function == AggregateFunction::APPROX_COUNT_DISTINCT) {
+            auto sketch = HyperLogLog::fromBytes(readBytes(in, buffer));
+            tdb_assert(sketch.has_value(), "Spilled distinct sketch is corrupt");
+            state.distinctSketches.push_back(std::move(*sketch));
+        } else if (state.function == AggregateFunction::APPROX_QUANTILE) {
+            auto sketch = KllSketch::fromBytes(readBytes(in, buffer));
+            tdb_assert(sketch.has_value(), "Spilled quantile sketch is corrupt");
+            state.quantileSketches.push_back(std::move(*sketch));
+        }
+    }
+
+    void writeGroup(std::string& out, int64_t group) const {
+        size_t g = static_cast<size_t>(group);
+        writeValue(out, groupHashes_[g]);
+
+        for (const KeyColumn& key : keys_) {
+            writeValue(out, key.nulls[g]);
+            switch (key.domain) {
+                case Domain::INTEGRAL: writeValue(out, key.ints[g]); break;
+                case Domain::DOUBLE: writeValue(out, key.doubles[g]); break;
+                case Domain::STRING: writeString(out, key.strings[g]); break;
+                case Domain::NONE: break;
+            }
+        }
+        for (const AggregateColumn& state : states_) {
+            writeValue(out, state.counts[g]);
+            switch (state.domain) {
+                case Domain::INTEGRAL: writeValue(out, state.ints[g]); break;
+                case Domain::DOUBLE: writeValue(out, state.doubles[g]); break;
+                case Domain::STRING: writeString(out, state.strings[g]); break;
+                case Domain::NONE: break;
+            }
+            writeSketch(out, state, g);
+        }
+    }
+
+    /**
+     * @brief Append a group written by writeGroup, without inserting it into the slots
+     * @param in A SpillReader or RecordReader
+     * @return false at the end of the input
+     */
+    template<typename Reader>
+    bool readGroup(Reader& in, std::string& buffer) {
+        uint64_t hash = 0;
+        if (!readValue(in, hash)) {
+            return false;
+        }
+        groupHashes_.push_back(hash);
+
+        for (KeyColumn& key : keys_) {
+            uint8_t isNull = 0;
+            readValue(in, isNull);
+            key.nulls.push_back(isNull);
+            switch (key.domain) {
+                case Domain::INTEGRAL: readValue(in, key.ints.emplace_back()); break;
+                case Domain::DOUBLE: readValue(in, key.doubles.emplace_back()); break;
+                case Domain::STRING: key.strings.push_back(readString(in, buffer)); break;
+                case Domain::NONE: break;
+            }
+        }
+        for (AggregateColumn& state : states_) {
+            readValue(in, state.counts.emplace_back());
+            switch (state.domain) {
+                case Domain::INTEGRAL: readValue(in, state.ints.emplace_back()); break;
+                case Domain::DOUBLE: readValue(in, state.doubles.emplace_back()); break;
+                case Domain::STRING: state.strings.push_back(readString(in, buffer)); break;
+                case Domain::NONE: break;
+            }
+            readSketch(in, state, buffer);
+        }
+        ++groupCount_;
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting rows and move the remaining groups to disk if the table spilled before
+     */
+    void finish() {
+        finished_ = true;
+
+        // An aggregation without groups produces a single row, even for an empty input
+        if (keys_.empty() && groupCount_ == 0 && partitions_.empty()) {
+            groupHashes_.push_back(0);
+            appendStates();
+            groupCount_ = 1;
+        }
+
+        if (!partitions_.empty() && groupCount_ > 0) {
+            spill();
+        }
+        emitGroup_ = 0;
+    }
+
+    /**
+     * @brief Replace the groups in memory with the merged groups of the next spill partition
+     * @return false if there is no partition left
+     */
+    bool loadNextPartition() {
+        while (nextPartition_ < partitions_.size()) {
+            SpillPartition& spilled = partitions_[nextPartition_++];
+            clearGroups();
+            emitGroup_ = 0;
+            if (spilled.groupCount == 0) {
+                continue;
+            }
+
+            AggregateHashTable loaded(groupBy_, aggregates_, bufferManager_, std::numeric_limits<size_t>::max());
+            std::string buffer;
+            auto reader = spilled.file->openReader();
+            while (loaded.readGroup(*reader, buffer)) {
+                if (loaded.groupCount_ == LOAD_BATCH_GROUPS) {
+                    mergeGroups(loaded);
+                    loaded.clearGroups();
+                }
+            }
+            mergeGroups(loaded);
+
+            if (getMemoryUsage() > memoryBudget_) {
+                Logger::warn("AggregateHashTable: spill partition with {} groups exceeds the memory budget", groupCount_);
+            }
+            Logger::debug("AggregateHashTable: loaded {} groups from spill partition {}", groupCount_, nextPartition_ - 1);
+
+            // Release the disk space early
+            reader.reset();
+            spilled.file.reset();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Write n groups starting at firstGroup to the rows of the batch starting at firstRow
+     */
+    void writeGroups(RowVector& batch, int64_t firstRow, int64_t firstGroup, int64_t n) {
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            const KeyColumn& key = keys_[k];
+            ColumnBuffer& col = batch.getColumn(static_cast<int64_t>(k));
+            for (int64_t i = 0; i < n; ++i) {
+                size_t g = static_cast<size_t>(firstGroup + i);
+                int64_t row = firstRow + i;
+                if (key.nulls[g]) {
+                    col.setNull(row);
+                    col.count = std::max(col.count, row + 1);
+                    continue;
+                }
+                switch (key.type.getType()) {
+                    case DataType::Type::INT32: col.writeEntry<db_int32>(row, static_cast<db_int32>(key.ints[g])); break;
+                    case DataType::Type::INT64: col.writeEntry<db_int64>(row, key.ints[g]); break;
+                    case DataType::Type::BOOL: col.writeEntry<db_bool>(row, key.ints[g] != 0); break;
+                    case DataType::Type::DOUBLE: col.writeEntry<db_double>(row, key.doubles[g]); break;
+                    case DataType::Type::STRING: col.writeString(row, key.strings[g].view()); break;
+                    default: tdb_unreachable("Unsupported group column type");
+                }
+            }
+        }
+
+        for (size_t a = 0; a < aggregates_.size(); ++a) {
+            const AggregateSpec& spec = aggregates_[a];
+            const AggregateColumn& state = states_[a];
+            ColumnBuffer& col = batch.getColumn(static_cast<int64_t>(keys_.size() + a));
+            DataType resultType = outputSchema_->getColumn(static_cast<int64_t>(keys_.size() + a)).type;
+
+            for (int64_t i = 0; i < n; ++i) {
+                size_t g = static_cast<size_t>(firstGroup + i);
+                int64_t row = firstRow + i;
+                int64_t count = state.counts[g];
+
+                if (spec.function == AggregateFunction::COUNT_STAR || spec.function == AggregateFunction::COUNT) {
+                    col.writeEntry<db_int64>(row, count);
+                    continue;
+                }
+                if (spec.function == AggregateFunction::APPROX_COUNT_DISTINCT) {
+                    // There can't be more distinct values than values
+                    auto estimate = std::llround(state.distinctSketches[g].estimate());
+                    col.writeEntry<db_int64>(row, std::min<int64_t>(estimate, count));
+                    continue;
+                }
+                if (count == 0) {
+                    col.setNull(row);
+                    col.count = std::max(col.count, row + 1);
+                    continue;
+                }
+                if (spec.function == AggregateFunction::AVG) {
+                    col.writeEntry<db_double>(row, state.doubles[g] / static_cast<double>(count));
+                    continue;
+                }
+                if (spec.function == AggregateFunction::APPROX_QUANTILE) {
+                    col.writeEntry<db_double>(row, state.quantileSketches[g].quantile(spec.quantile));
+                    continue;
+                }
+                switch (resultType.getType()) {
+                    case DataType::Type::INT32: col.writeEntry<db_int32>(row, static_cast<db_int32>(state.ints[g])); break;
+                    case DataType::Type::INT64: col.writeEntry<db_int64>(row, state.ints[g]); break;
+                    case DataType::Type::BOOL: col.writeEntry<db_bool>(row, state.ints[g] != 0); break;
+                    case DataType::Type::DOUBLE: col.writeEntry<db_double>(row, state.doubles[g]); break;
+                    case DataType::Type::STRING: col.writeString(row, state.strings[g].view()); break;
+                    default: tdb_unreachable("Unsupported aggregate result type");
+                }
+            }
+        }
+    }
+};
+
+}  // namespace toydb
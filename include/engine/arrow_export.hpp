@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include "engine/physical_operator.hpp"
+#include "planner/physical_planner.hpp"
+
+namespace arrow {
+class RecordBatch;
+class RecordBatchReader;
+class Schema;
+}  // namespace arrow
+
+namespace toydb {
+
+/**
+ * @brief How fixed-width columns are handed to Arrow. Their layout already matches Arrow's: the
+ * values are contiguous and the NullBitmap is an LSB-first validity bitmap. BOOL and STRING columns
+ * and batches with a selection are always built row by row.
+ */
+enum class ArrowBufferMode {
+    // Point at the batch's buffers, the record batch is only valid until the batch is reused
+    WRAP,
+    // Copy the buffers, the record batch owns its memory
+    COPY,
+};
+
+std::shared_ptr<arrow::Schema> toArrowSchema(const BatchSchema& schema);
+
+/**
+ * @brief Convert the selected rows of a batch
+ * @param schema The Arrow schema of the batch's schema, see toArrowSchema
+ * @throws InternalSQLError if Arrow fails to allocate
+ */
+std::shared_ptr<arrow::RecordBatch> toRecordBatch(const std::shared_ptr<arrow::Schema>& schema, const RowVector& batch,
+                                                  ArrowBufferMode mode);
+
+/**
+ * @brief Run a plan as a stream of record batches that its reader pulls one at a time, e.g. to
+ * hand the result to pandas or Polars in process without encoding it.
+ *
+ * Operators only expose their schema with their batches, so the first batch is pulled when the
+ * reader is created. The schema of an empty result has no fields. The record batches own their
+ * memory, since the plan reuses its batches.
+ */
+std::shared_ptr<arrow::RecordBatchReader> makeRecordBatchReader(PhysicalQueryPlan plan);
+
+}  // namespace toydb
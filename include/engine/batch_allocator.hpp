@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/types.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/string_heap.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Returns the columns of a batch in order
+ */
+inline std::vector<ColumnDescriptor> getColumnDescriptors(const RowVector& batch) {
+    return batch.getSchema()->getColumns();
+}
+
+/**
+ * @brief Carves ColumnBuffers out of BufferManager buffers. Every column occupies exactly one
+ * buffer: the null bitmap first, followed by the values.
+ *
+ * The allocator owns the buffer handles, so the columns it hands out stay valid
+ * until reset() is called or the allocator is destroyed.
+ */
+class BatchAllocator {
+private:
+    memory::BufferManager* bufferManager_;
+    std::vector<memory::BufferManager::BufferHandle> handles_;
+    // Characters of long strings written to string columns allocated here
+    std::unique_ptr<StringHeap> stringHeap_ = std::make_unique<StringHeap>();
+
+    // Bitmap size padded to 8 bytes, so the values that follow are aligned
+    static size_t bitmapBytes(int64_t capacity) noexcept {
+        size_t bytes = static_cast<size_t>(capacity + 7) / 8;
+        return (bytes + 7) & ~static_cast<size_t>(7);
+    }
+
+public:
+    explicit BatchAllocator(memory::BufferManager* bufferManager) : bufferManager_(bufferManager) {}
+
+    BatchAllocator(const BatchAllocator&) = delete;
+    BatchAllocator& operator=(const BatchAllocator&) = delete;
+
+    BatchAllocator(BatchAllocator&&) = default;
+    BatchAllocator& operator=(BatchAllocator&&) = default;
+
+    /**
+     * @brief Number of rows of the given type that fit into a single buffer
+     */
+    static int64_t rowsPerBuffer(DataType type) noexcept {
+        size_t typeSize = static_cast<size_t>(type.getSize());
+        // capacity * size + bitmap (incl. up to 15 bytes rounding) must fit the buffer
+        size_t usable = memory::BufferManager::BUFFER_SIZE - 16;
+        return static_cast<int64_t>((usable * 8) / (typeSize * 8 + 1));
+    }
+
+    /**
+     * @brief Number of rows for which every column of the schema fits into a single buffer
+     */
+    static int64_t rowsPerBuffer(const std::vector<ColumnDescriptor>& schema) noexcept {
+        int64_t rows = static_cast<int64_t>(memory::BufferManager::BUFFER_SIZE) * 8;
+        for (const auto& desc : schema) {
+            rows = std::min(rows, rowsPerBuffer(desc.type));
+        }
+        return rows;
+    }
+
+    /**
+     * @brief Allocate an empty column with room for rowsPerBuffer(type) rows. All rows start out non-null.
+     *        String columns copy long strings into the allocator's string heap.
+     */
+    ColumnBuffer allocateColumn(const ColumnId& columnId, DataType type) {
+        auto handle = bufferManager_->allocate();
+        int64_t capacity = rowsPerBuffer(type);
+        size_t bitmapSize = bitmapBytes(capacity);
+
+        auto* base = static_cast<uint8_t*>(handle.get());
+        tdb_assert(bitmapSize + ColumnBuffer::calculateDataSize(capacity, type) <= handle.size(),
+                   "Column does not fit into buffer");
+
+        NullBitmap bitmap(base, capacity);
+        bitmap.clearAllNull();
+
+        handles_.push_back(std::move(handle));
+        ColumnBuffer column(columnId, type, base + bitmapSize, capacity, bitmap);
+        if (type == DataType::getString()) {
+            column.setStringHeap(stringHeap_.get());
+        }
+        return column;
+    }
+
+    /**
+     * @brief Bind batch to the schema and give it newly allocated, empty columns. The batch's own
+     *        storage is reused, so batches refilled this way don't allocate outside the buffers.
+     */
+    void allocateBatch(const std::shared_ptr<const BatchSchema>& schema, RowVector& batch) {
+        batch.bind(schema);
+        for (int64_t i = 0; i < schema->getColumnCount(); ++i) {
+            const ColumnDescriptor& desc = schema->getColumn(i);
+            batch.setColumn(i, allocateColumn(desc.columnId, desc.type));
+        }
+    }
+
+    /**
+     * @brief Allocate an empty batch bound to the schema
+     */
+    RowVector allocateBatch(const std::shared_ptr<const BatchSchema>& schema) {
+        RowVector batch;
+        allocateBatch(schema, batch);
+        return batch;
+    }
+
+    /**
+     * @brief Allocate an empty batch with one column per descriptor
+     */
+    RowVector allocateBatch(const std::vector<ColumnDescriptor>& schema) {
+        return allocateBatch(BatchSchema::make(schema));
+    }
+
+    /**
+     * @brief Return all buffers to the BufferManager. Invalidates every column allocated so far.
+     */
+    void reset() noexcept {
+        handles_.clear();
+        stringHeap_->reset();
+    }
+
+    size_t getBufferCount() const noexcept {
+        return handles_.size();
+    }
+
+    /**
+     * @brief Bytes held by the buffers and the string heap
+     */
+    size_t getAllocatedBytes() const noexcept {
+        return handles_.size() * memory::BufferManager::BUFFER_SIZE + stringHeap_->getAllocatedBytes();
+    }
+};
+
+/**
+ * @brief Deep copy of all batches an operator produces.
+ *
+ * Batches returned by PhysicalOperator::next are only valid until the next call, so operators
+ * that need their whole input (join build sides) copy it into chunks that they own.
+ * Every chunk holds up to getChunkCapacity() rows.
+ */
+class MaterializedInput {
+private:
+    BatchAllocator allocator_;
+    // Shared by all chunks
+    std::shared_ptr<const BatchSchema> schema_;
+    std::vector<RowVector> chunks_;
+
+    // Global row index of the first row in each chunk
+    std::vector<int64_t> chunkOffsets_;
+    int64_t rowCount_ = 0;
+    int64_t chunkCapacity_ = 0;
+    bool hasSchema_ = false;
+
+    void setSchema(const RowVector& batch) {
+        schema_ = batch.getSchema();
+        chunkCapacity_ = BatchAllocator::rowsPerBuffer(schema_->getColumns());
+        hasSchema_ = true;
+    }
+
+public:
+    explicit MaterializedInput(memory::BufferManager* bufferManager) : allocator_(bufferManager) {}
+
+    /**
+     * @brief Drain the input operator and copy all of its rows
+     * @return Number of batches read
+     */
+    int64_t materialize(PhysicalOperator& input) {
+        int64_t batchCount = 0;
+        materializeUntil(input, [&] {
+            ++batchCount;
+            return false;
+        });
+        return batchCount;
+    }
+
+    /**
+     * @brief Copy the rows of the input until it is exhausted, or full() returns true after a batch
+     * @return Whether the input is exhausted
+     */
+    template<typename Full>
+    bool materializeUntil(PhysicalOperator& input, Full&& full) {
+        RowVector batch;
+        while (true) {
+            int64_t rowCount = input.next(batch);
+
+            // The schema is known even if the input is empty, as long as it sets up its columns
+            if (!hasSchema_ && batch.getColumnCount() > 0) {
+                setSchema(batch);
+            }
+
+            if (rowCount == 0) {
+                return true;
+            }
+
+            append(batch);
+            if (full()) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Copy all selected rows of the batch. The batch must have the same columns as previous ones.
+     */
+    void append(const RowVector& batch) {
+        if (!hasSchema_) {
+            setSchema(batch);
+        }
+        tdb_assert(batch.getColumnCount() == schema_->getColumnCount(),
+                   "Batch column count {} does not match materialized schema {}",
+                   batch.getColumnCount(), schema_->getColumnCount());
+
+        if (batch.hasSelection()) {
+            appendSelected(batch);
+            return;
+        }
+
+        int64_t rowCount = batch.getRowCount();
+        int64_t srcRow = 0;
+
+        while (srcRow < rowCount) {
+            RowVector& chunk = chunkWithSpace();
+            int64_t dstRow = chunk.getRowCount();
+            int64_t n = std::min(rowCount - srcRow, chunkCapacity_ - dstRow);
+
+            for (int64_t colIdx = 0; colIdx < batch.getColumnCount(); ++colIdx) {
+                const ColumnBuffer& src = batch.getColumn(colIdx);
+                ColumnBuffer& dst = chunk.getColumn(colIdx);
+                for (int64_t i = 0; i < n; ++i) {
+                    dst.copyEntry(dstRow + i, src, srcRow + i);
+                }
+            }
+
+            chunk.setRowCount(dstRow + n);
+            srcRow += n;
+            rowCount_ += n;
+        }
+    }
+
+private:
+    RowVector& chunkWithSpace() {
+        if (chunks_.empty() || chunks_.back().getRowCount() == chunkCapacity_) {
+            chunkOffsets_.push_back(rowCount_);
+            chunks_.push_back(allocator_.allocateBatch(schema_));
+        }
+        return chunks_.back();
+    }
+
+    void appendSelected(const RowVector& batch) {
+        batch.forEachSelectedRow([&](int64_t srcRow) { copyRow(batch, srcRow); });
+    }
+
+    void copyRow(const RowVector& batch, int64_t srcRow) {
+        RowVector& chunk = chunkWithSpace();
+        int64_t dstRow = chunk.getRowCount();
+        for (int64_t colIdx = 0; colIdx < batch.getColumnCount(); ++colIdx) {
+            chunk.getColumn(colIdx).copyEntry(dstRow, batch.getColumn(colIdx), srcRow);
+        }
+        chunk.setRowCount(dstRow + 1);
+        ++rowCount_;
+    }
+
+public:
+    /**
+     * @brief Copy a single row of the batch. The batch must have the same columns as previous ones.
+     */
+    void appendRow(const RowVector& batch, int64_t row) {
+        if (!hasSchema_) {
+            setSchema(batch);
+        }
+        tdb_assert(batch.getColumnCount() == schema_->getColumnCount(),
+                   "Batch column count {} does not match materialized schema {}",
+                   batch.getColumnCount(), schema_->getColumnCount());
+        copyRow(batch, row);
+    }
+
+    bool hasSchema() const noexcept {
+        return hasSchema_;
+    }
+
+    const std::vector<ColumnDescriptor>& getSchema() const noexcept {
+        static const std::vector<ColumnDescriptor> empty;
+        return schema_ ? schema_->getColumns() : empty;
+    }
+
+    const std::shared_ptr<const BatchSchema>& getBatchSchema() const noexcept {
+        return schema_;
+    }
+
+    int64_t getRowCount() const noexcept {
+        return rowCount_;
+    }
+
+    int64_t getChunkCapacity() const noexcept {
+        return chunkCapacity_;
+    }
+
+    size_t getChunkCount() const noexcept {
+        return chunks_.size();
+    }
+
+    const RowVector& getChunk(size_t index) const {
+        tdb_assert(index < chunks_.size(), "Chunk index out of range");
+        return chunks_[index];
+    }
+
+    int64_t getChunkOffset(size_t index) const {
+        tdb_assert(index < chunkOffsets_.size(), "Chunk index out of range");
+        return chunkOffsets_[index];
+    }
+
+    /**
+     * @brief Index of a column of the materialized schema, -1 if it does not exist
+     */
+    int64_t getColumnIndex(const ColumnId& columnId) const noexcept {
+        return schema_ ? schema_->getColumnIndex(columnId) : -1;
+    }
+
+    /**
+     * @brief Bytes held by the chunks, including their long strings
+     */
+    size_t getMemoryUsage() const noexcept {
+        return allocator_.getAllocatedBytes();
+    }
+
+    void clear() noexcept {
+        chunks_.clear();
+        chunkOffsets_.clear();
+        allocator_.reset();
+        rowCount_ = 0;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace toydb {
+
+namespace memory {
+
+/**
+ * @brief Process-wide pool of memory buffers for temporary data, e.g. the batches operators
+ * materialize. Buffers may be allocated and released from any thread.
+ *
+ * Buffer sizes are powers of two between MIN_BUFFER_SIZE and MAX_BUFFER_SIZE (size classes).
+ * Buffers are mapped from the OS on demand and released buffers are cached for reuse:
+ * - every thread has a small cache slot, so that threads reusing buffers don't contend,
+ * - buffers overflowing it go to the free list of their NUMA node. Allocations prefer the
+ *   cache and the free list of the node the thread runs on, new buffers are bound to that node.
+ *
+ * The bytes mapped from the OS never exceed the memory budget. Cached buffers are returned to
+ * the OS when they exceed a quarter of the budget, or when an allocation needs their memory.
+ * Once the buffers in use exceed PRESSURE_THRESHOLD of the budget, the pool is under pressure:
+ * operators that can spill should do so.
+ */
+class BufferPool {
+public:
+    static constexpr size_t MIN_BUFFER_SIZE = 64 * 1024;  // 64KB
+    static constexpr size_t SIZE_CLASS_COUNT = 8;
+    static constexpr size_t MAX_BUFFER_SIZE = MIN_BUFFER_SIZE << (SIZE_CLASS_COUNT - 1);  // 8MB
+    static constexpr double PRESSURE_THRESHOLD = 0.85;
+    // Bytes cached per size class in a thread's cache slot, at least one buffer
+    static constexpr size_t THREAD_CACHE_BYTES = 1024 * 1024;
+    static constexpr size_t CACHE_SLOT_COUNT = 64;
+
+    struct Buffer {
+        void* data = nullptr;
+        uint32_t sizeClass = 0;
+        uint32_t node = 0;
+
+        size_t size() const noexcept {
+            return MIN_BUFFER_SIZE << sizeClass;
+        }
+    };
+
+private:
+    struct FreeLists {
+        std::mutex mutex;
+        std::array<std::vector<Buffer>, SIZE_CLASS_COUNT> buffers;
+    };
+
+    std::atomic<size_t> budget_;
+    std::atomic<size_t> reserved_ = 0;  // mapped from the OS, in use or cached
+    std::atomic<size_t> used_ = 0;      // handed out
+
+    std::vector<uint32_t> cpuNodes_;  // NUMA node of every CPU
+    size_t nodeCount_ = 1;
+    std::unique_ptr<FreeLists[]> nodeLists_;
+    std::array<FreeLists, CACHE_SLOT_COUNT> cacheSlots_;
+
+public:
+    /**
+     * @param memoryBudget Maximum number of bytes mapped from the OS
+     */
+    explicit BufferPool(size_t memoryBudget = getDefaultMemoryBudget());
+
+    /**
+     * @brief Unmaps the cached buffers. All buffers must have been released.
+     */
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief The pool shared by all queries of the process
+     */
+    static BufferPool& global();
+
+    /**
+     * @brief TOYDB_MEMORY_BUDGET in bytes if set, half of the physical memory otherwise
+     */
+    static size_t getDefaultMemoryBudget();
+
+    /**
+     * @brief Allocate a buffer of at least minSize bytes
+     * @return nullopt if the buffer does not fit into the memory budget
+     */
+    std::optional<Buffer> tryAllocate(size_t minSize = MIN_BUFFER_SIZE);
+
+    /**
+     * @brief Allocate a buffer of at least minSize bytes
+     * @throws MemoryBudgetExceededError if the buffer does not fit into the memory budget
+     */
+    Buffer allocate(size_t minSize = MIN_BUFFER_SIZE);
+
+    void release(const Buffer& buffer);
+
+    /**
+     * @brief Return all cached buffers to the OS
+     */
+    void trim();
+
+    /**
+     * @brief Change the budget. Buffers in use beyond a lowered budget stay valid.
+     */
+    void setMemoryBudget(size_t bytes);
+
+    size_t getMemoryBudget() const noexcept {
+        return budget_.load(std::memory_order_relaxed);
+    }
+
+    size_t getReservedBytes() const noexcept {
+        return reserved_.load(std::memory_order_relaxed);
+    }
+
+    size_t getUsedBytes() const noexcept {
+        return used_.load(std::memory_order_relaxed);
+    }
+
+    bool isUnderPressure() const noexcept {
+        return static_cast<double>(getUsedBytes()) > PRESSURE_THRESHOLD * static_cast<double>(getMemoryBudget());
+    }
+
+    size_t getNodeCount() const noexcept {
+        return nodeCount_;
+    }
+
+    /**
+     * @brief Size class of the smallest buffer holding size bytes
+     */
+    static uint32_t getSizeClass(size_t size);
+
+private:
+    uint32_t currentNode() const noexcept;
+    FreeLists& currentCacheSlot() noexcept;
+    void detectNodes();
+    bool reserve(size_t bytes) noexcept;
+    std::optional<Buffer> mapBuffer(uint32_t sizeClass, uint32_t node);
+    void unmapBuffer(const Buffer& buffer) noexcept;
+    std::optional<Buffer> popFrom(FreeLists& lists, uint32_t sizeClass);
+    size_t trimLists(FreeLists& lists);
+};
+
+}  // namespace memory
+}  // namespace toydb
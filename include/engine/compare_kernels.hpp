@@ -0,0 +1,443 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/simd_kernels.hpp"
+#include "common/types.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_result.hpp"
+
+namespace toydb::kernels {
+
+/**
+ * @brief Value domain a comparison is evaluated in. Operands are converted to the domain's type.
+ */
+enum class CompareDomain {
+    INTEGRAL,  // INT32, INT64 and BOOL, compared as int64_t
+    DOUBLE,    // any numeric type, compared as double
+    STRING,
+    INVALID,   // operands can't be compared, every row evaluates to NULL
+};
+
+/**
+ * @brief Operand of a comparison, resolved once per batch
+ */
+struct CompareOperand {
+    // Column to read from, nullptr for constants
+    const ColumnBuffer* column = nullptr;
+    DataType type;
+
+    bool isNullConstant = false;
+    int64_t intValue = 0;
+    double doubleValue = 0.0;
+    std::string_view stringValue;
+
+    bool isConstant() const noexcept {
+        return column == nullptr;
+    }
+};
+
+inline bool isIntegralType(DataType type) noexcept {
+    return type == DataType::getInt32() || type == DataType::getInt64() || type == DataType::getBool();
+}
+
+inline CompareDomain getCompareDomain(DataType compareType) noexcept {
+    if (isIntegralType(compareType)) {
+        return CompareDomain::INTEGRAL;
+    }
+    if (compareType == DataType::getDouble()) {
+        return CompareDomain::DOUBLE;
+    }
+    if (compareType == DataType::getString()) {
+        return CompareDomain::STRING;
+    }
+    return CompareDomain::INVALID;
+}
+
+/**
+ * @brief Whether an operand of the given type can be converted into the domain
+ */
+inline bool isConvertible(DataType type, CompareDomain domain) noexcept {
+    switch (domain) {
+        case CompareDomain::INTEGRAL:
+            return isIntegralType(type);
+        case CompareDomain::DOUBLE:
+            return isIntegralType(type) || type == DataType::getDouble();
+        case CompareDomain::STRING:
+            return type == DataType::getString();
+        case CompareDomain::INVALID:
+            return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Operator to use when the operands of a comparison are swapped, e.g. 5 < x => x > 5
+ */
+inline CompareOp mirrorCompareOp(CompareOp op) noexcept {
+    switch (op) {
+        case CompareOp::GREATER: return CompareOp::LESS;
+        case CompareOp::LESS: return CompareOp::GREATER;
+        case CompareOp::GREATER_EQUAL: return CompareOp::LESS_EQUAL;
+        case CompareOp::LESS_EQUAL: return CompareOp::GREATER_EQUAL;
+        default: return op;
+    }
+}
+
+template<CompareOp Op, typename T>
+inline bool compareScalar(const T& left, const T& right) noexcept {
+    if constexpr (Op == CompareOp::EQUAL) {
+        return left == right;
+    } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+        return left != right;
+    } else if constexpr (Op == CompareOp::GREATER) {
+        return left > right;
+    } else if constexpr (Op == CompareOp::LESS) {
+        return left < right;
+    } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+        return left >= right;
+    } else {
+        static_assert(Op == CompareOp::LESS_EQUAL, "Not a comparison operator");
+        return left <= right;
+    }
+}
+
+/**
+ * @brief Calls fn with std::integral_constant<CompareOp, op>, so that op becomes a template argument
+ */
+template<typename Fn>
+inline void dispatchCompareOp(CompareOp op, Fn&& fn) {
+    switch (op) {
+        case CompareOp::EQUAL: fn(std::integral_constant<CompareOp, CompareOp::EQUAL>{}); return;
+        case CompareOp::NOT_EQUAL: fn(std::integral_constant<CompareOp, CompareOp::NOT_EQUAL>{}); return;
+        case CompareOp::GREATER: fn(std::integral_constant<CompareOp, CompareOp::GREATER>{}); return;
+        case CompareOp::LESS: fn(std::integral_constant<CompareOp, CompareOp::LESS>{}); return;
+        case CompareOp::GREATER_EQUAL: fn(std::integral_constant<CompareOp, CompareOp::GREATER_EQUAL>{}); return;
+        case CompareOp::LESS_EQUAL: fn(std::integral_constant<CompareOp, CompareOp::LESS_EQUAL>{}); return;
+        default: tdb_unreachable("Not a comparison operator");
+    }
+}
+
+/**
+ * @brief Returns the constant of an operand converted to T
+ */
+template<typename T>
+inline T constantAs(const CompareOperand& operand) noexcept {
+    if constexpr (std::is_same_v<T, db_string>) {
+        return db_string::fromView(operand.stringValue);
+    } else if constexpr (std::is_same_v<T, double>) {
+        return operand.type == DataType::getDouble() ? operand.doubleValue : static_cast<double>(operand.intValue);
+    } else {
+        return operand.intValue;
+    }
+}
+
+/**
+ * @brief Calls fn with a loader (int64_t row) -> T reading the column's values converted to T
+ */
+template<typename T, typename Fn>
+inline void dispatchColumnLoader(const ColumnBuffer& col, Fn&& fn) {
+    if constexpr (std::is_same_v<T, db_string>) {
+        // Strings are compared in their db_string form, most comparisons are decided by the prefix
+        const db_string* data = col.getDataAs<db_string>().data();
+        fn([data](int64_t row) -> const db_string& { return data[row]; });
+    } else {
+        switch (col.type.getType()) {
+            case DataType::Type::INT32: {
+                const db_int32* data = col.getDataAs<db_int32>().data();
+                fn([data](int64_t row) { return static_cast<T>(data[row]); });
+                return;
+            }
+            case DataType::Type::INT64: {
+                const db_int64* data = col.getDataAs<db_int64>().data();
+                fn([data](int64_t row) { return static_cast<T>(data[row]); });
+                return;
+            }
+            case DataType::Type::BOOL: {
+                const db_bool* data = col.getDataAs<db_bool>().data();
+                fn([data](int64_t row) { return static_cast<T>(data[row]); });
+                return;
+            }
+            case DataType::Type::DOUBLE:
+                if constexpr (std::is_same_v<T, double>) {
+                    const db_double* data = col.getDataAs<db_double>().data();
+                    fn([data](int64_t row) { return data[row]; });
+                    return;
+                }
+                [[fallthrough]];
+            default:
+                tdb_unreachable("Column type not convertible to the comparison domain");
+        }
+    }
+}
+
+/**
+ * @brief Compare rows [0, count) and write one bit per row into out, 64 rows per word.
+ *
+ * The comparison results are first written to a byte array, which the compiler vectorizes
+ * for numeric loaders, and then packed into the word.
+ */
+template<CompareOp Op, typename T, typename LeftFn, typename RightFn>
+inline void compareWords(LeftFn left, RightFn right, int64_t count, uint64_t* out) noexcept {
+    uint8_t matches[64];
+    for (int64_t base = 0; base < count; base += 64) {
+        int64_t n = std::min<int64_t>(64, count - base);
+        for (int64_t i = 0; i < n; ++i) {
+            matches[i] = compareScalar<Op, T>(left(base + i), right(base + i));
+        }
+
+        uint64_t word = 0;
+        for (int64_t i = 0; i < n; ++i) {
+            word |= static_cast<uint64_t>(matches[i]) << i;
+        }
+        out[base / 64] = word;
+    }
+}
+
+/**
+ * @brief Compares up to 64 rows of a column with a constant, starting at a multiple of 64.
+ * @return One bit per row that is not NULL and satisfies the comparison
+ */
+using ConstantWordKernel = uint64_t (*)(const ColumnBuffer& column, const CompareOperand& constant, int64_t base,
+                                        int64_t count);
+
+/**
+ * @brief compareConstantWord with the vectorized kernel the host selected, see simd::KernelTable
+ */
+template<CompareOp Op, typename Stored>
+inline uint64_t compareConstantWordSimd(const ColumnBuffer& column, const CompareOperand& constant, int64_t base,
+                                        int64_t count) noexcept {
+    const Stored* data = column.getDataAs<Stored>().data() + base;
+    const simd::KernelTable& kernels = simd::getKernels();
+    constexpr size_t op = static_cast<size_t>(Op);
+    uint64_t word;
+    if constexpr (std::is_same_v<Stored, db_int32>) {
+        word = kernels.compareInt32[op](data, constantAs<int64_t>(constant), count);
+    } else if constexpr (std::is_same_v<Stored, db_int64>) {
+        word = kernels.compareInt64[op](data, constantAs<int64_t>(constant), count);
+    } else {
+        static_assert(std::is_same_v<Stored, db_double>, "No vectorized kernel for the type");
+        word = kernels.compareDouble[op](data, constantAs<double>(constant), count);
+    }
+    return word & column.getNullBitmap().getValidityWord(base / 64);
+}
+
+/**
+ * @brief Vectorized kernel comparing a column of columnType with a constant in the domain
+ * @return nullptr if there is none for the column type and domain
+ */
+inline ConstantWordKernel selectSimdConstantWordKernel(CompareOp op, CompareDomain domain, DataType columnType) {
+    ConstantWordKernel kernel = nullptr;
+    dispatchCompareOp(op, [&](auto opConstant) {
+        constexpr CompareOp Op = decltype(opConstant)::value;
+        DataType::Type type = columnType.getType();
+        if (domain == CompareDomain::INTEGRAL && type == DataType::Type::INT32) {
+            kernel = compareConstantWordSimd<Op, db_int32>;
+        } else if (domain == CompareDomain::INTEGRAL && type == DataType::Type::INT64) {
+            kernel = compareConstantWordSimd<Op, db_int64>;
+        } else if (domain == CompareDomain::DOUBLE && type == DataType::Type::DOUBLE) {
+            kernel = compareConstantWordSimd<Op, db_double>;
+        }
+    });
+    return kernel;
+}
+
+template<typename T>
+inline void compareBatchInDomain(CompareOp op, const CompareOperand& left, const CompareOperand& right,
+                                 int64_t count, uint64_t* out) {
+    dispatchCompareOp(op, [&](auto opConstant) {
+        constexpr CompareOp Op = decltype(opConstant)::value;
+
+        dispatchColumnLoader<T>(*left.column, [&](auto leftLoader) {
+            if (right.isConstant()) {
+                T constant = constantAs<T>(right);
+                compareWords<Op, T>(leftLoader, [constant](int64_t) { return constant; }, count, out);
+            } else {
+                dispatchColumnLoader<T>(*right.column, [&](auto rightLoader) {
+                    compareWords<Op, T>(leftLoader, rightLoader, count, out);
+                });
+            }
+        });
+    });
+}
+
+template<typename T>
+inline bool compareConstantsInDomain(CompareOp op, const CompareOperand& left, const CompareOperand& right) {
+    bool result = false;
+    dispatchCompareOp(op, [&](auto opConstant) {
+        result = compareScalar<decltype(opConstant)::value, T>(constantAs<T>(left), constantAs<T>(right));
+    });
+    return result;
+}
+
+/**
+ * @brief Evaluate the comparison for rows [0, count) of a batch and store the results.
+ *
+ * The operand types must be convertible to the domain, otherwise every row is NULL. A row is NULL
+ * if either operand is NULL.
+ */
+inline void compareBatch(CompareOp op, CompareDomain domain, const CompareOperand& left,
+                         const CompareOperand& right, int64_t count, PredicateResultVector& result) {
+    if (count == 0) {
+        return;
+    }
+
+    bool valid = isConvertible(left.type, domain) && isConvertible(right.type, domain);
+    if (!valid || left.isNullConstant || right.isNullConstant) {
+        result.setAll(PredicateValue::NULL_VALUE);
+        return;
+    }
+
+    if (left.isConstant() && right.isConstant()) {
+        bool value = false;
+        switch (domain) {
+            case CompareDomain::INTEGRAL: value = compareConstantsInDomain<int64_t>(op, left, right); break;
+            case CompareDomain::DOUBLE: value = compareConstantsInDomain<double>(op, left, right); break;
+            case CompareDomain::STRING: value = compareConstantsInDomain<db_string>(op, left, right); break;
+            case CompareDomain::INVALID: break;
+        }
+        result.setAll(value ? PredicateValue::TRUE : PredicateValue::FALSE);
+        return;
+    }
+
+    // Kernels expect the column on the left
+    if (left.isConstant()) {
+        compareBatch(mirrorCompareOp(op), domain, right, left, count, result);
+        return;
+    }
+
+    // The matches are written into the result, then masked by the validity of the operands
+    tdb_assert(result.size() >= count, "Result has {} rows, {} are compared", result.size(), count);
+    int64_t wordCount = (count + 63) / 64;
+    uint64_t* trueWords = result.getTrueWords();
+
+    ConstantWordKernel simdKernel =
+        right.isConstant() ? selectSimdConstantWordKernel(op, domain, left.column->type) : nullptr;
+    if (simdKernel) {
+        for (int64_t w = 0; w < wordCount; ++w) {
+            trueWords[w] = simdKernel(*left.column, right, w * 64, std::min<int64_t>(64, count - w * 64));
+        }
+    } else {
+        switch (domain) {
+            case CompareDomain::INTEGRAL: compareBatchInDomain<int64_t>(op, left, right, count, trueWords); break;
+            case CompareDomain::DOUBLE: compareBatchInDomain<double>(op, left, right, count, trueWords); break;
+            case CompareDomain::STRING: compareBatchInDomain<db_string>(op, left, right, count, trueWords); break;
+            case CompareDomain::INVALID: tdb_unreachable("Invalid domain");
+        }
+    }
+
+    for (int64_t w = 0; w < wordCount; ++w) {
+        uint64_t validBits = left.column->getNullBitmap().getValidityWord(w);
+        if (!right.isConstant()) {
+            validBits &= right.column->getNullBitmap().getValidityWord(w);
+        }
+        result.setWord(w, trueWords[w], ~validBits);
+    }
+}
+
+template<CompareOp Op, typename T, typename Stored>
+inline uint64_t compareConstantWord(const ColumnBuffer& column, const CompareOperand& constant, int64_t base,
+                                    int64_t count) noexcept {
+    const Stored* data = column.getDataAs<Stored>().data() + base;
+    T value = constantAs<T>(constant);
+    uint8_t matches[64];
+    for (int64_t i = 0; i < count; ++i) {
+        if constexpr (std::is_same_v<T, Stored>) {
+            matches[i] = compareScalar<Op, T>(data[i], value);
+        } else {
+            matches[i] = compareScalar<Op, T>(static_cast<T>(data[i]), value);
+        }
+    }
+
+    uint64_t word = 0;
+    for (int64_t i = 0; i < count; ++i) {
+        word |= static_cast<uint64_t>(matches[i]) << i;
+    }
+    return word & column.getNullBitmap().getValidityWord(base / 64);
+}
+
+/**
+ * @brief Kernel comparing a column of columnType with a constant in the domain
+ * @return nullptr if the column type can't be converted into the domain
+ */
+inline ConstantWordKernel selectConstantWordKernel(CompareOp op, CompareDomain domain, DataType columnType) {
+    ConstantWordKernel kernel = selectSimdConstantWordKernel(op, domain, columnType);
+    if (kernel) {
+        return kernel;
+    }
+    dispatchCompareOp(op, [&](auto opConstant) {
+        constexpr CompareOp Op = decltype(opConstant)::value;
+        DataType::Type type = columnType.getType();
+        switch (domain) {
+            case CompareDomain::INTEGRAL:
+                if (type == DataType::Type::INT32) kernel = compareConstantWord<Op, int64_t, db_int32>;
+                if (type == DataType::Type::INT64) kernel = compareConstantWord<Op, int64_t, db_int64>;
+                if (type == DataType::Type::BOOL) kernel = compareConstantWord<Op, int64_t, db_bool>;
+                break;
+            case CompareDomain::DOUBLE:
+                if (type == DataType::Type::INT32) kernel = compareConstantWord<Op, double, db_int32>;
+                if (type == DataType::Type::INT64) kernel = compareConstantWord<Op, double, db_int64>;
+                if (type == DataType::Type::BOOL) kernel = compareConstantWord<Op, double, db_bool>;
+                if (type == DataType::Type::DOUBLE) kernel = compareConstantWord<Op, double, db_double>;
+                break;
+            case CompareDomain::STRING:
+                if (type == DataType::Type::STRING) kernel = compareConstantWord<Op, db_string, db_string>;
+                break;
+            case CompareDomain::INVALID:
+                break;
+        }
+    });
+    return kernel;
+}
+
+template<typename T>
+inline T loadAs(const CompareOperand& operand, int64_t row) {
+    if (operand.isConstant()) {
+        return constantAs<T>(operand);
+    }
+
+    T value{};
+    dispatchColumnLoader<T>(*operand.column, [&](auto loader) { value = loader(row); });
+    return value;
+}
+
+template<typename T>
+inline bool compareRowInDomain(CompareOp op, const CompareOperand& left, const CompareOperand& right, int64_t row) {
+    T l = loadAs<T>(left, row);
+    T r = loadAs<T>(right, row);
+    bool result = false;
+    dispatchCompareOp(op, [&](auto opConstant) { result = compareScalar<decltype(opConstant)::value, T>(l, r); });
+    return result;
+}
+
+/**
+ * @brief Evaluate the comparison for a single row, with the same semantics as compareBatch
+ */
+inline PredicateValue compareRow(CompareOp op, CompareDomain domain, const CompareOperand& left,
+                                 const CompareOperand& right, int64_t row) {
+    if (!isConvertible(left.type, domain) || !isConvertible(right.type, domain)) {
+        return PredicateValue::NULL_VALUE;
+    }
+    if (left.isNullConstant || right.isNullConstant) {
+        return PredicateValue::NULL_VALUE;
+    }
+    if ((left.column && left.column->isNull(row)) || (right.column && right.column->isNull(row))) {
+        return PredicateValue::NULL_VALUE;
+    }
+
+    bool result = false;
+    switch (domain) {
+        case CompareDomain::INTEGRAL: result = compareRowInDomain<int64_t>(op, left, right, row); break;
+        case CompareDomain::DOUBLE: result = compareRowInDomain<double>(op, left, right, row); break;
+        case CompareDomain::STRING: result = compareRowInDomain<db_string>(op, left, right, row); break;
+        case CompareDomain::INVALID: return PredicateValue::NULL_VALUE;
+    }
+    return result ? PredicateValue::TRUE : PredicateValue::FALSE;
+}
+
+}  // namespace toydb::kernels
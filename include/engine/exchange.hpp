@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/logging.hpp"
+#include "engine/aggregate_hash_table.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/spill.hpp"
+
+namespace toydb {
+
+/**
+ * @brief The payloads the workers of a cluster send for one plan fragment, in the order they arrive
+ */
+class FragmentStream {
+public:
+    virtual ~FragmentStream() = default;
+
+    /**
+     * @brief Wait for the next payload of any worker
+     * @return false once every worker completed the fragment
+     * @throws SQLRuntimeException if a worker failed or could not be reached
+     */
+    virtual bool next(std::string& payload) = 0;
+};
+
+/**
+ * @brief Runs an encoded PlanFragment on every worker of a cluster, each against its local files
+ */
+class FragmentDispatcher {
+public:
+    virtual ~FragmentDispatcher() = default;
+
+    virtual std::unique_ptr<FragmentStream> dispatch(const std::string& fragment) = 0;
+};
+
+/**
+ * @brief Produces the union of the batches the workers of a cluster produce for a fragment.
+ *
+ * The fragment is dispatched by initialize(), so that the workers of all exchanges of a plan
+ * start right away. Every payload holds batches encoded with BatchCodec, which are decoded into
+ * columns of the schema by position.
+ */
+class GatherExec : public PhysicalOperator {
+private:
+    FragmentDispatcher* dispatcher_;
+    std::string fragment_;
+    std::shared_ptr<const BatchSchema> schema_;
+    memory::BufferManager bufferManager_;
+    BatchAllocator allocator_;
+    std::unique_ptr<FragmentStream> stream_;
+    std::string payload_;
+    // Start of the next encoded batch in the payload
+    size_t offset_ = 0;
+
+public:
+    GatherExec(FragmentDispatcher* dispatcher, std::string fragment, std::vector<ColumnDescriptor> schema)
+        : dispatcher_(dispatcher),
+          fragment_(std::move(fragment)),
+          schema_(BatchSchema::make(std::move(schema))),
+          allocator_(&bufferManager_) {}
+
+    void initialize() override {
+        stream_ = dispatcher_->dispatch(fragment_);
+        payload_.clear();
+        offset_ = 0;
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        while (true) {
+            if (offset_ < payload_.size()) {
+                allocator_.reset();
+                const char* start = payload_.data() + offset_;
+                offset_ += static_cast<size_t>(BatchCodec::decode(start, schema_, allocator_, out) - start);
+                if (out.getRowCount() > 0) {
+                    return out.getRowCount();
+                }
+                continue;
+            }
+            if (!stream_->next(payload_)) {
+                out.clear();
+                return 0;
+            }
+            offset_ = 0;
+        }
+    }
+};
+
+/**
+ * @brief Merges the partial aggregates the workers of a cluster compute for a fragment (see
+ * AggregateHashTable::exportPartialStates) and produces the final aggregates like a
+ * HashAggregateExec. The payloads are merged by the first call to next().
+ */
+class GatherAggregateExec : public PhysicalOperator {
+private:
+    FragmentDispatcher* dispatcher_;
+    std::string fragment_;
+    memory::BufferManager bufferManager_;
+    AggregateHashTable table_;
+    std::unique_ptr<FragmentStream> stream_;
+    bool merged_ = false;
+
+public:
+    GatherAggregateExec(FragmentDispatcher* dispatcher, std::string fragment, std::vector<ColumnDescriptor> groupBy,
+                        std::vector<AggregateSpec> aggregates,
+                        size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : dispatcher_(dispatcher),
+          fragment_(std::move(fragment)),
+          table_(std::move(groupBy), std::move(aggregates), &bufferManager_, memoryBudget) {}
+
+    void initialize() override {
+        stream_ = dispatcher_->dispatch(fragment_);
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!merged_) {
+            std::string payload;
+            while (stream_->next(payload)) {
+                table_.mergePartialStates(payload);
+            }
+            stream_.reset();
+            merged_ = true;
+            Logger::debug("GatherAggregateExec: {} groups in memory, spilled {} times", table_.getGroupCount(),
+                          table_.getSpillCount());
+        }
+        return table_.emit(out);
+    }
+
+    const AggregateHashTable& getTable() const noexcept {
+        return table_;
+    }
+};
+
+}  // namespace toydb
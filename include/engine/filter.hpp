@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "common/logging.hpp"
+#include "engine/fused_predicate.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/predicate_result.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Evaluates a predicate over batches and turns the result into their selection.
+ *
+ * Batches are not compacted: the filtered batch keeps its columns and carries the predicate
+ * result as its selection. Sparse results are converted to a selection vector, dense ones keep
+ * the bitmask. Batches where all rows pass keep no selection. Conjunctions of comparisons with
+ * constants are evaluated by a FusedPredicate, other predicates as a tree.
+ */
+class BatchFilter {
+private:
+    std::unique_ptr<PredicateExpr> predicate_;
+
+    // Columns referenced by the predicate, one per column reference, ordered by their index
+    std::vector<ColumnId> predicateColumns_;
+    std::optional<FusedPredicate> fused_;
+
+    // Columns referenced by the predicate, refilled from each batch
+    RowVector input_;
+    // Selection of the last filtered batch and the intermediate results of the predicate,
+    // their storage is reused across batches
+    PredicateResultVector result_;
+    PredicateScratch scratch_;
+    double sparseSelectivity_;
+
+public:
+    explicit BatchFilter(std::unique_ptr<PredicateExpr> predicate,
+                         double sparseSelectivity = PredicateResultVector::SPARSE_SELECTIVITY)
+        : predicate_(std::move(predicate)), sparseSelectivity_(sparseSelectivity) {}
+
+    void initialize() {
+        predicate_->initializeIndexMap();
+
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(predicate_.get(), refs);
+        predicateColumns_.clear();
+        for (const ColumnRefExpr* ref : refs) {
+            tdb_assert(ref->getColumnIndex() == static_cast<int32_t>(predicateColumns_.size()),
+                       "Predicate column index {} out of order", ref->getColumnIndex());
+            predicateColumns_.push_back(ref->getColumnId());
+        }
+        fused_ = FusedPredicate::compile(*predicate_);
+    }
+
+    const PredicateExpr* getPredicate() const noexcept {
+        return predicate_.get();
+    }
+
+    /**
+     * @brief Filter the batch in place. Rows the batch already filtered out stay filtered.
+     *        The selection stays valid until the next call.
+     * @return Number of selected rows
+     */
+    int64_t apply(RowVector& batch) {
+        const RowVector& input = predicateInput(batch);
+        if (fused_) {
+            fused_->evaluateInto(input, result_, batch.getSelection());
+            return select(batch);
+        }
+
+        scratch_.reset();
+        predicate_->evaluateInto(input, result_, scratch_);
+        if (batch.hasSelection()) {
+            PredicateResultVector& inputSelection = scratch_.acquire(batch.getRowCount());
+            for (int64_t w = 0; w < inputSelection.wordCount(); ++w) {
+                inputSelection.setWord(w, batch.getSelection()->getTrueWord(w), 0);
+            }
+            result_.combineAnd(inputSelection);
+        }
+        return select(batch);
+    }
+
+    /**
+     * @brief Whether the predicate is evaluated by a FusedPredicate
+     */
+    bool isFused() const noexcept {
+        return fused_.has_value();
+    }
+
+private:
+    int64_t select(RowVector& batch) {
+        int64_t selected = result_.count();
+        Logger::debug("BatchFilter::apply: {} of {} rows selected", selected, batch.getRowCount());
+
+        if (selected == batch.getRowCount()) {
+            batch.setSelection(nullptr);
+        } else if (selected > 0) {
+            result_.adaptRepresentation(sparseSelectivity_);
+            batch.setSelection(&result_);
+        }
+        return selected;
+    }
+
+    /**
+     * @brief Arrange the columns referenced by the predicate in the order of its index map.
+     *        The columns are shared, not copied.
+     */
+    const RowVector& predicateInput(const RowVector& batch) {
+        for (size_t i = 0; i < predicateColumns_.size(); ++i) {
+            int64_t colIdx = batch.getColumnIndex(predicateColumns_[i]);
+            tdb_assert(colIdx != -1, "Filter column {} is not produced by the input", predicateColumns_[i]);
+            if (static_cast<int64_t>(i) < input_.getColumnCount()) {
+                input_.setColumn(static_cast<int64_t>(i), batch.getColumn(colIdx));
+            } else {
+                input_.addColumn(batch.getColumn(colIdx));
+            }
+        }
+        input_.setRowCount(batch.getRowCount());
+        return input_;
+    }
+};
+
+/**
+ * @brief Filters the batches of its input with a predicate, see BatchFilter. Batches where
+ * no row passes are skipped.
+ */
+class FilterExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    BatchFilter filter_;
+    // Input batch, reused across calls
+    RowVector batch_;
+
+public:
+    FilterExec(PhysicalOperator* input, std::unique_ptr<PredicateExpr> predicate,
+               double sparseSelectivity = PredicateResultVector::SPARSE_SELECTIVITY)
+        : input_(input), filter_(std::move(predicate), sparseSelectivity) {}
+
+    void initialize() override {
+        input_->initialize();
+        filter_.initialize();
+    }
+
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        return input_->pushRuntimeFilter(filter);
+    }
+
+    int64_t next(RowVector& out) override {
+        while (true) {
+            int64_t inputCount = input_->next(batch_);
+            if (inputCount == 0) {
+                out.clear();
+                return 0;
+            }
+
+            int64_t selected = filter_.apply(batch_);
+            if (selected > 0) {
+                out.assignView(batch_);
+                return selected;
+            }
+        }
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/compare_kernels.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/predicate_result.hpp"
+
+namespace toydb {
+
+/**
+ * @brief A conjunction of comparisons between a column and a constant, e.g. a >= 1 AND b < 2.5,
+ * compiled into one kernel per comparison that is specialized on the operator, the comparison
+ * domain and the column's type.
+ *
+ * Batches are evaluated 64 rows at a time: the results of the comparisons are ANDed into one
+ * word, and the remaining comparisons are skipped once no row of the word passes. Neither
+ * intermediate result vectors nor virtual calls are needed. Only TRUE is computed, NULL rows are
+ * reported as FALSE, which is all a filter needs.
+ */
+class FusedPredicate {
+private:
+    struct Comparison {
+        // Index of the column in the predicate's input
+        int32_t column;
+        kernels::ConstantWordKernel kernel;
+        kernels::CompareOperand constant;
+    };
+
+    std::vector<Comparison> comparisons_;
+
+    static bool collect(const PredicateExpr& expr, std::vector<Comparison>& out) {
+        if (auto* logical = dynamic_cast<const LogicalExpr*>(&expr)) {
+            return logical->getOp() == CompareOp::AND && collect(*logical->getLeft(), out) &&
+                   collect(*logical->getRight(), out);
+        }
+        auto* compare = dynamic_cast<const CompareExpr*>(&expr);
+        if (!compare) {
+            return false;
+        }
+
+        CompareOp op = compare->getOp();
+        auto* column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+        auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getRight()));
+        if (!column) {
+            column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+            constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getLeft()));
+            op = kernels::mirrorCompareOp(op);
+        }
+        if (!column || !constant || constant->isNull() || column->getColumnIndex() < 0) {
+            return false;
+        }
+
+        kernels::CompareDomain domain = kernels::getCompareDomain(compare->getType());
+        if (!kernels::isConvertible(constant->getType(), domain)) {
+            return false;
+        }
+        kernels::ConstantWordKernel kernel = kernels::selectConstantWordKernel(op, domain, column->getType());
+        if (!kernel) {
+            return false;
+        }
+        out.push_back({column->getColumnIndex(), kernel, constantOperand(*constant)});
+        return true;
+    }
+
+public:
+    /**
+     * @brief Compile a predicate whose index map is initialized. String constants are referenced,
+     *        the predicate must outlive the compiled form.
+     * @return nullopt if the predicate has another shape
+     */
+    static std::optional<FusedPredicate> compile(const PredicateExpr& predicate) {
+        FusedPredicate fused;
+        if (!collect(predicate, fused.comparisons_)) {
+            return std::nullopt;
+        }
+        return fused;
+    }
+
+    size_t getComparisonCount() const noexcept {
+        return comparisons_.size();
+    }
+
+    /**
+     * @brief Set out to the rows of the input for which the predicate is TRUE, only among the rows
+     *        of selection if it is set
+     */
+    void evaluateInto(const RowVector& input, PredicateResultVector& out,
+                      const PredicateResultVector* selection = nullptr) const {
+        int64_t rowCount = input.getRowCount();
+        out.reset(rowCount);
+        for (int64_t w = 0; w < out.wordCount(); ++w) {
+            int64_t base = w * 64;
+            int64_t count = std::min<int64_t>(64, rowCount - base);
+            uint64_t word = selection ? selection->getTrueWord(w) : ~uint64_t{0};
+            for (const Comparison& comparison : comparisons_) {
+                if (word == 0) {
+                    break;
+                }
+                word &= comparison.kernel(input.getColumn(comparison.column), comparison.constant, base, count);
+            }
+            out.setWord(w, word, 0);
+        }
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "common/logging.hpp"
+#include "engine/aggregate_hash_table.hpp"
+#include "engine/memory.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/pipeline_executor.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Groups its input by the group columns and computes the aggregates of every group.
+ *
+ * The input is consumed entirely by the first call to next(). The output has the group columns,
+ * followed by one column per aggregate, in no particular order. Without group columns, exactly
+ * one row is produced, even if the input is empty.
+ */
+class HashAggregateExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    memory::BufferManager bufferManager_;
+    AggregateHashTable table_;
+    bool consumed_ = false;
+
+public:
+    HashAggregateExec(PhysicalOperator* input, std::vector<ColumnDescriptor> groupBy, std::vector<AggregateSpec> aggregates,
+                      size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : input_(input), table_(std::move(groupBy), std::move(aggregates), &bufferManager_, memoryBudget) {}
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!consumed_) {
+            RowVector batch;
+            while (true) {
+                if (input_->next(batch) == 0) {
+                    break;
+                }
+                table_.consume(batch);
+            }
+            consumed_ = true;
+            Logger::debug("HashAggregateExec: {} groups in memory, spilled {} times",
+                          table_.getGroupCount(), table_.getSpillCount());
+        }
+        return table_.emit(out);
+    }
+
+    const AggregateHashTable& getTable() const noexcept {
+        return table_;
+    }
+};
+
+/**
+ * @brief Aggregation as the sink of a parallel pipeline. Every worker aggregates into a table
+ * of its own, the partial aggregates are merged into a single table once all workers are done.
+ * Each table spills on its own once it exceeds the memory budget.
+ */
+class HashAggregateSink : public PipelineSink {
+private:
+    struct State : LocalState {
+        std::unique_ptr<AggregateHashTable> table;
+    };
+
+    std::vector<ColumnDescriptor> groupBy_;
+    std::vector<AggregateSpec> aggregates_;
+    size_t memoryBudget_;
+    memory::BufferManager bufferManager_;
+    std::unique_ptr<AggregateHashTable> result_;
+
+public:
+    HashAggregateSink(std::vector<ColumnDescriptor> groupBy, std::vector<AggregateSpec> aggregates,
+                      size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : groupBy_(std::move(groupBy)), aggregates_(std::move(aggregates)), memoryBudget_(memoryBudget) {}
+
+    std::unique_ptr<LocalState> createLocalState() override {
+        auto state = std::make_unique<State>();
+        state->table = std::make_unique<AggregateHashTable>(groupBy_, aggregates_, &bufferManager_, memoryBudget_);
+        return state;
+    }
+
+    void consume(LocalState& state, const RowVector& batch) override {
+        static_cast<State&>(state).table->consume(batch);
+    }
+
+    void combine(std::vector<std::unique_ptr<LocalState>>& states) override {
+        for (auto& localState : states) {
+            std::unique_ptr<AggregateHashTable>& table = static_cast<State&>(*localState).table;
+            if (!result_) {
+                result_ = std::move(table);
+            } else {
+                result_->merge(*table);
+            }
+        }
+    }
+
+    /**
+     * @brief The merged aggregates, emit() produces the result rows. Only valid after the pipeline ran.
+     */
+    AggregateHashTable& getResult() {
+        tdb_assert(result_ != nullptr, "The aggregation pipeline has not run");
+        return *result_;
+    }
+};
+
+/**
+ * @brief Groups its input like a HashAggregateExec, on the workers of a PipelineExecutor.
+ *
+ * The first call to next() runs a pipeline from the input, read through an OperatorMorselSource,
+ * into a HashAggregateSink, so that every worker aggregates the morsels it pulls into a table of
+ * its own. The output is that of the merged table. Instead of an input, the pipeline can read a
+ * source of its own, e.g. a ParallelScan, through streaming operators every worker builds itself,
+ * so that the operators below the aggregation run on the workers as well.
+ */
+class ParallelHashAggregateExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_ = nullptr;
+    // Set if the pipeline reads a source of its own instead of the input
+    MorselSourceFactory source_;
+    PipelineFactory factory_;
+    size_t workerCount_;
+    memory::BufferManager bufferManager_;
+    HashAggregateSink sink_;
+    bool consumed_ = false;
+
+public:
+    ParallelHashAggregateExec(PhysicalOperator* input, std::vector<ColumnDescriptor> groupBy,
+                              std::vector<AggregateSpec> aggregates, size_t workerCount,
+                              size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : input_(input), workerCount_(workerCount), sink_(std::move(groupBy), std::move(aggregates), memoryBudget) {}
+
+    /**
+     * @param source Creates the source of the pipeline, e.g. a scan of a table, when it runs
+     * @param factory Builds the streaming operators every worker applies to its morsels, e.g. filters
+     */
+    ParallelHashAggregateExec(MorselSourceFactory source, PipelineFactory factory,
+                              std::vector<ColumnDescriptor> groupBy, std::vector<AggregateSpec> aggregates,
+                              size_t workerCount, size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : source_(std::move(source)),
+          factory_(std::move(factory)),
+          workerCount_(workerCount),
+          sink_(std::move(groupBy), std::move(aggregates), memoryBudget) {}
+
+    /**
+     * @brief The input is initialized by the source of the pipeline
+     */
+    void initialize() override {}
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!consumed_) {
+            std::unique_ptr<MorselSource> source =
+                source_ ? source_() : std::make_unique<OperatorMorselSource>(input_, &bufferManager_);
+            Pipeline pipeline {source.get(), factory_, &sink_, {}};
+            PipelineExecutor(workerCount_).run(pipeline);
+            consumed_ = true;
+            Logger::debug("ParallelHashAggregateExec: {} groups merged from {} workers, spilled {} times",
+                          sink_.getResult().getGroupCount(), workerCount_, sink_.getResult().getSpillCount());
+        }
+        return sink_.getResult().emit(out);
+    }
+
+    size_t getWorkerCount() const noexcept {
+        return workerCount_;
+    }
+
+    /**
+     * @brief Whether the workers read the source themselves instead of an input operator
+     */
+    bool hasSource() const noexcept {
+        return static_cast<bool>(source_);
+    }
+};
+
+}  // namespace toydb
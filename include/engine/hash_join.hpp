@@ -0,0 +1,441 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/hash.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/join_key.hpp"
+#include "engine/join_output.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "planner/logical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Implements an equi-join by building a hash table on the key column of the build input
+ *        and probing it with one batch of the probe input at a time.
+ *
+ * The output rows contain the build columns followed by the probe columns. LEFT joins preserve
+ * the build rows, RIGHT joins the probe rows and FULL_OUTER joins both. Preserved rows without
+ * a join partner have all columns of the other side set to NULL. NULL keys never match.
+ * Unselected rows of filtered input batches are skipped.
+ *
+ * Once the hash table is built, a runtime filter of the build keys is pushed into the probe input
+ * (see publishRuntimeFilter), so that probe rows without a partner are dropped by the scan. The
+ * distinct keys of small integral build sides are published with it, so that a scan with a
+ * secondary index on the probe key only reads the rows of those keys.
+ */
+class HashJoinExec : public PhysicalOperator {
+private:
+    enum class Phase {
+        OPEN,
+        PROBE,
+        EMIT_UNMATCHED_BUILD,
+        DONE,
+    };
+
+    struct HashEntry {
+        uint64_t hash;
+        uint32_t chunk;
+        uint32_t row;
+        int64_t next;  // next entry in the bucket chain, CHAIN_END if last
+    };
+
+    static constexpr int64_t CHAIN_END = -1;
+    static constexpr int64_t NEW_PROBE_ROW = -2;
+
+    PhysicalOperator* build_;
+    PhysicalOperator* probe_;
+    std::unique_ptr<ColumnRefExpr> buildKey_;
+    std::unique_ptr<ColumnRefExpr> probeKey_;
+    JoinType joinType_;
+    JoinKeyDomain keyDomain_;
+
+    memory::BufferManager bufferManager_;
+    MaterializedInput buildInput_;
+    JoinOutputBuilder output_;
+    Phase phase_ = Phase::OPEN;
+
+    // Hash table over the materialized build input
+    std::vector<HashEntry> entries_;
+    std::vector<int64_t> buckets_;
+    uint64_t bucketMask_ = 0;
+    int64_t buildKeyIndex_ = -1;
+
+    // Per build row (indexed by chunk offset + row), only tracked if build rows are preserved
+    std::vector<bool> buildMatched_;
+
+    // Probe state, kept across calls to next()
+    RowVector probeBatch_;
+    std::vector<ColumnDescriptor> probeSchema_;
+    int64_t probeKeyIndex_ = -1;
+    int64_t probeRow_ = 0;
+    uint64_t probeHash_ = 0;
+    int64_t chainPos_ = NEW_PROBE_ROW;
+    bool probeRowMatched_ = false;
+
+    // Emission state of unmatched build rows
+    size_t unmatchedChunk_ = 0;
+    int64_t unmatchedRow_ = 0;
+
+public:
+    // Most build rows whose distinct keys are published with the runtime filter, so that the probe
+    // scan can look them up in a secondary index. Larger key sets only publish their range.
+    static constexpr size_t RUNTIME_FILTER_MAX_KEYS = 4096;
+
+    HashJoinExec(PhysicalOperator* build, PhysicalOperator* probe,
+                 std::unique_ptr<ColumnRefExpr> buildKey, std::unique_ptr<ColumnRefExpr> probeKey,
+                 JoinType joinType = JoinType::INNER)
+        : build_(build),
+          probe_(probe),
+          buildKey_(std::move(buildKey)),
+          probeKey_(std::move(probeKey)),
+          joinType_(joinType),
+          keyDomain_(resolveJoinKeyDomain(buildKey_->getType(), probeKey_->getType())),
+          buildInput_(&bufferManager_),
+          output_(&bufferManager_) {
+        if (joinType_ == JoinType::CROSS) {
+            throw InternalSQLError("HashJoinExec requires an equi-join condition, got a cross join");
+        }
+    }
+
+    void initialize() override {
+        build_->initialize();
+        probe_->initialize();
+    }
+
+    int64_t next(RowVector& out) override {
+        Logger::debug("HashJoinExec::next");
+
+        if (phase_ == Phase::OPEN) {
+            buildHashTable();
+            publishRuntimeFilter();
+            startProbe();
+        }
+
+        output_.begin();
+        while (!output_.isFull()) {
+            if (phase_ == Phase::PROBE) {
+                if (probeRow_ >= probeBatch_.getRowCount() && !fetchProbeBatch()) {
+                    phase_ = preservesBuild() ? Phase::EMIT_UNMATCHED_BUILD : Phase::DONE;
+                    continue;
+                }
+                probeCurrentRow();
+            } else if (phase_ == Phase::EMIT_UNMATCHED_BUILD) {
+                emitUnmatchedBuildRows();
+            } else {
+                break;
+            }
+        }
+
+        return output_.finish(out);
+    }
+
+    /**
+     * @brief Forward the filter to the inputs producing its columns, as long as dropping their
+     *        rows early drops no output row: the input must not be preserved, and the build input
+     *        must not have been consumed yet.
+     */
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        if (!preservesProbe() && probe_->pushRuntimeFilter(filter)) {
+            return true;
+        }
+        return !preservesBuild() && phase_ == Phase::OPEN && build_->pushRuntimeFilter(filter);
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+private:
+    bool preservesBuild() const noexcept {
+        return joinType_ == JoinType::LEFT || joinType_ == JoinType::FULL_OUTER;
+    }
+
+    bool preservesProbe() const noexcept {
+        return joinType_ == JoinType::RIGHT || joinType_ == JoinType::FULL_OUTER;
+    }
+
+    uint64_t hashKey(const ColumnBuffer& col, int64_t row) const {
+        return hashJoinKey(keyDomain_, col, row);
+    }
+
+    bool keysEqual(const ColumnBuffer& left, int64_t leftRow, const ColumnBuffer& right, int64_t rightRow) const {
+        return joinKeysEqual(keyDomain_, left, leftRow, right, rightRow);
+    }
+
+    static int64_t findKeyColumn(const std::vector<ColumnDescriptor>& schema, const ColumnRefExpr& key) {
+        return findJoinKeyColumn(schema, key.getColumnId(), key.getType());
+    }
+
+    /**
+     * @brief Materialize the build input and insert every row with a non-null key into the hash table
+     */
+    void buildHashTable() {
+        buildInput_.materialize(*build_);
+        Logger::debug("HashJoinExec::buildHashTable: materialized {} build rows in {} chunks",
+                      buildInput_.getRowCount(), buildInput_.getChunkCount());
+
+        if (buildInput_.hasSchema()) {
+            buildKeyIndex_ = findKeyColumn(buildInput_.getSchema(), *buildKey_);
+        }
+
+        // Power of two bucket count with a load factor of at most 0.5
+        size_t bucketCount = 16;
+        while (bucketCount < static_cast<size_t>(buildInput_.getRowCount()) * 2) {
+            bucketCount <<= 1;
+        }
+        buckets_.assign(bucketCount, CHAIN_END);
+        bucketMask_ = bucketCount - 1;
+        entries_.reserve(static_cast<size_t>(buildInput_.getRowCount()));
+
+        std::vector<uint64_t> hashes;
+        for (size_t chunkIdx = 0; chunkIdx < buildInput_.getChunkCount(); ++chunkIdx) {
+            const RowVector& chunk = buildInput_.getChunk(chunkIdx);
+            const ColumnBuffer& key = chunk.getColumn(buildKeyIndex_);
+            hashes.resize(static_cast<size_t>(chunk.getRowCount()));
+            hashJoinKeys(keyDomain_, key, 0, chunk.getRowCount(), hashes.data());
+
+            for (int64_t row = 0; row < chunk.getRowCount(); ++row) {
+                if (key.isNull(row)) {
+                    continue;
+                }
+
+                uint64_t hash = hashes[static_cast<size_t>(row)];
+                int64_t& bucket = buckets_[hash & bucketMask_];
+                entries_.push_back({hash, static_cast<uint32_t>(chunkIdx), static_cast<uint32_t>(row), bucket});
+                bucket = static_cast<int64_t>(entries_.size()) - 1;
+            }
+        }
+
+        if (preservesBuild()) {
+            buildMatched_.assign(static_cast<size_t>(buildInput_.getRowCount()), false);
+        }
+    }
+
+    /**
+     * @brief Push a filter of the build keys down into the probe input: their range and a Bloom
+     *        filter of their hashes, with the keys themselves if there are few (see buildKeySet).
+     *        Probe rows failing it have no join partner, so they can be dropped before they are
+     *        materialized, unless probe rows are preserved.
+     */
+    void publishRuntimeFilter() {
+        if (preservesProbe() || entries_.empty()) {
+            return;
+        }
+
+        auto bloom = std::make_shared<BlockedBloomFilter>(static_cast<int64_t>(entries_.size()));
+        for (const HashEntry& entry : entries_) {
+            bloom->insert(entry.hash);
+        }
+
+        auto probeKey = [this] {
+            return std::make_unique<ColumnRefExpr>(probeKey_->getColumnId(), probeKey_->getType());
+        };
+        std::unique_ptr<PredicateExpr> filter =
+            std::make_unique<BloomFilterExpr>(probeKey(), keyDomain_, std::move(bloom), buildKeySet());
+
+        auto [min, max] = buildKeyRange();
+        if (min && max) {
+            DataType compareType = keyDomain_ == JoinKeyDomain::INTEGRAL ? DataType::getInt64()
+                                 : keyDomain_ == JoinKeyDomain::DOUBLE   ? DataType::getDouble()
+                                                                         : DataType::getString();
+            auto range = std::make_unique<LogicalExpr>(
+                CompareOp::AND,
+                std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, compareType, probeKey(), std::move(min)),
+                std::make_unique<CompareExpr>(CompareOp::LESS_EQUAL, compareType, probeKey(), std::move(max)));
+            // The range comes first, so that it is used to skip files and row groups
+            filter = std::make_unique<LogicalExpr>(CompareOp::AND, std::move(range), std::move(filter));
+        }
+
+        bool pushed = probe_->pushRuntimeFilter(*filter);
+        Logger::debug("HashJoinExec::publishRuntimeFilter: filter of {} build keys {}", entries_.size(),
+                      pushed ? "pushed into the probe input" : "not accepted by the probe input");
+    }
+
+    /**
+     * @brief Distinct integral build keys ascending, null for other key domains or more than
+     *        RUNTIME_FILTER_MAX_KEYS build rows
+     */
+    std::shared_ptr<const std::vector<int64_t>> buildKeySet() const {
+        if (keyDomain_ != JoinKeyDomain::INTEGRAL || probeKey_->getType() == DataType::getBool() ||
+            entries_.size() > RUNTIME_FILTER_MAX_KEYS) {
+            return nullptr;
+        }
+        auto keys = std::make_shared<std::vector<int64_t>>();
+        keys->reserve(entries_.size());
+        for (const HashEntry& entry : entries_) {
+            keys->push_back(readIntegralKey(buildInput_.getChunk(entry.chunk).getColumn(buildKeyIndex_), entry.row));
+        }
+        std::sort(keys->begin(), keys->end());
+        keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+        return keys;
+    }
+
+    /**
+     * @brief Smallest and largest of the non-null build keys, read with read(column, row)
+     */
+    template<typename T, typename ReadFn>
+    std::pair<T, T> keyRange(ReadFn&& read) const {
+        const HashEntry& first = entries_.front();
+        T min = read(buildInput_.getChunk(first.chunk).getColumn(buildKeyIndex_), first.row);
+        T max = min;
+        for (const HashEntry& entry : entries_) {
+            T value = read(buildInput_.getChunk(entry.chunk).getColumn(buildKeyIndex_), entry.row);
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        return {min, max};
+    }
+
+    /**
+     * @brief Smallest and largest build key as constants of the key domain. None for BOOL probe
+     *        keys, whose comparisons take BOOL constants.
+     */
+    std::pair<std::unique_ptr<ConstantExpr>, std::unique_ptr<ConstantExpr>> buildKeyRange() const {
+        if (probeKey_->getType() == DataType::getBool()) {
+            return {};
+        }
+
+        switch (keyDomain_) {
+            case JoinKeyDomain::INTEGRAL: {
+                auto [min, max] = keyRange<int64_t>(readIntegralKey);
+                return {std::make_unique<ConstantExpr>(DataType::getInt64(), min),
+                        std::make_unique<ConstantExpr>(DataType::getInt64(), max)};
+            }
+            case JoinKeyDomain::DOUBLE: {
+                auto [min, max] = keyRange<double>(readDoubleKey);
+                return {std::make_unique<ConstantExpr>(DataType::getDouble(), min),
+                        std::make_unique<ConstantExpr>(DataType::getDouble(), max)};
+            }
+            case JoinKeyDomain::STRING: {
+                auto [min, max] = keyRange<std::string_view>(
+                    [](const ColumnBuffer& col, int64_t row) { return col.getEntry<db_string>(row).view(); });
+                return {std::make_unique<ConstantExpr>(DataType::getString(), std::string(min)),
+                        std::make_unique<ConstantExpr>(DataType::getString(), std::string(max))};
+            }
+        }
+        tdb_unreachable("Unknown key domain");
+    }
+
+    /**
+     * @brief Fetch the first probe batch, which determines the output schema
+     */
+    void startProbe() {
+        if (buildInput_.getRowCount() == 0 && !preservesProbe()) {
+            // No row can be produced, skip the probe input entirely
+            output_.setSchema(buildInput_.getSchema(), {});
+            phase_ = Phase::DONE;
+            return;
+        }
+
+        fetchProbeBatch();
+        output_.setSchema(buildInput_.getSchema(), probeSchema_);
+        phase_ = Phase::PROBE;
+    }
+
+    bool fetchProbeBatch() {
+        probeRow_ = 0;
+        chainPos_ = NEW_PROBE_ROW;
+
+        int64_t rowCount = probe_->next(probeBatch_);
+        if (probeSchema_.empty() && probeBatch_.getColumnCount() > 0) {
+            probeSchema_ = getColumnDescriptors(probeBatch_);
+            probeKeyIndex_ = findKeyColumn(probeSchema_, *probeKey_);
+        }
+
+        if (rowCount == 0) {
+            probeBatch_.clear();
+            return false;
+        }
+
+        probeRow_ = probeBatch_.nextSelectedRow(0);
+        return true;
+    }
+
+    /**
+     * @brief Emit the matches of the current probe row until the output batch is full. Advances
+     *        to the next probe row once the bucket chain is exhausted.
+     */
+    void probeCurrentRow() {
+        const ColumnBuffer& key = probeBatch_.getColumn(probeKeyIndex_);
+
+        if (chainPos_ == NEW_PROBE_ROW) {
+            probeRowMatched_ = false;
+            if (key.isNull(probeRow_)) {
+                chainPos_ = CHAIN_END;
+            } else {
+                probeHash_ = hashKey(key, probeRow_);
+                chainPos_ = buckets_[probeHash_ & bucketMask_];
+            }
+        }
+
+        while (chainPos_ != CHAIN_END && !output_.isFull()) {
+            const HashEntry& entry = entries_[static_cast<size_t>(chainPos_)];
+            chainPos_ = entry.next;
+
+            if (entry.hash != probeHash_) {
+                continue;
+            }
+
+            const RowVector& chunk = buildInput_.getChunk(entry.chunk);
+            if (!keysEqual(chunk.getColumn(buildKeyIndex_), entry.row, key, probeRow_)) {
+                continue;
+            }
+
+            probeRowMatched_ = true;
+            if (preservesBuild()) {
+                buildMatched_[static_cast<size_t>(buildInput_.getChunkOffset(entry.chunk) + entry.row)] = true;
+            }
+            output_.append(&chunk, entry.row, &probeBatch_, probeRow_);
+        }
+
+        if (chainPos_ != CHAIN_END) {
+            return;
+        }
+
+        if (preservesProbe() && !probeRowMatched_) {
+            if (output_.isFull()) {
+                return;
+            }
+            output_.append(nullptr, 0, &probeBatch_, probeRow_);
+        }
+
+        probeRow_ = probeBatch_.nextSelectedRow(probeRow_ + 1);
+        chainPos_ = NEW_PROBE_ROW;
+    }
+
+    void emitUnmatchedBuildRows() {
+        while (unmatchedChunk_ < buildInput_.getChunkCount()) {
+            const RowVector& chunk = buildInput_.getChunk(unmatchedChunk_);
+            int64_t offset = buildInput_.getChunkOffset(unmatchedChunk_);
+
+            for (; unmatchedRow_ < chunk.getRowCount(); ++unmatchedRow_) {
+                if (buildMatched_[static_cast<size_t>(offset + unmatchedRow_)]) {
+                    continue;
+                }
+                if (output_.isFull()) {
+                    return;
+                }
+                output_.append(&chunk, unmatchedRow_, nullptr, 0);
+            }
+
+            ++unmatchedChunk_;
+            unmatchedRow_ = 0;
+        }
+
+        phase_ = Phase::DONE;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "common/hash.hpp"
+#include "common/simd_kernels.hpp"
+#include "common/types.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Domain in which the keys of an equi-join are hashed and compared, so that e.g. INT32
+ *        and INT64 keys can be joined
+ */
+enum class JoinKeyDomain {
+    INTEGRAL,
+    DOUBLE,
+    STRING,
+};
+
+inline bool isIntegralJoinKey(DataType type) noexcept {
+    return type == DataType::getInt32() || type == DataType::getInt64() || type == DataType::getBool();
+}
+
+inline JoinKeyDomain resolveJoinKeyDomain(DataType buildType, DataType probeType) {
+    if (isIntegralJoinKey(buildType) && isIntegralJoinKey(probeType)) {
+        return JoinKeyDomain::INTEGRAL;
+    }
+
+    bool buildNumeric = isIntegralJoinKey(buildType) || buildType == DataType::getDouble();
+    bool probeNumeric = isIntegralJoinKey(probeType) || probeType == DataType::getDouble();
+    if (buildNumeric && probeNumeric) {
+        return JoinKeyDomain::DOUBLE;
+    }
+
+    if (buildType == DataType::getString() && probeType == DataType::getString()) {
+        return JoinKeyDomain::STRING;
+    }
+
+    throw InternalSQLError("Incompatible hash join key types " + buildType.toString() + " and " +
+                           probeType.toString());
+}
+
+inline int64_t readIntegralKey(const ColumnBuffer& col, int64_t row) {
+    switch (col.type.getType()) {
+        case DataType::Type::INT32:
+            return col.getEntry<db_int32>(row);
+        case DataType::Type::INT64:
+            return col.getEntry<db_int64>(row);
+        case DataType::Type::BOOL:
+            return col.getEntry<db_bool>(row) ? 1 : 0;
+        default:
+            tdb_unreachable("Not an integral key type");
+    }
+}
+
+inline double readDoubleKey(const ColumnBuffer& col, int64_t row) {
+    if (col.type == DataType::getDouble()) {
+        return col.getEntry<db_double>(row);
+    }
+    return static_cast<double>(readIntegralKey(col, row));
+}
+
+/**
+ * @brief Hash of a non-null key. Keys that compare equal in the domain hash equal.
+ */
+inline uint64_t hashJoinKey(JoinKeyDomain domain, const ColumnBuffer& col, int64_t row) {
+    switch (domain) {
+        case JoinKeyDomain::INTEGRAL:
+            return hashInt64(readIntegralKey(col, row));
+        case JoinKeyDomain::DOUBLE:
+            return hashDouble(readDoubleKey(col, row));
+        case JoinKeyDomain::STRING: {
+            std::string_view value = col.getEntry<db_string>(row).view();
+            return hashBytes(value.data(), value.size());
+        }
+    }
+    tdb_unreachable("Unknown key domain");
+}
+
+/**
+ * @brief hashJoinKey of rows [begin, begin + count) into out, NULL rows get an arbitrary hash.
+ *        INT64 keys are hashed by the vectorized kernels.
+ */
+inline void hashJoinKeys(JoinKeyDomain domain, const ColumnBuffer& col, int64_t begin, int64_t count, uint64_t* out) {
+    if (domain == JoinKeyDomain::INTEGRAL && col.type == DataType::getInt64()) {
+        simd::getKernels().hashInt64(col.getDataAs<db_int64>().data() + begin, count, out);
+        return;
+    }
+    for (int64_t i = 0; i < count; ++i) {
+        out[i] = hashJoinKey(domain, col, begin + i);
+    }
+}
+
+/**
+ * @brief Whether two non-null keys are equal in the domain
+ */
+inline bool joinKeysEqual(JoinKeyDomain domain, const ColumnBuffer& left, int64_t leftRow, const ColumnBuffer& right,
+                          int64_t rightRow) {
+    switch (domain) {
+        case JoinKeyDomain::INTEGRAL:
+            return readIntegralKey(left, leftRow) == readIntegralKey(right, rightRow);
+        case JoinKeyDomain::DOUBLE:
+            return readDoubleKey(left, leftRow) == readDoubleKey(right, rightRow);
+        case JoinKeyDomain::STRING:
+            return left.getEntry<db_string>(leftRow) == right.getEntry<db_string>(rightRow);
+    }
+    tdb_unreachable("Unknown key domain");
+}
+
+/**
+ * @brief Order of two non-null keys in the domain
+ * @return Negative if left sorts before right, 0 if they are equal, positive otherwise
+ */
+inline int compareJoinKeys(JoinKeyDomain domain, const ColumnBuffer& left, int64_t leftRow, const ColumnBuffer& right,
+                           int64_t rightRow) {
+    switch (domain) {
+        case JoinKeyDomain::INTEGRAL: {
+            int64_t a = readIntegralKey(left, leftRow);
+            int64_t b = readIntegralKey(right, rightRow);
+            return (a > b) - (a < b);
+        }
+        case JoinKeyDomain::DOUBLE: {
+            double a = readDoubleKey(left, leftRow);
+            double b = readDoubleKey(right, rightRow);
+            return (a > b) - (a < b);
+        }
+        case JoinKeyDomain::STRING: {
+            int order = left.getEntry<db_string>(leftRow).view().compare(right.getEntry<db_string>(rightRow).view());
+            return (order > 0) - (order < 0);
+        }
+    }
+    tdb_unreachable("Unknown key domain");
+}
+
+/**
+ * @brief Index of the key column in the schema of a join input
+ */
+inline int64_t findJoinKeyColumn(const std::vector<ColumnDescriptor>& schema, const ColumnId& key, DataType type) {
+    for (size_t i = 0; i < schema.size(); ++i) {
+        if (schema[i].columnId == key) {
+            tdb_assert(schema[i].type == type, "Join key type does not match the input column");
+            return static_cast<int64_t>(i);
+        }
+    }
+    throw InternalSQLError("Join key column " + key.getName() + " is not produced by the join input");
+}
+
+}  // namespace toydb
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "common/assert.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Assembles the output batches of a join operator.
+ *
+ * An output row consists of the build columns followed by the probe columns. Either side may be
+ * missing (outer joins), in which case its columns are NULL. The batch handed out by finish()
+ * stays valid until the next call to begin().
+ */
+class JoinOutputBuilder {
+private:
+    BatchAllocator allocator_;
+    std::vector<ColumnDescriptor> buildSchema_;
+    std::vector<ColumnDescriptor> probeSchema_;
+    // Build columns followed by the probe columns, shared by all output batches
+    std::shared_ptr<const BatchSchema> schema_;
+    RowVector batch_;
+    int64_t capacity_ = 0;
+    int64_t rowCount_ = 0;
+
+public:
+    explicit JoinOutputBuilder(memory::BufferManager* bufferManager) : allocator_(bufferManager) {}
+
+    void setSchema(std::vector<ColumnDescriptor> buildSchema, std::vector<ColumnDescriptor> probeSchema) {
+        buildSchema_ = std::move(buildSchema);
+        probeSchema_ = std::move(probeSchema);
+
+        std::vector<ColumnDescriptor> schema = buildSchema_;
+        schema.insert(schema.end(), probeSchema_.begin(), probeSchema_.end());
+
+        capacity_ = BatchAllocator::rowsPerBuffer(schema);
+        schema_ = BatchSchema::make(std::move(schema));
+    }
+
+    /**
+     * @brief Start a new output batch. Invalidates the previously finished batch.
+     */
+    void begin() {
+        allocator_.reset();
+        allocator_.allocateBatch(schema_, batch_);
+        rowCount_ = 0;
+    }
+
+    bool isFull() const noexcept {
+        return rowCount_ >= capacity_;
+    }
+
+    int64_t getRowCount() const noexcept {
+        return rowCount_;
+    }
+
+    int64_t getCapacity() const noexcept {
+        return capacity_;
+    }
+
+    /**
+     * @brief Append an output row
+     * @param build Batch holding the build row, nullptr to emit NULLs for the build columns
+     * @param probe Batch holding the probe row, nullptr to emit NULLs for the probe columns
+     */
+    void append(const RowVector* build, int64_t buildRow, const RowVector* probe, int64_t probeRow) {
+        tdb_assert(!isFull(), "Join output batch is full");
+
+        int64_t outIdx = 0;
+        for (size_t i = 0; i < buildSchema_.size(); ++i, ++outIdx) {
+            ColumnBuffer& dst = batch_.getColumn(outIdx);
+            if (build) {
+                dst.copyEntry(rowCount_, build->getColumn(static_cast<int64_t>(i)), buildRow);
+            } else {
+                dst.setNull(rowCount_);
+                dst.count = rowCount_ + 1;
+            }
+        }
+
+        for (size_t i = 0; i < probeSchema_.size(); ++i, ++outIdx) {
+            ColumnBuffer& dst = batch_.getColumn(outIdx);
+            if (probe) {
+                dst.copyEntry(rowCount_, probe->getColumn(static_cast<int64_t>(i)), probeRow);
+            } else {
+                dst.setNull(rowCount_);
+                dst.count = rowCount_ + 1;
+            }
+        }
+
+        ++rowCount_;
+    }
+
+    /**
+     * @brief Hand out the current batch
+     * @return Number of rows in the batch
+     */
+    int64_t finish(RowVector& out) {
+        batch_.setRowCount(rowCount_);
+        out.assignView(batch_);
+        return rowCount_;
+    }
+};
+
+}  // namespace toydb
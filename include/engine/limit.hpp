@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include "common/assert.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_result.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Passes through the first limit selected rows of its input and stops pulling once they
+ * were produced. The batch that crosses the limit is cut after its last row in the limit.
+ */
+class LimitExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    int64_t limit_;
+    int64_t produced_ = 0;
+
+    // Selection of a cut batch that had a selection of its own
+    std::optional<PredicateResultVector> selection_;
+    // Input batch, reused across calls
+    RowVector batch_;
+
+public:
+    LimitExec(PhysicalOperator* input, int64_t limit) : input_(input), limit_(limit) {
+        tdb_assert(limit >= 0, "Negative limit {}", limit);
+    }
+
+    void initialize() override {
+        input_->initialize();
+        produced_ = 0;
+    }
+
+    int64_t next(RowVector& out) override {
+        out.clear();
+        if (produced_ >= limit_) {
+            return 0;
+        }
+
+        int64_t count = input_->next(batch_);
+        if (count == 0) {
+            return 0;
+        }
+
+        int64_t remaining = limit_ - produced_;
+        if (count <= remaining) {
+            produced_ += count;
+            out.assignView(batch_);
+            return count;
+        }
+
+        if (!batch_.hasSelection()) {
+            out = batch_.slice(0, remaining);
+        } else {
+            selection_.emplace(batch_.getRowCount());
+            selection_->setAll(PredicateValue::FALSE);
+            int64_t row = -1;
+            for (int64_t i = 0; i < remaining; ++i) {
+                row = batch_.nextSelectedRow(row + 1);
+                selection_->setTrue(row);
+            }
+            out.assignView(batch_);
+            out.setSelection(&*selection_);
+        }
+        produced_ = limit_;
+        return remaining;
+    }
+};
+
+}  // namespace toydb
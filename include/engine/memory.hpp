@@ -1,209 +1,404 @@
 #pragma once
 
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
-#include <memory>
 #include <vector>
+#include "engine/buffer_pool.hpp"
 
 namespace toydb {
 
 namespace memory {
 
-struct Page {
-    using ID = unsigned int;
+/**
+ * @brief Allocates the temporary buffers of one operator from a BufferPool, the process-wide one
+ * by default, and keeps track of the bytes the operator holds. Buffers may be allocated and
+ * released from any thread. All buffers must be released before the manager is destroyed.
+ */
+class BufferManager {
+public:
+    static constexpr std::size_t BUFFER_SIZE = BufferPool::MIN_BUFFER_SIZE; // 64KB
+    // Operators holding less are not asked to spill under pressure, it would only produce tiny spills
+    static constexpr std::size_t MIN_PRESSURE_SPILL_BYTES = 8 * 1024 * 1024;
 
-    void* data;
-};
+    /**
+     * @brief RAII handle to a temporary memory buffer
+     */
+    class BufferHandle {
+    private:
+        BufferManager* manager_;
+        BufferPool::Buffer buffer_;
 
-enum struct MemoryError { OK = 0, FILE_ERROR, MMAP_FAILED, UNKNOWN_PAGE };
+        friend class BufferManager;
 
-struct ManagedRegion {
-    void* data;
-    std::size_t size;
-};
+        BufferHandle(BufferManager* manager, BufferPool::Buffer buffer)
+            : manager_(manager), buffer_(buffer) {}
 
-struct MemoryManager {
+    public:
+        BufferHandle(BufferHandle&& other) noexcept
+            : manager_(other.manager_), buffer_(other.buffer_) {
+            other.manager_ = nullptr;
+            other.buffer_ = {};
+        }
 
-    using FD = int;
-    using Offset = std::size_t;
+        BufferHandle& operator=(BufferHandle&& other) noexcept {
+            if (this != &other) {
+                release();
+                manager_ = other.manager_;
+                buffer_ = other.buffer_;
+                other.manager_ = nullptr;
+                other.buffer_ = {};
+            }
+            return *this;
+        }
 
-    std::size_t pageSize{};
+        ~BufferHandle() {
+            release();
+        }
+
+        // Non-copyable
+        BufferHandle(const BufferHandle&) = delete;
+        BufferHandle& operator=(const BufferHandle&) = delete;
 
-    MemoryError init() noexcept {
-        pageSize = sysconf(_SC_PAGE_SIZE);
-        return MemoryError::OK;
+        void* get() const noexcept {
+            return buffer_.data;
+        }
+
+        std::size_t size() const noexcept {
+            return buffer_.size();
+        }
+
+        void release() {
+            if (manager_ && buffer_.data) {
+                manager_->releaseBuffer(buffer_);
+                manager_ = nullptr;
+                buffer_ = {};
+            }
+        }
+    };
+
+private:
+    BufferPool* pool_;
+    std::atomic<std::size_t> allocatedBytes_ = 0;
+    // Bytes of all buffers ever allocated and the most held at once, reported by EXPLAIN ANALYZE
+    std::atomic<std::size_t> totalAllocatedBytes_ = 0;
+    std::atomic<std::size_t> peakAllocatedBytes_ = 0;
+
+    void recordAllocation(std::size_t size) noexcept {
+        std::size_t held = allocatedBytes_.fetch_add(size, std::memory_order_relaxed) + size;
+        totalAllocatedBytes_.fetch_add(size, std::memory_order_relaxed);
+        std::size_t peak = peakAllocatedBytes_.load(std::memory_order_relaxed);
+        while (held > peak && !peakAllocatedBytes_.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {
+        }
     }
 
-    std::size_t alignToPageSize(std::size_t offset) const noexcept {
-        return offset & ~(pageSize - 1);
+    void releaseBuffer(const BufferPool::Buffer& buffer) {
+        allocatedBytes_.fetch_sub(buffer.size(), std::memory_order_relaxed);
+        pool_->release(buffer);
     }
 
-    std::expected<void*, MemoryError> mapNewFile(const std::string& name,
-                                                 std::size_t size) noexcept {
+public:
+    explicit BufferManager(BufferPool* pool = &BufferPool::global()) : pool_(pool) {}
+    ~BufferManager() = default;
+
+    BufferManager(const BufferManager&) = delete;
+    BufferManager& operator=(const BufferManager&) = delete;
 
-        FD fd = open(name.c_str(), O_CREAT | O_RDWR);
-        if (fd == -1) {
-            return std::unexpected(MemoryError::FILE_ERROR);
+    /**
+     * @brief Allocate a buffer of at least minSize bytes, at most BufferPool::MAX_BUFFER_SIZE
+     * @throws MemoryBudgetExceededError if the pool's memory budget is exhausted
+     */
+    BufferHandle allocate(std::size_t minSize = BUFFER_SIZE) {
+        BufferPool::Buffer buffer = pool_->allocate(minSize);
+        recordAllocation(buffer.size());
+        return BufferHandle(this, buffer);
+    }
+
+    /**
+     * @brief Like allocate, but returns nullopt if the pool's memory budget is exhausted
+     */
+    std::optional<BufferHandle> tryAllocate(std::size_t minSize = BUFFER_SIZE) {
+        std::optional<BufferPool::Buffer> buffer = pool_->tryAllocate(minSize);
+        if (!buffer) {
+            return std::nullopt;
         }
+        recordAllocation(buffer->size());
+        return BufferHandle(this, *buffer);
+    }
 
-        struct stat sb;
-        if (fstat(fd, &sb) == -1)
-            return std::unexpected(MemoryError::FILE_ERROR);
+    /**
+     * @brief Bytes of the buffers currently held through this manager
+     */
+    std::size_t getAllocatedBytes() const noexcept {
+        return allocatedBytes_.load(std::memory_order_relaxed);
+    }
 
-        void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /**
+     * @brief Bytes of all buffers allocated through this manager so far, including released ones
+     */
+    std::size_t getTotalAllocatedBytes() const noexcept {
+        return totalAllocatedBytes_.load(std::memory_order_relaxed);
+    }
 
-        if (addr == MAP_FAILED)
-            return std::unexpected(MemoryError::MMAP_FAILED);
+    /**
+     * @brief Most bytes held through this manager at any time
+     */
+    std::size_t getPeakAllocatedBytes() const noexcept {
+        return peakAllocatedBytes_.load(std::memory_order_relaxed);
+    }
 
-        return addr;
+    /**
+     * @brief Whether the pool is close to its budget, operators that can spill should do so
+     */
+    bool isUnderPressure() const noexcept {
+        return pool_->isUnderPressure();
     }
 
-    std::expected<void*, MemoryError> load(FD fd, Offset offset) const noexcept;
-};
+    /**
+     * @brief Whether an operator using usage bytes should spill: it exceeds its own budget, or it
+     *        holds a fair amount of memory while the pool is under pressure
+     */
+    bool shouldSpill(std::size_t usage, std::size_t operatorBudget) const noexcept {
+        return usage > operatorBudget || (usage >= MIN_PRESSURE_SPILL_BYTES && isUnderPressure());
+    }
 
-struct PageCache {
+    static constexpr std::size_t getBufferSize() noexcept {
+        return BUFFER_SIZE;
+    }
+};
 
-    using FD = int;
+struct Page {
+    using ID = unsigned int;
 
-    struct Entry {
-        void* page;
-        bool pinned;
-        bool read;
-    };
+    void* data;
+};
 
-    std::size_t size;  // number of pages
-    std::unordered_map<Page::ID, Entry> pageMappings;
-    MemoryManager memory;
+enum struct MemoryError { OK = 0, FILE_ERROR, MMAP_FAILED, UNKNOWN_PAGE, READ_FAILED, NO_FREE_FRAME };
 
-    Page getPage(Page::ID id) noexcept;
+struct ManagedRegion {
+    void* data;
+    std::size_t size;
 };
 
-struct PageDirectory {
-    using Offset = MemoryManager::Offset;
+struct MemoryManager {
 
-    std::unordered_map<Page::ID, Offset> pageMappings;
-    MemoryManager& memory;
-    MemoryManager::FD fd;
+    using FD = int;
+    using Offset = std::size_t;
 
-    std::expected<Page, MemoryError> getPage(Page::ID id) noexcept {
-        auto it = pageMappings.find(id);
+    std::size_t pageSize{};
 
-        if (it == pageMappings.end()) {
-            return std::unexpected(MemoryError::UNKNOWN_PAGE);
-        }
+    MemoryError init() noexcept;
 
-        auto result = memory.load(fd, it->second);
-        return result.transform([](void* value) -> Page { return Page{value}; });
+    std::size_t alignToPageSize(std::size_t offset) const noexcept {
+        return offset & ~(pageSize - 1);
     }
+
+    /**
+     * @brief Create (or truncate) the file to size bytes and map it writable and shared, so that
+     * writes reach the file. The file descriptor is closed, the mapping stays valid until munmap.
+     */
+    std::expected<ManagedRegion, MemoryError> mapNewFile(const std::string& name, std::size_t size) noexcept;
+
+    /**
+     * @brief Map the whole file read-only, e.g. to read it without copying it first. The file
+     * descriptor is closed, the mapping stays valid until unmap. Empty files can't be mapped.
+     */
+    std::expected<ManagedRegion, MemoryError> mapFile(const std::string& name) const noexcept;
+
+    static void unmap(const ManagedRegion& region) noexcept;
+
+    /**
+     * @brief Read size bytes at offset of the file into frame. Bytes past the end of the file are zeroed.
+     */
+    std::expected<void, MemoryError> load(FD fd, Offset offset, void* frame, std::size_t size) const noexcept;
 };
 
 /**
- * @brief Manages a pool of memory to create temporary RowVectorBuffers
+ * @brief Caches fixed-size pages in a bounded number of frames.
+ *
+ * Pages are identified by a 64-bit key and loaded into a frame on the first access. A page is
+ * pinned while a PageHandle to it exists, pinned pages are never evicted. Once all frames are in
+ * use, unpinned pages are evicted with the clock algorithm: the clock hand sweeps the frames,
+ * clearing their referenced bit, and evicts the first unpinned frame whose bit is already clear.
+ *
+ * Lookups are partitioned by key, every partition has its own lock. Frames are allocated from
+ * the buffer pool when they are first used. All handles must be released before the cache is
+ * destroyed.
  */
-class BufferManager {
+class PageCache {
 public:
-    static constexpr std::size_t BUFFER_SIZE = 64 * 1024; // 64KB
+    using Key = uint64_t;
+    // Fills the frame with the page, returns false if it could not be read
+    using LoadFn = std::function<bool(void* frame, std::size_t size)>;
+
+    static constexpr std::size_t PAGE_SIZE = BufferPool::MIN_BUFFER_SIZE;
+    static constexpr std::size_t PARTITION_COUNT = 16;
 
     /**
-     * @brief RAII handle to a temporary memory buffer
+     * @brief RAII pin of a cached page
      */
-    class BufferHandle {
+    class PageHandle {
     private:
-        BufferManager* manager_;
-        void* buffer_;
+        PageCache* cache_;
+        std::size_t frame_;
 
-        friend class BufferManager;
+        friend class PageCache;
 
-        BufferHandle(BufferManager* manager, void* buffer)
-            : manager_(manager), buffer_(buffer) {}
+        PageHandle(PageCache* cache, std::size_t frame) : cache_(cache), frame_(frame) {}
 
     public:
-        BufferHandle(BufferHandle&& other) noexcept
-            : manager_(other.manager_), buffer_(other.buffer_) {
-            other.manager_ = nullptr;
-            other.buffer_ = nullptr;
+        PageHandle(PageHandle&& other) noexcept : cache_(other.cache_), frame_(other.frame_) {
+            other.cache_ = nullptr;
         }
 
-        BufferHandle& operator=(BufferHandle&& other) noexcept {
+        PageHandle& operator=(PageHandle&& other) noexcept {
             if (this != &other) {
                 release();
-                manager_ = other.manager_;
-                buffer_ = other.buffer_;
-                other.manager_ = nullptr;
-                other.buffer_ = nullptr;
+                cache_ = other.cache_;
+                frame_ = other.frame_;
+                other.cache_ = nullptr;
             }
             return *this;
         }
 
-        ~BufferHandle() {
+        ~PageHandle() {
             release();
         }
 
-        // Non-copyable
-        BufferHandle(const BufferHandle&) = delete;
-        BufferHandle& operator=(const BufferHandle&) = delete;
+        PageHandle(const PageHandle&) = delete;
+        PageHandle& operator=(const PageHandle&) = delete;
 
-        void* get() const noexcept {
-            return buffer_;
+        Page get() const noexcept {
+            return Page{cache_->frames_[frame_].buffer->get()};
         }
 
-        std::size_t size() const noexcept {
-            return BUFFER_SIZE;
+        void* data() const noexcept {
+            return get().data;
         }
 
-        void release() {
-            if (manager_ && buffer_) {
-                manager_->releaseBuffer(buffer_);
-                manager_ = nullptr;
-                buffer_ = nullptr;
+        void release() noexcept {
+            if (cache_) {
+                cache_->unpin(frame_);
+                cache_ = nullptr;
             }
         }
     };
 
 private:
-    std::vector<std::unique_ptr<char[]>> pool_;
-    std::vector<void*> available_;
+    enum class FrameState : uint8_t { EMPTY, LOADING, READY, FAILED };
 
-    void releaseBuffer(void* buffer) {
-        available_.push_back(buffer);
-    }
+    static constexpr Key NO_KEY = ~Key{0};
+
+    struct Frame {
+        std::optional<BufferManager::BufferHandle> buffer;
+        std::atomic<Key> key = NO_KEY;
+        std::atomic<int32_t> pins = 0;
+        std::atomic<bool> referenced = false;
+        std::atomic<FrameState> state = FrameState::EMPTY;
+    };
+
+    struct Partition {
+        std::mutex mutex;
+        std::unordered_map<Key, std::size_t> frames;
+    };
+
+    BufferManager bufferManager_;
+    std::unique_ptr<Frame[]> frames_;
+    std::size_t frameCount_;
+    std::atomic<std::size_t> clockHand_ = 0;
+    std::array<Partition, PARTITION_COUNT> partitions_;
+
+    std::atomic<int64_t> hits_ = 0;
+    std::atomic<int64_t> misses_ = 0;
+    std::atomic<int64_t> evictions_ = 0;
 
 public:
-    BufferManager() = default;
-    ~BufferManager() = default;
+    explicit PageCache(std::size_t frameCount, BufferPool* pool = &BufferPool::global());
 
-    BufferManager(const BufferManager&) = delete;
-    BufferManager& operator=(const BufferManager&) = delete;
+    PageCache(const PageCache&) = delete;
+    PageCache& operator=(const PageCache&) = delete;
 
-    BufferHandle allocate() {
-        // Try to reuse an available buffer first
-        if (!available_.empty()) {
-            void* buffer = available_.back();
-            available_.pop_back();
-            return BufferHandle(this, buffer);
-        }
+    /**
+     * @brief Pin the page with the key, loading it with load if it is not cached. Concurrent
+     * requests for a page that is being loaded wait for the load.
+     * @return NO_FREE_FRAME if every frame is pinned, READ_FAILED if load failed
+     */
+    std::expected<PageHandle, MemoryError> pin(Key key, const LoadFn& load);
 
-        // TODO: Come up with a better strategy that grows
-        // and shrinks the pool exponentially, while also preventing OOMs.
-        // ...or use a fixed size pool.
-        auto buffer = std::make_unique<char[]>(BUFFER_SIZE);
-        void* raw_buffer = buffer.get();
+    /**
+     * @brief Whether the page is cached, e.g. for tests and statistics
+     */
+    bool contains(Key key);
 
-        pool_.push_back(std::move(buffer));
-        return BufferHandle(this, raw_buffer);
+    std::size_t getFrameCount() const noexcept {
+        return frameCount_;
     }
 
-    static constexpr std::size_t getBufferSize() noexcept {
-        return BUFFER_SIZE;
+    int64_t getHitCount() const noexcept {
+        return hits_.load(std::memory_order_relaxed);
+    }
+
+    int64_t getMissCount() const noexcept {
+        return misses_.load(std::memory_order_relaxed);
+    }
+
+    int64_t getEvictionCount() const noexcept {
+        return evictions_.load(std::memory_order_relaxed);
+    }
+
+private:
+    Partition& partitionOf(Key key) noexcept;
+    std::optional<std::size_t> claimFrame();
+    bool tryClaim(std::size_t frame);
+    std::expected<PageHandle, MemoryError> waitUntilLoaded(std::size_t frame);
+    void unpin(std::size_t frame) noexcept;
+};
+
+/**
+ * @brief Pages of one file, served through a PageCache. Page ids are mapped to their offset in
+ * the file, file ids keep the pages of different files apart in a shared cache.
+ */
+class PageDirectory {
+public:
+    using Offset = MemoryManager::Offset;
+
+private:
+    std::unordered_map<Page::ID, Offset> pageMappings_;
+    PageCache& cache_;
+    const MemoryManager& memory_;
+    MemoryManager::FD fd_;
+    uint32_t fileId_;
+
+public:
+    PageDirectory(PageCache& cache, const MemoryManager& memory, MemoryManager::FD fd, uint32_t fileId)
+        : cache_(cache), memory_(memory), fd_(fd), fileId_(fileId) {}
+
+    void addPage(Page::ID id, Offset offset) {
+        pageMappings_[id] = offset;
+    }
+
+    /**
+     * @brief Pin the page, reading it from the file unless it is cached
+     */
+    std::expected<PageCache::PageHandle, MemoryError> getPage(Page::ID id) {
+        auto it = pageMappings_.find(id);
+        if (it == pageMappings_.end()) {
+            return std::unexpected(MemoryError::UNKNOWN_PAGE);
+        }
+
+        Offset offset = it->second;
+        PageCache::Key key = (static_cast<PageCache::Key>(fileId_) << 32) | id;
+        return cache_.pin(key, [this, offset](void* frame, std::size_t size) {
+            return memory_.load(fd_, offset, frame, size).has_value();
+        });
     }
 };
 
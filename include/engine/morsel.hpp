@@ -0,0 +1,258 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/data_strucures/lock_free_queue.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief A fixed-size range of rows of a shared batch, the unit of work of the pipeline executor.
+ * The batch is kept alive as long as morsels referencing it exist.
+ */
+struct Morsel {
+    std::shared_ptr<const RowVector> batch;
+    int64_t begin = 0;
+    int64_t count = 0;
+
+    RowVector rows() const {
+        return batch->slice(begin, count);
+    }
+};
+
+/**
+ * @brief Produces the batches a pipeline is run on. The executor splits them into morsels.
+ * Calls to nextBatch() are serialized by the executor, sources don't need to be thread-safe.
+ */
+class MorselSource {
+public:
+    virtual ~MorselSource() = default;
+
+    /**
+     * @brief Hand out the next batch. The batch must not have a selection.
+     * @return nullptr once the source is exhausted
+     */
+    virtual std::shared_ptr<const RowVector> nextBatch() = 0;
+};
+
+/**
+ * @brief Creates the source of a pipeline when the pipeline starts, e.g. a table scan whose readers
+ * start as soon as it is constructed
+ */
+using MorselSourceFactory = std::function<std::unique_ptr<MorselSource>()>;
+
+/**
+ * @brief Hands out the chunks of materialized inputs, e.g. the output of an earlier pipeline.
+ * The inputs must outlive the morsels.
+ */
+class MaterializedMorselSource : public MorselSource {
+private:
+    std::vector<const MaterializedInput*> inputs_;
+    size_t input_ = 0;
+    size_t chunk_ = 0;
+
+public:
+    explicit MaterializedMorselSource(std::vector<const MaterializedInput*> inputs) : inputs_(std::move(inputs)) {}
+
+    explicit MaterializedMorselSource(const MaterializedInput* input) : inputs_{input} {}
+
+    std::shared_ptr<const RowVector> nextBatch() override {
+        while (input_ < inputs_.size()) {
+            if (chunk_ < inputs_[input_]->getChunkCount()) {
+                // The chunk is owned by the input, share it without an owner
+                return std::shared_ptr<const RowVector>(std::shared_ptr<void>(), &inputs_[input_]->getChunk(chunk_++));
+            }
+            ++input_;
+            chunk_ = 0;
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * @brief Drains a single-threaded operator. Its batches are only valid until the next call to
+ * next(), so every batch is copied before it is split into morsels.
+ */
+class OperatorMorselSource : public MorselSource {
+private:
+    PhysicalOperator* input_;
+    memory::BufferManager* bufferManager_;
+    bool initialized_ = false;
+
+    std::shared_ptr<MaterializedInput> current_;
+    size_t chunk_ = 0;
+    // Batch of the input, reused across calls
+    RowVector batch_;
+    std::vector<ColumnDescriptor> schema_;
+
+public:
+    OperatorMorselSource(PhysicalOperator* input, memory::BufferManager* bufferManager)
+        : input_(input), bufferManager_(bufferManager) {}
+
+    std::shared_ptr<const RowVector> nextBatch() override {
+        if (!initialized_) {
+            input_->initialize();
+            initialized_ = true;
+        }
+
+        while (!current_ || chunk_ == current_->getChunkCount()) {
+            int64_t rowCount = input_->next(batch_);
+            // The schema is known even if the input is empty, as long as it sets up its columns
+            if (schema_.empty() && batch_.getColumnCount() > 0) {
+                schema_ = getColumnDescriptors(batch_);
+            }
+            if (rowCount == 0) {
+                current_.reset();
+                return nullptr;
+            }
+
+            current_ = std::make_shared<MaterializedInput>(bufferManager_);
+            current_->append(batch_);
+            chunk_ = 0;
+        }
+
+        const RowVector& chunk = current_->getChunk(chunk_++);
+        return std::shared_ptr<const RowVector>(current_, &chunk);
+    }
+
+    /**
+     * @brief Columns of the input, empty until it produced its first batch
+     */
+    const std::vector<ColumnDescriptor>& getSchema() const noexcept {
+        return schema_;
+    }
+};
+
+/**
+ * @brief Hands out the morsels of a source to a fixed number of workers.
+ *
+ * Every worker has its own queue. A worker with an empty queue fetches the next batch of the
+ * source and queues all of its morsels locally, so that a worker mostly processes rows it read
+ * itself. Once the source is exhausted, idle workers steal morsels from the other queues.
+ */
+class MorselDispatcher {
+private:
+    // Capacity of each worker queue. Batches of the sources above have at most rowsPerBuffer()
+    // rows, which is below LOCAL_QUEUE_CAPACITY * MIN_MORSEL_SIZE, so all their morsels fit.
+    static constexpr size_t LOCAL_QUEUE_CAPACITY = 1024;
+
+    MorselSource* source_;
+    int64_t morselSize_;
+    std::vector<std::unique_ptr<LockFreeQueue<Morsel>>> queues_;
+
+    std::mutex sourceMutex_;
+    std::atomic<bool> exhausted_ = false;
+    std::atomic<int64_t> stolenCount_ = 0;
+
+public:
+    // Morsels start at multiples of 64 rows, so that slices of the null bitmap are word aligned
+    static constexpr int64_t MIN_MORSEL_SIZE = 64;
+
+    MorselDispatcher(MorselSource* source, size_t workerCount, int64_t morselSize)
+        : source_(source), morselSize_(morselSize) {
+        tdb_assert(morselSize >= MIN_MORSEL_SIZE && morselSize % MIN_MORSEL_SIZE == 0,
+                   "Morsel size {} is not a multiple of {}", morselSize, MIN_MORSEL_SIZE);
+        for (size_t i = 0; i < workerCount; ++i) {
+            queues_.push_back(std::make_unique<LockFreeQueue<Morsel>>(LOCAL_QUEUE_CAPACITY));
+        }
+    }
+
+    /**
+     * @brief Fetch the next morsel for the given worker
+     * @return false once all morsels have been handed out
+     */
+    bool next(size_t worker, Morsel& out) {
+        while (true) {
+            if (queues_[worker]->tryPop(out)) {
+                return true;
+            }
+            if (!exhausted_.load(std::memory_order_acquire)) {
+                refill(worker);
+                continue;
+            }
+
+            // The source is exhausted and no more morsels are queued, steal from the other workers
+            for (size_t i = 1; i < queues_.size(); ++i) {
+                if (queues_[(worker + i) % queues_.size()]->tryPop(out)) {
+                    stolenCount_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    /**
+     * @brief Number of morsels processed by another worker than the one that fetched them
+     */
+    int64_t getStolenCount() const noexcept {
+        return stolenCount_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void refill(size_t worker) {
+        std::lock_guard lock(sourceMutex_);
+        if (exhausted_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        std::shared_ptr<const RowVector> batch = source_->nextBatch();
+        if (!batch) {
+            // Set while holding the lock: every morsel queued before is visible to workers seeing the flag
+            exhausted_.store(true, std::memory_order_release);
+            return;
+        }
+        tdb_assert(!batch->hasSelection(), "Morsel source batches must not have a selection");
+
+        for (int64_t begin = 0; begin < batch->getRowCount(); begin += morselSize_) {
+            Morsel morsel {batch, begin, std::min(morselSize_, batch->getRowCount() - begin)};
+            [[maybe_unused]] bool queued = queues_[worker]->tryPush(morsel);
+            tdb_assert(queued, "Batch of {} rows does not fit the morsel queue", batch->getRowCount());
+        }
+    }
+};
+
+/**
+ * @brief Leaf of a worker's copy of a pipeline, returns one morsel of the dispatcher per call
+ */
+class MorselScanExec : public PhysicalOperator {
+private:
+    MorselDispatcher* dispatcher_;
+    size_t worker_;
+    const std::atomic<bool>* cancelled_;
+
+    Morsel current_;
+
+public:
+    /**
+     * @param cancelled Stop producing rows once set, may be nullptr
+     */
+    MorselScanExec(MorselDispatcher* dispatcher, size_t worker, const std::atomic<bool>* cancelled = nullptr)
+        : dispatcher_(dispatcher), worker_(worker), cancelled_(cancelled) {}
+
+    void initialize() override {}
+
+    int64_t next(RowVector& out) override {
+        out.clear();
+        if (cancelled_ && cancelled_->load(std::memory_order_relaxed)) {
+            current_ = Morsel();
+            return 0;
+        }
+        if (!dispatcher_->next(worker_, current_)) {
+            current_ = Morsel();
+            return 0;
+        }
+        out = current_.rows();
+        return out.getRowCount();
+    }
+};
+
+}  // namespace toydb
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/join_output.hpp"
 #include "engine/physical_operator.hpp"
 #include "engine/predicate_expr.hpp"
 #include "engine/memory.hpp"
 #include "engine/predicate_result.hpp"
+#include "engine/spill.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <cstring>
@@ -17,84 +21,304 @@ class PredicateExpr;
 /**
  * @brief Implements the execution of a nested loop join with a comparison expression.
  *        The comparison must be a single compare operator with a left and right column or constants.
+ *
+ * The output rows contain the build columns followed by the probe columns. Equi-joins should use
+ * HashJoinExec instead.
+ *
+ * If the build input exceeds the memory budget, the join runs as a block nested loop join: the
+ * rest of the build input is spilled, and the probe input is spilled while it is joined with the
+ * first block. Each further block of the build input that fits the budget is then joined with the
+ * probe input read back from disk.
  */
 class NestedLoopJoinExec : public PhysicalOperator {
 private:
+    // Where a column referenced by the predicate comes from
+    struct PredicateInput {
+        bool fromBuild;
+        int64_t columnIndex;
+    };
+
     PhysicalOperator* build_;
     PhysicalOperator* probe_;
     std::unique_ptr<PredicateExpr> joinExpr_;
     memory::BufferManager bufferManager_;
+    size_t memoryBudget_;
+
+    // Materialized left side (build input), the current block if the build input spilled
+    MaterializedInput materializedLeft_;
+    JoinOutputBuilder output_;
+    bool opened_ = false;
+
+    // Scratch batch holding (build row, probe row) pairs in the layout expected by the predicate
+    BatchAllocator scratchAllocator_;
+    RowVector scratch_;
+    std::vector<PredicateInput> predicateInputs_;
+    int64_t scratchCapacity_ = 0;
+    // Result of the predicate on the scratch batch and its intermediate results, reused across blocks
+    PredicateResultVector joinResult_;
+    PredicateScratch joinScratch_;
 
-    // Materialized left side (build input)
-    std::vector<RowVector> materializedLeft_;
+    // Probe state: pairs of the current probe batch are enumerated as probeRow * buildRows + buildRow
+    RowVector probeBatch_;
+    // Selected rows of the probe batch, nullptr if all rows are selected
+    const SelectionVector* probeSelection_ = nullptr;
+    std::vector<ColumnDescriptor> probeSchema_;
+    int64_t pairCursor_ = 0;
+    int64_t pairCount_ = 0;
+    bool probeExhausted_ = false;
+
+    // Block nested loop state: the build rows after the first block and the probe rows, and the
+    // readers of the current pass. probeReader_ is set once the probe input is replayed from disk.
+    std::unique_ptr<SpillFile> buildSpill_;
+    std::unique_ptr<SpillFile> probeSpill_;
+    std::unique_ptr<SpillReader> buildReader_;
+    std::unique_ptr<SpillReader> probeReader_;
+    std::shared_ptr<const BatchSchema> probeBatchSchema_;
+    // Batches read back from the spill files
+    BatchAllocator spillAllocator_;
+    BatchAllocator probeAllocator_;
 
 public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    /**
+     * @param memoryBudget Bytes of build rows kept in memory at once
+     */
     NestedLoopJoinExec(PhysicalOperator* build, PhysicalOperator* probe,
-                       std::unique_ptr<PredicateExpr> joinExpr)
-        : build_(build), probe_(probe), joinExpr_(std::move(joinExpr)) {}
+                       std::unique_ptr<PredicateExpr> joinExpr, size_t memoryBudget = DEFAULT_MEMORY_BUDGET)
+        : build_(build),
+          probe_(probe),
+          joinExpr_(std::move(joinExpr)),
+          memoryBudget_(memoryBudget),
+          materializedLeft_(&bufferManager_),
+          output_(&bufferManager_),
+          scratchAllocator_(&bufferManager_),
+          spillAllocator_(&bufferManager_),
+          probeAllocator_(&bufferManager_) {}
 
     void initialize() override {
         // Initialize both operators
         build_->initialize();
         probe_->initialize();
+        joinExpr_->initializeIndexMap();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
     }
 
     int64_t next(RowVector& out) override {
         Logger::debug("NestedLoopJoinExec::next");
 
-        materializeBuildInput();
-
-        int64_t totalOutputRows = 0;
-
-        // Scan right side (probe input) in chunks
-        RowVector rightVector;
-        int64_t rightCount = probe_->next(rightVector);
+        if (!opened_) {
+            materializeBuildInput();
+            fetchProbeBatch();
+            output_.setSchema(materializedLeft_.getSchema(), probeSchema_);
+            setupScratch();
+            opened_ = true;
+        }
 
-        // TODO: Implement the join logic.
-        // 0. Get the index map for the predicate
-        // 1. iterate over the rows in the probe vector
-        // 2. for each row, iterate over the materialized left rows
-        // 3. evaluate the predicate for the row: Create a row vector with the required columns specified by the index map
-        // 4. if the predicate is true, add the row to the output vector (for now just returne the count and leave a todo)
-        while (rightCount > 0) {
-            tdb_unreachable("Not implemented");
+        output_.begin();
+        while (!output_.isFull()) {
+            if (pairCursor_ >= pairCount_ && !fetchProbeBatch()) {
+                break;
+            }
+            evaluatePairs();
         }
 
-        out.setRowCount(totalOutputRows);
-        return totalOutputRows;
+        return output_.finish(out);
     }
 
 private:
 
     /**
-     * @brief Materialize the entire left side (build input) into memory
+     * @brief Materialize the left side (build input) into memory, spilling what exceeds the budget
      */
     void materializeBuildInput() {
         Logger::debug("NestedLoopJoinExec::materializeLeftSide: starting materialization");
 
-        RowVector leftBatch;
-        int64_t batchCount = 0;
+        bool exhausted = materializedLeft_.materializeUntil(*build_, [&] { return isBlockFull(); });
+        if (!exhausted) {
+            buildSpill_ = std::make_unique<SpillFile>("join");
+            probeSpill_ = std::make_unique<SpillFile>("join");
+            RowVector batch;
+            while (build_->next(batch) > 0) {
+                buildSpill_->writeBatch(batch);
+            }
+            buildReader_ = buildSpill_->openReader();
+            Logger::debug("NestedLoopJoinExec::materializeLeftSide: spilled {} bytes of the build input",
+                          buildSpill_->getSize());
+        }
+
+        Logger::debug("NestedLoopJoinExec::materializeLeftSide: completed materialization of {} rows in memory",
+                      materializedLeft_.getRowCount());
+    }
+
+    bool isBlockFull() const noexcept {
+        return bufferManager_.shouldSpill(materializedLeft_.getMemoryUsage(), memoryBudget_);
+    }
 
-        // Read all batches from the left operator until exhausted
-        while (true) {
-            int64_t rowCount = build_->next(leftBatch);
-            if (rowCount == 0) {
+    /**
+     * @brief Replace the build rows in memory with the next block of the spilled build input, and
+     *        replay the probe input from the start
+     * @return false if no build rows are left
+     */
+    bool loadNextBuildBlock() {
+        if (!buildReader_ || probeSpill_->getSize() == 0) {
+            return false;
+        }
+
+        materializedLeft_.clear();
+        RowVector batch;
+        while (!isBlockFull()) {
+            spillAllocator_.reset();
+            if (buildReader_->readBatch(materializedLeft_.getBatchSchema(), spillAllocator_, batch) == 0) {
+                buildReader_.reset();
                 break;
             }
+            materializedLeft_.append(batch);
+        }
+        if (materializedLeft_.getRowCount() == 0) {
+            return false;
+        }
 
-            // Store the batch in the materialized vector
-            materializedLeft_.push_back(leftBatch);
-            batchCount++;
+        Logger::debug("NestedLoopJoinExec: joining a spilled block of {} build rows", materializedLeft_.getRowCount());
+        probeReader_ = probeSpill_->openReader();
+        return true;
+    }
+
+    int64_t readProbeBatch() {
+        probeSelection_ = nullptr;
+        if (probeReader_) {
+            probeAllocator_.reset();
+            return probeReader_->readBatch(probeBatchSchema_, probeAllocator_, probeBatch_);
+        }
+
+        int64_t rowCount = probe_->next(probeBatch_);
+        if (probeSchema_.empty() && probeBatch_.getColumnCount() > 0) {
+            probeSchema_ = getColumnDescriptors(probeBatch_);
+            probeBatchSchema_ = probeBatch_.getSchema();
+        }
+        if (rowCount > 0 && probeSpill_) {
+            probeSpill_->writeBatch(probeBatch_);
+        }
+        return rowCount;
+    }
 
-            Logger::debug("NestedLoopJoinExec::materializeLeftSide: materialized batch {} with {} rows",
-                         batchCount, rowCount);
+    bool fetchProbeBatch() {
+        pairCursor_ = 0;
+        pairCount_ = 0;
 
-            // Clear the batch for the next iteration
-            leftBatch = RowVector();
+        while (!probeExhausted_) {
+            if (opened_ && materializedLeft_.getRowCount() == 0) {
+                probeExhausted_ = true;
+                break;
+            }
+
+            int64_t rowCount = readProbeBatch();
+            if (rowCount > 0) {
+                probeSelection_ = probeBatch_.hasSelection() ? &probeBatch_.getSelection()->getSelectionVector() : nullptr;
+                pairCount_ = rowCount * materializedLeft_.getRowCount();
+                return true;
+            }
+
+            // The probe input is done with the current build rows
+            if (!loadNextBuildBlock()) {
+                probeExhausted_ = true;
+            }
+        }
+        return false;
+    }
+
+    int64_t probeRowOf(int64_t pair, int64_t buildRows) const noexcept {
+        int64_t probeIdx = pair / buildRows;
+        return probeSelection_ ? (*probeSelection_)[probeIdx] : probeIdx;
+    }
+
+    /**
+     * @brief Resolve the columns referenced by the predicate and allocate the scratch batch
+     */
+    void setupScratch() {
+        if (materializedLeft_.getRowCount() == 0 || probeSchema_.empty()) {
+            // No pairs to evaluate
+            return;
+        }
+
+        auto indexMap = joinExpr_->getColumnIndexMap();
+        std::vector<ColumnDescriptor> scratchSchema(indexMap.size());
+        predicateInputs_.resize(indexMap.size());
+
+        for (const auto& [colId, idx] : indexMap) {
+            tdb_assert(idx >= 0 && static_cast<size_t>(idx) < indexMap.size(), "Predicate column index {} out of range", idx);
+
+            int64_t buildIdx = materializedLeft_.getColumnIndex(colId);
+            if (buildIdx != -1) {
+                predicateInputs_[idx] = {true, buildIdx};
+                scratchSchema[idx] = materializedLeft_.getSchema()[static_cast<size_t>(buildIdx)];
+                continue;
+            }
+
+            int64_t probeIdx = -1;
+            for (size_t i = 0; i < probeSchema_.size(); ++i) {
+                if (probeSchema_[i].columnId == colId) {
+                    probeIdx = static_cast<int64_t>(i);
+                }
+            }
+            tdb_assert(probeIdx != -1, "Join predicate column {} is not produced by either input", colId);
+            predicateInputs_[idx] = {false, probeIdx};
+            scratchSchema[idx] = probeSchema_[static_cast<size_t>(probeIdx)];
+        }
+
+        scratch_ = scratchAllocator_.allocateBatch(scratchSchema);
+        for (int64_t colIdx = 0; colIdx < scratch_.getColumnCount(); ++colIdx) {
+            // Pairs only live for one evaluation, their strings can point into the inputs
+            scratch_.getColumn(colIdx).setStringHeap(nullptr);
+        }
+        scratchCapacity_ = BatchAllocator::rowsPerBuffer(scratchSchema);
+    }
+
+    /**
+     * @brief Evaluate the predicate over the next block of pairs and emit the matches. The block never
+     *        contains more pairs than there is room left in the output batch.
+     */
+    void evaluatePairs() {
+        int64_t buildRows = materializedLeft_.getRowCount();
+        int64_t chunkCapacity = materializedLeft_.getChunkCapacity();
+        int64_t blockSize = std::min({pairCount_ - pairCursor_, scratchCapacity_,
+                                      output_.getCapacity() - output_.getRowCount()});
+
+        for (int64_t colIdx = 0; colIdx < scratch_.getColumnCount(); ++colIdx) {
+            ColumnBuffer& dst = scratch_.getColumn(colIdx);
+            const PredicateInput& input = predicateInputs_[static_cast<size_t>(colIdx)];
+            dst.count = 0;
+
+            for (int64_t i = 0; i < blockSize; ++i) {
+                int64_t pair = pairCursor_ + i;
+                if (input.fromBuild) {
+                    int64_t buildRow = pair % buildRows;
+                    const RowVector& chunk = materializedLeft_.getChunk(static_cast<size_t>(buildRow / chunkCapacity));
+                    dst.copyEntry(i, chunk.getColumn(input.columnIndex), buildRow % chunkCapacity);
+                } else {
+                    dst.copyEntry(i, probeBatch_.getColumn(input.columnIndex), probeRowOf(pair, buildRows));
+                }
+            }
+        }
+        scratch_.setRowCount(blockSize);
+
+        joinScratch_.reset();
+        joinExpr_->evaluateInto(scratch_, joinResult_, joinScratch_);
+
+        for (int64_t i = 0; i < blockSize; ++i) {
+            if (!joinResult_.isTrue(i)) {
+                continue;
+            }
+            int64_t pair = pairCursor_ + i;
+            int64_t buildRow = pair % buildRows;
+            const RowVector& chunk = materializedLeft_.getChunk(static_cast<size_t>(buildRow / chunkCapacity));
+            output_.append(&chunk, buildRow % chunkCapacity, &probeBatch_, probeRowOf(pair, buildRows));
         }
 
-        Logger::debug("NestedLoopJoinExec::materializeLeftSide: completed materialization of {} batches",
-                     materializedLeft_.size());
+        pairCursor_ += blockSize;
     }
 };
-} // namespace toydb
\ No newline at end of file
+} // namespace toydb
@@ -1,16 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <span>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include "common/assert.hpp"
 #include "common/types.hpp"
+#include "engine/predicate_result.hpp"
+#include "engine/string_heap.hpp"
 
 namespace toydb {
 
+class PredicateExpr;
+
+namespace memory {
+class BufferManager;
+}
+
 class NullBitmap {
 public:
     NullBitmap() : bitmap_(nullptr), size_ {0} {}
@@ -55,6 +65,22 @@ public:
         clearAllNull(0, size_);
     }
 
+    /**
+     * @brief Returns the validity bits (1 = non-null) of the 64 rows starting at wordIndex * 64.
+     * Bits past the end of the bitmap are unspecified.
+     */
+    uint64_t getValidityWord(int64_t wordIndex) const noexcept {
+        if (!bitmap_) return ~uint64_t{0};
+
+        int64_t byteOffset = wordIndex * 8;
+        int64_t bytes = std::min<int64_t>(8, (size_ + 7) / 8 - byteOffset);
+        uint64_t word = 0;
+        if (bytes > 0) {
+            std::memcpy(&word, bitmap_ + byteOffset, static_cast<size_t>(bytes));
+        }
+        return word;
+    }
+
     uint8_t* data() noexcept { return bitmap_; }
     const uint8_t* data() const noexcept { return bitmap_; }
 
@@ -88,6 +114,13 @@ class ColumnBuffer {
         return capacity_;
     }
 
+    /**
+     * @brief The values, getCapacity() of them with type.getSize() bytes each
+     */
+    const void* getData() const noexcept {
+        return data_;
+    }
+
     bool isNull(int64_t index) const noexcept {
         return nullBitmap_.isNull(index);
     }
@@ -100,62 +133,118 @@ class ColumnBuffer {
         nullBitmap_.clearNull(index);
     }
 
+    const NullBitmap& getNullBitmap() const noexcept {
+        return nullBitmap_;
+    }
+
+    /**
+     * @brief Heap holding the characters of long strings written to this column. Not owned.
+     */
+    StringHeap* getStringHeap() const noexcept {
+        return stringHeap_;
+    }
+
+    void setStringHeap(StringHeap* stringHeap) noexcept {
+        stringHeap_ = stringHeap;
+    }
+
     template<is_db_type T>
     std::span<T> getDataAs() const {
         tdb_assert(type == getDataTypeFor<T>(), "Column type mismatch");
-        if constexpr (std::same_as<T, db_string>) {
-            // For string arrays, we need to handle char[256] specially
-            // Return span of first element, caller must handle stride manually
-            tdb_unreachable("getDataAs<db_string> not supported, use getEntryAt instead");
-        } else {
-            T* dataPtr = static_cast<T*>(data_);
-            return std::span<T>(dataPtr, static_cast<size_t>(capacity_));
-        }
+        T* dataPtr = static_cast<T*>(data_);
+        return std::span<T>(dataPtr, static_cast<size_t>(capacity_));
     }
 
     template<is_db_type T>
     const T& getEntry(int64_t index) const {
         tdb_assert(type == getDataTypeFor<T>(), "Column type mismatch");
         tdb_assert(index >= 0 && index < count, "Index out of range");
-        if constexpr (std::same_as<T, db_string>) {
-            const char* dataPtr = static_cast<const char*>(data_);
-            return *reinterpret_cast<const db_string*>(dataPtr + (index * 256));
-        } else {
-            const T* dataPtr = static_cast<const T*>(data_);
-            return dataPtr[index];
-        }
+        const T* dataPtr = static_cast<const T*>(data_);
+        return dataPtr[index];
     }
 
     template<is_db_type T>
     T& getEntry(int64_t index) {
         tdb_assert(type == getDataTypeFor<T>(), "Column type mismatch");
         tdb_assert(index >= 0 && index < count, "Index out of range");
-        if constexpr (std::same_as<T, db_string>) {
-            char* dataPtr = static_cast<char*>(data_);
-            return *reinterpret_cast<db_string*>(dataPtr + (index * sizeof(db_string)));
-        } else {
-            T* dataPtr = static_cast<T*>(data_);
-            return dataPtr[index];
-        }
+        T* dataPtr = static_cast<T*>(data_);
+        return dataPtr[index];
     }
 
+    /**
+     * @brief Write a value. Strings are stored as given: the characters of a long string must
+     * outlive the column, use writeString to copy them into the column's heap.
+     */
     template<is_db_type T>
     void writeEntry(int64_t index, const T& value) {
         tdb_assert(type == getDataTypeFor<T>(), "Column type mismatch");
         tdb_assert(index >= 0 && index < capacity_, "Index out of range");
-        if constexpr (std::same_as<T, db_string>) {
-            char* dataPtr = static_cast<char*>(data_);
-            char* strPtr = dataPtr + (index * sizeof(db_string));
-            std::memcpy(strPtr, value, sizeof(db_string));
+        T* dataPtr = static_cast<T*>(data_);
+        dataPtr[index] = value;
+        if (index >= count) {
+            count = index + 1;
+        }
+    }
+
+    /**
+     * @brief Write a string, copying the characters of long strings into heap, or the column's
+     * heap if heap is nullptr
+     */
+    void writeString(int64_t index, std::string_view value, StringHeap* heap = nullptr) {
+        if (value.size() > db_string::INLINE_LENGTH) {
+            heap = heap ? heap : stringHeap_;
+            tdb_assert(heap != nullptr, "Column {} has no string heap for long strings", columnId.getName());
+            writeEntry(index, heap->makeString(value));
+        } else {
+            writeEntry(index, db_string::fromView(value));
+        }
+    }
+
+    /**
+     * @brief Copy the entry (value and null flag) at srcIndex of src to index of this column.
+     * Long strings are copied into this column's heap if it has one.
+     */
+    void copyEntry(int64_t index, const ColumnBuffer& src, int64_t srcIndex) {
+        tdb_assert(type == src.type, "Column type mismatch");
+        tdb_assert(index >= 0 && index < capacity_, "Index out of range");
+        if (src.isNull(srcIndex)) {
+            setNull(index);
         } else {
-            T* dataPtr = static_cast<T*>(data_);
-            dataPtr[index] = value;
+            clearNull(index);
+            size_t size = static_cast<size_t>(type.getSize());
+            std::memcpy(static_cast<char*>(data_) + static_cast<size_t>(index) * size,
+                        static_cast<const char*>(src.data_) + static_cast<size_t>(srcIndex) * size, size);
+
+            if (type == DataType::getString() && stringHeap_) {
+                db_string& value = static_cast<db_string*>(data_)[index];
+                if (!value.isInline()) {
+                    value = stringHeap_->makeString(value.view());
+                }
+            }
         }
         if (index >= count) {
             count = index + 1;
         }
     }
 
+    /**
+     * @brief View of count rows starting at begin that shares the data of this column. begin must
+     * be a multiple of 8, so that the null bitmap of the view starts at a byte boundary.
+     */
+    ColumnBuffer slice(int64_t begin, int64_t count) const {
+        tdb_assert(begin % 8 == 0, "Slice offset {} is not byte aligned", begin);
+        tdb_assert(begin >= 0 && count >= 0 && begin + count <= capacity_, "Slice out of range");
+
+        NullBitmap bitmap = nullBitmap_;
+        NullBitmap sliceBitmap = bitmap.data() ? NullBitmap(bitmap.data() + begin / 8, count) : NullBitmap();
+        size_t offset = static_cast<size_t>(begin) * static_cast<size_t>(type.getSize());
+
+        ColumnBuffer result(columnId, type, static_cast<char*>(data_) + offset, count, sliceBitmap);
+        result.count = std::clamp<int64_t>(this->count - begin, 0, count);
+        result.stringHeap_ = stringHeap_;
+        return result;
+    }
+
     std::string getValueAsString(int64_t index) const {
         if (isNull(index)) {
             return "NULL";
@@ -171,7 +260,7 @@ class ColumnBuffer {
             case DataType::Type::BOOL:
                 return getEntry<db_bool>(index) ? "true" : "false";
             case DataType::Type::STRING:
-                return "'" + std::string(getEntry<db_string>(index)) + "'";
+                return "'" + std::string(getEntry<db_string>(index).view()) + "'";
             case DataType::Type::NULL_CONST:
                 return "NULL";
             default:
@@ -207,18 +296,234 @@ private:
     void* data_;
     NullBitmap nullBitmap_;
     int64_t capacity_;
+    StringHeap* stringHeap_ = nullptr;
+};
+
+/**
+ * @brief Id and type of a column in an operator's output
+ */
+struct ColumnDescriptor {
+    ColumnId columnId;
+    DataType type;
+};
+
+/**
+ * @brief Ids and types of the columns of a batch. Immutable, so that all batches an operator
+ * produces can share one instance.
+ */
+class BatchSchema {
+private:
+    std::vector<ColumnDescriptor> columns_;
+
+public:
+    explicit BatchSchema(std::vector<ColumnDescriptor> columns) : columns_(std::move(columns)) {}
+
+    static std::shared_ptr<const BatchSchema> make(std::vector<ColumnDescriptor> columns) {
+        return std::make_shared<const BatchSchema>(std::move(columns));
+    }
+
+    int64_t getColumnCount() const noexcept {
+        return static_cast<int64_t>(columns_.size());
+    }
+
+    const std::vector<ColumnDescriptor>& getColumns() const noexcept {
+        return columns_;
+    }
+
+    const ColumnDescriptor& getColumn(int64_t index) const {
+        tdb_assert(index >= 0 && index < getColumnCount(), "Column index {} out of range", index);
+        return columns_[static_cast<size_t>(index)];
+    }
+
+    /**
+     * @brief Index of the column, -1 if the schema does not contain it. Batches have few columns,
+     *        so the ids are scanned instead of hashed.
+     */
+    int64_t getColumnIndex(const ColumnId& colId) const noexcept {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (columns_[i].columnId == colId) {
+                return static_cast<int64_t>(i);
+            }
+        }
+        return -1;
+    }
 };
 
+/**
+ * @brief A batch of rows stored as columns.
+ *
+ * A batch can be bound to a schema, which sizes it to the schema's columns once; producers then
+ * only refill the columns for every batch. reset() and clear() keep the storage, so a batch that
+ * is reused across calls stops allocating. Batches are move-only: a batch that shares the columns
+ * of another is made explicitly with view() or assignView().
+ */
 class RowVector {
+    // Columns of the batch, derived from columns_ on demand if the batch was built column by column
+    mutable std::shared_ptr<const BatchSchema> schema_;
     std::vector<ColumnBuffer> columns_;
-    std::unordered_map<ColumnId, int64_t, ColumnIdHash> columnIdToIndex_;
-    int64_t rowCount_;
+    int64_t rowCount_ = 0;
+
+    // Rows of the batch that are part of the result, nullptr if all rows are. Owned by the producer.
+    const PredicateResultVector* selection_ = nullptr;
 
     public:
+    RowVector() = default;
+
+    /**
+     * @brief An empty batch bound to schema, see bind()
+     */
+    explicit RowVector(std::shared_ptr<const BatchSchema> schema) {
+        bind(std::move(schema));
+    }
+
+    RowVector(const RowVector&) = delete;
+    RowVector& operator=(const RowVector&) = delete;
+    RowVector(RowVector&&) noexcept = default;
+    RowVector& operator=(RowVector&&) noexcept = default;
+
+    /**
+     * @brief Size the batch to the columns of schema. Every column is a placeholder without data
+     *        until it is replaced with setColumn(). Binding to the schema the batch is already
+     *        bound to only resets it, keeping its columns.
+     */
+    void bind(std::shared_ptr<const BatchSchema> schema) {
+        reset();
+        if (schema_ == schema && columns_.size() == static_cast<size_t>(schema->getColumnCount())) {
+            return;
+        }
+        columns_.clear();
+        for (const ColumnDescriptor& desc : schema->getColumns()) {
+            columns_.emplace_back(desc.columnId, desc.type, nullptr, 0);
+        }
+        schema_ = std::move(schema);
+    }
+
+    /**
+     * @brief Drop the rows and the selection, keeping the columns and their buffers
+     */
+    void reset() noexcept {
+        rowCount_ = 0;
+        selection_ = nullptr;
+    }
+
+    /**
+     * @brief Drop the columns, the rows and the selection. The column storage is kept for reuse.
+     */
+    void clear() noexcept {
+        reset();
+        columns_.clear();
+        schema_.reset();
+    }
+
+    /**
+     * @brief A batch that shares the columns, rows and selection of this one. Only the column
+     *        descriptors are copied, never the data.
+     */
+    RowVector view() const {
+        RowVector result;
+        result.assignView(*this);
+        return result;
+    }
+
+    /**
+     * @brief Make this batch share the columns, rows and selection of other, reusing its storage
+     */
+    void assignView(const RowVector& other) {
+        columns_.assign(other.columns_.begin(), other.columns_.end());
+        schema_ = other.schema_;
+        rowCount_ = other.rowCount_;
+        selection_ = other.selection_;
+    }
+
+    /**
+     * @brief The schema of the batch. Built from the columns if the batch is not bound to one.
+     */
+    const std::shared_ptr<const BatchSchema>& getSchema() const {
+        if (!schema_) {
+            std::vector<ColumnDescriptor> columns;
+            columns.reserve(columns_.size());
+            for (const ColumnBuffer& col : columns_) {
+                columns.push_back({col.columnId, col.type});
+            }
+            schema_ = BatchSchema::make(std::move(columns));
+        }
+        return schema_;
+    }
+
+    /**
+     * @brief Number of physical rows in the columns, including rows that are not selected
+     */
     int64_t getRowCount() const noexcept {
         return rowCount_;
     }
 
+    /**
+     * @brief Restrict the batch to the TRUE rows of the selection. The columns are left untouched,
+     * consumers skip the unselected rows. The selection must stay valid as long as the batch.
+     */
+    void setSelection(const PredicateResultVector* selection) noexcept {
+        tdb_assert(selection == nullptr || selection->size() == rowCount_, "Selection size does not match row count");
+        selection_ = selection;
+    }
+
+    const PredicateResultVector* getSelection() const noexcept {
+        return selection_;
+    }
+
+    bool hasSelection() const noexcept {
+        return selection_ != nullptr;
+    }
+
+    int64_t getSelectedRowCount() const noexcept {
+        return selection_ ? selection_->count() : rowCount_;
+    }
+
+    bool isRowSelected(int64_t row) const noexcept {
+        return !selection_ || selection_->isTrue(row);
+    }
+
+    /**
+     * @brief Index of the first selected row at or after from, getRowCount() if there is none
+     */
+    int64_t nextSelectedRow(int64_t from) const noexcept {
+        if (!selection_) {
+            return std::min(from, rowCount_);
+        }
+        return selection_->nextTrue(from);
+    }
+
+    /**
+     * @brief Call fn(row) for every selected row in ascending order
+     */
+    template<typename Fn>
+    void forEachSelectedRow(Fn&& fn) const {
+        if (selection_) {
+            selection_->forEachTrue(fn);
+        } else {
+            for (int64_t row = 0; row < rowCount_; ++row) {
+                fn(row);
+            }
+        }
+    }
+
+    /**
+     * @brief View of count rows starting at begin, see ColumnBuffer::slice. The batch must not
+     * have a selection.
+     */
+    RowVector slice(int64_t begin, int64_t count) const {
+        tdb_assert(!hasSelection(), "Cannot slice a batch with a selection");
+        tdb_assert(begin >= 0 && begin + count <= rowCount_, "Slice out of range");
+
+        RowVector result;
+        result.columns_.reserve(columns_.size());
+        for (const ColumnBuffer& col : columns_) {
+            result.columns_.push_back(col.slice(begin, count));
+        }
+        result.schema_ = schema_;
+        result.setRowCount(count);
+        return result;
+    }
+
     int64_t getColumnCount() const noexcept {
         return static_cast<int64_t>(columns_.size());
     }
@@ -240,16 +545,22 @@ class RowVector {
     }
 
     const ColumnBuffer& getColumnById(const ColumnId& colId) const {
-        auto it = columnIdToIndex_.find(colId);
-        tdb_assert(it != columnIdToIndex_.end(),
-            "Tried accessing non existing column: " + std::to_string(colId.getId()));
-        return columns_[static_cast<size_t>(it->second)];
+        int64_t index = getColumnIndex(colId);
+        tdb_assert(index != -1, "Tried accessing non existing column: " + std::to_string(colId.getId()));
+        return columns_[static_cast<size_t>(index)];
     }
 
-    int64_t getColumnIndex(const ColumnId& colId) const {
-        auto it = columnIdToIndex_.find(colId);
-        if (it != columnIdToIndex_.end()) {
-            return it->second;
+    /**
+     * @brief Index of the column, -1 if the batch does not contain it
+     */
+    int64_t getColumnIndex(const ColumnId& colId) const noexcept {
+        if (schema_) {
+            return schema_->getColumnIndex(colId);
+        }
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (columns_[i].columnId == colId) {
+                return static_cast<int64_t>(i);
+            }
         }
         return -1;
     }
@@ -259,25 +570,36 @@ class RowVector {
     }
 
     void addColumn(const ColumnBuffer& col) {
-        int64_t index = static_cast<int64_t>(columns_.size());
         columns_.push_back(col);
-        columnIdToIndex_[col.columnId] = index;
+        schema_.reset();
         if (rowCount_ == 0) {
             rowCount_ = col.count;
         }
     }
 
+    /**
+     * @brief Replace the index-th column, e.g. to refill a batch that is reused across calls.
+     *        The schema is kept if the column has the same id and type.
+     */
+    void setColumn(int64_t index, const ColumnBuffer& col) {
+        ColumnBuffer& dst = getColumn(index);
+        if (dst.columnId != col.columnId || dst.type != col.type) {
+            schema_.reset();
+        }
+        dst = col;
+    }
+
     void addOrReplaceColumn(const ColumnBuffer& col) {
         int64_t index = getColumnIndex(col.columnId);
         if (index != -1) {
-            columns_[index] = col;
+            setColumn(index, col);
         } else {
             addColumn(col);
         }
     }
 
     /**
-     * @brief Convert the row vector buffer to a pretty string representation in table format
+     * @brief Convert the selected rows of the buffer to a pretty string representation in table format
      * @param maxRows Maximum number of rows to display (default: 20). Set to -1 for all rows.
      */
     std::string toPrettyString(int64_t maxRows = 20) const {
@@ -292,21 +614,23 @@ class RowVector {
             colWidths.push_back(width);
         }
 
-        // Determine how many rows to display
-        bool truncated = false;
-        int64_t displayRows = rowCount_;
-        if (maxRows >= 0 && rowCount_ > maxRows) {
-            displayRows = maxRows;
-            truncated = true;
+        // Determine which rows to display, unselected rows are skipped
+        int64_t selectedRows = getSelectedRowCount();
+        bool truncated = maxRows >= 0 && selectedRows > maxRows;
+        std::vector<int64_t> displayRows;
+        int64_t displayCount = truncated ? maxRows : selectedRows;
+        for (int64_t row = nextSelectedRow(0); static_cast<int64_t>(displayRows.size()) < displayCount;
+             row = nextSelectedRow(row + 1)) {
+            displayRows.push_back(row);
         }
 
-        // First pass: calculate maximum width for each column
-        for (int64_t row = 0; row < displayRows; ++row) {
+        // First pass: format every value once and calculate maximum width for each column
+        std::vector<std::string> cells;
+        cells.reserve(displayRows.size() * columns_.size());
+        for (int64_t row : displayRows) {
             for (size_t colIdx = 0; colIdx < columns_.size(); ++colIdx) {
-                std::string valueStr = columns_[colIdx].getValueAsString(row);
-                if (valueStr.length() > colWidths[colIdx]) {
-                    colWidths[colIdx] = valueStr.length();
-                }
+                const std::string& valueStr = cells.emplace_back(columns_[colIdx].getValueAsString(row));
+                colWidths[colIdx] = std::max(colWidths[colIdx], valueStr.length());
             }
         }
 
@@ -337,12 +661,13 @@ class RowVector {
         result += "\n";
 
         // Print rows
-        for (int64_t row = 0; row < displayRows; ++row) {
+        for (size_t rowIdx = 0; rowIdx < displayRows.size(); ++rowIdx) {
             result += "|";
             for (size_t colIdx = 0; colIdx < columns_.size(); ++colIdx) {
-                std::string valueStr = columns_[colIdx].getValueAsString(row);
-                result += " " + valueStr;
-                result += std::string(colWidths[colIdx] - valueStr.length() + 1, ' ');
+                const std::string& valueStr = cells[rowIdx * columns_.size() + colIdx];
+                result += ' ';
+                result += valueStr;
+                result.append(colWidths[colIdx] - valueStr.length() + 1, ' ');
                 result += "|";
             }
             result += "\n";
@@ -357,10 +682,10 @@ class RowVector {
             }
             result += "\n";
 
-            std::string truncMsg = "... (" + std::to_string(rowCount_ - maxRows) + " more rows)";
+            std::string truncMsg = "... (" + std::to_string(selectedRows - maxRows) + " more rows)";
             // Ensure message fits in first column width
             if (truncMsg.length() > colWidths[0]) {
-                truncMsg = "... (" + std::to_string(rowCount_ - maxRows) + " more)";
+                truncMsg = "... (" + std::to_string(selectedRows - maxRows) + " more)";
                 if (truncMsg.length() > colWidths[0]) {
                     truncMsg = "...";
                 }
@@ -393,7 +718,31 @@ class RowVector {
 class PhysicalOperator {
     public:
     virtual void initialize() = 0;
+
+    /**
+     * @brief Produce the next batch. The batch stays valid until the next call.
+     * @return Number of selected rows in the batch, 0 once the operator is exhausted
+     */
     virtual int64_t next(RowVector& out) = 0;
+
+    /**
+     * @brief Offer a runtime filter on columns this operator produces, e.g. one a hash join derived
+     * from its build keys. Rows for which it is not TRUE may be dropped early. Must be called before
+     * the first call to next(). Operators that accept it keep a copy.
+     * @return Whether the filter is applied
+     */
+    virtual bool pushRuntimeFilter([[maybe_unused]] const PredicateExpr& filter) {
+        return false;
+    }
+
+    /**
+     * @brief The manager the operator allocates its own buffers from, if it has one. Its counters
+     * are reported by EXPLAIN ANALYZE.
+     */
+    virtual const memory::BufferManager* getBufferManager() const noexcept {
+        return nullptr;
+    }
+
     virtual ~PhysicalOperator() {};
 };
 
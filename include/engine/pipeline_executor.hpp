@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Owns the operators of one worker's copy of a pipeline
+ */
+class OperatorChain {
+private:
+    std::vector<std::unique_ptr<PhysicalOperator>> operators_;
+
+public:
+    template<typename Op, typename... Args>
+    Op* add(Args&&... args) {
+        auto op = std::make_unique<Op>(std::forward<Args>(args)...);
+        Op* result = op.get();
+        operators_.push_back(std::move(op));
+        return result;
+    }
+};
+
+/**
+ * @brief Builds the streaming operators of a pipeline on top of a worker's morsel scan and
+ * returns the root. Called once per worker, so every worker runs on its own operator state.
+ */
+using PipelineFactory = std::function<PhysicalOperator*(PhysicalOperator* source, OperatorChain& chain)>;
+
+/**
+ * @brief End of a pipeline, e.g. the build side of a join or an aggregation.
+ *
+ * Every worker consumes its output into a state of its own, without synchronization. Once all
+ * workers are done, the states are combined on a single thread.
+ */
+class PipelineSink {
+public:
+    struct LocalState {
+        virtual ~LocalState() = default;
+    };
+
+    virtual ~PipelineSink() = default;
+
+    virtual std::unique_ptr<LocalState> createLocalState() = 0;
+
+    /**
+     * @brief Consume the selected rows of a batch. The batch is only valid during the call.
+     */
+    virtual void consume(LocalState& state, const RowVector& batch) = 0;
+
+    virtual void combine(std::vector<std::unique_ptr<LocalState>>& states) = 0;
+};
+
+/**
+ * @brief Collects the output of a pipeline. Every worker fills its own materialized part, the
+ * parts can be read by a later pipeline through a MaterializedMorselSource.
+ */
+class MaterializeSink : public PipelineSink {
+private:
+    struct State : LocalState {
+        MaterializedInput rows;
+
+        explicit State(memory::BufferManager* bufferManager) : rows(bufferManager) {}
+    };
+
+    memory::BufferManager* bufferManager_;
+    std::vector<std::unique_ptr<MaterializedInput>> parts_;
+
+public:
+    explicit MaterializeSink(memory::BufferManager* bufferManager) : bufferManager_(bufferManager) {}
+
+    std::unique_ptr<LocalState> createLocalState() override {
+        return std::make_unique<State>(bufferManager_);
+    }
+
+    void consume(LocalState& state, const RowVector& batch) override {
+        static_cast<State&>(state).rows.append(batch);
+    }
+
+    void combine(std::vector<std::unique_ptr<LocalState>>& states) override {
+        for (auto& state : states) {
+            MaterializedInput& rows = static_cast<State&>(*state).rows;
+            if (rows.getRowCount() > 0) {
+                parts_.push_back(std::make_unique<MaterializedInput>(std::move(rows)));
+            }
+        }
+    }
+
+    std::vector<const MaterializedInput*> getParts() const {
+        std::vector<const MaterializedInput*> parts;
+        for (const auto& part : parts_) {
+            parts.push_back(part.get());
+        }
+        return parts;
+    }
+
+    int64_t getRowCount() const noexcept {
+        int64_t rowCount = 0;
+        for (const auto& part : parts_) {
+            rowCount += part->getRowCount();
+        }
+        return rowCount;
+    }
+};
+
+/**
+ * @brief A source, the streaming operators applied to its morsels, and a sink.
+ */
+struct Pipeline {
+    MorselSource* source = nullptr;
+    // Empty if morsels are passed to the sink unchanged
+    PipelineFactory factory;
+    PipelineSink* sink = nullptr;
+    // Pipelines that must finish before this one starts, e.g. the one reading its source
+    std::vector<const Pipeline*> dependencies;
+};
+
+/**
+ * @brief Runs pipelines with a pool of workers in a morsel-driven fashion.
+ *
+ * Queries are split into pipelines at operators that have to see all of their input before
+ * producing a row, such as join builds and aggregations. Each worker builds its own copy of the
+ * pipeline's operators on top of a MorselScanExec and pulls morsels until the source is
+ * exhausted, stealing from other workers when it runs out. Since the operators only see the
+ * rows of one morsel at a time, the work is balanced at morsel granularity, regardless of how
+ * selective the operators are on different parts of the input.
+ *
+ * The calling thread takes part as worker 0. The first exception of a worker cancels the other
+ * workers and is rethrown once all of them stopped.
+ */
+class PipelineExecutor {
+private:
+    size_t workerCount_;
+    int64_t morselSize_;
+    int64_t stolenMorselCount_ = 0;
+
+public:
+    static constexpr int64_t DEFAULT_MORSEL_SIZE = 1024;
+
+    explicit PipelineExecutor(size_t workerCount = std::thread::hardware_concurrency(),
+                              int64_t morselSize = DEFAULT_MORSEL_SIZE)
+        : workerCount_(std::max<size_t>(workerCount, 1)), morselSize_(morselSize) {}
+
+    size_t getWorkerCount() const noexcept {
+        return workerCount_;
+    }
+
+    /**
+     * @brief Number of morsels stolen from other workers during the last run
+     */
+    int64_t getStolenMorselCount() const noexcept {
+        return stolenMorselCount_;
+    }
+
+    /**
+     * @brief Run the pipelines one after another, each after its dependencies. Dependencies that
+     * are not part of pipelines must have been run before.
+     */
+    void run(const std::vector<Pipeline*>& pipelines) {
+        std::unordered_set<const Pipeline*> pending(pipelines.begin(), pipelines.end());
+        std::unordered_set<const Pipeline*> visiting;
+        int64_t stolen = 0;
+
+        std::function<void(Pipeline*)> visit = [&](Pipeline* pipeline) {
+            if (!pending.contains(pipeline)) {
+                return;
+            }
+            tdb_assert(!visiting.contains(pipeline), "Pipeline dependencies form a cycle");
+            visiting.insert(pipeline);
+            for (const Pipeline* dependency : pipeline->dependencies) {
+                auto it = std::find(pipelines.begin(), pipelines.end(), dependency);
+                if (it != pipelines.end()) {
+                    visit(*it);
+                }
+            }
+            pending.erase(pipeline);
+
+            run(*pipeline);
+            stolen += stolenMorselCount_;
+        };
+
+        for (Pipeline* pipeline : pipelines) {
+            visit(pipeline);
+        }
+        stolenMorselCount_ = stolen;
+    }
+
+    void run(Pipeline& pipeline) {
+        tdb_assert(pipeline.source != nullptr && pipeline.sink != nullptr, "Pipeline needs a source and a sink");
+
+        MorselDispatcher dispatcher(pipeline.source, workerCount_, morselSize_);
+        std::atomic<bool> cancelled = false;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        std::vector<std::unique_ptr<PipelineSink::LocalState>> states;
+        for (size_t i = 0; i < workerCount_; ++i) {
+            states.push_back(pipeline.sink->createLocalState());
+        }
+
+        auto runWorker = [&](size_t worker) {
+            try {
+                MorselScanExec scan(&dispatcher, worker, &cancelled);
+                OperatorChain chain;
+                PhysicalOperator* root = pipeline.factory ? pipeline.factory(&scan, chain) : &scan;
+
+                root->initialize();
+                RowVector batch;
+                while (true) {
+                    if (root->next(batch) == 0) {
+                        break;
+                    }
+                    pipeline.sink->consume(*states[worker], batch);
+                }
+            } catch (...) {
+                std::lock_guard lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                cancelled = true;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workerCount_; ++i) {
+            threads.emplace_back(runWorker, i);
+        }
+        runWorker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        stolenMorselCount_ = dispatcher.getStolenCount();
+        Logger::debug("PipelineExecutor: pipeline finished on {} workers, {} morsels stolen",
+                      workerCount_, stolenMorselCount_);
+
+        pipeline.sink->combine(states);
+    }
+};
+
+}  // namespace toydb
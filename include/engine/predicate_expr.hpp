@@ -1,14 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include "common/data_strucures/bloom_filter.hpp"
 #include "common/logging.hpp"
 #include "common/types.hpp"
+#include "engine/compare_kernels.hpp"
+#include "engine/join_key.hpp"
 #include "engine/physical_operator.hpp"
 #include "engine/predicate_result.hpp"
 
@@ -58,9 +64,21 @@ public:
     virtual ~PredicateExpr() = default;
 
     /**
-     * @brief Evaluate the predicate over a row buffer
+     * @brief Evaluate the predicate over a row buffer into out, which is reset to the rows of the
+     *        buffer. Intermediate results are taken from scratch, which the caller resets per batch.
      */
-    virtual PredicateResultVector evaluate(const RowVector& buffer) const = 0;
+    virtual void evaluateInto(const RowVector& buffer, PredicateResultVector& out, PredicateScratch& scratch) const = 0;
+
+    /**
+     * @brief Evaluate the predicate over a row buffer into a new result. Allocates, operators
+     *        evaluating batches use evaluateInto with buffers they keep.
+     */
+    PredicateResultVector evaluate(const RowVector& buffer) const {
+        PredicateResultVector result;
+        PredicateScratch scratch;
+        evaluateInto(buffer, result, scratch);
+        return result;
+    }
 
     /**
      * @brief Evaluate predicate for a single row (tuple-by-tuple)
@@ -68,6 +86,11 @@ public:
     virtual PredicateValue evaluateRow(
         const RowVector& buffer,
         int64_t rowIndex) const = 0;
+
+    /**
+     * @brief Deep copy of the expression. The index map is not copied, initializeIndexMap() must be called on the copy.
+     */
+    virtual std::unique_ptr<PredicateExpr> clone() const = 0;
 };
 
 /**
@@ -107,17 +130,16 @@ public:
         }
     }
 
-    PredicateResultVector evaluate(const RowVector& buffer) const override {
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out,
+                      [[maybe_unused]] PredicateScratch& scratch) const override {
         tdb_assert(columnIndex_ >= 0, "Column index not initialized. Call initialize() first.");
         const ColumnBuffer& col = buffer.getColumn(columnIndex_);
-        PredicateResultVector result(col.count);
+        out.reset(col.count);
 
         // Evaluate each row
         for (int64_t i = 0; i < col.count; ++i) {
-            result.set(i, evaluateRow(buffer, i));
+            out.set(i, evaluateRow(buffer, i));
         }
-
-        return result;
     }
 
     PredicateValue evaluateRow(
@@ -132,6 +154,10 @@ public:
         }
         return PredicateValue::TRUE;
     }
+
+    std::unique_ptr<PredicateExpr> clone() const override {
+        return std::make_unique<ColumnRefExpr>(columnId_, type_);
+    }
 };
 
 /**
@@ -145,6 +171,8 @@ class ConstantExpr : public PredicateExpr {
         bool boolValue_;
     };
     std::string stringValue_;
+    // Set for the slots of ? placeholders of prepared statements
+    std::optional<size_t> parameterIndex_;
 
     void initializeIndexMap([[maybe_unused]] int32_t* nextIndex = nullptr) override {
         columnIndexMap_.clear();
@@ -158,6 +186,37 @@ public:
     ConstantExpr() : type_(DataType::NULL_CONST) {}
     explicit ConstantExpr(DataType type) : type_(type) {}
 
+    /**
+     * @brief Slot for the value of the index-th ? placeholder of a prepared statement, compared
+     *        as type. Holds zero until a value is bound.
+     */
+    static std::unique_ptr<ConstantExpr> parameter(size_t index, DataType type) {
+        auto slot = std::make_unique<ConstantExpr>(type, int64_t{0});
+        slot->parameterIndex_ = index;
+        return slot;
+    }
+
+    std::optional<size_t> getParameterIndex() const noexcept {
+        return parameterIndex_;
+    }
+
+    /**
+     * @brief Replace the value of a parameter slot by a constant of the slot's type
+     */
+    void bindValue(const ConstantExpr& value) {
+        tdb_assert(parameterIndex_.has_value(), "Only parameter slots can be bound");
+        tdb_assert(value.type_ == type_, "Parameter of type {} bound to a {}", type_.toString(), value.type_.toString());
+        if (type_ == DataType::getDouble()) {
+            doubleValue_ = value.doubleValue_;
+        } else if (type_ == DataType::getBool()) {
+            boolValue_ = value.boolValue_;
+        } else if (type_ == DataType::getString()) {
+            stringValue_ = value.stringValue_;
+        } else {
+            intValue_ = value.intValue_;
+        }
+    }
+
     DataType getType() const noexcept {
         return type_;
     }
@@ -182,27 +241,35 @@ public:
         return type_ == DataType::getNullConst();
     }
 
-    PredicateResultVector evaluate(const RowVector& buffer) const override {
-        int64_t rowCount = buffer.getRowCount();
-        PredicateResultVector result(rowCount);
-
-        if (isNull()) [[unlikely]] {
-            for (int64_t i = 0; i < rowCount; ++i) {
-                result.setAll(PredicateValue::NULL_VALUE);
-            }
-        } else {
-            for (int64_t i = 0; i < rowCount; ++i) {
-                result.setAll(PredicateValue::TRUE);
-            }
+    /**
+     * @brief The constant as a predicate: NULL if it is NULL, the value of booleans, TRUE otherwise
+     */
+    PredicateValue getPredicateValue() const noexcept {
+        if (isNull()) {
+            return PredicateValue::NULL_VALUE;
+        }
+        if (type_ == DataType::getBool() && !boolValue_) {
+            return PredicateValue::FALSE;
         }
+        return PredicateValue::TRUE;
+    }
 
-        return result;
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out,
+                      [[maybe_unused]] PredicateScratch& scratch) const override {
+        out.reset(buffer.getRowCount());
+        out.setAll(getPredicateValue());
     }
 
     PredicateValue evaluateRow(
         [[maybe_unused]] const RowVector& buffer,
         [[maybe_unused]] int64_t rowIndex) const override {
-        return isNull() ? PredicateValue::NULL_VALUE : PredicateValue::TRUE;
+        return getPredicateValue();
+    }
+
+    std::unique_ptr<PredicateExpr> clone() const override {
+        auto copy = std::make_unique<ConstantExpr>(*this);
+        copy->columnIndexMap_.clear();
+        return copy;
     }
 };
 
@@ -224,20 +291,60 @@ public:
         return expr_.get();
     }
 
+    PredicateExpr* getExpr() {
+        return expr_.get();
+    }
+
     void initializeIndexMap(int32_t* nextIndex = nullptr) override {
         expr_->initializeIndexMap(nextIndex);
     }
 
-    PredicateResultVector evaluate(const RowVector& buffer) const override {
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out, PredicateScratch& scratch) const override {
         // TODO: Implement cast
-        return expr_->evaluate(buffer);
+        expr_->evaluateInto(buffer, out, scratch);
     }
 
     PredicateValue evaluateRow(const RowVector& buffer, int64_t rowIndex) const override {
         return expr_->evaluateRow(buffer, rowIndex);
     }
+
+    std::unique_ptr<PredicateExpr> clone() const override {
+        return std::make_unique<CastExpr>(type_, expr_->clone());
+    }
 };
 
+namespace detail {
+
+// Strip casts, statistics and kernels convert the operands to the comparison domain instead
+inline const PredicateExpr* unwrapCast(const PredicateExpr* expr) noexcept {
+    while (const auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+        expr = cast->getExpr();
+    }
+    return expr;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Operand of a comparison kernel holding the value of a constant. String values point into the constant.
+ */
+inline kernels::CompareOperand constantOperand(const ConstantExpr& constant) {
+    kernels::CompareOperand operand;
+    operand.type = constant.getType();
+    if (constant.isNull()) [[unlikely]] {
+        operand.isNullConstant = true;
+    } else if (operand.type == DataType::getDouble()) {
+        operand.doubleValue = constant.getDoubleValue();
+    } else if (operand.type == DataType::getBool()) {
+        operand.intValue = constant.getBoolValue() ? 1 : 0;
+    } else if (operand.type == DataType::getString()) {
+        operand.stringValue = constant.getStringValue();
+    } else {
+        operand.intValue = constant.getIntValue();
+    }
+    return operand;
+}
+
 /**
  * @brief Comparison expression (>, <, =, !=, >=, <=)
  */
@@ -248,121 +355,29 @@ private:
     std::unique_ptr<PredicateExpr> left_;
     std::unique_ptr<PredicateExpr> right_;
 
-    template<typename T>
-    PredicateValue compareValues(T left, T right, bool leftNull, bool rightNull) const {
-        if (leftNull || rightNull) {
-            return PredicateValue::NULL_VALUE;
-        }
-
-        bool result = false;
-        switch (op_) {
-            case CompareOp::EQUAL:
-                result = (left == right);
-                break;
-            case CompareOp::NOT_EQUAL:
-                result = (left != right);
-                break;
-            case CompareOp::GREATER:
-                result = (left > right);
-                break;
-            case CompareOp::LESS:
-                result = (left < right);
-                break;
-            case CompareOp::GREATER_EQUAL:
-                result = (left >= right);
-                break;
-            case CompareOp::LESS_EQUAL:
-                result = (left <= right);
-                break;
-            default:
-                return PredicateValue::NULL_VALUE;
+    /**
+     * @brief Resolve an operand to the column of the buffer or the constant it refers to.
+     *        Casts are applied by the kernels, which convert both operands to the comparison domain.
+     */
+    static kernels::CompareOperand resolveOperand(const PredicateExpr* expr, const RowVector& buffer) {
+        while (auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+            expr = cast->getExpr();
         }
 
-        return result ? PredicateValue::TRUE : PredicateValue::FALSE;
-    }
-    template<typename T>
-    bool extractValue(PredicateExpr* expr, const RowVector& buffer,
-                      int64_t rowIndex, T& value, bool& isNull) const {
-        if (auto* colRef = dynamic_cast<ColumnRefExpr*>(expr)) {
-            // ColumnRefExpr stores its index directly
+        kernels::CompareOperand operand;
+        if (auto* colRef = dynamic_cast<const ColumnRefExpr*>(expr)) {
             int32_t colIdx = colRef->getColumnIndex();
             tdb_assert(colIdx >= 0, "Column index not initialized. Call initializeIndexMap() first.");
-            const ColumnBuffer& col = buffer.getColumn(colIdx);
-
-            // Check null bitmap
-            if (col.isNull(rowIndex)) {
-                isNull = true;
-                return false;
-            }
-
-            // Extract value based on type
-            if constexpr (std::is_same_v<T, int64_t>) {
-                if (col.type == DataType::getInt64()) {
-                    value = col.getEntry<db_int64>(rowIndex);
-                    isNull = false;
-                    return true;
-                }
-            } else if constexpr (std::is_same_v<T, double>) {
-                if (col.type == DataType::getDouble()) {
-                    value = col.getEntry<db_double>(rowIndex);
-                    isNull = false;
-                    return true;
-                }
-            }
-            isNull = true;
-            return false;
-        } else if (auto* constant = dynamic_cast<ConstantExpr*>(expr)) {
-            if (constant->isNull()) [[unlikely]] {
-                isNull = true;
-                return false;
-            }
-
-            if constexpr (std::is_same_v<T, int64_t>) {
-                if (constant->getType() == DataType::getInt64()) {
-                    value = constant->getIntValue();
-                    isNull = false;
-                    return true;
-                }
-            } else if constexpr (std::is_same_v<T, double>) {
-                if (constant->getType() == DataType::getDouble()) {
-                    value = constant->getDoubleValue();
-                    isNull = false;
-                    return true;
-                }
-            }
-            isNull = true;
-            return false;
+            operand.column = &buffer.getColumn(colIdx);
+            operand.type = operand.column->type;
+            return operand;
         }
 
-        tdb_unreachable("Unsupported expression type");
-    }
-
-    PredicateValue evaluateComparison(
-            const RowVector& buffer,
-            int64_t rowIndex) const {
-        // Use the stored type to directly extract and compare values
-        if (type_ == DataType::getInt64()) {
-            int64_t leftInt = 0, rightInt = 0;
-            bool leftNull = false, rightNull = false;
-            bool leftOk = extractValue(left_.get(), buffer, rowIndex, leftInt, leftNull);
-            bool rightOk = extractValue(right_.get(), buffer, rowIndex, rightInt, rightNull);
-
-            if (leftOk && rightOk) {
-                return compareValues(leftInt, rightInt, leftNull, rightNull);
-            }
-        } else if (type_ == DataType::getDouble()) {
-            double leftDouble = 0.0, rightDouble = 0.0;
-            bool leftNull = false, rightNull = false;
-            bool leftOk = extractValue(left_.get(), buffer, rowIndex, leftDouble, leftNull);
-            bool rightOk = extractValue(right_.get(), buffer, rowIndex, rightDouble, rightNull);
-
-            if (leftOk && rightOk) {
-                return compareValues(leftDouble, rightDouble, leftNull, rightNull);
-            }
+        if (auto* constant = dynamic_cast<const ConstantExpr*>(expr)) {
+            return constantOperand(*constant);
         }
 
-        // If either is null or type mismatch, return NULL
-        return PredicateValue::NULL_VALUE;
+        tdb_unreachable("Unsupported expression type");
     }
 
 public:
@@ -385,24 +400,40 @@ public:
         return right_.get();
     }
 
-    PredicateResultVector evaluate(const RowVector& buffer) const override {
+    PredicateExpr* getLeft() {
+        return left_.get();
+    }
+
+    PredicateExpr* getRight() {
+        return right_.get();
+    }
+
+    /**
+     * @brief Evaluate the comparison over the whole batch. Operands are resolved once, then a kernel
+     *        specialized on the operator, the operand types and whether the right operand is constant is run.
+     */
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out,
+                      [[maybe_unused]] PredicateScratch& scratch) const override {
         assertIndexMapValid(buffer);
 
         int64_t rowCount = buffer.getRowCount();
-        PredicateResultVector result(rowCount);
+        out.reset(rowCount);
 
-        // Evaluate comparison for each row
-        for (int64_t i = 0; i < rowCount; ++i) {
-            result.set(i, evaluateComparison(buffer, i));
-        }
-
-        return result;
+        kernels::CompareOperand left = resolveOperand(left_.get(), buffer);
+        kernels::CompareOperand right = resolveOperand(right_.get(), buffer);
+        kernels::compareBatch(op_, kernels::getCompareDomain(type_), left, right, rowCount, out);
     }
 
     PredicateValue evaluateRow(
             const RowVector& buffer,
             int64_t rowIndex) const override {
-        return evaluateComparison(buffer, rowIndex);
+        kernels::CompareOperand left = resolveOperand(left_.get(), buffer);
+        kernels::CompareOperand right = resolveOperand(right_.get(), buffer);
+        return kernels::compareRow(op_, kernels::getCompareDomain(type_), left, right, rowIndex);
+    }
+
+    std::unique_ptr<PredicateExpr> clone() const override {
+        return std::make_unique<CompareExpr>(op_, type_, left_->clone(), right_->clone());
     }
 
     // Must be called before the predicate is evaluated.
@@ -437,6 +468,49 @@ private:
     std::unique_ptr<PredicateExpr> left_;
     std::unique_ptr<PredicateExpr> right_;
 
+    // Evaluating a row resolves the operands again, which costs about as much as running the
+    // batch kernels over a few dozen rows
+    static constexpr double ROW_AT_A_TIME_SELECTIVITY = 1.0 / 32;
+
+    /**
+     * @brief Rows of word w the left result leaves undecided: not FALSE for AND, not TRUE for OR
+     */
+    uint64_t undecidedWord(const PredicateResultVector& left, int64_t w) const noexcept {
+        uint64_t trueBits = left.getTrueWord(w);
+        uint64_t nullBits = left.getNullWord(w);
+        if (op_ == CompareOp::AND) {
+            return trueBits | nullBits;
+        }
+        int64_t remaining = left.size() - w * 64;
+        uint64_t valid = remaining >= 64 ? ~uint64_t{0} : (uint64_t{1} << remaining) - 1;
+        return ~trueBits & valid;
+    }
+
+    /**
+     * @brief Three-valued AND or OR
+     */
+    PredicateValue combine(PredicateValue left, PredicateValue right) const noexcept {
+        if (op_ == CompareOp::AND) {
+            if (left == PredicateValue::FALSE || right == PredicateValue::FALSE) {
+                return PredicateValue::FALSE;
+            }
+            if (left == PredicateValue::NULL_VALUE || right == PredicateValue::NULL_VALUE) {
+                return PredicateValue::NULL_VALUE;
+            }
+            return PredicateValue::TRUE;
+        } else if (op_ == CompareOp::OR) {
+            if (left == PredicateValue::TRUE || right == PredicateValue::TRUE) {
+                return PredicateValue::TRUE;
+            }
+            if (left == PredicateValue::NULL_VALUE || right == PredicateValue::NULL_VALUE) {
+                return PredicateValue::NULL_VALUE;
+            }
+            return PredicateValue::FALSE;
+        }
+
+        return PredicateValue::FALSE;
+    }
+
 public:
     void initializeIndexMap(int32_t* nextIndex = nullptr) override {
         int32_t localIndex = 0;
@@ -474,51 +548,208 @@ public:
         return right_.get();
     }
 
-    PredicateResultVector evaluate(const RowVector& buffer) const override {
+    PredicateExpr* getLeft() {
+        return left_.get();
+    }
+
+    PredicateExpr* getRight() {
+        return right_.get();
+    }
+
+    /**
+     * @brief Evaluate the left operand, then the right one only as far as the result is still
+     *        undecided: not at all if the left operand decided every row (FALSE for AND, TRUE for
+     *        OR), row by row if it left few rows open, over the whole batch otherwise.
+     */
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out, PredicateScratch& scratch) const override {
         assertIndexMapValid(buffer);
-        
-        PredicateResultVector leftResult = left_->evaluate(buffer);
-        PredicateResultVector rightResult = right_->evaluate(buffer);
+
+        left_->evaluateInto(buffer, out, scratch);
+        int64_t rowCount = buffer.getRowCount();
+        int64_t undecided = 0;
+        for (int64_t w = 0; w < out.wordCount(); ++w) {
+            undecided += std::popcount(undecidedWord(out, w));
+        }
+        if (undecided == 0) {
+            return;
+        }
+
+        if (static_cast<double>(undecided) <= ROW_AT_A_TIME_SELECTIVITY * static_cast<double>(rowCount)) {
+            for (int64_t w = 0; w < out.wordCount(); ++w) {
+                for (uint64_t word = undecidedWord(out, w); word != 0; word &= word - 1) {
+                    int64_t row = w * 64 + std::countr_zero(word);
+                    out.set(row, combine(out.get(row), right_->evaluateRow(buffer, row)));
+                }
+            }
+            return;
+        }
+
+        PredicateResultVector& rightResult = scratch.acquire(rowCount);
+        right_->evaluateInto(buffer, rightResult, scratch);
 
         if (op_ == CompareOp::AND) {
-            leftResult.combineAnd(rightResult);
-            return leftResult;
+            out.combineAnd(rightResult);
         } else if (op_ == CompareOp::OR) {
-            leftResult.combineOr(rightResult);
-            return leftResult;
+            out.combineOr(rightResult);
         }
-
-        return leftResult;
     }
 
     PredicateValue evaluateRow(
         const RowVector& buffer,
         int64_t rowIndex) const override {
         PredicateValue leftVal = left_->evaluateRow(buffer, rowIndex);
-        PredicateValue rightVal = right_->evaluateRow(buffer, rowIndex);
+        if ((op_ == CompareOp::AND && leftVal == PredicateValue::FALSE) ||
+            (op_ == CompareOp::OR && leftVal == PredicateValue::TRUE)) {
+            return leftVal;
+        }
+        return combine(leftVal, right_->evaluateRow(buffer, rowIndex));
+    }
 
-        if (op_ == CompareOp::AND) {
-            // Three-valued AND logic
-            if (leftVal == PredicateValue::FALSE || rightVal == PredicateValue::FALSE) {
-                return PredicateValue::FALSE;
-            }
-            if (leftVal == PredicateValue::NULL_VALUE || rightVal == PredicateValue::NULL_VALUE) {
-                return PredicateValue::NULL_VALUE;
-            }
-            return PredicateValue::TRUE;
-        } else if (op_ == CompareOp::OR) {
-            // Three-valued OR logic
-            if (leftVal == PredicateValue::TRUE || rightVal == PredicateValue::TRUE) {
-                return PredicateValue::TRUE;
-            }
-            if (leftVal == PredicateValue::NULL_VALUE || rightVal == PredicateValue::NULL_VALUE) {
-                return PredicateValue::NULL_VALUE;
+    std::unique_ptr<PredicateExpr> clone() const override {
+        return std::make_unique<LogicalExpr>(op_, left_->clone(), right_->clone());
+    }
+};
+
+/**
+ * @brief Membership test of a key column in a Bloom filter: FALSE if the key is not in the
+ *        filter, TRUE if it may be, NULL for NULL keys. Keys are hashed in the given join key
+ *        domain. Hash joins publish the filter of their build keys as a runtime filter.
+ *
+ * Integral keys can come with the exact set of keys the filter was built from. It is not
+ * evaluated, but lets scans look the keys up in a secondary index (see getIndexKeys).
+ */
+class BloomFilterExpr : public PredicateExpr {
+private:
+    std::unique_ptr<ColumnRefExpr> key_;
+    JoinKeyDomain domain_;
+    std::shared_ptr<const BlockedBloomFilter> filter_;
+    // Distinct keys ascending, null if not known
+    std::shared_ptr<const std::vector<int64_t>> keys_;
+
+public:
+    BloomFilterExpr(std::unique_ptr<ColumnRefExpr> key, JoinKeyDomain domain,
+                    std::shared_ptr<const BlockedBloomFilter> filter,
+                    std::shared_ptr<const std::vector<int64_t>> keys = nullptr)
+        : key_(std::move(key)), domain_(domain), filter_(std::move(filter)), keys_(std::move(keys)) {}
+
+    const ColumnRefExpr* getKey() const {
+        return key_.get();
+    }
+
+    /**
+     * @return The distinct keys of the filter ascending, nullptr if not known
+     */
+    const std::vector<int64_t>* getKeys() const noexcept {
+        return keys_.get();
+    }
+
+    void initializeIndexMap(int32_t* nextIndex = nullptr) override {
+        key_->initializeIndexMap(nextIndex);
+        columnIndexMap_ = key_->getColumnIndexMap();
+    }
+
+    void evaluateInto(const RowVector& buffer, PredicateResultVector& out,
+                      [[maybe_unused]] PredicateScratch& scratch) const override {
+        assertIndexMapValid(buffer);
+        const ColumnBuffer& col = buffer.getColumn(key_->getColumnIndex());
+        int64_t rowCount = buffer.getRowCount();
+        out.reset(rowCount);
+
+        uint64_t hashes[64];
+        for (int64_t w = 0; w < out.wordCount(); ++w) {
+            int64_t begin = w * 64;
+            int64_t end = std::min(begin + 64, rowCount);
+            uint64_t trueBits = 0;
+            uint64_t nullBits = 0;
+            hashJoinKeys(domain_, col, begin, end - begin, hashes);
+            for (int64_t row = begin; row < end; ++row) {
+                uint64_t bit = uint64_t{1} << (row - begin);
+                if (col.isNull(row)) {
+                    nullBits |= bit;
+                } else if (filter_->mayContain(hashes[row - begin])) {
+                    trueBits |= bit;
+                }
             }
-            return PredicateValue::FALSE;
+            out.setWord(w, trueBits, nullBits);
         }
+    }
 
-        return PredicateValue::FALSE;
+    PredicateValue evaluateRow(const RowVector& buffer, int64_t rowIndex) const override {
+        const ColumnBuffer& col = buffer.getColumn(key_->getColumnIndex());
+        if (col.isNull(rowIndex)) {
+            return PredicateValue::NULL_VALUE;
+        }
+        return filter_->mayContain(hashJoinKey(domain_, col, rowIndex)) ? PredicateValue::TRUE
+                                                                          : PredicateValue::FALSE;
+    }
+
+    std::unique_ptr<PredicateExpr> clone() const override {
+        return std::make_unique<BloomFilterExpr>(
+            std::make_unique<ColumnRefExpr>(key_->getColumnId(), key_->getType()), domain_, filter_, keys_);
     }
 };
 
+/**
+ * @brief Collect the column references of an expression in post-order. Once the index map was
+ *        initialized, the i-th reference has index i. A column referenced twice is collected twice.
+ */
+inline void collectColumnRefs(const PredicateExpr* expr, std::vector<const ColumnRefExpr*>& out) {
+    if (auto* colRef = dynamic_cast<const ColumnRefExpr*>(expr)) {
+        out.push_back(colRef);
+    } else if (auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+        collectColumnRefs(cast->getExpr(), out);
+    } else if (auto* compare = dynamic_cast<const CompareExpr*>(expr)) {
+        collectColumnRefs(compare->getLeft(), out);
+        collectColumnRefs(compare->getRight(), out);
+    } else if (auto* logical = dynamic_cast<const LogicalExpr*>(expr)) {
+        collectColumnRefs(logical->getLeft(), out);
+        collectColumnRefs(logical->getRight(), out);
+    } else if (auto* bloom = dynamic_cast<const BloomFilterExpr*>(expr)) {
+        out.push_back(bloom->getKey());
+    }
+}
+
+/**
+ * @brief Append copies of the conjuncts of a predicate to out, the operands of its top-level ANDs
+ */
+inline void splitConjuncts(const PredicateExpr* predicate, std::vector<std::unique_ptr<PredicateExpr>>& out) {
+    if (auto* logical = dynamic_cast<const LogicalExpr*>(predicate); logical && logical->getOp() == CompareOp::AND) {
+        splitConjuncts(logical->getLeft(), out);
+        splitConjuncts(logical->getRight(), out);
+        return;
+    }
+    out.push_back(predicate->clone());
+}
+
+/**
+ * @brief AND of the conjuncts, evaluated in their order
+ */
+inline std::unique_ptr<PredicateExpr> combineConjuncts(std::vector<std::unique_ptr<PredicateExpr>> conjuncts) {
+    tdb_assert(!conjuncts.empty(), "Cannot combine an empty list of conjuncts");
+    std::unique_ptr<PredicateExpr> result = std::move(conjuncts[0]);
+    for (size_t i = 1; i < conjuncts.size(); ++i) {
+        result = std::make_unique<LogicalExpr>(CompareOp::AND, std::move(result), std::move(conjuncts[i]));
+    }
+    return result;
+}
+
+/**
+ * @brief Collect the parameter slots of an expression (see ConstantExpr::parameter)
+ */
+inline void collectParameters(PredicateExpr* expr, std::vector<ConstantExpr*>& out) {
+    if (auto* constant = dynamic_cast<ConstantExpr*>(expr)) {
+        if (constant->getParameterIndex()) {
+            out.push_back(constant);
+        }
+    } else if (auto* cast = dynamic_cast<CastExpr*>(expr)) {
+        collectParameters(cast->getExpr(), out);
+    } else if (auto* compare = dynamic_cast<CompareExpr*>(expr)) {
+        collectParameters(compare->getLeft(), out);
+        collectParameters(compare->getRight(), out);
+    } else if (auto* logical = dynamic_cast<LogicalExpr*>(expr)) {
+        collectParameters(logical->getLeft(), out);
+        collectParameters(logical->getRight(), out);
+    }
+}
+
 } // namespace toydb
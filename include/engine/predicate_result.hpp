@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
-#include <cstring>
+#include "common/simd_kernels.hpp"
 
 namespace toydb {
 
@@ -20,70 +24,134 @@ enum class PredicateValue : uint8_t {
 /**
  * @brief Bitmask-based predicate result implementation
  *
- * Stores predicate evaluation results as a bitmask where each row
- * can be true, false, or null. Uses two bits per row to represent
- * three states.
+ * Stores predicate evaluation results as two bit-planes with 64 rows per word: a TRUE plane and
+ * a NULL plane. A row is NULL if its null bit is set, TRUE if its true bit is set and FALSE otherwise.
+ * The true bit of a NULL row and all bits past size() are always zero, so three-valued logic and
+ * counting run as whole-word bitwise operations.
  */
 class BitmaskResult {
 private:
-    std::vector<uint8_t> bits_;  // Packed bits: 2 bits per row
+    std::vector<uint64_t> true_;
+    std::vector<uint64_t> null_;
     int64_t size_;
 
-    static constexpr uint8_t TRUE_MASK = 0x01;
-    static constexpr uint8_t NULL_MASK = 0x02;
+    static constexpr int64_t WORD_BITS = 64;
 
-    void setBit(int64_t index, uint8_t mask, bool value) noexcept {
-        int64_t byteIdx = index / 4;
-        int64_t bitOffset = (index % 4) * 2;
+    static int64_t wordCountFor(int64_t size) noexcept {
+        return (size + WORD_BITS - 1) / WORD_BITS;
+    }
 
-        if (value) {
-            bits_[byteIdx] |= (mask << bitOffset);
-        } else {
-            bits_[byteIdx] &= ~(mask << bitOffset);
+    // Mask of the valid rows in word wordIndex
+    uint64_t validMask(int64_t wordIndex) const noexcept {
+        int64_t remaining = size_ - wordIndex * WORD_BITS;
+        if (remaining >= WORD_BITS) {
+            return ~uint64_t{0};
         }
+        return remaining <= 0 ? 0 : (uint64_t{1} << remaining) - 1;
+    }
+
+    static uint64_t bitFor(int64_t index) noexcept {
+        return uint64_t{1} << (index % WORD_BITS);
     }
 
-    bool getBit(int64_t index, uint8_t mask) const noexcept {
-        int64_t byteIdx = index / 4;
-        int64_t bitOffset = (index % 4) * 2;
-        return (bits_[byteIdx] & (mask << bitOffset)) != 0;
+    /**
+     * @brief Apply fn(trueA, nullA, trueB, nullB) -> {true, null} to the words shared with other,
+     * starting at word from. Rows of this result past other.size() are left unchanged.
+     */
+    template<typename Fn>
+    void combineWords(const BitmaskResult& other, int64_t from, Fn fn) noexcept {
+        int64_t words = wordCountFor(std::min(size_, other.size_));
+        for (int64_t w = from; w < words; ++w) {
+            size_t i = static_cast<size_t>(w);
+            auto [t, n] = fn(true_[i], null_[i], other.true_[i], other.null_[i]);
+
+            uint64_t mask = other.validMask(w) & validMask(w);
+            true_[i] = (true_[i] & ~mask) | (t & mask);
+            null_[i] = (null_[i] & ~mask) | (n & mask);
+        }
+    }
+
+    /**
+     * @brief Words in which every row is valid in both results, they are combined by the
+     *        vectorized kernels and need no masking
+     */
+    int64_t sharedFullWords(const BitmaskResult& other) const noexcept {
+        return std::min(size_, other.size_) / WORD_BITS;
     }
 
 public:
     explicit BitmaskResult(int64_t size) : size_(size) {
-        // 2 bits per row, 4 rows per byte
-        int64_t bytesNeeded = (size + 3) / 4;
-        bits_.resize(bytesNeeded, 0);
+        true_.resize(static_cast<size_t>(wordCountFor(size)), 0);
+        null_.resize(static_cast<size_t>(wordCountFor(size)), 0);
+    }
+
+    /**
+     * @brief Resize to size rows, all FALSE. Allocates only if the result grows beyond its capacity.
+     */
+    void reset(int64_t size) {
+        size_ = size;
+        true_.assign(static_cast<size_t>(wordCountFor(size)), 0);
+        null_.assign(static_cast<size_t>(wordCountFor(size)), 0);
     }
 
     int64_t size() const noexcept {
         return size_;
     }
 
+    int64_t wordCount() const noexcept {
+        return static_cast<int64_t>(true_.size());
+    }
+
+    /**
+     * @brief TRUE bits of the 64 rows starting at wordIndex * 64
+     */
+    uint64_t getTrueWord(int64_t wordIndex) const noexcept {
+        return true_[static_cast<size_t>(wordIndex)];
+    }
+
+    /**
+     * @brief NULL bits of the 64 rows starting at wordIndex * 64
+     */
+    uint64_t getNullWord(int64_t wordIndex) const noexcept {
+        return null_[static_cast<size_t>(wordIndex)];
+    }
+
+    /**
+     * @brief The TRUE plane, for kernels that write whole words. Callers must restore the
+     *        invariants afterwards, e.g. by passing every word through setWord.
+     */
+    uint64_t* getTrueWords() noexcept {
+        return true_.data();
+    }
+
     void setTrue(int64_t index) noexcept {
-        setBit(index, TRUE_MASK, true);
-        setBit(index, NULL_MASK, false);
+        size_t w = static_cast<size_t>(index / WORD_BITS);
+        true_[w] |= bitFor(index);
+        null_[w] &= ~bitFor(index);
     }
 
     void setFalse(int64_t index) noexcept {
-        setBit(index, TRUE_MASK, false);
-        setBit(index, NULL_MASK, false);
+        size_t w = static_cast<size_t>(index / WORD_BITS);
+        true_[w] &= ~bitFor(index);
+        null_[w] &= ~bitFor(index);
     }
 
     void setNull(int64_t index) noexcept {
-        setBit(index, TRUE_MASK, false);
-        setBit(index, NULL_MASK, true);
+        size_t w = static_cast<size_t>(index / WORD_BITS);
+        true_[w] &= ~bitFor(index);
+        null_[w] |= bitFor(index);
     }
 
     PredicateValue get(int64_t index) const noexcept {
-        if (getBit(index, NULL_MASK)) {
+        size_t w = static_cast<size_t>(index / WORD_BITS);
+        if (null_[w] & bitFor(index)) {
             return PredicateValue::NULL_VALUE;
         }
-        return getBit(index, TRUE_MASK) ? PredicateValue::TRUE : PredicateValue::FALSE;
+        return (true_[w] & bitFor(index)) ? PredicateValue::TRUE : PredicateValue::FALSE;
     }
 
     bool isTrue(int64_t index) const noexcept {
-        return get(index) == PredicateValue::TRUE;
+        return (true_[static_cast<size_t>(index / WORD_BITS)] & bitFor(index)) != 0;
     }
 
     bool isFalse(int64_t index) const noexcept {
@@ -91,7 +159,7 @@ public:
     }
 
     bool isNull(int64_t index) const noexcept {
-        return get(index) == PredicateValue::NULL_VALUE;
+        return (null_[static_cast<size_t>(index / WORD_BITS)] & bitFor(index)) != 0;
     }
 
     /**
@@ -99,10 +167,8 @@ public:
      */
     int64_t count() const noexcept {
         int64_t cnt = 0;
-        for (int64_t i = 0; i < size_; ++i) {
-            if (isTrue(i)) {
-                ++cnt;
-            }
+        for (uint64_t word : true_) {
+            cnt += std::popcount(word);
         }
         return cnt;
     }
@@ -111,62 +177,34 @@ public:
      * @brief Combine with another result using AND logic (three-valued)
      */
     void combineAnd(const BitmaskResult& other) noexcept {
-        for (int64_t i = 0; i < size_ && i < other.size_; ++i) {
-            PredicateValue left = get(i);
-            PredicateValue right = other.get(i);
-
-            // Three-valued AND logic
-            if (left == PredicateValue::FALSE || right == PredicateValue::FALSE) {
-                setFalse(i);
-            } else if (left == PredicateValue::NULL_VALUE || right == PredicateValue::NULL_VALUE) {
-                setNull(i);
-            } else {
-                setTrue(i);
-            }
-        }
+        int64_t full = sharedFullWords(other);
+        simd::getKernels().combineAnd(true_.data(), null_.data(), other.true_.data(), other.null_.data(), full);
+        combineWords(other, full, [](uint64_t ta, uint64_t na, uint64_t tb, uint64_t nb) {
+            simd::scalar::combineAnd(ta, na, tb, nb);
+            return std::pair{ta, na};
+        });
     }
 
     /**
      * @brief Combine with another result using OR logic (three-valued)
      */
     void combineOr(const BitmaskResult& other) noexcept {
-        for (int64_t i = 0; i < size_ && i < other.size_; ++i) {
-            PredicateValue left = get(i);
-            PredicateValue right = other.get(i);
-
-            // Three-valued OR logic
-            if (left == PredicateValue::TRUE || right == PredicateValue::TRUE) {
-                setTrue(i);
-            } else if (left == PredicateValue::NULL_VALUE || right == PredicateValue::NULL_VALUE) {
-                setNull(i);
-            } else {
-                setFalse(i);
-            }
-        }
+        int64_t full = sharedFullWords(other);
+        simd::getKernels().combineOr(true_.data(), null_.data(), other.true_.data(), other.null_.data(), full);
+        combineWords(other, full, [](uint64_t ta, uint64_t na, uint64_t tb, uint64_t nb) {
+            simd::scalar::combineOr(ta, na, tb, nb);
+            return std::pair{ta, na};
+        });
     }
 
     /**
-     * @brief Create a new result by combining this and other with AND
+     * @brief Negate using three-valued logic: NOT NULL is NULL
      */
-    BitmaskResult andResult(const BitmaskResult& other) const {
-        BitmaskResult result(size_);
-        for (int64_t i = 0; i < size_; ++i) {
-            result.set(i, get(i));
+    void negate() noexcept {
+        for (int64_t w = 0; w < wordCount(); ++w) {
+            size_t i = static_cast<size_t>(w);
+            true_[i] = ~true_[i] & ~null_[i] & validMask(w);
         }
-        result.combineAnd(other);
-        return result;
-    }
-
-    /**
-     * @brief Create a new result by combining this and other with OR
-     */
-    BitmaskResult orResult(const BitmaskResult& other) const {
-        BitmaskResult result(size_);
-        for (int64_t i = 0; i < size_; ++i) {
-            result.set(i, get(i));
-        }
-        result.combineOr(other);
-        return result;
     }
 
     void set(int64_t index, PredicateValue value) noexcept {
@@ -184,49 +222,174 @@ public:
     }
 
     void setAll(PredicateValue value) noexcept {
-        for (int64_t i = 0; i < size_; ++i) {
-            set(i, value);
+        for (int64_t w = 0; w < wordCount(); ++w) {
+            size_t i = static_cast<size_t>(w);
+            true_[i] = value == PredicateValue::TRUE ? validMask(w) : 0;
+            null_[i] = value == PredicateValue::NULL_VALUE ? validMask(w) : 0;
+        }
+    }
+
+    /**
+     * @brief Set the 64 rows starting at wordIndex * 64 at once. Bit i of the words refers to row
+     * wordIndex * 64 + i. Rows with the null bit set are NULL regardless of the true bit, bits past
+     * the end of the result are ignored.
+     */
+    void setWord(int64_t wordIndex, uint64_t trueBits, uint64_t nullBits) noexcept {
+        if (wordIndex >= wordCount()) {
+            return;
+        }
+        uint64_t mask = validMask(wordIndex);
+        null_[static_cast<size_t>(wordIndex)] = nullBits & mask;
+        true_[static_cast<size_t>(wordIndex)] = trueBits & ~nullBits & mask;
+    }
+};
+
+/**
+ * @brief Sparse predicate result: the ascending indices of the rows that evaluated to TRUE
+ */
+class SelectionVector {
+private:
+    std::vector<uint32_t> indices_;
+
+public:
+    SelectionVector() = default;
+
+    /**
+     * @brief Collect the TRUE rows of a bitmask, one word at a time
+     */
+    static SelectionVector fromBitmask(const BitmaskResult& bitmask) {
+        SelectionVector selection;
+        selection.assign(bitmask);
+        return selection;
+    }
+
+    /**
+     * @brief Replace the indices by the TRUE rows of a bitmask, reusing the storage
+     */
+    void assign(const BitmaskResult& bitmask) {
+        indices_.clear();
+        indices_.reserve(static_cast<size_t>(bitmask.count()));
+        for (int64_t w = 0; w < bitmask.wordCount(); ++w) {
+            uint64_t word = bitmask.getTrueWord(w);
+            while (word != 0) {
+                int bit = std::countr_zero(word);
+                indices_.push_back(static_cast<uint32_t>(w * 64 + bit));
+                word &= word - 1;
+            }
         }
     }
+
+    int64_t size() const noexcept {
+        return static_cast<int64_t>(indices_.size());
+    }
+
+    bool empty() const noexcept {
+        return indices_.empty();
+    }
+
+    int64_t operator[](int64_t index) const noexcept {
+        return indices_[static_cast<size_t>(index)];
+    }
+
+    const uint32_t* data() const noexcept {
+        return indices_.data();
+    }
+
+    void push_back(int64_t row) {
+        indices_.push_back(static_cast<uint32_t>(row));
+    }
+
+    void clear() noexcept {
+        indices_.clear();
+    }
 };
 
 /**
  * @brief Type-erased predicate result abstraction
  *
- * Can represent either bitmask or selection vector (future).
- * Currently uses BitmaskResult as the concrete implementation.
+ * Results are always computed as a BitmaskResult. adaptRepresentation() additionally derives a
+ * SelectionVector when few rows are TRUE, so consumers can iterate the matches without scanning
+ * the bitmask. Any modification invalidates the selection vector again. Both keep their storage
+ * when the result is reset, so a result reused across batches stops allocating once it has grown
+ * to the batch size.
  */
 class PredicateResultVector {
 private:
     BitmaskResult bitmask_;
+    // Derived from bitmask_ on demand, valid if hasSelection_ is set
+    mutable SelectionVector selection_;
+    mutable bool hasSelection_ = false;
 
 public:
+    // Results with at most this fraction of TRUE rows switch to a selection vector
+    static constexpr double SPARSE_SELECTIVITY = 0.25;
+
+    PredicateResultVector() : bitmask_(0) {}
+
     explicit PredicateResultVector(int64_t size) : bitmask_(size) {}
 
+    /**
+     * @brief Resize to size rows, all FALSE, reusing the storage
+     */
+    void reset(int64_t size) {
+        hasSelection_ = false;
+        bitmask_.reset(size);
+    }
+
     int64_t size() const noexcept {
         return bitmask_.size();
     }
 
     void setTrue(int64_t index) noexcept {
+        hasSelection_ = false;
         bitmask_.setTrue(index);
     }
 
     void setFalse(int64_t index) noexcept {
+        hasSelection_ = false;
         bitmask_.setFalse(index);
     }
 
     void setNull(int64_t index) noexcept {
+        hasSelection_ = false;
         bitmask_.setNull(index);
     }
 
     void set(int64_t index, PredicateValue value) noexcept {
+        hasSelection_ = false;
         bitmask_.set(index, value);
     }
 
     void setAll(PredicateValue value) noexcept {
+        hasSelection_ = false;
         bitmask_.setAll(value);
     }
 
+    void setWord(int64_t wordIndex, uint64_t trueBits, uint64_t nullBits) noexcept {
+        hasSelection_ = false;
+        bitmask_.setWord(wordIndex, trueBits, nullBits);
+    }
+
+    /**
+     * @brief See BitmaskResult::getTrueWords
+     */
+    uint64_t* getTrueWords() noexcept {
+        hasSelection_ = false;
+        return bitmask_.getTrueWords();
+    }
+
+    int64_t wordCount() const noexcept {
+        return bitmask_.wordCount();
+    }
+
+    uint64_t getTrueWord(int64_t wordIndex) const noexcept {
+        return bitmask_.getTrueWord(wordIndex);
+    }
+
+    uint64_t getNullWord(int64_t wordIndex) const noexcept {
+        return bitmask_.getNullWord(wordIndex);
+    }
+
     PredicateValue get(int64_t index) const noexcept {
         return bitmask_.get(index);
     }
@@ -244,28 +407,125 @@ public:
     }
 
     int64_t count() const noexcept {
-        return bitmask_.count();
+        return hasSelection_ ? selection_.size() : bitmask_.count();
+    }
+
+    /**
+     * @brief Index of the first TRUE row at or after from, size() if there is none
+     */
+    int64_t nextTrue(int64_t from) const noexcept {
+        if (from >= size()) {
+            return size();
+        }
+
+        int64_t w = from / 64;
+        uint64_t word = bitmask_.getTrueWord(w) & (~uint64_t{0} << (from % 64));
+        while (word == 0) {
+            if (++w >= wordCount()) {
+                return size();
+            }
+            word = bitmask_.getTrueWord(w);
+        }
+        return w * 64 + std::countr_zero(word);
+    }
+
+    /**
+     * @brief Call fn(row) for every TRUE row in ascending order
+     */
+    template<typename Fn>
+    void forEachTrue(Fn&& fn) const {
+        if (hasSelection_) {
+            for (int64_t i = 0; i < selection_.size(); ++i) {
+                fn(selection_[i]);
+            }
+            return;
+        }
+
+        for (int64_t w = 0; w < wordCount(); ++w) {
+            uint64_t word = bitmask_.getTrueWord(w);
+            while (word != 0) {
+                fn(w * 64 + std::countr_zero(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    /**
+     * @brief Derive a selection vector if at most maxSelectivity of the rows are TRUE
+     * @return Whether the result now has a selection vector
+     */
+    bool adaptRepresentation(double maxSelectivity = SPARSE_SELECTIVITY) {
+        if (!hasSelection_ && static_cast<double>(bitmask_.count()) <= maxSelectivity * static_cast<double>(size())) {
+            selection_.assign(bitmask_);
+            hasSelection_ = true;
+        }
+        return hasSelection_;
+    }
+
+    bool hasSelectionVector() const noexcept {
+        return hasSelection_;
+    }
+
+    /**
+     * @brief The selection vector of the TRUE rows, derived on first use if necessary
+     */
+    const SelectionVector& getSelectionVector() const {
+        if (!hasSelection_) {
+            selection_.assign(bitmask_);
+            hasSelection_ = true;
+        }
+        return selection_;
     }
 
     void combineAnd(const PredicateResultVector& other) noexcept {
+        hasSelection_ = false;
         bitmask_.combineAnd(other.bitmask_);
     }
 
     void combineOr(const PredicateResultVector& other) noexcept {
+        hasSelection_ = false;
         bitmask_.combineOr(other.bitmask_);
     }
 
-    PredicateResultVector andResult(const PredicateResultVector& other) const {
-        PredicateResultVector result(size());
-        result.bitmask_ = bitmask_.andResult(other.bitmask_);
-        return result;
+    void negate() noexcept {
+        hasSelection_ = false;
+        bitmask_.negate();
     }
+};
 
-    PredicateResultVector orResult(const PredicateResultVector& other) const {
-        PredicateResultVector result(size());
-        result.bitmask_ = bitmask_.orResult(other.bitmask_);
+/**
+ * @brief Arena of the intermediate results of a predicate tree. It is reset before every batch
+ * and hands out the same results again, so evaluation only allocates while the arena grows to
+ * the tree's depth and the batch size. Results stay valid until the next reset.
+ */
+class PredicateScratch {
+private:
+    std::vector<std::unique_ptr<PredicateResultVector>> results_;
+    size_t used_ = 0;
+
+public:
+    /**
+     * @brief An all-FALSE result of size rows
+     */
+    PredicateResultVector& acquire(int64_t size) {
+        if (used_ == results_.size()) {
+            results_.push_back(std::make_unique<PredicateResultVector>());
+        }
+        PredicateResultVector& result = *results_[used_++];
+        result.reset(size);
         return result;
     }
+
+    void reset() noexcept {
+        used_ = 0;
+    }
+
+    /**
+     * @brief Results allocated so far
+     */
+    size_t getResultCount() const noexcept {
+        return results_.size();
+    }
 };
 
 } // namespace toydb
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Hardware events counted on the CPU
+ */
+struct HardwareCounters {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+
+    HardwareCounters& operator+=(const HardwareCounters& other) noexcept {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        cacheMisses += other.cacheMisses;
+        branchMisses += other.branchMisses;
+        return *this;
+    }
+
+    friend HardwareCounters operator-(HardwareCounters left, const HardwareCounters& right) noexcept {
+        left.cycles -= right.cycles;
+        left.instructions -= right.instructions;
+        left.cacheMisses -= right.cacheMisses;
+        left.branchMisses -= right.branchMisses;
+        return left;
+    }
+};
+
+/**
+ * @brief Counts the hardware events of the thread that opened it with perf_event_open. Events the
+ * CPU does not support stay 0.
+ */
+class HardwareCounterGroup {
+private:
+    // The first descriptor leads the group, all events are read at once through it
+    std::vector<int> fds_;
+    // Field of HardwareCounters each event of the group is read into
+    std::vector<uint64_t HardwareCounters::*> fields_;
+
+    HardwareCounterGroup() = default;
+
+public:
+    HardwareCounterGroup(const HardwareCounterGroup&) = delete;
+    HardwareCounterGroup& operator=(const HardwareCounterGroup&) = delete;
+
+    ~HardwareCounterGroup();
+
+    /**
+     * @return nullptr if not on Linux or perf events are not permitted (see perf_event_paranoid)
+     */
+    static std::unique_ptr<HardwareCounterGroup> open();
+
+    /**
+     * @brief Events counted since the group was opened
+     */
+    HardwareCounters read() const noexcept;
+};
+
+/**
+ * @brief What an operator did during its calls to next(). Times and counters include the calls to
+ * its inputs.
+ */
+struct OperatorProfile {
+    int64_t calls = 0;
+    // Calls that produced rows
+    int64_t batches = 0;
+    int64_t rowsOut = 0;
+    std::chrono::nanoseconds wallTime {0};
+    // CPU time of the calling thread, work of scan threads is not included
+    std::chrono::nanoseconds cpuTime {0};
+    // From the operator's own BufferManager
+    size_t bytesAllocated = 0;
+    size_t peakBytes = 0;
+    std::optional<HardwareCounters> counters;
+};
+
+/**
+ * @brief Forwards to an operator and records the OperatorProfile of its calls to next().
+ *
+ * The PhysicalPlanner only puts it above every operator when profiling is enabled, plans without
+ * it run unchanged. The counters, if any, must have been opened by the thread calling next().
+ */
+class ProfilingExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    const HardwareCounterGroup* counters_;
+    OperatorProfile profile_;
+
+    static std::chrono::nanoseconds threadCpuTime() noexcept;
+
+public:
+    ProfilingExec(PhysicalOperator* input, const HardwareCounterGroup* counters)
+        : input_(input), counters_(counters) {
+        if (counters_) {
+            profile_.counters.emplace();
+        }
+    }
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    int64_t next(RowVector& out) override {
+        HardwareCounters countersBefore = counters_ ? counters_->read() : HardwareCounters();
+        std::chrono::nanoseconds cpuBefore = threadCpuTime();
+        auto wallBefore = std::chrono::steady_clock::now();
+
+        int64_t rows = input_->next(out);
+
+        profile_.wallTime += std::chrono::steady_clock::now() - wallBefore;
+        profile_.cpuTime += threadCpuTime() - cpuBefore;
+        if (counters_) {
+            *profile_.counters += counters_->read() - countersBefore;
+        }
+
+        profile_.calls++;
+        if (rows > 0) {
+            profile_.batches++;
+            profile_.rowsOut += rows;
+        }
+        if (const memory::BufferManager* bufferManager = input_->getBufferManager()) {
+            profile_.bytesAllocated = bufferManager->getTotalAllocatedBytes();
+            profile_.peakBytes = bufferManager->getPeakAllocatedBytes();
+        }
+        return rows;
+    }
+
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        return input_->pushRuntimeFilter(filter);
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return input_->getBufferManager();
+    }
+
+    const OperatorProfile& getProfile() const noexcept {
+        return profile_;
+    }
+
+    PhysicalOperator* getInput() const noexcept {
+        return input_;
+    }
+};
+
+}  // namespace toydb
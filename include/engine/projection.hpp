@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_result.hpp"
+#include "engine/value_expr.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Produces the given columns of its input in the given order. Columns are shared with
+ * the input batch and its selection is kept, so no rows are copied.
+ *
+ * Columns with an expression are computed for every row of the batch, selected or not, into
+ * buffers that are reused for the next batch. Every intermediate result of an expression has to
+ * fit into one buffer, so input batches with more rows are emitted in slices.
+ */
+class ProjectionExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    std::vector<ColumnId> columns_;
+    // Expression computing each column, nullptr for columns of the input. Empty if no column is
+    // computed.
+    std::vector<std::unique_ptr<ValueExpr>> expressions_;
+
+    memory::BufferManager bufferManager_;
+    // Computed columns of the current output batch
+    BatchAllocator allocator_{&bufferManager_};
+    // Most rows per output batch, a multiple of 64 so that slices start at a selection word
+    int64_t maxRows_ = std::numeric_limits<int64_t>::max();
+
+    // Index of every output column in the input batches, -1 for computed columns, resolved on the
+    // first batch
+    std::vector<int64_t> columnIndices_;
+    // Output columns, shared by all output batches
+    std::shared_ptr<const BatchSchema> schema_;
+    // Input batch, reused across calls
+    RowVector batch_;
+    // Rows of the input batch emitted so far if it is emitted in slices
+    int64_t offset_ = 0;
+    RowVector slice_;
+    PredicateResultVector sliceSelection_;
+
+public:
+    ProjectionExec(PhysicalOperator* input, std::vector<ColumnId> columns)
+        : input_(input), columns_(std::move(columns)) {}
+
+    /**
+     * @param expressions Expression of every column, nullptr for columns passed through
+     */
+    ProjectionExec(PhysicalOperator* input, std::vector<ColumnId> columns,
+                   std::vector<std::unique_ptr<ValueExpr>> expressions)
+        : input_(input), columns_(std::move(columns)), expressions_(std::move(expressions)) {
+        tdb_assert(expressions_.size() == columns_.size(), "Projection of {} columns has {} expressions",
+                   columns_.size(), expressions_.size());
+        for (const auto& expression : expressions_) {
+            if (expression) {
+                maxRows_ = std::min(maxRows_, expression->getMaxRowCount());
+            }
+        }
+        if (maxRows_ == std::numeric_limits<int64_t>::max()) {
+            expressions_.clear();
+        } else {
+            maxRows_ -= maxRows_ % 64;
+        }
+    }
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        // Computed columns do not exist below the projection
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(&filter, refs);
+        for (size_t i = 0; i < expressions_.size(); ++i) {
+            for (const ColumnRefExpr* ref : refs) {
+                if (expressions_[i] && ref->getColumnId() == columns_[i]) {
+                    return false;
+                }
+            }
+        }
+        return input_->pushRuntimeFilter(filter);
+    }
+
+    int64_t next(RowVector& out) override {
+        if (expressions_.empty()) {
+            int64_t count = input_->next(batch_);
+            if (count == 0) {
+                out.clear();
+                return 0;
+            }
+            if (columnIndices_.empty()) {
+                resolveColumns(batch_);
+            }
+            emit(batch_, out);
+            return count;
+        }
+
+        while (true) {
+            if (offset_ == batch_.getRowCount()) {
+                offset_ = 0;
+                if (input_->next(batch_) == 0) {
+                    out.clear();
+                    return 0;
+                }
+                if (columnIndices_.empty()) {
+                    resolveColumns(batch_);
+                }
+            }
+
+            const RowVector* rows = &batch_;
+            if (offset_ > 0 || batch_.getRowCount() > maxRows_) {
+                int64_t count = std::min(maxRows_, batch_.getRowCount() - offset_);
+                sliceBatch(offset_, count);
+                offset_ += count;
+                if (slice_.getSelectedRowCount() == 0) {
+                    continue;
+                }
+                rows = &slice_;
+            } else {
+                offset_ = batch_.getRowCount();
+            }
+
+            allocator_.reset();
+            emit(*rows, out);
+            return rows->getSelectedRowCount();
+        }
+    }
+
+private:
+    void resolveColumns(const RowVector& batch) {
+        std::vector<ColumnDescriptor> schema;
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            const ColumnId& colId = columns_[i];
+            if (!expressions_.empty() && expressions_[i]) {
+                expressions_[i]->bind(*batch.getSchema());
+                columnIndices_.push_back(-1);
+                schema.push_back({colId, expressions_[i]->getType()});
+                continue;
+            }
+            int64_t index = batch.getColumnIndex(colId);
+            if (index == -1) {
+                throw InternalSQLError("Projected column " + colId.getName() + " is not produced by the input");
+            }
+            columnIndices_.push_back(index);
+            schema.push_back({colId, batch.getColumn(index).type});
+        }
+        schema_ = BatchSchema::make(std::move(schema));
+        Logger::debug("ProjectionExec: {} of {} columns", columns_.size(), batch.getColumnCount());
+    }
+
+    void emit(const RowVector& rows, RowVector& out) {
+        out.bind(schema_);
+        for (size_t i = 0; i < columnIndices_.size(); ++i) {
+            if (columnIndices_[i] == -1) {
+                ColumnBuffer column = expressions_[i]->evaluate(rows, allocator_);
+                column.columnId = columns_[i];
+                out.setColumn(static_cast<int64_t>(i), column);
+            } else {
+                out.setColumn(static_cast<int64_t>(i), rows.getColumn(columnIndices_[i]));
+            }
+        }
+        out.setRowCount(rows.getRowCount());
+        out.setSelection(rows.getSelection());
+    }
+
+    /**
+     * @brief View count rows of the input batch from begin, with their part of its selection
+     */
+    void sliceBatch(int64_t begin, int64_t count) {
+        RowVector rows = batch_.view();
+        rows.setSelection(nullptr);
+        slice_ = rows.slice(begin, count);
+
+        const PredicateResultVector* selection = batch_.getSelection();
+        if (!selection) {
+            return;
+        }
+        sliceSelection_.reset(count);
+        for (int64_t w = 0; w < sliceSelection_.wordCount(); ++w) {
+            int64_t sourceWord = begin / 64 + w;
+            sliceSelection_.setWord(w, selection->getTrueWord(sourceWord), selection->getNullWord(sourceWord));
+        }
+        slice_.setSelection(&sliceSelection_);
+    }
+};
+
+}  // namespace toydb
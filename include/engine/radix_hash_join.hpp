@@ -0,0 +1,864 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/join_key.hpp"
+#include "engine/join_output.hpp"
+#include "engine/memory.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/sort.hpp"
+#include "engine/spill.hpp"
+#include "planner/logical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Equi-join for two large inputs: both inputs are radix partitioned on the hash of their
+ *        key, and every pair of partitions is joined on its own, in parallel.
+ *
+ * A single hash table over a large build input misses the cache and the TLB on almost every
+ * probe. Instead, both inputs are first split into PARTITION_COUNT partitions by the top
+ * RADIX_BITS of the key hash, on the workers of a PipelineExecutor. Rows are stored encoded
+ * (see RowEncoder) behind their hash. Every partition is then a task of a second pipeline:
+ * build partitions larger than PARTITION_TARGET_BYTES are split further by the next bits of the
+ * hash, at most RADIX_BITS per pass, until the hash table of each piece fits into the L2 cache.
+ * Probe rows are grouped by the same bits before they probe the tables.
+ *
+ * Once the partitions of a worker exceed its share of the memory budget, the largest ones are
+ * appended to a spill file per partition and input, as in a grace hash join. Joining a partition
+ * loads its build rows back, while its probe rows are streamed from disk in blocks.
+ *
+ * Output rows and outer join semantics are the same as those of HashJoinExec. The workers
+ * produce output batches while next() hands them out, in no particular order.
+ */
+class RadixHashJoinExec : public PhysicalOperator {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+    // Bits of the hash used per partitioning pass. A fan-out of 64 keeps the write positions of
+    // a pass within the L1 cache and the TLB.
+    static constexpr int RADIX_BITS = 6;
+    static constexpr size_t PARTITION_COUNT = size_t{1} << RADIX_BITS;
+    // Passes over a partition after the first one, more don't help with skewed keys
+    static constexpr int MAX_EXTRA_PASSES = 2;
+    // Encoded build rows of a piece joined with a single hash table, about the size of an L2 cache
+    static constexpr size_t PARTITION_TARGET_BYTES = 256 * 1024;
+
+private:
+    enum class Phase {
+        OPEN,
+        JOIN,
+    };
+
+    struct HashEntry {
+        uint64_t hash;
+        uint32_t chunk;
+        uint32_t row;
+        int64_t next;  // next entry in the bucket chain, CHAIN_END if last
+    };
+
+    // Spill file of a partition, created when a worker first spills to it
+    struct SpillPartition {
+        std::mutex mutex;
+        std::unique_ptr<SpillFile> file;
+
+        int64_t getBytes() const noexcept {
+            return file ? static_cast<int64_t>(file->getSize()) : 0;
+        }
+    };
+
+    /**
+     * @brief An input and its partitions. Partition NULL_PARTITION holds the rows with a NULL
+     *        key, which are only kept if the input is preserved.
+     */
+    struct Side {
+        PhysicalOperator* input;
+        std::unique_ptr<ColumnRefExpr> key;
+        bool preserved;
+        std::vector<ColumnDescriptor> schema;
+        int64_t keyIndex = -1;
+        int64_t rowCount = 0;
+        // Per partition: encoded rows in memory, one buffer per worker that produced any
+        std::vector<std::vector<std::string>> parts;
+        std::vector<std::unique_ptr<SpillPartition>> spills;
+        // Per partition: encoded bytes in memory and on disk
+        std::vector<int64_t> bytes;
+
+        Side(PhysicalOperator* input, std::unique_ptr<ColumnRefExpr> key, bool preserved)
+            : input(input), key(std::move(key)), preserved(preserved) {
+            parts.resize(PARTITION_COUNT + 1);
+            bytes.resize(PARTITION_COUNT + 1);
+            for (size_t p = 0; p <= PARTITION_COUNT; ++p) {
+                spills.push_back(std::make_unique<SpillPartition>());
+            }
+        }
+    };
+
+    /**
+     * @brief First pass: encodes the rows of an input into the partitions of the worker
+     */
+    class PartitionSink : public PipelineSink {
+    private:
+        struct State : LocalState {
+            std::vector<std::string> partitions = std::vector<std::string>(PARTITION_COUNT + 1);
+            size_t bytes = 0;
+            int64_t rowCount = 0;
+            int64_t keyIndex = -1;
+        };
+
+        RadixHashJoinExec* join_;
+        Side* side_;
+
+    public:
+        PartitionSink(RadixHashJoinExec* join, Side* side) : join_(join), side_(side) {}
+
+        std::unique_ptr<LocalState> createLocalState() override {
+            return std::make_unique<State>();
+        }
+
+        void consume(LocalState& localState, const RowVector& batch) override {
+            auto& state = static_cast<State&>(localState);
+            if (state.keyIndex < 0) {
+                state.keyIndex = findJoinKeyColumn(getColumnDescriptors(batch), side_->key->getColumnId(),
+                                                   side_->key->getType());
+            }
+
+            const ColumnBuffer& key = batch.getColumn(state.keyIndex);
+            batch.forEachSelectedRow([&](int64_t row) {
+                uint64_t hash = 0;
+                size_t partition = NULL_PARTITION;
+                if (!key.isNull(row)) {
+                    hash = join_->hashKey(key, row);
+                    partition = partitionOf(hash);
+                }
+                if (!side_->preserved && !join_->mayMatch(*side_, partition)) {
+                    return;
+                }
+
+                std::string& rows = state.partitions[partition];
+                size_t size = rows.size();
+                encodeRecord(rows, batch, row, hash);
+                state.bytes += rows.size() - size;
+                ++state.rowCount;
+            });
+
+            if (join_->bufferManager_.shouldSpill(state.bytes, join_->getWorkerBudget())) {
+                join_->spill(*side_, state.partitions, state.bytes);
+            }
+        }
+
+        void combine(std::vector<std::unique_ptr<LocalState>>& states) override {
+            for (auto& localState : states) {
+                auto& state = static_cast<State&>(*localState);
+                for (size_t p = 0; p <= PARTITION_COUNT; ++p) {
+                    if (!state.partitions[p].empty()) {
+                        side_->bytes[p] += static_cast<int64_t>(state.partitions[p].size());
+                        side_->parts[p].push_back(std::move(state.partitions[p]));
+                    }
+                }
+                side_->rowCount += state.rowCount;
+            }
+            for (size_t p = 0; p <= PARTITION_COUNT; ++p) {
+                side_->bytes[p] += side_->spills[p]->getBytes();
+            }
+        }
+    };
+
+    /**
+     * @brief Hands out one single-row batch per partition to join, holding its index
+     */
+    class PartitionTaskSource : public MorselSource {
+    private:
+        struct Task {
+            BatchAllocator allocator;
+            RowVector rows;
+
+            explicit Task(memory::BufferManager* bufferManager) : allocator(bufferManager) {}
+        };
+
+        memory::BufferManager* bufferManager_;
+        std::shared_ptr<const BatchSchema> schema_;
+        std::vector<int64_t> partitions_;
+        size_t next_ = 0;
+
+    public:
+        PartitionTaskSource(memory::BufferManager* bufferManager, std::vector<int64_t> partitions)
+            : bufferManager_(bufferManager),
+              schema_(BatchSchema::make({{ColumnId(0, "partition"), DataType::getInt64()}})),
+              partitions_(std::move(partitions)) {}
+
+        std::shared_ptr<const RowVector> nextBatch() override {
+            if (next_ == partitions_.size()) {
+                return nullptr;
+            }
+            auto task = std::make_shared<Task>(bufferManager_);
+            task->allocator.allocateBatch(schema_, task->rows);
+            task->rows.getColumn(0).writeEntry<db_int64>(0, partitions_[next_++]);
+            task->rows.setRowCount(1);
+            return std::shared_ptr<const RowVector>(task, &task->rows);
+        }
+    };
+
+    /**
+     * @brief Second pass: joins the partitions handed out by a PartitionTaskSource
+     */
+    class JoinSink : public PipelineSink {
+    public:
+        struct State : LocalState {
+            BatchAllocator buildAllocator;
+            BatchAllocator probeAllocator;
+
+            // Hash tables of the pieces of the current build partition
+            std::vector<RowVector> buildChunks;
+            std::vector<HashEntry> entries;
+            std::vector<int64_t> buckets;
+            // Per piece: first bucket and bucket mask
+            std::vector<std::pair<size_t, uint64_t>> pieces;
+            int pieceBits = 0;
+            std::vector<bool> buildMatched;
+
+            RowVector probeBatch;
+            std::vector<uint64_t> probeHashes;
+            std::vector<int64_t> probeOrder;
+
+            // Output batch being filled, handed to the consumer once full
+            std::unique_ptr<JoinOutputBuilder> output;
+
+            explicit State(memory::BufferManager* bufferManager)
+                : buildAllocator(bufferManager), probeAllocator(bufferManager) {}
+        };
+
+    private:
+        RadixHashJoinExec* join_;
+
+    public:
+        explicit JoinSink(RadixHashJoinExec* join) : join_(join) {}
+
+        std::unique_ptr<LocalState> createLocalState() override {
+            return std::make_unique<State>(&join_->bufferManager_);
+        }
+
+        void consume(LocalState& localState, const RowVector& batch) override {
+            auto& state = static_cast<State&>(localState);
+            const ColumnBuffer& partitions = batch.getColumn(0);
+            batch.forEachSelectedRow([&](int64_t row) {
+                join_->joinPartition(static_cast<size_t>(partitions.getEntry<db_int64>(row)), state);
+            });
+        }
+
+        void combine(std::vector<std::unique_ptr<LocalState>>& states) override {
+            for (auto& localState : states) {
+                auto& state = static_cast<State&>(*localState);
+                if (state.output && state.output->getRowCount() > 0) {
+                    join_->push(std::move(state.output));
+                }
+            }
+        }
+    };
+
+    static constexpr size_t NULL_PARTITION = PARTITION_COUNT;
+    static constexpr int64_t CHAIN_END = -1;
+    // Record header: hash (u64) | length of the encoded values (u32)
+    static constexpr size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    static constexpr size_t QUEUED_BATCHES_PER_WORKER = 2;
+
+    Side build_;
+    Side probe_;
+    JoinType joinType_;
+    JoinKeyDomain keyDomain_;
+    size_t workerCount_;
+    size_t memoryBudget_;
+
+    memory::BufferManager bufferManager_;
+    std::shared_ptr<const BatchSchema> buildSchema_;
+    std::shared_ptr<const BatchSchema> probeSchema_;
+    Phase phase_ = Phase::OPEN;
+
+    // Output batches produced by the workers of the join pipeline
+    std::mutex mutex_;
+    std::condition_variable batchReady_;
+    std::condition_variable spaceAvailable_;
+    std::deque<std::unique_ptr<JoinOutputBuilder>> queue_;
+    bool joinDone_ = false;
+    std::atomic<bool> stopped_ = false;
+    std::exception_ptr error_;
+    std::thread runner_;
+
+    // Batch handed out by the last call to next()
+    std::unique_ptr<JoinOutputBuilder> current_;
+
+public:
+    RadixHashJoinExec(PhysicalOperator* build, PhysicalOperator* probe,
+                      std::unique_ptr<ColumnRefExpr> buildKey, std::unique_ptr<ColumnRefExpr> probeKey,
+                      JoinType joinType = JoinType::INNER,
+                      size_t workerCount = std::thread::hardware_concurrency(),
+                      size_t memoryBudget = DEFAULT_MEMORY_BUDGET)
+        : build_(build, std::move(buildKey), joinType == JoinType::LEFT || joinType == JoinType::FULL_OUTER),
+          probe_(probe, std::move(probeKey), joinType == JoinType::RIGHT || joinType == JoinType::FULL_OUTER),
+          joinType_(joinType),
+          keyDomain_(resolveJoinKeyDomain(build_.key->getType(), probe_.key->getType())),
+          workerCount_(std::max<size_t>(workerCount, 1)),
+          memoryBudget_(memoryBudget) {
+        if (joinType_ == JoinType::CROSS) {
+            throw InternalSQLError("RadixHashJoinExec requires an equi-join condition, got a cross join");
+        }
+    }
+
+    RadixHashJoinExec(const RadixHashJoinExec&) = delete;
+    RadixHashJoinExec& operator=(const RadixHashJoinExec&) = delete;
+
+    ~RadixHashJoinExec() override {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        spaceAvailable_.notify_all();
+        if (runner_.joinable()) {
+            runner_.join();
+        }
+    }
+
+    /**
+     * @brief The inputs are initialized by the sources of the partitioning pipelines
+     */
+    void initialize() override {}
+
+    int64_t next(RowVector& out) override {
+        Logger::debug("RadixHashJoinExec::next");
+
+        if (phase_ == Phase::OPEN) {
+            partitionInputs();
+            startJoin();
+            phase_ = Phase::JOIN;
+        }
+
+        current_ = pop();
+        if (!current_) {
+            // An empty batch with the output columns
+            current_ = makeOutput();
+        }
+        return current_->finish(out);
+    }
+
+    /**
+     * @brief Forward the filter to the inputs producing its columns, as long as they have not been
+     *        partitioned yet and dropping their rows drops no output row
+     */
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        if (phase_ != Phase::OPEN) {
+            return false;
+        }
+        return (!probe_.preserved && probe_.input->pushRuntimeFilter(filter)) ||
+               (!build_.preserved && build_.input->pushRuntimeFilter(filter));
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+private:
+    uint64_t hashKey(const ColumnBuffer& col, int64_t row) const {
+        return hashJoinKey(keyDomain_, col, row);
+    }
+
+    // Partitions are selected by the top bits of the hash, buckets by the low bits
+    static size_t partitionOf(uint64_t hash) noexcept {
+        return static_cast<size_t>(hash >> (64 - RADIX_BITS));
+    }
+
+    /**
+     * @brief Piece of a partition split by pieceBits more bits of the hash
+     */
+    static size_t pieceOf(uint64_t hash, int pieceBits) noexcept {
+        if (pieceBits == 0) {
+            return 0;
+        }
+        return static_cast<size_t>((hash >> (64 - RADIX_BITS - pieceBits)) & ((uint64_t{1} << pieceBits) - 1));
+    }
+
+    /**
+     * @brief Whether rows of the partition of a side that is not preserved can have a partner.
+     *        The build input is partitioned first, so probe rows of empty build partitions are
+     *        dropped right away.
+     */
+    bool mayMatch(const Side& side, size_t partition) const noexcept {
+        if (partition == NULL_PARTITION) {
+            return false;
+        }
+        return &side == &build_ || build_.bytes[partition] > 0;
+    }
+
+    /**
+     * @brief Share of the memory budget for the partitions of one input held by one worker
+     */
+    size_t getWorkerBudget() const noexcept {
+        return memoryBudget_ / (2 * workerCount_);
+    }
+
+    static void encodeRecord(std::string& out, const RowVector& batch, int64_t row, uint64_t hash) {
+        size_t start = out.size();
+        out.append(RECORD_HEADER_SIZE, '\0');
+        for (int64_t c = 0; c < batch.getColumnCount(); ++c) {
+            RowEncoder::encode(out, batch.getColumn(c), row);
+        }
+        auto length = static_cast<uint32_t>(out.size() - start - RECORD_HEADER_SIZE);
+        std::memcpy(out.data() + start, &hash, sizeof(hash));
+        std::memcpy(out.data() + start + sizeof(hash), &length, sizeof(length));
+    }
+
+    static uint64_t recordHash(const char* record) noexcept {
+        uint64_t hash = 0;
+        std::memcpy(&hash, record, sizeof(hash));
+        return hash;
+    }
+
+    static size_t recordSize(const char* record) noexcept {
+        uint32_t length = 0;
+        std::memcpy(&length, record + sizeof(uint64_t), sizeof(length));
+        return RECORD_HEADER_SIZE + length;
+    }
+
+    /**
+     * @brief Decode the values of a record into a new row of the batch
+     */
+    static void decodeRecord(const char* record, RowVector& batch) {
+        int64_t row = batch.getRowCount();
+        const char* data = record + RECORD_HEADER_SIZE;
+        for (int64_t c = 0; c < batch.getColumnCount(); ++c) {
+            data = RowEncoder::decode(data, batch.getColumn(c), row);
+        }
+        batch.setRowCount(row + 1);
+    }
+
+    /**
+     * @brief Length of the complete records at the start of the bytes
+     */
+    static size_t completeRecords(std::string_view bytes) noexcept {
+        size_t pos = 0;
+        while (pos + RECORD_HEADER_SIZE <= bytes.size() && pos + recordSize(bytes.data() + pos) <= bytes.size()) {
+            pos += recordSize(bytes.data() + pos);
+        }
+        return pos;
+    }
+
+    /**
+     * @brief Append the largest partitions of a worker to their spill files, until it holds at
+     *        most half of its budget
+     */
+    void spill(Side& side, std::vector<std::string>& partitions, size_t& bytes) {
+        Logger::debug("RadixHashJoinExec: spilling {} bytes of partitions", bytes);
+
+        std::vector<size_t> order(partitions.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(),
+                  [&](size_t a, size_t b) { return partitions[a].size() > partitions[b].size(); });
+
+        for (size_t p : order) {
+            std::string& rows = partitions[p];
+            if (rows.empty() || bytes <= getWorkerBudget() / 2) {
+                break;
+            }
+
+            SpillPartition& spilled = *side.spills[p];
+            {
+                std::lock_guard lock(spilled.mutex);
+                if (!spilled.file) {
+                    spilled.file = std::make_unique<SpillFile>("join");
+                }
+                spilled.file->write(rows);
+            }
+
+            bytes -= rows.size();
+            std::string().swap(rows);
+        }
+    }
+
+    /**
+     * @brief Call fn with blocks of complete records of a partition, first those read back from
+     *        its spill file, then those in memory. Releases the rows passed to fn.
+     */
+    template<typename Fn>
+    void forEachRecordBlock(Side& side, size_t partition, Fn&& fn) {
+        SpillPartition& spilled = *side.spills[partition];
+        if (spilled.file) {
+            auto reader = spilled.file->openReader();
+            std::string block;
+            size_t consumed = 0;
+            for (std::string_view read = reader->nextBlock(); !read.empty(); read = reader->nextBlock()) {
+                // Records cut off at the end of the last block are completed by the next one
+                block.erase(0, consumed);
+                block.append(read);
+                consumed = completeRecords(block);
+                fn(std::string_view(block.data(), consumed));
+            }
+            if (consumed != block.size()) {
+                throw SQLRuntimeException("Spill file " + spilled.file->getPath().string() + " is truncated");
+            }
+
+            // Release the disk space early
+            reader.reset();
+            spilled.file.reset();
+        }
+
+        for (std::string& rows : side.parts[partition]) {
+            fn(std::string_view(rows));
+            std::string().swap(rows);
+        }
+    }
+
+    /**
+     * @brief Call fn(batch) with the rows of a partition, decoded into batches of the side's schema
+     */
+    template<typename Fn>
+    void forEachBatch(Side& side, size_t partition, JoinSink::State& state, Fn&& fn) {
+        const std::shared_ptr<const BatchSchema>& schema = &side == &build_ ? buildSchema_ : probeSchema_;
+        int64_t capacity = BatchAllocator::rowsPerBuffer(side.schema);
+
+        auto flush = [&] {
+            if (state.probeBatch.getRowCount() > 0) {
+                fn(state.probeBatch);
+            }
+            state.probeAllocator.reset();
+            state.probeAllocator.allocateBatch(schema, state.probeBatch);
+            state.probeHashes.clear();
+        };
+
+        flush();
+        forEachRecordBlock(side, partition, [&](std::string_view records) {
+            for (size_t pos = 0; pos < records.size(); pos += recordSize(records.data() + pos)) {
+                if (stopped_) {
+                    return;
+                }
+                decodeRecord(records.data() + pos, state.probeBatch);
+                state.probeHashes.push_back(recordHash(records.data() + pos));
+                if (state.probeBatch.getRowCount() == capacity) {
+                    flush();
+                }
+            }
+        });
+        flush();
+    }
+
+    /**
+     * @brief Run the first pass over both inputs
+     */
+    void partitionInputs() {
+        PipelineExecutor executor(workerCount_);
+
+        OperatorMorselSource buildSource(build_.input, &bufferManager_);
+        PartitionSink buildSink(this, &build_);
+        Pipeline buildPipeline {&buildSource, {}, &buildSink, {}};
+        executor.run(buildPipeline);
+        build_.schema = buildSource.getSchema();
+
+        // No row can be produced, skip the probe input entirely
+        if (build_.rowCount > 0 || probe_.preserved) {
+            OperatorMorselSource probeSource(probe_.input, &bufferManager_);
+            PartitionSink probeSink(this, &probe_);
+            Pipeline probePipeline {&probeSource, {}, &probeSink, {}};
+            executor.run(probePipeline);
+            probe_.schema = probeSource.getSchema();
+        }
+
+        for (Side* side : {&build_, &probe_}) {
+            if (!side->schema.empty()) {
+                side->keyIndex = findJoinKeyColumn(side->schema, side->key->getColumnId(), side->key->getType());
+            }
+        }
+        buildSchema_ = BatchSchema::make(build_.schema);
+        probeSchema_ = BatchSchema::make(probe_.schema);
+        Logger::debug("RadixHashJoinExec: partitioned {} build and {} probe rows", build_.rowCount, probe_.rowCount);
+    }
+
+    /**
+     * @brief Start joining the partitions that can produce rows, largest first
+     */
+    void startJoin() {
+        std::vector<int64_t> partitions;
+        for (size_t p = 0; p <= PARTITION_COUNT; ++p) {
+            bool hasBuild = build_.bytes[p] > 0;
+            bool hasProbe = probe_.bytes[p] > 0;
+            if ((hasBuild && (hasProbe || build_.preserved)) || (hasProbe && probe_.preserved)) {
+                partitions.push_back(static_cast<int64_t>(p));
+            }
+        }
+        std::stable_sort(partitions.begin(), partitions.end(), [this](int64_t a, int64_t b) {
+            return build_.bytes[static_cast<size_t>(a)] + probe_.bytes[static_cast<size_t>(a)] >
+                   build_.bytes[static_cast<size_t>(b)] + probe_.bytes[static_cast<size_t>(b)];
+        });
+
+        if (partitions.empty()) {
+            joinDone_ = true;
+            return;
+        }
+
+        runner_ = std::thread([this, partitions = std::move(partitions)]() mutable {
+            try {
+                PartitionTaskSource source(&bufferManager_, std::move(partitions));
+                JoinSink sink(this);
+                Pipeline pipeline {&source, {}, &sink, {}};
+                PipelineExecutor(workerCount_).run(pipeline);
+            } catch (...) {
+                std::lock_guard lock(mutex_);
+                error_ = std::current_exception();
+            }
+            {
+                std::lock_guard lock(mutex_);
+                joinDone_ = true;
+            }
+            batchReady_.notify_all();
+        });
+    }
+
+    std::unique_ptr<JoinOutputBuilder> makeOutput() {
+        auto output = std::make_unique<JoinOutputBuilder>(&bufferManager_);
+        output->setSchema(build_.schema, probe_.schema);
+        output->begin();
+        return output;
+    }
+
+    void emit(JoinSink::State& state, const RowVector* build, int64_t buildRow, const RowVector* probe,
+              int64_t probeRow) {
+        if (!state.output) {
+            state.output = makeOutput();
+        }
+        state.output->append(build, buildRow, probe, probeRow);
+        if (state.output->isFull()) {
+            push(std::move(state.output));
+        }
+    }
+
+    /**
+     * @brief Queue an output batch, waiting while the consumer is behind
+     */
+    void push(std::unique_ptr<JoinOutputBuilder> batch) {
+        std::unique_lock lock(mutex_);
+        spaceAvailable_.wait(lock, [this] { return stopped_ || queue_.size() < QUEUED_BATCHES_PER_WORKER * workerCount_; });
+        if (stopped_) {
+            return;
+        }
+        queue_.push_back(std::move(batch));
+        batchReady_.notify_one();
+    }
+
+    /**
+     * @brief Next output batch, rethrows exceptions of the workers
+     * @return nullptr once all partitions are joined
+     */
+    std::unique_ptr<JoinOutputBuilder> pop() {
+        std::unique_lock lock(mutex_);
+        batchReady_.wait(lock, [this] { return !queue_.empty() || joinDone_; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        if (queue_.empty()) {
+            return nullptr;
+        }
+        std::unique_ptr<JoinOutputBuilder> batch = std::move(queue_.front());
+        queue_.pop_front();
+        spaceAvailable_.notify_one();
+        return batch;
+    }
+
+    /**
+     * @brief Reorder the records of every piece by bits more bits of their hash, below the
+     *        usedBits already partitioned on. bounds holds the start of every piece and the end.
+     */
+    static void radixPass(std::string& rows, std::vector<size_t>& bounds, int usedBits, int bits) {
+        size_t fanOut = size_t{1} << bits;
+        int shift = 64 - usedBits - bits;
+        std::string out(rows.size(), '\0');
+        std::vector<size_t> newBounds {0};
+        std::vector<size_t> offsets(fanOut);
+
+        for (size_t piece = 0; piece + 1 < bounds.size(); ++piece) {
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (size_t pos = bounds[piece]; pos < bounds[piece + 1]; pos += recordSize(rows.data() + pos)) {
+                offsets[(recordHash(rows.data() + pos) >> shift) & (fanOut - 1)] += recordSize(rows.data() + pos);
+            }
+            // Byte counts to start offsets
+            size_t start = bounds[piece];
+            for (size_t& offset : offsets) {
+                size_t size = offset;
+                offset = start;
+                start += size;
+                newBounds.push_back(start);
+            }
+            for (size_t pos = bounds[piece]; pos < bounds[piece + 1];) {
+                size_t size = recordSize(rows.data() + pos);
+                size_t& offset = offsets[(recordHash(rows.data() + pos) >> shift) & (fanOut - 1)];
+                std::memcpy(out.data() + offset, rows.data() + pos, size);
+                offset += size;
+                pos += size;
+            }
+        }
+        rows.swap(out);
+        bounds.swap(newBounds);
+    }
+
+    /**
+     * @brief Load the build rows of a partition, split them into pieces that fit the L2 cache and
+     *        build a hash table per piece
+     */
+    void buildPartition(size_t partition, JoinSink::State& state) {
+        std::string rows;
+        rows.reserve(static_cast<size_t>(build_.bytes[partition]));
+        forEachRecordBlock(build_, partition, [&](std::string_view records) { rows.append(records); });
+
+        int extraBits = 0;
+        while (extraBits < MAX_EXTRA_PASSES * RADIX_BITS && (rows.size() >> extraBits) > PARTITION_TARGET_BYTES) {
+            ++extraBits;
+        }
+        std::vector<size_t> bounds {0, rows.size()};
+        for (int used = 0; used < extraBits; used += RADIX_BITS) {
+            radixPass(rows, bounds, RADIX_BITS + used, std::min(RADIX_BITS, extraBits - used));
+        }
+        state.pieceBits = extraBits;
+
+        state.buildAllocator.reset();
+        state.buildChunks.clear();
+        state.entries.clear();
+        state.buckets.clear();
+        state.pieces.clear();
+        int64_t capacity = BatchAllocator::rowsPerBuffer(build_.schema);
+
+        for (size_t piece = 0; piece + 1 < bounds.size(); ++piece) {
+            size_t rowCount = 0;
+            for (size_t pos = bounds[piece]; pos < bounds[piece + 1]; pos += recordSize(rows.data() + pos)) {
+                ++rowCount;
+            }
+
+            // Power of two bucket count with a load factor of at most 0.5
+            size_t bucketCount = 16;
+            while (bucketCount < rowCount * 2) {
+                bucketCount <<= 1;
+            }
+            size_t firstBucket = state.buckets.size();
+            state.buckets.resize(firstBucket + bucketCount, CHAIN_END);
+            state.pieces.emplace_back(firstBucket, bucketCount - 1);
+
+            for (size_t pos = bounds[piece]; pos < bounds[piece + 1]; pos += recordSize(rows.data() + pos)) {
+                if (state.buildChunks.empty() || state.buildChunks.back().getRowCount() == capacity) {
+                    state.buildChunks.push_back(state.buildAllocator.allocateBatch(buildSchema_));
+                }
+                RowVector& chunk = state.buildChunks.back();
+                int64_t row = chunk.getRowCount();
+                decodeRecord(rows.data() + pos, chunk);
+
+                uint64_t hash = recordHash(rows.data() + pos);
+                int64_t& bucket = state.buckets[firstBucket + (hash & (bucketCount - 1))];
+                state.entries.push_back({hash, static_cast<uint32_t>(state.buildChunks.size() - 1),
+                                         static_cast<uint32_t>(row), bucket});
+                bucket = static_cast<int64_t>(state.entries.size()) - 1;
+            }
+        }
+
+        if (build_.preserved) {
+            state.buildMatched.assign(state.entries.size(), false);
+        }
+    }
+
+    /**
+     * @brief Probe the hash tables with the rows of the probe batch, grouped by piece so that the
+     *        table of each piece is probed by all of its rows in a row
+     */
+    void probeBatch(const RowVector& batch, JoinSink::State& state) {
+        int64_t rowCount = batch.getRowCount();
+        state.probeOrder.resize(static_cast<size_t>(rowCount));
+        if (state.pieceBits == 0) {
+            std::iota(state.probeOrder.begin(), state.probeOrder.end(), 0);
+        } else {
+            std::vector<size_t> offsets((size_t{1} << state.pieceBits) + 1);
+            for (uint64_t hash : state.probeHashes) {
+                ++offsets[pieceOf(hash, state.pieceBits) + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            for (int64_t row = 0; row < rowCount; ++row) {
+                state.probeOrder[offsets[pieceOf(state.probeHashes[static_cast<size_t>(row)], state.pieceBits)]++] = row;
+            }
+        }
+
+        const ColumnBuffer& key = batch.getColumn(probe_.keyIndex);
+        for (int64_t row : state.probeOrder) {
+            uint64_t hash = state.probeHashes[static_cast<size_t>(row)];
+            auto [firstBucket, mask] = state.pieces[pieceOf(hash, state.pieceBits)];
+
+            bool matched = false;
+            for (int64_t pos = state.buckets[firstBucket + (hash & mask)]; pos != CHAIN_END;) {
+                const HashEntry& entry = state.entries[static_cast<size_t>(pos)];
+                if (entry.hash == hash) {
+                    const RowVector& chunk = state.buildChunks[entry.chunk];
+                    if (joinKeysEqual(keyDomain_, chunk.getColumn(build_.keyIndex), entry.row, key, row)) {
+                        matched = true;
+                        if (build_.preserved) {
+                            state.buildMatched[static_cast<size_t>(pos)] = true;
+                        }
+                        emit(state, &chunk, entry.row, &batch, row);
+                    }
+                }
+                pos = entry.next;
+            }
+
+            if (!matched && probe_.preserved) {
+                emit(state, nullptr, 0, &batch, row);
+            }
+        }
+    }
+
+    /**
+     * @brief Join the build and probe rows of a partition, emitting the output of the worker
+     */
+    void joinPartition(size_t partition, JoinSink::State& state) {
+        if (stopped_) {
+            return;
+        }
+
+        // NULL keys never match, the rows are kept only if they are preserved
+        if (partition == NULL_PARTITION) {
+            forEachBatch(build_, partition, state, [&](const RowVector& batch) {
+                for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+                    emit(state, &batch, row, nullptr, 0);
+                }
+            });
+            forEachBatch(probe_, partition, state, [&](const RowVector& batch) {
+                for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+                    emit(state, nullptr, 0, &batch, row);
+                }
+            });
+            return;
+        }
+
+        buildPartition(partition, state);
+        forEachBatch(probe_, partition, state, [&](const RowVector& batch) { probeBatch(batch, state); });
+
+        if (build_.preserved) {
+            for (size_t i = 0; i < state.entries.size(); ++i) {
+                if (!state.buildMatched[i]) {
+                    const HashEntry& entry = state.entries[i];
+                    emit(state, &state.buildChunks[entry.chunk], entry.row, nullptr, 0);
+                }
+            }
+        }
+        Logger::debug("RadixHashJoinExec: joined partition {} in {} pieces", partition, state.pieces.size());
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Receives encoded result bytes, e.g. to send them to a client
+ */
+using ByteWriter = std::function<void(std::string_view bytes)>;
+
+/**
+ * @brief Buffer that encoders append to, handed to a ByteWriter once it holds flushSize bytes.
+ * The storage is kept across flushes, so encoding a long result stops allocating.
+ */
+class OutputBuffer {
+private:
+    std::vector<char> data_;
+    size_t size_ = 0;
+    ByteWriter writer_;
+    size_t flushSize_;
+
+public:
+    static constexpr size_t DEFAULT_FLUSH_SIZE = 64 * 1024;
+
+    explicit OutputBuffer(ByteWriter writer, size_t flushSize = DEFAULT_FLUSH_SIZE)
+        : data_(flushSize), writer_(std::move(writer)), flushSize_(flushSize) {}
+
+    /**
+     * @brief Space for at least size bytes after the buffered ones, make them part of the buffer
+     *        with commit()
+     */
+    char* reserve(size_t size) {
+        if (size_ + size > data_.size()) {
+            data_.resize(std::max(data_.size() * 2, size_ + size));
+        }
+        return data_.data() + size_;
+    }
+
+    void commit(size_t size) noexcept {
+        size_ += size;
+    }
+
+    void append(const void* bytes, size_t size) {
+        std::memcpy(reserve(size), bytes, size);
+        size_ += size;
+    }
+
+    void append(std::string_view text) {
+        append(text.data(), text.size());
+    }
+
+    void append(char c) {
+        *reserve(1) = c;
+        size_++;
+    }
+
+    /**
+     * @brief Append the value in its raw, host byte order representation
+     */
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void appendRaw(const T& value) {
+        append(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Append the decimal text of an integer or the shortest text that parses back to a double
+     */
+    template<typename T>
+        requires std::integral<T> || std::floating_point<T>
+    void appendText(T value) {
+        // Enough for any int64 and the shortest representation of any double
+        constexpr size_t maxLength = 32;
+        char* begin = reserve(maxLength);
+        size_ += static_cast<size_t>(std::to_chars(begin, begin + maxLength, value).ptr - begin);
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Hand the buffered bytes to the writer if there are at least flushSize
+     */
+    void flushIfFull() {
+        if (size_ >= flushSize_) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (size_ > 0) {
+            writer_(std::string_view(data_.data(), size_));
+            size_ = 0;
+        }
+    }
+};
+
+enum class ResultFormat {
+    // The batches as aligned tables (see RowVector::toPrettyString), for humans
+    TABLE,
+    // RFC 4180 with a header line, NULL as an empty field
+    CSV,
+    // Arrow IPC stream format
+    ARROW,
+    // The binary format of BinaryResultSink
+    BINARY,
+};
+
+std::string resultFormatToString(ResultFormat format) noexcept;
+
+/**
+ * @brief Format of a name like "csv", case-insensitive
+ */
+std::optional<ResultFormat> parseResultFormat(std::string_view name) noexcept;
+
+/**
+ * @brief Encodes the selected rows of the batches of a query result while the query runs.
+ *
+ * Sinks serialize straight from the column data into an OutputBuffer, without building strings
+ * per value or row, and flush it whenever it is full, so that a client can consume the first rows
+ * long before the last batch is produced. The schema is taken from the first batch; a result
+ * without batches has no header.
+ */
+class ResultSink {
+protected:
+    OutputBuffer out_;
+    bool started_ = false;
+
+    explicit ResultSink(ByteWriter writer, size_t flushSize) : out_(std::move(writer), flushSize) {}
+
+    virtual void writeHeader(const BatchSchema& schema) = 0;
+    virtual void writeBatch(const RowVector& batch) = 0;
+    virtual void writeFooter() {}
+
+public:
+    virtual ~ResultSink() = default;
+
+    ResultSink(const ResultSink&) = delete;
+    ResultSink& operator=(const ResultSink&) = delete;
+
+    /**
+     * @brief Encode the selected rows of the batch. The batch may be reused after the call.
+     */
+    void write(const RowVector& batch) {
+        if (!started_) {
+            writeHeader(*batch.getSchema());
+            started_ = true;
+        }
+        writeBatch(batch);
+        out_.flushIfFull();
+    }
+
+    /**
+     * @brief End the result and flush everything still buffered
+     */
+    void finish() {
+        if (started_) {
+            writeFooter();
+        }
+        out_.flush();
+    }
+
+    static std::unique_ptr<ResultSink> create(ResultFormat format, ByteWriter writer,
+                                              size_t flushSize = OutputBuffer::DEFAULT_FLUSH_SIZE);
+};
+
+/**
+ * @brief Every batch as a table of at most maxRows rows, like the repl always printed them
+ */
+class TableResultSink : public ResultSink {
+private:
+    int64_t maxRows_;
+
+protected:
+    void writeHeader(const BatchSchema&) override {}
+    void writeBatch(const RowVector& batch) override;
+
+public:
+    explicit TableResultSink(ByteWriter writer, size_t flushSize = OutputBuffer::DEFAULT_FLUSH_SIZE,
+                             int64_t maxRows = 20)
+        : ResultSink(std::move(writer), flushSize), maxRows_(maxRows) {}
+};
+
+class CsvResultSink : public ResultSink {
+protected:
+    void writeHeader(const BatchSchema& schema) override;
+    void writeBatch(const RowVector& batch) override;
+
+public:
+    explicit CsvResultSink(ByteWriter writer, size_t flushSize = OutputBuffer::DEFAULT_FLUSH_SIZE)
+        : ResultSink(std::move(writer), flushSize) {}
+};
+
+/**
+ * @brief Columnar binary encoding, decodable without parsing text. All integers are little endian.
+ *
+ * The header is the column count (uint32) followed by every column's type (uint8, the value of
+ * DataType::Type), name length (uint32) and name. Every batch is its row count (uint32, never 0)
+ * followed by the columns: a validity bitmap of (rows + 7) / 8 bytes (bit i of byte i / 8 set if
+ * row i is not NULL), then the values. INT32, INT64 and DOUBLE values take 4, 8 and 8 bytes, BOOL
+ * values one byte, and STRING values are their length (uint32) followed by their characters.
+ * The value of a NULL row is unspecified, NULL strings are empty. A row count of 0 ends the
+ * result.
+ */
+class BinaryResultSink : public ResultSink {
+private:
+    std::vector<int64_t> rows_;
+
+    void writeColumn(const ColumnBuffer& column, const RowVector& batch);
+
+protected:
+    void writeHeader(const BatchSchema& schema) override;
+    void writeBatch(const RowVector& batch) override;
+    void writeFooter() override;
+
+public:
+    explicit BinaryResultSink(ByteWriter writer, size_t flushSize = OutputBuffer::DEFAULT_FLUSH_SIZE)
+        : ResultSink(std::move(writer), flushSize) {}
+};
+
+/**
+ * @brief Arrow IPC stream, one record batch per batch. Fixed-width columns of batches without a
+ * selection are handed to Arrow without copying.
+ */
+class ArrowResultSink : public ResultSink {
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+
+protected:
+    void writeHeader(const BatchSchema& schema) override;
+    void writeBatch(const RowVector& batch) override;
+    void writeFooter() override;
+
+public:
+    explicit ArrowResultSink(ByteWriter writer, size_t flushSize = OutputBuffer::DEFAULT_FLUSH_SIZE);
+    ~ArrowResultSink() override;
+};
+
+}  // namespace toydb
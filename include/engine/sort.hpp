@@ -0,0 +1,501 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/data_strucures/loser_tree.hpp"
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "common/types.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/spill.hpp"
+
+namespace toydb {
+
+/**
+ * @brief A column to sort by. NULLs sort after all values in ascending order and before all
+ * values in descending order.
+ */
+struct SortKey {
+    ColumnId column;
+    DataType type;
+    bool ascending = true;
+};
+
+/**
+ * @brief Encodes sort keys as byte strings whose memcmp order is the sort order.
+ *
+ * Every key column starts with a null marker. Integers are stored big-endian with the sign bit
+ * flipped, doubles with the sign bit flipped for positive and all bits flipped for negative
+ * values. Strings escape 0x00 as 0x00 0xFF and end with 0x00 0x00, so that no encoding is a
+ * prefix of another. For descending columns, all bytes of the column are inverted.
+ */
+class SortKeyEncoder {
+private:
+    static void appendBigEndian(std::vector<uint8_t>& out, uint64_t value, size_t bytes) {
+        for (size_t i = bytes; i > 0; --i) {
+            out.push_back(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+        }
+    }
+
+public:
+    static void encode(std::vector<uint8_t>& out, const ColumnBuffer& col, int64_t row, bool ascending) {
+        size_t begin = out.size();
+        if (col.isNull(row)) {
+            out.push_back(1);
+        } else {
+            out.push_back(0);
+            switch (col.type.getType()) {
+                case DataType::Type::INT32:
+                    appendBigEndian(out, static_cast<uint32_t>(col.getEntry<db_int32>(row)) ^ 0x80000000u, 4);
+                    break;
+                case DataType::Type::INT64:
+                    appendBigEndian(out, static_cast<uint64_t>(col.getEntry<db_int64>(row)) ^ (uint64_t{1} << 63), 8);
+                    break;
+                case DataType::Type::BOOL:
+                    out.push_back(col.getEntry<db_bool>(row) ? 1 : 0);
+                    break;
+                case DataType::Type::DOUBLE: {
+                    double value = col.getEntry<db_double>(row);
+                    // -0.0 and 0.0 compare equal
+                    uint64_t bits = std::bit_cast<uint64_t>(value == 0.0 ? 0.0 : value);
+                    bits = (bits >> 63) ? ~bits : bits ^ (uint64_t{1} << 63);
+                    appendBigEndian(out, bits, 8);
+                    break;
+                }
+                case DataType::Type::STRING:
+                    for (char c : col.getEntry<db_string>(row).view()) {
+                        out.push_back(static_cast<uint8_t>(c));
+                        if (c == '\0') {
+                            out.push_back(0xFF);
+                        }
+                    }
+                    out.push_back(0);
+                    out.push_back(0);
+                    break;
+                default:
+                    throw InternalSQLError("Cannot sort by values of type " + col.type.toString());
+            }
+        }
+
+        if (!ascending) {
+            for (size_t i = begin; i < out.size(); ++i) {
+                out[i] = static_cast<uint8_t>(~out[i]);
+            }
+        }
+    }
+
+    static int compare(const uint8_t* left, size_t leftLength, const uint8_t* right, size_t rightLength) noexcept {
+        int result = std::memcmp(left, right, std::min(leftLength, rightLength));
+        if (result != 0) {
+            return result;
+        }
+        return leftLength < rightLength ? -1 : (leftLength > rightLength ? 1 : 0);
+    }
+};
+
+/**
+ * @brief Serializes the values of a row, column by column: a null marker followed by the raw
+ * value, or by the length and characters of a string.
+ */
+class RowEncoder {
+private:
+    template<is_db_type T>
+    static void encodeValue(std::string& out, const ColumnBuffer& col, int64_t row) {
+        T value = col.getEntry<T>(row);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<is_db_type T>
+    static const char* decodeValue(const char* data, ColumnBuffer& col, int64_t row) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        col.writeEntry<T>(row, value);
+        return data + sizeof(T);
+    }
+
+public:
+    static void encode(std::string& out, const ColumnBuffer& col, int64_t row) {
+        if (col.isNull(row)) {
+            out.push_back(1);
+            return;
+        }
+        out.push_back(0);
+        switch (col.type.getType()) {
+            case DataType::Type::STRING: {
+                std::string_view value = col.getEntry<db_string>(row).view();
+                auto length = static_cast<uint32_t>(value.size());
+                out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                out.append(value);
+                break;
+            }
+            case DataType::Type::INT32: encodeValue<db_int32>(out, col, row); break;
+            case DataType::Type::INT64: encodeValue<db_int64>(out, col, row); break;
+            case DataType::Type::BOOL: encodeValue<db_bool>(out, col, row); break;
+            case DataType::Type::DOUBLE: encodeValue<db_double>(out, col, row); break;
+            default: tdb_unreachable("Unsupported column type");
+        }
+    }
+
+    /**
+     * @brief Write a value encoded by encode() into the row of the column. Strings are copied
+     * into the column's heap.
+     * @return Start of the next encoded value
+     */
+    static const char* decode(const char* data, ColumnBuffer& col, int64_t row) {
+        if (*data++ != 0) {
+            col.setNull(row);
+            col.count = std::max(col.count, row + 1);
+            return data;
+        }
+        switch (col.type.getType()) {
+            case DataType::Type::STRING: {
+                uint32_t length = 0;
+                std::memcpy(&length, data, sizeof(length));
+                data += sizeof(length);
+                col.writeString(row, std::string_view(data, length));
+                return data + length;
+            }
+            case DataType::Type::INT32: return decodeValue<db_int32>(data, col, row);
+            case DataType::Type::INT64: return decodeValue<db_int64>(data, col, row);
+            case DataType::Type::BOOL: return decodeValue<db_bool>(data, col, row);
+            case DataType::Type::DOUBLE: return decodeValue<db_double>(data, col, row);
+            default: tdb_unreachable("Unsupported column type");
+        }
+    }
+};
+
+/**
+ * @brief Sorts its input by the sort keys (ORDER BY).
+ *
+ * Input rows are copied into a run in memory, together with their normalized sort key. Sorting
+ * a run only compares keys with memcmp. Once a run exceeds the memory budget, or the buffer pool
+ * is under pressure, it is sorted and written to a temporary file. Spilled runs are merged with a loser tree, at most MERGE_FAN_IN
+ * at a time: if there are more, they are first merged into longer runs. Rows of equal keys are
+ * produced in no particular order.
+ */
+class SortExec : public PhysicalOperator {
+private:
+    // A row of the current run: its key in keys_ and its position in rows_
+    struct SortEntry {
+        uint64_t keyOffset;
+        uint32_t keyLength;
+        int64_t row;
+    };
+
+    // Sequential reader of a spilled run. Records are the key length and key, followed by the
+    // payload length and payload, which holds the null marker and value of every column.
+    struct RunReader {
+        std::unique_ptr<SpillReader> reader;
+        std::string key;
+        std::string payload;
+        bool exhausted = false;
+
+        explicit RunReader(SpillFile& file) : reader(file.openReader()) {
+            advance();
+        }
+
+        void advance() {
+            uint32_t length = 0;
+            if (!reader->read(&length, sizeof(length))) {
+                exhausted = true;
+                return;
+            }
+            key.resize(length);
+            bool complete = reader->read(key.data(), length) && reader->read(&length, sizeof(length));
+            payload.resize(length);
+            if (!complete || !reader->read(payload.data(), length)) {
+                throw SQLRuntimeException("Sort run is truncated");
+            }
+        }
+    };
+
+    struct RunLess {
+        const std::vector<std::unique_ptr<RunReader>>* readers;
+
+        bool operator()(size_t a, size_t b) const {
+            const RunReader& left = *(*readers)[a];
+            const RunReader& right = *(*readers)[b];
+            if (left.exhausted || right.exhausted) {
+                return !left.exhausted;
+            }
+            return SortKeyEncoder::compare(reinterpret_cast<const uint8_t*>(left.key.data()), left.key.size(),
+                                           reinterpret_cast<const uint8_t*>(right.key.data()), right.key.size()) < 0;
+        }
+    };
+
+    // Merges up to MERGE_FAN_IN runs, the readers are owned so that the tree can refer to them
+    struct RunMerger {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        LoserTree<RunLess> tree;
+
+        static std::vector<std::unique_ptr<RunReader>> open(const std::vector<std::unique_ptr<SpillFile>>& runs) {
+            std::vector<std::unique_ptr<RunReader>> readers;
+            for (const auto& run : runs) {
+                readers.push_back(std::make_unique<RunReader>(*run));
+            }
+            return readers;
+        }
+
+        explicit RunMerger(const std::vector<std::unique_ptr<SpillFile>>& runs)
+            : readers(open(runs)), tree(readers.size(), RunLess{&readers}) {}
+
+        // The reader with the smallest key, nullptr once all runs are exhausted
+        RunReader* top() {
+            RunReader* reader = readers[tree.top()].get();
+            return reader->exhausted ? nullptr : reader;
+        }
+
+        void pop() {
+            readers[tree.top()]->advance();
+            tree.replay();
+        }
+    };
+
+    PhysicalOperator* input_;
+    std::vector<SortKey> keys_;
+    size_t memoryBudget_;
+    memory::BufferManager bufferManager_;
+
+    std::shared_ptr<const BatchSchema> schema_;
+    std::vector<int64_t> keyIndices_;
+
+    // Current run
+    MaterializedInput rows_;
+    std::vector<uint8_t> keyBytes_;
+    std::vector<SortEntry> entries_;
+
+    std::vector<std::unique_ptr<SpillFile>> runs_;
+    size_t spilledRunCount_ = 0;
+    std::unique_ptr<RunMerger> merger_;
+    std::string payloadBuffer_;
+
+    bool sorted_ = false;
+    size_t emitIndex_ = 0;
+    BatchAllocator outputAllocator_;
+
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+    static constexpr size_t MERGE_FAN_IN = 64;
+
+    SortExec(PhysicalOperator* input, std::vector<SortKey> keys, size_t memoryBudget = DEFAULT_MEMORY_BUDGET)
+        : input_(input),
+          keys_(std::move(keys)),
+          memoryBudget_(memoryBudget),
+          rows_(&bufferManager_),
+          outputAllocator_(&bufferManager_) {
+        tdb_assert(!keys_.empty(), "SortExec needs at least one sort key");
+    }
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!sorted_) {
+            consumeInput();
+            sorted_ = true;
+        }
+
+        if (!schema_) {
+            out.clear();
+            return 0;
+        }
+
+        outputAllocator_.reset();
+        outputAllocator_.allocateBatch(schema_, out);
+        int64_t capacity = BatchAllocator::rowsPerBuffer(schema_->getColumns());
+        int64_t rowCount = merger_ ? emitMerged(out, capacity) : emitInMemory(out, capacity);
+        if (rowCount == 0) {
+            out.clear();
+            return 0;
+        }
+        out.setRowCount(rowCount);
+        return rowCount;
+    }
+
+    /**
+     * @brief Number of runs written to disk
+     */
+    size_t getSpilledRunCount() const noexcept {
+        return spilledRunCount_;
+    }
+
+private:
+    void resolveSchema(const RowVector& batch) {
+        schema_ = batch.getSchema();
+        for (const SortKey& key : keys_) {
+            int64_t index = batch.getColumnIndex(key.column);
+            if (index == -1) {
+                throw InternalSQLError("Sort column " + key.column.getName() + " is not produced by the sort input");
+            }
+            tdb_assert(batch.getColumn(index).type == key.type, "Sort column {} has the wrong type", key.column.getName());
+            keyIndices_.push_back(index);
+        }
+    }
+
+    size_t getRunMemoryUsage() const noexcept {
+        return rows_.getMemoryUsage() + keyBytes_.capacity() + entries_.capacity() * sizeof(SortEntry);
+    }
+
+    void consumeInput() {
+        RowVector batch;
+        while (true) {
+            if (input_->next(batch) == 0) {
+                break;
+            }
+            if (!schema_) {
+                resolveSchema(batch);
+            }
+
+            // Rows are appended to rows_ in selection order, so their index continues the row count
+            int64_t row = rows_.getRowCount();
+            batch.forEachSelectedRow([&](int64_t srcRow) {
+                SortEntry entry {keyBytes_.size(), 0, row++};
+                for (size_t k = 0; k < keys_.size(); ++k) {
+                    SortKeyEncoder::encode(keyBytes_, batch.getColumn(keyIndices_[k]), srcRow, keys_[k].ascending);
+                }
+                entry.keyLength = static_cast<uint32_t>(keyBytes_.size() - entry.keyOffset);
+                entries_.push_back(entry);
+            });
+            rows_.append(batch);
+
+            if (bufferManager_.shouldSpill(getRunMemoryUsage(), memoryBudget_)) {
+                spillRun();
+            }
+        }
+
+        if (!runs_.empty()) {
+            if (!entries_.empty()) {
+                spillRun();
+            }
+            mergeRuns();
+        } else {
+            sortRun();
+        }
+    }
+
+    void sortRun() {
+        const uint8_t* keys = keyBytes_.data();
+        std::sort(entries_.begin(), entries_.end(), [keys](const SortEntry& a, const SortEntry& b) {
+            return SortKeyEncoder::compare(keys + a.keyOffset, a.keyLength, keys + b.keyOffset, b.keyLength) < 0;
+        });
+    }
+
+    const ColumnBuffer& runColumn(int64_t row, size_t column, int64_t& chunkRow) const {
+        int64_t capacity = rows_.getChunkCapacity();
+        chunkRow = row % capacity;
+        return rows_.getChunk(static_cast<size_t>(row / capacity)).getColumn(static_cast<int64_t>(column));
+    }
+
+    static void writeRecord(SpillFile& file, const char* key, uint32_t keyLength, const std::string& payload) {
+        auto payloadLength = static_cast<uint32_t>(payload.size());
+        file.write(&keyLength, sizeof(keyLength));
+        file.write(key, keyLength);
+        file.write(&payloadLength, sizeof(payloadLength));
+        file.write(payload);
+    }
+
+    void encodePayload(int64_t row, std::string& payload) const {
+        payload.clear();
+        for (size_t c = 0; c < schema_->getColumns().size(); ++c) {
+            int64_t chunkRow = 0;
+            const ColumnBuffer& col = runColumn(row, c, chunkRow);
+            RowEncoder::encode(payload, col, chunkRow);
+        }
+    }
+
+    /**
+     * @brief Sort the current run, write it to a new run file and start an empty run
+     */
+    void spillRun() {
+        sortRun();
+        Logger::debug("SortExec: spilling run of {} rows ({} bytes)", entries_.size(), getRunMemoryUsage());
+
+        auto file = std::make_unique<SpillFile>("sort");
+        for (const SortEntry& entry : entries_) {
+            encodePayload(entry.row, payloadBuffer_);
+            writeRecord(*file, reinterpret_cast<const char*>(keyBytes_.data() + entry.keyOffset), entry.keyLength, payloadBuffer_);
+        }
+        file->flush();
+        runs_.push_back(std::move(file));
+        ++spilledRunCount_;
+
+        rows_.clear();
+        keyBytes_ = {};
+        entries_ = {};
+    }
+
+    /**
+     * @brief Merge runs until at most MERGE_FAN_IN are left, and set up the final merge
+     */
+    void mergeRuns() {
+        while (runs_.size() > MERGE_FAN_IN) {
+            std::vector<std::unique_ptr<SpillFile>> inputs;
+            for (size_t i = 0; i < MERGE_FAN_IN; ++i) {
+                inputs.push_back(std::move(runs_[i]));
+            }
+            runs_.erase(runs_.begin(), runs_.begin() + MERGE_FAN_IN);
+
+            RunMerger merger(inputs);
+            auto file = std::make_unique<SpillFile>("sort");
+            int64_t rowCount = 0;
+            while (RunReader* reader = merger.top()) {
+                writeRecord(*file, reader->key.data(), static_cast<uint32_t>(reader->key.size()), reader->payload);
+                ++rowCount;
+                merger.pop();
+            }
+            file->flush();
+            Logger::debug("SortExec: merged {} runs into a run of {} rows", inputs.size(), rowCount);
+            runs_.push_back(std::move(file));
+        }
+        merger_ = std::make_unique<RunMerger>(runs_);
+    }
+
+    int64_t emitInMemory(RowVector& batch, int64_t capacity) {
+        int64_t rowCount = std::min<int64_t>(capacity, static_cast<int64_t>(entries_.size() - emitIndex_));
+        for (size_t c = 0; c < schema_->getColumns().size(); ++c) {
+            ColumnBuffer& dst = batch.getColumn(static_cast<int64_t>(c));
+            for (int64_t i = 0; i < rowCount; ++i) {
+                int64_t chunkRow = 0;
+                const ColumnBuffer& src = runColumn(entries_[emitIndex_ + static_cast<size_t>(i)].row, c, chunkRow);
+                dst.copyEntry(i, src, chunkRow);
+            }
+        }
+        emitIndex_ += static_cast<size_t>(rowCount);
+        return rowCount;
+    }
+
+    int64_t emitMerged(RowVector& batch, int64_t capacity) {
+        int64_t rowCount = 0;
+        while (rowCount < capacity) {
+            RunReader* reader = merger_->top();
+            if (!reader) {
+                break;
+            }
+            decodePayload(reader->payload, batch, rowCount++);
+            merger_->pop();
+        }
+        return rowCount;
+    }
+
+    void decodePayload(const std::string& payload, RowVector& batch, int64_t row) const {
+        const char* data = payload.data();
+        for (size_t c = 0; c < schema_->getColumns().size(); ++c) {
+            data = RowEncoder::decode(data, batch.getColumn(static_cast<int64_t>(c)), row);
+        }
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/join_key.hpp"
+#include "engine/join_output.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "planner/logical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Joins two inputs sorted ascending on their join keys by merging them, without
+ *        materializing either input.
+ *
+ * The condition compares the build key with the probe key (build op probe). Equi-joins only keep
+ * the build rows of the current key in memory, and support LEFT, RIGHT and FULL_OUTER joins like
+ * HashJoinExec. Range joins (<, <=, >, >=) are INNER only: the rows of one input match a prefix
+ * of the other input, which only grows with the key and is kept in memory.
+ *
+ * The output rows contain the build columns followed by the probe columns. NULL keys never match
+ * and must sort last, as SortExec orders them. Unselected rows of filtered input batches are
+ * skipped. Inputs that are not sorted produce wrong results.
+ */
+class SortMergeJoinExec : public PhysicalOperator {
+private:
+    /**
+     * @brief Current row of a sorted input
+     */
+    struct Cursor {
+        PhysicalOperator* input;
+        std::unique_ptr<ColumnRefExpr> key;
+        RowVector batch;
+        std::vector<ColumnDescriptor> schema;
+        int64_t keyIndex = -1;
+        int64_t row = 0;
+        bool exhausted = false;
+
+        Cursor(PhysicalOperator* input, std::unique_ptr<ColumnRefExpr> key) : input(input), key(std::move(key)) {}
+
+        /**
+         * @brief Move to the first selected row at or after from, fetching batches as needed
+         */
+        void seek(int64_t from) {
+            row = from < batch.getRowCount() ? batch.nextSelectedRow(from) : batch.getRowCount();
+            while (row >= batch.getRowCount()) {
+                int64_t rowCount = input->next(batch);
+                if (schema.empty() && batch.getColumnCount() > 0) {
+                    schema = getColumnDescriptors(batch);
+                    keyIndex = findJoinKeyColumn(schema, key->getColumnId(), key->getType());
+                }
+                if (rowCount == 0) {
+                    exhausted = true;
+                    return;
+                }
+                row = batch.nextSelectedRow(0);
+            }
+        }
+
+        void advance() {
+            seek(row + 1);
+        }
+
+        const ColumnBuffer& keyColumn() const {
+            return batch.getColumn(keyIndex);
+        }
+
+        bool keyIsNull() const {
+            return keyColumn().isNull(row);
+        }
+    };
+
+    Cursor build_;
+    Cursor probe_;
+    CompareOp op_;
+    JoinType joinType_;
+    JoinKeyDomain keyDomain_;
+
+    memory::BufferManager bufferManager_;
+    JoinOutputBuilder output_;
+    bool opened_ = false;
+    bool done_ = false;
+
+    // Equi-joins: the build rows sharing the current key, and whether a probe row matched them
+    MaterializedInput group_;
+    bool groupActive_ = false;
+    bool groupMatched_ = false;
+    // Next row of the group to pair with the current probe row, or to emit unmatched
+    int64_t groupCursor_ = 0;
+
+    // Range joins: the retained input matches a prefix of itself per row of the streamed input
+    bool retainBuild_ = false;
+    bool strict_ = false;
+    MaterializedInput retained_;
+    bool streamedRowOpen_ = false;
+    int64_t retainedCursor_ = 0;
+
+public:
+    /**
+     * @param op Comparison of the build key with the probe key
+     */
+    SortMergeJoinExec(PhysicalOperator* build, PhysicalOperator* probe, std::unique_ptr<ColumnRefExpr> buildKey,
+                      std::unique_ptr<ColumnRefExpr> probeKey, CompareOp op = CompareOp::EQUAL,
+                      JoinType joinType = JoinType::INNER)
+        : build_(build, std::move(buildKey)),
+          probe_(probe, std::move(probeKey)),
+          op_(op),
+          joinType_(joinType),
+          keyDomain_(resolveJoinKeyDomain(build_.key->getType(), probe_.key->getType())),
+          output_(&bufferManager_),
+          group_(&bufferManager_),
+          retained_(&bufferManager_) {
+        switch (op_) {
+            case CompareOp::EQUAL:
+                break;
+            case CompareOp::LESS:
+            case CompareOp::LESS_EQUAL:
+            case CompareOp::GREATER:
+            case CompareOp::GREATER_EQUAL:
+                if (joinType_ != JoinType::INNER) {
+                    throw InternalSQLError("SortMergeJoinExec only supports inner range joins");
+                }
+                // build < probe retains a prefix of the build input, build > probe one of the probe input
+                retainBuild_ = op_ == CompareOp::LESS || op_ == CompareOp::LESS_EQUAL;
+                strict_ = op_ == CompareOp::LESS || op_ == CompareOp::GREATER;
+                break;
+            default:
+                throw InternalSQLError("SortMergeJoinExec does not support the comparison " + toString(op_));
+        }
+        if (joinType_ == JoinType::CROSS) {
+            throw InternalSQLError("SortMergeJoinExec requires a join condition, got a cross join");
+        }
+    }
+
+    void initialize() override {
+        build_.input->initialize();
+        probe_.input->initialize();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        Logger::debug("SortMergeJoinExec::next");
+
+        if (!opened_) {
+            build_.seek(0);
+            probe_.seek(0);
+            output_.setSchema(build_.schema, probe_.schema);
+            opened_ = true;
+        }
+
+        output_.begin();
+        while (!done_ && !output_.isFull()) {
+            done_ = op_ == CompareOp::EQUAL ? !mergeEqual() : !mergeRange();
+        }
+
+        return output_.finish(out);
+    }
+
+private:
+    bool preservesBuild() const noexcept {
+        return joinType_ == JoinType::LEFT || joinType_ == JoinType::FULL_OUTER;
+    }
+
+    bool preservesProbe() const noexcept {
+        return joinType_ == JoinType::RIGHT || joinType_ == JoinType::FULL_OUTER;
+    }
+
+    std::pair<const RowVector*, int64_t> materializedRow(const MaterializedInput& rows, int64_t index) const {
+        int64_t capacity = rows.getChunkCapacity();
+        return {&rows.getChunk(static_cast<size_t>(index / capacity)), index % capacity};
+    }
+
+    /**
+     * @brief Make one step of the equi-join, emitting at most as many rows as fit the output
+     * @return false once no more rows can be produced
+     */
+    bool mergeEqual() {
+        if (groupActive_) {
+            continueGroup();
+            return true;
+        }
+
+        if (!build_.exhausted && build_.keyIsNull()) {
+            if (preservesBuild()) {
+                output_.append(&build_.batch, build_.row, nullptr, 0);
+            }
+            build_.advance();
+            return true;
+        }
+        if (!probe_.exhausted && probe_.keyIsNull()) {
+            if (preservesProbe()) {
+                output_.append(nullptr, 0, &probe_.batch, probe_.row);
+            }
+            probe_.advance();
+            return true;
+        }
+
+        // Once an input is exhausted, only the remaining rows of a preserved input are left
+        if (build_.exhausted && probe_.exhausted) {
+            return false;
+        }
+        if (probe_.exhausted) {
+            if (!preservesBuild()) {
+                return false;
+            }
+            output_.append(&build_.batch, build_.row, nullptr, 0);
+            build_.advance();
+            return true;
+        }
+        if (build_.exhausted) {
+            if (!preservesProbe()) {
+                return false;
+            }
+            output_.append(nullptr, 0, &probe_.batch, probe_.row);
+            probe_.advance();
+            return true;
+        }
+
+        int order = compareJoinKeys(keyDomain_, build_.keyColumn(), build_.row, probe_.keyColumn(), probe_.row);
+        if (order < 0) {
+            if (preservesBuild()) {
+                output_.append(&build_.batch, build_.row, nullptr, 0);
+            }
+            build_.advance();
+        } else if (order > 0) {
+            if (preservesProbe()) {
+                output_.append(nullptr, 0, &probe_.batch, probe_.row);
+            }
+            probe_.advance();
+        } else {
+            collectGroup();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Copy the build rows with the key of the current build row
+     */
+    void collectGroup() {
+        group_.appendRow(build_.batch, build_.row);
+        build_.advance();
+        const ColumnBuffer& groupKey = group_.getChunk(0).getColumn(build_.keyIndex);
+        while (!build_.exhausted && !build_.keyIsNull() &&
+               compareJoinKeys(keyDomain_, groupKey, 0, build_.keyColumn(), build_.row) == 0) {
+            group_.appendRow(build_.batch, build_.row);
+            build_.advance();
+        }
+
+        groupActive_ = true;
+        groupMatched_ = false;
+        groupCursor_ = 0;
+    }
+
+    /**
+     * @brief Pair the group with the current probe row if it has the same key, otherwise close the
+     *        group, emitting its rows if none matched and the build rows are preserved
+     */
+    void continueGroup() {
+        const ColumnBuffer& groupKey = group_.getChunk(0).getColumn(build_.keyIndex);
+        bool probeMatches = !probe_.exhausted && !probe_.keyIsNull() &&
+                            compareJoinKeys(keyDomain_, groupKey, 0, probe_.keyColumn(), probe_.row) == 0;
+
+        if (probeMatches) {
+            for (; groupCursor_ < group_.getRowCount() && !output_.isFull(); ++groupCursor_) {
+                auto [chunk, row] = materializedRow(group_, groupCursor_);
+                output_.append(chunk, row, &probe_.batch, probe_.row);
+            }
+            if (groupCursor_ == group_.getRowCount()) {
+                groupMatched_ = true;
+                groupCursor_ = 0;
+                probe_.advance();
+            }
+            return;
+        }
+
+        if (preservesBuild() && !groupMatched_) {
+            for (; groupCursor_ < group_.getRowCount() && !output_.isFull(); ++groupCursor_) {
+                auto [chunk, row] = materializedRow(group_, groupCursor_);
+                output_.append(chunk, row, nullptr, 0);
+            }
+            if (groupCursor_ < group_.getRowCount()) {
+                return;
+            }
+        }
+
+        group_.clear();
+        groupActive_ = false;
+    }
+
+    /**
+     * @brief Make one step of the range join, emitting at most as many rows as fit the output
+     * @return false once no more rows can be produced
+     */
+    bool mergeRange() {
+        Cursor& streamed = retainBuild_ ? probe_ : build_;
+        Cursor& retained = retainBuild_ ? build_ : probe_;
+
+        if (streamed.exhausted) {
+            return false;
+        }
+        if (streamed.keyIsNull()) {
+            streamed.advance();
+            return true;
+        }
+
+        if (!streamedRowOpen_) {
+            // Retain the rows with a key before the streamed key
+            while (!retained.exhausted && !retained.keyIsNull()) {
+                int order = compareJoinKeys(keyDomain_, retained.keyColumn(), retained.row, streamed.keyColumn(),
+                                            streamed.row);
+                if (strict_ ? order >= 0 : order > 0) {
+                    break;
+                }
+                retained_.appendRow(retained.batch, retained.row);
+                retained.advance();
+            }
+            if (retained_.getRowCount() == 0 && (retained.exhausted || retained.keyIsNull())) {
+                // No streamed row can find a partner
+                return false;
+            }
+            streamedRowOpen_ = true;
+            retainedCursor_ = 0;
+        }
+
+        for (; retainedCursor_ < retained_.getRowCount() && !output_.isFull(); ++retainedCursor_) {
+            auto [chunk, row] = materializedRow(retained_, retainedCursor_);
+            if (retainBuild_) {
+                output_.append(chunk, row, &streamed.batch, streamed.row);
+            } else {
+                output_.append(&streamed.batch, streamed.row, chunk, row);
+            }
+        }
+        if (retainedCursor_ == retained_.getRowCount()) {
+            streamedRowOpen_ = false;
+            streamed.advance();
+        }
+        return true;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "common/metrics.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/async_io.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Compact serialization of batches, e.g. for spill files: the row count, then per column
+ * the null bitmap and the values. Fixed size values are stored as in memory, strings as their
+ * length and characters. Only the selected rows are written.
+ */
+class BatchCodec {
+public:
+    /**
+     * @brief Append the selected rows of the batch to out
+     */
+    static void encode(const RowVector& batch, std::string& out);
+
+    /**
+     * @brief Decode a batch written by encode() into columns of the schema allocated from
+     * allocator. Long strings are copied into the allocator's string heap.
+     * @return Start of the next encoded batch
+     */
+    static const char* decode(const char* data, const std::shared_ptr<const BatchSchema>& schema,
+                              BatchAllocator& allocator, RowVector& out);
+};
+
+class SpillReader;
+
+/**
+ * @brief A temporary file an operator moves data to when it runs out of memory (see
+ * BufferManager::shouldSpill). The file is removed when the SpillFile is destroyed.
+ *
+ * Appended bytes are collected in a block of BLOCK_SIZE bytes. A full block is written by a
+ * background thread while the next one fills up, so that the operator rarely waits for the disk.
+ * Bytes written are counted in toydb_spill_bytes_total, labeled with the operator. Not
+ * thread-safe.
+ */
+class SpillFile {
+public:
+    static constexpr size_t BLOCK_SIZE = 256 * 1024;
+
+    /**
+     * @param operatorName Part of the file name and label of the spilled bytes, e.g. "sort"
+     * @throws SQLRuntimeException if the file cannot be created
+     */
+    explicit SpillFile(const std::string& operatorName);
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    /**
+     * @brief Waits for the write in flight and removes the file
+     */
+    ~SpillFile();
+
+    /**
+     * @throws SQLRuntimeException if a previous write failed
+     */
+    void write(const void* data, size_t size);
+
+    void write(std::string_view data) {
+        write(data.data(), data.size());
+    }
+
+    /**
+     * @brief Append the selected rows of the batch, see BatchCodec. Batches without selected rows
+     * are skipped.
+     */
+    void writeBatch(const RowVector& batch);
+
+    /**
+     * @brief Write all appended bytes to the file and wait until they are written
+     * @throws SQLRuntimeException on I/O errors
+     */
+    void flush();
+
+    /**
+     * @brief Flush and read the file from the start. More bytes may be appended once the reader
+     * is done.
+     */
+    std::unique_ptr<SpillReader> openReader();
+
+    /**
+     * @brief Bytes appended so far
+     */
+    uint64_t getSize() const noexcept {
+        return size_;
+    }
+
+    const std::filesystem::path& getPath() const noexcept {
+        return path_;
+    }
+
+private:
+    std::filesystem::path path_;
+    int fd_ = -1;
+    metrics::Counter* spilledBytes_;
+    uint64_t size_ = 0;
+    // Bytes handed to the writer
+    uint64_t writeOffset_ = 0;
+    std::string block_;
+    // Block being written in the background, and the errno of the write, 0 on success
+    std::string writing_;
+    std::future<int> pending_;
+    std::string batchBuffer_;
+
+    void writeBehind();
+    void waitForWrite();
+};
+
+/**
+ * @brief Reads a spill file sequentially, reading the next block ahead while the current one is
+ * consumed
+ */
+class SpillReader {
+public:
+    explicit SpillReader(const std::filesystem::path& path);
+
+    /**
+     * @brief Copy the next size bytes into data
+     * @return false at the end of the file
+     * @throws SQLRuntimeException on I/O errors, or if the file ends within the bytes
+     */
+    bool read(void* data, size_t size);
+
+    /**
+     * @brief The bytes up to the end of the current block, or the next block if it is consumed.
+     * They stay valid until the next call.
+     * @return An empty view at the end of the file
+     */
+    std::string_view nextBlock();
+
+    /**
+     * @brief Read the next batch written by SpillFile::writeBatch into columns of the schema
+     * allocated from allocator
+     * @return Number of rows, 0 at the end of the file
+     */
+    int64_t readBatch(const std::shared_ptr<const BatchSchema>& schema, BatchAllocator& allocator, RowVector& out);
+
+private:
+    std::filesystem::path path_;
+    AsyncFileReader file_;
+    std::string_view block_;
+    std::string batchBuffer_;
+
+    std::string_view fetchBlock();
+};
+
+}  // namespace toydb
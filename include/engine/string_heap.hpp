@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "common/types.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Bump allocator for the characters of long strings (see db_string).
+ *
+ * Characters are appended to 64KB blocks, strings that don't fit a block get their own.
+ * Stored strings stay valid until reset() is called or the heap is destroyed.
+ */
+class StringHeap {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t used_ = 0;  // bytes used in the last block
+
+public:
+    StringHeap() = default;
+
+    StringHeap(const StringHeap&) = delete;
+    StringHeap& operator=(const StringHeap&) = delete;
+
+    StringHeap(StringHeap&&) = default;
+    StringHeap& operator=(StringHeap&&) = default;
+
+    /**
+     * @brief Copy the characters into the heap
+     * @return View of the copy
+     */
+    std::string_view store(std::string_view value) {
+        if (blocks_.empty() || blocks_.back().size - used_ < value.size()) {
+            size_t size = std::max(BLOCK_SIZE, value.size());
+            blocks_.push_back({std::make_unique<char[]>(size), size});
+            used_ = 0;
+        }
+
+        char* dst = blocks_.back().data.get() + used_;
+        std::memcpy(dst, value.data(), value.size());
+        used_ += value.size();
+        return std::string_view(dst, value.size());
+    }
+
+    /**
+     * @brief Create a db_string owned by this heap. Short strings are stored inline.
+     */
+    db_string makeString(std::string_view value) {
+        if (value.size() <= db_string::INLINE_LENGTH) {
+            return db_string::fromView(value);
+        }
+        return db_string::fromView(store(value));
+    }
+
+    /**
+     * @brief Free all strings. The first block is kept for reuse.
+     */
+    void reset() noexcept {
+        if (blocks_.size() > 1) {
+            blocks_.resize(1);
+        }
+        if (!blocks_.empty() && blocks_.front().size != BLOCK_SIZE) {
+            blocks_.clear();
+        }
+        used_ = 0;
+    }
+
+    size_t getBlockCount() const noexcept {
+        return blocks_.size();
+    }
+
+    /**
+     * @brief Total size of the allocated blocks
+     */
+    size_t getAllocatedBytes() const noexcept {
+        size_t bytes = 0;
+        for (const Block& block : blocks_) {
+            bytes += block.size;
+        }
+        return bytes;
+    }
+};
+
+}  // namespace toydb
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/hash.hpp"
+#include "engine/filter.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Reads a table with a TableIterator and produces only the columns needed by the query.
+ *
+ * The columns are pushed down to the file readers, which don't read the others. A predicate can
+ * be fused into the scan: it is pushed down to the readers, which skip what they can, and is then
+ * evaluated on every batch right after it was read. It can reference table columns that are not
+ * produced. Batches without a passing row are skipped. Runtime filters pushed before the scan
+ * starts are fused into the predicate.
+ *
+ * A TABLESAMPLE is applied after the predicate: BERNOULLI drops single rows from the selection,
+ * SYSTEM whole batches. Tables with many files are sampled by file instead, before they are scanned
+ * (see TableHandle::sampleFiles). With a seed, the sample is reproducible if the table is read by
+ * a single worker, which returns the batches in the same order on every scan.
+ */
+class TableScanExec : public PhysicalOperator {
+private:
+    std::unique_ptr<TableIterator> iterator_;
+    // Produced columns, followed by the columns only the predicate references
+    std::vector<ColumnId> readColumns_;
+    size_t producedCount_;
+    std::optional<BatchFilter> filter_;
+    bool started_ = false;
+    // Batch read from the table, reused across calls
+    RowVector batch_;
+    // Produced columns, shared by all output batches if the predicate reads more columns
+    std::shared_ptr<const BatchSchema> schema_;
+
+    std::optional<TableSample> sample_;
+    uint64_t random_ = 0;
+    // Selection of the rows sampled from the last batch
+    PredicateResultVector sampled_;
+
+public:
+    /**
+     * @param columns Columns of the table to produce, in this order
+     * @param predicate Filter to fuse into the scan, may be null
+     * @param sample Rows or batches to keep, all if not set
+     */
+    TableScanExec(std::unique_ptr<TableIterator> iterator, std::vector<ColumnId> columns,
+                  std::unique_ptr<PredicateExpr> predicate = nullptr, std::optional<TableSample> sample = std::nullopt)
+        : iterator_(std::move(iterator)),
+          readColumns_(std::move(columns)),
+          producedCount_(readColumns_.size()),
+          sample_(sample) {
+        if (sample_) {
+            random_ = sample_->seed.value_or(std::random_device{}());
+        }
+        if (predicate) {
+            std::vector<const ColumnRefExpr*> refs;
+            collectColumnRefs(predicate.get(), refs);
+            for (const ColumnRefExpr* ref : refs) {
+                if (std::find(readColumns_.begin(), readColumns_.end(), ref->getColumnId()) == readColumns_.end()) {
+                    readColumns_.push_back(ref->getColumnId());
+                }
+            }
+            filter_.emplace(std::move(predicate));
+        }
+    }
+
+    /**
+     * @brief Ids of the produced columns
+     */
+    std::vector<ColumnId> getColumns() const {
+        return std::vector<ColumnId>(readColumns_.begin(), readColumns_.begin() + static_cast<std::ptrdiff_t>(producedCount_));
+    }
+
+    /**
+     * @brief Ids of the columns read from the table
+     */
+    const std::vector<ColumnId>& getReadColumns() const noexcept {
+        return readColumns_;
+    }
+
+    bool hasPredicate() const noexcept {
+        return filter_.has_value();
+    }
+
+    const std::optional<TableSample>& getSample() const noexcept {
+        return sample_;
+    }
+
+    void initialize() override {
+        if (sample_) {
+            // With a seed, scanning again draws the same sample
+            random_ = sample_->seed.value_or(random_);
+        }
+        iterator_->reset();
+        iterator_->setProjection(readColumns_);
+        if (filter_) {
+            // The readers evaluate the predicate as well, its index map must be set up first
+            filter_->initialize();
+            iterator_->setPredicate(filter_->getPredicate());
+        }
+    }
+
+    /**
+     * @brief Fuse the filter into the predicate, so that it is pushed down to the readers as well.
+     *        Refused once the scan started or if the filter references columns that are not read.
+     */
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        if (started_) {
+            return false;
+        }
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(&filter, refs);
+        for (const ColumnRefExpr* ref : refs) {
+            if (std::find(readColumns_.begin(), readColumns_.end(), ref->getColumnId()) == readColumns_.end()) {
+                return false;
+            }
+        }
+
+        std::unique_ptr<PredicateExpr> predicate = filter.clone();
+        if (filter_) {
+            predicate = std::make_unique<LogicalExpr>(CompareOp::AND, filter_->getPredicate()->clone(),
+                                                      std::move(predicate));
+        }
+        // The readers keep a pointer to the replaced predicate, drop them before it is destroyed
+        iterator_->reset();
+        filter_.emplace(std::move(predicate));
+        filter_->initialize();
+        iterator_->setPredicate(filter_->getPredicate());
+        return true;
+    }
+
+    int64_t next(RowVector& out) override {
+        started_ = true;
+        while (true) {
+            if (iterator_->next(batch_) == 0) {
+                out.clear();
+                return 0;
+            }
+            tdb_assert(batch_.getColumnCount() == static_cast<int64_t>(readColumns_.size()),
+                       "Table reader produced {} columns, expected {}", batch_.getColumnCount(), readColumns_.size());
+
+            int64_t selected = batch_.getSelectedRowCount();
+            if (filter_) {
+                selected = filter_->apply(batch_);
+                if (selected == 0) {
+                    continue;
+                }
+            }
+            if (sample_) {
+                selected = applySample(selected);
+                if (selected == 0) {
+                    continue;
+                }
+            }
+
+            if (producedCount_ == readColumns_.size()) {
+                out.assignView(batch_);
+            } else {
+                if (!schema_) {
+                    const auto& columns = batch_.getSchema()->getColumns();
+                    schema_ = BatchSchema::make({columns.begin(), columns.begin() + static_cast<std::ptrdiff_t>(producedCount_)});
+                }
+                out.bind(schema_);
+                for (size_t i = 0; i < producedCount_; ++i) {
+                    out.setColumn(static_cast<int64_t>(i), batch_.getColumn(static_cast<int64_t>(i)));
+                }
+                out.setRowCount(batch_.getRowCount());
+                out.setSelection(batch_.getSelection());
+            }
+            return selected;
+        }
+    }
+
+private:
+    uint64_t nextRandom() noexcept {
+        random_ += 0x9e3779b97f4a7c15ULL;
+        return hashMix(random_);
+    }
+
+    /**
+     * @brief Restrict the batch to the sampled rows
+     * @param selected Number of rows the batch selects
+     * @return Number of rows selected after sampling
+     */
+    int64_t applySample(int64_t selected) {
+        if (sample_->method == SampleMethod::SYSTEM) {
+            return sample_->keeps(nextRandom()) ? selected : 0;
+        }
+
+        int64_t rowCount = batch_.getRowCount();
+        const PredicateResultVector* selection = batch_.getSelection();
+        sampled_.reset(rowCount);
+        for (int64_t w = 0; w < sampled_.wordCount(); ++w) {
+            int64_t bits = std::min<int64_t>(64, rowCount - w * 64);
+            uint64_t word = 0;
+            for (int64_t i = 0; i < bits; ++i) {
+                word |= static_cast<uint64_t>(sample_->keeps(nextRandom())) << i;
+            }
+            if (selection) {
+                word &= selection->getTrueWord(w);
+            }
+            sampled_.setWord(w, word, 0);
+        }
+
+        int64_t count = sampled_.count();
+        sampled_.adaptRepresentation();
+        batch_.setSelection(&sampled_);
+        return count;
+    }
+};
+
+}  // namespace toydb
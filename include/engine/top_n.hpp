@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "engine/sort.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Keeps the first limit rows by the sort keys in a bounded max-heap.
+ *
+ * The sort key of every row is normalized first and compared against the largest key kept so
+ * far. Only rows that make it into the heap are copied, so once the heap is full, most rows
+ * cost a key encoding and a memcmp. Memory is proportional to limit, independent of the input.
+ */
+class TopNHeap {
+private:
+    struct Entry {
+        std::vector<uint8_t> key;
+        std::string row;
+    };
+
+    std::vector<SortKey> keys_;
+    int64_t limit_;
+    std::shared_ptr<const BatchSchema> schema_;
+    std::vector<int64_t> keyIndices_;
+
+    // Max-heap on the key, the root is the first row to be replaced
+    std::vector<Entry> heap_;
+    std::vector<uint8_t> key_;
+
+    bool finished_ = false;
+    size_t emitIndex_ = 0;
+    BatchAllocator outputAllocator_;
+
+    static bool keyLess(const Entry& a, const Entry& b) noexcept {
+        return SortKeyEncoder::compare(a.key.data(), a.key.size(), b.key.data(), b.key.size()) < 0;
+    }
+
+public:
+    TopNHeap(std::vector<SortKey> keys, int64_t limit, memory::BufferManager* bufferManager)
+        : keys_(std::move(keys)), limit_(limit), outputAllocator_(bufferManager) {
+        tdb_assert(!keys_.empty(), "TopNHeap needs at least one sort key");
+        tdb_assert(limit >= 0, "Negative limit {}", limit);
+    }
+
+    TopNHeap(const TopNHeap&) = delete;
+    TopNHeap& operator=(const TopNHeap&) = delete;
+
+    /**
+     * @brief Number of rows held, at most the limit
+     */
+    int64_t getRowCount() const noexcept {
+        return static_cast<int64_t>(heap_.size());
+    }
+
+    void consume(const RowVector& batch) {
+        tdb_assert(!finished_, "Cannot consume rows after results were emitted");
+        if (limit_ == 0) {
+            return;
+        }
+        if (!schema_) {
+            resolveSchema(batch);
+        }
+
+        batch.forEachSelectedRow([&](int64_t row) {
+            key_.clear();
+            for (size_t k = 0; k < keys_.size(); ++k) {
+                SortKeyEncoder::encode(key_, batch.getColumn(keyIndices_[k]), row, keys_[k].ascending);
+            }
+
+            if (static_cast<int64_t>(heap_.size()) < limit_) {
+                Entry& entry = heap_.emplace_back();
+                entry.key = key_;
+                encodeRow(batch, row, entry.row);
+                std::push_heap(heap_.begin(), heap_.end(), keyLess);
+                return;
+            }
+
+            const Entry& largest = heap_.front();
+            if (SortKeyEncoder::compare(key_.data(), key_.size(), largest.key.data(), largest.key.size()) >= 0) {
+                return;
+            }
+            // Reuse the memory of the evicted entry
+            std::pop_heap(heap_.begin(), heap_.end(), keyLess);
+            Entry& entry = heap_.back();
+            entry.key.assign(key_.begin(), key_.end());
+            encodeRow(batch, row, entry.row);
+            std::push_heap(heap_.begin(), heap_.end(), keyLess);
+        });
+    }
+
+    /**
+     * @brief Add the rows of another heap with the same keys and limit. The other heap is left empty.
+     */
+    void merge(TopNHeap& other) {
+        tdb_assert(!finished_ && !other.finished_, "Cannot merge heaps after results were emitted");
+        if (!schema_) {
+            schema_ = other.schema_;
+        }
+
+        for (Entry& entry : other.heap_) {
+            if (static_cast<int64_t>(heap_.size()) < limit_) {
+                heap_.push_back(std::move(entry));
+                std::push_heap(heap_.begin(), heap_.end(), keyLess);
+            } else if (keyLess(entry, heap_.front())) {
+                std::pop_heap(heap_.begin(), heap_.end(), keyLess);
+                heap_.back() = std::move(entry);
+                std::push_heap(heap_.begin(), heap_.end(), keyLess);
+            }
+        }
+        other.heap_.clear();
+    }
+
+    /**
+     * @brief Produce the next batch of rows in sort order, which stays valid until the next call.
+     * The first call finishes the heap: no more rows can be consumed afterwards.
+     * @return Number of rows, 0 once all rows were emitted
+     */
+    int64_t emit(RowVector& out) {
+        if (!finished_) {
+            std::sort_heap(heap_.begin(), heap_.end(), keyLess);
+            finished_ = true;
+        }
+
+        if (emitIndex_ == heap_.size()) {
+            out.clear();
+            return 0;
+        }
+
+        outputAllocator_.reset();
+        outputAllocator_.allocateBatch(schema_, out);
+        int64_t capacity = BatchAllocator::rowsPerBuffer(schema_->getColumns());
+        int64_t rowCount = 0;
+        for (; rowCount < capacity && emitIndex_ < heap_.size(); ++rowCount, ++emitIndex_) {
+            const char* data = heap_[emitIndex_].row.data();
+            for (size_t c = 0; c < schema_->getColumns().size(); ++c) {
+                data = RowEncoder::decode(data, out.getColumn(static_cast<int64_t>(c)), rowCount);
+            }
+        }
+        out.setRowCount(rowCount);
+        return rowCount;
+    }
+
+private:
+    void resolveSchema(const RowVector& batch) {
+        schema_ = batch.getSchema();
+        for (const SortKey& key : keys_) {
+            int64_t index = batch.getColumnIndex(key.column);
+            if (index == -1) {
+                throw InternalSQLError("Sort column " + key.column.getName() + " is not produced by the top-n input");
+            }
+            tdb_assert(batch.getColumn(index).type == key.type, "Sort column {} has the wrong type", key.column.getName());
+            keyIndices_.push_back(index);
+        }
+    }
+
+    static void encodeRow(const RowVector& batch, int64_t row, std::string& out) {
+        out.clear();
+        for (const ColumnBuffer& col : batch.getColumns()) {
+            RowEncoder::encode(out, col, row);
+        }
+    }
+};
+
+/**
+ * @brief The first limit rows of its input by the sort keys, i.e. ORDER BY ... LIMIT.
+ * Replaces a SortExec followed by a LimitExec without sorting the whole input.
+ */
+class TopNExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    memory::BufferManager bufferManager_;
+    TopNHeap heap_;
+    bool consumed_ = false;
+
+public:
+    TopNExec(PhysicalOperator* input, std::vector<SortKey> keys, int64_t limit)
+        : input_(input), heap_(std::move(keys), limit, &bufferManager_) {}
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!consumed_) {
+            RowVector batch;
+            while (true) {
+                if (input_->next(batch) == 0) {
+                    break;
+                }
+                heap_.consume(batch);
+            }
+            consumed_ = true;
+            Logger::debug("TopNExec: kept {} rows", heap_.getRowCount());
+        }
+        return heap_.emit(out);
+    }
+};
+
+/**
+ * @brief Top-n as the sink of a parallel pipeline. Every worker keeps a heap of its own, the
+ * heaps are merged into a single one once all workers are done.
+ */
+class TopNSink : public PipelineSink {
+private:
+    struct State : LocalState {
+        std::unique_ptr<TopNHeap> heap;
+    };
+
+    std::vector<SortKey> keys_;
+    int64_t limit_;
+    memory::BufferManager bufferManager_;
+    std::unique_ptr<TopNHeap> result_;
+
+public:
+    TopNSink(std::vector<SortKey> keys, int64_t limit) : keys_(std::move(keys)), limit_(limit) {}
+
+    std::unique_ptr<LocalState> createLocalState() override {
+        auto state = std::make_unique<State>();
+        state->heap = std::make_unique<TopNHeap>(keys_, limit_, &bufferManager_);
+        return state;
+    }
+
+    void consume(LocalState& state, const RowVector& batch) override {
+        static_cast<State&>(state).heap->consume(batch);
+    }
+
+    void combine(std::vector<std::unique_ptr<LocalState>>& states) override {
+        for (auto& localState : states) {
+            std::unique_ptr<TopNHeap>& heap = static_cast<State&>(*localState).heap;
+            if (!result_) {
+                result_ = std::move(heap);
+            } else {
+                result_->merge(*heap);
+            }
+        }
+    }
+
+    /**
+     * @brief The merged heap, emit() produces the result rows. Only valid after the pipeline ran.
+     */
+    TopNHeap& getResult() {
+        tdb_assert(result_ != nullptr, "The top-n pipeline has not run");
+        return *result_;
+    }
+};
+
+/**
+ * @brief The first limit rows of its input like a TopNExec, on the workers of a PipelineExecutor.
+ *
+ * The first call to next() runs a pipeline from the input, read through an OperatorMorselSource,
+ * into a TopNSink, so that every worker keeps the first rows of the morsels it pulls in a heap of
+ * its own. The output is that of the merged heap. Like a ParallelHashAggregateExec, the pipeline
+ * can read a source of its own through streaming operators every worker builds itself.
+ */
+class ParallelTopNExec : public PhysicalOperator {
+private:
+    PhysicalOperator* input_ = nullptr;
+    // Set if the pipeline reads a source of its own instead of the input
+    MorselSourceFactory source_;
+    PipelineFactory factory_;
+    size_t workerCount_;
+    memory::BufferManager bufferManager_;
+    TopNSink sink_;
+    bool consumed_ = false;
+
+public:
+    ParallelTopNExec(PhysicalOperator* input, std::vector<SortKey> keys, int64_t limit, size_t workerCount)
+        : input_(input), workerCount_(workerCount), sink_(std::move(keys), limit) {}
+
+    /**
+     * @param source Creates the source of the pipeline, e.g. a scan of a table, when it runs
+     * @param factory Builds the streaming operators every worker applies to its morsels, e.g. filters
+     */
+    ParallelTopNExec(MorselSourceFactory source, PipelineFactory factory, std::vector<SortKey> keys, int64_t limit,
+                     size_t workerCount)
+        : source_(std::move(source)), factory_(std::move(factory)), workerCount_(workerCount),
+          sink_(std::move(keys), limit) {}
+
+    /**
+     * @brief The input is initialized by the source of the pipeline
+     */
+    void initialize() override {}
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!consumed_) {
+            std::unique_ptr<MorselSource> source =
+                source_ ? source_() : std::make_unique<OperatorMorselSource>(input_, &bufferManager_);
+            Pipeline pipeline {source.get(), factory_, &sink_, {}};
+            PipelineExecutor(workerCount_).run(pipeline);
+            consumed_ = true;
+            Logger::debug("ParallelTopNExec: kept {} rows merged from {} workers", sink_.getResult().getRowCount(),
+                          workerCount_);
+        }
+        return sink_.getResult().emit(out);
+    }
+
+    size_t getWorkerCount() const noexcept {
+        return workerCount_;
+    }
+
+    /**
+     * @brief Whether the workers read the source themselves instead of an input operator
+     */
+    bool hasSource() const noexcept {
+        return static_cast<bool>(source_);
+    }
+};
+
+}  // namespace toydb
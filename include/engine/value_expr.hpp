@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/types.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/physical_operator.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Expression computing a value per row, e.g. price * quantity in a SELECT list.
+ *
+ * Unlike PredicateExpr, which yields a PredicateResultVector, value expressions produce a column:
+ * evaluate() computes every row of a batch at once into a ColumnBuffer. All expressions are
+ * strict, a row is NULL if any input of it is NULL: the null bitmap of a result is the AND of the
+ * bitmaps of its inputs. Errors such as a division by zero are only raised for rows that are
+ * selected and not NULL, so that a row removed by a filter cannot fail the query.
+ */
+class ValueExpr {
+protected:
+    DataType type_;
+    std::vector<std::unique_ptr<ValueExpr>> children_;
+
+    explicit ValueExpr(DataType type, std::vector<std::unique_ptr<ValueExpr>> children = {})
+        : type_(type), children_(std::move(children)) {}
+
+    std::vector<std::unique_ptr<ValueExpr>> cloneChildren() const {
+        std::vector<std::unique_ptr<ValueExpr>> children;
+        for (const auto& child : children_) {
+            children.push_back(child->clone());
+        }
+        return children;
+    }
+
+public:
+    virtual ~ValueExpr() = default;
+
+    DataType getType() const noexcept {
+        return type_;
+    }
+
+    const std::vector<std::unique_ptr<ValueExpr>>& getChildren() const noexcept {
+        return children_;
+    }
+
+    /**
+     * @brief Resolve the columns the expression reads to their index in batches of the schema
+     * @throws InternalSQLError if the schema lacks one of them
+     */
+    virtual void bind(const BatchSchema& schema) {
+        for (auto& child : children_) {
+            child->bind(schema);
+        }
+    }
+
+    /**
+     * @brief Append the columns the expression reads to columns
+     */
+    virtual void collectColumns(std::vector<ColumnId>& columns) const {
+        for (const auto& child : children_) {
+            child->collectColumns(columns);
+        }
+    }
+
+    /**
+     * @brief Most rows of a batch the expression can evaluate: every intermediate result is
+     * allocated as a single buffer
+     */
+    virtual int64_t getMaxRowCount() const {
+        int64_t rows = BatchAllocator::rowsPerBuffer(type_);
+        for (const auto& child : children_) {
+            rows = std::min(rows, child->getMaxRowCount());
+        }
+        return rows;
+    }
+
+    /**
+     * @brief Compute the value of every row of the batch, which holds at most getMaxRowCount()
+     * rows. The result is either a column of the batch or allocated from allocator and valid
+     * until it is reset. Its column id is unset.
+     * @throws SQLRuntimeException if the value of a selected row cannot be computed
+     */
+    virtual ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const = 0;
+
+    /**
+     * @brief Deep copy of the expression, bind() must be called on the copy
+     */
+    virtual std::unique_ptr<ValueExpr> clone() const = 0;
+
+    /**
+     * @brief The expression as SQL, e.g. "(price * quantity)"
+     */
+    virtual std::string toString() const = 0;
+};
+
+/**
+ * @brief Column of the input, returned as is without copying it
+ */
+class ColumnValueExpr : public ValueExpr {
+private:
+    ColumnId columnId_;
+    int64_t columnIndex_ = -1;
+
+public:
+    ColumnValueExpr(const ColumnId& columnId, DataType type) : ValueExpr(type), columnId_(columnId) {}
+
+    const ColumnId& getColumnId() const noexcept {
+        return columnId_;
+    }
+
+    void bind(const BatchSchema& schema) override {
+        columnIndex_ = schema.getColumnIndex(columnId_);
+        if (columnIndex_ == -1) {
+            throw InternalSQLError("Column " + columnId_.getName() + " of an expression is not produced by the input");
+        }
+    }
+
+    void collectColumns(std::vector<ColumnId>& columns) const override {
+        columns.push_back(columnId_);
+    }
+
+    int64_t getMaxRowCount() const override {
+        return std::numeric_limits<int64_t>::max();
+    }
+
+    ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const override;
+
+    std::unique_ptr<ValueExpr> clone() const override {
+        return std::make_unique<ColumnValueExpr>(columnId_, type_);
+    }
+
+    std::string toString() const override {
+        return columnId_.getName();
+    }
+};
+
+/**
+ * @brief Literal value. Operators over constants read them directly instead of evaluating them
+ * into a column of copies.
+ */
+class ConstantValueExpr : public ValueExpr {
+private:
+    std::variant<std::monostate, int64_t, double, bool, std::string> value_;
+
+public:
+    /**
+     * @brief NULL of the type, which may be NULL_CONST until the constant is cast to the type of
+     * its use
+     */
+    explicit ConstantValueExpr(DataType type = DataType::getNullConst()) : ValueExpr(type) {}
+    ConstantValueExpr(DataType type, int64_t value) : ValueExpr(type), value_(value) {}
+    ConstantValueExpr(DataType type, double value) : ValueExpr(type), value_(value) {}
+    ConstantValueExpr(DataType type, bool value) : ValueExpr(type), value_(value) {}
+    ConstantValueExpr(DataType type, std::string value) : ValueExpr(type), value_(std::move(value)) {}
+
+    /**
+     * @brief The value of a row of a column as a constant
+     */
+    static std::unique_ptr<ConstantValueExpr> fromColumn(const ColumnBuffer& column, int64_t row);
+
+    bool isNull() const noexcept {
+        return std::holds_alternative<std::monostate>(value_);
+    }
+
+    /**
+     * @brief The value as T, which must be the type of the constant. The characters of strings
+     * are owned by the constant.
+     */
+    template<is_db_type T>
+    T getValue() const {
+        tdb_assert(getDataTypeFor<T>() == type_ && !isNull(), "Constant is not a {}", getDataTypeFor<T>().toString());
+        if constexpr (std::is_same_v<T, db_string>) {
+            return db_string::fromView(std::get<std::string>(value_));
+        } else if constexpr (std::is_same_v<T, db_double>) {
+            return std::get<double>(value_);
+        } else if constexpr (std::is_same_v<T, db_bool>) {
+            return std::get<bool>(value_);
+        } else {
+            return static_cast<T>(std::get<int64_t>(value_));
+        }
+    }
+
+    int64_t getMaxRowCount() const override {
+        return type_ == DataType::getNullConst() ? std::numeric_limits<int64_t>::max() : ValueExpr::getMaxRowCount();
+    }
+
+    /**
+     * @brief The constant repeated for every row of the batch
+     */
+    ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const override;
+
+    std::unique_ptr<ValueExpr> clone() const override {
+        auto copy = std::make_unique<ConstantValueExpr>(type_);
+        copy->value_ = value_;
+        return copy;
+    }
+
+    std::string toString() const override;
+};
+
+/**
+ * @brief Arithmetic on two numbers of the same type, which is the type of the result. Integer
+ * division truncates. Integer overflow and division by zero fail the query.
+ */
+class ArithmeticExpr : public ValueExpr {
+private:
+    ArithmeticOp op_;
+
+    template<typename T, typename Left, typename Right>
+    void computeIntegers(const Left& left, const Right& right, ColumnBuffer& result, const RowVector& batch) const;
+
+    template<typename Left, typename Right>
+    void computeDoubles(const Left& left, const Right& right, ColumnBuffer& result, const RowVector& batch) const;
+
+public:
+    /**
+     * @throws InternalSQLError if the operands are not numbers of the same type
+     */
+    ArithmeticExpr(ArithmeticOp op, std::unique_ptr<ValueExpr> left, std::unique_ptr<ValueExpr> right);
+
+    ArithmeticOp getOp() const noexcept {
+        return op_;
+    }
+
+    ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const override;
+
+    std::unique_ptr<ValueExpr> clone() const override {
+        return std::make_unique<ArithmeticExpr>(op_, children_[0]->clone(), children_[1]->clone());
+    }
+
+    std::string toString() const override {
+        return "(" + children_[0]->toString() + " " + toydb::toString(op_) + " " + children_[1]->toString() + ")";
+    }
+};
+
+/**
+ * @brief Conversion of a value to another type. Numbers convert into each other, doubles are
+ * rounded to integers, and integers to booleans (not zero) and back (1 or 0). Every type converts
+ * to and from strings. Values that do not fit the type or strings that do not spell a value of
+ * it fail the query.
+ */
+class CastValueExpr : public ValueExpr {
+public:
+    /**
+     * @throws InternalSQLError if the type of input cannot be cast to type, see canCast
+     */
+    CastValueExpr(std::unique_ptr<ValueExpr> input, DataType type);
+
+    static bool canCast(DataType from, DataType to) noexcept;
+
+    ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const override;
+
+    std::unique_ptr<ValueExpr> clone() const override {
+        return std::make_unique<CastValueExpr>(children_[0]->clone(), type_);
+    }
+
+    std::string toString() const override {
+        return "CAST(" + children_[0]->toString() + " AS " + type_.toString() + ")";
+    }
+};
+
+/**
+ * @brief Scalar function of strings. UPPER and LOWER change the case of ASCII letters, LENGTH
+ * counts bytes, SUBSTR(s, start[, length]) takes the characters from the 1-based start, and
+ * CONCAT appends its arguments like ||.
+ */
+class FunctionExpr : public ValueExpr {
+private:
+    ScalarFunction function_;
+
+public:
+    /**
+     * @brief The arguments of SUBSTR after the string are BIGINT, all others STRING
+     * @throws InternalSQLError if the number or types of the arguments do not match the function
+     */
+    FunctionExpr(ScalarFunction function, std::vector<std::unique_ptr<ValueExpr>> arguments);
+
+    ScalarFunction getFunction() const noexcept {
+        return function_;
+    }
+
+    ColumnBuffer evaluate(const RowVector& batch, BatchAllocator& allocator) const override;
+
+    std::unique_ptr<ValueExpr> clone() const override {
+        return std::make_unique<FunctionExpr>(function_, cloneChildren());
+    }
+
+    std::string toString() const override;
+};
+
+/**
+ * @brief Convert the value of expr to type. Constants are converted right away, expressions of
+ * the type are returned as is.
+ * @throws InternalSQLError if the conversion is not supported
+ * @throws SQLRuntimeException if a constant does not convert, e.g. CAST('a' AS INTEGER)
+ */
+std::unique_ptr<ValueExpr> makeCast(std::unique_ptr<ValueExpr> expr, DataType type);
+
+}  // namespace toydb
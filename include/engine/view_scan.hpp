@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/aggregate_hash_table.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/spill.hpp"
+
+namespace toydb {
+
+/**
+ * @brief The contents of a materialized view. Views hold the results dashboards ask for, so they
+ *        are read at once.
+ * @throws SQLRuntimeException if the file can't be read
+ */
+inline std::string readMaterializedView(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw SQLRuntimeException("Failed to open materialized view " + path.string());
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        throw SQLRuntimeException("Failed to read materialized view " + path.string());
+    }
+    return contents;
+}
+
+/**
+ * @brief Produces the rows of a materialized view, batches encoded with BatchCodec that are decoded
+ * into columns of the schema by position. The view is read by the constructor, so that a refresh
+ * replacing its file can't fail a query once it is planned.
+ * @throws SQLRuntimeException from the constructor if the view can't be read
+ */
+class ViewScanExec : public PhysicalOperator {
+private:
+    std::shared_ptr<const BatchSchema> schema_;
+    memory::BufferManager bufferManager_;
+    BatchAllocator allocator_;
+    std::string contents_;
+    // Start of the next encoded batch
+    size_t offset_ = 0;
+
+public:
+    ViewScanExec(const std::filesystem::path& path, std::vector<ColumnDescriptor> schema)
+        : schema_(BatchSchema::make(std::move(schema))), allocator_(&bufferManager_),
+          contents_(readMaterializedView(path)) {}
+
+    void initialize() override {
+        offset_ = 0;
+    }
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        while (offset_ < contents_.size()) {
+            allocator_.reset();
+            const char* start = contents_.data() + offset_;
+            offset_ += static_cast<size_t>(BatchCodec::decode(start, schema_, allocator_, out) - start);
+            if (out.getRowCount() > 0) {
+                return out.getRowCount();
+            }
+        }
+        out.clear();
+        return 0;
+    }
+};
+
+/**
+ * @brief Produces the aggregates of a materialized view of an aggregate like a HashAggregateExec,
+ * from the partial states of its groups. The view is read by the constructor like by a
+ * ViewScanExec, the states are merged by the first call to next().
+ * @throws SQLRuntimeException from the constructor if the view can't be read
+ */
+class ViewAggregateExec : public PhysicalOperator {
+private:
+    std::string states_;
+    memory::BufferManager bufferManager_;
+    AggregateHashTable table_;
+    bool merged_ = false;
+
+public:
+    ViewAggregateExec(const std::filesystem::path& path, std::vector<ColumnDescriptor> groupBy,
+                      std::vector<AggregateSpec> aggregates,
+                      size_t memoryBudget = AggregateHashTable::DEFAULT_MEMORY_BUDGET)
+        : states_(readMaterializedView(path)),
+          table_(std::move(groupBy), std::move(aggregates), &bufferManager_, memoryBudget) {}
+
+    void initialize() override {}
+
+    const memory::BufferManager* getBufferManager() const noexcept override {
+        return &bufferManager_;
+    }
+
+    int64_t next(RowVector& out) override {
+        if (!merged_) {
+            table_.mergePartialStates(states_);
+            states_ = {};
+            merged_ = true;
+            Logger::debug("ViewAggregateExec: {} groups in memory, spilled {} times", table_.getGroupCount(),
+                          table_.getSpillCount());
+        }
+        return table_.emit(out);
+    }
+};
+
+}  // namespace toydb
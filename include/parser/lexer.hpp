@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <expected>
 
@@ -22,6 +23,8 @@ enum class TokenType {
     FalseLiteral,
     StringLiteral,
     NullLiteral,
+    // ? placeholder of a prepared statement
+    Parameter,
     EndOfStatement,
     EndOfFile,
 
@@ -33,6 +36,12 @@ enum class TokenType {
     OpNotEquals,
     OpAnd,
     OpOr,
+    OpPlus,
+    OpMinus,
+    OpDivide,
+    OpModulo,
+    // || string concatenation
+    OpConcat,
 
     KeyInsert,
     KeyInto,
@@ -44,12 +53,21 @@ enum class TokenType {
     KeyJoin,
     KeyOn,
     KeyOrder,
+    KeyGroup,
     KeyBy,
+    KeyAsc,
+    KeyDesc,
+    KeyLimit,
     KeyUpdate,
     KeySet,
     KeyDelete,
     KeyCreate,
     KeyTable,
+    KeyIndex,
+    KeyAnalyze,
+    KeyExplain,
+    KeyCast,
+    KeyTablesample,
 
     KeyBoolType,
     KeyIntegerType,
@@ -68,19 +86,21 @@ enum class TokenType {
     Unknown = 666,
 };
 
+/**
+ * @brief Identifiers and string literals are views of the query, so tokens must not outlive it
+ */
 struct Token {
-    using TokenValue = std::variant<std::monostate, std::string, int64_t, double>;
+    using TokenValue = std::variant<std::monostate, std::string_view, int64_t, double>;
 
     TokenType type;
     TokenValue value;
 
     Token(TokenType type = TokenType::Unknown) : type(type), value(std::monostate{}) {}
-    Token(TokenType type, const std::string& str) : type(type), value(str) {}
-    Token(TokenType type, std::string&& str) : type(type), value(std::move(str)) {}
+    Token(TokenType type, std::string_view str) : type(type), value(str) {}
     Token(TokenType type, int64_t val) : type(type), value(val) {}
     Token(TokenType type, double val) : type(type), value(val) {}
 
-    std::string getString() const;
+    std::string_view getString() const;
     int64_t getInt() const;
     double getDouble() const;
     bool getBool() const;
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cctype>
+#include <memory>
 #include <string>
 #include "common/types.hpp"
 #include "parser/lexer.hpp"
@@ -15,32 +16,66 @@ class Parser {
 
     TokenStream ts;
 
+    // Owns the nodes of the query, handed to its QueryAST
+    std::unique_ptr<Arena> arena_;
+
+    // ? placeholders parsed so far
+    size_t parameterCount_ = 0;
+
     void expectToken(TokenType expected, const std::string& context);
 
     Token parseIdentifier(const std::string& context);
 
     std::pair<std::string, std::string> parseQualifiedColumnRef(const std::string& context);
 
-    std::unique_ptr<ast::Expression> parseExpression();
+    ast::ColumnRef parseSelectColumn();
+
+    std::vector<ast::ColumnRef> parseGroupBy();
+
+    void parseOrderBy(ast::SelectFrom& selectFrom);
+
+    std::optional<int64_t> parseLimit();
+
+    TableSample parseTableSample();
+
+    double parseNumber(const std::string& context);
+
+    ast::Expression* parseExpression(int minPrecedence = 1);
+
+    ast::Expression* makeBinaryExpression(TokenType op, ast::Expression* left, ast::Expression* right);
+
+    ast::Expression* parseTerm();
+
+    ast::Expression* parseCall(std::string_view name);
+
+    ast::Cast* parseCast();
+
+    ast::Expression* parseWhere();
+
+    ast::SelectFrom* parseSelect();
+
+    ast::Insert* parseInsertInto();
+
+    ast::Delete* parseDeleteFrom();
 
-    std::unique_ptr<ast::Expression> parseTerm();
+    ast::Update* parseUpdate();
 
-    std::unique_ptr<ast::Expression> parseWhere();
+    ast::ASTNode* parseCreate();
 
-    std::unique_ptr<ast::SelectFrom> parseSelect();
+    ast::CreateTable* parseCreateTable();
 
-    std::unique_ptr<ast::Insert> parseInsertInto();
+    ast::CreateIndex* parseCreateIndex();
 
-    std::unique_ptr<ast::Delete> parseDeleteFrom();
+    ast::CreateMaterializedView* parseCreateMaterializedView();
 
-    std::unique_ptr<ast::Update> parseUpdate();
+    ast::Analyze* parseAnalyze();
 
-    std::unique_ptr<ast::CreateTable> parseCreateTable();
+    ast::Explain* parseExplain();
 
     DataType parseDataType(Token token, size_t line, size_t pos);
 
 public:
-    Parser(std::string_view query) noexcept : ts(query) {}
+    Parser(std::string_view query) : ts(query), arena_(std::make_unique<Arena>()) {}
 
     std::expected<std::unique_ptr<ast::QueryAST>, std::string> parseQuery();
 };
@@ -2,109 +2,248 @@
 
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "common/arena.hpp"
 #include "common/types.hpp"
 
 namespace toydb {
 
 namespace ast {
 
+/**
+ * @brief The concrete type of an ASTNode. Expressions and constants are contiguous ranges, so that
+ * Expression::classof and Constant::classof are range checks.
+ */
+enum class NodeKind : uint8_t {
+    TABLE,
+    TABLE_EXPR,
+    COLUMN_DEFINITION,
+
+    // Expressions
+    CONSTANT_INT,
+    CONSTANT_DOUBLE,
+    CONSTANT_STRING,
+    CONSTANT_NULL,
+    CONSTANT_BOOL,
+    PARAMETER,
+    COLUMN_REF,
+    CONDITION,
+    ARITHMETIC,
+    FUNCTION_CALL,
+    CAST,
+
+    // Statements
+    CREATE_TABLE,
+    CREATE_INDEX,
+    INSERT,
+    UPDATE,
+    DELETE,
+    ANALYZE,
+    SELECT_FROM,
+    EXPLAIN,
+    CREATE_MATERIALIZED_VIEW,
+};
+
+/**
+ * @brief Base of all nodes. Nodes are not polymorphic: code that needs the concrete type switches
+ * on getKind() or uses as<T>(). The nodes of a parsed query are allocated from the arena of its
+ * QueryAST, child nodes are pointers into the same arena.
+ */
 class ASTNode {
-   public:
-    virtual ~ASTNode() = default;
-    virtual std::ostream& print(std::ostream&) const noexcept = 0;
+private:
+    NodeKind kind_;
+
+protected:
+    explicit ASTNode(NodeKind kind) noexcept : kind_(kind) {}
+
+public:
+    NodeKind getKind() const noexcept { return kind_; }
+
+    /**
+     * @brief Print the node as SQL, dispatching on its kind
+     */
+    std::ostream& print(std::ostream&) const noexcept;
     friend std::ostream& operator<<(std::ostream&, const ASTNode&);
 };
 
-struct QueryAST {
-    explicit QueryAST(ASTNode* query) : query_(query) {}
+/**
+ * @brief The node as a T, nullptr if it is none (or node is nullptr)
+ */
+template<typename T>
+const T* as(const ASTNode* node) noexcept {
+    return node && T::classof(node->getKind()) ? static_cast<const T*>(node) : nullptr;
+}
+
+template<typename T>
+T* as(ASTNode* node) noexcept {
+    return node && T::classof(node->getKind()) ? static_cast<T*>(node) : nullptr;
+}
 
-    std::unique_ptr<ASTNode> query_;
+struct QueryAST {
+    /**
+     * @param query Root of the query
+     * @param arena Owner of the nodes, nullptr if the caller owns them and keeps them alive
+     */
+    explicit QueryAST(ASTNode* query, std::unique_ptr<Arena> arena = nullptr) noexcept
+        : arena(std::move(arena)), query_(query) {}
+
+    // Declared first, so that it outlives the nodes it owns
+    std::unique_ptr<Arena> arena;
+    ASTNode* query_;
+    // Number of ? placeholders, which are bound when the query is executed as a prepared statement
+    size_t parameterCount = 0;
     friend std::ostream& operator<<(std::ostream& os, const QueryAST&);
 };
 
 struct Table : public ASTNode {
     std::string name;
     std::string alias;
+    // Set by a TABLESAMPLE clause
+    std::optional<TableSample> sample;
 
-    Table(const std::string& name) noexcept : name(name) {}
+    Table(std::string_view name) : ASTNode(NodeKind::TABLE), name(name) {}
 
-    Table(const std::string& name, const std::string& alias) noexcept : name(name), alias(alias) {}
+    Table(std::string_view name, std::string_view alias)
+        : ASTNode(NodeKind::TABLE), name(name), alias(alias) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::TABLE; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
-struct Expression : public ASTNode {};
+struct Expression : public ASTNode {
+    static constexpr bool classof(NodeKind kind) noexcept {
+        return kind >= NodeKind::CONSTANT_INT && kind <= NodeKind::CAST;
+    }
+
+protected:
+    explicit Expression(NodeKind kind) noexcept : ASTNode(kind) {}
+};
 
 struct Constant : public Expression {
-    virtual ~Constant() = default;
-    virtual std::ostream& print(std::ostream&) const noexcept override = 0;
+    static constexpr bool classof(NodeKind kind) noexcept {
+        return kind >= NodeKind::CONSTANT_INT && kind <= NodeKind::CONSTANT_BOOL;
+    }
+
+protected:
+    explicit Constant(NodeKind kind) noexcept : Expression(kind) {}
 };
 
 struct ConstantInt : public Constant {
     int64_t value;
     bool isInt64;  // true for int64, false for int32
 
-    ConstantInt(int64_t value, bool isInt64) noexcept : value(value), isInt64(isInt64) {}
+    ConstantInt(int64_t value, bool isInt64) noexcept
+        : Constant(NodeKind::CONSTANT_INT), value(value), isInt64(isInt64) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONSTANT_INT; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ConstantDouble : public Constant {
     double value;
 
-    explicit ConstantDouble(double value) noexcept : value(value) {}
+    explicit ConstantDouble(double value) noexcept : Constant(NodeKind::CONSTANT_DOUBLE), value(value) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONSTANT_DOUBLE; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ConstantString : public Constant {
     std::string value;
 
-    explicit ConstantString(const std::string& value) noexcept : value(value) {}
+    explicit ConstantString(std::string_view value) : Constant(NodeKind::CONSTANT_STRING), value(value) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONSTANT_STRING; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ConstantNull : public Constant {
-    ConstantNull() noexcept = default;
+    ConstantNull() noexcept : Constant(NodeKind::CONSTANT_NULL) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONSTANT_NULL; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ConstantBool : public Constant {
     bool value;
 
-    explicit ConstantBool(bool value) noexcept : value(value) {}
+    explicit ConstantBool(bool value) noexcept : Constant(NodeKind::CONSTANT_BOOL), value(value) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONSTANT_BOOL; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief ? placeholder of a prepared statement, numbered from 0 in order of appearance
+ */
+struct Parameter : public Expression {
+    size_t index;
+
+    explicit Parameter(size_t index) noexcept : Expression(NodeKind::PARAMETER), index(index) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::PARAMETER; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ColumnRef : public Expression {
     std::string name;
     std::string table;  // Table name or alias (e.g., "table.column" -> "table")
     std::string alias;  // Column alias
+    std::optional<AggregateFunction> aggregate;  // Set for aggregate calls, COUNT(*) has the name "*"
+    double quantile = 0.5;  // Fraction of APPROX_QUANTILE(column, fraction)
+    // Set for computed select items, e.g. "price * quantity", whose name is the printed expression,
+    // and for aggregates of computed arguments such as SUM(price * quantity)
+    Expression* expression = nullptr;
+
+    explicit ColumnRef(std::string_view name) : Expression(NodeKind::COLUMN_REF), name(name) {}
 
-    explicit ColumnRef(const std::string& name) noexcept : name(name) {}
+    ColumnRef(std::string_view name, std::string_view alias)
+        : Expression(NodeKind::COLUMN_REF), name(name), alias(alias) {}
 
-    ColumnRef(const std::string& name, const std::string& alias) noexcept : name(name), alias(alias) {}
+    ColumnRef(std::string_view table, std::string_view name, std::string_view alias)
+        : Expression(NodeKind::COLUMN_REF), name(name), table(table), alias(alias) {}
 
-    ColumnRef(const std::string& table, const std::string& name, const std::string& alias)
-        noexcept : name(name), table(table), alias(alias) {}
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::COLUMN_REF; }
 
     bool isQualified() const noexcept { return !table.empty(); }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    bool isAggregate() const noexcept { return aggregate.has_value(); }
+
+    bool isComputed() const noexcept { return expression != nullptr; }
+
+    /**
+     * @brief The column or aggregate call without its alias, e.g. "SUM(t.price)"
+     */
+    std::string getExpressionString() const;
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct Condition : public Expression {
     CompareOp op;
-    std::unique_ptr<Expression> left, right;
+    Expression* left = nullptr;
+    Expression* right = nullptr;
+
+    Condition() noexcept : Expression(NodeKind::CONDITION) {}
+
+    Condition(CompareOp op, Expression* left, Expression* right) noexcept
+        : Expression(NodeKind::CONDITION), op(op), left(left), right(right) {}
 
     bool isUnop() const { return right == nullptr; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CONDITION; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 
    private:
     static std::string getOperatorString(CompareOp op) noexcept {
@@ -133,76 +272,201 @@ struct Condition : public Expression {
     }
 };
 
+/**
+ * @brief Binary arithmetic on numbers, e.g. price * quantity. Unary minus is parsed as 0 - x.
+ */
+struct Arithmetic : public Expression {
+    ArithmeticOp op;
+    Expression* left;
+    Expression* right;
+
+    Arithmetic(ArithmeticOp op, Expression* left, Expression* right) noexcept
+        : Expression(NodeKind::ARITHMETIC), op(op), left(left), right(right) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::ARITHMETIC; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief Call of a scalar function, e.g. UPPER(name). a || b is parsed as CONCAT(a, b).
+ */
+struct FunctionCall : public Expression {
+    ScalarFunction function;
+    std::vector<Expression*> arguments;
+
+    FunctionCall(ScalarFunction function, std::vector<Expression*> arguments) noexcept
+        : Expression(NodeKind::FUNCTION_CALL), function(function), arguments(std::move(arguments)) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::FUNCTION_CALL; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief CAST(expression AS type)
+ */
+struct Cast : public Expression {
+    Expression* expression;
+    DataType type;
+
+    Cast(Expression* expression, DataType type) noexcept
+        : Expression(NodeKind::CAST), expression(expression), type(type) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CAST; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
 struct TableExpr : public ASTNode {
     Table table;
-    std::unique_ptr<TableExpr> join;
-    std::unique_ptr<Expression> condition;
+    TableExpr* join = nullptr;
+    Expression* condition = nullptr;
 
-    TableExpr(const Table& table) noexcept : table(table) {}
+    TableExpr(const Table& table) : ASTNode(NodeKind::TABLE_EXPR), table(table) {}
 
-    TableExpr(const Table& table, std::unique_ptr<TableExpr> join) noexcept
-        : table(table), join(std::move(join)) {}
+    TableExpr(const Table& table, TableExpr* join)
+        : ASTNode(NodeKind::TABLE_EXPR), table(table), join(join) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::TABLE_EXPR; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct ColumnDefinition : public ASTNode {
     std::string name;
     DataType type;
 
-    ColumnDefinition(const std::string& name, DataType type) noexcept
-        : name(name), type(std::move(type)) {}
+    ColumnDefinition(std::string_view name, DataType type)
+        : ASTNode(NodeKind::COLUMN_DEFINITION), name(name), type(std::move(type)) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::COLUMN_DEFINITION; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct CreateTable : public ASTNode {
     std::string tableName;
     std::vector<ColumnDefinition> columns;
 
-    CreateTable(const std::string& tableName) noexcept : tableName(tableName) {}
+    CreateTable(std::string_view tableName) : ASTNode(NodeKind::CREATE_TABLE), tableName(tableName) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CREATE_TABLE; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief CREATE INDEX ON table (column): build a secondary index over the column and register it
+ * in the catalog
+ */
+struct CreateIndex : public ASTNode {
+    std::string tableName;
+    std::string columnName;
+
+    CreateIndex(std::string_view tableName, std::string_view columnName)
+        : ASTNode(NodeKind::CREATE_INDEX), tableName(tableName), columnName(columnName) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CREATE_INDEX; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct Insert : public ASTNode {
     std::string tableName;
     std::vector<std::string> columnNames;
-    std::vector<std::vector<std::unique_ptr<Expression>>> values;
+    std::vector<std::vector<Expression*>> values;
+
+    Insert(std::string_view tableName) : ASTNode(NodeKind::INSERT), tableName(tableName) {}
 
-    Insert(const std::string& tableName) noexcept : tableName(tableName) {}
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::INSERT; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct Update : public ASTNode {
     std::string tableName;
-    std::vector<std::pair<std::string, std::unique_ptr<Expression>>> assignments;
-    std::unique_ptr<Expression> where;
+    std::vector<std::pair<std::string, Expression*>> assignments;
+    Expression* where = nullptr;
 
-    Update(const std::string& tableName) noexcept : tableName(tableName) {}
+    Update(std::string_view tableName) : ASTNode(NodeKind::UPDATE), tableName(tableName) {}
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::UPDATE; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct Delete : public ASTNode {
     std::string tableName;
-    std::unique_ptr<Expression> where;
+    Expression* where = nullptr;
+
+    Delete(std::string_view tableName) : ASTNode(NodeKind::DELETE), tableName(tableName) {}
 
-    Delete(const std::string& tableName) noexcept : tableName(tableName) {}
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::DELETE; }
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief ANALYZE table: compute the statistics of the table's files and store them in the catalog
+ */
+struct Analyze : public ASTNode {
+    std::string tableName;
+
+    Analyze(std::string_view tableName) : ASTNode(NodeKind::ANALYZE), tableName(tableName) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::ANALYZE; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 struct SelectFrom : public ASTNode {
     std::vector<ColumnRef> columns;
     std::vector<TableExpr> tables;
-    std::unique_ptr<Expression> where;
+    Expression* where = nullptr;
+    std::vector<ColumnRef> groupBy;
     std::optional<ColumnRef> orderBy;
+    bool orderByDescending = false;
+    std::optional<int64_t> limit;
     bool distinct = false;
     bool selectAll = false;  // true when SELECT * is used
 
-    std::ostream& print(std::ostream&) const noexcept override;
+    SelectFrom() noexcept : ASTNode(NodeKind::SELECT_FROM) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::SELECT_FROM; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief EXPLAIN [ANALYZE] query: print the plan of the query, with ANALYZE run it and print the
+ * profile of every operator
+ */
+struct Explain : public ASTNode {
+    bool analyze;
+    SelectFrom* query;
+
+    Explain(bool analyze, SelectFrom* query) noexcept : ASTNode(NodeKind::EXPLAIN), analyze(analyze), query(query) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::EXPLAIN; }
+
+    std::ostream& print(std::ostream&) const noexcept;
+};
+
+/**
+ * @brief CREATE MATERIALIZED VIEW name AS query: store the result of the query in the catalog,
+ * where it is kept up to date as rows are inserted and answers the same query
+ */
+struct CreateMaterializedView : public ASTNode {
+    std::string name;
+    SelectFrom* query;
+
+    CreateMaterializedView(std::string_view name, SelectFrom* query)
+        : ASTNode(NodeKind::CREATE_MATERIALIZED_VIEW), name(name), query(query) {}
+
+    static constexpr bool classof(NodeKind kind) noexcept { return kind == NodeKind::CREATE_MATERIALIZED_VIEW; }
+
+    std::ostream& print(std::ostream&) const noexcept;
 };
 
 std::ostream& operator<<(std::ostream& os, const ASTNode& node);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include "planner/logical_operator.hpp"
+#include "planner/physical_planner.hpp"
+
+namespace toydb {
+
+/**
+ * @brief The logical plan as a tree, one operator per line, children indented below their parent
+ */
+std::string explainPlan(const LogicalQueryPlan& plan);
+
+/**
+ * @brief The logical plan annotated with the profile of every operator, of a plan built from it
+ *        with profiling (see PhysicalPlanner::setProfiling) and run to completion
+ */
+std::string explainPlan(const LogicalQueryPlan& plan, const PhysicalQueryPlan& profiled);
+
+/**
+ * @brief Plan the query like planner but with profiling enabled, run it discarding its result,
+ *        then explain it. Used for EXPLAIN ANALYZE.
+ */
+std::string explainAnalyze(const LogicalQueryPlan& plan, const PhysicalPlanner& planner);
+
+}  // namespace toydb
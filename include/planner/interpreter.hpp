@@ -5,6 +5,7 @@
 #include <string>
 #include <unordered_map>
 #include "common/errors.hpp"
+#include "engine/batch_allocator.hpp"
 #include "parser/query_ast.hpp"
 #include "planner/logical_operator.hpp"
 #include "storage/catalog.hpp"
@@ -30,6 +31,23 @@ class PlaceholderCatalog {
     virtual DataType getColumnType(const ColumnId& columnId) = 0;
 };
 
+/**
+ * @brief Resolves the tables and columns of queries against a Catalog
+ */
+class CatalogQueryAdapter : public PlaceholderCatalog {
+   private:
+    Catalog* catalog_;
+
+   public:
+    explicit CatalogQueryAdapter(Catalog* catalog) : catalog_(catalog) {}
+
+    std::optional<TableMetadata> getTable(const std::string& name) override;
+
+    std::optional<ColumnId> resolveColumn(const std::string& tableName, const std::string& columnName) override;
+
+    DataType getColumnType(const ColumnId& columnId) override;
+};
+
 struct QueryContext {
     // Map: alias -> actual table name
     std::unordered_map<std::string, std::string> aliasToTable;
@@ -51,6 +69,15 @@ struct QueryContext {
     }
 };
 
+/**
+ * @brief Rows of an INSERT, converted to the types of the table's columns
+ */
+struct InsertBatches {
+    TableId tableId;
+    // Every batch has a column per column of the table, in the table's order
+    std::vector<RowVector> batches;
+};
+
 /**
  * @brief Executes the query given as the AST
  */
@@ -62,10 +89,27 @@ class SQLInterpreter {
 
     std::unique_ptr<PredicateExpr> lowerConstant(const ast::Constant* constant);
 
+    /**
+     * @brief Slot for the value of a parameter compared with other
+     */
+    std::unique_ptr<PredicateExpr> lowerParameter(const ast::Parameter& parameter, const PredicateExpr* other);
+
     std::unique_ptr<PredicateExpr> lowerPredicate(const ast::Expression* expr, const QueryContext& context);
 
     std::unique_ptr<PredicateExpr> lowerCondition(const ast::Condition* condition, const QueryContext& context);
 
+    /**
+     * @brief Expression computing a value per row, e.g. of a computed SELECT column. Operands are
+     *        cast to their common type.
+     */
+    std::unique_ptr<ValueExpr> lowerValue(const ast::Expression* expr, const QueryContext& context);
+
+    std::shared_ptr<LogicalOperator> lowerAggregation(const ast::SelectFrom& selectFrom, const QueryContext& context,
+                                                      std::shared_ptr<LogicalOperator> input,
+                                                      std::vector<ColumnId>& outputColumns);
+
+    SortKey lowerOrderBy(const ast::SelectFrom& selectFrom, const QueryContext& context, const AggregateOp* aggregateOp);
+
    public:
     explicit SQLInterpreter(PlaceholderCatalog* catalog) : catalog_(catalog) {}
 
@@ -85,9 +129,14 @@ class SQLInterpreter {
         throw NotYetImplementedError("CREATE TABLE");
     }
 
-    LogicalQueryPlan handleInsert([[maybe_unused]] const ast::Insert& insert) {
-        throw NotYetImplementedError("INSERT");
-    }
+    /**
+     * @brief Convert the rows of an INSERT into batches of the table's columns. Columns missing
+     *        from the column list are NULL. INSERTs have no query plan, see TableWriter.
+     * @param allocator Owns the columns of the batches
+     * @throws UnresolvedColumnException if the table or a column doesn't exist
+     * @throws SQLRuntimeException if a value doesn't fit its column
+     */
+    InsertBatches handleInsert(const ast::Insert& insert, BatchAllocator& allocator);
 
     LogicalQueryPlan handleUpdate([[maybe_unused]] const ast::Update& update) {
         throw NotYetImplementedError("UPDATE");
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/predicate_expr.hpp"
+#include "planner/logical_operator.hpp"
+#include "storage/catalog.hpp"
+#include "storage/column_statistics.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Reorders the inner joins and cross products of a LogicalQueryPlan by estimated cost.
+ *
+ * A join region is a tree of filters, cross products and inner joins. Its leaves are the relations
+ * to join and its predicates are split into conjuncts. Conjuncts that reference a single relation
+ * are pushed down onto it. The cheapest join order is searched with dynamic programming over the
+ * subsets of relations, costing a plan by the sum of the estimated sizes of its intermediate
+ * results. Trees with a cross product are only chosen if the conjuncts don't connect all
+ * relations. Regions with more than MAX_DP_RELATIONS relations are ordered greedily instead.
+ *
+ * Cardinalities come from the row counts of the catalog, selectivities from the distinct counts,
+ * min/max values and null fractions of its column statistics. The smaller input of every join is
+ * placed on the left, the build side of the physical joins. Every join gets one equality between
+ * its inputs as condition if there is one, the other conjuncts are applied by a filter above it.
+ */
+class JoinOrderOptimizer {
+private:
+    Catalog* catalog_;
+    std::unordered_map<ColumnId, std::optional<ColumnStatistics>, ColumnIdHash> statistics_;
+
+    struct JoinRegion;
+
+    std::shared_ptr<LogicalOperator> optimizeOperator(const std::shared_ptr<LogicalOperator>& op);
+
+    std::shared_ptr<LogicalOperator> optimizeRegion(const std::shared_ptr<LogicalOperator>& op);
+
+    void collectRegion(const std::shared_ptr<LogicalOperator>& op, JoinRegion& region);
+
+    const ColumnStatistics* getStatistics(const ColumnId& columnId);
+
+    /**
+     * @brief Distinct values of a column, the row count of its table if the catalog doesn't know
+     */
+    double getDistinctCount(const ColumnId& columnId);
+
+    double estimateCompareSelectivity(const CompareExpr* compare);
+
+public:
+    // Largest region ordered with dynamic programming, 3^n subset pairs are enumerated
+    static constexpr size_t MAX_DP_RELATIONS = 12;
+
+    // Rows assumed for relations whose size the catalog doesn't know
+    static constexpr double DEFAULT_CARDINALITY = 1000.0;
+
+    explicit JoinOrderOptimizer(Catalog* catalog) : catalog_(catalog) {}
+
+    void optimize(LogicalQueryPlan& plan);
+
+    /**
+     * @brief Estimated number of rows produced by a logical operator
+     */
+    double estimateCardinality(const LogicalOperator* op);
+
+    /**
+     * @brief Estimated fraction of rows for which a predicate is TRUE
+     */
+    double estimateSelectivity(const PredicateExpr* predicate);
+};
+
+}  // namespace toydb
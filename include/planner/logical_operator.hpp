@@ -1,11 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include "common/assert.hpp"
 #include "common/types.hpp"
+#include "engine/aggregate_hash_table.hpp"
 #include "engine/predicate_expr.hpp"
+#include "engine/sort.hpp"
+#include "engine/value_expr.hpp"
 
 namespace toydb {
 
@@ -51,6 +60,13 @@ public:
         }
     }
 
+    void removeParent(LogicalOperator* parent) {
+        auto it = std::find(parents_.begin(), parents_.end(), parent);
+        if (it != parents_.end()) {
+            parents_.erase(it);
+        }
+    }
+
     size_t getChildCount() const noexcept {
         return children_.size();
     }
@@ -64,6 +80,17 @@ public:
         return children_[index];
     }
 
+    /**
+     * @brief Replace a child, this operator is no longer a parent of the old one
+     */
+    void replaceChild(size_t index, std::shared_ptr<LogicalOperator> child) {
+        tdb_assert(index < children_.size(), "Child index out of range");
+        tdb_assert(child != nullptr, "Cannot replace a child with null");
+        children_[index]->removeParent(this);
+        child->addParent(this);
+        children_[index] = std::move(child);
+    }
+
     virtual std::ostream& print(std::ostream& os) const = 0;
 
     friend std::ostream& operator<<(std::ostream& os, const LogicalOperator& op) {
@@ -98,6 +125,10 @@ public:
         return root_.get();
     }
 
+    const std::shared_ptr<LogicalOperator>& getSharedRoot() const noexcept {
+        return root_;
+    }
+
     bool hasRoot() const noexcept {
         return root_ != nullptr;
     }
@@ -116,22 +147,55 @@ public:
     }
 };
 
+/**
+ * @brief Produces the given columns, either passed through from the child or computed from its
+ * columns by an expression
+ */
 class ProjectionOp : public LogicalOperator {
 private:
     std::vector<ColumnId> columns_;
+    // Expression computing each column, nullptr for columns of the child
+    std::vector<std::unique_ptr<ValueExpr>> expressions_;
 
 public:
+    // Computed columns are not table columns, their ids start here to not collide with the catalog's
+    static constexpr uint64_t OUTPUT_COLUMN_ID_BASE = uint64_t{3} << 61;
+
     explicit ProjectionOp(std::vector<ColumnId> columns)
         : columns_(std::move(columns)) {}
 
+    /**
+     * @param expressions Expression of every column, nullptr for columns passed through
+     */
+    ProjectionOp(std::vector<ColumnId> columns, std::vector<std::unique_ptr<ValueExpr>> expressions)
+        : columns_(std::move(columns)), expressions_(std::move(expressions)) {
+        tdb_assert(expressions_.size() == columns_.size(), "Projection of {} columns has {} expressions",
+                   columns_.size(), expressions_.size());
+    }
+
     const std::vector<ColumnId>& getColumns() const noexcept {
         return columns_;
     }
 
+    /**
+     * @brief Expression computing the i-th column, nullptr if the column is passed through
+     */
+    const ValueExpr* getExpression(size_t i) const noexcept {
+        return expressions_.empty() ? nullptr : expressions_[i].get();
+    }
+
+    bool hasExpressions() const noexcept {
+        return std::any_of(expressions_.begin(), expressions_.end(), [](const auto& expr) { return expr != nullptr; });
+    }
+
     std::ostream& print(std::ostream& os) const override {
         os << "Projection[";
         for (size_t i = 0; i < columns_.size(); ++i) {
             if (i > 0) os << ", ";
+            const ValueExpr* expression = getExpression(i);
+            if (expression) {
+                os << expression->toString() << " AS ";
+            }
             os << columns_[i].getName();
         }
         os << "]";
@@ -318,13 +382,132 @@ public:
     }
 };
 
+/**
+ * @brief Groups its child's rows by the group columns and computes the aggregates per group.
+ * Produces the group columns followed by the aggregate outputs.
+ */
+class AggregateOp : public LogicalOperator {
+private:
+    std::vector<ColumnDescriptor> groupBy_;
+    std::vector<AggregateSpec> aggregates_;
+
+public:
+    // Aggregate outputs are not table columns, their ids start here to not collide with the catalog's
+    static constexpr uint64_t OUTPUT_COLUMN_ID_BASE = uint64_t{1} << 62;
+
+    AggregateOp(std::vector<ColumnDescriptor> groupBy, std::vector<AggregateSpec> aggregates)
+        : groupBy_(std::move(groupBy)), aggregates_(std::move(aggregates)) {}
+
+    const std::vector<ColumnDescriptor>& getGroupBy() const noexcept {
+        return groupBy_;
+    }
+
+    const std::vector<AggregateSpec>& getAggregates() const noexcept {
+        return aggregates_;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        os << "Aggregate[";
+        for (size_t i = 0; i < groupBy_.size(); ++i) {
+            if (i > 0) os << ", ";
+            os << groupBy_[i].columnId.getName();
+        }
+        if (!groupBy_.empty() && !aggregates_.empty()) {
+            os << "; ";
+        }
+        for (size_t i = 0; i < aggregates_.size(); ++i) {
+            if (i > 0) os << ", ";
+            os << aggregates_[i].output.getName();
+        }
+        os << "]";
+        return os;
+    }
+};
+
+class SortOp : public LogicalOperator {
+private:
+    std::vector<SortKey> keys_;
+
+public:
+    explicit SortOp(std::vector<SortKey> keys)
+        : keys_(std::move(keys)) {}
+
+    const std::vector<SortKey>& getKeys() const noexcept {
+        return keys_;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        os << "Sort[";
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (i > 0) os << ", ";
+            os << keys_[i].column.getName() << (keys_[i].ascending ? " ASC" : " DESC");
+        }
+        os << "]";
+        return os;
+    }
+};
+
+class LimitOp : public LogicalOperator {
+private:
+    int64_t limit_;
+
+public:
+    explicit LimitOp(int64_t limit)
+        : limit_(limit) {}
+
+    int64_t getLimit() const noexcept {
+        return limit_;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        os << "Limit[" << limit_ << "]";
+        return os;
+    }
+};
+
+/**
+ * @brief A sort followed by a limit: only the first rows by the sort keys are kept
+ */
+class TopNOp : public LogicalOperator {
+private:
+    std::vector<SortKey> keys_;
+    int64_t limit_;
+
+public:
+    TopNOp(std::vector<SortKey> keys, int64_t limit)
+        : keys_(std::move(keys)), limit_(limit) {}
+
+    const std::vector<SortKey>& getKeys() const noexcept {
+        return keys_;
+    }
+
+    int64_t getLimit() const noexcept {
+        return limit_;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        os << "TopN[" << limit_;
+        for (const SortKey& key : keys_) {
+            os << ", " << key.column.getName() << (key.ascending ? " ASC" : " DESC");
+        }
+        os << "]";
+        return os;
+    }
+};
+
 class TableScanOp : public LogicalOperator {
 private:
     std::vector<ColumnId> columns_;
+    std::optional<TableSample> sample_;
+    // Files [first, second) of the table, nullopt for all files
+    std::optional<std::pair<size_t, size_t>> fileRange_;
 
 public:
-    explicit TableScanOp(std::vector<ColumnId> columns)
-        : columns_(std::move(columns)) {
+    /**
+     * @param sample Only read a sample of the table, see TableSample
+     */
+    explicit TableScanOp(std::vector<ColumnId> columns, std::optional<TableSample> sample = std::nullopt)
+        : columns_(std::move(columns)), sample_(sample) {
         if (!columns_.empty()) {
             const TableId& firstTableId = columns_[0].getTableId();
             for (size_t i = 1; i < columns_.size(); ++i) {
@@ -339,6 +522,21 @@ public:
         return columns_;
     }
 
+    const std::optional<TableSample>& getSample() const noexcept {
+        return sample_;
+    }
+
+    /**
+     * @brief Only read the files [begin, end) of the table, e.g. to maintain a materialized view
+     */
+    void setFileRange(size_t begin, size_t end) noexcept {
+        fileRange_ = {begin, end};
+    }
+
+    const std::optional<std::pair<size_t, size_t>>& getFileRange() const noexcept {
+        return fileRange_;
+    }
+
     std::ostream& print(std::ostream& os) const override {
         os << "TableScan[";
         if (!columns_.empty()) {
@@ -347,9 +545,128 @@ public:
                 os << " (" << columns_.size() << " columns)";
             }
         }
+        if (sample_) {
+            os << ", " << toString(sample_->method) << " " << sample_->percent << "%";
+        }
+        if (fileRange_) {
+            os << ", files " << fileRange_->first << "-" << fileRange_->second;
+        }
         os << "]";
         return os;
     }
 };
 
+/**
+ * @brief Reads the contents of a materialized view in place of the part of a plan the view
+ * materializes. The view of an aggregate holds the partial states of its groups (see
+ * AggregateHashTable::exportPartialStates) and produces the output of the aggregate, other views
+ * hold their rows encoded with BatchCodec.
+ */
+class MaterializedViewScanOp : public LogicalOperator {
+private:
+    std::string name_;
+    std::filesystem::path path_;
+    // Produced columns of a view of rows
+    std::vector<ColumnDescriptor> columns_;
+    std::vector<ColumnDescriptor> groupBy_;
+    // Empty for a view of rows
+    std::vector<AggregateSpec> aggregates_;
+
+public:
+    /**
+     * @brief A view of rows with the given columns
+     */
+    MaterializedViewScanOp(std::string name, std::filesystem::path path, std::vector<ColumnDescriptor> columns)
+        : name_(std::move(name)), path_(std::move(path)), columns_(std::move(columns)) {}
+
+    /**
+     * @brief A view of the aggregates of the groups
+     */
+    MaterializedViewScanOp(std::string name, std::filesystem::path path, std::vector<ColumnDescriptor> groupBy,
+                           std::vector<AggregateSpec> aggregates)
+        : name_(std::move(name)),
+          path_(std::move(path)),
+          groupBy_(std::move(groupBy)),
+          aggregates_(std::move(aggregates)) {}
+
+    const std::string& getName() const noexcept {
+        return name_;
+    }
+
+    const std::filesystem::path& getPath() const noexcept {
+        return path_;
+    }
+
+    bool isAggregated() const noexcept {
+        return !aggregates_.empty();
+    }
+
+    const std::vector<ColumnDescriptor>& getColumns() const noexcept {
+        return columns_;
+    }
+
+    const std::vector<ColumnDescriptor>& getGroupBy() const noexcept {
+        return groupBy_;
+    }
+
+    const std::vector<AggregateSpec>& getAggregates() const noexcept {
+        return aggregates_;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        os << "MaterializedViewScan[" << name_ << "]";
+        return os;
+    }
+};
+
+using ColumnSet = std::unordered_set<ColumnId, ColumnIdHash>;
+
+/**
+ * @brief Columns produced by a logical operator, in the order they are produced
+ */
+inline std::vector<ColumnId> getOutputColumnList(const LogicalOperator* op) {
+    if (auto* scan = dynamic_cast<const TableScanOp*>(op)) {
+        return scan->getColumns();
+    }
+    if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+        return projection->getColumns();
+    }
+    if (auto* aggregate = dynamic_cast<const AggregateOp*>(op)) {
+        std::vector<ColumnId> columns;
+        for (const ColumnDescriptor& key : aggregate->getGroupBy()) {
+            columns.push_back(key.columnId);
+        }
+        for (const AggregateSpec& spec : aggregate->getAggregates()) {
+            columns.push_back(spec.output);
+        }
+        return columns;
+    }
+    if (auto* view = dynamic_cast<const MaterializedViewScanOp*>(op)) {
+        std::vector<ColumnId> columns;
+        for (const ColumnDescriptor& column : view->isAggregated() ? view->getGroupBy() : view->getColumns()) {
+            columns.push_back(column.columnId);
+        }
+        for (const AggregateSpec& spec : view->getAggregates()) {
+            columns.push_back(spec.output);
+        }
+        return columns;
+    }
+
+    // Filters, sorts and limits pass their input through, joins concatenate their inputs
+    std::vector<ColumnId> columns;
+    for (const auto& child : op->getChildren()) {
+        std::vector<ColumnId> childColumns = getOutputColumnList(child.get());
+        columns.insert(columns.end(), childColumns.begin(), childColumns.end());
+    }
+    return columns;
+}
+
+/**
+ * @brief Columns produced by a logical operator
+ */
+inline ColumnSet getOutputColumns(const LogicalOperator* op) {
+    std::vector<ColumnId> columns = getOutputColumnList(op);
+    return ColumnSet(columns.begin(), columns.end());
+}
+
 } // namespace toydb
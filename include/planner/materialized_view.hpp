@@ -0,0 +1,85 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include "planner/logical_operator.hpp"
+#include "storage/catalog.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Maintains the materialized views of a catalog and answers their queries from them.
+ *
+ * A view holds the result of a SELECT of scans, filters, projections and inner joins, optionally
+ * aggregated. The view of an aggregate holds the partial states of its groups (see
+ * AggregateHashTable::exportPartialStates), the projection above the aggregate runs whenever
+ * the view is read. Other views hold their rows.
+ *
+ * Tables only grow by appended files, whether INSERTs write them directly or the InsertLog
+ * applies its records, so a view is maintained from the files appended since its last refresh.
+ * With the old files O and the appended files D of the tables T1 .. Tn, the rows a join gains are
+ * the union over i of T1 .. T(i-1) x Di x O(i+1) .. On, where every table before Ti is read with
+ * all of its files. The gained rows are appended to the rows of a view, or their partial states
+ * merged into its groups. Refreshed contents are written to a new file, which replaces the old
+ * one in the catalog.
+ *
+ * Queries are answered from a view if their text, normalized like the keys of the PlanCache,
+ * equals the query of the view. Not thread-safe: refreshing and creating views must exclude
+ * other statements on the catalog, like INSERTs.
+ */
+class MaterializedViewManager {
+private:
+    Catalog* catalog_;
+
+    /**
+     * @brief Write the contents of a view covering the current files of its tables and store the
+     *        view in the catalog
+     * @param previous The view to refresh, whose contents the appended files are added to,
+     *        nullptr to read all files
+     */
+    MaterializedViewMetadata materialize(const std::string& name, const std::string& query,
+                                         const MaterializedViewMetadata* previous);
+
+public:
+    explicit MaterializedViewManager(Catalog* catalog) : catalog_(catalog) {}
+
+    /**
+     * @brief The normalized SELECT of a statement (see PlanCache::normalize), without a leading
+     *        EXPLAIN [ANALYZE] or CREATE MATERIALIZED VIEW name AS
+     */
+    static std::string normalizeQuery(std::string_view statement);
+
+    /**
+     * @param query A query normalized with normalizeQuery
+     * @return nullopt if no view materializes the query
+     */
+    std::optional<MaterializedViewMetadata> findView(const std::string& query) const;
+
+    /**
+     * @brief Whether files were appended to the tables of the view since its last refresh
+     */
+    bool isStale(const MaterializedViewMetadata& view) const;
+
+    /**
+     * @brief Materialize a query as a new view
+     * @param query A query normalized with normalizeQuery
+     * @throws SQLRuntimeException if a view of the name exists or the view can't be written
+     * @throws NotYetImplementedError if the query can't be maintained incrementally, e.g. if it
+     *         sorts or samples its rows
+     */
+    MaterializedViewMetadata create(const std::string& name, const std::string& query);
+
+    /**
+     * @brief Bring the contents of a view up to date with the files appended to its tables
+     * @throws SQLRuntimeException if the view can't be read or written
+     */
+    MaterializedViewMetadata refresh(const MaterializedViewMetadata& view);
+
+    /**
+     * @brief Plan the query of a view, reading the contents of the view instead of its tables
+     */
+    LogicalQueryPlan plan(const MaterializedViewMetadata& view) const;
+};
+
+}  // namespace toydb
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "engine/profiling.hpp"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/logical_operator.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+class FragmentDispatcher;
+
+/**
+ * @brief An executable operator tree. Owns the operators and the handles of the scanned tables.
+ */
+class PhysicalQueryPlan {
+private:
+    // Declared first, so that the iterators of the scans are destroyed before their handles
+    std::vector<std::unique_ptr<TableHandle>> tables_;
+    std::vector<std::unique_ptr<PhysicalOperator>> operators_;
+    PhysicalOperator* root_ = nullptr;
+
+    // Only set if the plan was built with profiling
+    std::unique_ptr<HardwareCounterGroup> counters_;
+    std::unordered_map<const LogicalOperator*, const ProfilingExec*> profiles_;
+
+public:
+    PhysicalQueryPlan() = default;
+
+    PhysicalQueryPlan(const PhysicalQueryPlan&) = delete;
+    PhysicalQueryPlan& operator=(const PhysicalQueryPlan&) = delete;
+
+    PhysicalQueryPlan(PhysicalQueryPlan&&) = default;
+    PhysicalQueryPlan& operator=(PhysicalQueryPlan&&) = default;
+
+    template<typename Op, typename... Args>
+    Op* add(Args&&... args) {
+        auto op = std::make_unique<Op>(std::forward<Args>(args)...);
+        Op* result = op.get();
+        operators_.push_back(std::move(op));
+        return result;
+    }
+
+    TableHandle* addTable(std::unique_ptr<TableHandle> table) {
+        tables_.push_back(std::move(table));
+        return tables_.back().get();
+    }
+
+    void setRoot(PhysicalOperator* root) noexcept {
+        root_ = root;
+    }
+
+    PhysicalOperator* getRoot() const noexcept {
+        return root_;
+    }
+
+    bool hasRoot() const noexcept {
+        return root_ != nullptr;
+    }
+
+    /**
+     * @brief Initialize the root and run it to completion, passing every batch to consume. Counts
+     *        the query, its latency and failures in the global metrics.
+     * @return Number of selected rows produced
+     */
+    int64_t run(const std::function<void(const RowVector&)>& consume = {});
+
+    void setHardwareCounters(std::unique_ptr<HardwareCounterGroup> counters) noexcept {
+        counters_ = std::move(counters);
+    }
+
+    /**
+     * @brief Profile the physical operator lowered from op
+     * @return The operator to use in place of physical
+     */
+    PhysicalOperator* addProfiling(const LogicalOperator* op, PhysicalOperator* physical) {
+        ProfilingExec* profiling = add<ProfilingExec>(physical, counters_.get());
+        profiles_[op] = profiling;
+        return profiling;
+    }
+
+    /**
+     * @return nullptr if the plan was built without profiling, or op has no operator of its own,
+     *         like a filter fused into a scan
+     */
+    const OperatorProfile* getProfile(const LogicalOperator* op) const {
+        auto it = profiles_.find(op);
+        return it == profiles_.end() ? nullptr : &it->second->getProfile();
+    }
+};
+
+/**
+ * @brief Lowers a LogicalQueryPlan into a tree of PhysicalOperators.
+ *
+ * Columns are pruned top-down: every operator only asks its input for the columns it or its
+ * ancestors reference, so scans only read those. A filter directly above a scan is fused into
+ * the scan and pushed down to the file readers. Joins with a single equality between a column of each input use a HashJoinExec, all
+ * other joins and cross products a NestedLoopJoinExec. The left input of a join is its build side.
+ * Equi-joins of two inputs estimated at RADIX_JOIN_MIN_ROWS rows or more use a RadixHashJoinExec.
+ * Equi-joins and inner range joins (<, <=, >, >=) whose inputs are both sorted ascending on their
+ * keys, e.g. by a Sort, are merged by a SortMergeJoinExec instead. A TABLESAMPLE SYSTEM of a
+ * table with SYSTEM_SAMPLE_MIN_FILES files or more skips whole files, otherwise the scan samples.
+ * With more than one worker, aggregates and top-ns of inputs estimated at PARALLEL_MIN_ROWS rows
+ * or more run as pipelines into a HashAggregateSink or a TopNSink (see ParallelHashAggregateExec
+ * and ParallelTopNExec), otherwise on a single thread. If their input is a chain of filters and
+ * projections above a table scan, the workers read the table through a ParallelScan and apply the
+ * chain to their morsels, so that the scan runs on the workers as well. The estimates of a plan
+ * are computed once and shared by all operators that look at them.
+ * Materialized views are read by a ViewScanExec, or merged by a ViewAggregateExec if they hold
+ * the partial states of an aggregate.
+ *
+ * With a dispatcher, tables are read by the workers of a cluster: the scans, together with the
+ * filters and projections above them, become PlanFragments gathered by a GatherExec, and
+ * aggregates of such inputs are computed partially by the workers and merged by a
+ * GatherAggregateExec. Equi-joins of gathered inputs are radix partitioned by the coordinator.
+ * Since the workers don't repartition rows among each other, the coordinator receives all rows
+ * of both inputs: joins of a gathered input estimated at more than GATHER_JOIN_MAX_ROWS rows are
+ * refused with a NotYetImplementedError.
+ */
+class PhysicalPlanner {
+private:
+    Catalog* catalog_;
+    int64_t batchSize_;
+    size_t workerCount_;
+    bool profiling_ = false;
+    FragmentDispatcher* dispatcher_ = nullptr;
+    // Estimates of the plan being built
+    std::optional<JoinOrderOptimizer> estimator_;
+    std::unordered_map<const LogicalOperator*, double> estimates_;
+
+    /**
+     * @brief The source of a pipeline and the streaming operators every worker applies to its morsels
+     */
+    struct ScanPipeline {
+        MorselSourceFactory source;
+        PipelineFactory factory;
+    };
+
+    /**
+     * @param required Columns the parent needs from op, nullopt if it needs all of them
+     */
+    PhysicalOperator* lower(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                            PhysicalQueryPlan& plan);
+
+    PhysicalOperator* lowerOperator(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                                    PhysicalQueryPlan& plan);
+
+    /**
+     * @brief Estimated number of rows produced by op, computed once per plan
+     */
+    double estimateRows(const LogicalOperator* op);
+
+    /**
+     * @brief Whether an aggregate or a top-n consumes input on the workers of a PipelineExecutor
+     */
+    bool isParallel(const LogicalOperator* input);
+
+    /**
+     * @brief Add a handle of the scanned table to the plan, restricted to the files the scan reads
+     */
+    TableHandle* addTable(const TableScanOp* scan, PhysicalQueryPlan& plan);
+
+    static std::vector<ColumnId> getScanColumns(const TableScanOp* scan, const std::optional<ColumnSet>& required);
+
+    /**
+     * @brief Lower a chain of filters and projections ending at a table scan into a pipeline, so
+     *        that the workers read the table themselves
+     * @return nullopt if op is not such a chain, the scan samples, or the plan is profiled or
+     *         gathered from a cluster
+     */
+    std::optional<ScanPipeline> lowerScanPipeline(const LogicalOperator* op, std::optional<ColumnSet> required,
+                                                  PhysicalQueryPlan& plan);
+
+    PhysicalOperator* lowerScan(const TableScanOp* scan, const std::optional<ColumnSet>& required,
+                                std::unique_ptr<PredicateExpr> predicate, PhysicalQueryPlan& plan);
+
+    /**
+     * @brief Gather the output of op from the workers, op must satisfy PlanFragment::canDistribute
+     * @return nullptr if op can't be encoded as a fragment
+     */
+    PhysicalOperator* lowerGather(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                                  PhysicalQueryPlan& plan);
+
+    /**
+     * @return nullptr if the input of the aggregate can't be encoded as a fragment
+     */
+    PhysicalOperator* lowerGatherAggregate(const AggregateOp* aggregate, PhysicalQueryPlan& plan);
+
+    PhysicalOperator* lowerJoin(const LogicalOperator* op, const PredicateExpr* condition, JoinType joinType,
+                                const std::optional<ColumnSet>& required, PhysicalQueryPlan& plan);
+
+public:
+    // Rows of both inputs above which an equi-join is radix partitioned, about where the hash
+    // table of the build side no longer fits into the caches
+    static constexpr double RADIX_JOIN_MIN_ROWS = 1'000'000.0;
+    // Rows of the input above which aggregates and top-ns are computed by several workers,
+    // below that the partial results cost more to merge than the workers save
+    static constexpr double PARALLEL_MIN_ROWS = 100'000.0;
+    // Rows of a gathered input above which a join is refused, the coordinator would have to
+    // receive and partition them on its own. Estimated from the coordinator's catalog.
+    static constexpr double GATHER_JOIN_MAX_ROWS = 10'000'000.0;
+    // Tables with fewer files are sampled by batch, sampling their files would keep too few or too many rows
+    static constexpr size_t SYSTEM_SAMPLE_MIN_FILES = 8;
+
+    explicit PhysicalPlanner(Catalog* catalog, int64_t batchSize = 8192,
+                             size_t workerCount = std::thread::hardware_concurrency())
+        : catalog_(catalog), batchSize_(batchSize), workerCount_(workerCount) {}
+
+    /**
+     * @brief Profile every operator of the plans built from now on (see ProfilingExec). Hardware
+     *        counters count the thread calling plan(), which must also run the plan.
+     */
+    void setProfiling(bool enabled) noexcept {
+        profiling_ = enabled;
+    }
+
+    /**
+     * @brief Read the tables of the plans built from now on on the workers of dispatcher, nullptr
+     *        to read the local files
+     */
+    void setDispatcher(FragmentDispatcher* dispatcher) noexcept {
+        dispatcher_ = dispatcher;
+    }
+
+    /**
+     * @throws NotYetImplementedError if the plan contains an operator without a physical implementation
+     */
+    PhysicalQueryPlan plan(const LogicalQueryPlan& logicalPlan);
+};
+
+}  // namespace toydb
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/aggregate_hash_table.hpp"
+#include "engine/predicate_expr.hpp"
+#include "planner/logical_operator.hpp"
+#include "storage/catalog.hpp"
+
+namespace toydb {
+
+class PhysicalPlanner;
+
+/**
+ * @brief The part of a query the workers of a cluster run, see PhysicalPlanner::setDispatcher.
+ *
+ * A fragment scans the local files of one table, filters them and produces some of its columns.
+ * If it has aggregates, the workers aggregate the rows by the group columns instead and send
+ * the partial states of the groups (see AggregateHashTable::exportPartialStates). Columns are
+ * encoded by name, so that every worker resolves them against its own catalog. The coordinator
+ * receives the produced columns by position.
+ */
+struct PlanFragment {
+    // Produced columns, or the columns the aggregates read. All belong to the same table.
+    std::vector<ColumnId> columns;
+    // nullptr if every row is produced
+    std::unique_ptr<PredicateExpr> predicate;
+    std::optional<TableSample> sample;
+    std::vector<ColumnDescriptor> groupBy;
+    // Empty if the rows are produced instead of aggregated
+    std::vector<AggregateSpec> aggregates;
+
+    // Workers send their output in payloads of about this size
+    static constexpr size_t PAYLOAD_SIZE = 1024 * 1024;
+
+    bool isAggregated() const noexcept {
+        return !aggregates.empty();
+    }
+
+    /**
+     * @brief Whether op can run on the workers: a scan, optionally filtered and projected to some
+     *        of its columns
+     */
+    static bool canDistribute(const LogicalOperator* op);
+
+    /**
+     * @param op An operator for which canDistribute() holds
+     * @param columns Columns of the output of op the fragment produces
+     * @return nullopt if a predicate of op can't be encoded
+     */
+    static std::optional<PlanFragment> fromPlan(const LogicalOperator* op, std::vector<ColumnId> columns);
+
+    /**
+     * @brief Aggregate the output of the fragment on the workers
+     */
+    void aggregate(std::vector<ColumnDescriptor> groupByColumns, std::vector<AggregateSpec> aggregateSpecs) {
+        groupBy = std::move(groupByColumns);
+        aggregates = std::move(aggregateSpecs);
+    }
+
+    std::string encode() const;
+
+    /**
+     * @brief Decode a fragment, resolving its table and columns in the catalog
+     * @throws SQLRuntimeException if the bytes are not an encoded fragment or name unknown columns
+     */
+    static PlanFragment decode(std::string_view bytes, const Catalog& catalog);
+
+    /**
+     * @brief Run the fragment against the local files of its table, passing the encoded batches
+     *        or partial aggregate states to out in payloads of about PAYLOAD_SIZE bytes
+     * @param planner Plans the fragment, must not have a dispatcher
+     * @return Number of rows, or of groups if the fragment is aggregated
+     */
+    int64_t run(PhysicalPlanner& planner, const std::function<void(std::string_view)>& out) const;
+};
+
+}  // namespace toydb
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/predicate_expr.hpp"
+#include "planner/logical_operator.hpp"
+#include "planner/physical_planner.hpp"
+#include "storage/catalog.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Value bound to a ? placeholder. Integers can also be bound to DOUBLE parameters.
+ */
+using ParameterValue = std::variant<int64_t, double, bool, std::string>;
+
+/**
+ * @brief Optimized logical plan of a query with ? placeholders, shared by all prepared statements
+ * of the same query text.
+ *
+ * Every placeholder is a parameter slot (see ConstantExpr::parameter) in the predicates of the
+ * plan, typed after the column or constant it is compared with. The optimizer may have copied a
+ * predicate, so a parameter can have several slots.
+ */
+class CachedPlan {
+private:
+    LogicalQueryPlan plan_;
+    uint64_t catalogVersion_;
+    std::vector<std::vector<ConstantExpr*>> slots_;
+    std::vector<DataType> parameterTypes_;
+    // Guards the slots while they are bound and the plan is lowered
+    std::mutex mutex_;
+
+public:
+    /**
+     * @throws InternalSQLError if the plan has no slot for one of the parameterCount placeholders
+     */
+    CachedPlan(LogicalQueryPlan plan, size_t parameterCount, uint64_t catalogVersion);
+
+    CachedPlan(const CachedPlan&) = delete;
+    CachedPlan& operator=(const CachedPlan&) = delete;
+
+    const LogicalQueryPlan& getPlan() const noexcept { return plan_; }
+
+    /**
+     * @brief Version of the catalog the plan was built against (see Catalog::getVersion)
+     */
+    uint64_t getCatalogVersion() const noexcept { return catalogVersion_; }
+
+    size_t getParameterCount() const noexcept { return parameterTypes_.size(); }
+
+    DataType getParameterType(size_t index) const;
+
+    /**
+     * @brief Bind one value per parameter into the slots and lower the plan. The physical plan
+     *        owns copies of the predicates, so it is unaffected by later bindings.
+     */
+    PhysicalQueryPlan instantiate(const std::vector<ConstantExpr>& values, PhysicalPlanner& planner);
+};
+
+/**
+ * @brief A query with ? placeholders and the values bound to them. Each execution lowers the
+ * cached logical plan with the current bindings into a new physical plan.
+ */
+class PreparedStatement {
+private:
+    std::shared_ptr<CachedPlan> plan_;
+    std::vector<std::optional<ConstantExpr>> values_;
+
+public:
+    explicit PreparedStatement(std::shared_ptr<CachedPlan> plan);
+
+    size_t getParameterCount() const noexcept { return values_.size(); }
+
+    /**
+     * @brief Type of the column or constant the index-th placeholder is compared with
+     */
+    DataType getParameterType(size_t index) const;
+
+    /**
+     * @brief Bind a value to the index-th placeholder, counted from 0 in the order of the query text
+     * @throws SQLRuntimeException if the index is out of range or the value doesn't fit the parameter's type
+     */
+    void bind(size_t index, const ParameterValue& value);
+
+    void clearBindings();
+
+    /**
+     * @throws SQLRuntimeException if a parameter is unbound
+     */
+    PhysicalQueryPlan createPlan(PhysicalPlanner& planner) const;
+
+    const CachedPlan& getCachedPlan() const noexcept { return *plan_; }
+};
+
+/**
+ * @brief Prepares statements, reusing the optimized plans of recently prepared queries.
+ *
+ * Plans are keyed by the normalized query text, so queries that only differ in whitespace, the
+ * case of keywords or a trailing ';' share a plan. A plan built against an older version of the
+ * catalog is replanned. At most capacity plans are kept, least recently used first out.
+ * Thread-safe.
+ */
+class PlanCache {
+private:
+    struct Entry {
+        std::shared_ptr<CachedPlan> plan;
+        // Position in lru_
+        std::list<std::string>::iterator position;
+    };
+
+    Catalog* catalog_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    // Most recently used first
+    std::list<std::string> lru_;
+    int64_t hits_ = 0;
+    int64_t misses_ = 0;
+
+    std::shared_ptr<CachedPlan> lookup(const std::string& key, uint64_t catalogVersion);
+    void insert(const std::string& key, std::shared_ptr<CachedPlan> plan);
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 128;
+
+    explicit PlanCache(Catalog* catalog, size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Parse, interpret and optimize a query, unless a plan for it is cached
+     * @return The parse error on failure
+     * @throws SQLException if the query can't be interpreted
+     */
+    std::expected<PreparedStatement, std::string> prepare(std::string_view query);
+
+    /**
+     * @brief The tokens of a query separated by single spaces, without a trailing ';'
+     */
+    static std::string normalize(std::string_view query);
+
+    void clear();
+
+    size_t size() const;
+
+    int64_t getHitCount() const;
+
+    int64_t getMissCount() const;
+};
+
+}  // namespace toydb
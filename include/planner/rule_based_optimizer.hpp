@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "engine/predicate_expr.hpp"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/logical_operator.hpp"
+#include "storage/catalog.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Rewrites the predicates of a LogicalQueryPlan with rules that always pay off.
+ *
+ * Filters and join conditions are simplified: comparisons of constants are folded, comparisons
+ * with NULL are never TRUE, and AND/OR with a constant operand are reduced. Filters that are
+ * always TRUE are removed. A filter only keeps TRUE rows, so NULL is simplified as FALSE there.
+ *
+ * Filters are split into conjuncts, which are pushed below joins and cross products to the input
+ * producing all the columns they reference, down to the scans. Conjuncts are not pushed into the
+ * side of an outer join whose rows are kept unmatched, and an outer join's condition is only
+ * pushed into that side.
+ *
+ * The operands of AND and OR are reordered so that those that decide most rows at the least cost
+ * run first, LogicalExpr skips the rows they decided. Conjuncts are ordered by cost / (1 - s),
+ * disjuncts by cost / s, where s is the estimated selectivity.
+ *
+ * Runs after the JoinOrderOptimizer, which rebuilds the filters of the join regions it reorders.
+ */
+class RuleBasedOptimizer {
+private:
+    // Estimates the selectivities of predicates
+    JoinOrderOptimizer estimator_;
+
+    std::shared_ptr<LogicalOperator> pushFilters(const std::shared_ptr<LogicalOperator>& op,
+                                                 std::vector<std::unique_ptr<PredicateExpr>> conjuncts);
+
+    std::shared_ptr<LogicalOperator> pushIntoJoin(const std::shared_ptr<LogicalOperator>& op,
+                                                  std::vector<std::unique_ptr<PredicateExpr>> conjuncts);
+
+    /**
+     * @brief A filter of the conjuncts above op, op itself if there are none
+     */
+    std::shared_ptr<LogicalOperator> addFilter(std::shared_ptr<LogicalOperator> op,
+                                               std::vector<std::unique_ptr<PredicateExpr>> conjuncts);
+
+public:
+    explicit RuleBasedOptimizer(Catalog* catalog) : estimator_(catalog) {}
+
+    void optimize(LogicalQueryPlan& plan);
+
+    /**
+     * @brief Fold the constant parts of a predicate whose rows are kept if it is TRUE. Parameters
+     *        of prepared statements are not constant.
+     * @return The simplified predicate, a boolean ConstantExpr if it is the same for every row
+     */
+    static std::unique_ptr<PredicateExpr> simplify(std::unique_ptr<PredicateExpr> predicate);
+
+    /**
+     * @brief Reorder the operands of the ANDs and ORs of a predicate, see the class comment
+     */
+    std::unique_ptr<PredicateExpr> reorder(std::unique_ptr<PredicateExpr> predicate);
+
+    /**
+     * @brief Estimated cost of evaluating a predicate per row, relative to comparing a column with a constant
+     */
+    double estimateCost(const PredicateExpr* predicate);
+};
+
+}  // namespace toydb
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "engine/exchange.hpp"
+
+namespace toydb {
+
+namespace server {
+
+/**
+ * @brief Address of a QueryServer serving as the worker of a cluster
+ */
+struct WorkerAddress {
+    std::string host;
+    uint16_t port;
+
+    /**
+     * @brief Parse host:port
+     * @return nullopt if the address has no valid port
+     */
+    static std::optional<WorkerAddress> parse(std::string_view address);
+
+    std::string toString() const {
+        return host + ":" + std::to_string(port);
+    }
+};
+
+/**
+ * @brief Runs plan fragments on the QueryServers of a cluster, each holding some of the files of
+ * every table.
+ *
+ * Every dispatch connects to all workers, sending the fragment as a FRAGMENT message, and
+ * receives their payloads on one thread per worker. Received payloads wait in a queue of
+ * queueCapacity payloads shared by the workers, which stops reading from the sockets while it is
+ * full, so that a slow consumer applies backpressure to the workers.
+ */
+class ClusterDispatcher : public FragmentDispatcher {
+private:
+    std::vector<WorkerAddress> workers_;
+    size_t queueCapacity_;
+
+public:
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 16;
+
+    explicit ClusterDispatcher(std::vector<WorkerAddress> workers, size_t queueCapacity = DEFAULT_QUEUE_CAPACITY)
+        : workers_(std::move(workers)), queueCapacity_(std::max<size_t>(queueCapacity, 1)) {}
+
+    const std::vector<WorkerAddress>& getWorkers() const noexcept {
+        return workers_;
+    }
+
+    /**
+     * @brief The returned stream throws a SQLRuntimeException naming the worker if one can't be
+     *        reached or fails, and stops the other workers once it is destroyed
+     */
+    std::unique_ptr<FragmentStream> dispatch(const std::string& fragment) override;
+};
+
+}  // namespace server
+}  // namespace toydb
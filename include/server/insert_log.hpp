@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+#include "parser/query_ast.hpp"
+#include "storage/catalog.hpp"
+#include "storage/write_ahead_log.hpp"
+
+namespace toydb {
+
+namespace server {
+
+/**
+ * @brief Runs INSERT statements against a catalog, made durable by a WriteAheadLog instead of
+ * syncing every data file and the manifest.
+ *
+ * An INSERT writes its rows to a new data file without syncing it and logs the statement with the
+ * path of the file. It waits for the log without holding the catalog lock, so the concurrent
+ * INSERTs of many sessions share one fsync, then adds the file to the catalog. A checkpoint syncs
+ * the files added since the last one and the manifest, and truncates the log. recover() repeats
+ * the logged statements into their files after a crash, so that the rows of every INSERT that
+ * returned are in the table. The file of a logged INSERT that the catalog failed to add is added
+ * by the next checkpoint, which keeps the log until it succeeds.
+ */
+class InsertLog {
+private:
+    Catalog* catalog_;
+    std::shared_mutex* catalogMutex_;
+    std::unique_ptr<WriteAheadLog> log_;
+
+    // Taken after the catalog lock
+    std::mutex mutex_;
+    // INSERTs waiting for their record, the log can't be truncated until they added their file
+    int64_t pending_ = 0;
+    // Data files added since the last checkpoint
+    std::vector<std::filesystem::path> unsynced_;
+
+    struct WrittenFile {
+        TableId tableId;
+        FileEntry file;
+    };
+
+    // Files of committed INSERTs the catalog failed to add, the log is kept until a checkpoint added them
+    std::vector<WrittenFile> unapplied_;
+
+    std::unique_lock<std::shared_mutex> lockCatalog();
+
+    /**
+     * @brief Bind the statement and write its rows into a new data file, at path if it is set
+     * @throws SQLException if the statement is invalid or the file could not be written
+     */
+    WrittenFile writeRows(const ast::Insert& insert, const std::optional<std::filesystem::path>& path, bool sync);
+
+    /**
+     * @brief Checkpoint while holding the catalog lock and mutex_
+     */
+    bool checkpointLocked();
+
+public:
+    /**
+     * @param catalogMutex May be nullptr if the catalog is not shared
+     * @param log An opened log
+     */
+    InsertLog(Catalog* catalog, std::shared_mutex* catalogMutex, std::unique_ptr<WriteAheadLog> log);
+
+    InsertLog(const InsertLog&) = delete;
+    InsertLog& operator=(const InsertLog&) = delete;
+
+    /**
+     * @brief Insert the rows of the statement, returns once they are durable as the sync policy of
+     *        the log defines it
+     * @param sql Text of the statement, logged to repeat it in recover()
+     * @return Number of inserted rows
+     * @throws SQLException if the statement is invalid or the rows could not be written. If only
+     *         the catalog could not be updated, the rows are logged and added by the next checkpoint.
+     */
+    int64_t insert(const ast::Insert& insert, std::string_view sql);
+
+    /**
+     * @brief Write the files of the logged INSERTs again and add the ones missing from the catalog,
+     *        then checkpoint. Must run before the first insert().
+     * @return false if a logged statement could not be repeated
+     */
+    bool recover();
+
+    /**
+     * @brief Add the files of logged INSERTs the catalog failed to add, sync the files added since
+     *        the last checkpoint and the manifest, and truncate the log
+     * @return false if a file could not be added, something could not be synced or INSERTs are
+     *         waiting for the log, which is kept then
+     */
+    bool checkpoint();
+
+    const WriteAheadLog& getLog() const noexcept {
+        return *log_;
+    }
+};
+
+}  // namespace server
+}  // namespace toydb
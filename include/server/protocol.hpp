@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "engine/result_sink.hpp"
+
+namespace toydb {
+
+namespace server {
+
+/**
+ * @brief Messages between clients and the QueryServer. A message is its type byte, the length of
+ * its payload as a big-endian uint32 and the payload.
+ *
+ * The client sends a QUERY with the text of one statement. The server answers every query with
+ * any number of DATA messages carrying its result, encoded in the connection's ResultFormat,
+ * followed by COMPLETE with the number of rows of a query (empty for other statements) or ERROR
+ * with the message of the error. The queries of a connection run one at a time in the order they
+ * were sent, so a client may send the next one before the previous one completed.
+ *
+ * FORMAT with the name of a ResultFormat changes the format of the following results of the
+ * connection and is answered with COMPLETE or ERROR like a query.
+ *
+ * FRAGMENT with an encoded PlanFragment is sent by the coordinator of a cluster to its workers.
+ * The worker runs it against its local files and answers with DATA messages holding the encoded
+ * batches or partial aggregate states of the fragment, followed by COMPLETE with the number of
+ * rows or groups, or ERROR.
+ */
+enum class MessageType : char {
+    QUERY = 'Q',
+    FORMAT = 'F',
+    FRAGMENT = 'P',
+    DATA = 'D',
+    COMPLETE = 'C',
+    ERROR = 'E',
+};
+
+struct Message {
+    MessageType type;
+    std::string payload;
+};
+
+constexpr size_t MESSAGE_HEADER_SIZE = 5;
+constexpr size_t MAX_MESSAGE_SIZE = 64 * 1024 * 1024;  // 64MB
+
+/**
+ * @brief The peer sent something that is not a message
+ */
+class ProtocolError : public std::runtime_error {
+public:
+    explicit ProtocolError(const std::string& message) : std::runtime_error(message) {}
+};
+
+/**
+ * @brief Append the message to out
+ */
+void encodeMessage(MessageType type, std::string_view payload, std::string& out);
+
+/**
+ * @brief Splits the bytes received from a stream into messages
+ */
+class MessageDecoder {
+private:
+    std::string buffer_;
+    // Start of the first message not yet returned
+    size_t offset_ = 0;
+
+public:
+    void feed(const char* data, size_t size);
+
+    /**
+     * @brief The next complete message
+     * @return nullopt until all of its bytes were fed
+     * @throws ProtocolError on an unknown message type or a payload above MAX_MESSAGE_SIZE
+     */
+    std::optional<Message> next();
+};
+
+/**
+ * @brief Blocking connection to a QueryServer
+ */
+class QueryClient {
+public:
+    struct Result {
+        // The DATA of the query concatenated
+        std::string data;
+        // nullopt if the statement was not a query
+        std::optional<int64_t> rowCount;
+    };
+
+private:
+    int fd_ = -1;
+    MessageDecoder decoder_;
+
+    void send(const std::string& bytes);
+    Message receive();
+    /**
+     * @brief Receive the DATA of a request until it completes, passing every payload to consume
+     */
+    std::optional<int64_t> receiveResult(std::string_view request,
+                                         const std::function<void(std::string_view)>& consume);
+
+public:
+    /**
+     * @throws std::system_error if the connection fails
+     */
+    QueryClient(const std::string& host, uint16_t port);
+
+    ~QueryClient();
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    /**
+     * @brief Run a statement on the server and wait for its result
+     * @throws SQLException with the server's message if the statement failed
+     */
+    Result query(std::string_view sql);
+
+    /**
+     * @brief Change the format of the results of the following queries, TABLE by default
+     */
+    void setResultFormat(ResultFormat format);
+
+    /**
+     * @brief Run an encoded PlanFragment on the server, a worker of a cluster
+     * @param consume Called with the payload of every DATA message as it arrives
+     * @return Number of rows or groups the fragment produced
+     * @throws SQLException with the server's message if the fragment failed
+     */
+    int64_t runFragment(std::string_view fragment, const std::function<void(std::string_view)>& consume);
+};
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "planner/prepared_statement.hpp"
+#include "server/cluster.hpp"
+#include "server/insert_log.hpp"
+#include "server/protocol.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "storage/write_ahead_log.hpp"
+
+namespace toydb {
+
+namespace server {
+
+/**
+ * @brief Admits queries while the memory granted to the running ones stays within a limit.
+ *
+ * Every query is granted a fixed amount of memory before it runs. A query is always admitted if
+ * none is running, so that a grant above the limit can't stall the server. Not thread-safe, the
+ * QueryServer uses it from its event loop only.
+ */
+class AdmissionController {
+private:
+    size_t memoryLimit_;
+    size_t grantedBytes_ = 0;
+    size_t runningQueries_ = 0;
+
+public:
+    explicit AdmissionController(size_t memoryLimit) : memoryLimit_(memoryLimit) {}
+
+    /**
+     * @return false if the grant does not fit next to the running queries
+     */
+    bool tryAdmit(size_t grant) noexcept {
+        if (runningQueries_ > 0 && grantedBytes_ + grant > memoryLimit_) {
+            return false;
+        }
+        grantedBytes_ += grant;
+        runningQueries_++;
+        return true;
+    }
+
+    void release(size_t grant) noexcept {
+        grantedBytes_ -= grant;
+        runningQueries_--;
+    }
+
+    size_t getGrantedBytes() const noexcept {
+        return grantedBytes_;
+    }
+
+    size_t getRunningQueries() const noexcept {
+        return runningQueries_;
+    }
+};
+
+struct ServerOptions {
+    std::string host = "127.0.0.1";
+    // 0 picks a free port, see QueryServer::getPort
+    uint16_t port = 5433;
+    size_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+    // Memory granted to every query and the limit of the grants of the running queries
+    size_t queryMemory = 256 * 1024 * 1024;
+    size_t memoryLimit = 0;  // 0 is the budget of the global BufferPool
+    size_t planCacheCapacity = PlanCache::DEFAULT_CAPACITY;
+    // INSERTs are logged to walPath if set, see InsertLog
+    std::optional<WalOptions> wal;
+    std::filesystem::path walPath;
+    // If set, the server coordinates a cluster and reads the tables on these workers
+    std::vector<WorkerAddress> workers;
+};
+
+/**
+ * @brief Serves queries from many clients over TCP (see MessageType for the protocol), sharing one
+ * catalog, plan cache and buffer pool between them.
+ *
+ * A single thread runs an epoll event loop that accepts connections and reads their queries.
+ * Queries run on a pool of worker threads, which also send the results, so the event loop never
+ * blocks on a query or a slow client. Queries wait in a FIFO queue until the AdmissionController
+ * admits them, and while the buffer pool is under pressure, so that the memory of the running
+ * queries stays bounded no matter how many clients are connected.
+ *
+ * Every server runs the plan fragments other servers send it as the worker of a cluster. A server
+ * with workers in its options coordinates a cluster, see ClusterDispatcher.
+ */
+class QueryServer {
+private:
+    struct Connection {
+        int fd;
+        Session session;
+        MessageDecoder decoder;
+        // Received queries and format changes, not yet run
+        std::deque<Message> requests;
+        // A query of the connection is queued for admission or running
+        bool busy = false;
+        // The client hung up, the socket is closed once the running query finished
+        bool closing = false;
+        std::chrono::steady_clock::time_point queuedAt;
+
+        Connection(int fd, Session session) : fd(fd), session(session) {}
+    };
+
+    ServerOptions options_;
+    Catalog* catalog_;
+    std::shared_mutex catalogMutex_;
+    std::unique_ptr<InsertLog> insertLog_;
+    std::unique_ptr<ClusterDispatcher> dispatcher_;
+    PlanCache planCache_;
+    AdmissionController admission_;
+
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    // Wakes the event loop for completions and stop()
+    int wakeFd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_ = false;
+
+    // Owned by the event loop, connections stay until their socket is closed
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+    // Waiting for the admission of their next query
+    std::deque<std::shared_ptr<Connection>> waiting_;
+
+    // Connections whose query finished, handed from the workers to the event loop
+    std::mutex completionMutex_;
+    std::vector<std::shared_ptr<Connection>> completed_;
+
+    std::mutex taskMutex_;
+    std::condition_variable taskAvailable_;
+    std::deque<std::function<void()>> tasks_;
+    bool shutdown_ = false;
+    std::vector<std::thread> workers_;
+
+    void closeDescriptors() noexcept;
+    void acceptConnections();
+    void readConnection(const std::shared_ptr<Connection>& connection);
+    void closeConnection(const std::shared_ptr<Connection>& connection);
+    void closeSocket(const std::shared_ptr<Connection>& connection);
+    void handleCompletions();
+    void admitQueries();
+    void runRequest(const std::shared_ptr<Connection>& connection, const Message& request);
+    void submit(std::function<void()> task);
+    void runWorker();
+    void wake();
+
+    /**
+     * @brief Send a message on the connection from a worker, waiting while the socket is full
+     * @return false if the client is gone
+     */
+    static bool sendMessage(int fd, MessageType type, std::string_view payload);
+
+public:
+    /**
+     * @brief Listen on the configured address and start the workers
+     * @throws std::system_error if the address can't be bound
+     * @throws std::runtime_error if the write-ahead log can't be opened or recovered
+     */
+    QueryServer(Catalog* catalog, const ServerOptions& options = {});
+
+    /**
+     * @brief Stops the workers after the queries they run, closes all connections and checkpoints
+     *        the write-ahead log
+     */
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+     * @brief Run the event loop until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Make run() return, may be called from any thread or a signal handler
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief The port the server listens on
+     */
+    uint16_t getPort() const noexcept {
+        return port_;
+    }
+
+    const PlanCache& getPlanCache() const noexcept {
+        return planCache_;
+    }
+};
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include "engine/result_sink.hpp"
+#include "parser/query_ast.hpp"
+#include "planner/prepared_statement.hpp"
+#include "storage/catalog.hpp"
+
+namespace toydb {
+
+class FragmentDispatcher;
+
+namespace server {
+
+class InsertLog;
+
+/**
+ * @brief Receives the output of a statement, e.g. the encoded result of a query
+ */
+using OutputSink = ByteWriter;
+
+/**
+ * @brief Runs the statements of one client against a catalog, possibly shared with other sessions.
+ *
+ * Sessions sharing a catalog share its lock, which serializes the statements changing the catalog:
+ * ANALYZE, CREATE INDEX, INSERT and view refreshes hold it exclusively. Queries don't take it, they
+ * read the catalog through its snapshots (see CatalogImpl), so they never wait for a writer.
+ * Queries are prepared through the plan cache if there is one, so that sessions reuse each other's
+ * plans. Query results are streamed in the session's ResultFormat while the query runs. INSERTs go
+ * through the InsertLog if there is one, otherwise every INSERT syncs its data file and the
+ * manifest. With a FragmentDispatcher, the
+ * session is the coordinator of a cluster and reads tables on its workers (see
+ * PhysicalPlanner::setDispatcher), executeFragment() runs the fragments of a worker.
+ *
+ * Queries a materialized view materializes are answered from the view. A view is refreshed by
+ * the first query of it after rows were inserted into its tables, holding the lock exclusively.
+ * A query planned against a view whose file a concurrent refresh replaced is planned again.
+ */
+class Session {
+private:
+    Catalog* catalog_;
+    PlanCache* planCache_;
+    std::shared_mutex* catalogMutex_;
+    InsertLog* insertLog_;
+    FragmentDispatcher* dispatcher_;
+    ResultFormat format_ = ResultFormat::TABLE;
+
+    int64_t runPlan(PhysicalQueryPlan& plan, const OutputSink& out);
+    void analyzeTable(const ast::Analyze& analyze, const OutputSink& out);
+    void createIndex(const ast::CreateIndex& createIndex, const OutputSink& out);
+    void insertRows(const ast::Insert& insert, std::string_view sql, const OutputSink& out);
+    void createMaterializedView(const ast::CreateMaterializedView& create, std::string_view sql, const OutputSink& out);
+
+    /**
+     * @brief Refresh the view materializing the query of sql if rows were inserted since
+     */
+    void refreshMaterializedView(std::string_view sql);
+
+public:
+    /**
+     * @param planCache May be nullptr
+     * @param catalogMutex May be nullptr if the catalog is not shared
+     * @param insertLog May be nullptr, must share catalogMutex otherwise
+     * @param dispatcher May be nullptr to read the tables from the local files
+     */
+    explicit Session(Catalog* catalog, PlanCache* planCache = nullptr, std::shared_mutex* catalogMutex = nullptr,
+                     InsertLog* insertLog = nullptr, FragmentDispatcher* dispatcher = nullptr)
+        : catalog_(catalog),
+          planCache_(planCache),
+          catalogMutex_(catalogMutex),
+          insertLog_(insertLog),
+          dispatcher_(dispatcher) {}
+
+    ResultFormat getResultFormat() const noexcept {
+        return format_;
+    }
+
+    void setResultFormat(ResultFormat format) noexcept {
+        format_ = format;
+    }
+
+    /**
+     * @brief Parse, plan and run a statement, passing its output to out
+     * @return Number of rows of a query, nullopt for other statements
+     * @throws SQLException if the statement can't be parsed, planned or run
+     */
+    std::optional<int64_t> execute(std::string_view sql, const OutputSink& out);
+
+    /**
+     * @brief Plan and run a parsed statement
+     */
+    std::optional<int64_t> execute(const ast::QueryAST& ast, std::string_view sql, const OutputSink& out);
+
+    /**
+     * @brief Run an encoded PlanFragment against the local files, passing its payloads to out
+     * @return Number of rows or groups the fragment produced
+     * @throws SQLException if the fragment is malformed or names unknown tables or columns
+     */
+    int64_t executeFragment(std::string_view fragment, const OutputSink& out);
+};
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "engine/memory.hpp"
+
+namespace toydb {
+
+enum class IoBackend { AUTO, IO_URING, THREAD_POOL };
+
+std::string ioBackendToString(IoBackend backend) noexcept;
+
+struct IoCompletion {
+    uint64_t tag;
+    // Bytes read, or -errno
+    int64_t result;
+};
+
+/**
+ * @brief Queue of asynchronous reads. Reads are submitted with a tag and complete in any order.
+ * Not thread-safe, a queue is used by the thread that owns it.
+ */
+class IoQueue {
+public:
+    virtual ~IoQueue() = default;
+
+    /**
+     * @brief Start reading size bytes at offset of fd into buffer. At most the queue's depth reads
+     * may be in flight.
+     */
+    virtual void submitRead(int fd, char* buffer, size_t size, uint64_t offset, uint64_t tag) = 0;
+
+    /**
+     * @brief Wait until one of the reads in flight completes
+     */
+    virtual IoCompletion waitForCompletion() = 0;
+
+    virtual IoBackend getBackend() const noexcept = 0;
+
+    /**
+     * @brief Create a queue for depth reads in flight. AUTO uses io_uring if the kernel supports
+     * it and falls back to a thread pool otherwise.
+     * @return nullptr if the requested backend is not available
+     */
+    static std::unique_ptr<IoQueue> create(unsigned depth, IoBackend backend = IoBackend::AUTO);
+};
+
+struct AsyncIoOptions {
+    size_t blockSize = 1024 * 1024;
+    // Blocks read ahead of the one being consumed
+    unsigned depth = 4;
+    IoBackend backend = IoBackend::AUTO;
+
+    /**
+     * @brief Options selected by TOYDB_ASYNC_IO (auto, io_uring or threads), nullopt if it is
+     * unset or "off"
+     */
+    static std::optional<AsyncIoOptions> fromEnvironment();
+};
+
+/**
+ * @brief Reads a file sequentially in blocks, keeping depth reads of the following blocks in flight
+ * while the caller consumes the current one. Block buffers come from the buffer pool.
+ */
+class AsyncFileReader {
+public:
+    AsyncFileReader(const std::filesystem::path& path, uint64_t offset, const AsyncIoOptions& options = {});
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    /**
+     * @brief Waits for the reads in flight
+     */
+    ~AsyncFileReader();
+
+    bool isOpen() const noexcept { return fd_ >= 0; }
+
+    uint64_t getFileSize() const noexcept { return file_size_; }
+
+    IoBackend getBackend() const noexcept;
+
+    /**
+     * @brief Wait for the next block of the file. The block stays valid until the next call.
+     * @return An empty block at the end of the file or after a failed read
+     */
+    std::string_view next();
+
+    bool hasFailed() const noexcept { return failed_; }
+
+private:
+    enum class BlockState { EMPTY, READING, READY };
+
+    struct Block {
+        memory::BufferManager::BufferHandle buffer;
+        BlockState state = BlockState::EMPTY;
+        uint64_t offset = 0;
+        size_t size = 0;
+        // Bytes read so far, reads may return fewer bytes than requested
+        size_t done = 0;
+    };
+
+    std::filesystem::path path_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    size_t block_size_;
+    unsigned depth_;
+    unsigned in_flight_ = 0;
+    memory::BufferManager buffer_manager_;
+    std::unique_ptr<IoQueue> queue_;
+    // Ring of blocks in file order: the one at head_ is consumed next, the one at tail_ is read next
+    std::vector<Block> blocks_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    uint64_t next_offset_;
+    // Whether the caller holds the block at head_
+    bool holding_ = false;
+    bool failed_ = false;
+
+    void submitBlocks();
+    void complete(const IoCompletion& completion);
+};
+
+}  // namespace toydb
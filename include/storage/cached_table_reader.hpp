@@ -0,0 +1,82 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
+#include "storage/catalog.hpp"
+#include "storage/data_file_reader.hpp"
+#include "storage/parallel_scan.hpp"
+#include "storage/table_cache.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Reads a range of chunks of a table cached in memory (see TableCache).
+ *
+ * The values of the projected columns are copied into the output columns as they are, only long
+ * strings are copied into a string heap. Chunks whose min/max rule out the predicate are
+ * skipped. Batches end at chunk boundaries.
+ */
+class CachedTableReader : public DataFileReader {
+public:
+    CachedTableReader(std::shared_ptr<const CachedTable> table, ChunkRange chunks, const Schema& schema);
+
+    void setProjection(const std::vector<ColumnId>& columns) override;
+
+    /**
+     * @brief Skip chunks in which no row can satisfy the predicate. The predicate is not
+     * evaluated on the rows that are read.
+     */
+    void setPredicate(const PredicateExpr* predicate) override;
+
+    /**
+     * @brief Read up to requestedRows rows of the current chunk. RowVector must be pre-allocated
+     * and initialized with the projected columns. Long strings are stored in the column's string
+     * heap, or in the reader's heap if the column has none. The latter stay valid until the next
+     * call to readBatch.
+     */
+    int64_t readBatch(RowVector& out, int64_t requestedRows = 8192) override;
+
+    bool hasMore() const noexcept override;
+
+    void reset() override;
+
+    /**
+     * @brief Cached rows are not read from a file, the path is empty
+     */
+    std::filesystem::path getPath() const noexcept override { return {}; }
+
+    const Schema& getSchema() const noexcept override { return schema_; }
+
+    const std::vector<ColumnId>& getProjection() const noexcept override { return projection_; }
+
+    /**
+     * @brief Chunks skipped because their min/max ruled out the predicate
+     */
+    size_t getSkippedChunkCount() const noexcept { return skipped_chunks_; }
+
+private:
+    std::shared_ptr<const CachedTable> table_;
+    ChunkRange chunks_;
+    Schema schema_;
+    std::vector<ColumnId> projection_;
+    const PredicateExpr* predicate_ = nullptr;
+
+    // Column of the cached rows of each projected column
+    std::vector<int64_t> projected_columns_;
+    size_t chunk_;
+    int64_t row_offset_ = 0;
+    size_t skipped_chunks_ = 0;
+    bool started_ = false;
+    StringHeap string_heap_;
+
+    void startReading();
+    bool chunkMayMatch(size_t chunk) const;
+    void copyRows(const ColumnBuffer& src, int64_t begin, int64_t count, ColumnBuffer& out);
+};
+
+}  // namespace toydb
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <expected>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "common/types.hpp"
+#include "storage/column_statistics.hpp"
 
 namespace toydb {
 
@@ -18,7 +21,9 @@ using json = nlohmann::json;
 enum class CatalogError {
     TABLE_NOT_FOUND,
     COLUMN_NOT_FOUND,
-    INVALID_COLUMN_ID
+    INVALID_COLUMN_ID,
+    READ_FAILED,
+    WRITE_FAILED
 };
 
 struct ColumnMetadata {
@@ -32,10 +37,35 @@ struct ColumnMetadata {
 struct FileEntry {
     fs::path path;
     std::optional<int64_t> row_count;
+    // Statistics of the columns of the file, empty until the table is analyzed
+    StatisticsMap statistics;
 
     static FileEntry from_json(const json& obj);
 };
 
+struct IndexMetadata {
+    // Indexed column
+    ColumnId column;
+    // Index file, relative to the manifest directory in the manifest
+    fs::path path;
+    // The index covers the first fileCount files of the table, files appended later are not indexed
+    size_t fileCount = 0;
+};
+
+struct MaterializedViewMetadata {
+    std::string name;
+    // The SELECT statement of the view, normalized like the keys of the PlanCache
+    std::string query;
+    // Contents of the view, relative to the manifest directory in the manifest
+    fs::path path;
+    // The contents cover the first fileCounts[table] files of every table the query reads
+    std::unordered_map<std::string, size_t> fileCounts;
+
+    static MaterializedViewMetadata from_json(const json& obj);
+
+    bool operator==(const MaterializedViewMetadata&) const = default;
+};
+
 class Schema {
     std::vector<ColumnId> columnIds;
     std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById;
@@ -46,7 +76,7 @@ class Schema {
     Schema(std::vector<ColumnId> columnIds, std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById)
         : columnIds(std::move(columnIds)), columnsById(std::move(columnsById)) {}
 
-    std::vector<ColumnId> getColumnIds() const noexcept { return columnIds; }
+    const std::vector<ColumnId>& getColumnIds() const noexcept { return columnIds; }
 
     /**
      * @brief Get column metadata by ColumnId
@@ -62,7 +92,7 @@ class Schema {
     }
 };
 
-enum struct StorageFormat { PARQUET, CSV };
+enum struct StorageFormat { PARQUET, CSV, TDB };
 
 std::string storageFormatToString(StorageFormat format) noexcept;
 
@@ -76,6 +106,16 @@ struct TableMetadata {
     Schema schema;
     std::vector<FileEntry> files;
     std::unordered_map<std::string, ColumnId> column_map;
+    // Statistics of the columns, merged from those of the files if all files have them, otherwise
+    // as recorded for the column in the manifest
+    StatisticsMap statistics;
+    // Secondary indexes, at most one per column
+    std::vector<IndexMetadata> indexes;
+
+    /**
+     * @brief Sum of the row counts of the files, nullopt if any of them is unknown
+     */
+    std::optional<int64_t> getRowCount() const noexcept;
 };
 
 class CatalogManifest {
@@ -88,6 +128,14 @@ public:
      */
     virtual bool load() = 0;
 
+    /**
+     * @brief Load the manifest from disk again, e.g. after another process changed it. The
+     *        metadata of the tables that didn't change is kept.
+     * @return Names of the tables that were added, changed or removed, nullopt on error, which
+     *         keeps the previous state
+     */
+    virtual std::optional<std::vector<std::string>> reload() = 0;
+
     virtual std::vector<std::string> getTableNames() const = 0;
 
     virtual std::optional<TableMetadata> getTableMetadata(const std::string& name) const = 0;
@@ -95,9 +143,32 @@ public:
     virtual std::optional<TableMetadata> getTableMetadata(const TableId& id) const = 0;
 
     virtual fs::path getManifestPath() const = 0;
+
+    /**
+     * @brief Write the files of a table with their row counts and statistics back to disk. Files
+     *        may be appended, but not removed or reordered.
+     * @return true on success, false on error
+     */
+    virtual bool updateTable(const TableMetadata& meta) = 0;
+
+    virtual std::vector<MaterializedViewMetadata> getMaterializedViews() const = 0;
+
+    /**
+     * @brief Add a materialized view, or replace the view of the same name, and write it to disk
+     * @return true on success, false on error
+     */
+    virtual bool updateMaterializedView(const MaterializedViewMetadata& view) = 0;
+
+    /**
+     * @brief Flush the manifest to disk. Updates are atomic without it, but the last ones may be
+     *        lost in a crash.
+     * @return true on success, false on error
+     */
+    virtual bool sync() = 0;
 };
 
 class TableHandle;
+class TableCache;
 
 class Catalog {
 public:
@@ -125,13 +196,118 @@ public:
      */
     virtual std::expected<DataType, CatalogError> getColumnType(const ColumnId& columnId) const noexcept = 0;
 
+    /**
+     * @brief Number of rows of a table, from the row counts of its files
+     * @return nullopt if the table doesn't exist or the row count of a file is unknown
+     */
+    virtual std::optional<int64_t> getRowCount(const TableId& tableId) const noexcept = 0;
+
+    /**
+     * @brief Statistics of a column recorded in the catalog
+     * @return nullopt if the column doesn't exist or has no statistics
+     */
+    virtual std::optional<ColumnStatistics> getColumnStatistics(const ColumnId& columnId) const noexcept = 0;
+
     /**
      * @brief Get a TableHandle for reading/writing table data
      * @return TableHandle on success, CatalogError::TABLE_NOT_FOUND on failure
      */
     virtual std::expected<std::unique_ptr<TableHandle>, CatalogError> getTableHandle(const TableId& tableId) noexcept = 0;
+
+    /**
+     * @brief Read all files of a table, record their exact row counts and column statistics and
+     *        persist them in the manifest
+     * @return CatalogError::TABLE_NOT_FOUND, READ_FAILED or WRITE_FAILED on failure
+     */
+    virtual std::expected<void, CatalogError> analyzeTable(const TableId& tableId) = 0;
+
+    /**
+     * @brief Build a SecondaryIndex over an INT32 or INT64 column of a TDB table and persist it in
+     *        the manifest, replacing an existing index of the column
+     * @return CatalogError::TABLE_NOT_FOUND, COLUMN_NOT_FOUND, or WRITE_FAILED if the index could not
+     *         be built
+     */
+    virtual std::expected<void, CatalogError> createIndex(const ColumnId& columnId) = 0;
+
+    /**
+     * @brief Path for a new data file of a table, next to the manifest. The file is not part of
+     *        the table until it is added with addFiles.
+     * @return CatalogError::TABLE_NOT_FOUND on failure
+     */
+    virtual std::expected<fs::path, CatalogError> createFilePath(const TableId& tableId) const = 0;
+
+    /**
+     * @brief Append data files to a table and persist them in the manifest, which is replaced
+     *        atomically, so either all of them become visible or none does
+     * @param files Written to paths from createFilePath
+     * @return CatalogError::TABLE_NOT_FOUND or WRITE_FAILED on failure
+     */
+    virtual std::expected<void, CatalogError> addFiles(const TableId& tableId, std::vector<FileEntry> files) = 0;
+
+    /**
+     * @brief Materialized views, with their paths resolved against the directory of the manifest
+     */
+    virtual std::vector<MaterializedViewMetadata> listMaterializedViews() const = 0;
+
+    /**
+     * @brief Path for new contents of a materialized view, next to the manifest
+     */
+    virtual fs::path createViewPath(const std::string& name) const = 0;
+
+    /**
+     * @brief Add a materialized view, or replace the view of the same name, and persist it in the
+     *        manifest
+     * @param view Contents written to a path from createViewPath
+     * @return CatalogError::WRITE_FAILED on failure
+     */
+    virtual std::expected<void, CatalogError> putMaterializedView(MaterializedViewMetadata view) = 0;
+
+    /**
+     * @brief Flush the manifest to disk, see CatalogManifest::sync
+     * @return CatalogError::WRITE_FAILED on failure
+     */
+    virtual std::expected<void, CatalogError> sync() = 0;
+
+    /**
+     * @brief Load the manifest again, only the tables that changed get new metadata and lose their
+     *        cached rows
+     * @return CatalogError::READ_FAILED if the manifest could not be loaded
+     */
+    virtual std::expected<void, CatalogError> reload() = 0;
+
+    /**
+     * @brief Incremented whenever tables, their columns, their statistics or the materialized
+     *        views change, so that
+     *        plans built against an older version can be discarded
+     */
+    virtual uint64_t getVersion() const noexcept = 0;
+};
+
+/**
+ * @brief Immutable state of a CatalogImpl at one version. The metadata of a table is shared by all
+ * snapshots until the table changes.
+ */
+struct CatalogSnapshot {
+    uint64_t version = 0;
+    std::unordered_map<std::string, TableId> tableIds;
+    std::unordered_map<TableId, std::shared_ptr<const TableMetadata>, TableIdHash> tables;
+    std::unordered_map<std::string, MaterializedViewMetadata> views;
+
+    /**
+     * @return nullptr if the table doesn't exist, valid as long as the snapshot
+     */
+    const TableMetadata* findTable(const TableId& tableId) const noexcept {
+        auto it = tables.find(tableId);
+        return it == tables.end() ? nullptr : it->second.get();
+    }
 };
 
+/**
+ * @brief Catalog over a CatalogManifest. Reads are lock-free: they resolve tables and columns
+ * against the current CatalogSnapshot without copying metadata. Changes are serialized, persisted
+ * in the manifest and then published as a new snapshot, which replaces the metadata of the changed
+ * tables only.
+ */
 class CatalogImpl : public Catalog {
 public:
     explicit CatalogImpl(std::unique_ptr<CatalogManifest> manifest);
@@ -148,14 +324,75 @@ public:
 
     std::expected<DataType, CatalogError> getColumnType(const ColumnId& columnId) const noexcept override;
 
+    std::optional<int64_t> getRowCount(const TableId& tableId) const noexcept override;
+
+    std::optional<ColumnStatistics> getColumnStatistics(const ColumnId& columnId) const noexcept override;
+
     std::expected<std::unique_ptr<TableHandle>, CatalogError> getTableHandle(const TableId& tableId) noexcept override;
 
+    std::expected<void, CatalogError> analyzeTable(const TableId& tableId) override;
+
+    std::expected<void, CatalogError> createIndex(const ColumnId& columnId) override;
+
+    std::expected<fs::path, CatalogError> createFilePath(const TableId& tableId) const override;
+
+    std::expected<void, CatalogError> addFiles(const TableId& tableId, std::vector<FileEntry> files) override;
+
+    std::vector<MaterializedViewMetadata> listMaterializedViews() const override;
+
+    fs::path createViewPath(const std::string& name) const override;
+
+    std::expected<void, CatalogError> putMaterializedView(MaterializedViewMetadata view) override;
+
+    std::expected<void, CatalogError> sync() override;
+
+    std::expected<void, CatalogError> reload() override;
+
+    uint64_t getVersion() const noexcept override { return getSnapshot()->version; }
+
+    /**
+     * @brief The current state of the catalog, e.g. to resolve several tables against one version
+     */
+    std::shared_ptr<const CatalogSnapshot> getSnapshot() const noexcept {
+        return snapshot_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Keep the decoded rows of scanned tables in memory, up to memoryBudget bytes (see
+     *        TableCache). Enabled by the constructor if TOYDB_TABLE_CACHE is set.
+     */
+    void enableTableCache(size_t memoryBudget);
+
+    /**
+     * @brief Cache shared by the handles of this catalog, nullptr if it is disabled
+     */
+    TableCache* getTableCache() const noexcept { return table_cache_.get(); }
+
 protected:
     std::unique_ptr<CatalogManifest> manifest_;
-    std::unordered_map<std::string, TableId> name_to_table_id_;
-    std::unordered_map<TableId, TableMetadata, TableIdHash> tables_by_id_;
+    // Serializes changes, readers only load the snapshot
+    std::mutex write_mutex_;
+    std::atomic<std::shared_ptr<const CatalogSnapshot>> snapshot_;
+    std::shared_ptr<TableCache> table_cache_;
 
     void initialize();
+
+    /**
+     * @brief Make a snapshot visible with the next version and drop the cached rows of the changed
+     *        tables. Called holding write_mutex_.
+     */
+    void publish(CatalogSnapshot snapshot, const std::vector<TableId>& changed);
+
+    /**
+     * @brief Directory the paths of data files in the manifest are relative to
+     */
+    fs::path getDataDirectory() const;
+
+    /**
+     * @brief Persist the changed metadata of a table and make it visible to new queries. Called
+     *        holding write_mutex_.
+     */
+    std::expected<void, CatalogError> replaceTable(TableMetadata meta);
 };
 
 class JsonCatalogManifest : public CatalogManifest {
@@ -165,6 +402,8 @@ public:
 
     bool load() override;
 
+    std::optional<std::vector<std::string>> reload() override;
+
     std::vector<std::string> getTableNames() const override;
 
     std::optional<TableMetadata> getTableMetadata(const std::string& name) const override;
@@ -173,13 +412,29 @@ public:
 
     fs::path getManifestPath() const override { return manifest_path_; }
 
+    bool updateTable(const TableMetadata& meta) override;
+
+    std::vector<MaterializedViewMetadata> getMaterializedViews() const override { return views_; }
+
+    bool updateMaterializedView(const MaterializedViewMetadata& view) override;
+
+    bool sync() override;
+
 private:
     fs::path manifest_path_;
+    // Parsed manifest, updated in place so that fields the catalog doesn't know survive a rewrite
+    json root_;
     std::unordered_map<std::string, TableMetadata> tables_by_name_;
     std::unordered_map<TableId, TableMetadata, TableIdHash> tables_by_id_;
+    std::vector<MaterializedViewMetadata> views_;
     bool loaded_ = false;
 
     bool parseManifest();
+
+    /**
+     * @brief Replace the manifest on disk with root
+     */
+    bool writeManifest(const json& root);
 };
 
 class JsonCatalog : public CatalogImpl {
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/compare_kernels.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Lightweight encodings of a column chunk.
+ *
+ * Every encoded chunk starts with the null bitmap of its rows, padded to 8 bytes, followed by:
+ * - PLAIN: the values in ColumnBuffer layout. Long strings hold the offset of their characters,
+ *   which follow the values, instead of a pointer.
+ * - DICTIONARY (STRING): the sorted distinct values and one bit-packed code per row. Codes are
+ *   ordered like the values, so comparisons are evaluated on the codes.
+ * - RLE (INT32, INT64, BOOL): runs of equal values, as the value and the end row of every run.
+ *   Comparisons are evaluated once per run.
+ * - FRAME_OF_REFERENCE (INT32, INT64): the minimum value and the bit-packed difference of every
+ *   row to it. Comparisons are evaluated on the differences against the adjusted constant.
+ *
+ * NULL rows hold an arbitrary value.
+ */
+enum class ColumnEncoding : uint8_t { PLAIN, DICTIONARY, RLE, FRAME_OF_REFERENCE };
+
+std::string columnEncodingToString(ColumnEncoding encoding) noexcept;
+
+/**
+ * @brief Rows of a column in the PLAIN layout, as buffered by a writer
+ */
+struct PlainChunk {
+    DataType type;
+    int64_t rowCount = 0;
+    // Validity bit of every row (1 = non-null)
+    const uint8_t* bitmap = nullptr;
+    const char* values = nullptr;
+    // Characters of the long strings, addressed by the offsets in their values
+    std::string_view chars;
+
+    bool isNull(int64_t row) const noexcept {
+        return (bitmap[row / 8] & (1 << (row % 8))) == 0;
+    }
+
+    int64_t getInt(int64_t row) const noexcept;
+
+    std::string_view getString(int64_t row) const;
+};
+
+/**
+ * @brief Encode the chunk with the encoding that takes the fewest bytes
+ * @param out The encoded chunk is appended, its size is a multiple of 8
+ * @return The chosen encoding
+ */
+ColumnEncoding encodeChunk(const PlainChunk& chunk, std::string& out);
+
+/**
+ * @brief Encode the chunk with the given encoding, which must support the column type
+ */
+void encodeChunk(const PlainChunk& chunk, ColumnEncoding encoding, std::string& out);
+
+/**
+ * @brief Read access to an encoded chunk, e.g. in a mapped file. Does not own the bytes.
+ */
+class EncodedChunk {
+public:
+    /**
+     * @brief Check the layout of the chunk
+     * @return nullopt if the bytes are not a valid chunk of rowCount rows
+     */
+    static std::optional<EncodedChunk> open(ColumnEncoding encoding, DataType type, const char* data, size_t size,
+                                            int64_t rowCount);
+
+    ColumnEncoding getEncoding() const noexcept { return encoding_; }
+
+    int64_t getRowCount() const noexcept { return row_count_; }
+
+    /**
+     * @brief Decode count rows starting at begin into rows 0 to count - 1 of out. Long strings
+     * are copied into heap.
+     */
+    void decode(int64_t begin, int64_t count, ColumnBuffer& out, StringHeap* heap) const;
+
+    /**
+     * @brief Decode the given rows into rows 0 to rows.size() - 1 of out
+     */
+    void gather(std::span<const int64_t> rows, ColumnBuffer& out, StringHeap* heap) const;
+
+    /**
+     * @brief Evaluate `value op constant` in the comparison domain on count rows starting at
+     * begin without decoding the values. passes[i] is cleared for every row that is not TRUE.
+     * @return false if the encoding does not support the comparison, passes is unchanged then
+     */
+    bool filter(CompareOp op, kernels::CompareDomain domain, const ConstantExpr& constant, int64_t begin,
+                int64_t count, std::vector<uint8_t>& passes) const;
+
+private:
+    ColumnEncoding encoding_ = ColumnEncoding::PLAIN;
+    DataType type_;
+    int64_t row_count_ = 0;
+    const uint8_t* bitmap_ = nullptr;
+
+    // PLAIN
+    const char* values_ = nullptr;
+    std::string_view chars_;
+
+    // DICTIONARY and FRAME_OF_REFERENCE
+    const char* packed_ = nullptr;
+    uint32_t bit_width_ = 0;
+    int64_t reference_ = 0;
+    uint32_t dictionary_size_ = 0;
+    const char* dictionary_offsets_ = nullptr;
+    std::string_view dictionary_chars_;
+
+    // RLE
+    uint32_t run_count_ = 0;
+    const char* run_values_ = nullptr;
+    const char* run_ends_ = nullptr;
+
+    EncodedChunk() = default;
+
+    bool isNull(int64_t row) const noexcept {
+        return (bitmap_[row / 8] & (1 << (row % 8))) == 0;
+    }
+
+    uint64_t getCode(int64_t row) const noexcept;
+    std::string_view getDictionaryValue(uint64_t code) const;
+    int64_t getRunValue(uint32_t run) const noexcept;
+    uint32_t getRunEnd(uint32_t run) const noexcept;
+    uint32_t findRun(int64_t row) const noexcept;
+    int64_t getInt(int64_t row) const;
+    std::string_view getString(int64_t row) const;
+    void writeRow(int64_t row, ColumnBuffer& out, int64_t index, StringHeap* heap) const;
+    void filterCodes(CompareOp op, uint64_t below, bool found, int64_t begin, int64_t count,
+                     std::vector<uint8_t>& passes) const;
+};
+
+}  // namespace toydb
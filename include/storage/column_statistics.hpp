@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "common/hyperloglog.hpp"
+#include "common/types.hpp"
+#include "engine/compare_kernels.hpp"
+#include "engine/predicate_expr.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Min/max and null statistics of a column over a range of rows (e.g. a Parquet row group
+ * or a whole table).
+ *
+ * min/max are only meaningful if hasMinMax is set. They are stored in the field matching the
+ * column type: intMin/intMax for INT32, INT64 and BOOL columns, doubleMin/doubleMax for DOUBLE
+ * and stringMin/stringMax for STRING.
+ */
+struct ColumnStatistics {
+    DataType type;
+    int64_t rowCount = 0;
+    int64_t nullCount = 0;
+
+    bool hasMinMax = false;
+    int64_t intMin = 0;
+    int64_t intMax = 0;
+    double doubleMin = 0.0;
+    double doubleMax = 0.0;
+    std::string stringMin;
+    std::string stringMax;
+
+    // Number of distinct non-null values, if known
+    std::optional<int64_t> distinctCount;
+    // Sketch of the distinct values, so statistics of different rows can be merged
+    std::optional<HyperLogLog> distinctSketch;
+
+    // Bounds of an equi-depth histogram of the non-null values of a numeric column: bucket i
+    // holds the values in [histogram[i], histogram[i + 1]], each bucket the same number of them
+    std::vector<double> histogram;
+
+    bool allNull() const noexcept {
+        return rowCount > 0 && nullCount == rowCount;
+    }
+
+    double nullFraction() const noexcept {
+        return rowCount > 0 ? static_cast<double>(nullCount) / static_cast<double>(rowCount) : 0.0;
+    }
+
+    /**
+     * @brief Estimated fraction of the non-null values below value, interpolating linearly
+     *        within the histogram buckets
+     * @return nullopt if there is no histogram
+     */
+    std::optional<double> fractionBelow(double value) const noexcept {
+        if (histogram.size() < 2) {
+            return std::nullopt;
+        }
+        if (value <= histogram.front()) {
+            return 0.0;
+        }
+        if (value >= histogram.back()) {
+            return 1.0;
+        }
+
+        // histogram[bucket] <= value < histogram[bucket + 1]
+        size_t upper = static_cast<size_t>(std::upper_bound(histogram.begin(), histogram.end(), value) - histogram.begin());
+        size_t bucket = upper - 1;
+        double withinBucket = (value - histogram[bucket]) / (histogram[upper] - histogram[bucket]);
+        return (static_cast<double>(bucket) + withinBucket) / static_cast<double>(histogram.size() - 1);
+    }
+};
+
+using StatisticsMap = std::unordered_map<ColumnId, ColumnStatistics, ColumnIdHash>;
+
+/**
+ * @brief Returns the statistics of a column, nullptr if there are none
+ */
+using StatisticsLookup = std::function<const ColumnStatistics*(const ColumnId&)>;
+
+namespace detail {
+
+template<typename T>
+inline bool rangeMayMatch(CompareOp op, const T& min, const T& max, const T& value) noexcept {
+    switch (op) {
+        case CompareOp::EQUAL: return min <= value && value <= max;
+        case CompareOp::NOT_EQUAL: return !(min == value && max == value);
+        case CompareOp::LESS: return min < value;
+        case CompareOp::LESS_EQUAL: return min <= value;
+        case CompareOp::GREATER: return max > value;
+        case CompareOp::GREATER_EQUAL: return max >= value;
+        default: return true;
+    }
+}
+
+inline bool compareMayMatch(CompareOp op, kernels::CompareDomain domain, const ColumnStatistics& stats,
+                            const ConstantExpr& constant) {
+    switch (domain) {
+        case kernels::CompareDomain::INTEGRAL: {
+            if (!kernels::isIntegralType(stats.type) || !kernels::isIntegralType(constant.getType())) {
+                return true;
+            }
+            int64_t value = constant.getType() == DataType::getBool() ? constant.getBoolValue() : constant.getIntValue();
+            return rangeMayMatch(op, stats.intMin, stats.intMax, value);
+        }
+        case kernels::CompareDomain::DOUBLE: {
+            bool statsIsDouble = stats.type == DataType::getDouble();
+            if (!statsIsDouble && !kernels::isIntegralType(stats.type)) {
+                return true;
+            }
+            double min = statsIsDouble ? stats.doubleMin : static_cast<double>(stats.intMin);
+            double max = statsIsDouble ? stats.doubleMax : static_cast<double>(stats.intMax);
+            double value = constant.getType() == DataType::getDouble() ? constant.getDoubleValue()
+                                                                       : static_cast<double>(constant.getIntValue());
+            return rangeMayMatch(op, min, max, value);
+        }
+        case kernels::CompareDomain::STRING:
+            if (stats.type != DataType::getString() || constant.getType() != DataType::getString()) {
+                return true;
+            }
+            return rangeMayMatch(op, std::string_view(stats.stringMin), std::string_view(stats.stringMax),
+                                 std::string_view(constant.getStringValue()));
+        case kernels::CompareDomain::INVALID:
+            return true;
+    }
+    return true;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Check whether any row described by the statistics may satisfy the predicate.
+ *
+ * Only comparisons between a column and a constant, combined with AND and OR, are used for
+ * pruning. Everything else is assumed to match. Returns false only if no row can evaluate to TRUE.
+ */
+inline bool mayMatch(const PredicateExpr& predicate, const StatisticsLookup& lookup) {
+    if (const auto* logical = dynamic_cast<const LogicalExpr*>(&predicate)) {
+        if (logical->getOp() == CompareOp::AND) {
+            return mayMatch(*logical->getLeft(), lookup) && mayMatch(*logical->getRight(), lookup);
+        }
+        if (logical->getOp() == CompareOp::OR) {
+            return mayMatch(*logical->getLeft(), lookup) || mayMatch(*logical->getRight(), lookup);
+        }
+        return true;
+    }
+
+    const auto* compare = dynamic_cast<const CompareExpr*>(&predicate);
+    if (!compare) {
+        return true;
+    }
+
+    CompareOp op = compare->getOp();
+    const auto* column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+    const auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getRight()));
+    if (!column || !constant) {
+        // Statistics are checked with the column on the left
+        column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+        constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getLeft()));
+        op = kernels::mirrorCompareOp(op);
+    }
+    if (!column || !constant) {
+        return true;
+    }
+
+    if (constant->isNull()) {
+        // Comparisons with NULL are never TRUE
+        return false;
+    }
+
+    const ColumnStatistics* stats = lookup(column->getColumnId());
+    if (!stats) {
+        return true;
+    }
+    if (stats->allNull()) {
+        return false;
+    }
+    if (!stats->hasMinMax) {
+        return true;
+    }
+
+    return detail::compareMayMatch(op, kernels::getCompareDomain(compare->getType()), *stats, *constant);
+}
+
+}  // namespace toydb
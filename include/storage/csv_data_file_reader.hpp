@@ -1,36 +1,74 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
+#include "engine/fused_predicate.hpp"
 #include "engine/physical_operator.hpp"
+#include "engine/string_heap.hpp"
+#include "storage/async_io.hpp"
 #include "storage/data_file_reader.hpp"
 #include "storage/catalog.hpp"
 #include "common/types.hpp"
 
 namespace toydb {
 
+/**
+ * @brief Byte range [begin, end) of a CSV file. A reader over the range reads the lines starting in it.
+ */
+struct CsvByteRange {
+    size_t begin;
+    size_t end;
+};
+
 /**
  * @brief Very dumb CSV file reader. The following is supported:
  * - Comma separated values
- * - Double quotes can be used to escape the comma (Double quotes cannot be escaped themselves right now)
+ * - Double quotes can be used to escape the comma and line breaks (Double quotes cannot be escaped themselves right now)
  * - DataTypes INT32, INT64, STRING, BOOL
  * - NULL/null values (Cannot be escaped...)
  * - BOOL values are case insensitive
  * - Invalid CSV is UB
+ *
+ * The file is memory mapped and fields are parsed in place: lines and fields are views of the
+ * mapping, numbers are parsed with std::from_chars and values are written directly into the
+ * target ColumnBuffer. Only fields containing double quotes are copied, to strip the quotes.
+ *
+ * Only projected fields are parsed, and lines are not split past the last of them. With a
+ * predicate, lines are read in chunks and materialized late: only the fields the predicate
+ * references are parsed into scratch columns, the predicate is evaluated on the whole chunk at
+ * once, and only the lines of the rows that pass are parsed into the output batch.
+ *
+ * With setAsyncIo, the file is read in blocks by an AsyncFileReader instead, which reads the next
+ * blocks while the current ones are parsed. Lines are then parsed from a window of the blocks read
+ * so far, the window drops the lines of the previous batch when the next one is read.
  */
 class CsvDataFileReader : public DataFileReader {
 public:
     CsvDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId);
 
+    /**
+     * @brief Only read the lines starting in range, which must be one returned by splitRanges.
+     * The header line is never part of a range.
+     */
+    CsvDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId,
+                      CsvByteRange range);
+
     CsvDataFileReader(const CsvDataFileReader&) = delete;
     CsvDataFileReader& operator=(const CsvDataFileReader&) = delete;
 
-    ~CsvDataFileReader() override = default;
+    ~CsvDataFileReader() override;
 
     /**
      * @brief Read a batch of rows from the CSV file. RowVector must be pre-allocated
-     * and initialized with the correct schema. Assertion failure / UB otherwise.
+     * and initialized with the projected columns. Assertion failure / UB otherwise.
+     * Long strings are stored in the column's string heap, or in the reader's heap if the
+     * column has none. The latter stay valid until the next call to readBatch.
      */
     int64_t readBatch(RowVector& out, int64_t requestedRows = 8192) override;
 
@@ -38,20 +76,97 @@ public:
 
     void reset() override;
 
+    void setProjection(const std::vector<ColumnId>& columns) override;
+
+    const std::vector<ColumnId>& getProjection() const noexcept override { return projection_; }
+
+    /**
+     * @brief Read the file with asynchronous block reads instead of from a memory mapping, e.g.
+     * for cold files on NVMe or network storage. Must be set before the first call to readBatch.
+     */
+    void setAsyncIo(const AsyncIoOptions& options);
+
+    /**
+     * @brief Skip rows for which the predicate is not TRUE. Its index map must be initialized.
+     * The predicate is ignored if it references columns that are not projected.
+     */
+    void setPredicate(const PredicateExpr* predicate) override;
+
     std::filesystem::path getPath() const noexcept override { return file_path_; }
 
     const Schema& getSchema() const noexcept override { return schema_; }
 
+    /**
+     * @brief Split the lines after the header into at most rangeCount ranges of similar size.
+     * Ranges start at line boundaries, line breaks inside quotes don't end a line. Needs the
+     * mapping, so not available after setAsyncIo.
+     */
+    std::vector<CsvByteRange> splitRanges(size_t rangeCount) const;
+
 private:
     std::filesystem::path file_path_;
     Schema schema_;
     TableId table_id_;
-    std::ifstream file_;
+    // Bytes available for parsing: the mapping of the file, or the window of blocks read so far
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    // Position in data_
+    size_t pos_ = 0;
+    // File offset of data_[0], only the window starts after 0
+    size_t window_offset_ = 0;
+    size_t file_size_ = 0;
+    // File offsets. Lines starting at or after range_end_ are left to the reader of the next range
+    size_t range_begin_ = 0;
+    size_t range_end_ = SIZE_MAX;
+    bool ranged_ = false;
     bool header_read_;
     bool eof_;
     char separator_ = ',';
+    StringHeap string_heap_;
+
+    // Set by setAsyncIo
+    std::optional<AsyncIoOptions> async_io_;
+    std::unique_ptr<AsyncFileReader> stream_;
+    std::string window_;
+
+    std::vector<ColumnId> projection_;
+    const PredicateExpr* predicate_ = nullptr;
+    // Field index of each projected column
+    std::vector<size_t> projected_fields_;
+    // Number of fields to split: up to the last projected one
+    size_t field_count_ = 0;
+    // Projected column of each column reference of the predicate, empty without a usable predicate
+    std::vector<size_t> predicate_columns_;
+    // Number of fields to split to reach all fields the predicate references
+    size_t predicate_field_count_ = 0;
+    // Compiled form of the predicate if it is a conjunction of comparisons with constants
+    std::optional<FusedPredicate> fused_predicate_;
+
+    // Scratch columns the predicate is evaluated on, in the order of its index map
+    RowVector predicate_input_;
+    std::vector<std::vector<uint8_t>> predicate_data_;
+    std::vector<std::vector<uint8_t>> predicate_nulls_;
+    StringHeap predicate_heap_;
+    // Result of the predicate on the current chunk and its intermediate results, reused across chunks
+    PredicateResultVector predicate_result_;
+    PredicateScratch predicate_scratch_;
+    // Lines of the current chunk as positions in data_, parsed again for the rows that pass the predicate
+    std::vector<CsvByteRange> chunk_lines_;
+
+    // Fields of the current line, views of the mapping or of quoted_fields_
+    std::vector<std::string_view> fields_;
+    std::string quoted_fields_;
 
-    std::vector<std::string> parseCSVLine(const std::string& line);
+    size_t getRangeEnd() const noexcept;
+    bool extendWindow();
+    void compactWindow();
+    size_t findNextLine(size_t from, bool inQuotes) const noexcept;
+    std::string_view nextLine();
+    void skipEmptyLines();
+    void parseCSVLine(std::string_view line, size_t maxFields);
+    void resolveColumns();
+    void allocatePredicateInput(int64_t capacity);
+    int64_t readFilteredBatch(const std::vector<ColumnBuffer*>& columnBuffers, int64_t requestedRows, size_t maxFields);
 };
 
 }  // namespace toydb
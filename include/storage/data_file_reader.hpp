@@ -2,7 +2,10 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <vector>
 #include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
 #include "storage/catalog.hpp"
 
 namespace toydb {
@@ -14,7 +17,7 @@ public:
     /**
      * @brief Read next batch of rows into the buffer
      * @param out Buffer to fill with column data. Must be pre-allocated,
-     * set up with the right schema and have enough capacity for the requested rows.
+     * set up with the projected columns and have enough capacity for the requested rows.
      * @param requestedRows Maximum number of rows to read (hint)
      * @return Number of rows actually read (0 if EOF)
      */
@@ -27,6 +30,30 @@ public:
      */
     virtual void reset() = 0;
 
+    /**
+     * @brief Only read the given columns of the schema, in this order. Defaults to all columns.
+     * Must be set before the first call to readBatch.
+     */
+    virtual void setProjection(const std::vector<ColumnId>& columns) = 0;
+
+    virtual const std::vector<ColumnId>& getProjection() const noexcept = 0;
+
+    /**
+     * @brief Allow the reader to skip rows that can't satisfy the predicate. Readers skip as much
+     * as their format allows, so the caller still has to filter the rows that are read.
+     * The predicate must outlive the reader. Must be set before the first call to readBatch.
+     */
+    virtual void setPredicate(const PredicateExpr* predicate) = 0;
+
+    /**
+     * @brief Only read the rows at the given positions of the file, ascending, e.g. looked up in a
+     * SecondaryIndex. Must be set before the first call to readBatch.
+     * @return false if the reader can't seek to rows, it reads all of them then
+     */
+    virtual bool setRowPositions([[maybe_unused]] std::shared_ptr<const std::vector<int64_t>> positions) {
+        return false;
+    }
+
     virtual std::filesystem::path getPath() const noexcept = 0;
 
     virtual const Schema& getSchema() const noexcept = 0;
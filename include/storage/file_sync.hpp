@@ -0,0 +1,23 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+
+namespace toydb {
+
+/**
+ * @brief Flush a file, or a directory after files in it were created or renamed, to disk
+ * @return false if it could not be opened or synced
+ */
+inline bool syncPath(const std::filesystem::path& path) noexcept {
+    int fd = open(path.c_str(), std::filesystem::is_directory(path) ? O_RDONLY : O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+}  // namespace toydb
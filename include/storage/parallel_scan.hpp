@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/morsel.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/csv_data_file_reader.hpp"
+#include "storage/data_file_reader.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Chunks [begin, end) of the rows of a table cached in memory (see TableCache)
+ */
+struct ChunkRange {
+    size_t begin;
+    size_t end;
+};
+
+/**
+ * @brief Part of a table read by a single worker: a whole file, a byte range of a CSV file, the
+ * rows of a file found in a secondary index, or a range of chunks of a cached table
+ */
+struct ScanUnit {
+    std::filesystem::path path;
+    std::optional<CsvByteRange> range;
+    // Estimated cost of reading the unit (rows or bytes), larger units are read first
+    int64_t weight = 0;
+    // Read from the cached rows instead of the file
+    std::optional<ChunkRange> chunks;
+    // Only read the rows at these positions of the file, ascending
+    std::shared_ptr<const std::vector<int64_t>> rows = nullptr;
+};
+
+using ScanReaderFactory = std::function<std::unique_ptr<DataFileReader>(const ScanUnit&)>;
+
+/**
+ * @brief Reads scan units with several worker threads.
+ *
+ * Workers claim one unit at a time, largest weight first, and read it into batches which are
+ * handed to the single consumer calling next(). Claiming the next unit while the consumer is
+ * still busy with the batches of the last one opens the next file and prefetches its first
+ * batches. Workers pause while a few batches per worker are waiting for the consumer.
+ * Batches arrive in no particular order.
+ *
+ * As a MorselSource the scan hands out shared batches instead, which the pipeline executor
+ * splits into morsels without copying.
+ */
+class ParallelScan : public MorselSource {
+public:
+    ParallelScan(std::vector<ScanUnit> units, ScanReaderFactory readerFactory, std::vector<ColumnDescriptor> schema,
+                 size_t workerCount, int64_t batchSize = 8192);
+
+    ParallelScan(const ParallelScan&) = delete;
+    ParallelScan& operator=(const ParallelScan&) = delete;
+
+    ~ParallelScan() override;
+
+    /**
+     * @brief Hand out the next batch, with one column per schema column. The batch is owned by
+     * the scan and stays valid until the next call. Rethrows exceptions of the workers.
+     * @return Number of rows in the batch, 0 once all units are exhausted
+     */
+    int64_t next(RowVector& out);
+
+    /**
+     * @brief Hand out the next batch, which stays valid as long as it is referenced. Must not
+     * be mixed with next().
+     * @return nullptr once all units are exhausted
+     */
+    std::shared_ptr<const RowVector> nextBatch() override;
+
+    /**
+     * @brief Whether next() may return more rows
+     */
+    bool hasMore() const noexcept;
+
+    size_t getWorkerCount() const noexcept { return workers_.size(); }
+
+    size_t getUnitCount() const noexcept { return units_.size(); }
+
+private:
+    struct Batch {
+        BatchAllocator allocator;
+        RowVector rows;
+    };
+
+    static constexpr size_t QUEUED_BATCHES_PER_WORKER = 2;
+
+    std::vector<ScanUnit> units_;
+    ScanReaderFactory reader_factory_;
+    // Shared by all batches of the scan
+    std::shared_ptr<const BatchSchema> schema_;
+    int64_t batch_rows_;
+
+    memory::BufferManager buffer_manager_;
+    std::atomic<size_t> next_unit_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable batch_ready_;
+    std::condition_variable space_available_;
+    std::deque<std::unique_ptr<Batch>> queue_;
+    size_t queue_capacity_ = 0;
+    size_t active_workers_ = 0;
+    bool stopped_ = false;
+    std::exception_ptr error_;
+
+    // Batch handed out by the last call to next()
+    std::unique_ptr<Batch> current_;
+    std::vector<std::thread> workers_;
+
+    void runWorker();
+    bool push(std::unique_ptr<Batch> batch);
+    std::unique_ptr<Batch> pop();
+};
+
+}  // namespace toydb
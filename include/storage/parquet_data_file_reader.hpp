@@ -0,0 +1,107 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
+#include "storage/catalog.hpp"
+#include "storage/column_statistics.hpp"
+#include "storage/data_file_reader.hpp"
+
+namespace arrow {
+class RecordBatch;
+class RecordBatchReader;
+}  // namespace arrow
+
+namespace parquet::arrow {
+class FileReader;
+}  // namespace parquet::arrow
+
+namespace toydb {
+
+/**
+ * @brief Streams the record batches of a Parquet file into RowVectors.
+ *
+ * Schema columns are matched to the top-level fields of the file by name, nested columns are
+ * not supported. The following Arrow types are supported: int32, int64, double, bool, string
+ * and large_string, mapped to INT32, INT64, DOUBLE, BOOL and STRING.
+ *
+ * Only the projected columns are read, and row groups whose min/max statistics rule out the
+ * predicate are skipped. Both must be set before the first call to readBatch.
+ */
+class ParquetDataFileReader : public DataFileReader {
+public:
+    ParquetDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId);
+
+    ParquetDataFileReader(const ParquetDataFileReader&) = delete;
+    ParquetDataFileReader& operator=(const ParquetDataFileReader&) = delete;
+
+    ~ParquetDataFileReader() override;
+
+    void setProjection(const std::vector<ColumnId>& columns) override;
+
+    /**
+     * @brief Skip row groups in which no row can satisfy the predicate. The predicate is not
+     * evaluated on the rows that are read.
+     */
+    void setPredicate(const PredicateExpr* predicate) override;
+
+    /**
+     * @brief Read a batch of rows from the Parquet file. RowVector must be pre-allocated
+     * and initialized with the projected columns. Assertion failure / UB otherwise.
+     * Long strings are stored in the column's string heap, or in the reader's heap if the
+     * column has none. The latter stay valid until the next call to readBatch.
+     */
+    int64_t readBatch(RowVector& out, int64_t requestedRows = 8192) override;
+
+    bool hasMore() const noexcept override;
+
+    void reset() override;
+
+    std::filesystem::path getPath() const noexcept override { return file_path_; }
+
+    const Schema& getSchema() const noexcept override { return schema_; }
+
+    const std::vector<ColumnId>& getProjection() const noexcept override { return projection_; }
+
+    int getRowGroupCount() const noexcept;
+
+    /**
+     * @brief Row groups that are read after pruning. Only valid after the first readBatch.
+     */
+    const std::vector<int>& getSelectedRowGroups() const noexcept { return row_groups_; }
+
+private:
+    std::filesystem::path file_path_;
+    Schema schema_;
+    TableId table_id_;
+    std::vector<ColumnId> projection_;
+    const PredicateExpr* predicate_ = nullptr;
+
+    std::unique_ptr<parquet::arrow::FileReader> reader_;
+    // File column index of each schema column, -1 if the file doesn't contain it
+    std::vector<int> file_columns_;
+
+    std::vector<int> row_groups_;
+    // Names of the projected columns in the file
+    std::vector<std::string> projected_names_;
+    std::unique_ptr<arrow::RecordBatchReader> batch_reader_;
+    std::shared_ptr<arrow::RecordBatch> batch_;
+    int64_t batch_offset_ = 0;
+    bool started_ = false;
+    bool eof_ = false;
+    StringHeap string_heap_;
+
+    bool open();
+    bool startReading();
+    bool fetchBatch();
+    void selectRowGroups();
+    std::vector<ColumnStatistics> getRowGroupStatistics(int rowGroup) const;
+    int getFileColumn(const ColumnId& columnId) const;
+};
+
+}  // namespace toydb
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/memory.hpp"
+#include "engine/predicate_expr.hpp"
+
+namespace toydb {
+
+class TableHandle;
+
+/**
+ * @brief Inclusive range of keys of an index lookup
+ */
+struct IndexRange {
+    int64_t low = std::numeric_limits<int64_t>::min();
+    int64_t high = std::numeric_limits<int64_t>::max();
+
+    bool isEmpty() const noexcept { return low > high; }
+};
+
+/**
+ * @brief Range of the keys of a column that a predicate can be TRUE for: the intersection of the
+ *        comparisons of the column with integral constants in the conjunction of the predicate
+ * @return nullopt if the conjunction doesn't compare the column with a constant
+ */
+std::optional<IndexRange> getIndexRange(const PredicateExpr& predicate, const ColumnId& column);
+
+/**
+ * @brief Keys of a column that a predicate can be TRUE for, if the conjunction of the predicate
+ *        holds a Bloom filter of the column with its keys, e.g. the runtime filter of a hash join
+ * @return The keys ascending, restricted to getIndexRange, nullopt if no filter has its keys
+ */
+std::optional<std::vector<int64_t>> getIndexKeys(const PredicateExpr& predicate, const ColumnId& column);
+
+/**
+ * @brief Persistent index of an INT32 or INT64 column of a table: a sorted run of all its non-null
+ * keys with the position of their row, plus a sparse index of the first key of every block.
+ *
+ *   MAGIC | entries | first key of every block | entry count (u64) | file count (u64) | MAGIC
+ *
+ *   entry = key (i64) | file (u32) | row in the file (u32)
+ *
+ * Only the sparse index is read when the index is opened, a lookup reads the blocks overlapping
+ * its range. Both are read through a page cache shared by all indexes, so that the indexes of
+ * hot tables are served from memory across queries. Files appended to the table after the index
+ * was built are not covered, they have to be scanned. Values are stored in the byte order of the machine that wrote the file.
+ */
+class SecondaryIndex {
+public:
+    static constexpr char MAGIC[4] = {'T', 'D', 'X', '1'};
+    static constexpr size_t BLOCK_ENTRIES = 512;
+    // Frames of the page cache shared by all indexes, 16MB
+    static constexpr size_t CACHE_FRAMES = 256;
+
+    ~SecondaryIndex();
+
+    SecondaryIndex(const SecondaryIndex&) = delete;
+    SecondaryIndex& operator=(const SecondaryIndex&) = delete;
+
+    /**
+     * @brief Read the column of every file of the table and write the index
+     * @return false if the column has no integral type or a file could not be read or written
+     */
+    static bool build(const TableHandle& table, const ColumnId& column, const std::filesystem::path& path);
+
+    /**
+     * @return nullptr if the file is not a valid index
+     */
+    static std::unique_ptr<SecondaryIndex> open(const std::filesystem::path& path);
+
+    /**
+     * @brief Positions of the rows whose key is in the range, ascending, one list per indexed file
+     */
+    std::vector<std::vector<int64_t>> lookup(const IndexRange& range) const;
+
+    /**
+     * @brief Positions of the rows with one of the keys, ascending, one list per indexed file. Only
+     *        the blocks that may hold one of the keys are read, each once.
+     * @param keys Ascending
+     */
+    std::vector<std::vector<int64_t>> lookupKeys(std::span<const int64_t> keys) const;
+
+    /**
+     * @brief Number of indexed rows, rows with a null key are not indexed
+     */
+    int64_t getEntryCount() const noexcept { return entry_count_; }
+
+    size_t getFileCount() const noexcept { return file_count_; }
+
+    /**
+     * @brief Cache of the pages of all index files, e.g. for tests and statistics
+     */
+    static const memory::PageCache& getPageCache();
+
+private:
+    struct Entry {
+        int64_t key;
+        uint32_t file;
+        uint32_t row;
+    };
+
+    std::filesystem::path path_;
+    int fd_ = -1;
+    memory::MemoryManager memory_;
+    // Pages of the file in the shared page cache
+    std::unique_ptr<memory::PageDirectory> pages_;
+    int64_t entry_count_ = 0;
+    size_t file_count_ = 0;
+    // First key of every block
+    std::vector<int64_t> fences_;
+
+    explicit SecondaryIndex(std::filesystem::path path) : path_(std::move(path)) {}
+
+    /**
+     * @brief Blocks [first, end) of the keys in the range, empty if no block overlaps it
+     */
+    std::pair<size_t, size_t> getBlocks(const IndexRange& range) const;
+
+    /**
+     * @brief Decode the entries of blocks [first, end)
+     * @throws std::runtime_error if the blocks could not be read
+     */
+    std::vector<Entry> readBlocks(size_t first, size_t end) const;
+
+    /**
+     * @brief Copy the bytes at offset of the file into out, through the page cache
+     */
+    bool read(size_t offset, std::span<char> out) const;
+};
+
+}  // namespace toydb
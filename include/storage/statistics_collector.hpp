@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/column_statistics.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Computes the ColumnStatistics of a set of rows, e.g. of a data file, batch by batch.
+ *
+ * Collects the row and null counts, min/max, a HyperLogLog sketch of the distinct values and, for
+ * numeric columns, an equi-depth histogram. The histogram is built from a reservoir sample of
+ * SAMPLE_SIZE values, so collecting statistics needs constant memory per column.
+ */
+class StatisticsCollector {
+public:
+    static constexpr size_t HISTOGRAM_BUCKETS = 16;
+    static constexpr size_t SAMPLE_SIZE = 16384;
+
+    explicit StatisticsCollector(std::vector<ColumnDescriptor> columns);
+
+    /**
+     * @brief Add the selected rows of a batch, whose columns are the collector's in the same order
+     */
+    void add(const RowVector& batch);
+
+    int64_t getRowCount() const noexcept {
+        return rowCount_;
+    }
+
+    StatisticsMap finish() const;
+
+private:
+    struct ColumnState {
+        ColumnStatistics stats;
+        std::vector<double> sample;
+        // Non-null values offered to the sample
+        int64_t sampled = 0;
+    };
+
+    std::vector<ColumnDescriptor> columns_;
+    std::vector<ColumnState> states_;
+    int64_t rowCount_ = 0;
+    // Fixed seed, analyzing the same data gives the same statistics
+    std::mt19937_64 random_{42};
+
+    void addSample(ColumnState& state, double value);
+};
+
+/**
+ * @brief Combine the statistics of disjoint sets of rows of a column, e.g. of the files of a table.
+ *        Distinct counts are only known if all parts have a sketch.
+ */
+ColumnStatistics mergeColumnStatistics(const std::vector<const ColumnStatistics*>& parts);
+
+}  // namespace toydb
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/column_statistics.hpp"
+
+namespace toydb {
+
+class TableHandle;
+
+/**
+ * @brief Size and modification time of a data file, which change whenever the file is rewritten
+ */
+struct FileSignature {
+    std::filesystem::path path;
+    uintmax_t size = 0;
+    std::filesystem::file_time_type modified;
+
+    bool operator==(const FileSignature&) const = default;
+
+    /**
+     * @return nullopt if the file doesn't exist
+     */
+    static std::optional<FileSignature> of(const std::filesystem::path& path);
+};
+
+/**
+ * @brief All rows of a table, decoded into chunks with one ColumnBuffer per column of the table.
+ * Immutable once loaded and shared by the scans reading it.
+ */
+class CachedTable {
+public:
+    CachedTable(std::vector<ColumnDescriptor> columns, std::vector<FileSignature> files);
+
+    CachedTable(const CachedTable&) = delete;
+    CachedTable& operator=(const CachedTable&) = delete;
+
+    /**
+     * @brief Copy the selected rows of a batch with all columns of the table, in the same order
+     */
+    void append(const RowVector& batch);
+
+    /**
+     * @brief Compute the min/max of the columns of every chunk, after the last append
+     */
+    void finish();
+
+    const std::vector<ColumnDescriptor>& getColumns() const noexcept { return columns_; }
+
+    const std::vector<FileSignature>& getFiles() const noexcept { return files_; }
+
+    const MaterializedInput& getRows() const noexcept { return rows_; }
+
+    /**
+     * @brief Row count, null count and min/max of the columns of a chunk, in the order of the table's columns
+     */
+    const std::vector<ColumnStatistics>& getChunkStatistics(size_t chunk) const;
+
+    /**
+     * @brief Index of a column of the table, -1 if it does not exist
+     */
+    int64_t getColumnIndex(const ColumnId& columnId) const noexcept;
+
+    size_t getMemoryUsage() const noexcept { return rows_.getMemoryUsage(); }
+
+private:
+    std::vector<ColumnDescriptor> columns_;
+    std::vector<FileSignature> files_;
+    // Declared before the rows, which return their buffers to it
+    memory::BufferManager buffer_manager_;
+    MaterializedInput rows_{&buffer_manager_};
+    std::vector<std::vector<ColumnStatistics>> chunk_statistics_;
+};
+
+/**
+ * @brief Keeps the decoded rows of recently scanned tables in memory, so that repeated scans
+ * don't read and parse their files again.
+ *
+ * Entries are keyed by TableId and remember the columns of the table and the size and
+ * modification time of its files. A lookup with a handle that lists other columns or files, or
+ * after a file changed on disk, reloads the table. Once the cached rows exceed the memory budget,
+ * tables are evicted least recently used first. Tables larger than the budget are not cached.
+ * Thread-safe.
+ */
+class TableCache {
+public:
+    explicit TableCache(size_t memoryBudget);
+
+    /**
+     * @brief Budget selected by TOYDB_TABLE_CACHE (bytes), nullopt if it is unset or 0
+     */
+    static std::optional<size_t> getBudgetFromEnvironment();
+
+    /**
+     * @brief Cached rows of the table, read from its files with workerCount threads on a miss
+     * @return nullptr if the table doesn't fit into the budget or its files can't be read
+     */
+    std::shared_ptr<const CachedTable> getOrLoad(const TableHandle& table, size_t workerCount);
+
+    /**
+     * @brief Drop the rows of a table, e.g. because its entry in the manifest changed. Scans
+     * that are still reading them keep them alive.
+     */
+    void invalidate(const TableId& tableId);
+
+    void clear();
+
+    size_t getMemoryBudget() const noexcept { return memory_budget_; }
+
+    size_t getMemoryUsage() const;
+
+    size_t getTableCount() const;
+
+    int64_t getHitCount() const;
+
+    int64_t getMissCount() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CachedTable> table;
+        // Position in lru_
+        std::list<TableId>::iterator position;
+    };
+
+    size_t memory_budget_;
+    mutable std::mutex mutex_;
+    std::unordered_map<TableId, Entry, TableIdHash> entries_;
+    // Most recently used first
+    std::list<TableId> lru_;
+    // Files of tables that were too large to cache, so they are not read twice on every scan
+    std::unordered_map<TableId, std::vector<FileSignature>, TableIdHash> oversized_;
+    size_t memory_usage_ = 0;
+    int64_t hits_ = 0;
+    int64_t misses_ = 0;
+
+    std::shared_ptr<CachedTable> load(const TableHandle& table, std::vector<FileSignature> files,
+                                      size_t workerCount) const;
+    void insert(const TableId& tableId, std::shared_ptr<const CachedTable> table);
+    void erase(const TableId& tableId);
+};
+
+}  // namespace toydb
@@ -2,22 +2,30 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <thread>
 #include <vector>
 #include "common/assert.hpp"
+#include "engine/batch_allocator.hpp"
 #include "engine/physical_operator.hpp"
 #include "storage/catalog.hpp"
+#include "storage/csv_data_file_reader.hpp"
 #include "storage/data_file_reader.hpp"
+#include "storage/parallel_scan.hpp"
 #include "common/types.hpp"
 
 namespace toydb {
 
+class CachedTable;
+class TableCache;
+
 class TableIterator {
 public:
     virtual ~TableIterator() = default;
 
     /**
      * @brief Read next batch of rows
-     * @param out Buffer to fill with column data
+     * @param out Set to a batch owned by the iterator, which stays valid until the next call
      * @return Number of rows read (0 if no more data)
      */
     virtual int64_t next(RowVector& out) = 0;
@@ -31,15 +39,35 @@ public:
      * @brief Reset iterator to beginning
      */
     virtual void reset() = 0;
+
+    /**
+     * @brief Only read the given columns, in this order. Defaults to all columns of the table.
+     * Takes effect on the next call to next() after a reset.
+     */
+    virtual void setProjection(std::vector<ColumnId> columns) = 0;
+
+    /**
+     * @brief Push a predicate down to the file readers, which may skip rows that can't satisfy it.
+     * Rows that are read still have to be filtered. The predicate must be projected, have its
+     * index map initialized and outlive the iterator. Takes effect on the next call to next() after a reset.
+     */
+    virtual void setPredicate(const PredicateExpr* predicate) = 0;
 };
 
 class TableHandle {
 public:
-    explicit TableHandle(TableId tableId, StorageFormat format, const std::vector<ColumnMetadata>& schema,
-                         const std::vector<std::filesystem::path>& filePaths)
-    : table_id_(tableId), format_(format), schema_(schema), file_paths_(filePaths) {
-        tdb_assert(filePaths.size() == 1, "TableHandle currently only supports exactly one file");
-    }
+    /**
+     * @param metadata Metadata of the table in a catalog snapshot, shared by the handle
+     * @param dataDirectory Directory that relative paths of files and indexes are resolved against
+     */
+    TableHandle(std::shared_ptr<const TableMetadata> metadata, std::filesystem::path dataDirectory);
+
+    /**
+     * @param schema Columns of the table with their catalog ids, which the readers produce
+     * @param files Data files of the table, with paths readers can open
+     */
+    explicit TableHandle(TableId tableId, StorageFormat format, const Schema& schema,
+                         const std::vector<FileEntry>& files);
 
     TableHandle(const TableHandle&) = delete;
     TableHandle& operator=(const TableHandle&) = delete;
@@ -48,32 +76,143 @@ public:
 
     /**
      * @brief Create iterator for reading table in batches
+     * @param workerCount Number of threads reading files concurrently
      */
-    std::unique_ptr<TableIterator> createIterator(int64_t requestedBatchSize = 8192);
+    std::unique_ptr<TableIterator> createIterator(int64_t requestedBatchSize = 8192,
+                                                  size_t workerCount = std::thread::hardware_concurrency());
 
-    const std::vector<ColumnMetadata>& getSchema() const noexcept { return schema_; }
+    /**
+     * @brief Start reading the table with workerCount threads, e.g. as the morsel source of a pipeline.
+     * Reads the cached rows of the table if it has a table cache, which loads them on the first scan.
+     * @param projection Columns to read, all columns of the table if empty
+     * @param predicate Pushed down to the file readers, see TableIterator::setPredicate
+     */
+    std::unique_ptr<ParallelScan> createScan(int64_t batchSize = 8192,
+                                             size_t workerCount = std::thread::hardware_concurrency(),
+                                             const std::vector<ColumnId>& projection = {},
+                                             const PredicateExpr* predicate = nullptr) const;
 
-    TableId getTableId() const noexcept { return table_id_; }
+    /**
+     * @brief Like createScan, but always reads the data files. Only reads the rows a secondary
+     * index finds for the predicate if it restricts an indexed column to few enough keys.
+     */
+    std::unique_ptr<ParallelScan> createFileScan(int64_t batchSize = 8192,
+                                                 size_t workerCount = std::thread::hardware_concurrency(),
+                                                 const std::vector<ColumnId>& projection = {},
+                                                 const PredicateExpr* predicate = nullptr) const;
 
-    StorageFormat getFormat() const noexcept { return format_; }
+    /**
+     * @brief Secondary indexes of the table, with paths as listed in the catalog, see resolvePath
+     */
+    const std::vector<IndexMetadata>& getIndexes() const noexcept;
 
-    std::vector<std::filesystem::path> getFilePaths() const noexcept { return file_paths_; }
+    /**
+     * @brief Drop the files that are not part of a file level sample, e.g. for TABLESAMPLE SYSTEM.
+     *        Which files are kept only depends on their paths and the seed. Scans of the sampled
+     *        table read the remaining files, without the table cache or the secondary indexes.
+     */
+    void sampleFiles(const TableSample& sample);
+
+    /**
+     * @brief Only keep the files [begin, end), e.g. the files appended since a materialized view
+     *        was refreshed. Scans read them without the table cache or the secondary indexes.
+     */
+    void selectFiles(size_t begin, size_t end);
 
     /**
-     * @brief Factory method to create a file reader for the given file path and file format
+     * @brief Serve scans from the given cache, nullptr to read the files
      */
-    std::unique_ptr<DataFileReader> createFileReader(const std::filesystem::path& filePath);
+    void setTableCache(std::shared_ptr<TableCache> cache) noexcept { table_cache_ = std::move(cache); }
+
+    const std::vector<ColumnMetadata>& getSchema() const noexcept { return columns_; }
+
+    const std::vector<ColumnId>& getColumnIds() const noexcept { return metadata_->schema.getColumnIds(); }
+
+    TableId getTableId() const noexcept { return metadata_->id; }
+
+    StorageFormat getFormat() const noexcept { return metadata_->format; }
+
+    /**
+     * @brief Metadata of the table the handle was created from, regardless of sampled or selected files
+     */
+    const std::shared_ptr<const TableMetadata>& getMetadata() const noexcept { return metadata_; }
+
+    /**
+     * @brief Data files of the table, with paths as listed in the catalog, see resolvePath
+     */
+    const std::vector<FileEntry>& getFiles() const noexcept { return *files_; }
+
+    /**
+     * @brief Paths of the data files that readers can open
+     */
+    std::vector<std::filesystem::path> getFilePaths() const noexcept;
+
+    /**
+     * @brief Resolve the path of a file or index of the table against the data directory
+     */
+    std::filesystem::path resolvePath(const std::filesystem::path& path) const { return data_directory_ / path; }
+
+    /**
+     * @brief Factory method to create a file reader for the given file path and file format.
+     * The reader reads all columns until a projection is set.
+     * @param range Only read the given byte range of a CSV file
+     */
+    std::unique_ptr<DataFileReader> createFileReader(const std::filesystem::path& filePath,
+                                                     std::optional<CsvByteRange> range = std::nullopt) const;
+
+    /**
+     * @brief Split the table into units for workerCount workers. Files are balanced by their
+     * row count, or by their size if the manifest doesn't list row counts for all of them.
+     * Large CSV files are split into byte ranges if there are too few files to keep all workers busy.
+     * @param predicate Files whose statistics show that no row can satisfy it are skipped
+     */
+    std::vector<ScanUnit> planScanUnits(size_t workerCount, const PredicateExpr* predicate = nullptr) const;
+
+    /**
+     * @brief Read a data file of the table and compute the statistics of all its columns
+     * @return The file with its exact row count and statistics
+     */
+    FileEntry analyzeFile(const FileEntry& file, int64_t batchSize = 8192) const;
+
+    /**
+     * @brief Id and type of the given columns, all columns of the table if empty
+     */
+    std::vector<ColumnDescriptor> getColumnDescriptors(const std::vector<ColumnId>& columns = {}) const;
 
 private:
-    TableId table_id_;
-    StorageFormat format_;
-    std::vector<ColumnMetadata> schema_;
-    std::vector<std::filesystem::path> file_paths_;
+    // Units per worker planned for a table, so that workers finishing early can take over work
+    static constexpr size_t UNITS_PER_WORKER = 4;
+    // CSV files are not split into ranges smaller than this
+    static constexpr size_t MIN_RANGE_BYTES = 64 * 1024;
+    // An index is only used if at most 1 / INDEX_SELECTIVITY of the rows it covers match
+    static constexpr int64_t INDEX_SELECTIVITY = 16;
+
+    std::shared_ptr<const TableMetadata> metadata_;
+    std::filesystem::path data_directory_;
+    // The files of metadata_, until some of them are sampled or selected
+    std::shared_ptr<const std::vector<FileEntry>> files_;
+    bool use_indexes_ = true;
+    std::vector<ColumnMetadata> columns_;
+    std::shared_ptr<TableCache> table_cache_;
+
+    /**
+     * @brief Units reading the rows the most selective index finds for the predicate, and the
+     *        files appended after it was built
+     * @return nullopt if no index restricts the predicate to few enough rows
+     */
+    std::optional<std::vector<ScanUnit>> planIndexScanUnits(const PredicateExpr& predicate) const;
+
+    std::unique_ptr<ParallelScan> createCachedScan(std::shared_ptr<const CachedTable> cached, int64_t batchSize,
+                                                   size_t workerCount, const std::vector<ColumnId>& projection,
+                                                   const PredicateExpr* predicate) const;
 };
 
+/**
+ * @brief Reads the files of a table with a ParallelScan. Batches of different files are returned interleaved.
+ */
 class TableIteratorImpl : public TableIterator {
 public:
-    TableIteratorImpl(TableHandle* handle, int64_t batchSize);
+    TableIteratorImpl(TableHandle* handle, int64_t batchSize, size_t workerCount);
 
     int64_t next(RowVector& out) override;
 
@@ -81,12 +220,17 @@ public:
 
     void reset() override;
 
+    void setProjection(std::vector<ColumnId> columns) override;
+
+    void setPredicate(const PredicateExpr* predicate) override;
+
 private:
     TableHandle* handle_;
     int64_t batch_size_;
-    size_t current_file_index_;
-    std::vector<std::unique_ptr<DataFileReader>> readers_;
-    bool initialized_;
+    size_t worker_count_;
+    std::vector<ColumnId> projection_;
+    const PredicateExpr* predicate_ = nullptr;
+    std::unique_ptr<ParallelScan> scan_;
 
     void initialize();
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Appends rows to a TDB or Parquet table. Appended batches are copied into a write buffer,
+ * flush() writes the buffered rows into a single new data file and adds it to the catalog.
+ *
+ * The file is synced once, before the manifest listing it is replaced. A crash leaves either the
+ * table as it was, with at most an unlisted file next to it, or the table with all flushed rows.
+ */
+class TableWriter {
+public:
+    /**
+     * @throws SQLRuntimeException if the table doesn't exist or is stored as CSV
+     */
+    TableWriter(Catalog* catalog, const TableId& tableId);
+
+    TableWriter(const TableWriter&) = delete;
+    TableWriter& operator=(const TableWriter&) = delete;
+
+    /**
+     * @brief Copy the selected rows of a batch, whose columns are the table's in the same order
+     */
+    void append(const RowVector& batch);
+
+    int64_t getBufferedRowCount() const noexcept {
+        return buffer_.getRowCount();
+    }
+
+    /**
+     * @brief Write the buffered rows into a new data file of the table, with its row count and
+     *        column statistics, and add it to the catalog. Does nothing if no rows are buffered.
+     * @return CatalogError::WRITE_FAILED if the file could not be written, the error of the catalog
+     *         if it could not be added
+     */
+    std::expected<void, CatalogError> flush();
+
+    /**
+     * @brief Write the buffered rows into a data file without adding it to the catalog
+     * @param path Path of the file, e.g. from Catalog::createFilePath. An existing file is replaced.
+     * @param sync Whether to sync the file, unless it is made durable otherwise, e.g. by a WriteAheadLog
+     * @return The file with its row count and column statistics, nullopt if it could not be written
+     */
+    std::optional<FileEntry> writeFile(const std::filesystem::path& path, bool sync);
+
+private:
+    Catalog* catalog_;
+    std::unique_ptr<TableHandle> table_;
+    memory::BufferManager bufferManager_;
+    MaterializedInput buffer_;
+
+    bool writeTdb(const std::filesystem::path& path) const;
+    bool writeParquet(const std::filesystem::path& path) const;
+};
+
+}  // namespace toydb
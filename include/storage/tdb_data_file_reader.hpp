@@ -0,0 +1,139 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/memory.hpp"
+#include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
+#include "storage/catalog.hpp"
+#include "storage/column_encoding.hpp"
+#include "storage/data_file_reader.hpp"
+#include "storage/tdb_file.hpp"
+
+namespace toydb {
+
+/**
+ * @brief Reads TDB files (see tdb_file.hpp) from a read-only mapping of the file.
+ *
+ * Schema columns are matched to the file columns by name and must have the same type. PLAIN
+ * chunks of the projected columns are copied into the output columns as they are, only long
+ * strings are copied into a string heap, encoded chunks are decoded. Batches end at zone
+ * boundaries.
+ *
+ * Row groups and zones whose min/max rule out the predicate are skipped. Comparisons of a column with a
+ * constant in the conjunction of the predicate are evaluated on the encoded chunks of the rows
+ * (see EncodedChunk::filter), and only the rows passing all of them are decoded. With row
+ * positions, only the row groups containing them are read and only those rows are decoded.
+ */
+class TdbDataFileReader : public DataFileReader {
+public:
+    TdbDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId);
+
+    TdbDataFileReader(const TdbDataFileReader&) = delete;
+    TdbDataFileReader& operator=(const TdbDataFileReader&) = delete;
+
+    ~TdbDataFileReader() override;
+
+    void setProjection(const std::vector<ColumnId>& columns) override;
+
+    /**
+     * @brief Skip row groups and zones in which no row can satisfy the predicate, and rows for which a
+     * comparison evaluated on the encoded chunks is not TRUE. The rest of the predicate is not
+     * evaluated on the rows that are read.
+     */
+    void setPredicate(const PredicateExpr* predicate) override;
+
+    bool setRowPositions(std::shared_ptr<const std::vector<int64_t>> positions) override;
+
+    /**
+     * @brief Read up to requestedRows rows of the current row group. RowVector must be
+     * pre-allocated and initialized with the projected columns. Long strings are stored in the
+     * column's string heap, or in the reader's heap if the column has none. The latter stay valid
+     * until the next call to readBatch.
+     */
+    int64_t readBatch(RowVector& out, int64_t requestedRows = 8192) override;
+
+    /**
+     * @brief Rows skipped because a comparison evaluated on encoded chunks was not TRUE
+     */
+    int64_t getFilteredRowCount() const noexcept { return filtered_rows_; }
+
+    /**
+     * @brief Zones of the selected row groups skipped because their min/max ruled out the predicate
+     */
+    int64_t getSkippedZoneCount() const noexcept { return skipped_zones_; }
+
+    bool hasMore() const noexcept override;
+
+    void reset() override;
+
+    std::filesystem::path getPath() const noexcept override { return file_path_; }
+
+    const Schema& getSchema() const noexcept override { return schema_; }
+
+    const std::vector<ColumnId>& getProjection() const noexcept override { return projection_; }
+
+    int getRowGroupCount() const noexcept;
+
+    /**
+     * @brief Row groups that are read after pruning. Only valid after the first readBatch.
+     */
+    const std::vector<int>& getSelectedRowGroups() const noexcept { return row_groups_; }
+
+private:
+    // Comparison of a file column with a constant, evaluated on encoded chunks
+    struct EncodedFilter {
+        size_t fileColumn;
+        CompareOp op;
+        kernels::CompareDomain domain;
+        const ConstantExpr* constant;
+    };
+
+    std::filesystem::path file_path_;
+    Schema schema_;
+    TableId table_id_;
+    std::vector<ColumnId> projection_;
+    const PredicateExpr* predicate_ = nullptr;
+    // Rows to read, all rows if null
+    std::shared_ptr<const std::vector<int64_t>> positions_;
+
+    memory::MemoryManager memory_;
+    memory::ManagedRegion region_{nullptr, 0};
+    std::optional<tdb::Footer> footer_;
+    // Chunks of every row group, one per file column
+    std::vector<std::vector<EncodedChunk>> chunks_;
+    // Position of the first row of every row group in the file
+    std::vector<int64_t> row_group_starts_;
+    // File column index of each schema column, -1 if the file doesn't contain it
+    std::vector<int> file_columns_;
+    // File column index of each projected column
+    std::vector<int> projected_columns_;
+
+    std::vector<EncodedFilter> filters_;
+    std::vector<uint8_t> passes_;
+    std::vector<int64_t> selected_rows_;
+    int64_t filtered_rows_ = 0;
+    int64_t skipped_zones_ = 0;
+
+    std::vector<int> row_groups_;
+    size_t row_group_index_ = 0;
+    int64_t row_offset_ = 0;
+    bool started_ = false;
+    bool eof_ = false;
+    StringHeap string_heap_;
+
+    bool open();
+    bool startReading();
+    void selectRowGroups();
+    void prefetchRowGroup();
+    bool zoneMayMatch(size_t rowGroup, size_t zone) const;
+    // Move past rows of the current row group, to the next row group at its end
+    void advanceRows(int64_t rows);
+    void collectFilters(const PredicateExpr& predicate);
+    int getFileColumn(const ColumnId& columnId) const;
+};
+
+}  // namespace toydb
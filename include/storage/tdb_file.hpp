@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "common/types.hpp"
+#include "engine/physical_operator.hpp"
+#include "storage/column_encoding.hpp"
+#include "storage/column_statistics.hpp"
+
+namespace toydb {
+
+class TableHandle;
+
+/**
+ * @brief Native columnar file format (StorageFormat::TDB), read without parsing.
+ *
+ * Rows are stored in row groups, every column of a row group in one chunk. Chunks start at
+ * 8 byte aligned offsets and are encoded with the ColumnEncoding that takes the fewest bytes.
+ * PLAIN chunks have the layout of a ColumnBuffer: the null bitmap padded to 8 bytes, followed by
+ * the values.
+ *
+ *   MAGIC | VERSION (u32) | chunks | footer | footer size (u64) | MAGIC
+ *
+ * The footer lists the columns by name and type, the rows per zone, and per row group its row
+ * count and the offset, size, encoding, null count and min/max of every chunk. Row groups are
+ * split into zones of zoneRows rows, every chunk also lists the null count and min/max of each
+ * of its zones, so that readers can skip the zones a predicate rules out. Values are stored in
+ * the byte order of the machine that wrote the file.
+ */
+namespace tdb {
+
+inline constexpr char MAGIC[4] = {'T', 'D', 'B', '1'};
+inline constexpr uint32_t VERSION = 3;
+inline constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(VERSION);
+inline constexpr size_t TRAILER_SIZE = sizeof(uint64_t) + sizeof(MAGIC);
+// Matches the default batch size of the readers
+inline constexpr int64_t DEFAULT_ZONE_ROWS = 8192;
+
+struct ColumnInfo {
+    std::string name;
+    DataType type;
+};
+
+struct ChunkInfo {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    ColumnEncoding encoding = ColumnEncoding::PLAIN;
+    // Row count, null count and min/max of the chunk
+    ColumnStatistics statistics;
+    // Row count, null count and min/max of every zone of the chunk
+    std::vector<ColumnStatistics> zones;
+};
+
+struct RowGroupInfo {
+    int64_t rowCount = 0;
+    // One chunk per column
+    std::vector<ChunkInfo> chunks;
+};
+
+struct Footer {
+    std::vector<ColumnInfo> columns;
+    int64_t zoneRows = DEFAULT_ZONE_ROWS;
+    std::vector<RowGroupInfo> rowGroups;
+
+    std::string encode() const;
+
+    /**
+     * @return nullopt if the bytes are not a valid footer
+     */
+    static std::optional<Footer> decode(std::span<const char> bytes);
+};
+
+/**
+ * @brief Size of the null bitmap of a chunk, padded to 8 bytes so that the values are aligned
+ */
+constexpr size_t bitmapBytes(int64_t rows) noexcept {
+    size_t bytes = static_cast<size_t>(rows + 7) / 8;
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+constexpr size_t align(size_t bytes) noexcept {
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+}  // namespace tdb
+
+/**
+ * @brief Writes rows into a TDB file. Rows are buffered until a row group is full, the footer is
+ * written by finish(). A file that was not finished is not readable.
+ */
+class TdbFileWriter {
+public:
+    static constexpr int64_t DEFAULT_ROW_GROUP_ROWS = 64 * 1024;
+
+    TdbFileWriter(const std::filesystem::path& path, std::vector<tdb::ColumnInfo> columns,
+                  int64_t rowGroupRows = DEFAULT_ROW_GROUP_ROWS, int64_t zoneRows = tdb::DEFAULT_ZONE_ROWS);
+
+    TdbFileWriter(const TdbFileWriter&) = delete;
+    TdbFileWriter& operator=(const TdbFileWriter&) = delete;
+
+    /**
+     * @brief Append the selected rows of the batch, whose columns have the writer's types in the same order
+     */
+    void append(const RowVector& batch);
+
+    /**
+     * @brief Write the buffered rows and the footer
+     * @return false if the file could not be written
+     */
+    bool finish();
+
+    int64_t getRowCount() const noexcept { return row_count_; }
+
+private:
+    struct ColumnState {
+        std::vector<uint8_t> bitmap;
+        std::vector<char> values;
+        // Characters of the long strings of the row group
+        std::string chars;
+        // Statistics of the finished zones of the row group and of the current one
+        std::vector<ColumnStatistics> zones;
+        ColumnStatistics zone;
+    };
+
+    std::filesystem::path path_;
+    std::ofstream out_;
+    int64_t row_group_rows_;
+    tdb::Footer footer_;
+    std::vector<ColumnState> states_;
+    // Chunk being written
+    std::string encoded_;
+    int64_t buffered_rows_ = 0;
+    // First buffered row of the current zone
+    int64_t zone_start_ = 0;
+    int64_t row_count_ = 0;
+    uint64_t offset_ = 0;
+    bool failed_ = false;
+
+    void appendValue(ColumnState& state, const ColumnBuffer& column, int64_t row);
+    void resetStates();
+    void finishZone();
+    void flushRowGroup();
+    void write(const void* data, size_t size);
+};
+
+/**
+ * @brief Write all rows of a table into a TDB file with the same columns, e.g. to convert a CSV
+ * or Parquet table that is scanned repeatedly
+ * @return false if the file could not be written
+ */
+bool convertToTdb(const TableHandle& table, const std::filesystem::path& path);
+
+}  // namespace toydb
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "storage/lockfile.hpp"
+
+namespace toydb {
+
+enum class WalSyncPolicy {
+    // Commits wait until their record is synced, concurrent commits share one fsync
+    FSYNC,
+    // Commits wait until their record is written, the log is synced every syncInterval. A crash
+    // loses at most the commits of the last interval.
+    INTERVAL,
+    // Commits wait until their record is written, the OS decides when it reaches the disk
+    NONE,
+};
+
+std::string walSyncPolicyToString(WalSyncPolicy policy) noexcept;
+
+std::optional<WalSyncPolicy> walSyncPolicyFromString(std::string_view s) noexcept;
+
+struct WalOptions {
+    WalSyncPolicy syncPolicy = WalSyncPolicy::FSYNC;
+    std::chrono::milliseconds syncInterval {10};
+    // Size of the log at which its records are folded into the data files, see InsertLog
+    size_t checkpointBytes = 64 * 1024 * 1024;
+    // Called by the leader before each fsync of a commit, e.g. by tests to hold it while others queue up
+    std::function<void()> beforeSync;
+
+    /**
+     * @brief Options with the sync policy selected by TOYDB_WAL (fsync, interval or none),
+     * nullopt if it is unset or "off"
+     */
+    static std::optional<WalOptions> fromEnvironment();
+};
+
+/**
+ * @brief Append-only log of records that committers wait on to be durable, with group commit.
+ *
+ * append() only buffers a record. The first committer that finds no write in progress becomes the
+ * leader: it writes the records of all committers so far with a single write and, with the FSYNC
+ * policy, a single fsync, while the others wait for it. Committers arriving meanwhile are written
+ * by the next leader, so the number of syncs grows with the commit latency, not the commit rate.
+ *
+ *   record = payload size (u32) | checksum of the payload (u64) | payload
+ *
+ * A torn record at the end of the log, left by a crash during a write, is ignored when reading.
+ * The log is guarded by a lock file, only one process may open it.
+ */
+class WriteAheadLog {
+public:
+    using Lsn = uint64_t;
+
+    WriteAheadLog(std::filesystem::path path, WalOptions options = {});
+
+    /**
+     * @brief Writes and syncs the buffered records
+     */
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * @brief Open or create the log
+     * @return false if it can't be opened or another process holds it
+     */
+    bool open();
+
+    /**
+     * @brief Payloads of the complete records in the log, in order, e.g. to recover after a crash
+     */
+    std::vector<std::string> readRecords() const;
+
+    /**
+     * @brief Buffer a record, it is written by the next commit
+     * @return Sequence number of the record, to wait for with commit()
+     */
+    Lsn append(std::string_view payload);
+
+    /**
+     * @brief Wait until the record and all before it are durable as the sync policy defines it
+     * @return false if the log could not be written or synced
+     */
+    bool commit(Lsn lsn);
+
+    /**
+     * @brief Drop the records written so far, once they are durable elsewhere. Waits for a write in
+     *        progress, records appended but not yet written are kept for the next commit.
+     * @return false if the log could not be truncated
+     */
+    bool truncate();
+
+    /**
+     * @brief Bytes of the records written since the log was opened or truncated
+     */
+    size_t getSize() const;
+
+    /**
+     * @brief Number of fsyncs of the log so far
+     */
+    uint64_t getSyncCount() const;
+
+    const WalOptions& getOptions() const noexcept {
+        return options_;
+    }
+
+private:
+    std::filesystem::path path_;
+    WalOptions options_;
+    Lockfile lock_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    // Signalled when a leader finished writing or the sync thread synced
+    std::condition_variable progress_;
+    // Records appended but not yet taken by a leader
+    std::string buffer_;
+    Lsn nextLsn_ = 1;
+    Lsn writtenLsn_ = 0;
+    Lsn syncedLsn_ = 0;
+    // A leader is writing, only it touches the file
+    bool writing_ = false;
+    bool failed_ = false;
+    size_t size_ = 0;
+    uint64_t syncCount_ = 0;
+
+    // Syncs the log with the INTERVAL policy
+    std::thread syncThread_;
+    bool stopping_ = false;
+
+    /**
+     * @brief Write the buffered records as the leader, syncing them if sync is set
+     * @param lock Held on entry and exit, released while writing
+     */
+    void writeBuffered(std::unique_lock<std::mutex>& lock, bool sync);
+    bool writeAll(std::string_view bytes) const;
+    void runSyncThread();
+};
+
+}  // namespace toydb
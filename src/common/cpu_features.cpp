@@ -0,0 +1,67 @@
+#include "common/cpu_features.hpp"
+#include <array>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+namespace toydb {
+
+static constexpr std::array<std::string_view, 5> SIMD_LEVEL_NAMES = {"scalar", "sse4.2", "avx2", "avx512", "neon"};
+
+std::string_view toString(SimdLevel level) noexcept {
+    return SIMD_LEVEL_NAMES[static_cast<size_t>(level)];
+}
+
+std::optional<SimdLevel> parseSimdLevel(std::string_view name) noexcept {
+    for (size_t i = 0; i < SIMD_LEVEL_NAMES.size(); ++i) {
+        if (SIMD_LEVEL_NAMES[i] == name) {
+            return static_cast<SimdLevel>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+bool isSupported(SimdLevel level) noexcept {
+    switch (level) {
+        case SimdLevel::SCALAR:
+            return true;
+#if defined(__x86_64__)
+        // Also checks that the OS saves the vector registers (xgetbv)
+        case SimdLevel::SSE42:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2");
+        case SimdLevel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+        case SimdLevel::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                   __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+#elif defined(__aarch64__) && defined(__linux__)
+        case SimdLevel::NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#elif defined(__aarch64__)
+        // Advanced SIMD is mandatory in ARMv8-A
+        case SimdLevel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+SimdLevel detectSimdLevel() noexcept {
+    static const SimdLevel level = [] {
+        for (SimdLevel candidate : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE42, SimdLevel::NEON}) {
+            if (isSupported(candidate)) {
+                return candidate;
+            }
+        }
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+}
+
+}  // namespace toydb
@@ -0,0 +1,218 @@
+#include "common/metrics.hpp"
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include "common/assert.hpp"
+
+namespace toydb {
+namespace metrics {
+
+size_t currentShard() noexcept {
+    static std::atomic<size_t> nextShard = 0;
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return shard;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    tdb_assert(std::is_sorted(bounds_.begin(), bounds_.end()), "Histogram bounds must be ascending");
+    for (Shard& shard : shards_) {
+        shard.buckets = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+    }
+}
+
+void Histogram::observe(double value) noexcept {
+    // A value equal to a bound belongs to its bucket, like Prometheus' le
+    size_t bucket = static_cast<size_t>(std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin());
+    Shard& shard = shards_[currentShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.bounds = bounds_;
+    snapshot.buckets.assign(bounds_.size() + 1, 0);
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i <= bounds_.size(); ++i) {
+            uint64_t count = shard.buckets[i].load(std::memory_order_relaxed);
+            snapshot.buckets[i] += count;
+            snapshot.count += count;
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+double Histogram::Snapshot::quantile(double q) const noexcept {
+    if (count == 0) {
+        return 0.0;
+    }
+
+    double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+    uint64_t below = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (static_cast<double>(below + buckets[i]) < rank || buckets[i] == 0) {
+            below += buckets[i];
+            continue;
+        }
+        // Values above the last bound can't be placed, report the bound
+        if (i == bounds.size()) {
+            return bounds.empty() ? 0.0 : bounds.back();
+        }
+        double lower = i == 0 ? std::min(0.0, bounds[0]) : bounds[i - 1];
+        double fraction = (rank - static_cast<double>(below)) / static_cast<double>(buckets[i]);
+        return lower + (bounds[i] - lower) * fraction;
+    }
+    return bounds.empty() ? 0.0 : bounds.back();
+}
+
+std::vector<double> Histogram::exponentialBounds(double start, double factor, size_t count) {
+    std::vector<double> bounds;
+    double bound = start;
+    for (size_t i = 0; i < count; ++i) {
+        bounds.push_back(bound);
+        bound *= factor;
+    }
+    return bounds;
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Metric& MetricsRegistry::getOrAdd(const std::string& name, const std::string& help, Type type,
+                                                   const Labels& labels) {
+    auto family = std::find_if(families_.begin(), families_.end(),
+                               [&](const Family& existing) { return existing.name == name; });
+    if (family == families_.end()) {
+        families_.push_back({name, help, type, {}});
+        family = families_.end() - 1;
+    }
+    tdb_assert(family->type == type, "Metric {} was registered with a different type", name);
+
+    auto metric = std::find_if(family->metrics.begin(), family->metrics.end(),
+                               [&](const Metric& existing) { return existing.labels == labels; });
+    if (metric != family->metrics.end()) {
+        return *metric;
+    }
+    family->metrics.push_back({labels, nullptr, nullptr, nullptr});
+    return family->metrics.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    Metric& metric = getOrAdd(name, help, Type::COUNTER, labels);
+    if (!metric.counter) {
+        metric.counter = std::make_unique<Counter>();
+    }
+    return *metric.counter;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                                      const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    Metric& metric = getOrAdd(name, help, Type::HISTOGRAM, labels);
+    if (!metric.histogram) {
+        metric.histogram = std::make_unique<Histogram>(std::move(bounds));
+    }
+    return *metric.histogram;
+}
+
+void MetricsRegistry::gauge(const std::string& name, const std::string& help, std::function<double()> read,
+                            const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    getOrAdd(name, help, Type::GAUGE, labels).gauge = std::move(read);
+}
+
+static std::string escapeLabelValue(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+/**
+ * @brief {name="value",...} of the labels and the extra label, empty without labels
+ */
+static std::string formatLabels(const Labels& labels, const std::pair<std::string, std::string>* extra = nullptr) {
+    std::vector<std::string> parts;
+    for (const auto& [name, value] : labels) {
+        parts.push_back(fmt::format("{}=\"{}\"", name, escapeLabelValue(value)));
+    }
+    if (extra) {
+        parts.push_back(fmt::format("{}=\"{}\"", extra->first, escapeLabelValue(extra->second)));
+    }
+    return parts.empty() ? std::string() : fmt::format("{{{}}}", fmt::join(parts, ","));
+}
+
+void MetricsRegistry::exportPrometheus(std::ostream& os) const {
+    std::lock_guard lock(mutex_);
+    for (const Family& family : families_) {
+        const char* type = family.type == Type::COUNTER ? "counter" : family.type == Type::GAUGE ? "gauge" : "histogram";
+        os << "# HELP " << family.name << ' ' << family.help << '\n';
+        os << "# TYPE " << family.name << ' ' << type << '\n';
+
+        for (const Metric& metric : family.metrics) {
+            switch (family.type) {
+                case Type::COUNTER:
+                    os << family.name << formatLabels(metric.labels) << ' ' << metric.counter->get() << '\n';
+                    break;
+                case Type::GAUGE:
+                    os << family.name << formatLabels(metric.labels) << ' ' << fmt::format("{}", metric.gauge()) << '\n';
+                    break;
+                case Type::HISTOGRAM: {
+                    Histogram::Snapshot snapshot = metric.histogram->snapshot();
+                    uint64_t cumulative = 0;
+                    for (size_t i = 0; i <= snapshot.bounds.size(); ++i) {
+                        cumulative += snapshot.buckets[i];
+                        std::pair<std::string, std::string> le {
+                            "le", i < snapshot.bounds.size() ? fmt::format("{}", snapshot.bounds[i]) : "+Inf"};
+                        os << family.name << "_bucket" << formatLabels(metric.labels, &le) << ' ' << cumulative << '\n';
+                    }
+                    os << family.name << "_sum" << formatLabels(metric.labels) << ' ' << fmt::format("{}", snapshot.sum)
+                       << '\n';
+                    os << family.name << "_count" << formatLabels(metric.labels) << ' ' << snapshot.count << '\n';
+                    break;
+                }
+            }
+        }
+    }
+}
+
+std::string MetricsRegistry::exportPrometheus() const {
+    std::ostringstream os;
+    exportPrometheus(os);
+    return os.str();
+}
+
+bool MetricsRegistry::writeTextFile(const std::filesystem::path& path) const {
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        exportPrometheus(out);
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+}  // namespace metrics
+}  // namespace toydb
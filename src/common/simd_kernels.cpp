@@ -0,0 +1,99 @@
+#include "common/simd_kernels.hpp"
+#include <cstdlib>
+#include "common/hash.hpp"
+#include "common/logging.hpp"
+
+namespace toydb::simd {
+
+template<CompareOp Op>
+static uint64_t compareInt32Scalar(const int32_t* values, int64_t constant, int64_t count) noexcept {
+    return scalar::compareWord<Op>(values, constant, count);
+}
+
+template<CompareOp Op>
+static uint64_t compareInt64Scalar(const int64_t* values, int64_t constant, int64_t count) noexcept {
+    return scalar::compareWord<Op>(values, constant, count);
+}
+
+template<CompareOp Op>
+static uint64_t compareDoubleScalar(const double* values, double constant, int64_t count) noexcept {
+    return scalar::compareWord<Op>(values, constant, count);
+}
+
+static void combineAndScalar(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB, const uint64_t* nullB,
+                             int64_t words) noexcept {
+    for (int64_t w = 0; w < words; ++w) {
+        scalar::combineAnd(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+static void combineOrScalar(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB, const uint64_t* nullB,
+                            int64_t words) noexcept {
+    for (int64_t w = 0; w < words; ++w) {
+        scalar::combineOr(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+static const char* findSpecialScalar(const char* p, const char* end, char separator) noexcept {
+    return scalar::findSpecial(p, end, separator);
+}
+
+static void hashInt64Scalar(const int64_t* values, int64_t count, uint64_t* out) noexcept {
+    for (int64_t i = 0; i < count; ++i) {
+        out[i] = hashInt64(values[i]);
+    }
+}
+
+static const KernelTable SCALAR_KERNELS = {
+    .level = SimdLevel::SCALAR,
+    .compareInt32 = TDB_COMPARE_KERNELS(compareInt32Scalar),
+    .compareInt64 = TDB_COMPARE_KERNELS(compareInt64Scalar),
+    .compareDouble = TDB_COMPARE_KERNELS(compareDoubleScalar),
+    .combineAnd = combineAndScalar,
+    .combineOr = combineOrScalar,
+    .findSpecial = findSpecialScalar,
+    .hashInt64 = hashInt64Scalar,
+};
+
+const KernelTable* getKernels(SimdLevel level) noexcept {
+    if (!isSupported(level)) {
+        return nullptr;
+    }
+    switch (level) {
+        case SimdLevel::SCALAR: return &SCALAR_KERNELS;
+#if defined(__x86_64__)
+        case SimdLevel::SSE42: return detail::getSse42Kernels();
+        case SimdLevel::AVX2: return detail::getAvx2Kernels();
+        case SimdLevel::AVX512: return detail::getAvx512Kernels();
+#elif defined(__aarch64__)
+        case SimdLevel::NEON: return detail::getNeonKernels();
+#endif
+        default: return nullptr;
+    }
+}
+
+static const KernelTable& selectKernels() noexcept {
+    SimdLevel level = detectSimdLevel();
+    if (const char* value = std::getenv("TOYDB_SIMD")) {
+        std::optional<SimdLevel> requested = parseSimdLevel(value);
+        if (requested && getKernels(*requested)) {
+            level = *requested;
+        } else {
+            Logger::warn("Ignoring TOYDB_SIMD '{}', the host supports up to {}", value, toString(level));
+        }
+    }
+
+    const KernelTable* kernels = getKernels(level);
+    if (!kernels) {
+        kernels = &SCALAR_KERNELS;
+    }
+    Logger::debug("Using {} kernels", toString(kernels->level));
+    return *kernels;
+}
+
+const KernelTable& getKernels() noexcept {
+    static const KernelTable& kernels = selectKernels();
+    return kernels;
+}
+
+}  // namespace toydb::simd
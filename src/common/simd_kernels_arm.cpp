@@ -0,0 +1,190 @@
+#include "common/simd_kernels.hpp"
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+#include "common/hash.hpp"
+
+// Advanced SIMD is part of ARMv8-A, the kernels need no target attributes
+namespace toydb::simd {
+
+template<CompareOp Op>
+static inline uint64x2_t compareLanes(int64x2_t values, int64x2_t constant) noexcept {
+    if constexpr (Op == CompareOp::EQUAL) {
+        return vceqq_s64(values, constant);
+    } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+        return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_s64(values, constant))));
+    } else if constexpr (Op == CompareOp::GREATER) {
+        return vcgtq_s64(values, constant);
+    } else if constexpr (Op == CompareOp::LESS) {
+        return vcltq_s64(values, constant);
+    } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+        return vcgeq_s64(values, constant);
+    } else {
+        return vcleq_s64(values, constant);
+    }
+}
+
+template<CompareOp Op>
+static inline uint32x4_t compareLanes(int32x4_t values, int32x4_t constant) noexcept {
+    if constexpr (Op == CompareOp::EQUAL) {
+        return vceqq_s32(values, constant);
+    } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+        return vmvnq_u32(vceqq_s32(values, constant));
+    } else if constexpr (Op == CompareOp::GREATER) {
+        return vcgtq_s32(values, constant);
+    } else if constexpr (Op == CompareOp::LESS) {
+        return vcltq_s32(values, constant);
+    } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+        return vcgeq_s32(values, constant);
+    } else {
+        return vcleq_s32(values, constant);
+    }
+}
+
+// NaN compares unequal to everything, so NOT_EQUAL is the negation of EQUAL like in C++
+template<CompareOp Op>
+static inline uint64x2_t compareLanes(float64x2_t values, float64x2_t constant) noexcept {
+    if constexpr (Op == CompareOp::EQUAL) {
+        return vceqq_f64(values, constant);
+    } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+        return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(values, constant))));
+    } else if constexpr (Op == CompareOp::GREATER) {
+        return vcgtq_f64(values, constant);
+    } else if constexpr (Op == CompareOp::LESS) {
+        return vcltq_f64(values, constant);
+    } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+        return vcgeq_f64(values, constant);
+    } else {
+        return vcleq_f64(values, constant);
+    }
+}
+
+// One bit per lane, NEON has no movemask
+static inline uint64_t laneBits(uint64x2_t matches) noexcept {
+    static const uint64_t weights[2] = {1, 2};
+    return vaddvq_u64(vandq_u64(matches, vld1q_u64(weights)));
+}
+
+static inline uint64_t laneBits(uint32x4_t matches) noexcept {
+    static const uint32_t weights[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(matches, vld1q_u32(weights)));
+}
+
+template<CompareOp Op, typename T, typename C>
+static inline uint64_t compareTail(const T* values, C constant, int64_t i, int64_t count) noexcept {
+    return i < count ? scalar::compareWord<Op, T, C>(values + i, constant, count - i) << i : 0;
+}
+
+template<CompareOp Op>
+static uint64_t compareInt64Neon(const int64_t* values, int64_t constant, int64_t count) noexcept {
+    int64x2_t c = vdupq_n_s64(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        word |= laneBits(compareLanes<Op>(vld1q_s64(values + i), c)) << i;
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+static uint64_t compareInt32Neon(const int32_t* values, int64_t constant, int64_t count) noexcept {
+    if (!scalar::fitsInt32(constant)) {
+        return scalar::compareWord<Op>(values, constant, count);
+    }
+    int32x4_t c = vdupq_n_s32(static_cast<int32_t>(constant));
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        word |= laneBits(compareLanes<Op>(vld1q_s32(values + i), c)) << i;
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+static uint64_t compareDoubleNeon(const double* values, double constant, int64_t count) noexcept {
+    float64x2_t c = vdupq_n_f64(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        word |= laneBits(compareLanes<Op>(vld1q_f64(values + i), c)) << i;
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+static void combineAndNeon(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB, const uint64_t* nullB,
+                           int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        uint64x2_t ta = vld1q_u64(trueA + w);
+        uint64x2_t na = vld1q_u64(nullA + w);
+        uint64x2_t tb = vld1q_u64(trueB + w);
+        uint64x2_t nb = vld1q_u64(nullB + w);
+        // NULL if neither side is FALSE and one is NULL
+        uint64x2_t n = vandq_u64(vorrq_u64(na, nb), vandq_u64(vorrq_u64(ta, na), vorrq_u64(tb, nb)));
+        vst1q_u64(trueA + w, vandq_u64(ta, tb));
+        vst1q_u64(nullA + w, n);
+    }
+    for (; w < words; ++w) {
+        scalar::combineAnd(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+static void combineOrNeon(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB, const uint64_t* nullB,
+                          int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        uint64x2_t t = vorrq_u64(vld1q_u64(trueA + w), vld1q_u64(trueB + w));
+        uint64x2_t n = vorrq_u64(vld1q_u64(nullA + w), vld1q_u64(nullB + w));
+        vst1q_u64(trueA + w, t);
+        vst1q_u64(nullA + w, vbicq_u64(n, t));
+    }
+    for (; w < words; ++w) {
+        scalar::combineOr(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+static const char* findSpecialNeon(const char* p, const char* end, char separator) noexcept {
+    uint8x16_t separators = vdupq_n_u8(static_cast<uint8_t>(separator));
+    uint8x16_t quotes = vdupq_n_u8(static_cast<uint8_t>('"'));
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t matches = vorrq_u8(vceqq_u8(bytes, separators), vceqq_u8(bytes, quotes));
+        // Narrow every byte to 4 bits, the first match is at the lowest set nibble
+        uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+        if (nibbles) {
+            return p + __builtin_ctzll(nibbles) / 4;
+        }
+    }
+    return scalar::findSpecial(p, end, separator);
+}
+
+// NEON has no 64-bit lane multiply, hashing stays scalar
+static void hashInt64Neon(const int64_t* values, int64_t count, uint64_t* out) noexcept {
+    for (int64_t i = 0; i < count; ++i) {
+        out[i] = hashInt64(values[i]);
+    }
+}
+
+static const KernelTable NEON_KERNELS = {
+    .level = SimdLevel::NEON,
+    .compareInt32 = TDB_COMPARE_KERNELS(compareInt32Neon),
+    .compareInt64 = TDB_COMPARE_KERNELS(compareInt64Neon),
+    .compareDouble = TDB_COMPARE_KERNELS(compareDoubleNeon),
+    .combineAnd = combineAndNeon,
+    .combineOr = combineOrNeon,
+    .findSpecial = findSpecialNeon,
+    .hashInt64 = hashInt64Neon,
+};
+
+namespace detail {
+
+const KernelTable* getNeonKernels() noexcept {
+    return &NEON_KERNELS;
+}
+
+}  // namespace detail
+
+}  // namespace toydb::simd
+
+#endif  // defined(__aarch64__)
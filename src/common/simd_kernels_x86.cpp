@@ -0,0 +1,480 @@
+#include "common/simd_kernels.hpp"
+
+#if defined(__x86_64__)
+
+// GCC 12 warns about _mm512_undefined_epi32() in the AVX-512 intrinsics (GCC bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#include "common/hash.hpp"
+
+// Kernels are compiled for their level with target attributes, the rest of the library isn't
+#define TDB_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TDB_TARGET_AVX2 __attribute__((target("avx2")))
+#define TDB_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq")))
+
+namespace toydb::simd {
+
+/**
+ * @brief Integer lanes compare only for equality and greater than, the other operators are
+ *        derived by swapping the operands and negating the lane bits
+ */
+template<CompareOp Op>
+static constexpr bool IS_NEGATED = Op == CompareOp::NOT_EQUAL || Op == CompareOp::GREATER_EQUAL ||
+                                   Op == CompareOp::LESS_EQUAL;
+
+template<CompareOp Op>
+static constexpr bool IS_EQUALITY = Op == CompareOp::EQUAL || Op == CompareOp::NOT_EQUAL;
+
+template<CompareOp Op>
+static constexpr bool IS_SWAPPED = Op == CompareOp::LESS || Op == CompareOp::GREATER_EQUAL;
+
+/**
+ * @brief Shift the bits of the lanes [i, i + Lanes) into place, negating them for NOT_EQUAL, >= and <=
+ */
+template<CompareOp Op, int Lanes>
+static inline uint64_t placeBits(uint64_t bits, int64_t i) noexcept {
+    if constexpr (IS_NEGATED<Op>) {
+        bits = ~bits & ((uint64_t{1} << Lanes) - 1);
+    }
+    return bits << i;
+}
+
+/**
+ * @brief The scalar tail of a comparison word from value i on
+ */
+template<CompareOp Op, typename T, typename C>
+static inline uint64_t compareTail(const T* values, C constant, int64_t i, int64_t count) noexcept {
+    return i < count ? scalar::compareWord<Op, T, C>(values + i, constant, count - i) << i : 0;
+}
+
+// Predicates of _mm256_cmp_pd and _mm512_cmp_pd_mask with the results of the C++ operators, also for NaN
+template<CompareOp Op>
+static constexpr int DOUBLE_PREDICATE = Op == CompareOp::EQUAL           ? _CMP_EQ_OQ
+                                        : Op == CompareOp::NOT_EQUAL     ? _CMP_NEQ_UQ
+                                        : Op == CompareOp::GREATER       ? _CMP_GT_OQ
+                                        : Op == CompareOp::LESS          ? _CMP_LT_OQ
+                                        : Op == CompareOp::GREATER_EQUAL ? _CMP_GE_OQ
+                                                                         : _CMP_LE_OQ;
+
+// ---------------------------------------------------------------------------------------------
+// SSE4.2: 128-bit lanes. Hashing stays scalar, two lanes of emulated 64-bit multiplies don't pay off.
+// ---------------------------------------------------------------------------------------------
+
+template<CompareOp Op, bool Wide>
+TDB_TARGET_SSE42 static __m128i compareLanesSse42(__m128i values, __m128i constant) noexcept {
+    __m128i left = IS_SWAPPED<Op> ? constant : values;
+    __m128i right = IS_SWAPPED<Op> ? values : constant;
+    if constexpr (Wide) {
+        return IS_EQUALITY<Op> ? _mm_cmpeq_epi64(left, right) : _mm_cmpgt_epi64(left, right);
+    } else {
+        return IS_EQUALITY<Op> ? _mm_cmpeq_epi32(left, right) : _mm_cmpgt_epi32(left, right);
+    }
+}
+
+template<CompareOp Op>
+TDB_TARGET_SSE42 static uint64_t compareInt64Sse42(const int64_t* values, int64_t constant, int64_t count) noexcept {
+    __m128i c = _mm_set1_epi64x(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        auto bits = static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(compareLanesSse42<Op, true>(v, c))));
+        word |= placeBits<Op, 2>(bits, i);
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+TDB_TARGET_SSE42 static uint64_t compareInt32Sse42(const int32_t* values, int64_t constant, int64_t count) noexcept {
+    if (!scalar::fitsInt32(constant)) {
+        return scalar::compareWord<Op>(values, constant, count);
+    }
+    __m128i c = _mm_set1_epi32(static_cast<int32_t>(constant));
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        auto bits = static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(compareLanesSse42<Op, false>(v, c))));
+        word |= placeBits<Op, 4>(bits, i);
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+TDB_TARGET_SSE42 static uint64_t compareDoubleSse42(const double* values, double constant, int64_t count) noexcept {
+    __m128d c = _mm_set1_pd(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        __m128d matches;
+        if constexpr (Op == CompareOp::EQUAL) {
+            matches = _mm_cmpeq_pd(v, c);
+        } else if constexpr (Op == CompareOp::NOT_EQUAL) {
+            matches = _mm_cmpneq_pd(v, c);
+        } else if constexpr (Op == CompareOp::GREATER) {
+            matches = _mm_cmpgt_pd(v, c);
+        } else if constexpr (Op == CompareOp::LESS) {
+            matches = _mm_cmplt_pd(v, c);
+        } else if constexpr (Op == CompareOp::GREATER_EQUAL) {
+            matches = _mm_cmpge_pd(v, c);
+        } else {
+            matches = _mm_cmple_pd(v, c);
+        }
+        word |= static_cast<uint64_t>(_mm_movemask_pd(matches)) << i;
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+TDB_TARGET_SSE42 static void combineAndSse42(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                             const uint64_t* nullB, int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        __m128i ta = _mm_loadu_si128(reinterpret_cast<const __m128i*>(trueA + w));
+        __m128i na = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nullA + w));
+        __m128i tb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(trueB + w));
+        __m128i nb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nullB + w));
+        // NULL if neither side is FALSE and one is NULL
+        __m128i n = _mm_and_si128(_mm_or_si128(na, nb), _mm_and_si128(_mm_or_si128(ta, na), _mm_or_si128(tb, nb)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(trueA + w), _mm_and_si128(ta, tb));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(nullA + w), n);
+    }
+    for (; w < words; ++w) {
+        scalar::combineAnd(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+TDB_TARGET_SSE42 static void combineOrSse42(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                            const uint64_t* nullB, int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 2 <= words; w += 2) {
+        __m128i t = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(trueA + w)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(trueB + w)));
+        __m128i n = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nullA + w)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(nullB + w)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(trueA + w), t);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(nullA + w), _mm_andnot_si128(t, n));
+    }
+    for (; w < words; ++w) {
+        scalar::combineOr(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+TDB_TARGET_SSE42 static const char* findSpecialSse42(const char* p, const char* end, char separator) noexcept {
+    __m128i separators = _mm_set1_epi8(separator);
+    __m128i quotes = _mm_set1_epi8('"');
+    for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(bytes, separators), _mm_cmpeq_epi8(bytes, quotes));
+        if (int mask = _mm_movemask_epi8(matches)) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+    return scalar::findSpecial(p, end, separator);
+}
+
+static void hashInt64Sse42(const int64_t* values, int64_t count, uint64_t* out) noexcept {
+    for (int64_t i = 0; i < count; ++i) {
+        out[i] = hashInt64(values[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// AVX2: 256-bit lanes
+// ---------------------------------------------------------------------------------------------
+
+template<CompareOp Op, bool Wide>
+TDB_TARGET_AVX2 static __m256i compareLanesAvx2(__m256i values, __m256i constant) noexcept {
+    __m256i left = IS_SWAPPED<Op> ? constant : values;
+    __m256i right = IS_SWAPPED<Op> ? values : constant;
+    if constexpr (Wide) {
+        return IS_EQUALITY<Op> ? _mm256_cmpeq_epi64(left, right) : _mm256_cmpgt_epi64(left, right);
+    } else {
+        return IS_EQUALITY<Op> ? _mm256_cmpeq_epi32(left, right) : _mm256_cmpgt_epi32(left, right);
+    }
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX2 static uint64_t compareInt64Avx2(const int64_t* values, int64_t constant, int64_t count) noexcept {
+    __m256i c = _mm256_set1_epi64x(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        auto bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(compareLanesAvx2<Op, true>(v, c))));
+        word |= placeBits<Op, 4>(bits, i);
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX2 static uint64_t compareInt32Avx2(const int32_t* values, int64_t constant, int64_t count) noexcept {
+    if (!scalar::fitsInt32(constant)) {
+        return scalar::compareWord<Op>(values, constant, count);
+    }
+    __m256i c = _mm256_set1_epi32(static_cast<int32_t>(constant));
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        auto bits = static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(compareLanesAvx2<Op, false>(v, c))));
+        word |= placeBits<Op, 8>(bits, i);
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX2 static uint64_t compareDoubleAvx2(const double* values, double constant, int64_t count) noexcept {
+    __m256d c = _mm256_set1_pd(constant);
+    uint64_t word = 0;
+    int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d matches = _mm256_cmp_pd(_mm256_loadu_pd(values + i), c, DOUBLE_PREDICATE<Op>);
+        word |= static_cast<uint64_t>(_mm256_movemask_pd(matches)) << i;
+    }
+    return word | compareTail<Op>(values, constant, i, count);
+}
+
+TDB_TARGET_AVX2 static void combineAndAvx2(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                           const uint64_t* nullB, int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        __m256i ta = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(trueA + w));
+        __m256i na = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nullA + w));
+        __m256i tb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(trueB + w));
+        __m256i nb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nullB + w));
+        __m256i n = _mm256_and_si256(_mm256_or_si256(na, nb),
+                                     _mm256_and_si256(_mm256_or_si256(ta, na), _mm256_or_si256(tb, nb)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(trueA + w), _mm256_and_si256(ta, tb));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(nullA + w), n);
+    }
+    for (; w < words; ++w) {
+        scalar::combineAnd(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+TDB_TARGET_AVX2 static void combineOrAvx2(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                          const uint64_t* nullB, int64_t words) noexcept {
+    int64_t w = 0;
+    for (; w + 4 <= words; w += 4) {
+        __m256i t = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(trueA + w)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(trueB + w)));
+        __m256i n = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(nullA + w)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(nullB + w)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(trueA + w), t);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(nullA + w), _mm256_andnot_si256(t, n));
+    }
+    for (; w < words; ++w) {
+        scalar::combineOr(trueA[w], nullA[w], trueB[w], nullB[w]);
+    }
+}
+
+TDB_TARGET_AVX2 static const char* findSpecialAvx2(const char* p, const char* end, char separator) noexcept {
+    __m256i separators = _mm256_set1_epi8(separator);
+    __m256i quotes = _mm256_set1_epi8('"');
+    for (; end - p >= 32; p += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, separators), _mm256_cmpeq_epi8(bytes, quotes));
+        if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(matches))) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return scalar::findSpecial(p, end, separator);
+}
+
+/**
+ * @brief Low 64 bits of the lane products, AVX2 only multiplies 32-bit halves
+ */
+TDB_TARGET_AVX2 static __m256i multiplyAvx2(__m256i a, __m256i b) noexcept {
+    __m256i low = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+TDB_TARGET_AVX2 static void hashInt64Avx2(const int64_t* values, int64_t count, uint64_t* out) noexcept {
+    // hashMix four lanes at a time
+    __m256i m1 = _mm256_set1_epi64x(static_cast<int64_t>(0xff51afd7ed558ccdULL));
+    __m256i m2 = _mm256_set1_epi64x(static_cast<int64_t>(0xc4ceb9fe1a85ec53ULL));
+    int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 33));
+        key = multiplyAvx2(key, m1);
+        key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 33));
+        key = multiplyAvx2(key, m2);
+        key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 33));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), key);
+    }
+    for (; i < count; ++i) {
+        out[i] = hashInt64(values[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// AVX-512: 512-bit lanes and mask registers, tails are handled with masked loads
+// ---------------------------------------------------------------------------------------------
+
+// Predicates of _mm512_cmp_epi*_mask
+template<CompareOp Op>
+static constexpr int INT_PREDICATE = Op == CompareOp::EQUAL           ? _MM_CMPINT_EQ
+                                                 : Op == CompareOp::NOT_EQUAL     ? _MM_CMPINT_NE
+                                                 : Op == CompareOp::GREATER       ? _MM_CMPINT_NLE
+                                                 : Op == CompareOp::LESS          ? _MM_CMPINT_LT
+                                                 : Op == CompareOp::GREATER_EQUAL ? _MM_CMPINT_NLT
+                                                                                  : _MM_CMPINT_LE;
+
+static inline uint64_t tailMask(int64_t remaining) noexcept {
+    return remaining >= 64 ? ~uint64_t{0} : (uint64_t{1} << remaining) - 1;
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX512 static uint64_t compareInt64Avx512(const int64_t* values, int64_t constant, int64_t count) noexcept {
+    __m512i c = _mm512_set1_epi64(constant);
+    uint64_t word = 0;
+    for (int64_t i = 0; i < count; i += 8) {
+        auto lanes = static_cast<__mmask8>(tailMask(count - i));
+        __m512i v = _mm512_maskz_loadu_epi64(lanes, values + i);
+        word |= static_cast<uint64_t>(_mm512_mask_cmp_epi64_mask(lanes, v, c, INT_PREDICATE<Op>)) << i;
+    }
+    return word;
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX512 static uint64_t compareInt32Avx512(const int32_t* values, int64_t constant, int64_t count) noexcept {
+    if (!scalar::fitsInt32(constant)) {
+        return scalar::compareWord<Op>(values, constant, count);
+    }
+    __m512i c = _mm512_set1_epi32(static_cast<int32_t>(constant));
+    uint64_t word = 0;
+    for (int64_t i = 0; i < count; i += 16) {
+        auto lanes = static_cast<__mmask16>(tailMask(count - i));
+        __m512i v = _mm512_maskz_loadu_epi32(lanes, values + i);
+        word |= static_cast<uint64_t>(_mm512_mask_cmp_epi32_mask(lanes, v, c, INT_PREDICATE<Op>)) << i;
+    }
+    return word;
+}
+
+template<CompareOp Op>
+TDB_TARGET_AVX512 static uint64_t compareDoubleAvx512(const double* values, double constant, int64_t count) noexcept {
+    __m512d c = _mm512_set1_pd(constant);
+    uint64_t word = 0;
+    for (int64_t i = 0; i < count; i += 8) {
+        auto lanes = static_cast<__mmask8>(tailMask(count - i));
+        __m512d v = _mm512_maskz_loadu_pd(lanes, values + i);
+        word |= static_cast<uint64_t>(_mm512_mask_cmp_pd_mask(lanes, v, c, DOUBLE_PREDICATE<Op>)) << i;
+    }
+    return word;
+}
+
+TDB_TARGET_AVX512 static void combineAndAvx512(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                               const uint64_t* nullB, int64_t words) noexcept {
+    for (int64_t w = 0; w < words; w += 8) {
+        auto lanes = static_cast<__mmask8>(tailMask(words - w));
+        __m512i ta = _mm512_maskz_loadu_epi64(lanes, trueA + w);
+        __m512i na = _mm512_maskz_loadu_epi64(lanes, nullA + w);
+        __m512i tb = _mm512_maskz_loadu_epi64(lanes, trueB + w);
+        __m512i nb = _mm512_maskz_loadu_epi64(lanes, nullB + w);
+        __m512i n = _mm512_and_si512(_mm512_or_si512(na, nb),
+                                     _mm512_and_si512(_mm512_or_si512(ta, na), _mm512_or_si512(tb, nb)));
+        _mm512_mask_storeu_epi64(trueA + w, lanes, _mm512_and_si512(ta, tb));
+        _mm512_mask_storeu_epi64(nullA + w, lanes, n);
+    }
+}
+
+TDB_TARGET_AVX512 static void combineOrAvx512(uint64_t* trueA, uint64_t* nullA, const uint64_t* trueB,
+                                              const uint64_t* nullB, int64_t words) noexcept {
+    for (int64_t w = 0; w < words; w += 8) {
+        auto lanes = static_cast<__mmask8>(tailMask(words - w));
+        __m512i t = _mm512_or_si512(_mm512_maskz_loadu_epi64(lanes, trueA + w), _mm512_maskz_loadu_epi64(lanes, trueB + w));
+        __m512i n = _mm512_or_si512(_mm512_maskz_loadu_epi64(lanes, nullA + w), _mm512_maskz_loadu_epi64(lanes, nullB + w));
+        _mm512_mask_storeu_epi64(trueA + w, lanes, t);
+        _mm512_mask_storeu_epi64(nullA + w, lanes, _mm512_andnot_si512(t, n));
+    }
+}
+
+TDB_TARGET_AVX512 static const char* findSpecialAvx512(const char* p, const char* end, char separator) noexcept {
+    __m512i separators = _mm512_set1_epi8(separator);
+    __m512i quotes = _mm512_set1_epi8('"');
+    for (; p < end; p += 64) {
+        // Masked loads don't fault on the bytes past the end
+        __mmask64 bytesLeft = tailMask(end - p);
+        __m512i bytes = _mm512_maskz_loadu_epi8(bytesLeft, p);
+        __mmask64 matches = (_mm512_cmpeq_epi8_mask(bytes, separators) | _mm512_cmpeq_epi8_mask(bytes, quotes)) &
+                            bytesLeft;
+        if (matches) {
+            return p + __builtin_ctzll(matches);
+        }
+    }
+    return end;
+}
+
+TDB_TARGET_AVX512 static void hashInt64Avx512(const int64_t* values, int64_t count, uint64_t* out) noexcept {
+    __m512i m1 = _mm512_set1_epi64(static_cast<int64_t>(0xff51afd7ed558ccdULL));
+    __m512i m2 = _mm512_set1_epi64(static_cast<int64_t>(0xc4ceb9fe1a85ec53ULL));
+    for (int64_t i = 0; i < count; i += 8) {
+        auto lanes = static_cast<__mmask8>(tailMask(count - i));
+        __m512i key = _mm512_maskz_loadu_epi64(lanes, values + i);
+        key = _mm512_xor_si512(key, _mm512_srli_epi64(key, 33));
+        key = _mm512_mullo_epi64(key, m1);
+        key = _mm512_xor_si512(key, _mm512_srli_epi64(key, 33));
+        key = _mm512_mullo_epi64(key, m2);
+        key = _mm512_xor_si512(key, _mm512_srli_epi64(key, 33));
+        _mm512_mask_storeu_epi64(out + i, lanes, key);
+    }
+}
+
+static const KernelTable SSE42_KERNELS = {
+    .level = SimdLevel::SSE42,
+    .compareInt32 = TDB_COMPARE_KERNELS(compareInt32Sse42),
+    .compareInt64 = TDB_COMPARE_KERNELS(compareInt64Sse42),
+    .compareDouble = TDB_COMPARE_KERNELS(compareDoubleSse42),
+    .combineAnd = combineAndSse42,
+    .combineOr = combineOrSse42,
+    .findSpecial = findSpecialSse42,
+    .hashInt64 = hashInt64Sse42,
+};
+
+static const KernelTable AVX2_KERNELS = {
+    .level = SimdLevel::AVX2,
+    .compareInt32 = TDB_COMPARE_KERNELS(compareInt32Avx2),
+    .compareInt64 = TDB_COMPARE_KERNELS(compareInt64Avx2),
+    .compareDouble = TDB_COMPARE_KERNELS(compareDoubleAvx2),
+    .combineAnd = combineAndAvx2,
+    .combineOr = combineOrAvx2,
+    .findSpecial = findSpecialAvx2,
+    .hashInt64 = hashInt64Avx2,
+};
+
+static const KernelTable AVX512_KERNELS = {
+    .level = SimdLevel::AVX512,
+    .compareInt32 = TDB_COMPARE_KERNELS(compareInt32Avx512),
+    .compareInt64 = TDB_COMPARE_KERNELS(compareInt64Avx512),
+    .compareDouble = TDB_COMPARE_KERNELS(compareDoubleAvx512),
+    .combineAnd = combineAndAvx512,
+    .combineOr = combineOrAvx512,
+    .findSpecial = findSpecialAvx512,
+    .hashInt64 = hashInt64Avx512,
+};
+
+namespace detail {
+
+const KernelTable* getSse42Kernels() noexcept {
+    return &SSE42_KERNELS;
+}
+
+const KernelTable* getAvx2Kernels() noexcept {
+    return &AVX2_KERNELS;
+}
+
+const KernelTable* getAvx512Kernels() noexcept {
+    return &AVX512_KERNELS;
+}
+
+}  // namespace detail
+
+}  // namespace toydb::simd
+
+#endif  // defined(__x86_64__)
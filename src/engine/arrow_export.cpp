@@ -0,0 +1,168 @@
+#include "engine/arrow_export.hpp"
+#include <arrow/api.h>
+#include <cstring>
+#include <exception>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+
+namespace toydb {
+
+static void checkArrow(const arrow::Status& status) {
+    if (!status.ok()) {
+        throw InternalSQLError("Converting a batch to Arrow failed: " + status.ToString());
+    }
+}
+
+static std::shared_ptr<arrow::DataType> toArrowType(DataType type) {
+    switch (type.getType()) {
+        case DataType::Type::INT32: return arrow::int32();
+        case DataType::Type::INT64: return arrow::int64();
+        case DataType::Type::DOUBLE: return arrow::float64();
+        case DataType::Type::BOOL: return arrow::boolean();
+        case DataType::Type::STRING: return arrow::utf8();
+        case DataType::Type::NULL_CONST: return arrow::null();
+    }
+    return arrow::null();
+}
+
+std::shared_ptr<arrow::Schema> toArrowSchema(const BatchSchema& schema) {
+    arrow::FieldVector fields;
+    fields.reserve(schema.getColumns().size());
+    for (const ColumnDescriptor& column : schema.getColumns()) {
+        fields.push_back(arrow::field(column.columnId.getName(), toArrowType(column.type)));
+    }
+    return arrow::schema(std::move(fields));
+}
+
+static std::shared_ptr<arrow::Buffer> makeBuffer(const uint8_t* data, int64_t size, ArrowBufferMode mode) {
+    if (mode == ArrowBufferMode::WRAP) {
+        return std::make_shared<arrow::Buffer>(data, size);
+    }
+    auto buffer = arrow::AllocateBuffer(size);
+    checkArrow(buffer.status());
+    std::memcpy((*buffer)->mutable_data(), data, static_cast<size_t>(size));
+    return std::move(buffer).ValueOrDie();
+}
+
+/**
+ * @brief Hand the values and the validity bitmap of a fixed-width column to Arrow as they are
+ */
+static std::shared_ptr<arrow::Array> fixedWidthColumn(const ColumnBuffer& column, int64_t rowCount,
+                                                      ArrowBufferMode mode) {
+    int64_t valueSize = column.type.getSize();
+    std::shared_ptr<arrow::Buffer> values =
+        makeBuffer(static_cast<const uint8_t*>(column.getData()), rowCount * valueSize, mode);
+    std::shared_ptr<arrow::Buffer> validity;
+    if (const uint8_t* bitmap = column.getNullBitmap().data()) {
+        validity = makeBuffer(bitmap, (rowCount + 7) / 8, mode);
+    }
+    auto data = arrow::ArrayData::Make(toArrowType(column.type), rowCount, {validity, values},
+                                       validity ? arrow::kUnknownNullCount : 0);
+    return arrow::MakeArray(data);
+}
+
+template<typename Builder, is_db_type T>
+static std::shared_ptr<arrow::Array> buildColumn(const ColumnBuffer& column, const RowVector& batch) {
+    Builder builder;
+    checkArrow(builder.Reserve(batch.getSelectedRowCount()));
+    batch.forEachSelectedRow([&](int64_t row) {
+        if (column.isNull(row)) {
+            builder.UnsafeAppendNull();
+        } else if constexpr (std::same_as<T, db_string>) {
+            checkArrow(builder.Append(column.getEntry<db_string>(row).view()));
+        } else {
+            builder.UnsafeAppend(column.getEntry<T>(row));
+        }
+    });
+    std::shared_ptr<arrow::Array> array;
+    checkArrow(builder.Finish(&array));
+    return array;
+}
+
+static std::shared_ptr<arrow::Array> toArrowArray(const ColumnBuffer& column, const RowVector& batch,
+                                                  ArrowBufferMode mode) {
+    DataType::Type type = column.type.getType();
+    bool fixedWidth = type == DataType::Type::INT32 || type == DataType::Type::INT64 || type == DataType::Type::DOUBLE;
+    if (fixedWidth && !batch.hasSelection()) {
+        return fixedWidthColumn(column, batch.getRowCount(), mode);
+    }
+
+    switch (type) {
+        case DataType::Type::INT32: return buildColumn<arrow::Int32Builder, db_int32>(column, batch);
+        case DataType::Type::INT64: return buildColumn<arrow::Int64Builder, db_int64>(column, batch);
+        case DataType::Type::DOUBLE: return buildColumn<arrow::DoubleBuilder, db_double>(column, batch);
+        case DataType::Type::BOOL: return buildColumn<arrow::BooleanBuilder, db_bool>(column, batch);
+        case DataType::Type::STRING: return buildColumn<arrow::StringBuilder, db_string>(column, batch);
+        case DataType::Type::NULL_CONST: break;
+    }
+    return std::make_shared<arrow::NullArray>(batch.getSelectedRowCount());
+}
+
+std::shared_ptr<arrow::RecordBatch> toRecordBatch(const std::shared_ptr<arrow::Schema>& schema, const RowVector& batch,
+                                                  ArrowBufferMode mode) {
+    arrow::ArrayVector arrays;
+    arrays.reserve(batch.getColumns().size());
+    for (const ColumnBuffer& column : batch.getColumns()) {
+        arrays.push_back(toArrowArray(column, batch, mode));
+    }
+    return arrow::RecordBatch::Make(schema, batch.getSelectedRowCount(), std::move(arrays));
+}
+
+namespace {
+
+class PlanRecordBatchReader : public arrow::RecordBatchReader {
+private:
+    PhysicalQueryPlan plan_;
+    RowVector batch_;
+    std::shared_ptr<arrow::Schema> schema_;
+    // Pulled to know the schema, not yet read
+    std::shared_ptr<arrow::RecordBatch> first_;
+    bool exhausted_ = false;
+
+    std::shared_ptr<arrow::RecordBatch> pull() {
+        if (exhausted_ || plan_.getRoot()->next(batch_) == 0) {
+            exhausted_ = true;
+            return nullptr;
+        }
+        if (!schema_) {
+            schema_ = toArrowSchema(*batch_.getSchema());
+        }
+        return toRecordBatch(schema_, batch_, ArrowBufferMode::COPY);
+    }
+
+public:
+    explicit PlanRecordBatchReader(PhysicalQueryPlan plan) : plan_(std::move(plan)) {
+        plan_.getRoot()->initialize();
+        first_ = pull();
+        if (!schema_) {
+            schema_ = arrow::schema(arrow::FieldVector {});
+        }
+    }
+
+    std::shared_ptr<arrow::Schema> schema() const override {
+        return schema_;
+    }
+
+    arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+        if (first_) {
+            *batch = std::move(first_);
+            first_.reset();
+            return arrow::Status::OK();
+        }
+        try {
+            *batch = pull();
+        } catch (const std::exception& e) {
+            return arrow::Status::ExecutionError(e.what());
+        }
+        return arrow::Status::OK();
+    }
+};
+
+}  // namespace
+
+std::shared_ptr<arrow::RecordBatchReader> makeRecordBatchReader(PhysicalQueryPlan plan) {
+    tdb_assert(plan.hasRoot(), "Cannot read an empty plan");
+    return std::make_shared<PlanRecordBatchReader>(std::move(plan));
+}
+
+}  // namespace toydb
@@ -0,0 +1,310 @@
+#include "engine/buffer_pool.hpp"
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "common/metrics.hpp"
+
+namespace toydb {
+namespace memory {
+
+// Preferred node policy of mbind(2), numaif.h is not required
+static constexpr int MPOL_PREFERRED_NODE = 1;
+
+/**
+ * @brief Allocations served from cached buffers are hits, those mapping a new buffer misses
+ */
+static metrics::Counter& allocationCounter(bool hit) {
+    static metrics::Counter& hits = metrics::MetricsRegistry::global().counter(
+        "toydb_buffer_pool_allocations_total", "Buffers allocated from buffer pools", {{"result", "hit"}});
+    static metrics::Counter& misses = metrics::MetricsRegistry::global().counter(
+        "toydb_buffer_pool_allocations_total", "Buffers allocated from buffer pools", {{"result", "miss"}});
+    return hit ? hits : misses;
+}
+
+BufferPool::BufferPool(size_t memoryBudget) : budget_(memoryBudget) {
+    detectNodes();
+    nodeLists_ = std::make_unique<FreeLists[]>(nodeCount_);
+}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+BufferPool& BufferPool::global() {
+    static BufferPool& pool = []() -> BufferPool& {
+        static BufferPool global;
+        auto& registry = metrics::MetricsRegistry::global();
+        registry.gauge("toydb_buffer_pool_used_bytes", "Bytes of the buffers held by operators",
+                       [] { return static_cast<double>(global.getUsedBytes()); });
+        registry.gauge("toydb_buffer_pool_reserved_bytes", "Bytes mapped from the OS, in use or cached",
+                       [] { return static_cast<double>(global.getReservedBytes()); });
+        registry.gauge("toydb_buffer_pool_budget_bytes", "Memory budget of the buffer pool",
+                       [] { return static_cast<double>(global.getMemoryBudget()); });
+        return global;
+    }();
+    return pool;
+}
+
+size_t BufferPool::getDefaultMemoryBudget() {
+    if (const char* value = std::getenv("TOYDB_MEMORY_BUDGET")) {
+        size_t budget = 0;
+        std::string_view text(value);
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), budget);
+        if (error == std::errc() && end == text.data() + text.size() && budget > 0) {
+            return budget;
+        }
+        Logger::warn("Ignoring invalid TOYDB_MEMORY_BUDGET '{}'", text);
+    }
+
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || pageSize <= 0) {
+        return size_t{4} * 1024 * 1024 * 1024;
+    }
+    return static_cast<size_t>(pages) * static_cast<size_t>(pageSize) / 2;
+}
+
+uint32_t BufferPool::getSizeClass(size_t size) {
+    tdb_assert(size <= MAX_BUFFER_SIZE, "Buffer of {} bytes exceeds the largest size class", size);
+    size_t rounded = std::bit_ceil(std::max(size, MIN_BUFFER_SIZE));
+    return static_cast<uint32_t>(std::countr_zero(rounded) - std::countr_zero(MIN_BUFFER_SIZE));
+}
+
+/**
+ * @brief Parse a CPU list of the form "0-3,8,10-11"
+ */
+static std::vector<uint32_t> parseCpuList(const std::string& list) {
+    std::vector<uint32_t> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string_view range(list.data() + pos, end - pos);
+        uint32_t first = 0;
+        uint32_t last = 0;
+        auto [dash, error] = std::from_chars(range.data(), range.data() + range.size(), first);
+        last = first;
+        if (error == std::errc() && dash < range.data() + range.size() && *dash == '-') {
+            std::from_chars(dash + 1, range.data() + range.size(), last);
+        }
+        if (error == std::errc()) {
+            for (uint32_t cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+void BufferPool::detectNodes() {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::directory_iterator it("/sys/devices/system/node", error);
+    if (error) {
+        return;
+    }
+
+    for (const fs::directory_entry& entry : it) {
+        std::string name = entry.path().filename().string();
+        uint32_t node = 0;
+        if (!name.starts_with("node") ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), node).ptr != name.data() + name.size()) {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+        for (uint32_t cpu : parseCpuList(list)) {
+            if (cpu >= cpuNodes_.size()) {
+                cpuNodes_.resize(cpu + 1, 0);
+            }
+            cpuNodes_[cpu] = node;
+        }
+        nodeCount_ = std::max<size_t>(nodeCount_, node + 1);
+    }
+    Logger::debug("BufferPool: {} NUMA nodes, {} CPUs", nodeCount_, cpuNodes_.size());
+}
+
+uint32_t BufferPool::currentNode() const noexcept {
+    if (nodeCount_ == 1) {
+        return 0;
+    }
+    int cpu = sched_getcpu();
+    if (cpu < 0 || static_cast<size_t>(cpu) >= cpuNodes_.size()) {
+        return 0;
+    }
+    return cpuNodes_[static_cast<size_t>(cpu)];
+}
+
+BufferPool::FreeLists& BufferPool::currentCacheSlot() noexcept {
+    static std::atomic<size_t> nextSlot = 0;
+    thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % CACHE_SLOT_COUNT;
+    return cacheSlots_[slot];
+}
+
+bool BufferPool::reserve(size_t bytes) noexcept {
+    size_t reserved = reserved_.load(std::memory_order_relaxed);
+    while (reserved + bytes <= budget_.load(std::memory_order_relaxed)) {
+        if (reserved_.compare_exchange_weak(reserved, reserved + bytes, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<BufferPool::Buffer> BufferPool::mapBuffer(uint32_t sizeClass, uint32_t node) {
+    Buffer buffer{nullptr, sizeClass, node};
+    size_t size = buffer.size();
+    if (!reserve(size)) {
+        return std::nullopt;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        reserved_.fetch_sub(size, std::memory_order_relaxed);
+        Logger::warn("BufferPool: mapping a buffer of {} bytes failed", size);
+        return std::nullopt;
+    }
+
+#ifdef SYS_mbind
+    if (nodeCount_ > 1 && node < 64) {
+        // Pages are placed on the node once touched, failure only costs locality
+        unsigned long nodeMask = 1UL << node;
+        syscall(SYS_mbind, data, size, MPOL_PREFERRED_NODE, &nodeMask, 64UL, 0U);
+    }
+#endif
+
+    buffer.data = data;
+    allocationCounter(false).increment();
+    return buffer;
+}
+
+void BufferPool::unmapBuffer(const Buffer& buffer) noexcept {
+    munmap(buffer.data, buffer.size());
+    reserved_.fetch_sub(buffer.size(), std::memory_order_relaxed);
+}
+
+std::optional<BufferPool::Buffer> BufferPool::popFrom(FreeLists& lists, uint32_t sizeClass) {
+    std::lock_guard lock(lists.mutex);
+    std::vector<Buffer>& buffers = lists.buffers[sizeClass];
+    if (buffers.empty()) {
+        return std::nullopt;
+    }
+    Buffer buffer = buffers.back();
+    buffers.pop_back();
+    allocationCounter(true).increment();
+    return buffer;
+}
+
+size_t BufferPool::trimLists(FreeLists& lists) {
+    std::lock_guard lock(lists.mutex);
+    size_t bytes = 0;
+    for (std::vector<Buffer>& buffers : lists.buffers) {
+        for (const Buffer& buffer : buffers) {
+            bytes += buffer.size();
+            unmapBuffer(buffer);
+        }
+        buffers.clear();
+    }
+    return bytes;
+}
+
+std::optional<BufferPool::Buffer> BufferPool::tryAllocate(size_t minSize) {
+    uint32_t sizeClass = getSizeClass(minSize);
+    uint32_t node = currentNode();
+
+    std::optional<Buffer> buffer = popFrom(currentCacheSlot(), sizeClass);
+    if (!buffer) {
+        buffer = popFrom(nodeLists_[node], sizeClass);
+    }
+    if (!buffer) {
+        buffer = mapBuffer(sizeClass, node);
+    }
+    // At the budget: reuse a buffer cached for another node, or free the cached buffers to map a new one
+    for (size_t other = 0; !buffer && other < nodeCount_; ++other) {
+        buffer = popFrom(nodeLists_[other], sizeClass);
+    }
+    if (!buffer) {
+        trim();
+        buffer = mapBuffer(sizeClass, node);
+    }
+
+    if (buffer) {
+        used_.fetch_add(buffer->size(), std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
+BufferPool::Buffer BufferPool::allocate(size_t minSize) {
+    std::optional<Buffer> buffer = tryAllocate(minSize);
+    if (!buffer) {
+        throw MemoryBudgetExceededError("cannot allocate a buffer of " + std::to_string(minSize) + " bytes, " +
+                                        std::to_string(getUsedBytes()) + " of " +
+                                        std::to_string(getMemoryBudget()) + " bytes are in use");
+    }
+    return *buffer;
+}
+
+void BufferPool::release(const Buffer& buffer) {
+    size_t size = buffer.size();
+    used_.fetch_sub(size, std::memory_order_relaxed);
+
+    FreeLists& slot = currentCacheSlot();
+    {
+        std::lock_guard lock(slot.mutex);
+        std::vector<Buffer>& cached = slot.buffers[buffer.sizeClass];
+        if (cached.size() < std::max<size_t>(THREAD_CACHE_BYTES / size, 1)) {
+            cached.push_back(buffer);
+            return;
+        }
+    }
+
+    size_t cachedBytes = getReservedBytes() - getUsedBytes();
+    if (cachedBytes > getMemoryBudget() / 4) {
+        unmapBuffer(buffer);
+        return;
+    }
+
+    FreeLists& lists = nodeLists_[buffer.node];
+    std::lock_guard lock(lists.mutex);
+    lists.buffers[buffer.sizeClass].push_back(buffer);
+}
+
+void BufferPool::trim() {
+    size_t bytes = 0;
+    for (FreeLists& slot : cacheSlots_) {
+        bytes += trimLists(slot);
+    }
+    for (size_t node = 0; node < nodeCount_; ++node) {
+        bytes += trimLists(nodeLists_[node]);
+    }
+    if (bytes > 0) {
+        Logger::debug("BufferPool: returned {} cached bytes to the OS", bytes);
+    }
+}
+
+void BufferPool::setMemoryBudget(size_t bytes) {
+    budget_.store(bytes, std::memory_order_relaxed);
+    if (getReservedBytes() > bytes) {
+        trim();
+    }
+}
+
+}  // namespace memory
+}  // namespace toydb
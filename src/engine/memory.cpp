@@ -0,0 +1,248 @@
+#include "engine/memory.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "common/assert.hpp"
+#include "common/hash.hpp"
+
+namespace toydb {
+namespace memory {
+
+MemoryError MemoryManager::init() noexcept {
+    pageSize = static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE));
+    return MemoryError::OK;
+}
+
+std::expected<ManagedRegion, MemoryError> MemoryManager::mapNewFile(const std::string& name,
+                                                                    std::size_t size) noexcept {
+    FD fd = open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        return std::unexpected(MemoryError::FILE_ERROR);
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        close(fd);
+        return std::unexpected(MemoryError::FILE_ERROR);
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return std::unexpected(MemoryError::MMAP_FAILED);
+    }
+
+    return ManagedRegion{addr, size};
+}
+
+std::expected<ManagedRegion, MemoryError> MemoryManager::mapFile(const std::string& name) const noexcept {
+    FD fd = open(name.c_str(), O_RDONLY);
+    struct stat fileStat{};
+    if (fd == -1 || fstat(fd, &fileStat) != 0) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return std::unexpected(MemoryError::FILE_ERROR);
+    }
+
+    auto size = static_cast<std::size_t>(fileStat.st_size);
+    void* addr = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return std::unexpected(MemoryError::MMAP_FAILED);
+    }
+
+    return ManagedRegion{addr, size};
+}
+
+void MemoryManager::unmap(const ManagedRegion& region) noexcept {
+    if (region.data) {
+        munmap(region.data, region.size);
+    }
+}
+
+std::expected<void, MemoryError> MemoryManager::load(FD fd, Offset offset, void* frame,
+                                                     std::size_t size) const noexcept {
+    auto* out = static_cast<char*>(frame);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t count = pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::unexpected(MemoryError::READ_FAILED);
+        }
+        if (count == 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(count);
+    }
+    std::memset(out + done, 0, size - done);
+    return {};
+}
+
+PageCache::PageCache(std::size_t frameCount, BufferPool* pool)
+    : bufferManager_(pool), frames_(std::make_unique<Frame[]>(frameCount)), frameCount_(frameCount) {
+    tdb_assert(frameCount > 0, "A page cache needs at least one frame");
+}
+
+PageCache::Partition& PageCache::partitionOf(Key key) noexcept {
+    return partitions_[hashMix(key) % PARTITION_COUNT];
+}
+
+std::expected<PageCache::PageHandle, MemoryError> PageCache::pin(Key key, const LoadFn& load) {
+    tdb_assert(key != NO_KEY, "Invalid page key");
+    Partition& partition = partitionOf(key);
+    std::optional<std::size_t> cached;
+    {
+        std::lock_guard lock(partition.mutex);
+        auto it = partition.frames.find(key);
+        if (it != partition.frames.end()) {
+            cached = it->second;
+            Frame& frame = frames_[*cached];
+            frame.pins.fetch_add(1, std::memory_order_acquire);
+            frame.referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+    if (cached) {
+        // The page may still be loading, which happens outside of the partition lock
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return waitUntilLoaded(*cached);
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    std::optional<std::size_t> claimed = claimFrame();
+    if (!claimed) {
+        return std::unexpected(MemoryError::NO_FREE_FRAME);
+    }
+    Frame& frame = frames_[*claimed];
+
+    {
+        std::lock_guard lock(partition.mutex);
+        auto it = partition.frames.find(key);
+        if (it != partition.frames.end()) {
+            // Another thread loaded the page in the meantime
+            cached = it->second;
+            frames_[*cached].pins.fetch_add(1, std::memory_order_acquire);
+        } else {
+            partition.frames[key] = *claimed;
+            frame.key.store(key, std::memory_order_relaxed);
+            frame.referenced.store(true, std::memory_order_relaxed);
+            frame.state.store(FrameState::LOADING, std::memory_order_release);
+        }
+    }
+    if (cached) {
+        unpin(*claimed);
+        return waitUntilLoaded(*cached);
+    }
+
+    bool loaded = load(frame.buffer->get(), PAGE_SIZE);
+    if (!loaded) {
+        {
+            std::lock_guard lock(partition.mutex);
+            partition.frames.erase(key);
+            frame.key.store(NO_KEY, std::memory_order_relaxed);
+        }
+        frame.state.store(FrameState::FAILED, std::memory_order_release);
+        frame.state.notify_all();
+        unpin(*claimed);
+        return std::unexpected(MemoryError::READ_FAILED);
+    }
+
+    frame.state.store(FrameState::READY, std::memory_order_release);
+    frame.state.notify_all();
+    return PageHandle(this, *claimed);
+}
+
+std::expected<PageCache::PageHandle, MemoryError> PageCache::waitUntilLoaded(std::size_t index) {
+    Frame& frame = frames_[index];
+    FrameState state = frame.state.load(std::memory_order_acquire);
+    while (state == FrameState::LOADING) {
+        frame.state.wait(FrameState::LOADING, std::memory_order_acquire);
+        state = frame.state.load(std::memory_order_acquire);
+    }
+    if (state != FrameState::READY) {
+        unpin(index);
+        return std::unexpected(MemoryError::READ_FAILED);
+    }
+    return PageHandle(this, index);
+}
+
+std::optional<std::size_t> PageCache::claimFrame() {
+    // Every unpinned frame is reached with a clear referenced bit within two sweeps,
+    // the third one accounts for concurrent pins
+    for (std::size_t step = 0; step < 3 * frameCount_; ++step) {
+        std::size_t index = clockHand_.fetch_add(1, std::memory_order_relaxed) % frameCount_;
+        Frame& frame = frames_[index];
+        if (frame.pins.load(std::memory_order_relaxed) > 0) {
+            continue;
+        }
+        if (frame.key.load(std::memory_order_relaxed) != NO_KEY &&
+            frame.referenced.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+        if (tryClaim(index)) {
+            return index;
+        }
+    }
+    return std::nullopt;
+}
+
+bool PageCache::tryClaim(std::size_t index) {
+    Frame& frame = frames_[index];
+    Key key = frame.key.load(std::memory_order_acquire);
+    int32_t unpinned = 0;
+
+    if (key == NO_KEY) {
+        if (!frame.pins.compare_exchange_strong(unpinned, 1, std::memory_order_acquire)) {
+            return false;
+        }
+        if (frame.key.load(std::memory_order_acquire) != NO_KEY) {
+            // The frame received a page before it was pinned
+            unpin(index);
+            return false;
+        }
+    } else {
+        // Pages are only pinned under the lock of their partition, so the page can't be pinned concurrently
+        Partition& partition = partitionOf(key);
+        std::lock_guard lock(partition.mutex);
+        auto it = partition.frames.find(key);
+        if (it == partition.frames.end() || it->second != index ||
+            !frame.pins.compare_exchange_strong(unpinned, 1, std::memory_order_acquire)) {
+            return false;
+        }
+        partition.frames.erase(it);
+        frame.key.store(NO_KEY, std::memory_order_relaxed);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    frame.state.store(FrameState::EMPTY, std::memory_order_relaxed);
+    if (!frame.buffer) {
+        auto buffer = bufferManager_.tryAllocate(PAGE_SIZE);
+        if (!buffer) {
+            unpin(index);
+            return false;
+        }
+        frame.buffer.emplace(std::move(*buffer));
+    }
+    return true;
+}
+
+void PageCache::unpin(std::size_t index) noexcept {
+    frames_[index].pins.fetch_sub(1, std::memory_order_release);
+}
+
+bool PageCache::contains(Key key) {
+    Partition& partition = partitionOf(key);
+    std::lock_guard lock(partition.mutex);
+    auto it = partition.frames.find(key);
+    return it != partition.frames.end() &&
+           frames_[it->second].state.load(std::memory_order_acquire) == FrameState::READY;
+}
+
+}  // namespace memory
+}  // namespace toydb
@@ -0,0 +1,94 @@
+#include "engine/profiling.hpp"
+#include <unistd.h>
+#include <cstring>
+#include <ctime>
+#include <utility>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace toydb {
+
+#ifdef __linux__
+
+static int openCounter(uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+std::unique_ptr<HardwareCounterGroup> HardwareCounterGroup::open() {
+    std::unique_ptr<HardwareCounterGroup> group(new HardwareCounterGroup());
+    const std::pair<uint64_t, uint64_t HardwareCounters::*> events[] = {
+        {PERF_COUNT_HW_CPU_CYCLES, &HardwareCounters::cycles},
+        {PERF_COUNT_HW_INSTRUCTIONS, &HardwareCounters::instructions},
+        {PERF_COUNT_HW_CACHE_MISSES, &HardwareCounters::cacheMisses},
+        {PERF_COUNT_HW_BRANCH_MISSES, &HardwareCounters::branchMisses},
+    };
+
+    for (const auto& [config, field] : events) {
+        int fd = openCounter(config, group->fds_.empty() ? -1 : group->fds_[0]);
+        if (fd == -1) {
+            if (group->fds_.empty()) {
+                // Without cycles the others are not worth counting
+                return nullptr;
+            }
+            continue;
+        }
+        group->fds_.push_back(fd);
+        group->fields_.push_back(field);
+    }
+
+    ioctl(group->fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group->fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return group;
+}
+
+HardwareCounters HardwareCounterGroup::read() const noexcept {
+    // Number of events, then one value per event
+    uint64_t values[5] = {};
+    HardwareCounters counters;
+    if (::read(fds_[0], values, sizeof(values)) <= 0) {
+        return counters;
+    }
+    for (size_t i = 0; i < fields_.size() && i < values[0]; ++i) {
+        counters.*fields_[i] = values[i + 1];
+    }
+    return counters;
+}
+
+#else
+
+std::unique_ptr<HardwareCounterGroup> HardwareCounterGroup::open() {
+    return nullptr;
+}
+
+HardwareCounters HardwareCounterGroup::read() const noexcept {
+    return HardwareCounters();
+}
+
+#endif
+
+HardwareCounterGroup::~HardwareCounterGroup() {
+    for (int fd : fds_) {
+        close(fd);
+    }
+}
+
+std::chrono::nanoseconds ProfilingExec::threadCpuTime() noexcept {
+    timespec time {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+}  // namespace toydb
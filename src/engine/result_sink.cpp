@@ -0,0 +1,270 @@
+#include "engine/result_sink.hpp"
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/ipc/writer.h>
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include "common/errors.hpp"
+#include "engine/arrow_export.hpp"
+
+namespace toydb {
+
+static_assert(std::endian::native == std::endian::little, "The binary result format is little endian");
+
+std::string resultFormatToString(ResultFormat format) noexcept {
+    switch (format) {
+        case ResultFormat::TABLE: return "table";
+        case ResultFormat::CSV: return "csv";
+        case ResultFormat::ARROW: return "arrow";
+        case ResultFormat::BINARY: return "binary";
+    }
+    return "unknown";
+}
+
+std::optional<ResultFormat> parseResultFormat(std::string_view name) noexcept {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (ResultFormat format : {ResultFormat::TABLE, ResultFormat::CSV, ResultFormat::ARROW, ResultFormat::BINARY}) {
+        if (lower == resultFormatToString(format)) {
+            return format;
+        }
+    }
+    return std::nullopt;
+}
+
+std::unique_ptr<ResultSink> ResultSink::create(ResultFormat format, ByteWriter writer, size_t flushSize) {
+    switch (format) {
+        case ResultFormat::TABLE: return std::make_unique<TableResultSink>(std::move(writer), flushSize);
+        case ResultFormat::CSV: return std::make_unique<CsvResultSink>(std::move(writer), flushSize);
+        case ResultFormat::ARROW: return std::make_unique<ArrowResultSink>(std::move(writer), flushSize);
+        case ResultFormat::BINARY: return std::make_unique<BinaryResultSink>(std::move(writer), flushSize);
+    }
+    throw InternalSQLError("Unknown result format");
+}
+
+void TableResultSink::writeBatch(const RowVector& batch) {
+    out_.append(batch.toPrettyString(maxRows_));
+    out_.append('\n');
+}
+
+// CSV
+
+static void appendCsvString(OutputBuffer& out, std::string_view value) {
+    if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(value);
+        return;
+    }
+    out.append('"');
+    for (size_t begin = 0; begin < value.size();) {
+        size_t quote = value.find('"', begin);
+        size_t end = quote == std::string_view::npos ? value.size() : quote + 1;
+        out.append(value.substr(begin, end - begin));
+        if (quote != std::string_view::npos) {
+            out.append('"');
+        }
+        begin = end;
+    }
+    out.append('"');
+}
+
+static void appendCsvValue(OutputBuffer& out, const ColumnBuffer& column, int64_t row) {
+    if (column.isNull(row)) {
+        return;
+    }
+    switch (column.type.getType()) {
+        case DataType::Type::INT32:
+            out.appendText(column.getEntry<db_int32>(row));
+            break;
+        case DataType::Type::INT64:
+            out.appendText(column.getEntry<db_int64>(row));
+            break;
+        case DataType::Type::DOUBLE:
+            out.appendText(column.getEntry<db_double>(row));
+            break;
+        case DataType::Type::BOOL:
+            out.append(column.getEntry<db_bool>(row) ? std::string_view("true") : std::string_view("false"));
+            break;
+        case DataType::Type::STRING:
+            appendCsvString(out, column.getEntry<db_string>(row).view());
+            break;
+        case DataType::Type::NULL_CONST:
+            break;
+    }
+}
+
+void CsvResultSink::writeHeader(const BatchSchema& schema) {
+    for (int64_t i = 0; i < schema.getColumnCount(); ++i) {
+        if (i > 0) {
+            out_.append(',');
+        }
+        appendCsvString(out_, schema.getColumn(i).columnId.getName());
+    }
+    out_.append('\n');
+}
+
+void CsvResultSink::writeBatch(const RowVector& batch) {
+    const std::vector<ColumnBuffer>& columns = batch.getColumns();
+    batch.forEachSelectedRow([&](int64_t row) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i > 0) {
+                out_.append(',');
+            }
+            appendCsvValue(out_, columns[i], row);
+        }
+        out_.append('\n');
+    });
+}
+
+// Binary
+
+void BinaryResultSink::writeHeader(const BatchSchema& schema) {
+    out_.appendRaw(static_cast<uint32_t>(schema.getColumnCount()));
+    for (const ColumnDescriptor& column : schema.getColumns()) {
+        out_.appendRaw(static_cast<uint8_t>(column.type.getType()));
+        out_.appendRaw(static_cast<uint32_t>(column.columnId.getName().size()));
+        out_.append(column.columnId.getName());
+    }
+}
+
+void BinaryResultSink::writeBatch(const RowVector& batch) {
+    rows_.clear();
+    if (batch.hasSelection()) {
+        batch.forEachSelectedRow([this](int64_t row) { rows_.push_back(row); });
+    }
+    out_.appendRaw(static_cast<uint32_t>(batch.getSelectedRowCount()));
+    for (const ColumnBuffer& column : batch.getColumns()) {
+        writeColumn(column, batch);
+    }
+}
+
+void BinaryResultSink::writeColumn(const ColumnBuffer& column, const RowVector& batch) {
+    bool selected = batch.hasSelection();
+    int64_t rowCount = selected ? static_cast<int64_t>(rows_.size()) : batch.getRowCount();
+    auto rowAt = [&](int64_t index) { return selected ? rows_[static_cast<size_t>(index)] : index; };
+
+    // Validity, the bitmap of the column as is if all rows are part of the result
+    size_t bitmapSize = static_cast<size_t>((rowCount + 7) / 8);
+    char* bitmap = out_.reserve(bitmapSize);
+    const uint8_t* source = column.getNullBitmap().data();
+    if (!source) {
+        std::memset(bitmap, 0xFF, bitmapSize);
+    } else if (!selected) {
+        std::memcpy(bitmap, source, bitmapSize);
+    } else {
+        std::memset(bitmap, 0, bitmapSize);
+        for (int64_t i = 0; i < rowCount; ++i) {
+            if (!column.isNull(rowAt(i))) {
+                bitmap[i / 8] = static_cast<char>(bitmap[i / 8] | (1 << (i % 8)));
+            }
+        }
+    }
+    out_.commit(bitmapSize);
+
+    if (column.type.getType() == DataType::Type::STRING) {
+        for (int64_t i = 0; i < rowCount; ++i) {
+            int64_t row = rowAt(i);
+            std::string_view value = column.isNull(row) ? std::string_view() : column.getEntry<db_string>(row).view();
+            out_.appendRaw(static_cast<uint32_t>(value.size()));
+            out_.append(value);
+        }
+        return;
+    }
+
+    // Fixed-width values are copied in one piece unless rows are skipped
+    size_t valueSize = static_cast<size_t>(column.type.getSize());
+    const char* values = static_cast<const char*>(column.getData());
+    if (!selected) {
+        out_.append(values, static_cast<size_t>(rowCount) * valueSize);
+        return;
+    }
+    char* dst = out_.reserve(static_cast<size_t>(rowCount) * valueSize);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        std::memcpy(dst + static_cast<size_t>(i) * valueSize, values + static_cast<size_t>(rowAt(i)) * valueSize,
+                    valueSize);
+    }
+    out_.commit(static_cast<size_t>(rowCount) * valueSize);
+}
+
+void BinaryResultSink::writeFooter() {
+    out_.appendRaw(uint32_t {0});
+}
+
+// Arrow
+
+namespace {
+
+/**
+ * @brief Arrow output stream appending to an OutputBuffer
+ */
+class OutputBufferStream : public arrow::io::OutputStream {
+private:
+    OutputBuffer* out_;
+    int64_t position_ = 0;
+    bool closed_ = false;
+
+public:
+    explicit OutputBufferStream(OutputBuffer* out) : out_(out) {}
+
+    arrow::Status Close() override {
+        closed_ = true;
+        return arrow::Status::OK();
+    }
+
+    bool closed() const override {
+        return closed_;
+    }
+
+    arrow::Result<int64_t> Tell() const override {
+        return position_;
+    }
+
+    arrow::Status Write(const void* data, int64_t nbytes) override {
+        out_->append(data, static_cast<size_t>(nbytes));
+        position_ += nbytes;
+        return arrow::Status::OK();
+    }
+
+    using arrow::io::OutputStream::Write;
+};
+
+}  // namespace
+
+static void checkArrow(const arrow::Status& status) {
+    if (!status.ok()) {
+        throw InternalSQLError("Encoding an Arrow result failed: " + status.ToString());
+    }
+}
+
+struct ArrowResultSink::State {
+    std::shared_ptr<OutputBufferStream> stream;
+    std::shared_ptr<arrow::Schema> schema;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+};
+
+ArrowResultSink::ArrowResultSink(ByteWriter writer, size_t flushSize)
+    : ResultSink(std::move(writer), flushSize), state_(std::make_unique<State>()) {
+    state_->stream = std::make_shared<OutputBufferStream>(&out_);
+}
+
+ArrowResultSink::~ArrowResultSink() = default;
+
+void ArrowResultSink::writeHeader(const BatchSchema& schema) {
+    state_->schema = toArrowSchema(schema);
+
+    auto writer = arrow::ipc::MakeStreamWriter(state_->stream, state_->schema);
+    checkArrow(writer.status());
+    state_->writer = std::move(writer).ValueOrDie();
+}
+
+void ArrowResultSink::writeBatch(const RowVector& batch) {
+    // The batch outlives the record batch, which is encoded right away
+    auto recordBatch = toRecordBatch(state_->schema, batch, ArrowBufferMode::WRAP);
+    checkArrow(state_->writer->WriteRecordBatch(*recordBatch));
+}
+
+void ArrowResultSink::writeFooter() {
+    checkArrow(state_->writer->Close());
+}
+
+}  // namespace toydb
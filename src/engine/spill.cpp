@@ -0,0 +1,277 @@
+#include "engine/spill.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <system_error>
+#include <utility>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+
+namespace toydb {
+
+template<typename T>
+static void appendValue(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static const char* readValue(const char* data, T& value) {
+    std::memcpy(&value, data, sizeof(T));
+    return data + sizeof(T);
+}
+
+template<is_db_type T>
+static void encodeValues(const RowVector& batch, const ColumnBuffer& col, int64_t rowCount, std::string& out) {
+    std::span<T> values = col.getDataAs<T>();
+    if (!batch.hasSelection()) {
+        out.append(reinterpret_cast<const char*>(values.data()), static_cast<size_t>(rowCount) * sizeof(T));
+        return;
+    }
+    batch.forEachSelectedRow([&](int64_t row) { appendValue(out, values[static_cast<size_t>(row)]); });
+}
+
+template<is_db_type T>
+static const char* decodeValues(const char* data, ColumnBuffer& col, int64_t rowCount) {
+    size_t bytes = static_cast<size_t>(rowCount) * sizeof(T);
+    std::memcpy(col.getDataAs<T>().data(), data, bytes);
+    return data + bytes;
+}
+
+void BatchCodec::encode(const RowVector& batch, std::string& out) {
+    int64_t rowCount = batch.getSelectedRowCount();
+    appendValue(out, static_cast<uint32_t>(rowCount));
+
+    for (const ColumnBuffer& col : batch.getColumns()) {
+        size_t bitmap = out.size();
+        out.resize(bitmap + static_cast<size_t>(rowCount + 7) / 8, 0);
+        int64_t i = 0;
+        batch.forEachSelectedRow([&](int64_t row) {
+            if (col.isNull(row)) {
+                out[bitmap + static_cast<size_t>(i / 8)] |= static_cast<char>(1 << (i % 8));
+            }
+            ++i;
+        });
+
+        switch (col.type.getType()) {
+            case DataType::Type::STRING:
+                batch.forEachSelectedRow([&](int64_t row) {
+                    std::string_view value = col.isNull(row) ? std::string_view() : col.getEntry<db_string>(row).view();
+                    appendValue(out, static_cast<uint32_t>(value.size()));
+                    out.append(value);
+                });
+                break;
+            case DataType::Type::INT32: encodeValues<db_int32>(batch, col, rowCount, out); break;
+            case DataType::Type::INT64: encodeValues<db_int64>(batch, col, rowCount, out); break;
+            case DataType::Type::BOOL: encodeValues<db_bool>(batch, col, rowCount, out); break;
+            case DataType::Type::DOUBLE: encodeValues<db_double>(batch, col, rowCount, out); break;
+            default: tdb_unreachable("Unsupported column type");
+        }
+    }
+}
+
+const char* BatchCodec::decode(const char* data, const std::shared_ptr<const BatchSchema>& schema,
+                               BatchAllocator& allocator, RowVector& out) {
+    uint32_t encodedRows = 0;
+    data = readValue(data, encodedRows);
+    auto rowCount = static_cast<int64_t>(encodedRows);
+    tdb_assert(rowCount <= BatchAllocator::rowsPerBuffer(schema->getColumns()),
+               "Encoded batch of {} rows does not fit into a batch", rowCount);
+
+    allocator.allocateBatch(schema, out);
+    for (int64_t c = 0; c < schema->getColumnCount(); ++c) {
+        ColumnBuffer& col = out.getColumn(c);
+        const char* bitmap = data;
+        data += static_cast<size_t>(rowCount + 7) / 8;
+
+        switch (col.type.getType()) {
+            case DataType::Type::STRING:
+                for (int64_t row = 0; row < rowCount; ++row) {
+                    uint32_t length = 0;
+                    data = readValue(data, length);
+                    col.writeString(row, std::string_view(data, length));
+                    data += length;
+                }
+                break;
+            case DataType::Type::INT32: data = decodeValues<db_int32>(data, col, rowCount); break;
+            case DataType::Type::INT64: data = decodeValues<db_int64>(data, col, rowCount); break;
+            case DataType::Type::BOOL: data = decodeValues<db_bool>(data, col, rowCount); break;
+            case DataType::Type::DOUBLE: data = decodeValues<db_double>(data, col, rowCount); break;
+            default: tdb_unreachable("Unsupported column type");
+        }
+
+        for (int64_t row = 0; row < rowCount; ++row) {
+            if (bitmap[row / 8] & (1 << (row % 8))) {
+                col.setNull(row);
+            }
+        }
+        col.count = rowCount;
+    }
+    out.setRowCount(rowCount);
+    return data;
+}
+
+SpillFile::SpillFile(const std::string& operatorName) {
+    static std::atomic<uint64_t> fileCounter = 0;
+    path_ = std::filesystem::temp_directory_path() /
+        ("toydb-" + operatorName + "-" + std::to_string(::getpid()) + "-" + std::to_string(fileCounter++) + ".spill");
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        throw SQLRuntimeException("Could not create spill file " + path_.string() + ": " + std::strerror(errno));
+    }
+    spilledBytes_ = &metrics::MetricsRegistry::global().counter("toydb_spill_bytes_total", "Bytes written to spill files",
+                                                                {{"operator", operatorName}});
+    block_.reserve(BLOCK_SIZE);
+}
+
+SpillFile::~SpillFile() {
+    // The writer still uses the block and the descriptor
+    if (pending_.valid()) {
+        pending_.wait();
+    }
+    ::close(fd_);
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+}
+
+void SpillFile::write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        size_t n = std::min(size, BLOCK_SIZE - block_.size());
+        block_.append(bytes, n);
+        bytes += n;
+        size -= n;
+        size_ += n;
+        if (block_.size() == BLOCK_SIZE) {
+            writeBehind();
+        }
+    }
+}
+
+void SpillFile::writeBatch(const RowVector& batch) {
+    if (batch.getSelectedRowCount() == 0) {
+        return;
+    }
+    // Length of the encoded batch, followed by the batch
+    batchBuffer_.assign(sizeof(uint32_t), '\0');
+    BatchCodec::encode(batch, batchBuffer_);
+    auto length = static_cast<uint32_t>(batchBuffer_.size() - sizeof(uint32_t));
+    std::memcpy(batchBuffer_.data(), &length, sizeof(length));
+    write(batchBuffer_);
+}
+
+void SpillFile::flush() {
+    if (!block_.empty()) {
+        writeBehind();
+    }
+    waitForWrite();
+}
+
+std::unique_ptr<SpillReader> SpillFile::openReader() {
+    flush();
+    return std::make_unique<SpillReader>(path_);
+}
+
+void SpillFile::writeBehind() {
+    waitForWrite();
+    std::swap(block_, writing_);
+    block_.clear();
+    block_.reserve(BLOCK_SIZE);
+
+    uint64_t offset = writeOffset_;
+    writeOffset_ += writing_.size();
+    spilledBytes_->increment(writing_.size());
+    pending_ = std::async(std::launch::async, [fd = fd_, data = writing_.data(), size = writing_.size(), offset] {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return 0;
+    });
+}
+
+void SpillFile::waitForWrite() {
+    if (!pending_.valid()) {
+        return;
+    }
+    int error = pending_.get();
+    if (error != 0) {
+        throw SQLRuntimeException("I/O error on spill file " + path_.string() + ": " + std::strerror(error));
+    }
+}
+
+static AsyncIoOptions spillReadOptions() {
+    AsyncIoOptions options;
+    options.blockSize = SpillFile::BLOCK_SIZE;
+    // One block is read while the caller consumes the other
+    options.depth = 1;
+    return options;
+}
+
+SpillReader::SpillReader(const std::filesystem::path& path) : path_(path), file_(path, 0, spillReadOptions()) {
+    if (!file_.isOpen()) {
+        throw SQLRuntimeException("Could not open spill file " + path_.string());
+    }
+}
+
+std::string_view SpillReader::fetchBlock() {
+    std::string_view block = file_.next();
+    if (file_.hasFailed()) {
+        throw SQLRuntimeException("I/O error on spill file " + path_.string());
+    }
+    return block;
+}
+
+bool SpillReader::read(void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < size) {
+        if (block_.empty()) {
+            block_ = fetchBlock();
+            if (block_.empty()) {
+                if (done == 0) {
+                    return false;
+                }
+                throw SQLRuntimeException("Spill file " + path_.string() + " is truncated");
+            }
+        }
+        size_t n = std::min(size - done, block_.size());
+        std::memcpy(out + done, block_.data(), n);
+        block_.remove_prefix(n);
+        done += n;
+    }
+    return true;
+}
+
+std::string_view SpillReader::nextBlock() {
+    if (block_.empty()) {
+        block_ = fetchBlock();
+    }
+    return std::exchange(block_, {});
+}
+
+int64_t SpillReader::readBatch(const std::shared_ptr<const BatchSchema>& schema, BatchAllocator& allocator,
+                               RowVector& out) {
+    uint32_t length = 0;
+    if (!read(&length, sizeof(length))) {
+        return 0;
+    }
+    batchBuffer_.resize(length);
+    if (!read(batchBuffer_.data(), length)) {
+        throw SQLRuntimeException("Spill file " + path_.string() + " is truncated");
+    }
+    BatchCodec::decode(batchBuffer_.data(), schema, allocator, out);
+    return out.getRowCount();
+}
+
+}  // namespace toydb
@@ -0,0 +1,707 @@
+#include "engine/value_expr.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include "common/assert.hpp"
+
+namespace toydb {
+
+namespace {
+
+/**
+ * @brief Input of an operator: constants are read directly instead of being evaluated into a
+ * column of copies
+ */
+struct Operand {
+    ColumnBuffer column;
+    const ConstantValueExpr* constant = nullptr;
+
+    bool isNullConstant() const noexcept {
+        return constant && constant->isNull();
+    }
+};
+
+Operand evaluateOperand(const ValueExpr& expr, const RowVector& batch, BatchAllocator& allocator) {
+    if (const auto* constant = dynamic_cast<const ConstantValueExpr*>(&expr)) {
+        return {ColumnBuffer(), constant};
+    }
+    return {expr.evaluate(batch, allocator), nullptr};
+}
+
+/**
+ * @brief Make the rows that are NULL in the operand NULL in result, all rows if the operand is the
+ * NULL constant
+ */
+void intersectNulls(ColumnBuffer& result, const Operand& operand, int64_t rowCount) {
+    NullBitmap bitmap = result.getNullBitmap();
+    if (operand.isNullConstant()) {
+        bitmap.setAllNull();
+        return;
+    }
+    const uint8_t* validity = operand.column.getNullBitmap().data();
+    if (operand.constant || !validity) {
+        return;
+    }
+    auto bytes = static_cast<size_t>(rowCount + 7) / 8;
+    for (size_t i = 0; i < bytes; ++i) {
+        bitmap.data()[i] &= validity[i];
+    }
+}
+
+/**
+ * @brief Allocate the result of an operator for the rows of the batch, NULL where any operand is
+ */
+ColumnBuffer allocateResult(DataType type, std::initializer_list<const Operand*> operands, const RowVector& batch,
+                            BatchAllocator& allocator) {
+    ColumnBuffer result = allocator.allocateColumn(ColumnId(), type);
+    result.count = batch.getRowCount();
+    for (const Operand* operand : operands) {
+        intersectNulls(result, *operand, batch.getRowCount());
+    }
+    return result;
+}
+
+/**
+ * @brief Whether an error computing the row fails the query
+ */
+bool isActiveRow(const ColumnBuffer& result, const RowVector& batch, int64_t row) noexcept {
+    return !result.isNull(row) && batch.isRowSelected(row);
+}
+
+template<typename T>
+struct ColumnReader {
+    const T* values;
+
+    T operator[](int64_t row) const noexcept {
+        return values[row];
+    }
+};
+
+template<typename T>
+struct ConstantReader {
+    T value;
+
+    T operator[](int64_t) const noexcept {
+        return value;
+    }
+};
+
+/**
+ * @brief Call fn with a reader for either operand, specializing it for constants
+ */
+template<typename T, typename Fn>
+void dispatchReaders(const Operand& left, const Operand& right, Fn&& fn) {
+    auto column = [](const Operand& operand) { return ColumnReader<T>{operand.column.getDataAs<T>().data()}; };
+    auto constant = [](const Operand& operand) { return ConstantReader<T>{operand.constant->getValue<T>()}; };
+    if (left.constant && right.constant) {
+        fn(constant(left), constant(right));
+    } else if (left.constant) {
+        fn(constant(left), column(right));
+    } else if (right.constant) {
+        fn(column(left), constant(right));
+    } else {
+        fn(column(left), column(right));
+    }
+}
+
+/**
+ * @brief Reader of the values of an operand of any type, for kernels that do more work per row
+ * than reading it
+ */
+template<typename T>
+struct OperandReader {
+    const T* values = nullptr;
+    T constant{};
+
+    explicit OperandReader(const Operand& operand) {
+        if (operand.constant) {
+            constant = operand.constant->getValue<T>();
+        } else {
+            values = operand.column.getDataAs<T>().data();
+        }
+    }
+
+    T operator[](int64_t row) const noexcept {
+        return values ? values[row] : constant;
+    }
+};
+
+/**
+ * @brief Why the integer operation fails, nullptr if it does not
+ */
+template<typename T>
+const char* checkIntegerOp(ArithmeticOp op, T left, T right) noexcept {
+    T result;
+    switch (op) {
+        case ArithmeticOp::ADD: return __builtin_add_overflow(left, right, &result) ? "Integer overflow" : nullptr;
+        case ArithmeticOp::SUBTRACT: return __builtin_sub_overflow(left, right, &result) ? "Integer overflow" : nullptr;
+        case ArithmeticOp::MULTIPLY: return __builtin_mul_overflow(left, right, &result) ? "Integer overflow" : nullptr;
+        case ArithmeticOp::DIVIDE:
+            if (right == 0) {
+                return "Division by zero";
+            }
+            return right == -1 && left == std::numeric_limits<T>::min() ? "Integer overflow" : nullptr;
+        case ArithmeticOp::MODULO: return right == 0 ? "Division by zero" : nullptr;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+ColumnBuffer ColumnValueExpr::evaluate(const RowVector& batch, [[maybe_unused]] BatchAllocator& allocator) const {
+    tdb_assert(columnIndex_ != -1, "Column {} is not bound", columnId_.getName());
+    return batch.getColumn(columnIndex_);
+}
+
+std::unique_ptr<ConstantValueExpr> ConstantValueExpr::fromColumn(const ColumnBuffer& column, int64_t row) {
+    if (column.isNull(row)) {
+        return std::make_unique<ConstantValueExpr>(column.type);
+    }
+    switch (column.type.getType()) {
+        case DataType::Type::INT32:
+            return std::make_unique<ConstantValueExpr>(column.type, int64_t{column.getEntry<db_int32>(row)});
+        case DataType::Type::INT64: return std::make_unique<ConstantValueExpr>(column.type, column.getEntry<db_int64>(row));
+        case DataType::Type::DOUBLE:
+            return std::make_unique<ConstantValueExpr>(column.type, column.getEntry<db_double>(row));
+        case DataType::Type::BOOL: return std::make_unique<ConstantValueExpr>(column.type, column.getEntry<db_bool>(row));
+        case DataType::Type::STRING:
+            return std::make_unique<ConstantValueExpr>(column.type,
+                                                       std::string(column.getEntry<db_string>(row).view()));
+        default: tdb_unreachable("Unsupported constant type");
+    }
+}
+
+template<is_db_type T>
+static void fillColumn(ColumnBuffer& column, T value, int64_t rowCount) {
+    std::fill_n(column.getDataAs<T>().data(), rowCount, value);
+}
+
+ColumnBuffer ConstantValueExpr::evaluate(const RowVector& batch, BatchAllocator& allocator) const {
+    tdb_assert(type_ != DataType::getNullConst(), "NULL constant without a type cannot be evaluated");
+    ColumnBuffer column = allocator.allocateColumn(ColumnId(), type_);
+    int64_t rowCount = batch.getRowCount();
+    column.count = rowCount;
+    if (isNull()) {
+        NullBitmap bitmap = column.getNullBitmap();
+        bitmap.setAllNull();
+        return column;
+    }
+
+    switch (type_.getType()) {
+        case DataType::Type::INT32: fillColumn(column, getValue<db_int32>(), rowCount); break;
+        case DataType::Type::INT64: fillColumn(column, getValue<db_int64>(), rowCount); break;
+        case DataType::Type::DOUBLE: fillColumn(column, getValue<db_double>(), rowCount); break;
+        case DataType::Type::BOOL: fillColumn(column, getValue<db_bool>(), rowCount); break;
+        case DataType::Type::STRING:
+            // Long strings are copied into the heap once and shared by all rows
+            if (rowCount > 0) {
+                column.writeString(0, std::get<std::string>(value_));
+                fillColumn(column, column.getEntry<db_string>(0), rowCount);
+            }
+            break;
+        default: tdb_unreachable("Unsupported constant type");
+    }
+    return column;
+}
+
+std::string ConstantValueExpr::toString() const {
+    if (isNull()) {
+        return "NULL";
+    }
+    switch (type_.getType()) {
+        case DataType::Type::INT32:
+        case DataType::Type::INT64: return std::to_string(std::get<int64_t>(value_));
+        case DataType::Type::DOUBLE: {
+            std::array<char, 32> buffer;
+            auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), std::get<double>(value_));
+            return std::string(buffer.data(), end);
+        }
+        case DataType::Type::BOOL: return std::get<bool>(value_) ? "true" : "false";
+        case DataType::Type::STRING: {
+            std::string quoted = "'";
+            for (char c : std::get<std::string>(value_)) {
+                quoted += c;
+                if (c == '\'') {
+                    quoted += c;
+                }
+            }
+            return quoted + "'";
+        }
+        default: tdb_unreachable("Unsupported constant type");
+    }
+}
+
+static bool isArithmeticType(DataType type) noexcept {
+    return type == DataType::getInt32() || type == DataType::getInt64() || type == DataType::getDouble();
+}
+
+ArithmeticExpr::ArithmeticExpr(ArithmeticOp op, std::unique_ptr<ValueExpr> left, std::unique_ptr<ValueExpr> right)
+    : ValueExpr(left->getType()), op_(op) {
+    if (!isArithmeticType(left->getType()) || left->getType() != right->getType()) {
+        throw InternalSQLError("Operator " + toydb::toString(op) + " is not defined for " +
+                               left->getType().toString() + " and " + right->getType().toString());
+    }
+    children_.push_back(std::move(left));
+    children_.push_back(std::move(right));
+}
+
+template<typename T, typename Left, typename Right>
+void ArithmeticExpr::computeIntegers(const Left& left, const Right& right, ColumnBuffer& result,
+                                     const RowVector& batch) const {
+    T* out = result.getDataAs<T>().data();
+    int64_t rowCount = batch.getRowCount();
+
+    // Checking every row would keep the loops from being vectorized: failures are only collected
+    // here, and looked up in a second pass
+    bool failed = false;
+    switch (op_) {
+        case ArithmeticOp::ADD:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                failed |= __builtin_add_overflow(left[row], right[row], &out[row]);
+            }
+            break;
+        case ArithmeticOp::SUBTRACT:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                failed |= __builtin_sub_overflow(left[row], right[row], &out[row]);
+            }
+            break;
+        case ArithmeticOp::MULTIPLY:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                failed |= __builtin_mul_overflow(left[row], right[row], &out[row]);
+            }
+            break;
+        case ArithmeticOp::DIVIDE:
+        case ArithmeticOp::MODULO:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                T l = left[row];
+                T r = right[row];
+                // Dividing the minimum by -1 overflows, its remainder is 0 like that of any x % 1
+                bool invalid = r == 0 || (r == -1 && l == std::numeric_limits<T>::min());
+                failed |= op_ == ArithmeticOp::DIVIDE ? invalid : r == 0;
+                T divisor = invalid ? 1 : r;
+                out[row] = op_ == ArithmeticOp::DIVIDE ? l / divisor : l % divisor;
+            }
+            break;
+    }
+
+    if (!failed) {
+        return;
+    }
+    for (int64_t row = 0; row < rowCount; ++row) {
+        const char* error = checkIntegerOp<T>(op_, left[row], right[row]);
+        if (error && isActiveRow(result, batch, row)) {
+            throw SQLRuntimeException(std::string(error) + " in " + toString());
+        }
+    }
+}
+
+template<typename Left, typename Right>
+void ArithmeticExpr::computeDoubles(const Left& left, const Right& right, ColumnBuffer& result,
+                                    const RowVector& batch) const {
+    db_double* out = result.getDataAs<db_double>().data();
+    int64_t rowCount = batch.getRowCount();
+    bool failed = false;
+    switch (op_) {
+        case ArithmeticOp::ADD:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                out[row] = left[row] + right[row];
+            }
+            break;
+        case ArithmeticOp::SUBTRACT:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                out[row] = left[row] - right[row];
+            }
+            break;
+        case ArithmeticOp::MULTIPLY:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                out[row] = left[row] * right[row];
+            }
+            break;
+        case ArithmeticOp::DIVIDE:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                failed |= right[row] == 0.0;
+                out[row] = left[row] / right[row];
+            }
+            break;
+        case ArithmeticOp::MODULO:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                failed |= right[row] == 0.0;
+                out[row] = std::fmod(left[row], right[row]);
+            }
+            break;
+    }
+
+    if (!failed) {
+        return;
+    }
+    for (int64_t row = 0; row < rowCount; ++row) {
+        if (right[row] == 0.0 && isActiveRow(result, batch, row)) {
+            throw SQLRuntimeException("Division by zero in " + toString());
+        }
+    }
+}
+
+ColumnBuffer ArithmeticExpr::evaluate(const RowVector& batch, BatchAllocator& allocator) const {
+    Operand left = evaluateOperand(*children_[0], batch, allocator);
+    Operand right = evaluateOperand(*children_[1], batch, allocator);
+    ColumnBuffer result = allocateResult(type_, {&left, &right}, batch, allocator);
+    if (left.isNullConstant() || right.isNullConstant()) {
+        return result;
+    }
+
+    switch (type_.getType()) {
+        case DataType::Type::INT32:
+            dispatchReaders<db_int32>(left, right, [&](const auto& l, const auto& r) {
+                computeIntegers<db_int32>(l, r, result, batch);
+            });
+            break;
+        case DataType::Type::INT64:
+            dispatchReaders<db_int64>(left, right, [&](const auto& l, const auto& r) {
+                computeIntegers<db_int64>(l, r, result, batch);
+            });
+            break;
+        case DataType::Type::DOUBLE:
+            dispatchReaders<db_double>(left, right,
+                                       [&](const auto& l, const auto& r) { computeDoubles(l, r, result, batch); });
+            break;
+        default: tdb_unreachable("Unsupported arithmetic type");
+    }
+    return result;
+}
+
+CastValueExpr::CastValueExpr(std::unique_ptr<ValueExpr> input, DataType type) : ValueExpr(type) {
+    if (!canCast(input->getType(), type)) {
+        throw InternalSQLError("Cannot cast " + input->getType().toString() + " to " + type.toString());
+    }
+    children_.push_back(std::move(input));
+}
+
+bool CastValueExpr::canCast(DataType from, DataType to) noexcept {
+    auto isInteger = [](DataType type) { return type == DataType::getInt32() || type == DataType::getInt64(); };
+    if (from == to || from == DataType::getNullConst()) {
+        return true;
+    }
+    if (to == DataType::getNullConst()) {
+        return false;
+    }
+    if (from == DataType::getString() || to == DataType::getString()) {
+        return true;
+    }
+    if (isArithmeticType(from) && isArithmeticType(to)) {
+        return true;
+    }
+    return (from == DataType::getBool() && isInteger(to)) || (isInteger(from) && to == DataType::getBool());
+}
+
+/**
+ * @brief Convert a number or boolean
+ * @return false if the value does not fit the type
+ */
+template<typename From, typename To>
+static bool convertValue(From value, To& out) noexcept {
+    if constexpr (std::is_same_v<To, db_bool>) {
+        out = value != 0;
+    } else if constexpr (std::is_same_v<From, db_bool> || std::is_same_v<To, db_double>) {
+        out = static_cast<To>(value);
+    } else if constexpr (std::is_same_v<From, db_double>) {
+        // -min is 2^31 or 2^63, the smallest double past the range of To
+        double rounded = std::nearbyint(value);
+        if (!(rounded >= static_cast<double>(std::numeric_limits<To>::min()) &&
+              rounded < -static_cast<double>(std::numeric_limits<To>::min()))) {
+            out = 0;
+            return false;
+        }
+        out = static_cast<To>(rounded);
+    } else {
+        if (!std::in_range<To>(value)) {
+            out = 0;
+            return false;
+        }
+        out = static_cast<To>(value);
+    }
+    return true;
+}
+
+template<typename From, typename To>
+static void convertColumn(const ColumnBuffer& input, ColumnBuffer& result, const RowVector& batch) {
+    const From* in = input.getDataAs<From>().data();
+    To* out = result.getDataAs<To>().data();
+    for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+        if (!convertValue(in[row], out[row]) && isActiveRow(result, batch, row)) {
+            throw SQLRuntimeException("Value " + input.getValueAsString(row) + " is out of range for type " +
+                                      result.type.toString());
+        }
+    }
+}
+
+template<typename From>
+static void convertColumnFrom(const ColumnBuffer& input, ColumnBuffer& result, const RowVector& batch) {
+    switch (result.type.getType()) {
+        case DataType::Type::INT32: convertColumn<From, db_int32>(input, result, batch); break;
+        case DataType::Type::INT64: convertColumn<From, db_int64>(input, result, batch); break;
+        case DataType::Type::DOUBLE: convertColumn<From, db_double>(input, result, batch); break;
+        case DataType::Type::BOOL: convertColumn<From, db_bool>(input, result, batch); break;
+        default: tdb_unreachable("Unsupported cast");
+    }
+}
+
+static void formatColumn(const ColumnBuffer& input, ColumnBuffer& result, int64_t rowCount) {
+    std::array<char, 32> buffer;
+    for (int64_t row = 0; row < rowCount; ++row) {
+        if (result.isNull(row)) {
+            continue;
+        }
+        std::string_view value;
+        char* begin = buffer.data();
+        char* end = buffer.data() + buffer.size();
+        switch (input.type.getType()) {
+            case DataType::Type::INT32: value = {begin, std::to_chars(begin, end, input.getEntry<db_int32>(row)).ptr}; break;
+            case DataType::Type::INT64: value = {begin, std::to_chars(begin, end, input.getEntry<db_int64>(row)).ptr}; break;
+            case DataType::Type::DOUBLE:
+                value = {begin, std::to_chars(begin, end, input.getEntry<db_double>(row)).ptr};
+                break;
+            case DataType::Type::BOOL: value = input.getEntry<db_bool>(row) ? "true" : "false"; break;
+            default: tdb_unreachable("Unsupported cast");
+        }
+        result.writeString(row, value);
+    }
+}
+
+/**
+ * @brief Parse a value of the type T from a string, ignoring surrounding spaces
+ */
+template<typename T>
+static bool parseValue(std::string_view text, T& out) noexcept {
+    size_t begin = text.find_first_not_of(' ');
+    text = begin == std::string_view::npos ? std::string_view() : text.substr(begin, text.find_last_not_of(' ') - begin + 1);
+    if constexpr (std::is_same_v<T, db_bool>) {
+        auto equals = [&](std::string_view word) {
+            return std::ranges::equal(text, word, [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+        };
+        if (equals("true") || equals("1")) {
+            out = true;
+        } else if (equals("false") || equals("0")) {
+            out = false;
+        } else {
+            return false;
+        }
+        return true;
+    } else {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return error == std::errc() && end == text.data() + text.size() && !text.empty();
+    }
+}
+
+template<typename T>
+static void parseColumn(const ColumnBuffer& input, ColumnBuffer& result, const RowVector& batch) {
+    T* out = result.getDataAs<T>().data();
+    for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+        if (result.isNull(row)) {
+            continue;
+        }
+        std::string_view text = input.getEntry<db_string>(row).view();
+        if (!parseValue(text, out[row])) {
+            if (batch.isRowSelected(row)) {
+                throw SQLRuntimeException("Invalid value '" + std::string(text) + "' for type " +
+                                          result.type.toString());
+            }
+            out[row] = T{};
+        }
+    }
+}
+
+ColumnBuffer CastValueExpr::evaluate(const RowVector& batch, BatchAllocator& allocator) const {
+    DataType from = children_[0]->getType();
+    if (from == type_) {
+        return children_[0]->evaluate(batch, allocator);
+    }
+    Operand input = evaluateOperand(*children_[0], batch, allocator);
+    ColumnBuffer result = allocateResult(type_, {&input}, batch, allocator);
+    if (input.isNullConstant()) {
+        return result;
+    }
+    if (input.constant) {
+        input.column = input.constant->evaluate(batch, allocator);
+    }
+
+    if (type_ == DataType::getString()) {
+        formatColumn(input.column, result, batch.getRowCount());
+        return result;
+    }
+    switch (from.getType()) {
+        case DataType::Type::INT32: convertColumnFrom<db_int32>(input.column, result, batch); break;
+        case DataType::Type::INT64: convertColumnFrom<db_int64>(input.column, result, batch); break;
+        case DataType::Type::DOUBLE: convertColumnFrom<db_double>(input.column, result, batch); break;
+        case DataType::Type::BOOL: convertColumnFrom<db_bool>(input.column, result, batch); break;
+        case DataType::Type::STRING:
+            switch (type_.getType()) {
+                case DataType::Type::INT32: parseColumn<db_int32>(input.column, result, batch); break;
+                case DataType::Type::INT64: parseColumn<db_int64>(input.column, result, batch); break;
+                case DataType::Type::DOUBLE: parseColumn<db_double>(input.column, result, batch); break;
+                case DataType::Type::BOOL: parseColumn<db_bool>(input.column, result, batch); break;
+                default: tdb_unreachable("Unsupported cast");
+            }
+            break;
+        default: tdb_unreachable("Unsupported cast");
+    }
+    return result;
+}
+
+FunctionExpr::FunctionExpr(ScalarFunction function, std::vector<std::unique_ptr<ValueExpr>> arguments)
+    : ValueExpr(function == ScalarFunction::LENGTH ? DataType::getInt64() : DataType::getString(), std::move(arguments)),
+      function_(function) {
+    size_t minArguments = 1;
+    size_t maxArguments = 1;
+    if (function == ScalarFunction::SUBSTR) {
+        minArguments = 2;
+        maxArguments = 3;
+    } else if (function == ScalarFunction::CONCAT) {
+        maxArguments = children_.size();
+    }
+    if (children_.size() < minArguments || children_.size() > maxArguments) {
+        throw InternalSQLError("Wrong number of arguments for " + toydb::toString(function));
+    }
+    for (size_t i = 0; i < children_.size(); ++i) {
+        DataType expected = function == ScalarFunction::SUBSTR && i > 0 ? DataType::getInt64() : DataType::getString();
+        if (children_[i]->getType() != expected) {
+            throw InternalSQLError("Argument " + std::to_string(i + 1) + " of " + toydb::toString(function) +
+                                   " must be " + expected.toString() + " but is " + children_[i]->getType().toString());
+        }
+    }
+}
+
+/**
+ * @brief Characters of text from the 1-based start, up to length characters. Positions before the
+ * start of the text count towards the length.
+ */
+static std::string_view substring(std::string_view text, int64_t start, int64_t length) {
+    int64_t end = std::numeric_limits<int64_t>::max();
+    if (length != std::numeric_limits<int64_t>::max() && __builtin_add_overflow(start, length, &end)) {
+        end = std::numeric_limits<int64_t>::max();
+    }
+    int64_t first = std::max<int64_t>(start, 1);
+    int64_t last = std::min<int64_t>(end, static_cast<int64_t>(text.size()) + 1);
+    if (last <= first) {
+        return {};
+    }
+    return text.substr(static_cast<size_t>(first - 1), static_cast<size_t>(last - first));
+}
+
+ColumnBuffer FunctionExpr::evaluate(const RowVector& batch, BatchAllocator& allocator) const {
+    std::vector<Operand> operands;
+    for (const auto& child : children_) {
+        operands.push_back(evaluateOperand(*child, batch, allocator));
+    }
+    ColumnBuffer result = allocator.allocateColumn(ColumnId(), type_);
+    result.count = batch.getRowCount();
+    for (const Operand& operand : operands) {
+        intersectNulls(result, operand, batch.getRowCount());
+        if (operand.isNullConstant()) {
+            return result;
+        }
+    }
+
+    int64_t rowCount = batch.getRowCount();
+    OperandReader<db_string> text(operands[0]);
+    std::string buffer;
+    switch (function_) {
+        case ScalarFunction::UPPER:
+        case ScalarFunction::LOWER:
+            for (int64_t row = 0; row < rowCount; ++row) {
+                if (result.isNull(row)) {
+                    continue;
+                }
+                buffer = text[row].view();
+                for (char& c : buffer) {
+                    c = static_cast<char>(function_ == ScalarFunction::UPPER ? std::toupper(static_cast<unsigned char>(c))
+                                                                             : std::tolower(static_cast<unsigned char>(c)));
+                }
+                result.writeString(row, buffer);
+            }
+            break;
+        case ScalarFunction::LENGTH: {
+            db_int64* out = result.getDataAs<db_int64>().data();
+            for (int64_t row = 0; row < rowCount; ++row) {
+                out[row] = result.isNull(row) ? 0 : static_cast<db_int64>(text[row].view().size());
+            }
+            break;
+        }
+        case ScalarFunction::SUBSTR: {
+            OperandReader<db_int64> start(operands[1]);
+            std::optional<OperandReader<db_int64>> length;
+            if (operands.size() == 3) {
+                length.emplace(operands[2]);
+            }
+            for (int64_t row = 0; row < rowCount; ++row) {
+                if (result.isNull(row)) {
+                    continue;
+                }
+                int64_t count = length ? (*length)[row] : std::numeric_limits<int64_t>::max();
+                if (count < 0) {
+                    if (batch.isRowSelected(row)) {
+                        throw SQLRuntimeException("Negative length in " + toString());
+                    }
+                    count = 0;
+                }
+                result.writeString(row, substring(text[row].view(), start[row], count));
+            }
+            break;
+        }
+        case ScalarFunction::CONCAT: {
+            std::vector<OperandReader<db_string>> arguments;
+            for (const Operand& operand : operands) {
+                arguments.emplace_back(operand);
+            }
+            for (int64_t row = 0; row < rowCount; ++row) {
+                if (result.isNull(row)) {
+                    continue;
+                }
+                buffer.clear();
+                for (const auto& argument : arguments) {
+                    buffer += argument[row].view();
+                }
+                result.writeString(row, buffer);
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+std::string FunctionExpr::toString() const {
+    std::string result = toydb::toString(function_) + "(";
+    for (size_t i = 0; i < children_.size(); ++i) {
+        result += (i > 0 ? ", " : "") + children_[i]->toString();
+    }
+    return result + ")";
+}
+
+std::unique_ptr<ValueExpr> makeCast(std::unique_ptr<ValueExpr> expr, DataType type) {
+    if (expr->getType() == type) {
+        return expr;
+    }
+    const auto* constant = dynamic_cast<const ConstantValueExpr*>(expr.get());
+    if (constant && constant->isNull()) {
+        return std::make_unique<ConstantValueExpr>(type);
+    }
+    auto cast = std::make_unique<CastValueExpr>(std::move(expr), type);
+    if (!constant) {
+        return cast;
+    }
+
+    // Convert the constant as a batch of one row
+    memory::BufferManager bufferManager;
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch;
+    batch.setRowCount(1);
+    return ConstantValueExpr::fromColumn(cast->evaluate(batch, allocator), 0);
+}
+
+}  // namespace toydb
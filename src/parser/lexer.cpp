@@ -1,10 +1,11 @@
-#include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <climits>
 #include <cstdlib>
 #include <limits>
 #include <optional>
 #include <sstream>
+#include <string_view>
 #include <unordered_map>
 #include "common/assert.hpp"
 #include "common/logging.hpp"
@@ -15,49 +16,73 @@ namespace toydb {
 
 namespace parser {
 
-const std::unordered_map<std::string, TokenType> keywords = [](){
-    std::unordered_map<std::string, TokenType> result;
-    std::pair<std::string, TokenType> upperKeywords[] = {
-        {"SELECT", TokenType::KeySelect},
-        {"FROM", TokenType::KeyFrom},
-        {"WHERE", TokenType::KeyWhere},
-        {"JOIN", TokenType::KeyJoin},
-        {"ON", TokenType::KeyOn},
-        {"AS", TokenType::KeyAs},
-        {"ORDER", TokenType::KeyOrder},
-        {"BY", TokenType::KeyBy},
-        {"INSERT", TokenType::KeyInsert},
-        {"INTO", TokenType::KeyInto},
-        {"UPDATE", TokenType::KeyUpdate},
-        {"CREATE", TokenType::KeyCreate},
-        {"TABLE", TokenType::KeyTable},
-        {"SET", TokenType::KeySet},
-        {"DELETE", TokenType::KeyDelete},
-        {"VALUES", TokenType::KeyValues},
-        {"AND", TokenType::OpAnd},
-        {"OR", TokenType::OpOr},
-        {"INTEGER", TokenType::KeyIntegerType},
-        {"BIGINT", TokenType::KeyBigintType},
-        {"DOUBLE", TokenType::KeyDoubleType},
-        {"CHAR", TokenType::KeyCharType},
-        {"STRING", TokenType::KeyStringType},
-        {"BOOL", TokenType::KeyBoolType},
-        {"NULL", TokenType::NullLiteral},
-        {"TRUE", TokenType::TrueLiteral},
-        {"FALSE", TokenType::FalseLiteral}
-    };
-
-    // add lowercase versions
-    for (auto& entry : upperKeywords) {
-        result.insert(entry);
-        std::string lower{entry.first};
-        std::transform(entry.first.begin(), entry.first.end(), lower.begin(), ::tolower);
-        result[lower] = entry.second;
+const std::unordered_map<std::string_view, TokenType> keywords = {
+    {"SELECT", TokenType::KeySelect},
+    {"FROM", TokenType::KeyFrom},
+    {"WHERE", TokenType::KeyWhere},
+    {"JOIN", TokenType::KeyJoin},
+    {"ON", TokenType::KeyOn},
+    {"AS", TokenType::KeyAs},
+    {"ORDER", TokenType::KeyOrder},
+    {"GROUP", TokenType::KeyGroup},
+    {"BY", TokenType::KeyBy},
+    {"ASC", TokenType::KeyAsc},
+    {"DESC", TokenType::KeyDesc},
+    {"LIMIT", TokenType::KeyLimit},
+    {"INSERT", TokenType::KeyInsert},
+    {"INTO", TokenType::KeyInto},
+    {"UPDATE", TokenType::KeyUpdate},
+    {"CREATE", TokenType::KeyCreate},
+    {"TABLE", TokenType::KeyTable},
+    {"INDEX", TokenType::KeyIndex},
+    {"ANALYZE", TokenType::KeyAnalyze},
+    {"EXPLAIN", TokenType::KeyExplain},
+    {"CAST", TokenType::KeyCast},
+    {"TABLESAMPLE", TokenType::KeyTablesample},
+    {"SET", TokenType::KeySet},
+    {"DELETE", TokenType::KeyDelete},
+    {"VALUES", TokenType::KeyValues},
+    {"AND", TokenType::OpAnd},
+    {"OR", TokenType::OpOr},
+    {"INTEGER", TokenType::KeyIntegerType},
+    {"BIGINT", TokenType::KeyBigintType},
+    {"DOUBLE", TokenType::KeyDoubleType},
+    {"CHAR", TokenType::KeyCharType},
+    {"STRING", TokenType::KeyStringType},
+    {"BOOL", TokenType::KeyBoolType},
+    {"NULL", TokenType::NullLiteral},
+    {"TRUE", TokenType::TrueLiteral},
+    {"FALSE", TokenType::FalseLiteral}
+};
+
+constexpr size_t MAX_KEYWORD_LENGTH = 11;
+
+/**
+ * @brief Keywords are spelled either all uppercase or all lowercase, e.g. "False" is an identifier
+ */
+std::optional<TokenType> lookupKeyword(std::string_view word) noexcept {
+    if (word.size() > MAX_KEYWORD_LENGTH) {
+        return std::nullopt;
     }
 
-    return result;
-}();
+    char upper[MAX_KEYWORD_LENGTH];
+    bool hasUpper = false;
+    bool hasLower = false;
+    for (size_t i = 0; i < word.size(); ++i) {
+        hasUpper |= std::isupper(static_cast<unsigned char>(word[i])) != 0;
+        hasLower |= std::islower(static_cast<unsigned char>(word[i])) != 0;
+        upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[i])));
+    }
+    if (hasUpper && hasLower) {
+        return std::nullopt;
+    }
 
+    auto it = keywords.find(std::string_view(upper, word.size()));
+    if (it == keywords.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
 
 enum CharType {
     X,  // None
@@ -70,7 +95,7 @@ enum CharType {
 
 const CharType lut[128] = {
     X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
-    X, O, X, X, X, O, O, S, P, P, O, O, P, O, P, O, N, N, N, N, N, N, N, N, N, N, X, P, O, O, O, X,
+    X, O, X, X, X, O, O, S, P, P, O, O, P, O, P, O, N, N, N, N, N, N, N, N, N, N, X, P, O, O, O, P,
     P, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, P, X, P, O, A,
     X, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, P, O, P, O, X,
 };
@@ -143,24 +168,21 @@ std::optional<char> TokenStream::moveToNextToken() noexcept {
     while (position < query.size()) {
         char c = query[position];
 
-        if (c == '/' && position + 1 < query.size()) {
-            if (query[++position] == '/') {
-
-                // skip comment
-                while (position < query.size() && query[position] != '\n') {
-                    ++position;
-                }
-
-                if (position >= query.size()) {
-                    return std::nullopt;
-                }
-
+        if (c == '/' && position + 1 < query.size() && query[position + 1] == '/') {
+            // skip comment
+            while (position < query.size() && query[position] != '\n') {
                 ++position;
-                lineStart = position;
-                ++line;
+            }
 
-                continue;
+            if (position >= query.size()) {
+                return std::nullopt;
             }
+
+            ++position;
+            lineStart = position;
+            ++line;
+
+            continue;
         }
 
         // check whitespace
@@ -194,7 +216,31 @@ Token TokenStream::lexOperator() noexcept {
         case '*':
             op = TokenType::Asterisk;
             break;
-        
+
+        case '+':
+            op = TokenType::OpPlus;
+            break;
+
+        case '-':
+            op = TokenType::OpMinus;
+            break;
+
+        case '/':
+            op = TokenType::OpDivide;
+            break;
+
+        case '%':
+            op = TokenType::OpModulo;
+            break;
+
+        case '|': {
+            if (c2 == '|') {
+                op = TokenType::OpConcat;
+                ++position;
+            }
+            break;
+        }
+
         case '<': {
             if (c2 == '=') {
                 op = TokenType::OpLessEq;
@@ -246,20 +292,19 @@ Token TokenStream::lexWord() noexcept {
             c = query[position];
     }
 
-    std::string lexeme { query.substr(start, position - start) };
+    std::string_view lexeme = query.substr(start, position - start);
 
-    if (keywords.find(lexeme) != keywords.end()) {
-        TokenType keywordType = keywords.at(lexeme);
-        if (keywordType == TokenType::TrueLiteral) {
+    if (auto keywordType = lookupKeyword(lexeme)) {
+        if (*keywordType == TokenType::TrueLiteral) {
             return {TokenType::TrueLiteral, static_cast<int64_t>(1)};
-        } else if (keywordType == TokenType::FalseLiteral) {
+        } else if (*keywordType == TokenType::FalseLiteral) {
             return {TokenType::FalseLiteral, static_cast<int64_t>(0)};
         } else {
-            return {keywordType};
+            return {*keywordType};
         }
     }
 
-    return {TokenType::IdentifierType, std::move(lexeme) };
+    return {TokenType::IdentifierType, lexeme};
 }
 
 Token TokenStream::lexString() noexcept {
@@ -279,7 +324,7 @@ Token TokenStream::lexString() noexcept {
         ++position;
     }
 
-    std::string lexeme { query.substr(start, position - start) };
+    std::string_view lexeme = query.substr(start, position - start);
     ++position;
     return { TokenType::StringLiteral, lexeme };
 }
@@ -317,30 +362,32 @@ Token TokenStream::lexNumber() noexcept {
         }
     }
 
-    std::string lexeme = std::string(query.substr(start, position - start));
-    
+    std::string_view lexeme = query.substr(start, position - start);
+    const char* first = lexeme.data();
+    const char* last = lexeme.data() + lexeme.size();
+
     if (hasDecimal) {
-        try {
-            double value = std::stod(lexeme);
-            return {TokenType::DoubleLiteral, value};
-        } catch (const std::exception& e) {
-            Logger::error("Error parsing double: {}", e.what());
+        double value;
+        auto [end, error] = std::from_chars(first, last, value);
+        if (error != std::errc() || end != last) {
+            Logger::error("Error parsing double: {}", lexeme);
             return {TokenType::Unknown};
         }
+        return {TokenType::DoubleLiteral, value};
     } else {
-        // Check if it fits in int32 range
-        try {
-            int64_t value = std::stoll(lexeme);
-            if (value >= std::numeric_limits<int32_t>::min() &&
-                value <= std::numeric_limits<int32_t>::max()) {
-                return Token(TokenType::Int32Literal, value);
-            } else {
-                return Token(TokenType::Int64Literal, value);
-            }
-        } catch (const std::exception& e) {
-            Logger::error("Error parsing number: {}", e.what());
+        int64_t value;
+        auto [end, error] = std::from_chars(first, last, value);
+        if (error != std::errc() || end != last) {
+            Logger::error("Error parsing number: {}", lexeme);
             return {TokenType::Unknown};
         }
+        // Check if it fits in int32 range
+        if (value >= std::numeric_limits<int32_t>::min() &&
+            value <= std::numeric_limits<int32_t>::max()) {
+            return Token(TokenType::Int32Literal, value);
+        } else {
+            return Token(TokenType::Int64Literal, value);
+        }
     }
 }
 
@@ -351,13 +398,14 @@ Token TokenStream::lexPunctuationChar() noexcept {
         case ')': return TokenType::ParenthesisR;
         case ',': return TokenType::Comma;
         case '.': return TokenType::Dot;
+        case '?': return TokenType::Parameter;
         default: return TokenType::Unknown;
     }
 }
 
-std::string Token::getString() const {
-    tdb_assert(std::holds_alternative<std::string>(value), "Token value is not a string");
-    return std::get<std::string>(value);
+std::string_view Token::getString() const {
+    tdb_assert(std::holds_alternative<std::string_view>(value), "Token value is not a string");
+    return std::get<std::string_view>(value);
 }
 
 int64_t Token::getInt() const {
@@ -385,6 +433,11 @@ std::string Token::toString() const noexcept {
         case TokenType::OpNotEquals: return "!=";
         case TokenType::OpAnd: return "AND";
         case TokenType::OpOr: return "OR";
+        case TokenType::OpPlus: return "+";
+        case TokenType::OpMinus: return "-";
+        case TokenType::OpDivide: return "/";
+        case TokenType::OpModulo: return "%";
+        case TokenType::OpConcat: return "||";
 
         case TokenType::KeyInsert: return "INSERT";
         case TokenType::KeyInto: return "INTO";
@@ -395,14 +448,30 @@ std::string Token::toString() const noexcept {
         case TokenType::KeyAs: return "AS";
         case TokenType::KeyCreate: return "CREATE";
         case TokenType::KeyTable: return "TABLE";
+        case TokenType::KeyIndex: return "INDEX";
+        case TokenType::KeyAnalyze: return "ANALYZE";
+        case TokenType::KeyExplain: return "EXPLAIN";
+        case TokenType::KeyCast: return "CAST";
+        case TokenType::KeyTablesample: return "TABLESAMPLE";
         case TokenType::KeyJoin: return "JOIN";
         case TokenType::KeyOn: return "ON";
         case TokenType::KeyOrder: return "ORDER";
+        case TokenType::KeyGroup: return "GROUP";
         case TokenType::KeyBy: return "BY";
+        case TokenType::KeyAsc: return "ASC";
+        case TokenType::KeyDesc: return "DESC";
+        case TokenType::KeyLimit: return "LIMIT";
         case TokenType::KeyUpdate: return "UPDATE";
         case TokenType::KeySet: return "SET";
         case TokenType::KeyDelete: return "DELETE";
+        case TokenType::KeyBoolType: return "BOOL";
+        case TokenType::KeyIntegerType: return "INTEGER";
+        case TokenType::KeyBigintType: return "BIGINT";
+        case TokenType::KeyDoubleType: return "DOUBLE";
+        case TokenType::KeyCharType: return "CHAR";
+        case TokenType::KeyStringType: return "STRING";
         case TokenType::NullLiteral: return "NULL";
+        case TokenType::Parameter: return "?";
         case TokenType::TrueLiteral: return "TRUE";
         case TokenType::FalseLiteral: return "FALSE";
 
@@ -411,10 +480,11 @@ std::string Token::toString() const noexcept {
         case TokenType::Comma: return ",";
         case TokenType::Dot: return ".";
         case TokenType::Asterisk: return "*";
+        case TokenType::EndOfStatement: return ";";
 
         case TokenType::IdentifierType:
         case TokenType::StringLiteral:
-            return getString();
+            return std::string(getString());
 
         case TokenType::Int32Literal:
         case TokenType::Int64Literal: {
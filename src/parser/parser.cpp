@@ -1,8 +1,11 @@
 #include "parser/parser.hpp"
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 #include "common/assert.hpp"
 #include "common/debug.hpp"
@@ -35,22 +38,191 @@ Token Parser::parseIdentifier(const std::string& context) {
  */
 std::pair<std::string, std::string> Parser::parseQualifiedColumnRef(const std::string& context) {
     auto token = parseIdentifier(context);
-    std::string firstPart = token.getString();
+    std::string firstPart(token.getString());
 
     auto peeked = ts.peek();
     if (peeked.type == TokenType::Dot) {
         ts.next();
 
-        auto afterDot = ts.peek();
         auto secondToken = parseIdentifier(context);
 
-        return {firstPart, secondToken.getString()};
+        return {firstPart, std::string(secondToken.getString())};
     }
 
     // Unqualified identifier
     return {"", firstPart};
 }
 
+/**
+ * Name of a computed column: the printed expression without the parentheses around a binary
+ * operation, e.g. "price * quantity".
+ */
+static std::string getComputedName(const ast::Expression* expression) {
+    std::ostringstream os;
+    os << *expression;
+    std::string name = os.str();
+    if ((ast::as<ast::Arithmetic>(expression) || ast::as<ast::Condition>(expression)) && name.front() == '(') {
+        name = name.substr(1, name.size() - 2);
+    }
+    return name;
+}
+
+/**
+ * Parses an entry of the SELECT column list: a column reference, an aggregate call such as
+ * SUM(price) or COUNT(*), or an expression computed per row such as price * quantity, optionally
+ * followed by an alias. A computed entry is named by the printed expression.
+ * @throws ParserException if the function is unknown or the call is malformed
+ */
+ast::ColumnRef Parser::parseSelectColumn() {
+    auto* expression = parseExpression();
+
+    std::string alias{};
+    if (ts.peek().type == TokenType::KeyAs) {
+        ts.next();
+        alias = parseIdentifier("column alias").getString();
+    }
+
+    if (auto* column = ast::as<ast::ColumnRef>(expression)) {
+        ast::ColumnRef columnRef = *column;
+        columnRef.alias = alias;
+        return columnRef;
+    }
+
+    ast::ColumnRef columnRef(getComputedName(expression), alias);
+    columnRef.expression = expression;
+    return columnRef;
+}
+
+/**
+ * Parses an optional GROUP BY clause with a comma-separated list of columns.
+ * @return The group columns, empty if there is no GROUP BY clause
+ */
+std::vector<ast::ColumnRef> Parser::parseGroupBy() {
+    std::vector<ast::ColumnRef> groupBy;
+    if (ts.peek().type != TokenType::KeyGroup) {
+        return groupBy;
+    }
+    ts.next();
+    expectToken(TokenType::KeyBy, "BY after GROUP");
+
+    do {
+        if (!groupBy.empty()) {
+            ts.next();
+        }
+        auto [table, column] = parseQualifiedColumnRef("group column");
+        groupBy.emplace_back(table, column, "");
+    } while (ts.peek().type == TokenType::Comma);
+
+    return groupBy;
+}
+
+/**
+ * Parses an optional ORDER BY clause with a single column, followed by ASC or DESC.
+ */
+void Parser::parseOrderBy(ast::SelectFrom& selectFrom) {
+    if (ts.peek().type != TokenType::KeyOrder) {
+        return;
+    }
+    ts.next();
+    expectToken(TokenType::KeyBy, "BY after ORDER");
+
+    auto [table, column] = parseQualifiedColumnRef("order column");
+    selectFrom.orderBy.emplace(table, column, "");
+
+    if (ts.peek().type == TokenType::KeyAsc) {
+        ts.next();
+    } else if (ts.peek().type == TokenType::KeyDesc) {
+        ts.next();
+        selectFrom.orderByDescending = true;
+    }
+}
+
+/**
+ * Parses an optional LIMIT clause with a non-negative integer literal.
+ * @return The limit, nullopt if there is no LIMIT clause
+ */
+std::optional<int64_t> Parser::parseLimit() {
+    if (ts.peek().type != TokenType::KeyLimit) {
+        return std::nullopt;
+    }
+    ts.next();
+
+    auto token = ts.next();
+    if (token.type != TokenType::Int32Literal && token.type != TokenType::Int64Literal) {
+        throw ParserException("Expected row count after LIMIT, but got " + token.toString(),
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    if (token.getInt() < 0) {
+        throw ParserException("LIMIT must not be negative",
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    return token.getInt();
+}
+
+/**
+ * Parses an integer or floating point literal.
+ * @throws ParserException if the next token is not a number
+ */
+double Parser::parseNumber(const std::string& context) {
+    auto token = ts.next();
+    switch (token.type) {
+        case TokenType::Int32Literal:
+        case TokenType::Int64Literal:
+            return static_cast<double>(token.getInt());
+        case TokenType::DoubleLiteral:
+            return token.getDouble();
+        default:
+            throw ParserException("Expected " + context + ", but got " + token.toString(),
+                                  ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+}
+
+static std::string toUpper(std::string_view word) {
+    std::string upper(word);
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    return upper;
+}
+
+/**
+ * Parses the rest of a TABLESAMPLE BERNOULLI|SYSTEM (percent) [REPEATABLE (seed)] clause after
+ * TABLESAMPLE. The method and REPEATABLE are not keywords, so they remain usable as names.
+ * @throws ParserException if the method is unknown or the percentage is not in [0, 100]
+ */
+TableSample Parser::parseTableSample() {
+    std::string method = toUpper(parseIdentifier("BERNOULLI or SYSTEM after TABLESAMPLE").getString());
+    TableSample sample{};
+    if (method == "BERNOULLI") {
+        sample.method = SampleMethod::BERNOULLI;
+    } else if (method == "SYSTEM") {
+        sample.method = SampleMethod::SYSTEM;
+    } else {
+        throw ParserException("Unknown sampling method " + method + ", expected BERNOULLI or SYSTEM",
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+
+    expectToken(TokenType::ParenthesisL, "( after " + method);
+    sample.percent = parseNumber("sample percentage");
+    if (!(sample.percent >= 0.0 && sample.percent <= 100.0)) {
+        throw ParserException("Sample percentage must be between 0 and 100",
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    expectToken(TokenType::ParenthesisR, "closing parenthesis");
+
+    auto peeked = ts.peek();
+    if (peeked.type == TokenType::IdentifierType && toUpper(peeked.getString()) == "REPEATABLE") {
+        ts.next();
+        expectToken(TokenType::ParenthesisL, "( after REPEATABLE");
+        auto token = ts.next();
+        if (token.type != TokenType::Int32Literal && token.type != TokenType::Int64Literal) {
+            throw ParserException("Expected seed after REPEATABLE, but got " + token.toString(),
+                                  ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+        }
+        sample.seed = static_cast<uint64_t>(token.getInt());
+        expectToken(TokenType::ParenthesisR, "closing parenthesis");
+    }
+    return sample;
+}
+
 /**
  * Verifies that the next token matches the expected type.
  * @param expected The expected token type
@@ -76,18 +248,45 @@ bool isBinop(TokenType type) noexcept {
         case TokenType::OpLessEq:
         case TokenType::OpAnd:
         case TokenType::OpOr:
+        case TokenType::OpPlus:
+        case TokenType::OpMinus:
+        case TokenType::Asterisk:
+        case TokenType::OpDivide:
+        case TokenType::OpModulo:
+        case TokenType::OpConcat:
             return true;
         default:
             return false;
     }
 }
 
+bool isNegativeNumber(const Token& token) noexcept {
+    switch (token.type) {
+        case TokenType::Int32Literal:
+        case TokenType::Int64Literal:
+            return token.getInt() < 0;
+        case TokenType::DoubleLiteral:
+            return std::signbit(token.getDouble());
+        default:
+            return false;
+    }
+}
+
 /**
  * Get the operator precence of the binop token type.
  * A higher return value means higher precendence.
  */
 int getPrecedence(TokenType type) {
     switch (type) {
+        case TokenType::Asterisk:
+        case TokenType::OpDivide:
+        case TokenType::OpModulo:
+            return 6;
+        case TokenType::OpPlus:
+        case TokenType::OpMinus:
+            return 5;
+        case TokenType::OpConcat:
+            return 4;
         case TokenType::OpEquals:
         case TokenType::OpNotEquals:
         case TokenType::OpGreaterEq:
@@ -106,108 +305,110 @@ int getPrecedence(TokenType type) {
 
 /**
  * Parses a SQL expression and returns its AST representation.
- * Handles comparison operators and nested expressions.
+ * Binary operators are left-associative and parsed by precedence climbing: the right operand of
+ * an operator only takes operators that bind tighter.
+ * @param minPrecedence Lowest precedence of the operators to consume
  */
-std::unique_ptr<ast::Expression> Parser::parseExpression() {
-    auto left = parseTerm();
-    Token token = ts.peek();
-
-    int prevPrecedence = std::numeric_limits<int>::max();
-    int precedence = getPrecedence(token.type);
-
-    while (precedence > 0) {
-        ts.next();
-        auto right = parseTerm();
-        auto condition = std::make_unique<ast::Condition>();
+ast::Expression* Parser::parseExpression(int minPrecedence) {
+    auto* left = parseTerm();
 
-        switch (token.type) {
-            case TokenType::OpEquals:
-                condition->op = CompareOp::EQUAL;
-                break;
-            case TokenType::OpNotEquals:
-                condition->op = CompareOp::NOT_EQUAL;
-                break;
-            case TokenType::OpGreaterThan:
-                condition->op = CompareOp::GREATER;
-                break;
-            case TokenType::OpLessThan:
-                condition->op = CompareOp::LESS;
-                break;
-            case TokenType::OpGreaterEq:
-                condition->op = CompareOp::GREATER_EQUAL;
-                break;
-            case TokenType::OpLessEq:
-                condition->op = CompareOp::LESS_EQUAL;
-                break;
-            case TokenType::OpAnd:
-                condition->op = CompareOp::AND;
-                break;
-            case TokenType::OpOr:
-                condition->op = CompareOp::OR;
-                break;
-            default:
-                break;
+    while (true) {
+        Token token = ts.peek();
+        TokenType op = token.type;
+        if (isNegativeNumber(token)) {
+            // The lexer reads "a -1" as a followed by the number -1, which is a + -1. The number
+            // is left for the right operand.
+            op = TokenType::OpPlus;
         }
-
-        condition->right = std::move(right);
-
-        if (precedence <= prevPrecedence) {
-            condition->left = std::move(left);
-            left = std::move(condition);
-
-        } else {
-            auto leftCondition = dynamic_cast<ast::Condition*>(left.get());
-            tdb_assert(leftCondition, "Left should be binop");
-
-            condition->left = std::move(leftCondition->right);
-            leftCondition->right = std::move(condition);
+        int precedence = getPrecedence(op);
+        if (precedence == 0 || precedence < minPrecedence) {
+            break;
         }
-
-        token = ts.peek();
-        prevPrecedence = precedence;
-        precedence = getPrecedence(token.type);
+        if (op == token.type) {
+            ts.next();
+        }
+        auto* right = parseExpression(precedence + 1);
+        left = makeBinaryExpression(op, left, right);
     }
 
     return left;
 }
 
+ast::Expression* Parser::makeBinaryExpression(TokenType op, ast::Expression* left, ast::Expression* right) {
+    switch (op) {
+        case TokenType::OpEquals: return arena_->make<ast::Condition>(CompareOp::EQUAL, left, right);
+        case TokenType::OpNotEquals: return arena_->make<ast::Condition>(CompareOp::NOT_EQUAL, left, right);
+        case TokenType::OpGreaterThan: return arena_->make<ast::Condition>(CompareOp::GREATER, left, right);
+        case TokenType::OpLessThan: return arena_->make<ast::Condition>(CompareOp::LESS, left, right);
+        case TokenType::OpGreaterEq: return arena_->make<ast::Condition>(CompareOp::GREATER_EQUAL, left, right);
+        case TokenType::OpLessEq: return arena_->make<ast::Condition>(CompareOp::LESS_EQUAL, left, right);
+        case TokenType::OpAnd: return arena_->make<ast::Condition>(CompareOp::AND, left, right);
+        case TokenType::OpOr: return arena_->make<ast::Condition>(CompareOp::OR, left, right);
+        case TokenType::OpPlus: return arena_->make<ast::Arithmetic>(ArithmeticOp::ADD, left, right);
+        case TokenType::OpMinus: return arena_->make<ast::Arithmetic>(ArithmeticOp::SUBTRACT, left, right);
+        case TokenType::Asterisk: return arena_->make<ast::Arithmetic>(ArithmeticOp::MULTIPLY, left, right);
+        case TokenType::OpDivide: return arena_->make<ast::Arithmetic>(ArithmeticOp::DIVIDE, left, right);
+        case TokenType::OpModulo: return arena_->make<ast::Arithmetic>(ArithmeticOp::MODULO, left, right);
+        case TokenType::OpConcat:
+            return arena_->make<ast::FunctionCall>(ScalarFunction::CONCAT, std::vector<ast::Expression*>{left, right});
+        default: tdb_unreachable("Not a binary operator");
+    }
+}
+
 /**
- * Parses a term (identifier or literal) and returns its AST representation.
+ * Parses a term (column, literal, ? placeholder, function call, CAST, unary minus or parenthesized
+ * expression) and returns its AST representation.
  */
-std::unique_ptr<ast::Expression> Parser::parseTerm() {
-    auto token = ts.peek();
+ast::Expression* Parser::parseTerm() {
+    auto token = ts.next();
 
     if (token.type == TokenType::IdentifierType) {
+        auto peeked = ts.peek();
+        if (peeked.type == TokenType::ParenthesisL) {
+            return parseCall(token.getString());
+        }
         // Parse qualified identifier (table.column or just column)
-        auto [table, column] = parseQualifiedColumnRef("column name");
-        return std::make_unique<ast::ColumnRef>(table, column, "");
-    }
-
-    token = ts.next();
+        if (peeked.type == TokenType::Dot) {
+            ts.next();
+            auto column = parseIdentifier("column name");
+            return arena_->make<ast::ColumnRef>(token.getString(), column.getString(), "");
+        }
+        return arena_->make<ast::ColumnRef>("", token.getString(), "");
 
-    if (token.type == TokenType::Int32Literal) {
-        return std::make_unique<ast::ConstantInt>(token.getInt(), false);
+    } else if (token.type == TokenType::Int32Literal) {
+        return arena_->make<ast::ConstantInt>(token.getInt(), false);
 
     } else if (token.type == TokenType::Int64Literal) {
-        return std::make_unique<ast::ConstantInt>(token.getInt(), true);
+        return arena_->make<ast::ConstantInt>(token.getInt(), true);
 
     } else if (token.type == TokenType::DoubleLiteral) {
-        return std::make_unique<ast::ConstantDouble>(token.getDouble());
+        return arena_->make<ast::ConstantDouble>(token.getDouble());
 
     } else if (token.type == TokenType::StringLiteral) {
-        return std::make_unique<ast::ConstantString>(token.getString());
+        return arena_->make<ast::ConstantString>(token.getString());
 
     } else if (token.type == TokenType::NullLiteral) {
-        return std::make_unique<ast::ConstantNull>();
+        return arena_->make<ast::ConstantNull>();
 
     } else if (token.type == TokenType::TrueLiteral) {
-        return std::make_unique<ast::ConstantBool>(token.getBool());
+        return arena_->make<ast::ConstantBool>(token.getBool());
 
     } else if (token.type == TokenType::FalseLiteral) {
-        return std::make_unique<ast::ConstantBool>(token.getBool());
+        return arena_->make<ast::ConstantBool>(token.getBool());
+
+    } else if (token.type == TokenType::Parameter) {
+        return arena_->make<ast::Parameter>(parameterCount_++);
+
+    } else if (token.type == TokenType::KeyCast) {
+        return parseCast();
+
+    } else if (token.type == TokenType::OpMinus) {
+        // Negative numbers are lexed as literals, -x is 0 - x
+        auto* operand = parseTerm();
+        return arena_->make<ast::Arithmetic>(ArithmeticOp::SUBTRACT, arena_->make<ast::ConstantInt>(0, false), operand);
 
     } else if (token.type == TokenType::ParenthesisL) {
-        auto&& result = parseExpression();
+        auto* result = parseExpression();
         expectToken(TokenType::ParenthesisR, "closing parenthesis");
         return result;
     }
@@ -216,11 +417,139 @@ std::unique_ptr<ast::Expression> Parser::parseTerm() {
                           ts.getLinePosition(), ts.getQuery());
 }
 
+/**
+ * Parses the argument list of a function call after the function name. Aggregate calls such as
+ * SUM(price) or COUNT(*) take a column and are returned as a ColumnRef with the aggregate set,
+ * APPROX_QUANTILE(price, 0.9) also takes the fraction as a literal. Scalar functions such as
+ * UPPER(name) take expressions.
+ * @throws ParserException if the function is unknown or the call is malformed
+ */
+ast::Expression* Parser::parseCall(std::string_view name) {
+    std::string functionName(name);
+    std::transform(functionName.begin(), functionName.end(), functionName.begin(), ::toupper);
+
+    std::optional<AggregateFunction> aggregate;
+    std::optional<ScalarFunction> function;
+    // Number of arguments of a scalar function
+    size_t minArguments = 1;
+    size_t maxArguments = 1;
+    if (functionName == "COUNT") {
+        aggregate = AggregateFunction::COUNT;
+    } else if (functionName == "SUM") {
+        aggregate = AggregateFunction::SUM;
+    } else if (functionName == "AVG") {
+        aggregate = AggregateFunction::AVG;
+    } else if (functionName == "MIN") {
+        aggregate = AggregateFunction::MIN;
+    } else if (functionName == "MAX") {
+        aggregate = AggregateFunction::MAX;
+    } else if (functionName == "APPROX_COUNT_DISTINCT") {
+        aggregate = AggregateFunction::APPROX_COUNT_DISTINCT;
+    } else if (functionName == "APPROX_QUANTILE") {
+        aggregate = AggregateFunction::APPROX_QUANTILE;
+    } else if (functionName == "UPPER") {
+        function = ScalarFunction::UPPER;
+    } else if (functionName == "LOWER") {
+        function = ScalarFunction::LOWER;
+    } else if (functionName == "LENGTH") {
+        function = ScalarFunction::LENGTH;
+    } else if (functionName == "SUBSTR") {
+        function = ScalarFunction::SUBSTR;
+        minArguments = 2;
+        maxArguments = 3;
+    } else if (functionName == "CONCAT") {
+        function = ScalarFunction::CONCAT;
+        maxArguments = std::numeric_limits<size_t>::max();
+    } else {
+        throw ParserException("Unknown function " + std::string(name),
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    expectToken(TokenType::ParenthesisL, "(");
+
+    if (aggregate) {
+        std::string table;
+        std::string column;
+        // Set if the argument is computed, e.g. SUM(price * quantity)
+        ast::Expression* argument = nullptr;
+        if (ts.peek().type == TokenType::Asterisk) {
+            if (aggregate != AggregateFunction::COUNT) {
+                throw ParserException(functionName + "(*) is not supported",
+                                      ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+            }
+            ts.next();
+            aggregate = AggregateFunction::COUNT_STAR;
+            column = "*";
+        } else {
+            argument = parseExpression();
+            auto* argumentColumn = ast::as<ast::ColumnRef>(argument);
+            if (argumentColumn && argumentColumn->isAggregate()) {
+                throw ParserException("Aggregate calls cannot be nested", ts.getCurrentLineNumber(),
+                                      ts.getLinePosition(), ts.getQuery());
+            }
+            if (argumentColumn && !argumentColumn->isComputed()) {
+                table = argumentColumn->table;
+                column = argumentColumn->name;
+                argument = nullptr;
+            } else {
+                column = getComputedName(argument);
+            }
+        }
+
+        double quantile = 0.5;
+        if (aggregate == AggregateFunction::APPROX_QUANTILE) {
+            expectToken(TokenType::Comma, ", fraction");
+            quantile = parseNumber("quantile fraction");
+            if (!(quantile >= 0.0 && quantile <= 1.0)) {
+                throw ParserException("Quantile fraction must be between 0 and 1",
+                                      ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+            }
+        }
+        expectToken(TokenType::ParenthesisR, ")");
+
+        auto* columnRef = arena_->make<ast::ColumnRef>(table, column, "");
+        columnRef->aggregate = aggregate;
+        columnRef->quantile = quantile;
+        columnRef->expression = argument;
+        return columnRef;
+    }
+
+    std::vector<ast::Expression*> arguments;
+    if (ts.peek().type != TokenType::ParenthesisR) {
+        do {
+            if (!arguments.empty()) {
+                ts.next();
+            }
+            arguments.push_back(parseExpression());
+        } while (ts.peek().type == TokenType::Comma);
+    }
+    expectToken(TokenType::ParenthesisR, ")");
+
+    if (arguments.size() < minArguments || arguments.size() > maxArguments) {
+        throw ParserException("Wrong number of arguments for " + functionName,
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    return arena_->make<ast::FunctionCall>(*function, std::move(arguments));
+}
+
+/**
+ * Parses CAST(expression AS type) after the CAST keyword.
+ * @throws ParserException if syntax is invalid or the type is unknown
+ */
+ast::Cast* Parser::parseCast() {
+    expectToken(TokenType::ParenthesisL, "( after CAST");
+    auto* expression = parseExpression();
+    expectToken(TokenType::KeyAs, "AS in CAST");
+    auto token = ts.next();
+    DataType type = parseDataType(token, ts.getCurrentLineNumber(), ts.getLinePosition());
+    expectToken(TokenType::ParenthesisR, "closing parenthesis");
+    return arena_->make<ast::Cast>(expression, type);
+}
+
 /**
  * Parses a WHERE <Expression> clause and returns its AST representation.
  * @return AST node for WHERE clause or nullptr if no WHERE clause
  */
-std::unique_ptr<ast::Expression> Parser::parseWhere() {
+ast::Expression* Parser::parseWhere() {
     auto token = ts.peek();
 
     if (token.type != TokenType::KeyWhere) {
@@ -228,7 +557,7 @@ std::unique_ptr<ast::Expression> Parser::parseWhere() {
     }
 
     ts.next();
-    auto expr = parseExpression();
+    auto* expr = parseExpression();
     if (!expr) {
         throw ParserException("Expected expression after WHERE", ts.getCurrentLineNumber(),
                               ts.getLinePosition(), ts.getQuery());
@@ -237,16 +566,16 @@ std::unique_ptr<ast::Expression> Parser::parseWhere() {
 }
 
 /**
- * Parses a SELECT ... FROM ... [WHERE ...] statement and returns its AST representation.
+ * Parses a SELECT ... FROM table [AS alias] [TABLESAMPLE ...], ... [WHERE ...] [GROUP BY ...] [ORDER BY ...] [LIMIT n] statement and returns its AST representation.
  * @throws ParserException if syntax is invalid
  */
-std::unique_ptr<ast::SelectFrom> Parser::parseSelect() {
+ast::SelectFrom* Parser::parseSelect() {
     getLogger().trace("Parsing SELECT statement");
 
     expectToken(TokenType::KeySelect, "SELECT statement");
 
     // TODO: Support DISTINCT keyword
-    auto selectFrom = std::make_unique<ast::SelectFrom>();
+    auto* selectFrom = arena_->make<ast::SelectFrom>();
 
     // Parse column list or *
     auto token = ts.peek();
@@ -265,16 +594,7 @@ std::unique_ptr<ast::SelectFrom> Parser::parseSelect() {
             }
             first = false;
 
-            auto [table, column] = parseQualifiedColumnRef("column name");
-
-            std::string alias{};
-            if (ts.peek().type == TokenType::KeyAs) {
-                ts.next();
-                token = parseIdentifier("column alias");
-                alias = token.getString();
-            }
-
-            selectFrom->columns.emplace_back(table, column, alias);
+            selectFrom->columns.push_back(parseSelectColumn());
         }
 
         if (selectFrom->columns.empty()) {
@@ -308,6 +628,11 @@ std::unique_ptr<ast::SelectFrom> Parser::parseSelect() {
             table.alias = token.getString();
         }
 
+        if (ts.peek().type == TokenType::KeyTablesample) {
+            ts.next();
+            table.sample = parseTableSample();
+        }
+
         selectFrom->tables.emplace_back(table);
     }
 
@@ -317,8 +642,9 @@ std::unique_ptr<ast::SelectFrom> Parser::parseSelect() {
     }
 
     selectFrom->where = parseWhere();
-
-    // TODO: Support ORDER BY clause
+    selectFrom->groupBy = parseGroupBy();
+    parseOrderBy(*selectFrom);
+    selectFrom->limit = parseLimit();
 
     return selectFrom;
 }
@@ -339,21 +665,36 @@ DataType Parser::parseDataType(Token token, size_t line, size_t pos) {
     throw ParserException("Unknown data type: " + token.toString(), line, pos, ts.getQuery());
 }
 
-std::unique_ptr<ast::CreateTable> Parser::parseCreateTable() {
+/**
+ * Parses a CREATE TABLE, CREATE INDEX or CREATE MATERIALIZED VIEW statement and returns its AST representation.
+ * @throws ParserException if syntax is invalid
+ */
+ast::ASTNode* Parser::parseCreate() {
+    expectToken(TokenType::KeyCreate, "CREATE statement");
+    auto peeked = ts.peek();
+    if (peeked.type == TokenType::KeyIndex) {
+        return parseCreateIndex();
+    }
+    if (peeked.type == TokenType::IdentifierType && toUpper(peeked.getString()) == "MATERIALIZED") {
+        return parseCreateMaterializedView();
+    }
+    return parseCreateTable();
+}
+
+ast::CreateTable* Parser::parseCreateTable() {
     getLogger().trace("Parsing CREATE TABLE statement");
 
-    expectToken(TokenType::KeyCreate, "CREATE statement");
     expectToken(TokenType::KeyTable, "TABLE statement");
 
     auto token = parseIdentifier("table name");
     auto tableName = token.getString();
-    auto createTable = std::make_unique<ast::CreateTable>(tableName);
+    auto* createTable = arena_->make<ast::CreateTable>(tableName);
 
     expectToken(TokenType::ParenthesisL, "column definition list");
 
     while (ts.peek().type != TokenType::ParenthesisR) {
             token = parseIdentifier("column name");
-            std::string colName = token.getString();
+            std::string_view colName = token.getString();
 
         token = ts.next();
         auto colType = parseDataType(token, ts.getCurrentLineNumber(), ts.getLinePosition());
@@ -377,7 +718,7 @@ std::unique_ptr<ast::CreateTable> Parser::parseCreateTable() {
  * Parses an INSERT INTO <table> (column_list) VALUES (value_list) statement and returns its AST representation.
  * @throws ParserException if syntax is invalid
  */
-std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
+ast::Insert* Parser::parseInsertInto() {
     getLogger().trace("Parsing INSERT INTO statement");
 
     expectToken(TokenType::KeyInsert, "INSERT statement");
@@ -385,7 +726,7 @@ std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
 
     auto token = parseIdentifier("table name");
     auto tableName = token.getString();
-    auto insert = std::make_unique<ast::Insert>(tableName);
+    auto* insert = arena_->make<ast::Insert>(tableName);
 
     // column list
     if (ts.peek().type == TokenType::ParenthesisL) {
@@ -399,7 +740,7 @@ std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
             first = false;
 
             token = parseIdentifier("column name");
-            insert->columnNames.push_back(token.getString());
+            insert->columnNames.emplace_back(token.getString());
         }
         expectToken(TokenType::ParenthesisR, "column list");
     }
@@ -418,7 +759,7 @@ std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
         firstRow = false;
 
         expectToken(TokenType::ParenthesisL, "value list");
-        std::vector<std::unique_ptr<ast::Expression>> row;
+        std::vector<ast::Expression*> row;
 
         bool firstVal = true;
         while (ts.peek().type != TokenType::ParenthesisR) {
@@ -427,9 +768,9 @@ std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
             }
             firstVal = false;
 
-            auto expr = parseTerm();
+            auto* expr = parseTerm();
             tdb_assert(expr != nullptr, "Expected expression in VALUES list");
-            row.push_back(std::move(expr));
+            row.push_back(expr);
         }
 
         if (insert->columnNames.size() > 0 && insert->columnNames.size() != row.size()) {
@@ -448,7 +789,7 @@ std::unique_ptr<ast::Insert> Parser::parseInsertInto() {
  * Parses an UPDATE statement and returns its AST representation.
  * @throws ParserException if syntax is invalid
  */
-std::unique_ptr<ast::Update> Parser::parseUpdate() {
+ast::Update* Parser::parseUpdate() {
     getLogger().trace("Parsing UPDATE statement");
 
     expectToken(TokenType::KeyUpdate, "UPDATE statement");
@@ -460,7 +801,7 @@ std::unique_ptr<ast::Update> Parser::parseUpdate() {
     }
 
     auto tableName = token.getString();
-    auto update = std::make_unique<ast::Update>(tableName);
+    auto* update = arena_->make<ast::Update>(tableName);
 
     expectToken(TokenType::KeySet, "SET statement");
 
@@ -480,9 +821,9 @@ std::unique_ptr<ast::Update> Parser::parseUpdate() {
 
         expectToken(TokenType::OpEquals, "assignment in UPDATE statement");
 
-        auto value = parseTerm();
+        auto* value = parseTerm();
         tdb_assert(value != nullptr, "Expected expression after = in UPDATE statement");
-        update->assignments.emplace_back(colName, std::move(value));
+        update->assignments.emplace_back(colName, value);
     }
 
     update->where = parseWhere();
@@ -493,7 +834,7 @@ std::unique_ptr<ast::Update> Parser::parseUpdate() {
  * Parses a DELETE statement and returns its AST representation.
  * @throws ParserException if syntax is invalid
  */
-std::unique_ptr<ast::Delete> Parser::parseDeleteFrom() {
+ast::Delete* Parser::parseDeleteFrom() {
     getLogger().trace("Parsing DELETE FROM statement {}");
 
     expectToken(TokenType::KeyDelete, "DELETE statement");
@@ -501,58 +842,131 @@ std::unique_ptr<ast::Delete> Parser::parseDeleteFrom() {
 
     auto token = parseIdentifier("table name");
     auto tableName = token.getString();
-    auto deleteFrom = std::make_unique<ast::Delete>(tableName);
+    auto* deleteFrom = arena_->make<ast::Delete>(tableName);
 
     deleteFrom->where = parseWhere();
 
     return deleteFrom;
 }
 
+/**
+ * Parses the rest of a CREATE INDEX ON <table> (<column>) statement after CREATE.
+ * @throws ParserException if syntax is invalid
+ */
+ast::CreateIndex* Parser::parseCreateIndex() {
+    getLogger().trace("Parsing CREATE INDEX statement");
+
+    expectToken(TokenType::KeyIndex, "INDEX statement");
+    expectToken(TokenType::KeyOn, "ON table");
+    auto table = parseIdentifier("table name");
+    expectToken(TokenType::ParenthesisL, "indexed column");
+    auto column = parseIdentifier("column name");
+    expectToken(TokenType::ParenthesisR, "end of indexed column");
+    return arena_->make<ast::CreateIndex>(table.getString(), column.getString());
+}
+
+/**
+ * Parses the rest of a CREATE MATERIALIZED VIEW <name> AS <select> statement after CREATE.
+ * MATERIALIZED and VIEW are not keywords, so they remain usable as names.
+ * @throws ParserException if syntax is invalid
+ */
+ast::CreateMaterializedView* Parser::parseCreateMaterializedView() {
+    getLogger().trace("Parsing CREATE MATERIALIZED VIEW statement");
+
+    ts.next();
+    auto view = parseIdentifier("VIEW after MATERIALIZED");
+    if (toUpper(view.getString()) != "VIEW") {
+        throw ParserException("Expected VIEW after MATERIALIZED, but got " + view.toString(),
+                              ts.getCurrentLineNumber(), ts.getLinePosition(), ts.getQuery());
+    }
+    auto name = parseIdentifier("view name");
+    expectToken(TokenType::KeyAs, "AS query");
+    return arena_->make<ast::CreateMaterializedView>(name.getString(), parseSelect());
+}
+
+/**
+ * Parses an ANALYZE statement and returns its AST representation.
+ * @throws ParserException if syntax is invalid
+ */
+ast::Analyze* Parser::parseAnalyze() {
+    getLogger().trace("Parsing ANALYZE statement");
+
+    expectToken(TokenType::KeyAnalyze, "ANALYZE statement");
+
+    auto token = parseIdentifier("table name");
+    return arena_->make<ast::Analyze>(token.getString());
+}
+
+ast::Explain* Parser::parseExplain() {
+    getLogger().trace("Parsing EXPLAIN statement");
+
+    expectToken(TokenType::KeyExplain, "EXPLAIN statement");
+
+    bool analyze = ts.peek().type == TokenType::KeyAnalyze;
+    if (analyze) {
+        ts.next();
+    }
+
+    // Only queries have a plan to explain
+    return arena_->make<ast::Explain>(analyze, parseSelect());
+}
+
 /**
  * Parses a query string and returns a unique_ptr to the parsed query AST.
  * @param query The query string to parse.
  * @return A unique_ptr to the parsed query AST.
  */
 std::expected<std::unique_ptr<ast::QueryAST>, std::string> Parser::parseQuery() {
+    tdb_assert(arena_ != nullptr, "A parser parses a single query");
     auto token = ts.peek();
     ast::ASTNode* query{};
 
     try {
         switch (token.type) {
             case TokenType::KeySelect:
-                query = parseSelect().release();
+                query = parseSelect();
                 break;
             case TokenType::KeyInsert:
-                query = parseInsertInto().release();
+                query = parseInsertInto();
                 break;
             case TokenType::KeyDelete:
-                query = parseDeleteFrom().release();
+                query = parseDeleteFrom();
                 break;
             case TokenType::KeyUpdate:
-                query = parseUpdate().release();
+                query = parseUpdate();
                 break;
             case TokenType::KeyCreate:
-                query = parseCreateTable().release();
+                query = parseCreate();
+                break;
+            case TokenType::KeyAnalyze:
+                query = parseAnalyze();
+                break;
+            case TokenType::KeyExplain:
+                query = parseExplain();
                 break;
             default:
                 return std::unexpected("Unsupported query type: " + token.toString());
         }
+        if (ts.peek().type == TokenType::EndOfStatement) {
+            ts.next();
+        }
+        expectToken(TokenType::EndOfFile, "end of query");
     } catch (const ParserException& e) {
         getLogger().info("Query parsing failed: {}", e.what());
         return std::unexpected(e.what());
     }
-    if (ts.peek().type == TokenType::EndOfStatement) {
-        ts.next();
-    }
-
-    expectToken(TokenType::EndOfFile, "end of query");
 
     tdb_assert(query != nullptr, "Query AST should not be null");
-    std::stringstream ss;
-    ss << *query;
-    getLogger().debug("Successfully parsed query: {}", ss.str());
+    // Printing the query costs more than parsing it
+    if (getLogger().should_log(spdlog::level::debug)) {
+        std::stringstream ss;
+        ss << *query;
+        getLogger().debug("Successfully parsed query: {}", ss.str());
+    }
 
-    return std::make_unique<ast::QueryAST>(query);
+    auto ast = std::make_unique<ast::QueryAST>(query, std::move(arena_));
+    ast->parameterCount = parameterCount_;
+    return ast;
 }
 
 }  // namespace parser
@@ -1,5 +1,6 @@
 #include "parser/query_ast.hpp"
 #include <ostream>
+#include <sstream>
 #include "common/assert.hpp"
 
 namespace toydb {
@@ -7,7 +8,14 @@ namespace toydb {
 namespace ast {
 
 std::ostream& Table::print(std::ostream& os) const noexcept {
-    return os << name;
+    os << name;
+    if (sample) {
+        os << " TABLESAMPLE " << toString(sample->method) << " (" << sample->percent << ")";
+        if (sample->seed) {
+            os << " REPEATABLE (" << *sample->seed << ")";
+        }
+    }
+    return os;
 }
 
 std::ostream& TableExpr::print(std::ostream& os) const noexcept {
@@ -22,11 +30,21 @@ std::ostream& TableExpr::print(std::ostream& os) const noexcept {
     }
 }
 
-std::ostream& ColumnRef::print(std::ostream& os) const noexcept {
-    if (!table.empty()) {
-        os << table << ".";
+std::string ColumnRef::getExpressionString() const {
+    if (aggregate == AggregateFunction::COUNT_STAR) {
+        return toString(*aggregate);
     }
-    os << name;
+    std::string column = table.empty() ? name : table + "." + name;
+    if (aggregate == AggregateFunction::APPROX_QUANTILE) {
+        std::ostringstream fraction;
+        fraction << quantile;
+        return toString(*aggregate) + "(" + column + ", " + fraction.str() + ")";
+    }
+    return aggregate ? toString(*aggregate) + "(" + column + ")" : column;
+}
+
+std::ostream& ColumnRef::print(std::ostream& os) const noexcept {
+    os << getExpressionString();
     if (!alias.empty()) {
         os << " AS " << alias;
     }
@@ -53,6 +71,10 @@ std::ostream& ConstantBool::print(std::ostream& os) const noexcept {
     return os << (value ? "TRUE" : "FALSE");
 }
 
+std::ostream& Parameter::print(std::ostream& os) const noexcept {
+    return os << "?";
+}
+
 std::ostream& Condition::print(std::ostream& os) const noexcept {
     if (isUnop()) {
         return os << getOperatorString(op) << " (" << *left << ")";
@@ -61,6 +83,38 @@ std::ostream& Condition::print(std::ostream& os) const noexcept {
     }
 }
 
+std::ostream& Arithmetic::print(std::ostream& os) const noexcept {
+    return os << "(" << *left << " " << toString(op) << " " << *right << ")";
+}
+
+std::ostream& FunctionCall::print(std::ostream& os) const noexcept {
+    os << toString(function) << "(";
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        os << *arguments[i];
+        if (i < arguments.size() - 1)
+            os << ", ";
+    }
+    return os << ")";
+}
+
+/**
+ * @brief The type as spelled in SQL, e.g. in CAST(x AS BIGINT)
+ */
+static std::string getSqlTypeString(DataType type) noexcept {
+    switch (type.getType()) {
+        case DataType::INT32: return "INTEGER";
+        case DataType::INT64: return "BIGINT";
+        case DataType::DOUBLE: return "DOUBLE";
+        case DataType::BOOL: return "BOOL";
+        case DataType::STRING: return "STRING";
+        default: return "UNKNOWN";
+    }
+}
+
+std::ostream& Cast::print(std::ostream& os) const noexcept {
+    return os << "CAST(" << *expression << " AS " << getSqlTypeString(type) << ")";
+}
+
 std::ostream& SelectFrom::print(std::ostream& os) const noexcept {
     tdb_assert(selectAll || columns.size() > 0, "Select node must select at least one column.");
     tdb_assert(tables.size() > 0, "Select node must have at least one table");
@@ -92,13 +146,57 @@ std::ostream& SelectFrom::print(std::ostream& os) const noexcept {
         os << " WHERE " << *where;
     }
 
+    if (!groupBy.empty()) {
+        os << " GROUP BY ";
+        for (size_t i = 0; i < groupBy.size(); ++i) {
+            os << groupBy[i];
+            if (i < groupBy.size() - 1)
+                os << ", ";
+        }
+    }
+
     if (orderBy) {
         os << " ORDER BY " << orderBy.value();
+        if (orderByDescending)
+            os << " DESC";
+    }
+
+    if (limit) {
+        os << " LIMIT " << *limit;
     }
 
     return os;
 }
 
+std::ostream& ASTNode::print(std::ostream& os) const noexcept {
+    switch (kind_) {
+        case NodeKind::TABLE: return static_cast<const Table*>(this)->print(os);
+        case NodeKind::TABLE_EXPR: return static_cast<const TableExpr*>(this)->print(os);
+        case NodeKind::COLUMN_DEFINITION: return static_cast<const ColumnDefinition*>(this)->print(os);
+        case NodeKind::CONSTANT_INT: return static_cast<const ConstantInt*>(this)->print(os);
+        case NodeKind::CONSTANT_DOUBLE: return static_cast<const ConstantDouble*>(this)->print(os);
+        case NodeKind::CONSTANT_STRING: return static_cast<const ConstantString*>(this)->print(os);
+        case NodeKind::CONSTANT_NULL: return static_cast<const ConstantNull*>(this)->print(os);
+        case NodeKind::CONSTANT_BOOL: return static_cast<const ConstantBool*>(this)->print(os);
+        case NodeKind::PARAMETER: return static_cast<const Parameter*>(this)->print(os);
+        case NodeKind::COLUMN_REF: return static_cast<const ColumnRef*>(this)->print(os);
+        case NodeKind::CONDITION: return static_cast<const Condition*>(this)->print(os);
+        case NodeKind::ARITHMETIC: return static_cast<const Arithmetic*>(this)->print(os);
+        case NodeKind::FUNCTION_CALL: return static_cast<const FunctionCall*>(this)->print(os);
+        case NodeKind::CAST: return static_cast<const Cast*>(this)->print(os);
+        case NodeKind::CREATE_TABLE: return static_cast<const CreateTable*>(this)->print(os);
+        case NodeKind::CREATE_INDEX: return static_cast<const CreateIndex*>(this)->print(os);
+        case NodeKind::INSERT: return static_cast<const Insert*>(this)->print(os);
+        case NodeKind::UPDATE: return static_cast<const Update*>(this)->print(os);
+        case NodeKind::DELETE: return static_cast<const Delete*>(this)->print(os);
+        case NodeKind::ANALYZE: return static_cast<const Analyze*>(this)->print(os);
+        case NodeKind::SELECT_FROM: return static_cast<const SelectFrom*>(this)->print(os);
+        case NodeKind::EXPLAIN: return static_cast<const Explain*>(this)->print(os);
+        case NodeKind::CREATE_MATERIALIZED_VIEW: return static_cast<const CreateMaterializedView*>(this)->print(os);
+    }
+    return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const ASTNode& node) {
     return node.print(os);
 }
@@ -130,6 +228,10 @@ std::ostream& CreateTable::print(std::ostream& os) const noexcept {
     return os << ")";
 }
 
+std::ostream& CreateIndex::print(std::ostream& os) const noexcept {
+    return os << "CREATE INDEX ON " << tableName << " (" << columnName << ")";
+}
+
 std::ostream& Insert::print(std::ostream& os) const noexcept {
     os << "INSERT INTO " << tableName;
     if (!columnNames.empty()) {
@@ -175,8 +277,20 @@ std::ostream& Delete::print(std::ostream& os) const noexcept {
     return os;
 }
 
+std::ostream& Analyze::print(std::ostream& os) const noexcept {
+    return os << "ANALYZE " << tableName;
+}
+
+std::ostream& Explain::print(std::ostream& os) const noexcept {
+    return os << (analyze ? "EXPLAIN ANALYZE " : "EXPLAIN ") << *query;
+}
+
+std::ostream& CreateMaterializedView::print(std::ostream& os) const noexcept {
+    return os << "CREATE MATERIALIZED VIEW " << name << " AS " << *query;
+}
+
 std::ostream& operator<<(std::ostream& os, const QueryAST& ast) {
-    return os << ast.query_;
+    return os << *ast.query_;
 }
 
 }  // namespace ast
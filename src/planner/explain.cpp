@@ -0,0 +1,118 @@
+#include "planner/explain.hpp"
+#include <fmt/format.h>
+#include <chrono>
+#include <sstream>
+
+namespace toydb {
+
+static std::string formatDuration(std::chrono::nanoseconds duration) {
+    return fmt::format("{:.3f} ms", std::chrono::duration<double, std::milli>(duration).count());
+}
+
+static std::string formatBytes(size_t bytes) {
+    if (bytes < 1024) {
+        return fmt::format("{} B", bytes);
+    }
+    if (bytes < 1024 * 1024) {
+        return fmt::format("{:.1f} KiB", static_cast<double>(bytes) / 1024);
+    }
+    return fmt::format("{:.1f} MiB", static_cast<double>(bytes) / (1024 * 1024));
+}
+
+/**
+ * Rows in and self time are derived from the profiles of the children. They are left out if a
+ * child has no operator of its own, e.g. a scan with a fused filter.
+ */
+static std::string formatProfile(const LogicalOperator* op, const OperatorProfile& profile,
+                                 const PhysicalQueryPlan& plan) {
+    std::string result;
+    int64_t rowsIn = 0;
+    std::chrono::nanoseconds childTime {0};
+    bool childrenProfiled = op->getChildCount() > 0;
+    for (const auto& child : op->getChildren()) {
+        const OperatorProfile* childProfile = plan.getProfile(child.get());
+        if (!childProfile) {
+            childrenProfiled = false;
+            break;
+        }
+        rowsIn += childProfile->rowsOut;
+        childTime += childProfile->wallTime;
+    }
+
+    if (childrenProfiled) {
+        result += fmt::format("rows in={}, ", rowsIn);
+    }
+    result += fmt::format("rows out={}, batches={}, calls={}, time={}", profile.rowsOut, profile.batches,
+                          profile.calls, formatDuration(profile.wallTime));
+    if (childrenProfiled) {
+        result += fmt::format(" (self {})", formatDuration(profile.wallTime - childTime));
+    }
+    result += fmt::format(", cpu={}", formatDuration(profile.cpuTime));
+    if (profile.bytesAllocated > 0) {
+        result += fmt::format(", allocated={} (peak {})", formatBytes(profile.bytesAllocated),
+                              formatBytes(profile.peakBytes));
+    }
+    if (profile.counters) {
+        const HardwareCounters& counters = *profile.counters;
+        double ipc = counters.cycles > 0 ? static_cast<double>(counters.instructions) / static_cast<double>(counters.cycles) : 0.0;
+        result += fmt::format(", cycles={}, instructions={} (ipc {:.2f}), cache misses={}, branch misses={}",
+                              counters.cycles, counters.instructions, ipc, counters.cacheMisses,
+                              counters.branchMisses);
+    }
+    return result;
+}
+
+static void printOperator(std::ostream& os, const LogicalOperator* op, const PhysicalQueryPlan* profiled,
+                          size_t depth) {
+    if (depth > 0) {
+        os << std::string((depth - 1) * 2, ' ') << "-> ";
+    }
+    op->print(os);
+    if (profiled) {
+        if (const OperatorProfile* profile = profiled->getProfile(op)) {
+            os << "  (" << formatProfile(op, *profile, *profiled) << ")";
+        }
+    }
+    os << '\n';
+
+    for (const auto& child : op->getChildren()) {
+        printOperator(os, child.get(), profiled, depth + 1);
+    }
+}
+
+static std::string explain(const LogicalQueryPlan& plan, const PhysicalQueryPlan* profiled) {
+    std::ostringstream os;
+    if (!plan.hasRoot()) {
+        plan.print(os);
+        os << '\n';
+        return os.str();
+    }
+    printOperator(os, plan.getRoot(), profiled, 0);
+    return os.str();
+}
+
+std::string explainPlan(const LogicalQueryPlan& plan) {
+    return explain(plan, nullptr);
+}
+
+std::string explainPlan(const LogicalQueryPlan& plan, const PhysicalQueryPlan& profiled) {
+    return explain(plan, &profiled);
+}
+
+std::string explainAnalyze(const LogicalQueryPlan& plan, const PhysicalPlanner& planner) {
+    PhysicalPlanner profilingPlanner = planner;
+    profilingPlanner.setProfiling(true);
+    PhysicalQueryPlan physicalPlan = profilingPlanner.plan(plan);
+    if (!physicalPlan.hasRoot()) {
+        return explainPlan(plan);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t rowCount = physicalPlan.run();
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    return explainPlan(plan, physicalPlan) +
+           fmt::format("Execution: {} rows in {}\n", rowCount, formatDuration(duration));
+}
+
+}  // namespace toydb
@@ -1,12 +1,63 @@
 #include "planner/interpreter.hpp"
 #include "engine/predicate_expr.hpp"
+#include "engine/value_expr.hpp"
 #include "common/errors.hpp"
 #include "common/logging.hpp"
 #include "storage/catalog.hpp"
+#include "storage/table_handle.hpp"
+#include <algorithm>
 #include <cctype>
+#include <iterator>
+#include <limits>
 
 namespace toydb {
 
+std::optional<TableMetadata> CatalogQueryAdapter::getTable(const std::string& name) {
+    auto tableId = catalog_->getTableIdByName(name);
+    if (!tableId) {
+        return std::nullopt;
+    }
+    auto handle = catalog_->getTableHandle(*tableId);
+    if (!handle) {
+        return std::nullopt;
+    }
+
+    TableMetadata meta;
+    meta.name = name;
+    meta.id = *tableId;
+    meta.format = (*handle)->getFormat();
+    meta.files = (*handle)->getFiles();
+    for (const ColumnMetadata& column : (*handle)->getSchema()) {
+        auto colId = catalog_->resolveColumn(*tableId, column.name);
+        if (!colId) {
+            return std::nullopt;
+        }
+        meta.schema.addColumn(*colId, column);
+        meta.column_map[column.name] = *colId;
+    }
+    return meta;
+}
+
+std::optional<ColumnId> CatalogQueryAdapter::resolveColumn(const std::string& tableName, const std::string& columnName) {
+    auto tableId = catalog_->getTableIdByName(tableName);
+    if (!tableId) {
+        return std::nullopt;
+    }
+    auto colId = catalog_->resolveColumn(*tableId, columnName);
+    if (!colId) {
+        return std::nullopt;
+    }
+    return *colId;
+}
+
+DataType CatalogQueryAdapter::getColumnType(const ColumnId& columnId) {
+    auto type = catalog_->getColumnType(columnId);
+    if (!type) {
+        throw UnresolvedColumnException("Column '" + columnId.getName() + "' not found");
+    }
+    return *type;
+}
+
 static QueryContext buildSelectContext(const ast::SelectFrom& selectFrom, PlaceholderCatalog* catalog) {
     QueryContext context;
 
@@ -86,38 +137,65 @@ ColumnId SQLInterpreter::resolveColumnRef(const ast::ColumnRef& columnRef, const
 }
 
 std::unique_ptr<PredicateExpr> SQLInterpreter::lowerConstant(const ast::Constant* constant) {
-    if (auto* constInt = dynamic_cast<const ast::ConstantInt*>(constant)) {
-        DataType type = constInt->isInt64 ? DataType::getInt64() : DataType::getInt32();
-        return std::make_unique<ConstantExpr>(type, constInt->value);
-    } else if (auto* constDouble = dynamic_cast<const ast::ConstantDouble*>(constant)) {
-        return std::make_unique<ConstantExpr>(DataType::getDouble(), constDouble->value);
-    } else if (auto* constString = dynamic_cast<const ast::ConstantString*>(constant)) {
-        return std::make_unique<ConstantExpr>(DataType::getString(), constString->value);
-    } else if (dynamic_cast<const ast::ConstantNull*>(constant)) {
-        return std::make_unique<ConstantExpr>(DataType::getNullConst());
-    } else if (auto* constBool = dynamic_cast<const ast::ConstantBool*>(constant)) {
-        // Booleans are ints of size 1
-        return std::make_unique<ConstantExpr>(DataType::getBool(), constBool->value);
-    } else {
-        throw InternalSQLError("Unknown constant type");
+    switch (constant->getKind()) {
+        case ast::NodeKind::CONSTANT_INT: {
+            const auto* constInt = static_cast<const ast::ConstantInt*>(constant);
+            DataType type = constInt->isInt64 ? DataType::getInt64() : DataType::getInt32();
+            return std::make_unique<ConstantExpr>(type, constInt->value);
+        }
+        case ast::NodeKind::CONSTANT_DOUBLE:
+            return std::make_unique<ConstantExpr>(DataType::getDouble(),
+                                                  static_cast<const ast::ConstantDouble*>(constant)->value);
+        case ast::NodeKind::CONSTANT_STRING:
+            return std::make_unique<ConstantExpr>(DataType::getString(),
+                                                  static_cast<const ast::ConstantString*>(constant)->value);
+        case ast::NodeKind::CONSTANT_NULL:
+            return std::make_unique<ConstantExpr>(DataType::getNullConst());
+        case ast::NodeKind::CONSTANT_BOOL:
+            // Booleans are ints of size 1
+            return std::make_unique<ConstantExpr>(DataType::getBool(),
+                                                  static_cast<const ast::ConstantBool*>(constant)->value);
+        default:
+            throw InternalSQLError("Unknown constant type");
     }
 }
 
+std::unique_ptr<PredicateExpr> SQLInterpreter::lowerParameter(const ast::Parameter& parameter,
+                                                             const PredicateExpr* other) {
+    if (auto* columnRef = dynamic_cast<const ColumnRefExpr*>(other)) {
+        return ConstantExpr::parameter(parameter.index, columnRef->getType());
+    } else if (auto* constant = dynamic_cast<const ConstantExpr*>(other); constant && !constant->isNull()) {
+        return ConstantExpr::parameter(parameter.index, constant->getType());
+    }
+    throw InternalSQLError("Parameters must be compared with a column or a constant");
+}
+
 // Helper to convert AST Expression to PredicateExpr
 std::unique_ptr<PredicateExpr> SQLInterpreter::lowerPredicate(const ast::Expression* expr, const QueryContext& context) {
-    if (auto* columnRef = dynamic_cast<const ast::ColumnRef*>(expr)) {
-        ColumnId colId = resolveColumnRef(*columnRef, context);
-        auto colType = catalog_->getColumnType(colId);
-        return std::make_unique<ColumnRefExpr>(colId, colType);
-    } else if (auto* constant = dynamic_cast<const ast::Constant*>(expr)) {
-        if (auto* constString = dynamic_cast<const ast::ConstantString*>(constant)) {
-            throw UnresolvedColumnException("Unexpected string literal in predicate: " + constString->value);
-        }
-        return lowerConstant(constant);
-    } else if (auto* condition = dynamic_cast<const ast::Condition*>(expr)) {
-        return lowerCondition(condition, context);
-    } else {
-        throw InternalSQLError("Unsupported expression type in WHERE clause");
+    switch (expr->getKind()) {
+        case ast::NodeKind::COLUMN_REF: {
+            const auto* columnRef = static_cast<const ast::ColumnRef*>(expr);
+            if (columnRef->isAggregate()) {
+                throw InternalSQLError("Aggregates are not allowed in WHERE: " + columnRef->getExpressionString());
+            }
+            ColumnId colId = resolveColumnRef(*columnRef, context);
+            auto colType = catalog_->getColumnType(colId);
+            return std::make_unique<ColumnRefExpr>(colId, colType);
+        }
+        case ast::NodeKind::CONSTANT_STRING:
+            throw UnresolvedColumnException("Unexpected string literal in predicate: " +
+                                            static_cast<const ast::ConstantString*>(expr)->value);
+        case ast::NodeKind::CONSTANT_INT:
+        case ast::NodeKind::CONSTANT_DOUBLE:
+        case ast::NodeKind::CONSTANT_NULL:
+        case ast::NodeKind::CONSTANT_BOOL:
+            return lowerConstant(static_cast<const ast::Constant*>(expr));
+        case ast::NodeKind::CONDITION:
+            return lowerCondition(static_cast<const ast::Condition*>(expr), context);
+        case ast::NodeKind::PARAMETER:
+            throw InternalSQLError("Parameters must be compared with a column or a constant");
+        default:
+            throw InternalSQLError("Unsupported expression type in WHERE clause");
     }
 }
 
@@ -156,10 +234,25 @@ std::unique_ptr<PredicateExpr> SQLInterpreter::lowerCondition(const ast::Conditi
     }
 
     // Binary operator
-    auto left = lowerPredicate(condition->left.get(), context);
-    auto right = lowerPredicate(condition->right.get(), context);
+    auto* leftParameter = ast::as<ast::Parameter>(condition->left);
+    auto* rightParameter = ast::as<ast::Parameter>(condition->right);
+    bool isLogical = condition->op == CompareOp::AND || condition->op == CompareOp::OR;
+    if (isLogical || (leftParameter && rightParameter)) {
+        leftParameter = nullptr;
+        rightParameter = nullptr;
+    }
+
+    auto left = leftParameter ? nullptr : lowerPredicate(condition->left, context);
+    auto right = rightParameter ? nullptr : lowerPredicate(condition->right, context);
 
-    if (condition->op == CompareOp::AND || condition->op == CompareOp::OR) {
+    // A parameter is compared as the type of the other operand
+    if (leftParameter) {
+        left = lowerParameter(*leftParameter, right.get());
+    } else if (rightParameter) {
+        right = lowerParameter(*rightParameter, left.get());
+    }
+
+    if (isLogical) {
         return std::make_unique<LogicalExpr>(condition->op, std::move(left), std::move(right));
     } else {
         // Comparison operator
@@ -201,6 +294,191 @@ std::unique_ptr<PredicateExpr> SQLInterpreter::lowerCondition(const ast::Conditi
     }
 }
 
+std::unique_ptr<ValueExpr> SQLInterpreter::lowerValue(const ast::Expression* expr, const QueryContext& context) {
+    switch (expr->getKind()) {
+        case ast::NodeKind::COLUMN_REF: {
+            const auto* columnRef = static_cast<const ast::ColumnRef*>(expr);
+            if (columnRef->isAggregate()) {
+                throw NotYetImplementedError("Aggregates in expressions");
+            }
+            ColumnId colId = resolveColumnRef(*columnRef, context);
+            return std::make_unique<ColumnValueExpr>(colId, catalog_->getColumnType(colId));
+        }
+        case ast::NodeKind::CONSTANT_INT: {
+            const auto* constInt = static_cast<const ast::ConstantInt*>(expr);
+            DataType type = constInt->isInt64 ? DataType::getInt64() : DataType::getInt32();
+            return std::make_unique<ConstantValueExpr>(type, constInt->value);
+        }
+        case ast::NodeKind::CONSTANT_DOUBLE:
+            return std::make_unique<ConstantValueExpr>(DataType::getDouble(),
+                                                       static_cast<const ast::ConstantDouble*>(expr)->value);
+        case ast::NodeKind::CONSTANT_STRING:
+            return std::make_unique<ConstantValueExpr>(DataType::getString(),
+                                                       static_cast<const ast::ConstantString*>(expr)->value);
+        case ast::NodeKind::CONSTANT_BOOL:
+            return std::make_unique<ConstantValueExpr>(DataType::getBool(),
+                                                       static_cast<const ast::ConstantBool*>(expr)->value);
+        case ast::NodeKind::CONSTANT_NULL:
+            return std::make_unique<ConstantValueExpr>();
+        case ast::NodeKind::ARITHMETIC: {
+            const auto* arithmetic = static_cast<const ast::Arithmetic*>(expr);
+            auto left = lowerValue(arithmetic->left, context);
+            auto right = lowerValue(arithmetic->right, context);
+            // NULL takes the type of the other operand
+            DataType leftType = left->getType() == DataType::getNullConst() ? right->getType() : left->getType();
+            DataType rightType = right->getType() == DataType::getNullConst() ? left->getType() : right->getType();
+            if (leftType == DataType::getNullConst()) {
+                leftType = rightType = DataType::getInt64();
+            }
+            for (DataType type : {leftType, rightType}) {
+                if (type == DataType::getBool() || type == DataType::getString()) {
+                    throw InternalSQLError("Operator " + toString(arithmetic->op) + " is not defined for " +
+                                           type.toString());
+                }
+            }
+            DataType type = getCommonType(leftType, rightType);
+            return std::make_unique<ArithmeticExpr>(arithmetic->op, makeCast(std::move(left), type),
+                                                    makeCast(std::move(right), type));
+        }
+        case ast::NodeKind::FUNCTION_CALL: {
+            const auto* call = static_cast<const ast::FunctionCall*>(expr);
+            std::vector<std::unique_ptr<ValueExpr>> arguments;
+            for (size_t i = 0; i < call->arguments.size(); ++i) {
+                auto argument = lowerValue(call->arguments[i], context);
+                // CONCAT converts its arguments to strings, the positions of SUBSTR are widened
+                DataType argumentType = argument->getType();
+                bool isPosition = call->function == ScalarFunction::SUBSTR && i > 0;
+                if (call->function == ScalarFunction::CONCAT || argumentType == DataType::getNullConst() ||
+                    (isPosition && argumentType == DataType::getInt32())) {
+                    argument = makeCast(std::move(argument), isPosition ? DataType::getInt64() : DataType::getString());
+                }
+                arguments.push_back(std::move(argument));
+            }
+            return std::make_unique<FunctionExpr>(call->function, std::move(arguments));
+        }
+        case ast::NodeKind::CAST: {
+            const auto* cast = static_cast<const ast::Cast*>(expr);
+            return makeCast(lowerValue(cast->expression, context), cast->type);
+        }
+        case ast::NodeKind::CONDITION:
+            throw NotYetImplementedError("Comparisons in expressions");
+        case ast::NodeKind::PARAMETER:
+            throw NotYetImplementedError("Parameters in expressions");
+        default:
+            throw InternalSQLError("Unsupported expression type");
+    }
+}
+
+/**
+ * Builds the AggregateOp of a query with aggregate calls or a GROUP BY clause on top of its input.
+ * Every selected column must either be an aggregate or one of the group columns.
+ * @param outputColumns Receives the columns of the aggregate's output in the order they were selected
+ */
+std::shared_ptr<LogicalOperator> SQLInterpreter::lowerAggregation(const ast::SelectFrom& selectFrom,
+                                                                  const QueryContext& context,
+                                                                  std::shared_ptr<LogicalOperator> input,
+                                                                  std::vector<ColumnId>& outputColumns) {
+    if (selectFrom.selectAll) {
+        throw InternalSQLError("SELECT * cannot be used with GROUP BY");
+    }
+
+    std::vector<ColumnDescriptor> groupBy;
+    for (const auto& col : selectFrom.groupBy) {
+        ColumnId colId = resolveColumnRef(col, context);
+        groupBy.push_back({colId, catalog_->getColumnType(colId)});
+    }
+
+    std::vector<AggregateSpec> aggregates;
+    // Computed arguments of aggregates, e.g. price * quantity of SUM(price * quantity)
+    std::vector<ColumnId> computedColumns;
+    std::vector<std::unique_ptr<ValueExpr>> computedExpressions;
+    for (const auto& col : selectFrom.columns) {
+        if (!col.isAggregate() && col.isComputed()) {
+            throw NotYetImplementedError("Expressions with GROUP BY or aggregates: " + col.name);
+        }
+        if (!col.isAggregate()) {
+            ColumnId colId = resolveColumnRef(col, context);
+            bool grouped = std::any_of(groupBy.begin(), groupBy.end(),
+                                       [&](const ColumnDescriptor& key) { return key.columnId == colId; });
+            if (!grouped) {
+                throw UnresolvedColumnException("Column '" + col.getExpressionString() +
+                                                "' must appear in GROUP BY or be used in an aggregate");
+            }
+            outputColumns.push_back(colId);
+            continue;
+        }
+
+        AggregateSpec spec {*col.aggregate, ColumnId(), DataType::getInt64(), ColumnId(), col.quantile};
+        if (col.isComputed()) {
+            auto expression = lowerValue(col.expression, context);
+            if (expression->getType() == DataType::getNullConst()) {
+                throw InternalSQLError("Argument of " + col.getExpressionString() + " has no type");
+            }
+            spec.input = ColumnId(ProjectionOp::OUTPUT_COLUMN_ID_BASE + computedColumns.size(), col.name);
+            spec.inputType = expression->getType();
+            computedColumns.push_back(spec.input);
+            computedExpressions.push_back(std::move(expression));
+        } else if (spec.function != AggregateFunction::COUNT_STAR) {
+            spec.input = resolveColumnRef(col, context);
+            spec.inputType = catalog_->getColumnType(spec.input);
+        }
+        std::string name = col.alias.empty() ? col.getExpressionString() : col.alias;
+        spec.output = ColumnId(AggregateOp::OUTPUT_COLUMN_ID_BASE + aggregates.size(), name);
+        // Rejects e.g. SUM over strings
+        spec.getResultType();
+
+        outputColumns.push_back(spec.output);
+        aggregates.push_back(std::move(spec));
+    }
+
+    // The arguments are computed below the aggregation, next to the columns of its input
+    if (!computedColumns.empty()) {
+        std::vector<ColumnId> columns = getOutputColumnList(input.get());
+        std::vector<std::unique_ptr<ValueExpr>> expressions(columns.size());
+        columns.insert(columns.end(), computedColumns.begin(), computedColumns.end());
+        std::move(computedExpressions.begin(), computedExpressions.end(), std::back_inserter(expressions));
+        auto projectionOp = std::make_shared<ProjectionOp>(std::move(columns), std::move(expressions));
+        projectionOp->addChild(input);
+        input = projectionOp;
+    }
+
+    auto aggregateOp = std::make_shared<AggregateOp>(std::move(groupBy), std::move(aggregates));
+    aggregateOp->addChild(input);
+    return aggregateOp;
+}
+
+/**
+ * Resolves the ORDER BY column. Above an aggregation, it must name a group column or the
+ * alias of an aggregate.
+ */
+SortKey SQLInterpreter::lowerOrderBy(const ast::SelectFrom& selectFrom, const QueryContext& context,
+                                     const AggregateOp* aggregateOp) {
+    const ast::ColumnRef& orderBy = *selectFrom.orderBy;
+    bool ascending = !selectFrom.orderByDescending;
+
+    if (!aggregateOp) {
+        ColumnId colId = resolveColumnRef(orderBy, context);
+        return {colId, catalog_->getColumnType(colId), ascending};
+    }
+
+    if (!orderBy.isQualified()) {
+        for (const AggregateSpec& spec : aggregateOp->getAggregates()) {
+            if (spec.output.getName() == orderBy.name) {
+                return {spec.output, spec.getResultType(), ascending};
+            }
+        }
+    }
+
+    ColumnId colId = resolveColumnRef(orderBy, context);
+    for (const ColumnDescriptor& key : aggregateOp->getGroupBy()) {
+        if (key.columnId == colId) {
+            return {key.columnId, key.type, ascending};
+        }
+    }
+    throw UnresolvedColumnException("ORDER BY column '" + orderBy.getExpressionString() +
+                                    "' must appear in GROUP BY or name an aggregate");
+}
+
 std::optional<LogicalQueryPlan> SQLInterpreter::interpret(const ast::QueryAST& ast) {
     if (!ast.query_) {
         Logger::error("Interpretation failed: AST query node is null");
@@ -208,20 +486,25 @@ std::optional<LogicalQueryPlan> SQLInterpreter::interpret(const ast::QueryAST& a
     }
 
     // Dispatch based on AST node type
+    const ast::ASTNode* query = ast.query_;
     try {
-        if (auto* selectFrom = dynamic_cast<const ast::SelectFrom*>(ast.query_.get())) {
-            return handleSelectFrom(*selectFrom);
-        } else if (auto* createTable = dynamic_cast<const ast::CreateTable*>(ast.query_.get())) {
-            return handleCreateTable(*createTable);
-        } else if (auto* insert = dynamic_cast<const ast::Insert*>(ast.query_.get())) {
-            return handleInsert(*insert);
-        } else if (auto* update = dynamic_cast<const ast::Update*>(ast.query_.get())) {
-            return handleUpdate(*update);
-        } else if (auto* deleteStmt = dynamic_cast<const ast::Delete*>(ast.query_.get())) {
-            return handleDelete(*deleteStmt);
-        } else {
-            Logger::error("Could not execute query: Unknown AST node type");
-            return std::nullopt;
+        switch (query->getKind()) {
+            case ast::NodeKind::SELECT_FROM:
+                return handleSelectFrom(*static_cast<const ast::SelectFrom*>(query));
+            case ast::NodeKind::CREATE_TABLE:
+                return handleCreateTable(*static_cast<const ast::CreateTable*>(query));
+            case ast::NodeKind::INSERT:
+                throw InternalSQLError("INSERT has no query plan");
+            case ast::NodeKind::UPDATE:
+                return handleUpdate(*static_cast<const ast::Update*>(query));
+            case ast::NodeKind::DELETE:
+                return handleDelete(*static_cast<const ast::Delete*>(query));
+            case ast::NodeKind::EXPLAIN:
+                // The plan of the explained query, the caller prints it instead of the result
+                return handleSelectFrom(*static_cast<const ast::Explain*>(query)->query);
+            default:
+                Logger::error("Could not execute query: Unknown AST node type");
+                return std::nullopt;
         }
     } catch (const std::exception& e) {
         Logger::error("Could not execute query: {}", e.what());
@@ -238,59 +521,220 @@ LogicalQueryPlan SQLInterpreter::handleSelectFrom(const ast::SelectFrom& selectF
         throw InternalSQLError("SELECT query must have at least one table");
     }
 
-    if (selectFrom.tables.size() > 1) {
-        // TODO: Implement joins
-        throw NotYetImplementedError("Multiple tables (joins)");
-    }
-
     QueryContext context = buildSelectContext(selectFrom, catalog_);
+    if (context.tables.size() != selectFrom.tables.size()) {
+        // Columns are resolved by table, both sides of a self join would get the same ids
+        throw NotYetImplementedError("Self joins");
+    }
 
-    // Collect all columns for TableScanOp
-    std::vector<ColumnId> scanColumns;
-    for (const auto& [_, tableMeta] : context.tables) {
-        const auto& columnIds = tableMeta.schema.getColumnIds();
-        for (const auto& colId : columnIds) {
-            scanColumns.push_back(colId);
+    // One scan per table in FROM order, combined with cross products. The join order optimizer
+    // turns them into joins with the WHERE conjuncts and reorders them.
+    std::shared_ptr<LogicalOperator> current;
+    for (const auto& tableExpr : selectFrom.tables) {
+        const TableMetadata& tableMeta = context.tables.at(tableExpr.table.name);
+        auto tableScanOp = std::make_shared<TableScanOp>(tableMeta.schema.getColumnIds(), tableExpr.table.sample);
+        if (!current) {
+            current = tableScanOp;
+            continue;
         }
+        auto crossProductOp = std::make_shared<CrossProductOp>();
+        crossProductOp->addChild(current);
+        crossProductOp->addChild(tableScanOp);
+        current = crossProductOp;
     }
 
-    // Create TableScanOp as the base of the query plan
-    auto tableScanOp = std::make_shared<TableScanOp>(std::move(scanColumns));
-    std::shared_ptr<LogicalOperator> current = tableScanOp;
-
     // Add filter if WHERE clause exists
     if (selectFrom.where) {
-        auto predicate = lowerPredicate(selectFrom.where.get(), context);
+        auto predicate = lowerPredicate(selectFrom.where, context);
         auto filterOp = std::make_shared<FilterOp>(std::move(predicate));
         filterOp->addChild(current);
         current = filterOp;
     }
 
+    // Add aggregation if the query has aggregate calls or a GROUP BY clause
+    std::vector<ColumnId> projectionColumns;
+    // Expressions of computed columns, nullptr for columns of the input
+    std::vector<std::unique_ptr<ValueExpr>> projectionExpressions;
+    const AggregateOp* aggregateOp = nullptr;
+    bool hasAggregates = std::any_of(selectFrom.columns.begin(), selectFrom.columns.end(),
+                                     [](const ast::ColumnRef& col) { return col.isAggregate(); });
+    if (hasAggregates || !selectFrom.groupBy.empty()) {
+        current = lowerAggregation(selectFrom, context, current, projectionColumns);
+        aggregateOp = static_cast<const AggregateOp*>(current.get());
+    } else if (!selectFrom.selectAll) {
+        for (size_t i = 0; i < selectFrom.columns.size(); ++i) {
+            const ast::ColumnRef& col = selectFrom.columns[i];
+            if (!col.isComputed()) {
+                projectionColumns.push_back(resolveColumnRef(col, context));
+                projectionExpressions.push_back(nullptr);
+                continue;
+            }
+            auto expression = lowerValue(col.expression, context);
+            if (expression->getType() == DataType::getNullConst()) {
+                throw InternalSQLError("Type of " + col.name + " is unknown, use CAST(NULL AS <type>)");
+            }
+            std::string name = col.alias.empty() ? col.name : col.alias;
+            projectionColumns.emplace_back(ProjectionOp::OUTPUT_COLUMN_ID_BASE + i, name);
+            projectionExpressions.push_back(std::move(expression));
+        }
+    }
+
+    // Sort below the projection, the sort column does not need to be selected. A sort followed
+    // by a limit becomes a top-n, which does not need to sort its whole input.
+    if (selectFrom.orderBy) {
+        std::vector<SortKey> keys {lowerOrderBy(selectFrom, context, aggregateOp)};
+        std::shared_ptr<LogicalOperator> sortOp;
+        if (selectFrom.limit) {
+            sortOp = std::make_shared<TopNOp>(std::move(keys), *selectFrom.limit);
+        } else {
+            sortOp = std::make_shared<SortOp>(std::move(keys));
+        }
+        sortOp->addChild(current);
+        current = sortOp;
+    } else if (selectFrom.limit) {
+        auto limitOp = std::make_shared<LimitOp>(*selectFrom.limit);
+        limitOp->addChild(current);
+        current = limitOp;
+    }
+
+    LogicalQueryPlan plan;
     if (selectFrom.selectAll) {
-        LogicalQueryPlan plan;
         plan.setRoot(current);
         return plan;
     }
 
     // Add projection for selected columns
-    std::vector<ColumnId> projectionColumns;
-    for (const auto& col : selectFrom.columns) {
-        try {
-            ColumnId colId = resolveColumnRef(col, context);
-            projectionColumns.push_back(colId);
-        } catch (const std::exception& e) {
-            Logger::error("Interpretation failed: {}", e.what());
-            throw;
+    bool computed = std::any_of(projectionExpressions.begin(), projectionExpressions.end(),
+                                [](const auto& expression) { return expression != nullptr; });
+    auto projectionOp = computed
+        ? std::make_shared<ProjectionOp>(std::move(projectionColumns), std::move(projectionExpressions))
+        : std::make_shared<ProjectionOp>(std::move(projectionColumns));
+    projectionOp->addChild(current);
+    plan.setRoot(projectionOp);
+
+    return plan;
+}
+
+/**
+ * @brief Write a value of an INSERT into its column, converting integers to wider types
+ */
+static void writeInsertValue(ColumnBuffer& column, int64_t row, const ast::Expression* value,
+                             const ColumnMetadata& meta) {
+    auto mismatch = [&meta]() {
+        return SQLRuntimeException("Value does not match type " + meta.type.toString() + " of column '" +
+                                   meta.name + "'");
+    };
+
+    switch (value->getKind()) {
+        case ast::NodeKind::CONSTANT_NULL:
+            if (!meta.nullable) {
+                throw SQLRuntimeException("Column '" + meta.name + "' is not nullable");
+            }
+            column.setNull(row);
+            return;
+        case ast::NodeKind::CONSTANT_INT: {
+            int64_t intValue = static_cast<const ast::ConstantInt*>(value)->value;
+            if (meta.type == DataType::getInt32()) {
+                if (intValue < std::numeric_limits<db_int32>::min() || intValue > std::numeric_limits<db_int32>::max()) {
+                    throw SQLRuntimeException("Value out of range for column '" + meta.name + "'");
+                }
+                column.writeEntry<db_int32>(row, static_cast<db_int32>(intValue));
+            } else if (meta.type == DataType::getInt64()) {
+                column.writeEntry<db_int64>(row, intValue);
+            } else if (meta.type == DataType::getDouble()) {
+                column.writeEntry<db_double>(row, static_cast<db_double>(intValue));
+            } else {
+                throw mismatch();
+            }
+            return;
         }
+        case ast::NodeKind::CONSTANT_DOUBLE:
+            if (meta.type != DataType::getDouble()) {
+                throw mismatch();
+            }
+            column.writeEntry<db_double>(row, static_cast<const ast::ConstantDouble*>(value)->value);
+            return;
+        case ast::NodeKind::CONSTANT_BOOL:
+            if (meta.type != DataType::getBool()) {
+                throw mismatch();
+            }
+            column.writeEntry<db_bool>(row, static_cast<const ast::ConstantBool*>(value)->value);
+            return;
+        case ast::NodeKind::CONSTANT_STRING:
+            if (meta.type != DataType::getString()) {
+                throw mismatch();
+            }
+            column.writeString(row, static_cast<const ast::ConstantString*>(value)->value);
+            return;
+        case ast::NodeKind::PARAMETER:
+            throw NotYetImplementedError("Parameters in INSERT");
+        default:
+            throw NotYetImplementedError("Expressions in INSERT");
     }
+}
 
-    auto projectionOp = std::make_shared<ProjectionOp>(std::move(projectionColumns));
-    projectionOp->addChild(current);
+InsertBatches SQLInterpreter::handleInsert(const ast::Insert& insert, BatchAllocator& allocator) {
+    auto table = catalog_->getTable(insert.tableName);
+    if (!table) {
+        throw UnresolvedColumnException("Table '" + insert.tableName + "' not found");
+    }
 
-    LogicalQueryPlan plan;
-    plan.setRoot(projectionOp);
+    std::vector<ColumnId> columnIds = table->schema.getColumnIds();
+    std::vector<ColumnDescriptor> descriptors;
+    std::vector<ColumnMetadata> columns;
+    for (const ColumnId& columnId : columnIds) {
+        ColumnMetadata meta = *table->schema.getColumn(columnId);
+        descriptors.push_back({columnId, meta.type});
+        columns.push_back(std::move(meta));
+    }
 
-    return plan;
+    // Index of the table column of every value of a row, -1 for columns without a value
+    std::vector<int64_t> valueIndex(columnIds.size(), -1);
+    if (insert.columnNames.empty()) {
+        for (size_t i = 0; i < columnIds.size(); ++i) {
+            valueIndex[i] = static_cast<int64_t>(i);
+        }
+    } else {
+        for (size_t i = 0; i < insert.columnNames.size(); ++i) {
+            auto it = table->column_map.find(insert.columnNames[i]);
+            if (it == table->column_map.end()) {
+                throw UnresolvedColumnException("Column '" + insert.columnNames[i] + "' not found in table '" +
+                                                insert.tableName + "'");
+            }
+            auto column = std::find(columnIds.begin(), columnIds.end(), it->second) - columnIds.begin();
+            if (valueIndex[static_cast<size_t>(column)] != -1) {
+                throw SQLRuntimeException("Column '" + insert.columnNames[i] + "' is listed twice");
+            }
+            valueIndex[static_cast<size_t>(column)] = static_cast<int64_t>(i);
+        }
+    }
+    size_t valueCount = insert.columnNames.empty() ? columnIds.size() : insert.columnNames.size();
+
+    InsertBatches result{table->id, {}};
+    auto schema = BatchSchema::make(descriptors);
+    int64_t batchRows = BatchAllocator::rowsPerBuffer(descriptors);
+    ast::ConstantNull null;
+    for (size_t first = 0; first < insert.values.size(); first += static_cast<size_t>(batchRows)) {
+        int64_t rowCount = std::min<int64_t>(batchRows, static_cast<int64_t>(insert.values.size() - first));
+        RowVector batch = allocator.allocateBatch(schema);
+        for (int64_t row = 0; row < rowCount; ++row) {
+            const auto& values = insert.values[first + static_cast<size_t>(row)];
+            if (values.size() != valueCount) {
+                throw SQLRuntimeException("INSERT has " + std::to_string(values.size()) + " values for " +
+                                          std::to_string(valueCount) + " columns");
+            }
+            for (size_t i = 0; i < columns.size(); ++i) {
+                const ast::Expression* value = valueIndex[i] == -1 ? &null : values[static_cast<size_t>(valueIndex[i])];
+                writeInsertValue(batch.getColumn(static_cast<int64_t>(i)), row, value, columns[i]);
+            }
+        }
+        for (int64_t i = 0; i < batch.getColumnCount(); ++i) {
+            batch.getColumn(i).count = rowCount;
+        }
+        batch.setRowCount(rowCount);
+        result.batches.push_back(std::move(batch));
+    }
+    return result;
 }
 
 
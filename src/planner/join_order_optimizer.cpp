@@ -0,0 +1,618 @@
+#include "planner/join_order_optimizer.hpp"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <utility>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/compare_kernels.hpp"
+
+namespace toydb {
+
+// Selectivities assumed when the statistics can't tell
+static constexpr double EQUALITY_SELECTIVITY = 0.1;
+static constexpr double RANGE_SELECTIVITY = 1.0 / 3.0;
+static constexpr double DEFAULT_SELECTIVITY = 0.5;
+
+// Bitmask of the relations of a join region
+using RelationSet = uint64_t;
+
+static RelationSet relationBit(size_t index) {
+    return RelationSet{1} << index;
+}
+
+static bool isJoinNode(const LogicalOperator* op) {
+    if (dynamic_cast<const CrossProductOp*>(op)) {
+        return true;
+    }
+    auto* join = dynamic_cast<const JoinOp*>(op);
+    return join && (join->getJoinType() == JoinType::INNER || join->getJoinType() == JoinType::CROSS);
+}
+
+// A join region starts at the filters above its topmost join
+static bool isJoinRegion(const LogicalOperator* op) {
+    while (dynamic_cast<const FilterOp*>(op)) {
+        op = op->getChild(0).get();
+    }
+    return isJoinNode(op);
+}
+
+/**
+ * @brief Fraction of the non-null values of a column for which `column op constant` holds, from
+ *        the column's histogram or its [min, max] range
+ * @return nullopt if the column or the constant is not numeric
+ */
+static std::optional<double> rangeFraction(CompareOp op, const ColumnStatistics& stats, const ConstantExpr& constant) {
+    bool statsIsDouble = stats.type == DataType::getDouble();
+    if (!stats.hasMinMax || (!statsIsDouble && !kernels::isIntegralType(stats.type))) {
+        return std::nullopt;
+    }
+
+    double value;
+    if (constant.getType() == DataType::getDouble()) {
+        value = constant.getDoubleValue();
+    } else if (constant.getType() == DataType::getInt32() || constant.getType() == DataType::getInt64()) {
+        value = static_cast<double>(constant.getIntValue());
+    } else {
+        return std::nullopt;
+    }
+
+    double min = statsIsDouble ? stats.doubleMin : static_cast<double>(stats.intMin);
+    double max = statsIsDouble ? stats.doubleMax : static_cast<double>(stats.intMax);
+    if (max <= min) {
+        // A single value, which matches or the statistics would have ruled the comparison out
+        return 1.0;
+    }
+
+    // Without a histogram the values are assumed to be uniform
+    double below = stats.fractionBelow(value).value_or(std::clamp((value - min) / (max - min), 0.0, 1.0));
+    switch (op) {
+        case CompareOp::LESS:
+        case CompareOp::LESS_EQUAL:
+            return below;
+        case CompareOp::GREATER:
+        case CompareOp::GREATER_EQUAL:
+            return 1.0 - below;
+        default:
+            return std::nullopt;
+    }
+}
+
+static double defaultSelectivity(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQUAL:
+            return EQUALITY_SELECTIVITY;
+        case CompareOp::NOT_EQUAL:
+            return 1.0 - EQUALITY_SELECTIVITY;
+        default:
+            return RANGE_SELECTIVITY;
+    }
+}
+
+/**
+ * @brief The relations and conjuncts of a join region, and the search for its join order
+ */
+struct JoinOrderOptimizer::JoinRegion {
+    struct Relation {
+        std::shared_ptr<LogicalOperator> op;
+        double cardinality;
+    };
+
+    struct Conjunct {
+        std::unique_ptr<PredicateExpr> predicate;
+        // Relations the conjunct references columns of. Empty if it references none or a column
+        // the relations don't produce, it is then applied above the region.
+        RelationSet relations = 0;
+        double selectivity = 1.0;
+        bool applied = false;
+    };
+
+    // The two inputs of the join that produces a set of relations
+    using Splits = std::unordered_map<RelationSet, std::pair<RelationSet, RelationSet>>;
+
+    std::vector<Relation> relations;
+    std::vector<Conjunct> conjuncts;
+    std::unordered_map<ColumnId, size_t, ColumnIdHash> relationOfColumn;
+
+    RelationSet getAllRelations() const {
+        return relations.size() == std::numeric_limits<RelationSet>::digits ? ~RelationSet{0}
+                                                                             : relationBit(relations.size()) - 1;
+    }
+
+    /**
+     * @brief Estimated rows of the join of a set of relations: the product of their sizes and the
+     *        selectivities of the conjuncts between them
+     */
+    double getCardinality(RelationSet set) const {
+        double cardinality = 1.0;
+        for (size_t i = 0; i < relations.size(); ++i) {
+            if (set & relationBit(i)) {
+                cardinality *= relations[i].cardinality;
+            }
+        }
+        for (const Conjunct& conjunct : conjuncts) {
+            if (std::popcount(conjunct.relations) > 1 && (conjunct.relations & ~set) == 0) {
+                cardinality *= conjunct.selectivity;
+            }
+        }
+        return std::max(cardinality, 1.0);
+    }
+
+    /**
+     * @brief Whether a conjunct can be applied to the join of two disjoint sets of relations
+     */
+    bool isConnected(RelationSet left, RelationSet right) const {
+        for (const Conjunct& conjunct : conjuncts) {
+            if ((conjunct.relations & left) && (conjunct.relations & right) &&
+                (conjunct.relations & ~(left | right)) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Whether a predicate is an equality between a column of each input, which a hash join can evaluate
+     */
+    bool isEquiJoin(const PredicateExpr* predicate, RelationSet left, RelationSet right) const {
+        auto* compare = dynamic_cast<const CompareExpr*>(predicate);
+        if (!compare || compare->getOp() != CompareOp::EQUAL) {
+            return false;
+        }
+        auto* first = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+        auto* second = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+        if (!first || !second) {
+            return false;
+        }
+        RelationSet firstRelation = relationBit(relationOfColumn.at(first->getColumnId()));
+        RelationSet secondRelation = relationBit(relationOfColumn.at(second->getColumnId()));
+        return ((firstRelation & left) && (secondRelation & right)) || ((firstRelation & right) && (secondRelation & left));
+    }
+
+    /**
+     * @brief Find the cheapest join tree by dynamic programming over all subsets of relations.
+     *        The cost of a tree is the sum of the sizes of its intermediate results.
+     */
+    Splits orderDynamic() const {
+        RelationSet all = getAllRelations();
+        std::vector<double> cost(all + 1, std::numeric_limits<double>::infinity());
+        std::vector<RelationSet> bestLeft(all + 1, 0);
+        // Whether the best tree of a subset has no cross product
+        std::vector<bool> connected(all + 1, false);
+
+        // Subsets are numerically larger than their proper subsets, so these are done first
+        for (RelationSet set = 1; set <= all; ++set) {
+            if (std::has_single_bit(set)) {
+                cost[set] = 0.0;
+                connected[set] = true;
+                continue;
+            }
+
+            double cardinality = getCardinality(set);
+            for (RelationSet left = (set - 1) & set; left > 0; left = (left - 1) & set) {
+                RelationSet right = set ^ left;
+                if (left < right) {
+                    // Every split is seen twice, the sides are chosen when the tree is built
+                    continue;
+                }
+                bool splitConnected = connected[left] && connected[right] && isConnected(left, right);
+                double splitCost = cost[left] + cost[right] + cardinality;
+                if ((splitConnected && !connected[set]) || (splitConnected == connected[set] && splitCost < cost[set])) {
+                    cost[set] = splitCost;
+                    bestLeft[set] = left;
+                    connected[set] = splitConnected;
+                }
+            }
+        }
+
+        Splits splits;
+        std::vector<RelationSet> pending = {all};
+        while (!pending.empty()) {
+            RelationSet set = pending.back();
+            pending.pop_back();
+            if (std::has_single_bit(set)) {
+                continue;
+            }
+            RelationSet left = bestLeft[set];
+            splits[set] = {left, set ^ left};
+            pending.push_back(left);
+            pending.push_back(set ^ left);
+        }
+        return splits;
+    }
+
+    /**
+     * @brief Repeatedly join the two inputs with the smallest result, for regions too large for orderDynamic
+     */
+    Splits orderGreedy() const {
+        std::vector<RelationSet> inputs;
+        for (size_t i = 0; i < relations.size(); ++i) {
+            inputs.push_back(relationBit(i));
+        }
+
+        Splits splits;
+        while (inputs.size() > 1) {
+            size_t bestFirst = 0;
+            size_t bestSecond = 1;
+            double bestCardinality = std::numeric_limits<double>::infinity();
+            bool bestConnected = false;
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                for (size_t j = i + 1; j < inputs.size(); ++j) {
+                    bool connected = isConnected(inputs[i], inputs[j]);
+                    double cardinality = getCardinality(inputs[i] | inputs[j]);
+                    if ((connected && !bestConnected) || (connected == bestConnected && cardinality < bestCardinality)) {
+                        bestFirst = i;
+                        bestSecond = j;
+                        bestCardinality = cardinality;
+                        bestConnected = connected;
+                    }
+                }
+            }
+
+            RelationSet joined = inputs[bestFirst] | inputs[bestSecond];
+            splits[joined] = {inputs[bestFirst], inputs[bestSecond]};
+            inputs[bestFirst] = joined;
+            inputs.erase(inputs.begin() + static_cast<std::ptrdiff_t>(bestSecond));
+        }
+        return splits;
+    }
+
+    /**
+     * @brief Build the join tree of a set of relations. Every conjunct is applied by the lowest
+     *        join that has all the relations it references.
+     */
+    std::shared_ptr<LogicalOperator> buildJoinTree(RelationSet set, const Splits& splits) {
+        if (std::has_single_bit(set)) {
+            return relations[static_cast<size_t>(std::countr_zero(set))].op;
+        }
+
+        auto [left, right] = splits.at(set);
+        // The left input is the build side of the physical joins, it should be the smaller one
+        if (getCardinality(left) > getCardinality(right)) {
+            std::swap(left, right);
+        }
+        std::shared_ptr<LogicalOperator> leftOp = buildJoinTree(left, splits);
+        std::shared_ptr<LogicalOperator> rightOp = buildJoinTree(right, splits);
+
+        std::unique_ptr<PredicateExpr> condition;
+        std::vector<std::unique_ptr<PredicateExpr>> remaining;
+        for (Conjunct& conjunct : conjuncts) {
+            if (conjunct.applied || !(conjunct.relations & left) || !(conjunct.relations & right) ||
+                (conjunct.relations & ~set) != 0) {
+                continue;
+            }
+            conjunct.applied = true;
+            if (!condition && isEquiJoin(conjunct.predicate.get(), left, right)) {
+                condition = std::move(conjunct.predicate);
+            } else {
+                remaining.push_back(std::move(conjunct.predicate));
+            }
+        }
+
+        std::shared_ptr<LogicalOperator> join;
+        if (condition) {
+            join = std::make_shared<JoinOp>(JoinType::INNER, std::move(condition));
+        } else if (!remaining.empty()) {
+            // No equality, the nested loop join evaluates all conjuncts
+            join = std::make_shared<JoinOp>(JoinType::INNER, combineConjuncts(std::move(remaining)));
+            remaining.clear();
+        } else {
+            join = std::make_shared<CrossProductOp>();
+        }
+        join->addChild(leftOp);
+        join->addChild(rightOp);
+
+        if (remaining.empty()) {
+            return join;
+        }
+        auto filter = std::make_shared<FilterOp>(combineConjuncts(std::move(remaining)));
+        filter->addChild(join);
+        return filter;
+    }
+};
+
+void JoinOrderOptimizer::optimize(LogicalQueryPlan& plan) {
+    if (!plan.hasRoot()) {
+        return;
+    }
+
+    std::shared_ptr<LogicalOperator> root = plan.getSharedRoot();
+    std::vector<ColumnId> columns = getOutputColumnList(root.get());
+    std::shared_ptr<LogicalOperator> optimized = optimizeOperator(root);
+
+    // Joins concatenate the columns of their inputs, so reordering them reorders the columns. Only
+    // the root has to keep them in order, all other operators find their input columns by id.
+    if (getOutputColumnList(optimized.get()) != columns) {
+        auto projection = std::make_shared<ProjectionOp>(std::move(columns));
+        projection->addChild(optimized);
+        optimized = projection;
+    }
+    plan.setRoot(optimized);
+}
+
+std::shared_ptr<LogicalOperator> JoinOrderOptimizer::optimizeOperator(const std::shared_ptr<LogicalOperator>& op) {
+    if (isJoinRegion(op.get())) {
+        return optimizeRegion(op);
+    }
+
+    for (size_t i = 0; i < op->getChildCount(); ++i) {
+        std::shared_ptr<LogicalOperator> child = op->getChild(i);
+        std::shared_ptr<LogicalOperator> optimized = optimizeOperator(child);
+        if (optimized != child) {
+            op->replaceChild(i, optimized);
+        }
+    }
+    return op;
+}
+
+void JoinOrderOptimizer::collectRegion(const std::shared_ptr<LogicalOperator>& op, JoinRegion& region) {
+    std::vector<std::unique_ptr<PredicateExpr>> predicates;
+    if (auto* filter = dynamic_cast<const FilterOp*>(op.get())) {
+        splitConjuncts(filter->getPredicate(), predicates);
+    } else if (auto* join = dynamic_cast<const JoinOp*>(op.get()); join && join->getCondition()) {
+        splitConjuncts(join->getCondition(), predicates);
+    }
+    for (auto& predicate : predicates) {
+        region.conjuncts.push_back({std::move(predicate)});
+    }
+
+    for (const auto& child : op->getChildren()) {
+        if (isJoinRegion(child.get())) {
+            collectRegion(child, region);
+            continue;
+        }
+
+        // Anything else is a relation of the region, which may contain join regions itself
+        child->removeParent(op.get());
+        std::shared_ptr<LogicalOperator> relation = optimizeOperator(child);
+        for (const ColumnId& column : getOutputColumnList(relation.get())) {
+            region.relationOfColumn[column] = region.relations.size();
+        }
+        region.relations.push_back({relation, estimateCardinality(relation.get())});
+    }
+}
+
+std::shared_ptr<LogicalOperator> JoinOrderOptimizer::optimizeRegion(const std::shared_ptr<LogicalOperator>& op) {
+    JoinRegion region;
+    collectRegion(op, region);
+    size_t relationCount = region.relations.size();
+    if (relationCount > std::numeric_limits<RelationSet>::digits) {
+        throw NotYetImplementedError("Joins of more than 64 relations");
+    }
+
+    for (JoinRegion::Conjunct& conjunct : region.conjuncts) {
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(conjunct.predicate.get(), refs);
+        for (const ColumnRefExpr* ref : refs) {
+            auto it = region.relationOfColumn.find(ref->getColumnId());
+            if (it == region.relationOfColumn.end()) {
+                conjunct.relations = 0;
+                break;
+            }
+            conjunct.relations |= relationBit(it->second);
+        }
+        conjunct.selectivity = estimateSelectivity(conjunct.predicate.get());
+    }
+
+    // Conjuncts that reference a single relation filter it before the joins
+    for (size_t i = 0; i < relationCount; ++i) {
+        JoinRegion::Relation& relation = region.relations[i];
+        std::vector<std::unique_ptr<PredicateExpr>> pushed;
+        for (JoinRegion::Conjunct& conjunct : region.conjuncts) {
+            if (conjunct.relations == relationBit(i)) {
+                relation.cardinality = std::max(relation.cardinality * conjunct.selectivity, 1.0);
+                pushed.push_back(std::move(conjunct.predicate));
+                conjunct.applied = true;
+            }
+        }
+        if (pushed.empty()) {
+            continue;
+        }
+
+        // Merge with a filter the relation already has, so it can still be fused into a scan
+        if (auto* filter = dynamic_cast<const FilterOp*>(relation.op.get())) {
+            pushed.insert(pushed.begin(), filter->getPredicate()->clone());
+            std::shared_ptr<LogicalOperator> input = relation.op->getChild(0);
+            input->removeParent(relation.op.get());
+            relation.op = input;
+        }
+        auto filter = std::make_shared<FilterOp>(combineConjuncts(std::move(pushed)));
+        filter->addChild(relation.op);
+        relation.op = filter;
+    }
+
+    JoinRegion::Splits splits = relationCount <= MAX_DP_RELATIONS ? region.orderDynamic() : region.orderGreedy();
+    std::shared_ptr<LogicalOperator> result = region.buildJoinTree(region.getAllRelations(), splits);
+    Logger::debug("JoinOrderOptimizer: ordered {} relations, estimated {} rows", relationCount,
+                  region.getCardinality(region.getAllRelations()));
+
+    // Conjuncts without relations, e.g. constants
+    std::vector<std::unique_ptr<PredicateExpr>> remaining;
+    for (JoinRegion::Conjunct& conjunct : region.conjuncts) {
+        if (!conjunct.applied) {
+            remaining.push_back(std::move(conjunct.predicate));
+        }
+    }
+    if (!remaining.empty()) {
+        auto filter = std::make_shared<FilterOp>(combineConjuncts(std::move(remaining)));
+        filter->addChild(result);
+        result = filter;
+    }
+    return result;
+}
+
+const ColumnStatistics* JoinOrderOptimizer::getStatistics(const ColumnId& columnId) {
+    auto it = statistics_.find(columnId);
+    if (it == statistics_.end()) {
+        it = statistics_.emplace(columnId, catalog_->getColumnStatistics(columnId)).first;
+    }
+    return it->second ? &*it->second : nullptr;
+}
+
+double JoinOrderOptimizer::getDistinctCount(const ColumnId& columnId) {
+    const ColumnStatistics* stats = getStatistics(columnId);
+    if (stats && stats->distinctCount && *stats->distinctCount > 0) {
+        return static_cast<double>(*stats->distinctCount);
+    }
+    // Without statistics, assume the column is a key of its table
+    auto rowCount = catalog_->getRowCount(columnId.getTableId());
+    return rowCount && *rowCount > 0 ? static_cast<double>(*rowCount) : DEFAULT_CARDINALITY;
+}
+
+double JoinOrderOptimizer::estimateCardinality(const LogicalOperator* op) {
+    if (auto* scan = dynamic_cast<const TableScanOp*>(op)) {
+        if (scan->getColumns().empty()) {
+            return DEFAULT_CARDINALITY;
+        }
+        auto rowCount = catalog_->getRowCount(scan->getColumns()[0].getTableId());
+        double rows = rowCount ? static_cast<double>(*rowCount) : DEFAULT_CARDINALITY;
+        if (scan->getSample()) {
+            rows = std::max(rows * scan->getSample()->percent / 100.0, 1.0);
+        }
+        return rows;
+    }
+
+    if (auto* filter = dynamic_cast<const FilterOp*>(op)) {
+        return std::max(estimateCardinality(op->getChild(0).get()) * estimateSelectivity(filter->getPredicate()), 1.0);
+    }
+
+    if (auto* join = dynamic_cast<const JoinOp*>(op)) {
+        double left = estimateCardinality(op->getChild(0).get());
+        double right = estimateCardinality(op->getChild(1).get());
+        double rows = left * right * (join->getCondition() ? estimateSelectivity(join->getCondition()) : 1.0);
+        // Outer joins keep the unmatched rows of their outer sides
+        switch (join->getJoinType()) {
+            case JoinType::LEFT:
+                rows = std::max(rows, left);
+                break;
+            case JoinType::RIGHT:
+                rows = std::max(rows, right);
+                break;
+            case JoinType::FULL_OUTER:
+                rows = std::max(rows, left + right);
+                break;
+            default:
+                break;
+        }
+        return std::max(rows, 1.0);
+    }
+
+    if (dynamic_cast<const CrossProductOp*>(op)) {
+        return estimateCardinality(op->getChild(0).get()) * estimateCardinality(op->getChild(1).get());
+    }
+
+    if (auto* aggregate = dynamic_cast<const AggregateOp*>(op)) {
+        if (aggregate->getGroupBy().empty()) {
+            return 1.0;
+        }
+        double groups = 1.0;
+        for (const ColumnDescriptor& key : aggregate->getGroupBy()) {
+            groups *= getDistinctCount(key.columnId);
+        }
+        return std::min(groups, estimateCardinality(op->getChild(0).get()));
+    }
+
+    if (auto* limit = dynamic_cast<const LimitOp*>(op)) {
+        return std::min(static_cast<double>(limit->getLimit()), estimateCardinality(op->getChild(0).get()));
+    }
+
+    if (auto* topN = dynamic_cast<const TopNOp*>(op)) {
+        return std::min(static_cast<double>(topN->getLimit()), estimateCardinality(op->getChild(0).get()));
+    }
+
+    // Projections and sorts keep the rows of their input
+    if (op->getChildCount() == 1) {
+        return estimateCardinality(op->getChild(0).get());
+    }
+    return DEFAULT_CARDINALITY;
+}
+
+double JoinOrderOptimizer::estimateSelectivity(const PredicateExpr* predicate) {
+    if (auto* logical = dynamic_cast<const LogicalExpr*>(predicate)) {
+        double left = estimateSelectivity(logical->getLeft());
+        double right = estimateSelectivity(logical->getRight());
+        if (logical->getOp() == CompareOp::AND) {
+            return left * right;
+        }
+        if (logical->getOp() == CompareOp::OR) {
+            return left + right - left * right;
+        }
+        return DEFAULT_SELECTIVITY;
+    }
+
+    if (auto* compare = dynamic_cast<const CompareExpr*>(predicate)) {
+        return estimateCompareSelectivity(compare);
+    }
+
+    if (auto* constant = dynamic_cast<const ConstantExpr*>(predicate)) {
+        if (constant->isNull()) {
+            return 0.0;
+        }
+        return constant->getType() == DataType::getBool() && !constant->getBoolValue() ? 0.0 : 1.0;
+    }
+
+    return DEFAULT_SELECTIVITY;
+}
+
+double JoinOrderOptimizer::estimateCompareSelectivity(const CompareExpr* compare) {
+    CompareOp op = compare->getOp();
+    auto* leftColumn = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+    auto* rightColumn = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+
+    if (leftColumn && rightColumn) {
+        // Every value of the column with fewer distinct values is assumed to occur in the other one
+        double distinct = std::max(getDistinctCount(leftColumn->getColumnId()), getDistinctCount(rightColumn->getColumnId()));
+        double equality = 1.0 / std::max(distinct, 1.0);
+        if (op == CompareOp::EQUAL) {
+            return equality;
+        }
+        return op == CompareOp::NOT_EQUAL ? 1.0 - equality : RANGE_SELECTIVITY;
+    }
+
+    // Estimate with the column on the left
+    const ColumnRefExpr* column = leftColumn;
+    auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getRight()));
+    if (!column) {
+        column = rightColumn;
+        constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getLeft()));
+        op = kernels::mirrorCompareOp(op);
+    }
+    if (!column || !constant) {
+        return defaultSelectivity(op);
+    }
+    if (constant->isNull()) {
+        // Comparisons with NULL are never TRUE
+        return 0.0;
+    }
+
+    const ColumnStatistics* stats = getStatistics(column->getColumnId());
+    if (!stats) {
+        return defaultSelectivity(op);
+    }
+    // The value of a parameter is not known until the plan is executed
+    bool isParameter = constant->getParameterIndex().has_value();
+    if (!isParameter && !mayMatch(*compare, [this](const ColumnId& columnId) { return getStatistics(columnId); })) {
+        return 0.0;
+    }
+
+    double equality = stats->distinctCount && *stats->distinctCount > 0
+                          ? 1.0 / static_cast<double>(*stats->distinctCount)
+                          : EQUALITY_SELECTIVITY;
+    double selectivity;
+    switch (op) {
+        case CompareOp::EQUAL:
+            selectivity = equality;
+            break;
+        case CompareOp::NOT_EQUAL:
+            selectivity = 1.0 - equality;
+            break;
+        default:
+            selectivity = isParameter ? RANGE_SELECTIVITY
+                                      : rangeFraction(op, *stats, *constant).value_or(RANGE_SELECTIVITY);
+            break;
+    }
+    // NULLs never satisfy a comparison
+    return selectivity * (1.0 - stats->nullFraction());
+}
+
+}  // namespace toydb
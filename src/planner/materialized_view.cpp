@@ -0,0 +1,368 @@
+#include "planner/materialized_view.hpp"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/aggregate_hash_table.hpp"
+#include "engine/memory.hpp"
+#include "engine/spill.hpp"
+#include "engine/view_scan.hpp"
+#include "parser/parser.hpp"
+#include "planner/interpreter.hpp"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/physical_planner.hpp"
+#include "planner/prepared_statement.hpp"
+#include "planner/rule_based_optimizer.hpp"
+#include "storage/file_sync.hpp"
+
+namespace toydb {
+
+namespace {
+
+// Contents are written in chunks of about this size
+constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * @brief The part of the plan of a view's query the view materializes
+ */
+struct ViewShape {
+    // The aggregate whose partial states the view holds, nullptr for a view of rows
+    AggregateOp* aggregate = nullptr;
+    // Parent of the aggregate, nullptr if the aggregate is the root
+    LogicalOperator* aggregateParent = nullptr;
+    // Produces the materialized rows: the input of the aggregate, or the root of the plan
+    std::shared_ptr<LogicalOperator> input;
+    // One scan per table
+    std::vector<TableScanOp*> scans;
+};
+
+LogicalQueryPlan planQuery(Catalog* catalog, const std::string& query) {
+    auto ast = parser::Parser{query}.parseQuery();
+    if (!ast) {
+        throw SQLException(ast.error(), query);
+    }
+    if (!ast::as<ast::SelectFrom>((*ast)->query_)) {
+        throw SQLRuntimeException("A materialized view must be a SELECT", query);
+    }
+    if ((*ast)->parameterCount > 0) {
+        throw SQLRuntimeException("A materialized view can't have parameters", query);
+    }
+
+    CatalogQueryAdapter queryCatalog(catalog);
+    SQLInterpreter interpreter(&queryCatalog);
+    auto plan = interpreter.interpret(**ast);
+    if (!plan) {
+        throw InternalSQLError("Query could not be interpreted");
+    }
+    JoinOrderOptimizer(catalog).optimize(*plan);
+    RuleBasedOptimizer(catalog).optimize(*plan);
+    return std::move(*plan);
+}
+
+void collectScans(LogicalOperator* op, std::unordered_set<const LogicalOperator*>& visited,
+                  std::vector<TableScanOp*>& scans) {
+    if (!visited.insert(op).second) {
+        return;
+    }
+    if (auto* scan = dynamic_cast<TableScanOp*>(op)) {
+        if (scan->getColumns().empty()) {
+            throw InternalSQLError("Table scan without columns");
+        }
+        if (scan->getSample()) {
+            throw NotYetImplementedError("Materialized views of sampled tables");
+        }
+        scans.push_back(scan);
+        return;
+    }
+
+    // Appended rows only add rows to the result of these operators, never remove or change any
+    auto* join = dynamic_cast<JoinOp*>(op);
+    bool appendOnly = dynamic_cast<FilterOp*>(op) || dynamic_cast<ProjectionOp*>(op) ||
+                      dynamic_cast<CrossProductOp*>(op) ||
+                      (join && (join->getJoinType() == JoinType::INNER || join->getJoinType() == JoinType::CROSS));
+    if (!appendOnly) {
+        std::ostringstream name;
+        op->print(name);
+        throw NotYetImplementedError("Materialized views of " + name.str());
+    }
+    for (const auto& child : op->getChildren()) {
+        collectScans(child.get(), visited, scans);
+    }
+}
+
+/**
+ * @throws NotYetImplementedError if the view can't be maintained from appended files
+ */
+ViewShape analyzeShape(const LogicalQueryPlan& plan) {
+    ViewShape shape;
+    shape.input = plan.getSharedRoot();
+
+    // Only projections and filters of the aggregated rows run when the view is read
+    LogicalOperator* parent = nullptr;
+    LogicalOperator* op = plan.getRoot();
+    while (true) {
+        if (auto* aggregate = dynamic_cast<AggregateOp*>(op)) {
+            shape.aggregate = aggregate;
+            shape.aggregateParent = parent;
+            shape.input = aggregate->getChild(0);
+            break;
+        }
+        if ((!dynamic_cast<ProjectionOp*>(op) && !dynamic_cast<FilterOp*>(op)) || op->getChildCount() != 1) {
+            break;
+        }
+        parent = op;
+        op = op->getChild(0).get();
+    }
+
+    std::unordered_set<const LogicalOperator*> visited;
+    collectScans(shape.input.get(), visited, shape.scans);
+    return shape;
+}
+
+/**
+ * @brief Type of a column computed by a projection below op, nullopt for table columns
+ */
+std::optional<DataType> findComputedType(const LogicalOperator* op, const ColumnId& column) {
+    if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+        const auto& columns = projection->getColumns();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (columns[i] == column && projection->getExpression(i)) {
+                return projection->getExpression(i)->getType();
+            }
+        }
+    }
+    for (const auto& child : op->getChildren()) {
+        if (auto type = findComputedType(child.get(), column)) {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+std::string MaterializedViewManager::normalizeQuery(std::string_view statement) {
+    std::string normalized = PlanCache::normalize(statement);
+    // SELECT is a keyword, so the first SELECT token starts the query
+    if (normalized.starts_with("SELECT ")) {
+        return normalized;
+    }
+    size_t start = normalized.find(" SELECT ");
+    return start == std::string::npos ? normalized : normalized.substr(start + 1);
+}
+
+std::optional<MaterializedViewMetadata> MaterializedViewManager::findView(const std::string& query) const {
+    for (MaterializedViewMetadata& view : catalog_->listMaterializedViews()) {
+        if (view.query == query) {
+            return std::move(view);
+        }
+    }
+    return std::nullopt;
+}
+
+bool MaterializedViewManager::isStale(const MaterializedViewMetadata& view) const {
+    for (const auto& [tableName, fileCount] : view.fileCounts) {
+        auto tableId = catalog_->getTableIdByName(tableName);
+        if (!tableId) {
+            return true;
+        }
+        auto handle = catalog_->getTableHandle(*tableId);
+        if (!handle || (*handle)->getFiles().size() != fileCount) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MaterializedViewMetadata MaterializedViewManager::create(const std::string& name, const std::string& query) {
+    for (const MaterializedViewMetadata& view : catalog_->listMaterializedViews()) {
+        if (view.name == name) {
+            throw SQLRuntimeException("Materialized view " + name + " already exists");
+        }
+    }
+    return materialize(name, query, nullptr);
+}
+
+MaterializedViewMetadata MaterializedViewManager::refresh(const MaterializedViewMetadata& view) {
+    return materialize(view.name, view.query, &view);
+}
+
+MaterializedViewMetadata MaterializedViewManager::materialize(const std::string& name, const std::string& query,
+                                                              const MaterializedViewMetadata* previous) {
+    LogicalQueryPlan plan = planQuery(catalog_, query);
+    ViewShape shape = analyzeShape(plan);
+
+    std::unordered_map<std::string, size_t> fileCounts;
+    std::vector<size_t> oldCounts;
+    std::vector<size_t> newCounts;
+    // Contents the appended files are added to, nullptr to read all files
+    const MaterializedViewMetadata* base = previous;
+    for (TableScanOp* scan : shape.scans) {
+        const TableId& tableId = scan->getColumns().front().getTableId();
+        auto tableName = catalog_->getTableName(tableId);
+        auto handle = catalog_->getTableHandle(tableId);
+        if (!tableName || !handle) {
+            throw InternalSQLError("Table " + tableId.getName() + " not found in catalog");
+        }
+        size_t fileCount = (*handle)->getFiles().size();
+        fileCounts[*tableName] = fileCount;
+        newCounts.push_back(fileCount);
+
+        size_t oldCount = 0;
+        if (previous) {
+            auto it = previous->fileCounts.find(*tableName);
+            oldCount = it == previous->fileCounts.end() ? 0 : it->second;
+        }
+        oldCounts.push_back(oldCount);
+        // Files are only ever appended, unless the table was replaced
+        if (oldCount > fileCount) {
+            base = nullptr;
+        }
+    }
+    if (!base) {
+        std::fill(oldCounts.begin(), oldCounts.end(), 0);
+    }
+
+    // The rows the files appended since the last refresh add to the result, see the class comment
+    PhysicalPlanner planner(catalog_);
+    auto forEachAddedRow = [&](const std::shared_ptr<LogicalOperator>& root,
+                               const std::function<void(const RowVector&)>& consume) {
+        LogicalQueryPlan deltaPlan(root);
+        int64_t rowCount = 0;
+        for (size_t i = 0; i < shape.scans.size(); ++i) {
+            bool empty = false;
+            for (size_t j = 0; j < shape.scans.size(); ++j) {
+                size_t begin = j == i ? oldCounts[j] : 0;
+                size_t end = j > i ? oldCounts[j] : newCounts[j];
+                shape.scans[j]->setFileRange(begin, end);
+                empty = empty || begin == end;
+            }
+            if (!empty) {
+                PhysicalQueryPlan physicalPlan = planner.plan(deltaPlan);
+                rowCount += physicalPlan.run(consume);
+            }
+        }
+        return rowCount;
+    };
+
+    fs::path path = catalog_->createViewPath(name);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw SQLRuntimeException("Failed to create materialized view " + path.string());
+    }
+    auto write = [&out](std::string_view bytes) { out.write(bytes.data(), static_cast<std::streamsize>(bytes.size())); };
+
+    int64_t rowCount = 0;
+    if (shape.aggregate) {
+        // Only the columns the aggregate reads
+        std::vector<ColumnId> columns;
+        auto addColumn = [&columns](const ColumnId& column) {
+            if (std::find(columns.begin(), columns.end(), column) == columns.end()) {
+                columns.push_back(column);
+            }
+        };
+        for (const ColumnDescriptor& key : shape.aggregate->getGroupBy()) {
+            addColumn(key.columnId);
+        }
+        for (const AggregateSpec& spec : shape.aggregate->getAggregates()) {
+            if (spec.function != AggregateFunction::COUNT_STAR) {
+                addColumn(spec.input);
+            }
+        }
+        auto projection = std::make_shared<ProjectionOp>(std::move(columns));
+        projection->addChild(shape.input);
+
+        memory::BufferManager bufferManager;
+        AggregateHashTable table(shape.aggregate->getGroupBy(), shape.aggregate->getAggregates(), &bufferManager);
+        if (base) {
+            table.mergePartialStates(readMaterializedView(base->path));
+        }
+        rowCount = forEachAddedRow(projection, [&table](const RowVector& batch) { table.consume(batch); });
+        table.exportPartialStates(write, CHUNK_SIZE);
+    } else {
+        // Rows are stored in the order of the columns of the root, whatever order its input produces them in
+        std::shared_ptr<LogicalOperator> root = shape.input;
+        if (!dynamic_cast<const ProjectionOp*>(root.get())) {
+            root = std::make_shared<ProjectionOp>(getOutputColumnList(shape.input.get()));
+            root->addChild(shape.input);
+        }
+
+        if (base) {
+            write(readMaterializedView(base->path));
+        }
+        std::string chunk;
+        rowCount = forEachAddedRow(root, [&](const RowVector& batch) {
+            if (batch.getSelectedRowCount() == 0) {
+                return;
+            }
+            BatchCodec::encode(batch, chunk);
+            if (chunk.size() >= CHUNK_SIZE) {
+                write(chunk);
+                chunk.clear();
+            }
+        });
+        write(chunk);
+    }
+
+    out.close();
+    if (!out || !syncPath(path)) {
+        fs::remove(path);
+        throw SQLRuntimeException("Failed to write materialized view " + path.string());
+    }
+
+    MaterializedViewMetadata view {name, query, path, std::move(fileCounts)};
+    if (!catalog_->putMaterializedView(view)) {
+        fs::remove(path);
+        throw SQLRuntimeException("Failed to store materialized view " + name + " in the catalog");
+    }
+    // The old contents may only go once the manifest on disk no longer refers to them
+    if (previous && catalog_->sync()) {
+        std::error_code error;
+        fs::remove(previous->path, error);
+    }
+    Logger::debug("MaterializedViewManager: {} {} with {} rows", base ? "refreshed" : "materialized", name, rowCount);
+    return view;
+}
+
+LogicalQueryPlan MaterializedViewManager::plan(const MaterializedViewMetadata& view) const {
+    LogicalQueryPlan plan = planQuery(catalog_, view.query);
+    ViewShape shape = analyzeShape(plan);
+
+    if (shape.aggregate) {
+        auto scan = std::make_shared<MaterializedViewScanOp>(view.name, view.path, shape.aggregate->getGroupBy(),
+                                                             shape.aggregate->getAggregates());
+        LogicalOperator* parent = shape.aggregateParent;
+        if (!parent) {
+            plan.setRoot(scan);
+            return plan;
+        }
+        for (size_t i = 0; i < parent->getChildCount(); ++i) {
+            if (parent->getChild(i).get() == shape.aggregate) {
+                parent->replaceChild(i, scan);
+                break;
+            }
+        }
+        return plan;
+    }
+
+    std::vector<ColumnDescriptor> columns;
+    for (const ColumnId& column : getOutputColumnList(plan.getRoot())) {
+        std::optional<DataType> type = findComputedType(plan.getRoot(), column);
+        if (!type) {
+            auto tableType = catalog_->getColumnType(column);
+            if (!tableType) {
+                throw InternalSQLError("Column " + column.getName() + " not found in catalog");
+            }
+            type = *tableType;
+        }
+        columns.push_back({column, *type});
+    }
+    return LogicalQueryPlan(std::make_shared<MaterializedViewScanOp>(view.name, view.path, std::move(columns)));
+}
+
+}  // namespace toydb
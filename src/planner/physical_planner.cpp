@@ -0,0 +1,656 @@
+#include "planner/physical_planner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "common/metrics.hpp"
+#include "engine/exchange.hpp"
+#include "engine/filter.hpp"
+#include "engine/hash_aggregate.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/limit.hpp"
+#include "engine/nested_loop_join.hpp"
+#include "engine/projection.hpp"
+#include "engine/radix_hash_join.hpp"
+#include "engine/sort.hpp"
+#include "engine/sort_merge_join.hpp"
+#include "engine/table_scan.hpp"
+#include "engine/top_n.hpp"
+#include "engine/view_scan.hpp"
+#include "planner/plan_fragment.hpp"
+
+namespace toydb {
+
+static void addPredicateColumns(const PredicateExpr* predicate, ColumnSet& columns) {
+    std::vector<const ColumnRefExpr*> refs;
+    collectColumnRefs(predicate, refs);
+    for (const ColumnRefExpr* ref : refs) {
+        columns.insert(ref->getColumnId());
+    }
+}
+
+/**
+ * @brief The columns required from the input of an operator: the ones its parent requires plus
+ *        the ones it references itself
+ */
+static std::optional<ColumnSet> withColumns(const std::optional<ColumnSet>& required, const ColumnSet& referenced) {
+    if (!required) {
+        return std::nullopt;
+    }
+    ColumnSet result = *required;
+    result.insert(referenced.begin(), referenced.end());
+    return result;
+}
+
+/**
+ * @brief A filter or a projection applied by every worker of a scan pipeline
+ */
+struct PipelineStage {
+    std::unique_ptr<PredicateExpr> predicate;
+    std::vector<ColumnId> columns;
+    // Expression of every column, nullptr for columns passed through, empty if none is computed
+    std::vector<std::unique_ptr<ValueExpr>> expressions;
+};
+
+static const PredicateExpr* stripCasts(const PredicateExpr* expr) {
+    while (auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+        expr = cast->getExpr();
+    }
+    return expr;
+}
+
+/**
+ * @brief Split an equality between a column of the left and a column of the right input into the
+ *        keys of both sides
+ * @return The left and the right key, nullopt if the condition is not such an equality
+ */
+static std::optional<std::pair<const ColumnRefExpr*, const ColumnRefExpr*>> getEquiJoinKeys(
+    const PredicateExpr* condition, const ColumnSet& leftColumns, const ColumnSet& rightColumns) {
+    auto* compare = dynamic_cast<const CompareExpr*>(condition);
+    if (!compare || compare->getOp() != CompareOp::EQUAL) {
+        return std::nullopt;
+    }
+
+    auto* first = dynamic_cast<const ColumnRefExpr*>(stripCasts(compare->getLeft()));
+    auto* second = dynamic_cast<const ColumnRefExpr*>(stripCasts(compare->getRight()));
+    if (!first || !second) {
+        return std::nullopt;
+    }
+
+    if (leftColumns.contains(first->getColumnId()) && rightColumns.contains(second->getColumnId())) {
+        return std::make_pair(first, second);
+    }
+    if (leftColumns.contains(second->getColumnId()) && rightColumns.contains(first->getColumnId())) {
+        return std::make_pair(second, first);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Split a range comparison (<, <=, >, >=) between a column of the left and a column of the
+ *        right input into the keys of both sides
+ * @return The left key, the right key and the comparison as left op right, nullopt if the
+ *         condition is not such a comparison
+ */
+static std::optional<std::tuple<const ColumnRefExpr*, const ColumnRefExpr*, CompareOp>> getRangeJoinKeys(
+    const PredicateExpr* condition, const ColumnSet& leftColumns, const ColumnSet& rightColumns) {
+    auto* compare = dynamic_cast<const CompareExpr*>(condition);
+    if (!compare) {
+        return std::nullopt;
+    }
+    CompareOp op = compare->getOp();
+    CompareOp flipped;
+    switch (op) {
+        case CompareOp::LESS: flipped = CompareOp::GREATER; break;
+        case CompareOp::LESS_EQUAL: flipped = CompareOp::GREATER_EQUAL; break;
+        case CompareOp::GREATER: flipped = CompareOp::LESS; break;
+        case CompareOp::GREATER_EQUAL: flipped = CompareOp::LESS_EQUAL; break;
+        default: return std::nullopt;
+    }
+
+    auto* first = dynamic_cast<const ColumnRefExpr*>(stripCasts(compare->getLeft()));
+    auto* second = dynamic_cast<const ColumnRefExpr*>(stripCasts(compare->getRight()));
+    if (!first || !second) {
+        return std::nullopt;
+    }
+
+    if (leftColumns.contains(first->getColumnId()) && rightColumns.contains(second->getColumnId())) {
+        return std::make_tuple(first, second, op);
+    }
+    if (leftColumns.contains(second->getColumnId()) && rightColumns.contains(first->getColumnId())) {
+        return std::make_tuple(second, first, flipped);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief The column the output of op is sorted on ascending with NULLs last, as SortExec and
+ *        TopNExec produce it and filters, limits and projections keep it
+ * @return nullopt if the output has no known order
+ */
+static std::optional<ColumnId> getAscendingColumn(const LogicalOperator* op) {
+    auto firstAscendingKey = [](const std::vector<SortKey>& keys) -> std::optional<ColumnId> {
+        if (keys.empty() || !keys.front().ascending) {
+            return std::nullopt;
+        }
+        return keys.front().column;
+    };
+
+    if (auto* sort = dynamic_cast<const SortOp*>(op)) {
+        return firstAscendingKey(sort->getKeys());
+    }
+    if (auto* topN = dynamic_cast<const TopNOp*>(op)) {
+        return firstAscendingKey(topN->getKeys());
+    }
+    if (dynamic_cast<const FilterOp*>(op) || dynamic_cast<const LimitOp*>(op)) {
+        return getAscendingColumn(op->getChild(0).get());
+    }
+    if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+        auto column = getAscendingColumn(op->getChild(0).get());
+        const auto& columns = projection->getColumns();
+        if (column && std::find(columns.begin(), columns.end(), *column) != columns.end()) {
+            return column;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Whether both inputs of a join arrive sorted on their keys, so that they can be merged
+ */
+static bool isSortedOn(const LogicalOperator* left, const ColumnRefExpr* leftKey, const LogicalOperator* right,
+                       const ColumnRefExpr* rightKey) {
+    return getAscendingColumn(left) == leftKey->getColumnId() && getAscendingColumn(right) == rightKey->getColumnId();
+}
+
+int64_t PhysicalQueryPlan::run(const std::function<void(const RowVector&)>& consume) {
+    static auto& registry = metrics::MetricsRegistry::global();
+    static metrics::Counter& queries = registry.counter("toydb_queries_total", "Queries run");
+    static metrics::Counter& failures = registry.counter("toydb_query_failures_total", "Queries that threw an error");
+    // 100us to about 100s
+    static metrics::Histogram& latency = registry.histogram("toydb_query_duration_seconds", "Latency of queries",
+                                                            metrics::Histogram::exponentialBounds(0.0001, 2.0, 20));
+
+    tdb_assert(root_ != nullptr, "Cannot run an empty plan");
+    queries.increment();
+    auto start = std::chrono::steady_clock::now();
+    int64_t rowCount = 0;
+    try {
+        root_->initialize();
+        RowVector batch;
+        while (int64_t count = root_->next(batch)) {
+            if (consume) {
+                consume(batch);
+            }
+            rowCount += count;
+        }
+    } catch (...) {
+        failures.increment();
+        throw;
+    }
+    latency.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return rowCount;
+}
+
+PhysicalQueryPlan PhysicalPlanner::plan(const LogicalQueryPlan& logicalPlan) {
+    PhysicalQueryPlan plan;
+    if (!logicalPlan.hasRoot()) {
+        return plan;
+    }
+    if (profiling_) {
+        plan.setHardwareCounters(HardwareCounterGroup::open());
+    }
+
+    estimator_.emplace(catalog_);
+    estimates_.clear();
+    plan.setRoot(lower(logicalPlan.getRoot(), std::nullopt, plan));
+    return plan;
+}
+
+PhysicalOperator* PhysicalPlanner::lower(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                                         PhysicalQueryPlan& plan) {
+    PhysicalOperator* physical = lowerOperator(op, required, plan);
+    return profiling_ ? plan.addProfiling(op, physical) : physical;
+}
+
+PhysicalOperator* PhysicalPlanner::lowerOperator(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                                                 PhysicalQueryPlan& plan) {
+    if (dispatcher_) {
+        PhysicalOperator* gather = nullptr;
+        if (auto* aggregate = dynamic_cast<const AggregateOp*>(op);
+            aggregate && PlanFragment::canDistribute(op->getChild(0).get())) {
+            gather = lowerGatherAggregate(aggregate, plan);
+        } else if (PlanFragment::canDistribute(op)) {
+            gather = lowerGather(op, required, plan);
+        }
+        if (gather) {
+            return gather;
+        }
+    }
+
+    if (auto* scan = dynamic_cast<const TableScanOp*>(op)) {
+        return lowerScan(scan, required, nullptr, plan);
+    }
+
+    if (auto* view = dynamic_cast<const MaterializedViewScanOp*>(op)) {
+        if (view->isAggregated()) {
+            return plan.add<ViewAggregateExec>(view->getPath(), view->getGroupBy(), view->getAggregates());
+        }
+        return plan.add<ViewScanExec>(view->getPath(), view->getColumns());
+    }
+
+    if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+        if (!projection->hasExpressions()) {
+            const auto& columns = projection->getColumns();
+            PhysicalOperator* input = lower(op->getChild(0).get(), ColumnSet(columns.begin(), columns.end()), plan);
+            return plan.add<ProjectionExec>(input, columns);
+        }
+
+        // Columns that are not required are not computed, the input only produces the columns
+        // that are passed through or read by the expressions
+        std::vector<ColumnId> columns;
+        std::vector<std::unique_ptr<ValueExpr>> expressions;
+        std::vector<ColumnId> inputColumns;
+        for (size_t i = 0; i < projection->getColumns().size(); ++i) {
+            const ColumnId& column = projection->getColumns()[i];
+            if (required && !required->contains(column)) {
+                continue;
+            }
+            columns.push_back(column);
+            const ValueExpr* expression = projection->getExpression(i);
+            if (expression) {
+                expression->collectColumns(inputColumns);
+                expressions.push_back(expression->clone());
+            } else {
+                inputColumns.push_back(column);
+                expressions.push_back(nullptr);
+            }
+        }
+        PhysicalOperator* input =
+            lower(op->getChild(0).get(), ColumnSet(inputColumns.begin(), inputColumns.end()), plan);
+        return plan.add<ProjectionExec>(input, std::move(columns), std::move(expressions));
+    }
+
+    if (auto* filter = dynamic_cast<const FilterOp*>(op)) {
+        auto predicate = filter->getPredicate()->clone();
+        const LogicalOperator* child = op->getChild(0).get();
+        // Scans gathered from the workers can't be fused with filters they can't encode
+        if (auto* scan = dynamic_cast<const TableScanOp*>(child); scan && !dispatcher_) {
+            // The scan reads the predicate columns itself, they only have to be produced if required
+            return lowerScan(scan, required, std::move(predicate), plan);
+        }
+
+        ColumnSet referenced;
+        addPredicateColumns(predicate.get(), referenced);
+        PhysicalOperator* input = lower(child, withColumns(required, referenced), plan);
+        return plan.add<FilterExec>(input, std::move(predicate));
+    }
+
+    if (auto* join = dynamic_cast<const JoinOp*>(op)) {
+        return lowerJoin(op, join->getCondition(), join->getJoinType(), required, plan);
+    }
+
+    if (dynamic_cast<const CrossProductOp*>(op)) {
+        return lowerJoin(op, nullptr, JoinType::CROSS, required, plan);
+    }
+
+    if (auto* aggregate = dynamic_cast<const AggregateOp*>(op)) {
+        ColumnSet referenced;
+        for (const ColumnDescriptor& key : aggregate->getGroupBy()) {
+            referenced.insert(key.columnId);
+        }
+        for (const AggregateSpec& spec : aggregate->getAggregates()) {
+            if (spec.function != AggregateFunction::COUNT_STAR) {
+                referenced.insert(spec.input);
+            }
+        }
+        const LogicalOperator* child = op->getChild(0).get();
+        bool parallel = isParallel(child);
+        if (parallel) {
+            if (auto pipeline = lowerScanPipeline(child, referenced, plan)) {
+                return plan.add<ParallelHashAggregateExec>(std::move(pipeline->source), std::move(pipeline->factory),
+                                                           aggregate->getGroupBy(), aggregate->getAggregates(),
+                                                           workerCount_);
+            }
+        }
+        PhysicalOperator* input = lower(child, referenced, plan);
+        if (parallel) {
+            return plan.add<ParallelHashAggregateExec>(input, aggregate->getGroupBy(), aggregate->getAggregates(),
+                                                       workerCount_);
+        }
+        return plan.add<HashAggregateExec>(input, aggregate->getGroupBy(), aggregate->getAggregates());
+    }
+
+    if (auto* sort = dynamic_cast<const SortOp*>(op)) {
+        ColumnSet referenced;
+        for (const SortKey& key : sort->getKeys()) {
+            referenced.insert(key.column);
+        }
+        PhysicalOperator* input = lower(op->getChild(0).get(), withColumns(required, referenced), plan);
+        return plan.add<SortExec>(input, sort->getKeys());
+    }
+
+    if (auto* topN = dynamic_cast<const TopNOp*>(op)) {
+        ColumnSet referenced;
+        for (const SortKey& key : topN->getKeys()) {
+            referenced.insert(key.column);
+        }
+        const LogicalOperator* child = op->getChild(0).get();
+        bool parallel = isParallel(child);
+        if (parallel) {
+            if (auto pipeline = lowerScanPipeline(child, withColumns(required, referenced), plan)) {
+                return plan.add<ParallelTopNExec>(std::move(pipeline->source), std::move(pipeline->factory),
+                                                  topN->getKeys(), topN->getLimit(), workerCount_);
+            }
+        }
+        PhysicalOperator* input = lower(child, withColumns(required, referenced), plan);
+        if (parallel) {
+            return plan.add<ParallelTopNExec>(input, topN->getKeys(), topN->getLimit(), workerCount_);
+        }
+        return plan.add<TopNExec>(input, topN->getKeys(), topN->getLimit());
+    }
+
+    if (auto* limit = dynamic_cast<const LimitOp*>(op)) {
+        PhysicalOperator* input = lower(op->getChild(0).get(), required, plan);
+        return plan.add<LimitExec>(input, limit->getLimit());
+    }
+
+    std::ostringstream name;
+    op->print(name);
+    throw NotYetImplementedError("Physical operator for " + name.str());
+}
+
+double PhysicalPlanner::estimateRows(const LogicalOperator* op) {
+    auto it = estimates_.find(op);
+    if (it == estimates_.end()) {
+        it = estimates_.emplace(op, estimator_->estimateCardinality(op)).first;
+    }
+    return it->second;
+}
+
+bool PhysicalPlanner::isParallel(const LogicalOperator* input) {
+    if (workerCount_ < 2) {
+        return false;
+    }
+    double rows = estimateRows(input);
+    if (rows < PARALLEL_MIN_ROWS) {
+        return false;
+    }
+    Logger::debug("PhysicalPlanner: consuming {} estimated rows on {} workers", rows, workerCount_);
+    return true;
+}
+
+TableHandle* PhysicalPlanner::addTable(const TableScanOp* scan, PhysicalQueryPlan& plan) {
+    const TableId& tableId = scan->getColumns()[0].getTableId();
+    auto handleResult = catalog_->getTableHandle(tableId);
+    if (!handleResult) {
+        throw InternalSQLError("Table " + tableId.getName() + " not found in catalog");
+    }
+    TableHandle* table = plan.addTable(std::move(*handleResult));
+    if (const auto& range = scan->getFileRange()) {
+        table->selectFiles(range->first, range->second);
+    }
+    return table;
+}
+
+std::vector<ColumnId> PhysicalPlanner::getScanColumns(const TableScanOp* scan,
+                                                     const std::optional<ColumnSet>& required) {
+    const auto& scanColumns = scan->getColumns();
+    std::vector<ColumnId> columns;
+    for (const ColumnId& colId : scanColumns) {
+        if (!required || required->contains(colId)) {
+            columns.push_back(colId);
+        }
+    }
+    // Batches need a column to carry their row count, e.g. for COUNT(*)
+    if (columns.empty()) {
+        columns.push_back(scanColumns[0]);
+    }
+    return columns;
+}
+
+std::optional<PhysicalPlanner::ScanPipeline> PhysicalPlanner::lowerScanPipeline(const LogicalOperator* op,
+                                                                             std::optional<ColumnSet> required,
+                                                                             PhysicalQueryPlan& plan) {
+    // Profiled plans need an operator per logical operator, a cluster reads the tables on its workers
+    if (profiling_ || dispatcher_) {
+        return std::nullopt;
+    }
+
+    // The stages from the top of the chain down, with the columns each one needs from its input
+    auto stages = std::make_shared<std::vector<PipelineStage>>();
+    while (!dynamic_cast<const TableScanOp*>(op)) {
+        if (auto* filter = dynamic_cast<const FilterOp*>(op)) {
+            PipelineStage& stage = stages->emplace_back();
+            stage.predicate = filter->getPredicate()->clone();
+            ColumnSet referenced;
+            addPredicateColumns(stage.predicate.get(), referenced);
+            required = withColumns(required, referenced);
+        } else if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+            // Like lowerOperator, columns that are not required are not computed
+            PipelineStage& stage = stages->emplace_back();
+            std::vector<ColumnId> inputColumns;
+            for (size_t i = 0; i < projection->getColumns().size(); ++i) {
+                const ColumnId& column = projection->getColumns()[i];
+                if (projection->hasExpressions() && required && !required->contains(column)) {
+                    continue;
+                }
+                stage.columns.push_back(column);
+                const ValueExpr* expression = projection->hasExpressions() ? projection->getExpression(i) : nullptr;
+                if (expression) {
+                    expression->collectColumns(inputColumns);
+                } else {
+                    inputColumns.push_back(column);
+                }
+                if (projection->hasExpressions()) {
+                    stage.expressions.push_back(expression ? expression->clone() : nullptr);
+                }
+            }
+            required = ColumnSet(inputColumns.begin(), inputColumns.end());
+        } else {
+            return std::nullopt;
+        }
+        op = op->getChild(0).get();
+    }
+
+    // Sampled scans drop batches as they read them, which a pipeline can't
+    auto* scan = static_cast<const TableScanOp*>(op);
+    if (scan->getSample()) {
+        return std::nullopt;
+    }
+    TableHandle* table = addTable(scan, plan);
+    std::vector<ColumnId> columns = getScanColumns(scan, required);
+
+    // The filter right above the scan is pushed down to the readers, which skip what it rules out.
+    // The workers evaluate it on the rows that are read.
+    std::shared_ptr<PredicateExpr> pushed;
+    if (!stages->empty() && stages->back().predicate) {
+        pushed = stages->back().predicate->clone();
+        pushed->initializeIndexMap();
+    }
+
+    Logger::debug("PhysicalPlanner: scanning {} of {} columns of {} on {} workers", columns.size(),
+                  table->getColumnIds().size(), scan->getColumns()[0].getTableId().getName(), workerCount_);
+    ScanPipeline pipeline;
+    pipeline.source = [table, columns = std::move(columns), pushed, batchSize = batchSize_,
+                       workerCount = workerCount_]() -> std::unique_ptr<MorselSource> {
+        return table->createScan(batchSize, workerCount, columns, pushed.get());
+    };
+    pipeline.factory = [stages](PhysicalOperator* source, OperatorChain& chain) {
+        PhysicalOperator* input = source;
+        for (auto it = stages->rbegin(); it != stages->rend(); ++it) {
+            if (it->predicate) {
+                input = chain.add<FilterExec>(input, it->predicate->clone());
+            } else if (it->expressions.empty()) {
+                input = chain.add<ProjectionExec>(input, it->columns);
+            } else {
+                std::vector<std::unique_ptr<ValueExpr>> expressions;
+                for (const auto& expression : it->expressions) {
+                    expressions.push_back(expression ? expression->clone() : nullptr);
+                }
+                input = chain.add<ProjectionExec>(input, it->columns, std::move(expressions));
+            }
+        }
+        return input;
+    };
+    return pipeline;
+}
+
+PhysicalOperator* PhysicalPlanner::lowerScan(const TableScanOp* scan, const std::optional<ColumnSet>& required,
+                                             std::unique_ptr<PredicateExpr> predicate, PhysicalQueryPlan& plan) {
+    const auto& scanColumns = scan->getColumns();
+    if (scanColumns.empty()) {
+        throw InternalSQLError("Table scan without columns");
+    }
+
+    TableHandle* table = addTable(scan, plan);
+    std::optional<TableSample> sample = scan->getSample();
+    if (sample && sample->method == SampleMethod::SYSTEM && table->getFiles().size() >= SYSTEM_SAMPLE_MIN_FILES) {
+        table->sampleFiles(*sample);
+        sample.reset();
+    }
+
+    std::vector<ColumnId> columns = getScanColumns(scan, required);
+    Logger::debug("PhysicalPlanner: scanning {} of {} columns of {}{}", columns.size(), table->getColumnIds().size(),
+                  scanColumns[0].getTableId().getName(), predicate ? " with fused filter" : "");
+    return plan.add<TableScanExec>(table->createIterator(batchSize_, workerCount_), std::move(columns),
+                                   std::move(predicate), sample);
+}
+
+PhysicalOperator* PhysicalPlanner::lowerGather(const LogicalOperator* op, const std::optional<ColumnSet>& required,
+                                               PhysicalQueryPlan& plan) {
+    std::vector<ColumnId> columns;
+    for (const ColumnId& column : getOutputColumnList(op)) {
+        if (!required || required->contains(column)) {
+            columns.push_back(column);
+        }
+    }
+    std::optional<PlanFragment> fragment = PlanFragment::fromPlan(op, std::move(columns));
+    if (!fragment) {
+        return nullptr;
+    }
+
+    std::vector<ColumnDescriptor> schema;
+    for (const ColumnId& column : fragment->columns) {
+        auto type = catalog_->getColumnType(column);
+        if (!type) {
+            throw InternalSQLError("Column " + column.getName() + " not found in catalog");
+        }
+        schema.push_back({column, *type});
+    }
+    Logger::debug("PhysicalPlanner: gathering {} columns of {} from the workers", schema.size(),
+                  schema.front().columnId.getTableId().getName());
+    return plan.add<GatherExec>(dispatcher_, fragment->encode(), std::move(schema));
+}
+
+PhysicalOperator* PhysicalPlanner::lowerGatherAggregate(const AggregateOp* aggregate, PhysicalQueryPlan& plan) {
+    std::vector<ColumnId> columns;
+    auto addColumn = [&columns](const ColumnId& column) {
+        if (std::find(columns.begin(), columns.end(), column) == columns.end()) {
+            columns.push_back(column);
+        }
+    };
+    for (const ColumnDescriptor& key : aggregate->getGroupBy()) {
+        addColumn(key.columnId);
+    }
+    for (const AggregateSpec& spec : aggregate->getAggregates()) {
+        if (spec.function != AggregateFunction::COUNT_STAR) {
+            addColumn(spec.input);
+        }
+    }
+    std::optional<PlanFragment> fragment = PlanFragment::fromPlan(aggregate->getChild(0).get(), std::move(columns));
+    if (!fragment) {
+        return nullptr;
+    }
+
+    fragment->aggregate(aggregate->getGroupBy(), aggregate->getAggregates());
+    Logger::debug("PhysicalPlanner: aggregating {} partially on the workers",
+                  fragment->columns.front().getTableId().getName());
+    return plan.add<GatherAggregateExec>(dispatcher_, fragment->encode(), aggregate->getGroupBy(),
+                                         aggregate->getAggregates());
+}
+
+PhysicalOperator* PhysicalPlanner::lowerJoin(const LogicalOperator* op, const PredicateExpr* condition, JoinType joinType,
+                                             const std::optional<ColumnSet>& required, PhysicalQueryPlan& plan) {
+    tdb_assert(op->getChildCount() == 2, "Join must have two inputs, got {}", op->getChildCount());
+    const LogicalOperator* left = op->getChild(0).get();
+    const LogicalOperator* right = op->getChild(1).get();
+
+    ColumnSet referenced;
+    if (condition) {
+        addPredicateColumns(condition, referenced);
+    }
+    std::optional<ColumnSet> inputRequired = withColumns(required, referenced);
+
+    // The workers don't repartition their rows by the join key, gathered inputs are joined by the coordinator
+    if (dispatcher_) {
+        for (const LogicalOperator* input : {left, right}) {
+            if (!PlanFragment::canDistribute(input)) {
+                continue;
+            }
+            double rows = estimateRows(input);
+            if (rows > GATHER_JOIN_MAX_ROWS) {
+                throw NotYetImplementedError("Joins of inputs gathered from a cluster with more than " +
+                                             std::to_string(static_cast<int64_t>(GATHER_JOIN_MAX_ROWS)) +
+                                             " rows, estimated " + std::to_string(static_cast<int64_t>(rows)));
+            }
+        }
+    }
+
+    if (condition && joinType != JoinType::CROSS) {
+        auto keys = getEquiJoinKeys(condition, getOutputColumns(left), getOutputColumns(right));
+        if (keys) {
+            auto [leftKey, rightKey] = *keys;
+            PhysicalOperator* build = lower(left, inputRequired, plan);
+            PhysicalOperator* probe = lower(right, inputRequired, plan);
+            auto buildKey = std::make_unique<ColumnRefExpr>(leftKey->getColumnId(), leftKey->getType());
+            auto probeKey = std::make_unique<ColumnRefExpr>(rightKey->getColumnId(), rightKey->getType());
+
+            if (isSortedOn(left, leftKey, right, rightKey)) {
+                Logger::debug("PhysicalPlanner: merging inputs sorted on {} and {}", leftKey->getColumnId().getName(),
+                              rightKey->getColumnId().getName());
+                return plan.add<SortMergeJoinExec>(build, probe, std::move(buildKey), std::move(probeKey),
+                                                   CompareOp::EQUAL, joinType);
+            }
+
+            double buildRows = estimateRows(left);
+            double probeRows = estimateRows(right);
+            // The gathered inputs of a cluster are partitioned by the coordinator, whatever their size
+            if (dispatcher_ || std::min(buildRows, probeRows) >= RADIX_JOIN_MIN_ROWS) {
+                Logger::debug("PhysicalPlanner: radix partitioning join of {} and {} estimated rows", buildRows, probeRows);
+                return plan.add<RadixHashJoinExec>(build, probe, std::move(buildKey), std::move(probeKey), joinType,
+                                                   workerCount_);
+            }
+            return plan.add<HashJoinExec>(build, probe, std::move(buildKey), std::move(probeKey), joinType);
+        }
+    }
+
+    if (joinType != JoinType::INNER && joinType != JoinType::CROSS) {
+        throw NotYetImplementedError("Outer joins without an equality condition");
+    }
+
+    if (condition && joinType == JoinType::INNER) {
+        auto keys = getRangeJoinKeys(condition, getOutputColumns(left), getOutputColumns(right));
+        if (keys && isSortedOn(left, std::get<0>(*keys), right, std::get<1>(*keys))) {
+            auto [leftKey, rightKey, op] = *keys;
+            PhysicalOperator* build = lower(left, inputRequired, plan);
+            PhysicalOperator* probe = lower(right, inputRequired, plan);
+            return plan.add<SortMergeJoinExec>(build, probe,
+                                               std::make_unique<ColumnRefExpr>(leftKey->getColumnId(), leftKey->getType()),
+                                               std::make_unique<ColumnRefExpr>(rightKey->getColumnId(), rightKey->getType()),
+                                               op);
+        }
+    }
+
+    // Cross products keep every pair
+    std::unique_ptr<PredicateExpr> joinExpr = condition ? condition->clone()
+                                                        : std::make_unique<ConstantExpr>(DataType::getBool(), true);
+    PhysicalOperator* build = lower(left, inputRequired, plan);
+    PhysicalOperator* probe = lower(right, inputRequired, plan);
+    return plan.add<NestedLoopJoinExec>(build, probe, std::move(joinExpr));
+}
+
+}  // namespace toydb
@@ -0,0 +1,412 @@
+#include "planner/plan_fragment.hpp"
+#include <algorithm>
+#include <cstring>
+#include "common/errors.hpp"
+#include "engine/spill.hpp"
+#include "planner/physical_planner.hpp"
+
+namespace toydb {
+
+// Changes whenever the encoding does, so that workers reject fragments of other versions
+static constexpr uint8_t FRAGMENT_VERSION = 1;
+
+enum class ExprTag : uint8_t {
+    COLUMN,
+    CONSTANT,
+    CAST,
+    COMPARE,
+    LOGICAL,
+};
+
+template<typename T>
+static void appendValue(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void appendString(std::string& out, std::string_view value) {
+    appendValue(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+static void appendType(std::string& out, DataType type) {
+    appendValue(out, static_cast<uint8_t>(type.getType()));
+}
+
+/**
+ * @brief Reads the values written by the append functions
+ */
+class FragmentReader {
+private:
+    std::string_view bytes_;
+
+    [[noreturn]] static void malformed() {
+        throw SQLRuntimeException("Malformed plan fragment");
+    }
+
+public:
+    explicit FragmentReader(std::string_view bytes) : bytes_(bytes) {}
+
+    template<typename T>
+    T read() {
+        if (bytes_.size() < sizeof(T)) {
+            malformed();
+        }
+        T value;
+        std::memcpy(&value, bytes_.data(), sizeof(T));
+        bytes_.remove_prefix(sizeof(T));
+        return value;
+    }
+
+    std::string readString() {
+        auto length = read<uint32_t>();
+        if (bytes_.size() < length) {
+            malformed();
+        }
+        std::string value(bytes_.substr(0, length));
+        bytes_.remove_prefix(length);
+        return value;
+    }
+
+    DataType readType() {
+        auto type = read<uint8_t>();
+        if (type > static_cast<uint8_t>(DataType::Type::STRING)) {
+            malformed();
+        }
+        return DataType(static_cast<DataType::Type>(type));
+    }
+
+    bool atEnd() const noexcept {
+        return bytes_.empty();
+    }
+};
+
+/**
+ * @brief Whether the expression consists of the kinds of expressions appendPredicate() encodes.
+ *        Runtime filters, e.g. bloom filters, are not part of logical plans.
+ */
+static bool isEncodable(const PredicateExpr* expr) {
+    if (dynamic_cast<const ColumnRefExpr*>(expr) || dynamic_cast<const ConstantExpr*>(expr)) {
+        return true;
+    }
+    if (auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+        return isEncodable(cast->getExpr());
+    }
+    if (auto* compare = dynamic_cast<const CompareExpr*>(expr)) {
+        return isEncodable(compare->getLeft()) && isEncodable(compare->getRight());
+    }
+    if (auto* logical = dynamic_cast<const LogicalExpr*>(expr)) {
+        return isEncodable(logical->getLeft()) && isEncodable(logical->getRight());
+    }
+    return false;
+}
+
+static void appendPredicate(std::string& out, const PredicateExpr* expr) {
+    if (auto* column = dynamic_cast<const ColumnRefExpr*>(expr)) {
+        appendValue(out, ExprTag::COLUMN);
+        appendString(out, column->getColumnId().getName());
+        appendType(out, column->getType());
+    } else if (auto* constant = dynamic_cast<const ConstantExpr*>(expr)) {
+        // Parameter slots are sent with the value bound to them
+        DataType type = constant->getType();
+        appendValue(out, ExprTag::CONSTANT);
+        appendType(out, type);
+        if (constant->isNull()) {
+            return;
+        }
+        if (type == DataType::getDouble()) {
+            appendValue(out, constant->getDoubleValue());
+        } else if (type == DataType::getBool()) {
+            appendValue(out, static_cast<uint8_t>(constant->getBoolValue()));
+        } else if (type == DataType::getString()) {
+            appendString(out, constant->getStringValue());
+        } else {
+            appendValue(out, constant->getIntValue());
+        }
+    } else if (auto* cast = dynamic_cast<const CastExpr*>(expr)) {
+        appendValue(out, ExprTag::CAST);
+        appendType(out, cast->getType());
+        appendPredicate(out, cast->getExpr());
+    } else if (auto* compare = dynamic_cast<const CompareExpr*>(expr)) {
+        appendValue(out, ExprTag::COMPARE);
+        appendValue(out, static_cast<uint8_t>(compare->getOp()));
+        appendType(out, compare->getType());
+        appendPredicate(out, compare->getLeft());
+        appendPredicate(out, compare->getRight());
+    } else if (auto* logical = dynamic_cast<const LogicalExpr*>(expr)) {
+        appendValue(out, ExprTag::LOGICAL);
+        appendValue(out, static_cast<uint8_t>(logical->getOp()));
+        appendPredicate(out, logical->getLeft());
+        appendPredicate(out, logical->getRight());
+    } else {
+        tdb_unreachable("Plan fragments cannot encode this expression");
+    }
+}
+
+static CompareOp readCompareOp(FragmentReader& in) {
+    auto op = in.read<uint8_t>();
+    if (op > static_cast<uint8_t>(CompareOp::NOT)) {
+        throw SQLRuntimeException("Malformed plan fragment");
+    }
+    return static_cast<CompareOp>(op);
+}
+
+static std::unique_ptr<PredicateExpr> readPredicate(FragmentReader& in,
+                                                    const std::function<ColumnId(const std::string&)>& resolve) {
+    switch (in.read<ExprTag>()) {
+        case ExprTag::COLUMN: {
+            ColumnId column = resolve(in.readString());
+            return std::make_unique<ColumnRefExpr>(column, in.readType());
+        }
+        case ExprTag::CONSTANT: {
+            DataType type = in.readType();
+            if (type == DataType::getNullConst()) {
+                return std::make_unique<ConstantExpr>();
+            }
+            if (type == DataType::getDouble()) {
+                return std::make_unique<ConstantExpr>(type, in.read<double>());
+            }
+            if (type == DataType::getBool()) {
+                return std::make_unique<ConstantExpr>(type, in.read<uint8_t>() != 0);
+            }
+            if (type == DataType::getString()) {
+                return std::make_unique<ConstantExpr>(type, in.readString());
+            }
+            return std::make_unique<ConstantExpr>(type, in.read<int64_t>());
+        }
+        case ExprTag::CAST: {
+            DataType type = in.readType();
+            return std::make_unique<CastExpr>(type, readPredicate(in, resolve));
+        }
+        case ExprTag::COMPARE: {
+            CompareOp op = readCompareOp(in);
+            DataType type = in.readType();
+            auto left = readPredicate(in, resolve);
+            auto right = readPredicate(in, resolve);
+            return std::make_unique<CompareExpr>(op, type, std::move(left), std::move(right));
+        }
+        case ExprTag::LOGICAL: {
+            CompareOp op = readCompareOp(in);
+            auto left = readPredicate(in, resolve);
+            auto right = readPredicate(in, resolve);
+            return std::make_unique<LogicalExpr>(op, std::move(left), std::move(right));
+        }
+    }
+    throw SQLRuntimeException("Malformed plan fragment");
+}
+
+bool PlanFragment::canDistribute(const LogicalOperator* op) {
+    if (dynamic_cast<const TableScanOp*>(op)) {
+        return true;
+    }
+    if (dynamic_cast<const FilterOp*>(op)) {
+        return canDistribute(op->getChild(0).get());
+    }
+    if (auto* projection = dynamic_cast<const ProjectionOp*>(op)) {
+        return !projection->hasExpressions() && canDistribute(op->getChild(0).get());
+    }
+    return false;
+}
+
+std::optional<PlanFragment> PlanFragment::fromPlan(const LogicalOperator* op, std::vector<ColumnId> columns) {
+    tdb_assert(canDistribute(op), "Operator cannot run on the workers");
+
+    PlanFragment fragment;
+    std::vector<std::unique_ptr<PredicateExpr>> conjuncts;
+    while (!dynamic_cast<const TableScanOp*>(op)) {
+        if (auto* filter = dynamic_cast<const FilterOp*>(op)) {
+            if (!isEncodable(filter->getPredicate())) {
+                return std::nullopt;
+            }
+            splitConjuncts(filter->getPredicate(), conjuncts);
+        }
+        op = op->getChild(0).get();
+    }
+
+    const auto* scan = static_cast<const TableScanOp*>(op);
+    // Batches need a column to carry their row count, e.g. for COUNT(*)
+    if (columns.empty()) {
+        columns.push_back(scan->getColumns().front());
+    }
+    fragment.columns = std::move(columns);
+    fragment.sample = scan->getSample();
+    if (!conjuncts.empty()) {
+        fragment.predicate = combineConjuncts(std::move(conjuncts));
+    }
+    return fragment;
+}
+
+std::string PlanFragment::encode() const {
+    tdb_assert(!columns.empty(), "Plan fragment without columns");
+
+    std::string out;
+    appendValue(out, FRAGMENT_VERSION);
+    appendString(out, columns.front().getTableId().getName());
+    appendValue(out, static_cast<uint32_t>(columns.size()));
+    for (const ColumnId& column : columns) {
+        appendString(out, column.getName());
+    }
+
+    appendValue(out, static_cast<uint8_t>(predicate != nullptr));
+    if (predicate) {
+        appendPredicate(out, predicate.get());
+    }
+
+    appendValue(out, static_cast<uint8_t>(sample.has_value()));
+    if (sample) {
+        appendValue(out, static_cast<uint8_t>(sample->method));
+        appendValue(out, sample->percent);
+        appendValue(out, static_cast<uint8_t>(sample->seed.has_value()));
+        appendValue(out, sample->seed.value_or(0));
+    }
+
+    appendValue(out, static_cast<uint32_t>(groupBy.size()));
+    for (const ColumnDescriptor& key : groupBy) {
+        appendString(out, key.columnId.getName());
+        appendType(out, key.type);
+    }
+    appendValue(out, static_cast<uint32_t>(aggregates.size()));
+    for (const AggregateSpec& spec : aggregates) {
+        appendValue(out, static_cast<uint8_t>(spec.function));
+        appendString(out, spec.function == AggregateFunction::COUNT_STAR ? std::string() : spec.input.getName());
+        appendType(out, spec.inputType);
+        appendString(out, spec.output.getName());
+        appendValue(out, spec.quantile);
+    }
+    return out;
+}
+
+PlanFragment PlanFragment::decode(std::string_view bytes, const Catalog& catalog) {
+    FragmentReader in(bytes);
+    if (in.read<uint8_t>() != FRAGMENT_VERSION) {
+        throw SQLRuntimeException("Plan fragment of an unsupported version");
+    }
+
+    std::string tableName = in.readString();
+    std::optional<TableId> tableId = catalog.getTableIdByName(tableName);
+    if (!tableId) {
+        throw SQLRuntimeException("Unknown table " + tableName);
+    }
+    auto resolve = [&](const std::string& name) {
+        auto column = catalog.resolveColumn(*tableId, name);
+        if (!column) {
+            throw UnresolvedColumnException("Column '" + tableName + "." + name + "' not found");
+        }
+        return *column;
+    };
+
+    PlanFragment fragment;
+    auto columnCount = in.read<uint32_t>();
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        fragment.columns.push_back(resolve(in.readString()));
+    }
+    if (fragment.columns.empty()) {
+        throw SQLRuntimeException("Malformed plan fragment");
+    }
+
+    if (in.read<uint8_t>() != 0) {
+        fragment.predicate = readPredicate(in, resolve);
+    }
+
+    if (in.read<uint8_t>() != 0) {
+        TableSample sample {};
+        sample.method = in.read<uint8_t>() == 0 ? SampleMethod::BERNOULLI : SampleMethod::SYSTEM;
+        sample.percent = in.read<double>();
+        bool seeded = in.read<uint8_t>() != 0;
+        auto seed = in.read<uint64_t>();
+        if (seeded) {
+            sample.seed = seed;
+        }
+        fragment.sample = sample;
+    }
+
+    auto keyCount = in.read<uint32_t>();
+    for (uint32_t i = 0; i < keyCount; ++i) {
+        ColumnId column = resolve(in.readString());
+        fragment.groupBy.push_back({column, in.readType()});
+    }
+    auto aggregateCount = in.read<uint32_t>();
+    for (uint32_t i = 0; i < aggregateCount; ++i) {
+        auto function = in.read<uint8_t>();
+        if (function > static_cast<uint8_t>(AggregateFunction::APPROX_QUANTILE)) {
+            throw SQLRuntimeException("Malformed plan fragment");
+        }
+        AggregateSpec spec {};
+        spec.function = static_cast<AggregateFunction>(function);
+        std::string input = in.readString();
+        if (spec.function != AggregateFunction::COUNT_STAR) {
+            spec.input = resolve(input);
+        }
+        spec.inputType = in.readType();
+        spec.output = ColumnId(AggregateOp::OUTPUT_COLUMN_ID_BASE + i, in.readString());
+        spec.quantile = in.read<double>();
+        fragment.aggregates.push_back(std::move(spec));
+    }
+
+    if (!in.atEnd()) {
+        throw SQLRuntimeException("Malformed plan fragment");
+    }
+    return fragment;
+}
+
+int64_t PlanFragment::run(PhysicalPlanner& planner, const std::function<void(std::string_view)>& out) const {
+    // The scan reads the produced columns and those the predicate and the aggregates reference
+    std::vector<ColumnId> scanned = columns;
+    auto addScanned = [&scanned](const ColumnId& column) {
+        if (std::find(scanned.begin(), scanned.end(), column) == scanned.end()) {
+            scanned.push_back(column);
+        }
+    };
+    if (predicate) {
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(predicate.get(), refs);
+        for (const ColumnRefExpr* ref : refs) {
+            addScanned(ref->getColumnId());
+        }
+    }
+    for (const ColumnDescriptor& key : groupBy) {
+        addScanned(key.columnId);
+    }
+    for (const AggregateSpec& spec : aggregates) {
+        if (spec.function != AggregateFunction::COUNT_STAR) {
+            addScanned(spec.input);
+        }
+    }
+
+    std::shared_ptr<LogicalOperator> root = std::make_shared<TableScanOp>(std::move(scanned), sample);
+    if (predicate) {
+        auto filter = std::make_shared<FilterOp>(predicate->clone());
+        filter->addChild(root);
+        root = filter;
+    }
+    if (!isAggregated()) {
+        auto projection = std::make_shared<ProjectionOp>(columns);
+        projection->addChild(root);
+        root = projection;
+    }
+    PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(root));
+
+    if (isAggregated()) {
+        memory::BufferManager bufferManager;
+        AggregateHashTable table(groupBy, aggregates, &bufferManager);
+        plan.run([&table](const RowVector& batch) { table.consume(batch); });
+        return table.exportPartialStates(out, PAYLOAD_SIZE);
+    }
+
+    std::string payload;
+    int64_t rowCount = plan.run([&](const RowVector& batch) {
+        if (batch.getSelectedRowCount() == 0) {
+            return;
+        }
+        BatchCodec::encode(batch, payload);
+        if (payload.size() >= PAYLOAD_SIZE) {
+            out(payload);
+            payload.clear();
+        }
+    });
+    if (!payload.empty()) {
+        out(payload);
+    }
+    return rowCount;
+}
+
+}  // namespace toydb
@@ -0,0 +1,236 @@
+#include "planner/prepared_statement.hpp"
+#include <fmt/format.h>
+#include <limits>
+#include <unordered_set>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "parser/lexer.hpp"
+#include "parser/parser.hpp"
+#include "planner/interpreter.hpp"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/rule_based_optimizer.hpp"
+
+namespace toydb {
+
+static void collectPlanParameters(LogicalOperator* op, std::unordered_set<const LogicalOperator*>& visited,
+                                  std::vector<ConstantExpr*>& out) {
+    if (!visited.insert(op).second) {
+        return;
+    }
+    if (auto* filter = dynamic_cast<FilterOp*>(op)) {
+        collectParameters(filter->getPredicate(), out);
+    } else if (auto* join = dynamic_cast<JoinOp*>(op); join && join->getCondition()) {
+        collectParameters(join->getCondition(), out);
+    }
+    for (const auto& child : op->getChildren()) {
+        collectPlanParameters(child.get(), visited, out);
+    }
+}
+
+CachedPlan::CachedPlan(LogicalQueryPlan plan, size_t parameterCount, uint64_t catalogVersion)
+    : plan_(std::move(plan)), catalogVersion_(catalogVersion), slots_(parameterCount) {
+    std::vector<ConstantExpr*> slots;
+    if (plan_.hasRoot()) {
+        std::unordered_set<const LogicalOperator*> visited;
+        collectPlanParameters(plan_.getRoot(), visited, slots);
+    }
+    for (ConstantExpr* slot : slots) {
+        size_t index = *slot->getParameterIndex();
+        tdb_assert(index < parameterCount, "Parameter {} out of range of {} parameters", index, parameterCount);
+        slots_[index].push_back(slot);
+    }
+
+    for (size_t index = 0; index < parameterCount; ++index) {
+        if (slots_[index].empty()) {
+            throw InternalSQLError(fmt::format("Parameter {} is not used in a predicate", index));
+        }
+        parameterTypes_.push_back(slots_[index].front()->getType());
+    }
+}
+
+DataType CachedPlan::getParameterType(size_t index) const {
+    tdb_assert(index < parameterTypes_.size(), "Parameter {} out of range", index);
+    return parameterTypes_[index];
+}
+
+PhysicalQueryPlan CachedPlan::instantiate(const std::vector<ConstantExpr>& values, PhysicalPlanner& planner) {
+    tdb_assert(values.size() == slots_.size(), "{} values bound to {} parameters", values.size(), slots_.size());
+    std::lock_guard lock(mutex_);
+    for (size_t index = 0; index < slots_.size(); ++index) {
+        for (ConstantExpr* slot : slots_[index]) {
+            slot->bindValue(values[index]);
+        }
+    }
+    return planner.plan(plan_);
+}
+
+PreparedStatement::PreparedStatement(std::shared_ptr<CachedPlan> plan)
+    : plan_(std::move(plan)), values_(plan_->getParameterCount()) {}
+
+DataType PreparedStatement::getParameterType(size_t index) const {
+    if (index >= values_.size()) {
+        throw SQLRuntimeException(fmt::format("Parameter {} out of range, the statement has {}", index, values_.size()));
+    }
+    return plan_->getParameterType(index);
+}
+
+void PreparedStatement::bind(size_t index, const ParameterValue& value) {
+    DataType type = getParameterType(index);
+    std::optional<ConstantExpr>& slot = values_[index];
+
+    if (type == DataType::getInt32() || type == DataType::getInt64()) {
+        if (const int64_t* integer = std::get_if<int64_t>(&value)) {
+            bool fits = type == DataType::getInt64() || (*integer >= std::numeric_limits<int32_t>::min() &&
+                                                         *integer <= std::numeric_limits<int32_t>::max());
+            if (!fits) {
+                throw SQLRuntimeException(fmt::format("Value {} of parameter {} out of range of {}", *integer, index,
+                                                      type.toString()));
+            }
+            slot.emplace(type, *integer);
+            return;
+        }
+    } else if (type == DataType::getDouble()) {
+        if (const double* real = std::get_if<double>(&value)) {
+            slot.emplace(type, *real);
+            return;
+        } else if (const int64_t* integer = std::get_if<int64_t>(&value)) {
+            slot.emplace(type, static_cast<double>(*integer));
+            return;
+        }
+    } else if (type == DataType::getBool()) {
+        if (const bool* boolean = std::get_if<bool>(&value)) {
+            slot.emplace(type, *boolean);
+            return;
+        }
+    } else if (type == DataType::getString()) {
+        if (const std::string* string = std::get_if<std::string>(&value)) {
+            slot.emplace(type, *string);
+            return;
+        }
+    }
+    throw SQLRuntimeException(fmt::format("Parameter {} expects a value of type {}", index, type.toString()));
+}
+
+void PreparedStatement::clearBindings() {
+    for (std::optional<ConstantExpr>& value : values_) {
+        value.reset();
+    }
+}
+
+PhysicalQueryPlan PreparedStatement::createPlan(PhysicalPlanner& planner) const {
+    std::vector<ConstantExpr> values;
+    values.reserve(values_.size());
+    for (size_t index = 0; index < values_.size(); ++index) {
+        if (!values_[index]) {
+            throw SQLRuntimeException(fmt::format("Parameter {} is not bound", index));
+        }
+        values.push_back(*values_[index]);
+    }
+    return plan_->instantiate(values, planner);
+}
+
+PlanCache::PlanCache(Catalog* catalog, size_t capacity) : catalog_(catalog), capacity_(capacity) {}
+
+std::string PlanCache::normalize(std::string_view query) {
+    using parser::TokenType;
+
+    std::string normalized;
+    parser::TokenStream tokens(query);
+    for (parser::Token token = tokens.next(); token.type != TokenType::EndOfFile; token = tokens.next()) {
+        if (token.type == TokenType::EndOfStatement && tokens.peek().type == TokenType::EndOfFile) {
+            break;
+        }
+        if (!normalized.empty()) {
+            normalized += ' ';
+        }
+        if (token.type == TokenType::StringLiteral) {
+            normalized += '\'';
+            normalized += token.getString();
+            normalized += '\'';
+        } else if (token.type == TokenType::DoubleLiteral) {
+            // Shortest representation that round-trips, so distinct literals stay distinct
+            normalized += fmt::format("{}", token.getDouble());
+        } else {
+            normalized += token.toString();
+        }
+    }
+    return normalized;
+}
+
+std::shared_ptr<CachedPlan> PlanCache::lookup(const std::string& key, uint64_t catalogVersion) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.plan->getCatalogVersion() != catalogVersion) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second.position);
+    return it->second.plan;
+}
+
+void PlanCache::insert(const std::string& key, std::shared_ptr<CachedPlan> plan) {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        lru_.erase(it->second.position);
+        entries_.erase(it);
+    }
+    lru_.push_front(key);
+    entries_[key] = {std::move(plan), lru_.begin()};
+
+    while (entries_.size() > capacity_) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
+
+std::expected<PreparedStatement, std::string> PlanCache::prepare(std::string_view query) {
+    std::string key = normalize(query);
+    uint64_t catalogVersion = catalog_->getVersion();
+    if (auto plan = lookup(key, catalogVersion)) {
+        return PreparedStatement(std::move(plan));
+    }
+
+    auto ast = parser::Parser{query}.parseQuery();
+    if (!ast) {
+        return std::unexpected(ast.error());
+    }
+
+    CatalogQueryAdapter queryCatalog(catalog_);
+    SQLInterpreter interpreter(&queryCatalog);
+    auto logicalPlan = interpreter.interpret(**ast);
+    if (!logicalPlan) {
+        throw InternalSQLError("Query could not be interpreted");
+    }
+    JoinOrderOptimizer(catalog_).optimize(*logicalPlan);
+    RuleBasedOptimizer(catalog_).optimize(*logicalPlan);
+
+    auto plan = std::make_shared<CachedPlan>(std::move(*logicalPlan), (*ast)->parameterCount, catalogVersion);
+    Logger::debug("PlanCache: planned '{}' with {} parameters", key, plan->getParameterCount());
+    insert(key, plan);
+    return PreparedStatement(std::move(plan));
+}
+
+void PlanCache::clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+}
+
+size_t PlanCache::size() const {
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+int64_t PlanCache::getHitCount() const {
+    std::lock_guard lock(mutex_);
+    return hits_;
+}
+
+int64_t PlanCache::getMissCount() const {
+    std::lock_guard lock(mutex_);
+    return misses_;
+}
+
+}  // namespace toydb
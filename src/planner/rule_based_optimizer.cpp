@@ -0,0 +1,269 @@
+#include "planner/rule_based_optimizer.hpp"
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include "engine/compare_kernels.hpp"
+
+namespace toydb {
+
+// Costs relative to comparing a column with a constant
+static constexpr double COLUMN_COMPARE_COST = 2.0;
+static constexpr double STRING_COMPARE_FACTOR = 4.0;
+static constexpr double BLOOM_FILTER_COST = 3.0;
+
+// Operands expected to decide no row still rank by their cost
+static constexpr double MIN_DECIDED_FRACTION = 1e-6;
+
+static std::unique_ptr<PredicateExpr> makeTruth(PredicateValue value) {
+    // Only TRUE rows are kept, NULL is as good as FALSE
+    return std::make_unique<ConstantExpr>(DataType::getBool(), value == PredicateValue::TRUE);
+}
+
+/**
+ * @brief A constant operand, looking through casts. Parameters are not constant until they are bound.
+ */
+static const ConstantExpr* asConstant(const PredicateExpr* expr) {
+    auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(expr));
+    return constant && !constant->getParameterIndex() ? constant : nullptr;
+}
+
+/**
+ * @brief The value of a predicate that is the same for every row
+ */
+static std::optional<PredicateValue> getConstantValue(const PredicateExpr* predicate) {
+    auto* constant = dynamic_cast<const ConstantExpr*>(predicate);
+    if (!constant || constant->getParameterIndex()) {
+        return std::nullopt;
+    }
+    return constant->getPredicateValue();
+}
+
+static bool isJoinNode(const LogicalOperator* op) {
+    return dynamic_cast<const CrossProductOp*>(op) || dynamic_cast<const JoinOp*>(op);
+}
+
+static void flattenOperands(const PredicateExpr* predicate, CompareOp op, std::vector<const PredicateExpr*>& out) {
+    if (auto* logical = dynamic_cast<const LogicalExpr*>(predicate); logical && logical->getOp() == op) {
+        flattenOperands(logical->getLeft(), op, out);
+        flattenOperands(logical->getRight(), op, out);
+        return;
+    }
+    out.push_back(predicate);
+}
+
+std::unique_ptr<PredicateExpr> RuleBasedOptimizer::simplify(std::unique_ptr<PredicateExpr> predicate) {
+    if (auto value = getConstantValue(predicate.get())) {
+        return makeTruth(*value);
+    }
+
+    if (auto* compare = dynamic_cast<const CompareExpr*>(predicate.get())) {
+        const ConstantExpr* left = asConstant(compare->getLeft());
+        const ConstantExpr* right = asConstant(compare->getRight());
+        if ((left && left->isNull()) || (right && right->isNull())) {
+            return makeTruth(PredicateValue::NULL_VALUE);
+        }
+        if (left && right) {
+            return makeTruth(kernels::compareRow(compare->getOp(), kernels::getCompareDomain(compare->getType()),
+                                                 constantOperand(*left), constantOperand(*right), 0));
+        }
+        return predicate;
+    }
+
+    auto* logical = dynamic_cast<const LogicalExpr*>(predicate.get());
+    if (!logical) {
+        return predicate;
+    }
+    auto left = simplify(logical->getLeft()->clone());
+    auto right = simplify(logical->getRight()->clone());
+    auto leftValue = getConstantValue(left.get());
+    auto rightValue = getConstantValue(right.get());
+
+    // FALSE decides an AND and TRUE an OR, the other value leaves the result to the other operand
+    PredicateValue decisive = logical->getOp() == CompareOp::AND ? PredicateValue::FALSE : PredicateValue::TRUE;
+    if (leftValue == decisive || rightValue == decisive) {
+        return makeTruth(decisive);
+    }
+    if (leftValue) {
+        return right;
+    }
+    if (rightValue) {
+        return left;
+    }
+    return std::make_unique<LogicalExpr>(logical->getOp(), std::move(left), std::move(right));
+}
+
+double RuleBasedOptimizer::estimateCost(const PredicateExpr* predicate) {
+    if (auto* logical = dynamic_cast<const LogicalExpr*>(predicate)) {
+        double selectivity = estimator_.estimateSelectivity(logical->getLeft());
+        // The right operand only runs for the rows the left one leaves undecided
+        double undecided = logical->getOp() == CompareOp::AND ? selectivity : 1.0 - selectivity;
+        return estimateCost(logical->getLeft()) + undecided * estimateCost(logical->getRight());
+    }
+
+    if (auto* compare = dynamic_cast<const CompareExpr*>(predicate)) {
+        bool columns = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft())) &&
+                       dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+        double cost = columns ? COLUMN_COMPARE_COST : 1.0;
+        if (kernels::getCompareDomain(compare->getType()) == kernels::CompareDomain::STRING) {
+            cost *= STRING_COMPARE_FACTOR;
+        }
+        return cost;
+    }
+
+    if (dynamic_cast<const BloomFilterExpr*>(predicate)) {
+        return BLOOM_FILTER_COST;
+    }
+    if (dynamic_cast<const ConstantExpr*>(predicate)) {
+        return 0.0;
+    }
+    return 1.0;
+}
+
+std::unique_ptr<PredicateExpr> RuleBasedOptimizer::reorder(std::unique_ptr<PredicateExpr> predicate) {
+    auto* logical = dynamic_cast<const LogicalExpr*>(predicate.get());
+    if (!logical) {
+        return predicate;
+    }
+
+    CompareOp op = logical->getOp();
+    std::vector<const PredicateExpr*> operands;
+    flattenOperands(predicate.get(), op, operands);
+
+    struct RankedOperand {
+        std::unique_ptr<PredicateExpr> predicate;
+        double rank;
+    };
+    std::vector<RankedOperand> ranked;
+    for (const PredicateExpr* operand : operands) {
+        auto reordered = reorder(operand->clone());
+        double selectivity = estimator_.estimateSelectivity(reordered.get());
+        // Rows the operand decides: those it is FALSE for in an AND, TRUE for in an OR
+        double decided = op == CompareOp::AND ? 1.0 - selectivity : selectivity;
+        double rank = estimateCost(reordered.get()) / std::max(decided, MIN_DECIDED_FRACTION);
+        ranked.push_back({std::move(reordered), rank});
+    }
+    // Ties keep the order the query was written in
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const RankedOperand& a, const RankedOperand& b) { return a.rank < b.rank; });
+
+    std::unique_ptr<PredicateExpr> result = std::move(ranked[0].predicate);
+    for (size_t i = 1; i < ranked.size(); ++i) {
+        result = std::make_unique<LogicalExpr>(op, std::move(result), std::move(ranked[i].predicate));
+    }
+    return result;
+}
+
+void RuleBasedOptimizer::optimize(LogicalQueryPlan& plan) {
+    if (!plan.hasRoot()) {
+        return;
+    }
+    // Filters pass their input through, so the columns of the root don't change
+    plan.setRoot(pushFilters(plan.getSharedRoot(), {}));
+}
+
+std::shared_ptr<LogicalOperator> RuleBasedOptimizer::pushFilters(const std::shared_ptr<LogicalOperator>& op,
+                                                                 std::vector<std::unique_ptr<PredicateExpr>> conjuncts) {
+    if (auto* filter = dynamic_cast<const FilterOp*>(op.get())) {
+        auto predicate = simplify(filter->getPredicate()->clone());
+        if (getConstantValue(predicate.get()) != PredicateValue::TRUE) {
+            splitConjuncts(predicate.get(), conjuncts);
+        }
+        std::shared_ptr<LogicalOperator> input = op->getChild(0);
+        input->removeParent(op.get());
+        return pushFilters(input, std::move(conjuncts));
+    }
+
+    if (isJoinNode(op.get())) {
+        return pushIntoJoin(op, std::move(conjuncts));
+    }
+
+    // Anything else keeps the conjuncts above it, its inputs are optimized on their own
+    for (size_t i = 0; i < op->getChildCount(); ++i) {
+        std::shared_ptr<LogicalOperator> child = op->getChild(i);
+        std::shared_ptr<LogicalOperator> optimized = pushFilters(child, {});
+        if (optimized != child) {
+            op->replaceChild(i, optimized);
+        }
+    }
+    return addFilter(op, std::move(conjuncts));
+}
+
+std::shared_ptr<LogicalOperator> RuleBasedOptimizer::pushIntoJoin(const std::shared_ptr<LogicalOperator>& op,
+                                                                  std::vector<std::unique_ptr<PredicateExpr>> conjuncts) {
+    auto* join = dynamic_cast<const JoinOp*>(op.get());
+    JoinType joinType = join ? join->getJoinType() : JoinType::CROSS;
+    bool inner = joinType == JoinType::INNER || joinType == JoinType::CROSS;
+
+    std::shared_ptr<LogicalOperator> left = op->getChild(0);
+    std::shared_ptr<LogicalOperator> right = op->getChild(1);
+    ColumnSet leftColumns = getOutputColumns(left.get());
+    ColumnSet rightColumns = getOutputColumns(right.get());
+
+    std::vector<std::unique_ptr<PredicateExpr>> intoLeft;
+    std::vector<std::unique_ptr<PredicateExpr>> intoRight;
+    // Moves a conjunct into an input that produces all the columns it references, if it may go there
+    auto place = [&](std::unique_ptr<PredicateExpr> conjunct, bool mayGoLeft, bool mayGoRight,
+                     std::vector<std::unique_ptr<PredicateExpr>>& rest) {
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(conjunct.get(), refs);
+        auto producedBy = [&refs](const ColumnSet& columns) {
+            return !refs.empty() && std::all_of(refs.begin(), refs.end(), [&columns](const ColumnRefExpr* ref) {
+                return columns.contains(ref->getColumnId());
+            });
+        };
+        if (mayGoLeft && producedBy(leftColumns)) {
+            intoLeft.push_back(std::move(conjunct));
+        } else if (mayGoRight && producedBy(rightColumns)) {
+            intoRight.push_back(std::move(conjunct));
+        } else {
+            rest.push_back(std::move(conjunct));
+        }
+    };
+
+    // A filter above an outer join must not remove the rows it keeps unmatched
+    std::vector<std::unique_ptr<PredicateExpr>> above;
+    for (auto& conjunct : conjuncts) {
+        place(std::move(conjunct), inner || joinType == JoinType::LEFT, inner || joinType == JoinType::RIGHT, above);
+    }
+
+    // The condition of an outer join only decides which rows of the other side match
+    std::unique_ptr<PredicateExpr> condition;
+    if (join && join->getCondition()) {
+        auto simplified = simplify(join->getCondition()->clone());
+        std::vector<std::unique_ptr<PredicateExpr>> split;
+        if (getConstantValue(simplified.get()) != PredicateValue::TRUE) {
+            splitConjuncts(simplified.get(), split);
+        }
+        std::vector<std::unique_ptr<PredicateExpr>> kept;
+        for (auto& conjunct : split) {
+            place(std::move(conjunct), inner || joinType == JoinType::RIGHT, inner || joinType == JoinType::LEFT, kept);
+        }
+        if (!kept.empty()) {
+            condition = reorder(combineConjuncts(std::move(kept)));
+        }
+    }
+
+    left->removeParent(op.get());
+    right->removeParent(op.get());
+    std::shared_ptr<LogicalOperator> result;
+    if (inner && !condition) {
+        result = std::make_shared<CrossProductOp>();
+    } else {
+        result = std::make_shared<JoinOp>(inner ? JoinType::INNER : joinType, std::move(condition));
+    }
+    result->addChild(pushFilters(left, std::move(intoLeft)));
+    result->addChild(pushFilters(right, std::move(intoRight)));
+    return addFilter(result, std::move(above));
+}
+
+std::shared_ptr<LogicalOperator> RuleBasedOptimizer::addFilter(std::shared_ptr<LogicalOperator> op,
+                                                               std::vector<std::unique_ptr<PredicateExpr>> conjuncts) {
+    if (conjuncts.empty()) {
+        return op;
+    }
+    auto filter = std::make_shared<FilterOp>(reorder(combineConjuncts(std::move(conjuncts))));
+    filter->addChild(std::move(op));
+    return filter;
+}
+
+}  // namespace toydb
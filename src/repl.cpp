@@ -1,14 +1,116 @@
+#include "common/metrics.hpp"
 #include "common/stacktrace.hpp"
 #include "parser/parser.hpp"
+#include "server/insert_log.hpp"
+#include "server/query_server.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "storage/write_ahead_log.hpp"
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 using namespace toydb;
 using namespace toydb::parser;
 
-int main() {
+static server::QueryServer* runningServer = nullptr;
+
+static void stopServer(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+
+/**
+ * @brief Parse a comma-separated list of host:port worker addresses
+ */
+static std::optional<std::vector<server::WorkerAddress>> parseWorkers(std::string_view list) {
+    std::vector<server::WorkerAddress> workers;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        auto worker = server::WorkerAddress::parse(list.substr(0, comma));
+        if (!worker) {
+            return std::nullopt;
+        }
+        workers.push_back(std::move(*worker));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    return workers;
+}
+
+/**
+ * @brief Serve the catalog to clients until interrupted, coordinating the workers if there are any
+ */
+static int serve(Catalog& catalog, uint16_t port, const std::filesystem::path& walPath,
+                 std::vector<server::WorkerAddress> workers) {
+    server::ServerOptions options;
+    options.port = port;
+    options.workers = std::move(workers);
+    options.wal = WalOptions::fromEnvironment();
+    options.walPath = walPath;
+    server::QueryServer queryServer(&catalog, options);
+
+    runningServer = &queryServer;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cout << "Listening on " << options.host << ":" << queryServer.getPort() << std::endl;
+    queryServer.run();
+    runningServer = nullptr;
+    return 0;
+}
+
+int main(int argc, char** argv) {
     std::string input;
     toydb::initializeSignalHandlers();
+
+    // Without a manifest, queries are only parsed
+    std::unique_ptr<JsonCatalog> catalog;
+    // INSERTs are logged next to the manifest if TOYDB_WAL is set
+    std::filesystem::path walPath;
+    if (argc > 1) {
+        catalog = std::make_unique<JsonCatalog>(argv[1]);
+        walPath = std::string(argv[1]) + ".wal";
+    }
+    if (catalog && argc > 3 && std::string(argv[2]) == "--listen") {
+        std::vector<server::WorkerAddress> workers;
+        if (argc > 5 && std::string(argv[4]) == "--workers") {
+            auto parsed = parseWorkers(argv[5]);
+            if (!parsed) {
+                std::cout << "Error: workers must be a list of host:port, got " << argv[5] << std::endl;
+                return 1;
+            }
+            workers = std::move(*parsed);
+        }
+        return serve(*catalog, static_cast<uint16_t>(std::stoi(argv[3])), walPath, std::move(workers));
+    }
+    std::unique_ptr<server::InsertLog> insertLog;
+    std::unique_ptr<server::Session> session;
+    if (catalog) {
+        if (auto walOptions = WalOptions::fromEnvironment()) {
+            auto log = std::make_unique<WriteAheadLog>(walPath, *walOptions);
+            if (!log->open()) {
+                std::cout << "Error: could not open the write-ahead log " << walPath.string() << std::endl;
+                return 1;
+            }
+            insertLog = std::make_unique<server::InsertLog>(catalog.get(), nullptr, std::move(log));
+            if (!insertLog->recover()) {
+                std::cout << "Error: could not recover from the write-ahead log " << walPath.string() << std::endl;
+                return 1;
+            }
+        }
+        session = std::make_unique<server::Session>(catalog.get(), nullptr, nullptr, insertLog.get());
+    }
+
+    // Scraped by e.g. the node exporter's textfile collector
+    const char* metricsFile = std::getenv("TOYDB_METRICS_FILE");
+
     std::cout << "toydb> ";
     while (std::getline(std::cin, input)) {
         if (input.empty()) {
@@ -19,15 +121,31 @@ int main() {
         Parser parser{input};
         auto result = parser.parseQuery();
 
-        if (result.has_value()) {
+        if (!result.has_value()) {
+            std::cout << "Error: " << result.error() << std::endl;
+        } else if (!catalog) {
             result.value()->query_->print(std::cout);
             std::cout << std::endl;
         } else {
-            std::cout << "Error: " << result.error() << std::endl;
+            try {
+                auto rowCount = session->execute(*result.value(), input,
+                                                 [](std::string_view text) { std::cout << text << std::flush; });
+                if (rowCount) {
+                    std::cout << *rowCount << " rows" << std::endl;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+            }
         }
 
+        if (metricsFile && !metrics::MetricsRegistry::global().writeTextFile(metricsFile)) {
+            std::cout << "Error: could not write metrics to " << metricsFile << std::endl;
+        }
         std::cout << "toydb> ";
     }
 
+    if (insertLog) {
+        insertLog->checkpoint();
+    }
     return 0;
 }
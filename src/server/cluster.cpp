@@ -0,0 +1,121 @@
+#include "server/cluster.hpp"
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "server/protocol.hpp"
+
+namespace toydb {
+namespace server {
+
+std::optional<WorkerAddress> WorkerAddress::parse(std::string_view address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return std::nullopt;
+    }
+    std::string_view portText = address.substr(colon + 1);
+    uint16_t port = 0;
+    auto [end, error] = std::from_chars(portText.data(), portText.data() + portText.size(), port);
+    if (error != std::errc() || end != portText.data() + portText.size() || port == 0) {
+        return std::nullopt;
+    }
+    return WorkerAddress {std::string(address.substr(0, colon)), port};
+}
+
+namespace {
+
+/**
+ * @brief Thrown into the receiving threads to stop them once the stream is destroyed
+ */
+struct FragmentCancelled {};
+
+class RemoteFragmentStream : public FragmentStream {
+private:
+    size_t queueCapacity_;
+    std::mutex mutex_;
+    // Signaled when a payload is queued or a worker finished
+    std::condition_variable available_;
+    // Signaled when a payload is taken or the stream is cancelled
+    std::condition_variable space_;
+    std::deque<std::string> payloads_;
+    size_t runningWorkers_;
+    bool cancelled_ = false;
+    std::exception_ptr error_;
+    std::vector<std::thread> threads_;
+
+    void receive(const WorkerAddress& worker, const std::string& fragment) {
+        try {
+            QueryClient client(worker.host, worker.port);
+            int64_t count = client.runFragment(fragment, [this](std::string_view payload) {
+                std::unique_lock lock(mutex_);
+                space_.wait(lock, [this] { return cancelled_ || payloads_.size() < queueCapacity_; });
+                if (cancelled_) {
+                    throw FragmentCancelled();
+                }
+                payloads_.emplace_back(payload);
+                available_.notify_one();
+            });
+            Logger::debug("ClusterDispatcher: worker {} produced {} rows", worker.toString(), count);
+        } catch (const FragmentCancelled&) {
+        } catch (const std::exception& e) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::make_exception_ptr(SQLRuntimeException("Worker " + worker.toString() + ": " + e.what()));
+            }
+        }
+
+        std::lock_guard lock(mutex_);
+        runningWorkers_--;
+        available_.notify_all();
+    }
+
+public:
+    RemoteFragmentStream(const std::vector<WorkerAddress>& workers, const std::string& fragment, size_t queueCapacity)
+        : queueCapacity_(queueCapacity), runningWorkers_(workers.size()) {
+        threads_.reserve(workers.size());
+        for (const WorkerAddress& worker : workers) {
+            threads_.emplace_back([this, worker, fragment] { receive(worker, fragment); });
+        }
+    }
+
+    ~RemoteFragmentStream() override {
+        {
+            std::lock_guard lock(mutex_);
+            cancelled_ = true;
+        }
+        space_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    bool next(std::string& payload) override {
+        std::unique_lock lock(mutex_);
+        available_.wait(lock, [this] { return error_ || !payloads_.empty() || runningWorkers_ == 0; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        if (payloads_.empty()) {
+            return false;
+        }
+        payload = std::move(payloads_.front());
+        payloads_.pop_front();
+        space_.notify_one();
+        return true;
+    }
+};
+
+}  // namespace
+
+std::unique_ptr<FragmentStream> ClusterDispatcher::dispatch(const std::string& fragment) {
+    Logger::debug("ClusterDispatcher: dispatching a fragment of {} bytes to {} workers", fragment.size(),
+                  workers_.size());
+    return std::make_unique<RemoteFragmentStream>(workers_, fragment, queueCapacity_);
+}
+
+}  // namespace server
+}  // namespace toydb
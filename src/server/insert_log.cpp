@@ -0,0 +1,173 @@
+#include "server/insert_log.hpp"
+#include <algorithm>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "parser/parser.hpp"
+#include "planner/interpreter.hpp"
+#include "storage/file_sync.hpp"
+#include "storage/table_writer.hpp"
+
+namespace toydb {
+namespace server {
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+InsertLog::InsertLog(Catalog* catalog, std::shared_mutex* catalogMutex, std::unique_ptr<WriteAheadLog> log)
+    : catalog_(catalog), catalogMutex_(catalogMutex), log_(std::move(log)) {}
+
+std::unique_lock<std::shared_mutex> InsertLog::lockCatalog() {
+    if (!catalogMutex_) {
+        return {};
+    }
+    return std::unique_lock(*catalogMutex_);
+}
+
+InsertLog::WrittenFile InsertLog::writeRows(const ast::Insert& insert, const std::optional<fs::path>& path,
+                                            bool sync) {
+    CatalogQueryAdapter queryCatalog(catalog_);
+    memory::BufferManager bufferManager;
+    BatchAllocator allocator(&bufferManager);
+    InsertBatches rows = SQLInterpreter(&queryCatalog).handleInsert(insert, allocator);
+
+    TableWriter writer(catalog_, rows.tableId);
+    for (const RowVector& batch : rows.batches) {
+        writer.append(batch);
+    }
+
+    fs::path filePath;
+    if (path) {
+        filePath = *path;
+    } else {
+        auto created = catalog_->createFilePath(rows.tableId);
+        if (!created) {
+            throw SQLRuntimeException("Inserting into " + insert.tableName + " failed");
+        }
+        filePath = fs::absolute(*created);
+    }
+    auto file = writer.writeFile(filePath, sync);
+    if (!file) {
+        throw SQLRuntimeException("Inserting into " + insert.tableName + " failed");
+    }
+    return {rows.tableId, std::move(*file)};
+}
+
+int64_t InsertLog::insert(const ast::Insert& insert, std::string_view sql) {
+    WrittenFile written;
+    WriteAheadLog::Lsn lsn;
+    {
+        auto catalogLock = lockCatalog();
+        written = writeRows(insert, std::nullopt, false);
+        lsn = log_->append(json {{"file", written.file.path.string()}, {"sql", sql}}.dump());
+        std::lock_guard lock(mutex_);
+        ++pending_;
+    }
+
+    // Without the catalog lock, so that concurrent INSERTs join this commit
+    bool committed = log_->commit(lsn);
+
+    auto catalogLock = lockCatalog();
+    std::lock_guard lock(mutex_);
+    --pending_;
+    if (!committed) {
+        std::error_code error;
+        fs::remove(written.file.path, error);
+        throw SQLRuntimeException("Inserting into " + insert.tableName + " failed, the log could not be written");
+    }
+
+    int64_t rowCount = written.file.row_count.value_or(0);
+    if (!catalog_->addFiles(written.tableId, {written.file})) {
+        // The rows are logged, so they can't be dropped anymore: the checkpoint retries
+        unapplied_.push_back(std::move(written));
+        throw SQLRuntimeException("Inserting into " + insert.tableName +
+                                  " failed, the catalog could not be updated until the next checkpoint");
+    }
+    unsynced_.push_back(std::move(written.file.path));
+
+    if (pending_ == 0 && log_->getSize() >= log_->getOptions().checkpointBytes) {
+        checkpointLocked();
+    }
+    return rowCount;
+}
+
+bool InsertLog::recover() {
+    std::vector<std::string> records = log_->readRecords();
+    auto catalogLock = lockCatalog();
+    std::lock_guard lock(mutex_);
+
+    for (const std::string& record : records) {
+        json entry = json::parse(record, nullptr, false);
+        if (entry.is_discarded() || !entry.contains("file") || !entry.contains("sql")) {
+            Logger::error("Invalid record in the write-ahead log: {}", record);
+            return false;
+        }
+        fs::path path = entry["file"].get<std::string>();
+        std::string sql = entry["sql"].get<std::string>();
+
+        auto ast = parser::Parser {sql}.parseQuery();
+        const auto* insert = ast ? ast::as<ast::Insert>((*ast)->query_) : nullptr;
+        if (!insert) {
+            Logger::error("Logged statement is not an INSERT: {}", sql);
+            return false;
+        }
+        try {
+            // The file may be torn or missing, even if the catalog lists it
+            WrittenFile written = writeRows(*insert, path, true);
+            auto table = catalog_->getTableHandle(written.tableId);
+            if (!table) {
+                Logger::error("Failed to recover {}: unknown table {}", sql, written.tableId.getName());
+                return false;
+            }
+            const auto& files = (*table)->getFilePaths();
+            bool listed = std::any_of(files.begin(), files.end(),
+                                      [&](const fs::path& file) { return fs::absolute(file) == path; });
+            if (!listed && !catalog_->addFiles(written.tableId, {std::move(written.file)})) {
+                Logger::error("Failed to recover {}: the catalog could not be updated", sql);
+                return false;
+            }
+        } catch (const SQLException& e) {
+            Logger::error("Failed to recover {}: {}", sql, e.what());
+            return false;
+        }
+    }
+
+    if (!records.empty()) {
+        Logger::info("Recovered {} INSERT statements from the write-ahead log", records.size());
+    }
+    return checkpointLocked();
+}
+
+bool InsertLog::checkpoint() {
+    auto catalogLock = lockCatalog();
+    std::lock_guard lock(mutex_);
+    if (pending_ > 0) {
+        return false;
+    }
+    return checkpointLocked();
+}
+
+bool InsertLog::checkpointLocked() {
+    while (!unapplied_.empty()) {
+        WrittenFile& written = unapplied_.front();
+        if (!catalog_->addFiles(written.tableId, {written.file})) {
+            Logger::error("Checkpoint failed to add {} to the catalog, keeping the log", written.file.path.string());
+            return false;
+        }
+        unsynced_.push_back(written.file.path);
+        unapplied_.erase(unapplied_.begin());
+    }
+    for (const fs::path& path : unsynced_) {
+        if (!syncPath(path)) {
+            Logger::error("Checkpoint failed to sync {}", path.string());
+            return false;
+        }
+    }
+    if (!catalog_->sync() || !log_->truncate()) {
+        return false;
+    }
+    unsynced_.clear();
+    return true;
+}
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,192 @@
+#include "server/protocol.hpp"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <system_error>
+#include "common/errors.hpp"
+
+namespace toydb {
+namespace server {
+
+void encodeMessage(MessageType type, std::string_view payload, std::string& out) {
+    uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+    out.push_back(static_cast<char>(type));
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(payload);
+}
+
+void MessageDecoder::feed(const char* data, size_t size) {
+    // Drop the returned messages before the buffer grows
+    if (offset_ > 0 && offset_ == buffer_.size()) {
+        buffer_.clear();
+        offset_ = 0;
+    } else if (offset_ > buffer_.size() / 2) {
+        buffer_.erase(0, offset_);
+        offset_ = 0;
+    }
+    buffer_.append(data, size);
+}
+
+std::optional<Message> MessageDecoder::next() {
+    if (buffer_.size() - offset_ < MESSAGE_HEADER_SIZE) {
+        return std::nullopt;
+    }
+
+    auto type = static_cast<MessageType>(buffer_[offset_]);
+    switch (type) {
+        case MessageType::QUERY:
+        case MessageType::FORMAT:
+        case MessageType::FRAGMENT:
+        case MessageType::DATA:
+        case MessageType::COMPLETE:
+        case MessageType::ERROR:
+            break;
+        default:
+            throw ProtocolError("Unknown message type " + std::to_string(static_cast<int>(buffer_[offset_])));
+    }
+
+    uint32_t length;
+    std::memcpy(&length, buffer_.data() + offset_ + 1, sizeof(length));
+    length = ntohl(length);
+    if (length > MAX_MESSAGE_SIZE) {
+        throw ProtocolError("Message of " + std::to_string(length) + " bytes exceeds the maximum size");
+    }
+    if (buffer_.size() - offset_ < MESSAGE_HEADER_SIZE + length) {
+        return std::nullopt;
+    }
+
+    Message message {type, buffer_.substr(offset_ + MESSAGE_HEADER_SIZE, length)};
+    offset_ += MESSAGE_HEADER_SIZE + length;
+    return message;
+}
+
+QueryClient::QueryClient(const std::string& host, uint16_t port) {
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int error = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (error != 0) {
+        throw std::system_error(std::make_error_code(std::errc::host_unreachable), gai_strerror(error));
+    }
+
+    int lastErrno = 0;
+    for (addrinfo* address = addresses; address; address = address->ai_next) {
+        fd_ = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd_ == -1) {
+            lastErrno = errno;
+            continue;
+        }
+        if (connect(fd_, address->ai_addr, address->ai_addrlen) == 0) {
+            break;
+        }
+        lastErrno = errno;
+        close(fd_);
+        fd_ = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (fd_ == -1) {
+        throw std::system_error(lastErrno, std::generic_category(), "Connecting to " + host + " failed");
+    }
+}
+
+QueryClient::~QueryClient() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+void QueryClient::send(const std::string& bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = ::send(fd_, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Sending to the server failed");
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+Message QueryClient::receive() {
+    char buffer[64 * 1024];
+    while (true) {
+        if (auto message = decoder_.next()) {
+            return std::move(*message);
+        }
+        ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            throw std::system_error(errno, std::generic_category(), "Receiving from the server failed");
+        }
+        if (n == 0) {
+            throw std::system_error(std::make_error_code(std::errc::connection_reset), "The server closed the connection");
+        }
+        decoder_.feed(buffer, static_cast<size_t>(n));
+    }
+}
+
+std::optional<int64_t> QueryClient::receiveResult(std::string_view request,
+                                                  const std::function<void(std::string_view)>& consume) {
+    while (true) {
+        Message message = receive();
+        switch (message.type) {
+            case MessageType::DATA:
+                consume(message.payload);
+                break;
+            case MessageType::COMPLETE: {
+                if (message.payload.empty()) {
+                    return std::nullopt;
+                }
+                int64_t rowCount = 0;
+                std::from_chars(message.payload.data(), message.payload.data() + message.payload.size(), rowCount);
+                return rowCount;
+            }
+            case MessageType::ERROR:
+                throw SQLException(message.payload, std::string(request));
+            case MessageType::QUERY:
+            case MessageType::FORMAT:
+            case MessageType::FRAGMENT:
+                throw ProtocolError("Unexpected request from the server");
+        }
+    }
+}
+
+QueryClient::Result QueryClient::query(std::string_view sql) {
+    std::string request;
+    encodeMessage(MessageType::QUERY, sql, request);
+    send(request);
+
+    Result result;
+    result.rowCount = receiveResult(sql, [&result](std::string_view data) { result.data.append(data); });
+    return result;
+}
+
+void QueryClient::setResultFormat(ResultFormat format) {
+    std::string name = resultFormatToString(format);
+    std::string request;
+    encodeMessage(MessageType::FORMAT, name, request);
+    send(request);
+
+    receiveResult(name, [](std::string_view) {});
+}
+
+int64_t QueryClient::runFragment(std::string_view fragment, const std::function<void(std::string_view)>& consume) {
+    std::string request;
+    encodeMessage(MessageType::FRAGMENT, fragment, request);
+    send(request);
+
+    return receiveResult("plan fragment", consume).value_or(0);
+}
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,405 @@
+#include "server/query_server.hpp"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "common/metrics.hpp"
+#include "engine/buffer_pool.hpp"
+
+namespace toydb {
+namespace server {
+
+// A worker gives up on a client that doesn't read its results for this long
+static constexpr int SEND_TIMEOUT_MS = 60 * 1000;
+static constexpr int MAX_EVENTS = 64;
+
+static metrics::Counter& connectionsAccepted() {
+    static metrics::Counter& counter =
+        metrics::MetricsRegistry::global().counter("toydb_server_connections_total", "Client connections accepted");
+    return counter;
+}
+
+static metrics::Histogram& admissionWait() {
+    static metrics::Histogram& histogram = metrics::MetricsRegistry::global().histogram(
+        "toydb_server_admission_wait_seconds", "Time queries waited for admission",
+        metrics::Histogram::exponentialBounds(0.0001, 4.0, 10));
+    return histogram;
+}
+
+[[noreturn]] static void throwErrno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+static void addToEpoll(int epollFd, int fd) {
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        throwErrno("Watching a socket failed");
+    }
+}
+
+QueryServer::QueryServer(Catalog* catalog, const ServerOptions& options)
+    : options_(options),
+      catalog_(catalog),
+      planCache_(catalog, options.planCacheCapacity),
+      admission_(options.memoryLimit > 0 ? options.memoryLimit : memory::BufferPool::global().getMemoryBudget()) {
+    if (options_.wal) {
+        auto log = std::make_unique<WriteAheadLog>(options_.walPath, *options_.wal);
+        if (!log->open()) {
+            throw std::runtime_error("Opening the write-ahead log " + options_.walPath.string() + " failed");
+        }
+        insertLog_ = std::make_unique<InsertLog>(catalog_, &catalogMutex_, std::move(log));
+        if (!insertLog_->recover()) {
+            throw std::runtime_error("Recovering from the write-ahead log " + options_.walPath.string() + " failed");
+        }
+    }
+    if (!options_.workers.empty()) {
+        dispatcher_ = std::make_unique<ClusterDispatcher>(options_.workers);
+    }
+
+    try {
+        addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* addresses = nullptr;
+        int error = getaddrinfo(options_.host.c_str(), std::to_string(options_.port).c_str(), &hints, &addresses);
+        if (error != 0) {
+            throw std::system_error(std::make_error_code(std::errc::address_not_available), gai_strerror(error));
+        }
+        std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addressesGuard(addresses, &freeaddrinfo);
+
+        listenFd_ = socket(addresses->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ == -1) {
+            throwErrno("Creating the server socket failed");
+        }
+        int enable = 1;
+        setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(listenFd_, addresses->ai_addr, addresses->ai_addrlen) == -1) {
+            throwErrno("Binding " + options_.host + ":" + std::to_string(options_.port) + " failed");
+        }
+        if (listen(listenFd_, SOMAXCONN) == -1) {
+            throwErrno("Listening failed");
+        }
+
+        sockaddr_storage bound {};
+        socklen_t boundLength = sizeof(bound);
+        getsockname(listenFd_, reinterpret_cast<sockaddr*>(&bound), &boundLength);
+        port_ = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port
+                                                  : reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd_ == -1 || wakeFd_ == -1) {
+            throwErrno("Creating the event loop failed");
+        }
+        addToEpoll(epollFd_, listenFd_);
+        addToEpoll(epollFd_, wakeFd_);
+    } catch (...) {
+        closeDescriptors();
+        throw;
+    }
+
+    for (size_t i = 0; i < std::max<size_t>(options_.workerCount, 1); ++i) {
+        workers_.emplace_back([this] { runWorker(); });
+    }
+    Logger::info("QueryServer: listening on {}:{} with {} workers", options_.host, port_, workers_.size());
+}
+
+QueryServer::~QueryServer() {
+    {
+        std::lock_guard lock(taskMutex_);
+        shutdown_ = true;
+    }
+    taskAvailable_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    if (insertLog_) {
+        insertLog_->checkpoint();
+    }
+
+    for (const auto& [fd, connection] : connections_) {
+        close(fd);
+    }
+    closeDescriptors();
+}
+
+void QueryServer::closeDescriptors() noexcept {
+    for (int fd : {listenFd_, epollFd_, wakeFd_}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+    listenFd_ = epollFd_ = wakeFd_ = -1;
+}
+
+void QueryServer::run() {
+    epoll_event events[MAX_EVENTS];
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int count = epoll_wait(epollFd_, events, MAX_EVENTS, -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throwErrno("Waiting for events failed");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd_) {
+                acceptConnections();
+            } else if (fd == wakeFd_) {
+                uint64_t value;
+                [[maybe_unused]] ssize_t n = read(wakeFd_, &value, sizeof(value));
+                handleCompletions();
+            } else if (auto it = connections_.find(fd); it != connections_.end()) {
+                // Reading may close the connection and remove it from the map
+                std::shared_ptr<Connection> connection = it->second;
+                readConnection(connection);
+            }
+        }
+        admitQueries();
+    }
+}
+
+void QueryServer::stop() noexcept {
+    stopping_.store(true, std::memory_order_release);
+    wake();
+}
+
+void QueryServer::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = write(wakeFd_, &one, sizeof(one));
+}
+
+void QueryServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Logger::warn("QueryServer: accepting a connection failed: {}", std::strerror(errno));
+            }
+            return;
+        }
+
+        // Results are sent in one message per batch, don't delay the last one
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        addToEpoll(epollFd_, fd);
+        connections_.emplace(fd, std::make_shared<Connection>(fd, Session(catalog_, &planCache_, &catalogMutex_, insertLog_.get(), dispatcher_.get())));
+        connectionsAccepted().increment();
+    }
+}
+
+void QueryServer::readConnection(const std::shared_ptr<Connection>& connection) {
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            connection->decoder.feed(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        // Hung up or failed
+        closeConnection(connection);
+        return;
+    }
+
+    try {
+        while (auto message = connection->decoder.next()) {
+            if (message->type != MessageType::QUERY && message->type != MessageType::FORMAT &&
+                message->type != MessageType::FRAGMENT) {
+                throw ProtocolError("Clients may only send queries, formats and plan fragments");
+            }
+            connection->requests.push_back(std::move(*message));
+        }
+    } catch (const ProtocolError& e) {
+        Logger::warn("QueryServer: closing connection: {}", e.what());
+        closeConnection(connection);
+        return;
+    }
+
+    if (!connection->busy && !connection->requests.empty()) {
+        connection->busy = true;
+        connection->queuedAt = std::chrono::steady_clock::now();
+        waiting_.push_back(connection);
+    }
+}
+
+void QueryServer::closeConnection(const std::shared_ptr<Connection>& connection) {
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+    connection->closing = true;
+    connection->requests.clear();
+    // A worker may still send on the socket, it is closed when the query finished
+    if (!connection->busy) {
+        closeSocket(connection);
+    }
+}
+
+void QueryServer::closeSocket(const std::shared_ptr<Connection>& connection) {
+    connections_.erase(connection->fd);
+    close(connection->fd);
+}
+
+void QueryServer::handleCompletions() {
+    std::vector<std::shared_ptr<Connection>> completed;
+    {
+        std::lock_guard lock(completionMutex_);
+        completed.swap(completed_);
+    }
+
+    for (const std::shared_ptr<Connection>& connection : completed) {
+        admission_.release(options_.queryMemory);
+        connection->busy = false;
+        if (connection->closing) {
+            closeSocket(connection);
+        } else if (!connection->requests.empty()) {
+            connection->busy = true;
+            connection->queuedAt = std::chrono::steady_clock::now();
+            waiting_.push_back(connection);
+        }
+    }
+}
+
+void QueryServer::admitQueries() {
+    while (!waiting_.empty()) {
+        std::shared_ptr<Connection> connection = waiting_.front();
+        if (connection->closing) {
+            waiting_.pop_front();
+            connection->busy = false;
+            closeSocket(connection);
+            continue;
+        }
+
+        // Operators already spill, more queries would only make them spill more
+        bool underPressure = memory::BufferPool::global().isUnderPressure();
+        if (admission_.getRunningQueries() > 0 && underPressure) {
+            return;
+        }
+        if (!admission_.tryAdmit(options_.queryMemory)) {
+            return;
+        }
+        waiting_.pop_front();
+        admissionWait().observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - connection->queuedAt).count());
+
+        Message request = std::move(connection->requests.front());
+        connection->requests.pop_front();
+        submit([this, connection, request = std::move(request)] { runRequest(connection, request); });
+    }
+}
+
+bool QueryServer::sendMessage(int fd, MessageType type, std::string_view payload) {
+    std::string bytes;
+    encodeMessage(type, payload, bytes);
+
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n >= 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        // The client reads slower than the query produces, wait for it
+        pollfd writable {fd, POLLOUT, 0};
+        if (poll(&writable, 1, SEND_TIMEOUT_MS) <= 0 || (writable.revents & (POLLERR | POLLHUP))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void QueryServer::runRequest(const std::shared_ptr<Connection>& connection, const Message& request) {
+    bool connected = true;
+    auto send = [&](MessageType type, std::string_view payload) {
+        connected = connected && sendMessage(connection->fd, type, payload);
+        return connected;
+    };
+
+    try {
+        if (request.type == MessageType::FORMAT) {
+            std::optional<ResultFormat> format = parseResultFormat(request.payload);
+            if (!format) {
+                throw SQLRuntimeException("Unknown result format " + request.payload);
+            }
+            connection->session.setResultFormat(*format);
+            send(MessageType::COMPLETE, "");
+        } else if (request.type == MessageType::FRAGMENT) {
+            int64_t count = connection->session.executeFragment(request.payload, [&](std::string_view bytes) {
+                if (!send(MessageType::DATA, bytes)) {
+                    throw SQLRuntimeException("The coordinator disconnected");
+                }
+            });
+            send(MessageType::COMPLETE, std::to_string(count));
+        } else {
+            std::optional<int64_t> rowCount = connection->session.execute(request.payload, [&](std::string_view bytes) {
+                if (!send(MessageType::DATA, bytes)) {
+                    throw SQLRuntimeException("The client disconnected");
+                }
+            });
+            send(MessageType::COMPLETE, rowCount ? std::to_string(*rowCount) : std::string());
+        }
+    } catch (const std::exception& e) {
+        send(MessageType::ERROR, e.what());
+    }
+
+    {
+        std::lock_guard lock(completionMutex_);
+        completed_.push_back(connection);
+    }
+    wake();
+}
+
+void QueryServer::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(taskMutex_);
+        tasks_.push_back(std::move(task));
+    }
+    taskAvailable_.notify_one();
+}
+
+void QueryServer::runWorker() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(taskMutex_);
+            taskAvailable_.wait(lock, [this] { return !tasks_.empty() || shutdown_; });
+            // Queries submitted before the shutdown still run
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace server
+}  // namespace toydb
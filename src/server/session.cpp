@@ -0,0 +1,240 @@
+#include "server/session.hpp"
+#include <fmt/format.h>
+#include <mutex>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "parser/parser.hpp"
+#include "planner/explain.hpp"
+#include "planner/interpreter.hpp"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/materialized_view.hpp"
+#include "planner/physical_planner.hpp"
+#include "planner/plan_fragment.hpp"
+#include "planner/rule_based_optimizer.hpp"
+#include "server/insert_log.hpp"
+#include "storage/table_writer.hpp"
+
+namespace toydb {
+namespace server {
+
+std::optional<int64_t> Session::execute(std::string_view sql, const OutputSink& out) {
+    auto ast = parser::Parser{sql}.parseQuery();
+    if (!ast) {
+        throw SQLException(ast.error(), std::string(sql));
+    }
+    return execute(**ast, sql, out);
+}
+
+int64_t Session::runPlan(PhysicalQueryPlan& plan, const OutputSink& out) {
+    if (!plan.hasRoot()) {
+        return 0;
+    }
+    std::unique_ptr<ResultSink> sink = ResultSink::create(format_, out);
+    int64_t rowCount = plan.run([&sink](const RowVector& batch) { sink->write(batch); });
+    sink->finish();
+    return rowCount;
+}
+
+void Session::analyzeTable(const ast::Analyze& analyze, const OutputSink& out) {
+    std::unique_lock<std::shared_mutex> lock;
+    if (catalogMutex_) {
+        lock = std::unique_lock(*catalogMutex_);
+    }
+
+    auto tableId = catalog_->getTableIdByName(analyze.tableName);
+    if (!tableId) {
+        throw SQLRuntimeException("Unknown table " + analyze.tableName);
+    }
+    if (!catalog_->analyzeTable(*tableId)) {
+        throw SQLRuntimeException("Analyzing " + analyze.tableName + " failed");
+    }
+    out(fmt::format("Analyzed {}, {} rows\n", analyze.tableName, catalog_->getRowCount(*tableId).value_or(0)));
+}
+
+void Session::createIndex(const ast::CreateIndex& createIndex, const OutputSink& out) {
+    std::unique_lock<std::shared_mutex> lock;
+    if (catalogMutex_) {
+        lock = std::unique_lock(*catalogMutex_);
+    }
+
+    auto tableId = catalog_->getTableIdByName(createIndex.tableName);
+    if (!tableId) {
+        throw SQLRuntimeException("Unknown table " + createIndex.tableName);
+    }
+    auto columnId = catalog_->resolveColumn(*tableId, createIndex.columnName);
+    if (!columnId) {
+        throw UnresolvedColumnException("Column '" + createIndex.columnName + "' not found");
+    }
+    if (!catalog_->createIndex(*columnId)) {
+        throw SQLRuntimeException("Indexing " + createIndex.tableName + "." + createIndex.columnName + " failed");
+    }
+    out(fmt::format("Created index on {}.{}\n", createIndex.tableName, createIndex.columnName));
+}
+
+void Session::insertRows(const ast::Insert& insert, std::string_view sql, const OutputSink& out) {
+    if (insertLog_) {
+        int64_t rowCount = insertLog_->insert(insert, sql);
+        out(fmt::format("Inserted {} rows into {}\n", rowCount, insert.tableName));
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock;
+    if (catalogMutex_) {
+        lock = std::unique_lock(*catalogMutex_);
+    }
+
+    CatalogQueryAdapter queryCatalog(catalog_);
+    memory::BufferManager bufferManager;
+    BatchAllocator allocator(&bufferManager);
+    InsertBatches rows = SQLInterpreter(&queryCatalog).handleInsert(insert, allocator);
+
+    TableWriter writer(catalog_, rows.tableId);
+    for (const RowVector& batch : rows.batches) {
+        writer.append(batch);
+    }
+    int64_t rowCount = writer.getBufferedRowCount();
+    if (!writer.flush()) {
+        throw SQLRuntimeException("Inserting into " + insert.tableName + " failed");
+    }
+    out(fmt::format("Inserted {} rows into {}\n", rowCount, insert.tableName));
+}
+
+void Session::createMaterializedView(const ast::CreateMaterializedView& create, std::string_view sql,
+                                     const OutputSink& out) {
+    std::unique_lock<std::shared_mutex> lock;
+    if (catalogMutex_) {
+        lock = std::unique_lock(*catalogMutex_);
+    }
+
+    MaterializedViewManager views(catalog_);
+    views.create(create.name, MaterializedViewManager::normalizeQuery(sql));
+    out(fmt::format("Created materialized view {}\n", create.name));
+}
+
+void Session::refreshMaterializedView(std::string_view sql) {
+    MaterializedViewManager views(catalog_);
+    std::string query = MaterializedViewManager::normalizeQuery(sql);
+    auto view = views.findView(query);
+    if (!view || !views.isStale(*view)) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock;
+    if (catalogMutex_) {
+        lock = std::unique_lock(*catalogMutex_);
+    }
+    // Another session may have refreshed it meanwhile
+    view = views.findView(query);
+    if (view && views.isStale(*view)) {
+        views.refresh(*view);
+    }
+}
+
+std::optional<int64_t> Session::execute(const ast::QueryAST& ast, std::string_view sql, const OutputSink& out) {
+    if (const auto* analyze = ast::as<ast::Analyze>(ast.query_)) {
+        analyzeTable(*analyze, out);
+        return std::nullopt;
+    }
+    if (const auto* index = ast::as<ast::CreateIndex>(ast.query_)) {
+        createIndex(*index, out);
+        return std::nullopt;
+    }
+    if (const auto* insert = ast::as<ast::Insert>(ast.query_)) {
+        insertRows(*insert, sql, out);
+        return std::nullopt;
+    }
+    if (const auto* create = ast::as<ast::CreateMaterializedView>(ast.query_)) {
+        createMaterializedView(*create, sql, out);
+        return std::nullopt;
+    }
+
+    const auto* explain = ast::as<ast::Explain>(ast.query_);
+    bool query = explain || ast::as<ast::SelectFrom>(ast.query_);
+    if (query) {
+        refreshMaterializedView(sql);
+    }
+
+    // Without the catalog lock: every catalog read resolves against a snapshot, so queries never
+    // wait for INSERTs, ANALYZE or view refreshes
+    PhysicalPlanner planner(catalog_);
+    planner.setDispatcher(dispatcher_);
+
+    // Rows inserted since the refresh above are not in the view, the query reads the tables then
+    MaterializedViewManager views(catalog_);
+    auto findFreshView = [&views, normalized = query ? MaterializedViewManager::normalizeQuery(sql) : std::string()] {
+        std::optional<MaterializedViewMetadata> view = views.findView(normalized);
+        if (view && views.isStale(*view)) {
+            view.reset();
+        }
+        return view;
+    };
+    std::optional<MaterializedViewMetadata> view;
+    if (query) {
+        view = findFreshView();
+    }
+
+    if (!view && !explain && planCache_) {
+        auto statement = planCache_->prepare(sql);
+        if (!statement) {
+            throw SQLException(statement.error(), std::string(sql));
+        }
+        PhysicalQueryPlan plan = statement->createPlan(planner);
+        return runPlan(plan, out);
+    }
+
+    while (true) {
+        std::optional<LogicalQueryPlan> logicalPlan;
+        if (view) {
+            logicalPlan = views.plan(*view);
+        } else {
+            CatalogQueryAdapter queryCatalog(catalog_);
+            SQLInterpreter interpreter(&queryCatalog);
+            logicalPlan = interpreter.interpret(ast);
+            if (!logicalPlan.has_value()) {
+                throw InternalSQLError("Query could not be interpreted");
+            }
+            JoinOrderOptimizer(catalog_).optimize(*logicalPlan);
+            RuleBasedOptimizer(catalog_).optimize(*logicalPlan);
+        }
+
+        if (explain && !explain->analyze) {
+            out(explainPlan(*logicalPlan));
+            return std::nullopt;
+        }
+
+        // The view operators read their file when they are planned, before any output. A refresh
+        // removes the file it replaces, a query planned against it is planned again.
+        std::optional<PhysicalQueryPlan> plan;
+        std::string analyzed;
+        try {
+            if (explain) {
+                analyzed = explainAnalyze(*logicalPlan, planner);
+            } else {
+                plan = planner.plan(*logicalPlan);
+            }
+        } catch (const SQLRuntimeException&) {
+            std::optional<MaterializedViewMetadata> refreshed = view ? findFreshView() : std::nullopt;
+            if (!view || (refreshed && refreshed->path == view->path)) {
+                throw;
+            }
+            Logger::debug("Session: materialized view {} was refreshed while planning, planning again", view->name);
+            view = std::move(refreshed);
+        }
+
+        if (explain) {
+            out(analyzed);
+            return std::nullopt;
+        }
+        return runPlan(*plan, out);
+    }
+}
+
+int64_t Session::executeFragment(std::string_view fragment, const OutputSink& out) {
+    // Like queries, fragments only read catalog snapshots and don't take the catalog lock
+    PlanFragment decoded = PlanFragment::decode(fragment, *catalog_);
+    PhysicalPlanner planner(catalog_);
+    return decoded.run(planner, out);
+}
+
+}  // namespace server
+}  // namespace toydb
@@ -0,0 +1,476 @@
+#include "storage/async_io.hpp"
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+
+namespace toydb {
+
+std::string ioBackendToString(IoBackend backend) noexcept {
+    switch (backend) {
+        case IoBackend::AUTO:
+            return "auto";
+        case IoBackend::IO_URING:
+            return "io_uring";
+        case IoBackend::THREAD_POOL:
+            return "threads";
+        default:
+            return "unknown";
+    }
+}
+
+// There is no liburing dependency, the ring is set up with the raw system calls
+static int ioUringSetup(unsigned entries, io_uring_params* params) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int ringFd, unsigned opcode, void* arg, unsigned args) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode, arg, args));
+}
+
+static uint32_t loadAcquire(uint32_t* value) noexcept {
+    return std::atomic_ref<uint32_t>(*value).load(std::memory_order_acquire);
+}
+
+static void storeRelease(uint32_t* value, uint32_t newValue) noexcept {
+    std::atomic_ref<uint32_t>(*value).store(newValue, std::memory_order_release);
+}
+
+/**
+ * @brief Reads submitted to an io_uring submission ring, completions taken from its completion ring
+ */
+class IoUringQueue final : public IoQueue {
+public:
+    static std::unique_ptr<IoUringQueue> create(unsigned depth);
+
+    IoUringQueue(const IoUringQueue&) = delete;
+    IoUringQueue& operator=(const IoUringQueue&) = delete;
+
+    ~IoUringQueue() override;
+
+    void submitRead(int fd, char* buffer, size_t size, uint64_t offset, uint64_t tag) override;
+
+    IoCompletion waitForCompletion() override;
+
+    IoBackend getBackend() const noexcept override { return IoBackend::IO_URING; }
+
+private:
+    int ring_fd_ = -1;
+    void* sq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = MAP_FAILED;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t* sq_mask_ = nullptr;
+    uint32_t* sq_array_ = nullptr;
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    uint32_t* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    // Reads the kernel did not accept, reported as failed completions
+    std::deque<IoCompletion> rejected_;
+
+    IoUringQueue() = default;
+
+    bool supportsRead();
+};
+
+std::unique_ptr<IoUringQueue> IoUringQueue::create(unsigned depth) {
+    io_uring_params params{};
+    int ringFd = ioUringSetup(depth, &params);
+    if (ringFd < 0) {
+        Logger::debug("io_uring is not available: {}", std::strerror(errno));
+        return nullptr;
+    }
+
+    std::unique_ptr<IoUringQueue> queue(new IoUringQueue());
+    queue->ring_fd_ = ringFd;
+
+    queue->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    queue->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+        queue->sq_ring_size_ = queue->cq_ring_size_ = std::max(queue->sq_ring_size_, queue->cq_ring_size_);
+    }
+
+    queue->sq_ring_ = ::mmap(nullptr, queue->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ringFd, IORING_OFF_SQ_RING);
+    if (queue->sq_ring_ == MAP_FAILED) {
+        Logger::debug("Failed to map the io_uring submission ring: {}", std::strerror(errno));
+        return nullptr;
+    }
+    if (singleMapping) {
+        queue->cq_ring_ = queue->sq_ring_;
+    } else {
+        queue->cq_ring_ = ::mmap(nullptr, queue->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 ringFd, IORING_OFF_CQ_RING);
+        if (queue->cq_ring_ == MAP_FAILED) {
+            Logger::debug("Failed to map the io_uring completion ring: {}", std::strerror(errno));
+            return nullptr;
+        }
+    }
+    queue->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, queue->sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                        IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        Logger::debug("Failed to map the io_uring submission entries: {}", std::strerror(errno));
+        return nullptr;
+    }
+    queue->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sqRing = static_cast<char*>(queue->sq_ring_);
+    auto* cqRing = static_cast<char*>(queue->cq_ring_);
+    queue->sq_tail_ = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.tail);
+    queue->sq_mask_ = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.ring_mask);
+    queue->sq_array_ = reinterpret_cast<uint32_t*>(sqRing + params.sq_off.array);
+    queue->cq_head_ = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.head);
+    queue->cq_tail_ = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.tail);
+    queue->cq_mask_ = reinterpret_cast<uint32_t*>(cqRing + params.cq_off.ring_mask);
+    queue->cqes_ = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+
+    if (!queue->supportsRead()) {
+        Logger::debug("io_uring does not support IORING_OP_READ");
+        return nullptr;
+    }
+    return queue;
+}
+
+IoUringQueue::~IoUringQueue() {
+    if (sqes_) {
+        ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+        ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+    }
+}
+
+// IORING_OP_READ and the probe both need Linux 5.6
+bool IoUringQueue::supportsRead() {
+    constexpr unsigned OP_COUNT = 256;
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + OP_COUNT * sizeof(io_uring_probe_op), 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (ioUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, OP_COUNT) < 0) {
+        return false;
+    }
+    return probe->last_op >= IORING_OP_READ && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+void IoUringQueue::submitRead(int fd, char* buffer, size_t size, uint64_t offset, uint64_t tag) {
+    // Only this thread moves the tail, the kernel moves the head
+    uint32_t tail = *sq_tail_;
+    uint32_t index = tail & *sq_mask_;
+    io_uring_sqe& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(buffer);
+    sqe.len = static_cast<uint32_t>(size);
+    sqe.off = offset;
+    sqe.user_data = tag;
+    sq_array_[index] = index;
+    storeRelease(sq_tail_, tail + 1);
+
+    int submitted;
+    do {
+        submitted = ioUringEnter(ring_fd_, 1, 0, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted != 1) {
+        // The entry was not consumed, take it back
+        storeRelease(sq_tail_, tail);
+        rejected_.push_back({tag, submitted < 0 ? -static_cast<int64_t>(errno) : -EAGAIN});
+    }
+}
+
+IoCompletion IoUringQueue::waitForCompletion() {
+    if (!rejected_.empty()) {
+        IoCompletion completion = rejected_.front();
+        rejected_.pop_front();
+        return completion;
+    }
+
+    while (true) {
+        uint32_t head = *cq_head_;
+        if (head != loadAcquire(cq_tail_)) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            IoCompletion completion{cqe.user_data, cqe.res};
+            storeRelease(cq_head_, head + 1);
+            return completion;
+        }
+        if (ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            throw InternalSQLError(std::string("io_uring_enter failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+/**
+ * @brief Reads executed with pread by a few worker threads, for kernels without io_uring or
+ * where it is disabled
+ */
+class ThreadPoolQueue final : public IoQueue {
+public:
+    explicit ThreadPoolQueue(unsigned threadCount);
+
+    ThreadPoolQueue(const ThreadPoolQueue&) = delete;
+    ThreadPoolQueue& operator=(const ThreadPoolQueue&) = delete;
+
+    ~ThreadPoolQueue() override;
+
+    void submitRead(int fd, char* buffer, size_t size, uint64_t offset, uint64_t tag) override;
+
+    IoCompletion waitForCompletion() override;
+
+    IoBackend getBackend() const noexcept override { return IoBackend::THREAD_POOL; }
+
+private:
+    struct Request {
+        int fd;
+        char* buffer;
+        size_t size;
+        uint64_t offset;
+        uint64_t tag;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable request_cv_;
+    std::condition_variable completion_cv_;
+    std::deque<Request> requests_;
+    std::deque<IoCompletion> completions_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void work();
+};
+
+ThreadPoolQueue::ThreadPoolQueue(unsigned threadCount) {
+    for (unsigned i = 0; i < threadCount; ++i) {
+        threads_.emplace_back(&ThreadPoolQueue::work, this);
+    }
+}
+
+ThreadPoolQueue::~ThreadPoolQueue() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    request_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPoolQueue::submitRead(int fd, char* buffer, size_t size, uint64_t offset, uint64_t tag) {
+    {
+        std::lock_guard lock(mutex_);
+        requests_.push_back({fd, buffer, size, offset, tag});
+    }
+    request_cv_.notify_one();
+}
+
+IoCompletion ThreadPoolQueue::waitForCompletion() {
+    std::unique_lock lock(mutex_);
+    completion_cv_.wait(lock, [this] { return !completions_.empty(); });
+    IoCompletion completion = completions_.front();
+    completions_.pop_front();
+    return completion;
+}
+
+void ThreadPoolQueue::work() {
+    while (true) {
+        Request request{};
+        {
+            std::unique_lock lock(mutex_);
+            request_cv_.wait(lock, [this] { return stopping_ || !requests_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            request = requests_.front();
+            requests_.pop_front();
+        }
+
+        ssize_t bytes;
+        do {
+            bytes = ::pread(request.fd, request.buffer, request.size, static_cast<off_t>(request.offset));
+        } while (bytes < 0 && errno == EINTR);
+
+        {
+            std::lock_guard lock(mutex_);
+            completions_.push_back({request.tag, bytes < 0 ? -static_cast<int64_t>(errno) : bytes});
+        }
+        completion_cv_.notify_one();
+    }
+}
+
+std::unique_ptr<IoQueue> IoQueue::create(unsigned depth, IoBackend backend) {
+    depth = std::max(depth, 1u);
+    if (backend != IoBackend::THREAD_POOL) {
+        if (auto queue = IoUringQueue::create(depth)) {
+            return queue;
+        }
+        if (backend == IoBackend::IO_URING) {
+            return nullptr;
+        }
+    }
+    return std::make_unique<ThreadPoolQueue>(std::min(depth, 4u));
+}
+
+std::optional<AsyncIoOptions> AsyncIoOptions::fromEnvironment() {
+    const char* value = std::getenv("TOYDB_ASYNC_IO");
+    if (!value) {
+        return std::nullopt;
+    }
+
+    std::string_view text(value);
+    AsyncIoOptions options;
+    if (text == "auto") {
+        options.backend = IoBackend::AUTO;
+    } else if (text == "io_uring") {
+        options.backend = IoBackend::IO_URING;
+    } else if (text == "threads") {
+        options.backend = IoBackend::THREAD_POOL;
+    } else {
+        if (text != "off") {
+            Logger::warn("Ignoring invalid TOYDB_ASYNC_IO '{}'", text);
+        }
+        return std::nullopt;
+    }
+    return options;
+}
+
+AsyncFileReader::AsyncFileReader(const std::filesystem::path& path, uint64_t offset, const AsyncIoOptions& options)
+    : path_(path),
+      block_size_(std::clamp<size_t>(options.blockSize, 1, memory::BufferPool::MAX_BUFFER_SIZE)),
+      depth_(std::max(options.depth, 1u)),
+      next_offset_(offset) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat fileStat{};
+    if (fd_ < 0 || ::fstat(fd_, &fileStat) != 0) {
+        Logger::error("Failed to open {}", path.string());
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        return;
+    }
+    file_size_ = static_cast<uint64_t>(fileStat.st_size);
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), 0, POSIX_FADV_SEQUENTIAL);
+
+    queue_ = IoQueue::create(depth_, options.backend);
+    if (!queue_) {
+        Logger::warn("{} I/O is not available, reading {} with threads", ioBackendToString(options.backend),
+                     path.string());
+        queue_ = IoQueue::create(depth_, IoBackend::THREAD_POOL);
+    }
+
+    // One block more than reads in flight, the caller holds one
+    for (unsigned i = 0; i <= depth_; ++i) {
+        blocks_.push_back({buffer_manager_.allocate(block_size_)});
+    }
+    submitBlocks();
+}
+
+AsyncFileReader::~AsyncFileReader() {
+    // The kernel or the worker threads may still write into the buffers
+    while (in_flight_ > 0) {
+        complete(queue_->waitForCompletion());
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+IoBackend AsyncFileReader::getBackend() const noexcept {
+    return queue_ ? queue_->getBackend() : IoBackend::AUTO;
+}
+
+void AsyncFileReader::submitBlocks() {
+    while (!failed_ && in_flight_ < depth_ && next_offset_ < file_size_ &&
+           blocks_[tail_].state == BlockState::EMPTY) {
+        Block& block = blocks_[tail_];
+        block.state = BlockState::READING;
+        block.offset = next_offset_;
+        block.size = static_cast<size_t>(std::min<uint64_t>(block_size_, file_size_ - next_offset_));
+        block.done = 0;
+        queue_->submitRead(fd_, static_cast<char*>(block.buffer.get()), block.size, block.offset, tail_);
+        ++in_flight_;
+        next_offset_ += block.size;
+        tail_ = (tail_ + 1) % blocks_.size();
+    }
+}
+
+void AsyncFileReader::complete(const IoCompletion& completion) {
+    Block& block = blocks_[static_cast<size_t>(completion.tag)];
+    tdb_assert(block.state == BlockState::READING, "Completion for a block that is not being read");
+    if (completion.result < 0) {
+        Logger::error("Failed to read {} at offset {}: {}", path_.string(), block.offset + block.done,
+                      std::strerror(static_cast<int>(-completion.result)));
+        failed_ = true;
+    } else if (completion.result > 0) {
+        block.done += static_cast<size_t>(completion.result);
+    } else {
+        // The file was truncated while it was read
+        block.size = block.done;
+    }
+
+    if (!failed_ && block.done < block.size) {
+        // Short read, read the rest of the block
+        queue_->submitRead(fd_, static_cast<char*>(block.buffer.get()) + block.done, block.size - block.done,
+                           block.offset + block.done, completion.tag);
+        return;
+    }
+    block.state = BlockState::READY;
+    --in_flight_;
+}
+
+std::string_view AsyncFileReader::next() {
+    if (!queue_) {
+        return {};
+    }
+
+    if (holding_) {
+        blocks_[head_].state = BlockState::EMPTY;
+        head_ = (head_ + 1) % blocks_.size();
+        holding_ = false;
+    }
+    submitBlocks();
+
+    Block& block = blocks_[head_];
+    while (block.state == BlockState::READING) {
+        complete(queue_->waitForCompletion());
+    }
+    if (failed_ || block.state == BlockState::EMPTY) {
+        return {};
+    }
+
+    holding_ = true;
+    return {static_cast<const char*>(block.buffer.get()), block.done};
+}
+
+}  // namespace toydb
@@ -0,0 +1,154 @@
+#include "storage/cached_table_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include "common/assert.hpp"
+#include "storage/column_statistics.hpp"
+
+namespace toydb {
+
+CachedTableReader::CachedTableReader(std::shared_ptr<const CachedTable> table, ChunkRange chunks, const Schema& schema)
+    : table_(std::move(table)), chunks_(chunks), schema_(schema), projection_(schema.getColumnIds()),
+      chunk_(chunks.begin) {
+    tdb_assert(chunks_.begin <= chunks_.end && chunks_.end <= table_->getRows().getChunkCount(),
+               "Chunks [{}, {}) out of range of the cached table", chunks_.begin, chunks_.end);
+}
+
+void CachedTableReader::setProjection(const std::vector<ColumnId>& columns) {
+    tdb_assert(!started_, "Projection must be set before reading");
+    projection_ = columns;
+}
+
+void CachedTableReader::setPredicate(const PredicateExpr* predicate) {
+    tdb_assert(!started_, "Predicate must be set before reading");
+    predicate_ = predicate;
+}
+
+void CachedTableReader::startReading() {
+    projected_columns_.clear();
+    for (const ColumnId& columnId : projection_) {
+        int64_t column = table_->getColumnIndex(columnId);
+        tdb_assert(column >= 0, "Column {} is not cached", columnId.getName());
+        projected_columns_.push_back(column);
+    }
+    started_ = true;
+}
+
+bool CachedTableReader::chunkMayMatch(size_t chunk) const {
+    if (!predicate_) {
+        return true;
+    }
+    const std::vector<ColumnStatistics>& statistics = table_->getChunkStatistics(chunk);
+    auto lookup = [&](const ColumnId& columnId) -> const ColumnStatistics* {
+        int64_t column = table_->getColumnIndex(columnId);
+        return column < 0 ? nullptr : &statistics[static_cast<size_t>(column)];
+    };
+    return mayMatch(*predicate_, lookup);
+}
+
+template<is_db_type T>
+static void copyValues(const ColumnBuffer& src, int64_t begin, int64_t count, ColumnBuffer& out) {
+    std::memcpy(out.getDataAs<T>().data(), src.getDataAs<T>().data() + begin, static_cast<size_t>(count) * sizeof(T));
+}
+
+void CachedTableReader::copyRows(const ColumnBuffer& src, int64_t begin, int64_t count, ColumnBuffer& out) {
+    tdb_assert(out.type == src.type, "Column type mismatch");
+    tdb_assert(count <= out.getCapacity(), "Batch has room for {} rows, requested {}", out.getCapacity(), count);
+
+    NullBitmap srcBitmap = src.getNullBitmap();
+    NullBitmap outBitmap = out.getNullBitmap();
+    if (outBitmap.data() && begin % 8 == 0) {
+        std::memcpy(outBitmap.data(), srcBitmap.data() + begin / 8, static_cast<size_t>(count + 7) / 8);
+    } else if (outBitmap.data()) {
+        for (int64_t i = 0; i < count; ++i) {
+            if (src.isNull(begin + i)) {
+                out.setNull(i);
+            } else {
+                out.clearNull(i);
+            }
+        }
+    }
+
+    switch (src.type.getType()) {
+        case DataType::Type::INT32:
+            copyValues<db_int32>(src, begin, count, out);
+            break;
+        case DataType::Type::INT64:
+            copyValues<db_int64>(src, begin, count, out);
+            break;
+        case DataType::Type::DOUBLE:
+            copyValues<db_double>(src, begin, count, out);
+            break;
+        case DataType::Type::BOOL:
+            copyValues<db_bool>(src, begin, count, out);
+            break;
+        case DataType::Type::STRING: {
+            copyValues<db_string>(src, begin, count, out);
+            // Long strings point into the cached table, which may be evicted before the batch is consumed
+            StringHeap* heap = out.getStringHeap() ? out.getStringHeap() : &string_heap_;
+            std::span<db_string> values = out.getDataAs<db_string>();
+            for (int64_t i = 0; i < count; ++i) {
+                db_string& value = values[static_cast<size_t>(i)];
+                if (!src.isNull(begin + i) && !value.isInline()) {
+                    value = heap->makeString(value.view());
+                }
+            }
+            break;
+        }
+        default:
+            tdb_unreachable("Unsupported column type");
+    }
+    out.count = count;
+}
+
+int64_t CachedTableReader::readBatch(RowVector& out, int64_t requestedRows) {
+    if (!started_) {
+        startReading();
+    }
+    string_heap_.reset();
+
+    const MaterializedInput& rows = table_->getRows();
+    while (chunk_ < chunks_.end) {
+        if (row_offset_ == 0 && !chunkMayMatch(chunk_)) {
+            ++skipped_chunks_;
+            ++chunk_;
+            continue;
+        }
+        if (row_offset_ < rows.getChunk(chunk_).getRowCount()) {
+            break;
+        }
+        ++chunk_;
+        row_offset_ = 0;
+    }
+    if (chunk_ >= chunks_.end) {
+        out.setRowCount(0);
+        return 0;
+    }
+
+    const RowVector& chunk = rows.getChunk(chunk_);
+    int64_t count = std::min(requestedRows, chunk.getRowCount() - row_offset_);
+    for (size_t i = 0; i < projected_columns_.size(); ++i) {
+        copyRows(chunk.getColumn(projected_columns_[i]), row_offset_, count,
+                 out.getColumn(static_cast<int64_t>(i)));
+    }
+
+    row_offset_ += count;
+    if (row_offset_ == chunk.getRowCount()) {
+        ++chunk_;
+        row_offset_ = 0;
+    }
+    out.setRowCount(count);
+    return count;
+}
+
+bool CachedTableReader::hasMore() const noexcept {
+    return chunk_ < chunks_.end;
+}
+
+void CachedTableReader::reset() {
+    chunk_ = chunks_.begin;
+    row_offset_ = 0;
+    skipped_chunks_ = 0;
+    started_ = false;
+}
+
+}  // namespace toydb
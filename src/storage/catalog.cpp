@@ -1,7 +1,13 @@
 #include "storage/catalog.hpp"
 #include "common/errors.hpp"
+#include "storage/file_sync.hpp"
+#include "storage/lockfile.hpp"
+#include "storage/secondary_index.hpp"
+#include "storage/statistics_collector.hpp"
+#include "storage/table_cache.hpp"
 #include "storage/table_handle.hpp"
 #include <fstream>
+#include <unordered_map>
 #include "common/assert.hpp"
 #include "common/logging.hpp"
 
@@ -13,6 +19,8 @@ std::string storageFormatToString(StorageFormat format) noexcept {
             return "parquet";
         case StorageFormat::CSV:
             return "csv";
+        case StorageFormat::TDB:
+            return "tdb";
         default:
             return "unknown";
     }
@@ -23,6 +31,8 @@ std::optional<StorageFormat> storageFormatFromString(const std::string& s) noexc
         return StorageFormat::PARQUET;
     } else if (s == "csv") {
         return StorageFormat::CSV;
+    } else if (s == "tdb") {
+        return StorageFormat::TDB;
     } else {
         return std::nullopt;
     }
@@ -51,6 +61,124 @@ FileEntry FileEntry::from_json(const json& j) {
     return entry;
 }
 
+MaterializedViewMetadata MaterializedViewMetadata::from_json(const json& obj) {
+    MaterializedViewMetadata view;
+    view.name = obj.at("name").get<std::string>();
+    view.query = obj.at("query").get<std::string>();
+    view.path = obj.at("path").get<std::string>();
+    if (obj.contains("files")) {
+        view.fileCounts = obj.at("files").get<std::unordered_map<std::string, size_t>>();
+    }
+    return view;
+}
+
+/**
+ * @brief Parse a "stats" object of a column or of a column of a file in the manifest. Min/max are
+ *        given in the column's type, a null fraction is converted to a null count over rowCount rows.
+ */
+static ColumnStatistics parseColumnStatistics(const json& obj, DataType type, std::optional<int64_t> rowCount) {
+    ColumnStatistics stats;
+    stats.type = type;
+    stats.rowCount = rowCount.value_or(0);
+    if (obj.contains("distinct_count")) {
+        stats.distinctCount = obj.at("distinct_count").get<int64_t>();
+    }
+    if (obj.contains("null_count")) {
+        stats.nullCount = obj.at("null_count").get<int64_t>();
+    } else if (obj.contains("null_fraction")) {
+        double nullFraction = obj.at("null_fraction").get<double>();
+        stats.nullCount = static_cast<int64_t>(nullFraction * static_cast<double>(stats.rowCount));
+    }
+    if (obj.contains("sketch")) {
+        stats.distinctSketch = HyperLogLog::fromHex(obj.at("sketch").get<std::string>());
+        if (!stats.distinctSketch) {
+            Logger::warn("Ignoring invalid distinct sketch in manifest");
+        }
+    }
+    if (obj.contains("histogram")) {
+        stats.histogram = obj.at("histogram").get<std::vector<double>>();
+        if (!std::is_sorted(stats.histogram.begin(), stats.histogram.end())) {
+            Logger::warn("Ignoring unsorted histogram in manifest");
+            stats.histogram.clear();
+        }
+    }
+    if (obj.contains("min") && obj.contains("max")) {
+        stats.hasMinMax = true;
+        if (type == DataType::getDouble()) {
+            stats.doubleMin = obj.at("min").get<double>();
+            stats.doubleMax = obj.at("max").get<double>();
+        } else if (type == DataType::getString()) {
+            stats.stringMin = obj.at("min").get<std::string>();
+            stats.stringMax = obj.at("max").get<std::string>();
+        } else {
+            stats.intMin = obj.at("min").get<int64_t>();
+            stats.intMax = obj.at("max").get<int64_t>();
+        }
+    }
+    return stats;
+}
+
+static json columnStatisticsToJson(const ColumnStatistics& stats) {
+    json obj;
+    obj["null_count"] = stats.nullCount;
+    if (stats.distinctCount) {
+        obj["distinct_count"] = *stats.distinctCount;
+    }
+    if (stats.hasMinMax) {
+        if (stats.type == DataType::getDouble()) {
+            obj["min"] = stats.doubleMin;
+            obj["max"] = stats.doubleMax;
+        } else if (stats.type == DataType::getString()) {
+            obj["min"] = stats.stringMin;
+            obj["max"] = stats.stringMax;
+        } else {
+            obj["min"] = stats.intMin;
+            obj["max"] = stats.intMax;
+        }
+    }
+    if (stats.distinctSketch) {
+        obj["sketch"] = stats.distinctSketch->toHex();
+    }
+    if (!stats.histogram.empty()) {
+        obj["histogram"] = stats.histogram;
+    }
+    return obj;
+}
+
+/**
+ * @brief Replace the statistics of the columns all files have statistics for with their merged statistics
+ */
+static void mergeFileStatistics(TableMetadata& meta) {
+    if (meta.files.empty()) {
+        return;
+    }
+
+    for (const ColumnId& colId : meta.schema.getColumnIds()) {
+        std::vector<const ColumnStatistics*> parts;
+        for (const FileEntry& file : meta.files) {
+            auto it = file.statistics.find(colId);
+            if (it == file.statistics.end()) {
+                break;
+            }
+            parts.push_back(&it->second);
+        }
+        if (parts.size() == meta.files.size()) {
+            meta.statistics[colId] = mergeColumnStatistics(parts);
+        }
+    }
+}
+
+std::optional<int64_t> TableMetadata::getRowCount() const noexcept {
+    int64_t rowCount = 0;
+    for (const FileEntry& file : files) {
+        if (!file.row_count) {
+            return std::nullopt;
+        }
+        rowCount += *file.row_count;
+    }
+    return rowCount;
+}
+
 std::expected<ColumnMetadata, CatalogError> Schema::getColumn(const ColumnId& colId) const noexcept {
     auto it = columnsById.find(colId);
     if (it != columnsById.end()) {
@@ -68,7 +196,11 @@ std::optional<ColumnMetadata> Schema::getColumnByName(const std::string& name) c
     return std::nullopt;
 }
 
-CatalogImpl::CatalogImpl(std::unique_ptr<CatalogManifest> manifest) : manifest_(std::move(manifest)) {
+CatalogImpl::CatalogImpl(std::unique_ptr<CatalogManifest> manifest)
+    : manifest_(std::move(manifest)), snapshot_(std::make_shared<const CatalogSnapshot>()) {
+    if (auto budget = TableCache::getBudgetFromEnvironment()) {
+        enableTableCache(*budget);
+    }
     if (!manifest_->load()) {
         Logger::error("Failed to load catalog manifest");
         return;
@@ -76,57 +208,111 @@ CatalogImpl::CatalogImpl(std::unique_ptr<CatalogManifest> manifest) : manifest_(
     initialize();
 }
 
-void CatalogImpl::initialize() {
-    name_to_table_id_.clear();
-    tables_by_id_.clear();
+void CatalogImpl::enableTableCache(size_t memoryBudget) {
+    table_cache_ = std::make_shared<TableCache>(memoryBudget);
+}
 
-    auto tableNames = manifest_->getTableNames();
-    for (const auto& name : tableNames) {
+void CatalogImpl::initialize() {
+    std::lock_guard lock(write_mutex_);
+    CatalogSnapshot snapshot;
+    for (const auto& name : manifest_->getTableNames()) {
         auto metaOpt = manifest_->getTableMetadata(name);
         if (!metaOpt) {
             continue;
         }
+        TableId tableId = metaOpt->id;
+        snapshot.tableIds[name] = tableId;
+        snapshot.tables[tableId] = std::make_shared<const TableMetadata>(std::move(*metaOpt));
+    }
+    for (MaterializedViewMetadata& view : manifest_->getMaterializedViews()) {
+        snapshot.views[view.name] = std::move(view);
+    }
+    publish(std::move(snapshot), {});
+}
 
-        TableMetadata& meta = *metaOpt;
-        name_to_table_id_[name] = meta.id;
-        tables_by_id_[meta.id] = std::move(meta);
+void CatalogImpl::publish(CatalogSnapshot snapshot, const std::vector<TableId>& changed) {
+    snapshot.version = getSnapshot()->version + 1;
+    snapshot_.store(std::make_shared<const CatalogSnapshot>(std::move(snapshot)), std::memory_order_release);
+    if (table_cache_) {
+        for (const TableId& tableId : changed) {
+            table_cache_->invalidate(tableId);
+        }
     }
 }
 
+std::expected<void, CatalogError> CatalogImpl::reload() {
+    std::lock_guard lock(write_mutex_);
+    auto changed = manifest_->reload();
+    if (!changed) {
+        return std::unexpected(CatalogError::READ_FAILED);
+    }
+    std::unordered_map<std::string, MaterializedViewMetadata> views;
+    for (MaterializedViewMetadata& view : manifest_->getMaterializedViews()) {
+        views[view.name] = std::move(view);
+    }
+    if (changed->empty() && views == getSnapshot()->views) {
+        return {};
+    }
+
+    // Copies the maps, the metadata of unchanged tables stays shared
+    CatalogSnapshot snapshot = *getSnapshot();
+    snapshot.views = std::move(views);
+    std::vector<TableId> changedIds;
+    for (const std::string& name : *changed) {
+        if (auto it = snapshot.tableIds.find(name); it != snapshot.tableIds.end()) {
+            changedIds.push_back(it->second);
+            snapshot.tables.erase(it->second);
+            snapshot.tableIds.erase(it);
+        }
+        if (auto metaOpt = manifest_->getTableMetadata(name)) {
+            TableId tableId = metaOpt->id;
+            changedIds.push_back(tableId);
+            snapshot.tableIds[name] = tableId;
+            snapshot.tables[tableId] = std::make_shared<const TableMetadata>(std::move(*metaOpt));
+        }
+    }
+    Logger::debug("Reloaded the catalog, {} tables changed", changed->size());
+    publish(std::move(snapshot), changedIds);
+    return {};
+}
+
 std::vector<TableId> CatalogImpl::listTables() {
+    auto snapshot = getSnapshot();
     std::vector<TableId> tables;
-    tables.reserve(name_to_table_id_.size());
-    for (const auto& [_, tableId] : name_to_table_id_) {
+    tables.reserve(snapshot->tableIds.size());
+    for (const auto& [_, tableId] : snapshot->tableIds) {
         tables.push_back(tableId);
     }
     return tables;
 }
 
 std::optional<TableId> CatalogImpl::getTableIdByName(const std::string& name) const noexcept {
-    auto it = name_to_table_id_.find(name);
-    if (it != name_to_table_id_.end()) {
+    auto snapshot = getSnapshot();
+    auto it = snapshot->tableIds.find(name);
+    if (it != snapshot->tableIds.end()) {
         return it->second;
     }
     return std::nullopt;
 }
 
 std::expected<std::string, CatalogError> CatalogImpl::getTableName(const TableId& id) const noexcept {
-    auto it = tables_by_id_.find(id);
-    if (it == tables_by_id_.end()) {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(id);
+    if (!meta) {
         return std::unexpected(CatalogError::TABLE_NOT_FOUND);
     }
-    return it->second.name;
+    return meta->name;
 }
 
 std::expected<ColumnId, CatalogError> CatalogImpl::resolveColumn(const TableId& tableId, const std::string& columnName) const noexcept {
-    auto tableIt = tables_by_id_.find(tableId);
-    if (tableIt == tables_by_id_.end()) {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(tableId);
+    if (!meta) {
         return std::unexpected(CatalogError::TABLE_NOT_FOUND);
     }
 
-    const auto& meta = tableIt->second;
-    auto colIt = meta.column_map.find(columnName);
-    if (colIt != meta.column_map.end()) {
+    auto colIt = meta->column_map.find(columnName);
+    if (colIt != meta->column_map.end()) {
         return colIt->second;
     }
 
@@ -134,51 +320,244 @@ std::expected<ColumnId, CatalogError> CatalogImpl::resolveColumn(const TableId&
 }
 
 std::expected<DataType, CatalogError> CatalogImpl::getColumnType(const ColumnId& columnId) const noexcept {
-    auto tableIt = tables_by_id_.find(columnId.getTableId());
-    if (tableIt == tables_by_id_.end()) {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(columnId.getTableId());
+    if (!meta) {
         return std::unexpected(CatalogError::TABLE_NOT_FOUND);
     }
 
-    const auto& meta = tableIt->second;
-    auto colResult = meta.schema.getColumn(columnId);
+    auto colResult = meta->schema.getColumn(columnId);
     if (!colResult.has_value()) {
         return std::unexpected(colResult.error());
     }
     return colResult->type;
 }
 
-std::expected<std::unique_ptr<TableHandle>, CatalogError> CatalogImpl::getTableHandle(const TableId& tableId) noexcept {
-    auto it = tables_by_id_.find(tableId);
-    if (it == tables_by_id_.end()) {
-        return std::unexpected(CatalogError::TABLE_NOT_FOUND);
+std::optional<int64_t> CatalogImpl::getRowCount(const TableId& tableId) const noexcept {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(tableId);
+    if (!meta) {
+        return std::nullopt;
+    }
+    return meta->getRowCount();
+}
+
+std::optional<ColumnStatistics> CatalogImpl::getColumnStatistics(const ColumnId& columnId) const noexcept {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(columnId.getTableId());
+    if (!meta) {
+        return std::nullopt;
     }
 
-    const auto& meta = it->second;
-    std::vector<fs::path> filePaths;
-    filePaths.reserve(meta.files.size());
+    auto it = meta->statistics.find(columnId);
+    if (it == meta->statistics.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
 
-    fs::path manifestPath = manifest_->getManifestPath();
-    fs::path baseDir = manifestPath.parent_path();
+fs::path CatalogImpl::getDataDirectory() const {
+    fs::path baseDir = manifest_->getManifestPath().parent_path();
     if (baseDir.empty() || !fs::exists(baseDir)) {
         baseDir = fs::current_path();
     }
+    return baseDir;
+}
 
-    for (const auto& fileEntry : meta.files) {
-        fs::path filePath = baseDir / fileEntry.path;
-        filePaths.push_back(filePath);
+std::expected<std::unique_ptr<TableHandle>, CatalogError> CatalogImpl::getTableHandle(const TableId& tableId) noexcept {
+    auto snapshot = getSnapshot();
+    auto it = snapshot->tables.find(tableId);
+    if (it == snapshot->tables.end()) {
+        return std::unexpected(CatalogError::TABLE_NOT_FOUND);
     }
 
-    std::vector<ColumnMetadata> columns;
-    const auto& columnIds = meta.schema.getColumnIds();
-    columns.reserve(columnIds.size());
-    for (const auto& colId : columnIds) {
+    // The handle expects metadata for every column
+    const TableMetadata& meta = *it->second;
+    for (const auto& colId : meta.schema.getColumnIds()) {
         auto colResult = meta.schema.getColumn(colId);
         if (!colResult)
             return std::unexpected(colResult.error());
-        columns.push_back(*colResult);
     }
 
-    return std::make_unique<TableHandle>(meta.id, meta.format, columns, filePaths);
+    // Shares the metadata of the snapshot, paths are resolved when files are opened
+    auto handle = std::make_unique<TableHandle>(it->second, getDataDirectory());
+    handle->setTableCache(table_cache_);
+    return handle;
+}
+
+std::expected<void, CatalogError> CatalogImpl::analyzeTable(const TableId& tableId) {
+    auto handle = getTableHandle(tableId);
+    if (!handle) {
+        return std::unexpected(handle.error());
+    }
+
+    // Analyzed without the write lock, the results are applied to the latest metadata below
+    std::shared_ptr<const TableMetadata> analyzedMeta = (*handle)->getMetadata();
+    std::unordered_map<std::string, FileEntry> analyzed;
+    for (const FileEntry& file : (*handle)->getFiles()) {
+        try {
+            analyzed.emplace(file.path.string(), (*handle)->analyzeFile(file));
+        } catch (const std::exception& e) {
+            Logger::error("Failed to analyze {}: {}", file.path.string(), e.what());
+            return std::unexpected(CatalogError::READ_FAILED);
+        }
+    }
+
+    std::lock_guard lock(write_mutex_);
+    auto latestSnapshot = getSnapshot();
+    auto latestIt = latestSnapshot->tables.find(tableId);
+    if (latestIt == latestSnapshot->tables.end()) {
+        return std::unexpected(CatalogError::TABLE_NOT_FOUND);
+    }
+    if (latestIt->second != analyzedMeta) {
+        // Files are only appended, files added meanwhile keep the statistics they were written with
+        Logger::debug("Table {} changed while it was analyzed", analyzedMeta->name);
+    }
+    TableMetadata meta = *latestIt->second;
+    for (FileEntry& file : meta.files) {
+        auto it = analyzed.find(file.path.string());
+        if (it != analyzed.end()) {
+            file.row_count = it->second.row_count;
+            file.statistics = std::move(it->second.statistics);
+        }
+    }
+    return replaceTable(std::move(meta));
+}
+
+std::expected<void, CatalogError> CatalogImpl::createIndex(const ColumnId& columnId) {
+    auto handle = getTableHandle(columnId.getTableId());
+    if (!handle) {
+        return std::unexpected(handle.error());
+    }
+    if ((*handle)->getFormat() != StorageFormat::TDB) {
+        Logger::error("Only TDB tables can be indexed, {} is {}", columnId.getTableId().getName(),
+                      storageFormatToString((*handle)->getFormat()));
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+    auto tableName = getTableName(columnId.getTableId());
+    auto type = getColumnType(columnId);
+    if (!tableName || !type) {
+        return std::unexpected(tableName ? type.error() : tableName.error());
+    }
+    if (*type != DataType::getInt32() && *type != DataType::getInt64()) {
+        Logger::error("Only INT32 and INT64 columns can be indexed, {} is {}", columnId.getName(), type->toString());
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+
+    // Built without the write lock like analyzeTable, files added meanwhile fail the update
+    fs::path baseDir = getDataDirectory();
+    fs::path path = baseDir / (*tableName + "-" + columnId.getName() + ".idx");
+    size_t fileCount = (*handle)->getFiles().size();
+    try {
+        if (!SecondaryIndex::build(**handle, columnId, path)) {
+            return std::unexpected(CatalogError::WRITE_FAILED);
+        }
+    } catch (const std::exception& e) {
+        Logger::error("Failed to index {}: {}", columnId.getName(), e.what());
+        return std::unexpected(CatalogError::READ_FAILED);
+    }
+
+    std::lock_guard lock(write_mutex_);
+    const TableMetadata* current = getSnapshot()->findTable(columnId.getTableId());
+    if (!current || current->files.size() != fileCount) {
+        Logger::error("Table {} changed while it was indexed", *tableName);
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+    TableMetadata meta = *current;
+    std::erase_if(meta.indexes, [&columnId](const IndexMetadata& index) { return index.column == columnId; });
+    meta.indexes.push_back({columnId, path.lexically_relative(baseDir), fileCount});
+    return replaceTable(std::move(meta));
+}
+
+std::expected<void, CatalogError> CatalogImpl::replaceTable(TableMetadata meta) {
+    mergeFileStatistics(meta);
+
+    if (!manifest_->updateTable(meta)) {
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+    TableId tableId = meta.id;
+    CatalogSnapshot snapshot = *getSnapshot();
+    snapshot.tables[tableId] = std::make_shared<const TableMetadata>(std::move(meta));
+    publish(std::move(snapshot), {tableId});
+    return {};
+}
+
+std::expected<fs::path, CatalogError> CatalogImpl::createFilePath(const TableId& tableId) const {
+    auto snapshot = getSnapshot();
+    const TableMetadata* meta = snapshot->findTable(tableId);
+    if (!meta) {
+        return std::unexpected(CatalogError::TABLE_NOT_FOUND);
+    }
+
+    fs::path baseDir = getDataDirectory();
+    std::string extension = storageFormatToString(meta->format);
+    // Files left behind by writes that failed before they were added are skipped, not overwritten
+    for (size_t i = meta->files.size();; ++i) {
+        fs::path path = baseDir / (meta->name + "-" + std::to_string(i) + "." + extension);
+        if (!fs::exists(path)) {
+            return path;
+        }
+    }
+}
+
+std::expected<void, CatalogError> CatalogImpl::addFiles(const TableId& tableId, std::vector<FileEntry> files) {
+    std::lock_guard lock(write_mutex_);
+    auto snapshot = getSnapshot();
+    const TableMetadata* current = snapshot->findTable(tableId);
+    if (!current) {
+        return std::unexpected(CatalogError::TABLE_NOT_FOUND);
+    }
+
+    TableMetadata meta = *current;
+    fs::path baseDir = getDataDirectory();
+    for (FileEntry& file : files) {
+        file.path = file.path.lexically_relative(baseDir);
+        meta.files.push_back(std::move(file));
+    }
+    return replaceTable(std::move(meta));
+}
+
+std::vector<MaterializedViewMetadata> CatalogImpl::listMaterializedViews() const {
+    auto snapshot = getSnapshot();
+    fs::path baseDir = getDataDirectory();
+    std::vector<MaterializedViewMetadata> views;
+    views.reserve(snapshot->views.size());
+    for (const auto& [_, view] : snapshot->views) {
+        views.push_back(view);
+        views.back().path = baseDir / view.path;
+    }
+    return views;
+}
+
+fs::path CatalogImpl::createViewPath(const std::string& name) const {
+    fs::path baseDir = getDataDirectory();
+    // The current contents of the view stay readable until the new ones replace them
+    for (size_t i = 0;; ++i) {
+        fs::path path = baseDir / (name + "-" + std::to_string(i) + ".mv");
+        if (!fs::exists(path)) {
+            return path;
+        }
+    }
+}
+
+std::expected<void, CatalogError> CatalogImpl::putMaterializedView(MaterializedViewMetadata view) {
+    std::lock_guard lock(write_mutex_);
+    view.path = view.path.lexically_relative(getDataDirectory());
+    if (!manifest_->updateMaterializedView(view)) {
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+    CatalogSnapshot snapshot = *getSnapshot();
+    snapshot.views[view.name] = std::move(view);
+    publish(std::move(snapshot), {});
+    return {};
+}
+
+std::expected<void, CatalogError> CatalogImpl::sync() {
+    std::lock_guard lock(write_mutex_);
+    if (!manifest_->sync()) {
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+    return {};
 }
 
 bool JsonCatalogManifest::load() {
@@ -194,6 +573,44 @@ bool JsonCatalogManifest::load() {
     return parseManifest();
 }
 
+std::optional<std::vector<std::string>> JsonCatalogManifest::reload() {
+    json previousRoot = root_;
+    auto previousByName = tables_by_name_;
+    auto previousById = tables_by_id_;
+    if (!fs::exists(manifest_path_) || !parseManifest()) {
+        Logger::error("Failed to reload manifest {}", manifest_path_.string());
+        root_ = std::move(previousRoot);
+        tables_by_name_ = std::move(previousByName);
+        tables_by_id_ = std::move(previousById);
+        return std::nullopt;
+    }
+
+    std::unordered_map<std::string, const json*> previousJson;
+    if (previousRoot.contains("tables")) {
+        for (const auto& tableJson : previousRoot.at("tables")) {
+            previousJson[tableJson.at("name").get<std::string>()] = &tableJson;
+        }
+    }
+
+    // A table is unchanged if its JSON is and its columns kept their ids, which are numbered across tables
+    std::vector<std::string> changed;
+    for (const auto& tableJson : root_.at("tables")) {
+        std::string name = tableJson.at("name").get<std::string>();
+        auto it = previousJson.find(name);
+        if (it == previousJson.end() || *it->second != tableJson ||
+            previousByName.at(name).schema.getColumnIds() != tables_by_name_.at(name).schema.getColumnIds()) {
+            changed.push_back(name);
+        }
+        if (it != previousJson.end()) {
+            previousJson.erase(it);
+        }
+    }
+    for (const auto& [name, _] : previousJson) {
+        changed.push_back(name);
+    }
+    return changed;
+}
+
 bool JsonCatalogManifest::parseManifest() {
     std::ifstream ifs(manifest_path_);
     if (!ifs) {
@@ -216,8 +633,11 @@ bool JsonCatalogManifest::parseManifest() {
 
     tables_by_name_.clear();
     tables_by_id_.clear();
+    std::vector<MaterializedViewMetadata> views;
 
     try {
+        // Column ids are unique across all tables, so columns of different tables can be told apart in a query
+        uint64_t nextColumnId = 1;
         for (const auto& tableJson : root.at("tables")) {
             TableMetadata meta;
             meta.name = tableJson.at("name").get<std::string>();
@@ -234,8 +654,14 @@ bool JsonCatalogManifest::parseManifest() {
             }
             meta.format = *formatOpt;
 
+            // Files first, the null fractions of the column statistics are relative to the row count
+            if (tableJson.contains("files")) {
+                for (const auto& fileJson : tableJson.at("files")) {
+                    meta.files.push_back(FileEntry::from_json(fileJson));
+                }
+            }
+
             if (tableJson.contains("schema")) {
-                uint64_t nextColumnId = 1;
                 std::vector<ColumnId> columnIds;
                 std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById;
 
@@ -245,29 +671,182 @@ bool JsonCatalogManifest::parseManifest() {
                     columnIds.push_back(colId);
                     columnsById[colId] = colMeta;
                     meta.column_map[colMeta.name] = colId;
+
+                    if (colJson.contains("stats")) {
+                        meta.statistics[colId] = parseColumnStatistics(colJson.at("stats"), colMeta.type, meta.getRowCount());
+                    }
                 }
 
                 meta.schema = Schema(std::move(columnIds), std::move(columnsById));
             }
 
             if (tableJson.contains("files")) {
-                for (const auto& fileJson : tableJson.at("files")) {
-                    meta.files.push_back(FileEntry::from_json(fileJson));
+                const json& filesJson = tableJson.at("files");
+                for (size_t i = 0; i < filesJson.size(); ++i) {
+                    if (!filesJson[i].contains("stats")) {
+                        continue;
+                    }
+                    FileEntry& file = meta.files[i];
+                    for (const auto& [columnName, statsJson] : filesJson[i].at("stats").items()) {
+                        auto colIt = meta.column_map.find(columnName);
+                        if (colIt == meta.column_map.end()) {
+                            Logger::warn("Ignoring statistics of unknown column {} of {}", columnName, file.path.string());
+                            continue;
+                        }
+                        DataType type = meta.schema.getColumn(colIt->second)->type;
+                        file.statistics[colIt->second] = parseColumnStatistics(statsJson, type, file.row_count);
+                    }
+                }
+            }
+            if (tableJson.contains("indexes")) {
+                for (const auto& indexJson : tableJson.at("indexes")) {
+                    std::string columnName = indexJson.at("column").get<std::string>();
+                    auto colIt = meta.column_map.find(columnName);
+                    if (colIt == meta.column_map.end()) {
+                        Logger::warn("Ignoring index of unknown column {} of {}", columnName, meta.name);
+                        continue;
+                    }
+                    meta.indexes.push_back({colIt->second, indexJson.at("path").get<std::string>(),
+                                            indexJson.at("files").get<size_t>()});
                 }
             }
+            mergeFileStatistics(meta);
 
             tables_by_name_[meta.name] = meta;
             tables_by_id_[meta.id] = meta;
         }
+
+        if (root.contains("materialized_views")) {
+            for (const auto& viewJson : root.at("materialized_views")) {
+                views.push_back(MaterializedViewMetadata::from_json(viewJson));
+            }
+        }
     } catch (const std::exception& e) {
         Logger::error("Error parsing table metadata: {}", e.what());
         return false;
     }
 
+    root_ = std::move(root);
+    views_ = std::move(views);
     loaded_ = true;
     return true;
 }
 
+bool JsonCatalogManifest::updateTable(const TableMetadata& meta) {
+    // Changed on a copy, a failed write must not leave appended files behind
+    json root = root_;
+    json* tableJson = nullptr;
+    for (auto& candidate : root.at("tables")) {
+        if (candidate.at("id").get<uint64_t>() == meta.id.getId()) {
+            tableJson = &candidate;
+            break;
+        }
+    }
+    if (!tableJson || (*tableJson)["files"].size() > meta.files.size()) {
+        Logger::error("Table {} changed in the manifest", meta.name);
+        return false;
+    }
+
+    json& filesJson = tableJson->at("files");
+    for (size_t i = 0; i < meta.files.size(); ++i) {
+        const FileEntry& file = meta.files[i];
+        if (i == filesJson.size()) {
+            filesJson.push_back({{"path", file.path.string()}});
+        }
+        json& fileJson = filesJson[i];
+        if (file.row_count) {
+            fileJson["row_count"] = *file.row_count;
+        }
+
+        json statsJson = json::object();
+        for (const ColumnId& colId : meta.schema.getColumnIds()) {
+            auto it = file.statistics.find(colId);
+            if (it != file.statistics.end()) {
+                statsJson[colId.getName()] = columnStatisticsToJson(it->second);
+            }
+        }
+        fileJson["stats"] = std::move(statsJson);
+    }
+
+    if (meta.indexes.empty()) {
+        tableJson->erase("indexes");
+    } else {
+        json indexesJson = json::array();
+        for (const IndexMetadata& index : meta.indexes) {
+            indexesJson.push_back(
+                {{"column", index.column.getName()}, {"path", index.path.string()}, {"files", index.fileCount}});
+        }
+        (*tableJson)["indexes"] = std::move(indexesJson);
+    }
+
+    if (!writeManifest(root)) {
+        return false;
+    }
+    root_ = std::move(root);
+    tables_by_name_[meta.name] = meta;
+    tables_by_id_[meta.id] = meta;
+    return true;
+}
+
+bool JsonCatalogManifest::updateMaterializedView(const MaterializedViewMetadata& view) {
+    json root = root_;
+    json& viewsJson = root["materialized_views"];
+    if (!viewsJson.is_array()) {
+        viewsJson = json::array();
+    }
+    json viewJson = {{"name", view.name}, {"query", view.query}, {"path", view.path.string()}, {"files", view.fileCounts}};
+    auto it = std::find_if(viewsJson.begin(), viewsJson.end(),
+                           [&view](const json& candidate) { return candidate.at("name") == view.name; });
+    if (it == viewsJson.end()) {
+        viewsJson.push_back(std::move(viewJson));
+    } else {
+        *it = std::move(viewJson);
+    }
+
+    if (!writeManifest(root)) {
+        return false;
+    }
+    root_ = std::move(root);
+    std::erase_if(views_, [&view](const MaterializedViewMetadata& candidate) { return candidate.name == view.name; });
+    views_.push_back(view);
+    return true;
+}
+
+bool JsonCatalogManifest::writeManifest(const json& root) {
+    // Written to a temporary file and renamed, so readers never see a partially written manifest
+    Lockfile lock(fs::path(manifest_path_.string() + ".lock"));
+    if (!lock.lock()) {
+        Logger::error("Failed to lock manifest {}", manifest_path_.string());
+        return false;
+    }
+    fs::path tmpPath = manifest_path_.string() + ".tmp";
+    {
+        std::ofstream ofs(tmpPath);
+        ofs << root.dump(2) << "\n";
+        if (!ofs) {
+            Logger::error("Failed to write manifest {}", tmpPath.string());
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::rename(tmpPath, manifest_path_, error);
+    if (error) {
+        Logger::error("Failed to replace manifest {}: {}", manifest_path_.string(), error.message());
+        return false;
+    }
+    return true;
+}
+
+bool JsonCatalogManifest::sync() {
+    // The directory holds the rename that replaced the manifest
+    fs::path directory = manifest_path_.parent_path().empty() ? fs::current_path() : manifest_path_.parent_path();
+    if (!syncPath(manifest_path_) || !syncPath(directory)) {
+        Logger::error("Failed to sync manifest {}", manifest_path_.string());
+        return false;
+    }
+    return true;
+}
+
 std::vector<std::string> JsonCatalogManifest::getTableNames() const {
     std::vector<std::string> names;
     names.reserve(tables_by_name_.size());
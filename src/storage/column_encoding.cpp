@@ -0,0 +1,789 @@
+#include "storage/column_encoding.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <unordered_map>
+#include "common/assert.hpp"
+#include "common/errors.hpp"
+#include "storage/tdb_file.hpp"
+
+namespace toydb {
+
+std::string columnEncodingToString(ColumnEncoding encoding) noexcept {
+    switch (encoding) {
+        case ColumnEncoding::PLAIN:
+            return "plain";
+        case ColumnEncoding::DICTIONARY:
+            return "dictionary";
+        case ColumnEncoding::RLE:
+            return "rle";
+        case ColumnEncoding::FRAME_OF_REFERENCE:
+            return "frame_of_reference";
+        default:
+            return "unknown";
+    }
+}
+
+template<typename T>
+static T load(const char* bytes) noexcept {
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void pad(std::string& out) {
+    out.resize(tdb::align(out.size()), '\0');
+}
+
+static uint32_t bitWidth(uint64_t maxValue) noexcept {
+    return static_cast<uint32_t>(64 - std::countl_zero(maxValue));
+}
+
+static size_t packedBytes(int64_t count, uint32_t width) noexcept {
+    return (static_cast<size_t>(count) * width + 63) / 64 * sizeof(uint64_t);
+}
+
+// Values are packed into 64-bit words starting at the least significant bit
+static void packBits(const std::vector<uint64_t>& values, uint32_t width, std::string& out) {
+    std::vector<uint64_t> words(packedBytes(static_cast<int64_t>(values.size()), width) / sizeof(uint64_t), 0);
+    for (size_t i = 0; i < values.size() && width > 0; ++i) {
+        size_t bit = i * width;
+        size_t word = bit / 64;
+        size_t shift = bit % 64;
+        words[word] |= values[i] << shift;
+        if (shift + width > 64) {
+            words[word + 1] |= values[i] >> (64 - shift);
+        }
+    }
+    out.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+}
+
+static uint64_t unpackBits(const char* packed, uint32_t width, int64_t index) noexcept {
+    if (width == 0) {
+        return 0;
+    }
+    size_t bit = static_cast<size_t>(index) * width;
+    size_t word = bit / 64;
+    size_t shift = bit % 64;
+    uint64_t value = load<uint64_t>(packed + word * sizeof(uint64_t)) >> shift;
+    if (shift + width > 64) {
+        value |= load<uint64_t>(packed + (word + 1) * sizeof(uint64_t)) << (64 - shift);
+    }
+    return width == 64 ? value : value & ((uint64_t{1} << width) - 1);
+}
+
+/**
+ * @brief Copy count bits starting at bit srcBit of src to the start of dst. src holds srcBytes bytes.
+ */
+static void copyBits(const uint8_t* src, size_t srcBytes, int64_t srcBit, uint8_t* dst, int64_t count) {
+    auto bytes = static_cast<size_t>(count + 7) / 8;
+    size_t first = static_cast<size_t>(srcBit / 8);
+    int shift = static_cast<int>(srcBit % 8);
+    if (shift == 0) {
+        std::memcpy(dst, src + first, bytes);
+        return;
+    }
+    for (size_t i = 0; i < bytes; ++i) {
+        unsigned low = src[first + i] >> shift;
+        unsigned high = first + i + 1 < srcBytes ? src[first + i + 1] << (8 - shift) : 0;
+        dst[i] = static_cast<uint8_t>(low | high);
+    }
+}
+
+static std::string_view readPlainString(const char* values, std::string_view chars, int64_t row) {
+    const char* value = values + static_cast<size_t>(row) * sizeof(db_string);
+    auto length = load<uint32_t>(value);
+    if (length <= db_string::INLINE_LENGTH) {
+        return {value + sizeof(uint32_t), length};
+    }
+    // The pointer after the prefix is the offset of the characters
+    auto offset = load<uint64_t>(value + sizeof(uint32_t) + db_string::PREFIX_LENGTH);
+    if (offset > chars.size() || length > chars.size() - offset) {
+        throw InternalSQLError("String characters out of range of the chunk");
+    }
+    return chars.substr(offset, length);
+}
+
+static int64_t readPlainInt(DataType type, const char* values, int64_t row) noexcept {
+    auto index = static_cast<size_t>(row);
+    switch (type.getType()) {
+        case DataType::Type::INT32:
+            return load<db_int32>(values + index * sizeof(db_int32));
+        case DataType::Type::INT64:
+            return load<db_int64>(values + index * sizeof(db_int64));
+        case DataType::Type::BOOL:
+            return load<uint8_t>(values + index) != 0;
+        default:
+            tdb_unreachable("Not an integral column");
+    }
+}
+
+int64_t PlainChunk::getInt(int64_t row) const noexcept {
+    return readPlainInt(type, values, row);
+}
+
+std::string_view PlainChunk::getString(int64_t row) const {
+    return readPlainString(values, chars, row);
+}
+
+static void appendBitmap(const PlainChunk& chunk, std::string& out) {
+    size_t start = out.size();
+    out.append(reinterpret_cast<const char*>(chunk.bitmap), static_cast<size_t>(chunk.rowCount + 7) / 8);
+    out.resize(start + tdb::bitmapBytes(chunk.rowCount), '\0');
+}
+
+/**
+ * @brief Integral values of a chunk, NULL rows repeat the previous value so they don't break runs
+ */
+struct IntegralValues {
+    std::vector<int64_t> values;
+    int64_t min = 0;
+    int64_t max = 0;
+    size_t runCount = 0;
+
+    explicit IntegralValues(const PlainChunk& chunk) {
+        bool first = true;
+        for (int64_t row = 0; row < chunk.rowCount; ++row) {
+            if (chunk.isNull(row)) {
+                continue;
+            }
+            int64_t value = chunk.getInt(row);
+            min = first ? value : std::min(min, value);
+            max = first ? value : std::max(max, value);
+            first = false;
+        }
+
+        int64_t previous = min;
+        values.reserve(static_cast<size_t>(chunk.rowCount));
+        for (int64_t row = 0; row < chunk.rowCount; ++row) {
+            int64_t value = chunk.isNull(row) ? previous : chunk.getInt(row);
+            if (row == 0 || value != previous) {
+                ++runCount;
+            }
+            values.push_back(value);
+            previous = value;
+        }
+    }
+
+    uint32_t getDeltaWidth() const noexcept {
+        return bitWidth(static_cast<uint64_t>(max) - static_cast<uint64_t>(min));
+    }
+};
+
+static void encodePlain(const PlainChunk& chunk, std::string& out) {
+    appendBitmap(chunk, out);
+    out.append(chunk.values, ColumnBuffer::calculateDataSize(chunk.rowCount, chunk.type));
+    pad(out);
+    out.append(chunk.chars);
+    pad(out);
+}
+
+static void encodeRle(const PlainChunk& chunk, const IntegralValues& ints, std::string& out) {
+    std::vector<int64_t> runValues;
+    std::vector<uint32_t> runEnds;
+    for (size_t row = 0; row < ints.values.size(); ++row) {
+        if (row == 0 || ints.values[row] != runValues.back()) {
+            runValues.push_back(ints.values[row]);
+            runEnds.push_back(0);
+        }
+        runEnds.back() = static_cast<uint32_t>(row + 1);
+    }
+
+    appendBitmap(chunk, out);
+    append(out, static_cast<uint32_t>(runValues.size()));
+    append(out, uint32_t{0});
+    out.append(reinterpret_cast<const char*>(runValues.data()), runValues.size() * sizeof(int64_t));
+    out.append(reinterpret_cast<const char*>(runEnds.data()), runEnds.size() * sizeof(uint32_t));
+    pad(out);
+}
+
+static void encodeFrameOfReference(const PlainChunk& chunk, const IntegralValues& ints, std::string& out) {
+    uint32_t width = ints.getDeltaWidth();
+    std::vector<uint64_t> deltas;
+    deltas.reserve(ints.values.size());
+    for (int64_t value : ints.values) {
+        deltas.push_back(static_cast<uint64_t>(value) - static_cast<uint64_t>(ints.min));
+    }
+
+    appendBitmap(chunk, out);
+    append(out, ints.min);
+    append(out, width);
+    append(out, uint32_t{0});
+    packBits(deltas, width, out);
+}
+
+/**
+ * @brief Sorted distinct values of a string chunk, nullopt once there are more than maxSize
+ */
+static std::optional<std::vector<std::string_view>> collectDictionary(const PlainChunk& chunk, size_t maxSize) {
+    std::unordered_map<std::string_view, uint32_t> distinct;
+    for (int64_t row = 0; row < chunk.rowCount; ++row) {
+        if (!chunk.isNull(row) && distinct.emplace(chunk.getString(row), 0).second && distinct.size() > maxSize) {
+            return std::nullopt;
+        }
+    }
+
+    std::vector<std::string_view> dictionary;
+    dictionary.reserve(distinct.size());
+    for (const auto& [value, code] : distinct) {
+        dictionary.push_back(value);
+    }
+    std::sort(dictionary.begin(), dictionary.end());
+    return dictionary;
+}
+
+static uint32_t dictionaryCodeWidth(size_t dictionarySize) noexcept {
+    return dictionarySize <= 1 ? 0 : bitWidth(dictionarySize - 1);
+}
+
+static size_t dictionaryBytes(const PlainChunk& chunk, const std::vector<std::string_view>& dictionary) {
+    size_t chars = 0;
+    for (std::string_view value : dictionary) {
+        chars += value.size();
+    }
+    return tdb::bitmapBytes(chunk.rowCount) + 2 * sizeof(uint32_t) +
+           tdb::align((dictionary.size() + 1) * sizeof(uint32_t)) + tdb::align(chars) +
+           packedBytes(chunk.rowCount, dictionaryCodeWidth(dictionary.size()));
+}
+
+static void encodeDictionary(const PlainChunk& chunk, const std::vector<std::string_view>& dictionary,
+                             std::string& out) {
+    std::unordered_map<std::string_view, uint64_t> codes;
+    std::string chars;
+    std::vector<uint32_t> offsets;
+    for (std::string_view value : dictionary) {
+        codes.emplace(value, codes.size());
+        offsets.push_back(static_cast<uint32_t>(chars.size()));
+        chars.append(value);
+    }
+    offsets.push_back(static_cast<uint32_t>(chars.size()));
+
+    std::vector<uint64_t> rowCodes;
+    rowCodes.reserve(static_cast<size_t>(chunk.rowCount));
+    for (int64_t row = 0; row < chunk.rowCount; ++row) {
+        rowCodes.push_back(chunk.isNull(row) ? 0 : codes.at(chunk.getString(row)));
+    }
+
+    uint32_t width = dictionaryCodeWidth(dictionary.size());
+    appendBitmap(chunk, out);
+    append(out, static_cast<uint32_t>(dictionary.size()));
+    append(out, width);
+    out.append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    pad(out);
+    out.append(chars);
+    pad(out);
+    packBits(rowCodes, width, out);
+}
+
+void encodeChunk(const PlainChunk& chunk, ColumnEncoding encoding, std::string& out) {
+    std::string encoded;
+    switch (encoding) {
+        case ColumnEncoding::PLAIN:
+            encodePlain(chunk, encoded);
+            break;
+        case ColumnEncoding::DICTIONARY: {
+            tdb_assert(chunk.type == DataType::getString(), "Dictionary encoding needs a string column");
+            encodeDictionary(chunk, *collectDictionary(chunk, SIZE_MAX), encoded);
+            break;
+        }
+        case ColumnEncoding::RLE:
+            tdb_assert(chunk.type.isIntegral(), "RLE needs an integral column");
+            encodeRle(chunk, IntegralValues(chunk), encoded);
+            break;
+        case ColumnEncoding::FRAME_OF_REFERENCE:
+            tdb_assert(chunk.type == DataType::getInt32() || chunk.type == DataType::getInt64(),
+                       "Frame of reference encoding needs an INT32 or INT64 column");
+            encodeFrameOfReference(chunk, IntegralValues(chunk), encoded);
+            break;
+    }
+    out.append(encoded);
+}
+
+ColumnEncoding encodeChunk(const PlainChunk& chunk, std::string& out) {
+    size_t bitmap = tdb::bitmapBytes(chunk.rowCount);
+    size_t plainBytes = bitmap + tdb::align(ColumnBuffer::calculateDataSize(chunk.rowCount, chunk.type)) +
+                        tdb::align(chunk.chars.size());
+    ColumnEncoding best = ColumnEncoding::PLAIN;
+    size_t bestBytes = plainBytes;
+
+    if (chunk.type.isIntegral()) {
+        IntegralValues ints(chunk);
+        size_t rleBytes = bitmap + 2 * sizeof(uint32_t) +
+                          tdb::align(ints.runCount * (sizeof(int64_t) + sizeof(uint32_t)));
+        if (rleBytes < bestBytes) {
+            best = ColumnEncoding::RLE;
+            bestBytes = rleBytes;
+        }
+
+        uint32_t width = ints.getDeltaWidth();
+        size_t forBytes = bitmap + sizeof(int64_t) + 2 * sizeof(uint32_t) + packedBytes(chunk.rowCount, width);
+        if (chunk.type != DataType::getBool() && width < 8 * static_cast<uint32_t>(chunk.type.getSize()) &&
+            forBytes < bestBytes) {
+            best = ColumnEncoding::FRAME_OF_REFERENCE;
+            bestBytes = forBytes;
+        }
+
+        std::string encoded;
+        if (best == ColumnEncoding::RLE) {
+            encodeRle(chunk, ints, encoded);
+        } else if (best == ColumnEncoding::FRAME_OF_REFERENCE) {
+            encodeFrameOfReference(chunk, ints, encoded);
+        } else {
+            encodePlain(chunk, encoded);
+        }
+        out.append(encoded);
+        return best;
+    }
+
+    if (chunk.type == DataType::getString()) {
+        // Only low-cardinality columns are worth a dictionary
+        auto dictionary = collectDictionary(chunk, static_cast<size_t>(chunk.rowCount / 2));
+        if (dictionary && dictionaryBytes(chunk, *dictionary) < bestBytes) {
+            std::string encoded;
+            encodeDictionary(chunk, *dictionary, encoded);
+            out.append(encoded);
+            return ColumnEncoding::DICTIONARY;
+        }
+    }
+
+    encodeChunk(chunk, ColumnEncoding::PLAIN, out);
+    return ColumnEncoding::PLAIN;
+}
+
+std::optional<EncodedChunk> EncodedChunk::open(ColumnEncoding encoding, DataType type, const char* data, size_t size,
+                                               int64_t rowCount) {
+    EncodedChunk chunk;
+    chunk.encoding_ = encoding;
+    chunk.type_ = type;
+    chunk.row_count_ = rowCount;
+    chunk.bitmap_ = reinterpret_cast<const uint8_t*>(data);
+
+    size_t pos = tdb::bitmapBytes(rowCount);
+    if (rowCount < 0 || size < pos) {
+        return std::nullopt;
+    }
+    auto fits = [&](size_t bytes) { return size - pos >= bytes; };
+
+    switch (encoding) {
+        case ColumnEncoding::PLAIN: {
+            size_t valuesBytes = tdb::align(ColumnBuffer::calculateDataSize(rowCount, type));
+            if (!fits(valuesBytes)) {
+                return std::nullopt;
+            }
+            chunk.values_ = data + pos;
+            pos += valuesBytes;
+            chunk.chars_ = std::string_view(data + pos, size - pos);
+            return chunk;
+        }
+        case ColumnEncoding::DICTIONARY: {
+            if (type != DataType::getString() || !fits(2 * sizeof(uint32_t))) {
+                return std::nullopt;
+            }
+            chunk.dictionary_size_ = load<uint32_t>(data + pos);
+            chunk.bit_width_ = load<uint32_t>(data + pos + sizeof(uint32_t));
+            pos += 2 * sizeof(uint32_t);
+
+            size_t offsetsBytes = tdb::align((size_t{chunk.dictionary_size_} + 1) * sizeof(uint32_t));
+            if (chunk.bit_width_ > 32 || !fits(offsetsBytes)) {
+                return std::nullopt;
+            }
+            chunk.dictionary_offsets_ = data + pos;
+            pos += offsetsBytes;
+
+            // Offsets must be ascending and end within the chunk
+            uint32_t previous = 0;
+            for (uint32_t i = 0; i <= chunk.dictionary_size_; ++i) {
+                uint32_t offset = load<uint32_t>(chunk.dictionary_offsets_ + i * sizeof(uint32_t));
+                if (offset < previous) {
+                    return std::nullopt;
+                }
+                previous = offset;
+            }
+            if (!fits(tdb::align(previous))) {
+                return std::nullopt;
+            }
+            chunk.dictionary_chars_ = std::string_view(data + pos, previous);
+            pos += tdb::align(previous);
+
+            if (!fits(packedBytes(rowCount, chunk.bit_width_))) {
+                return std::nullopt;
+            }
+            chunk.packed_ = data + pos;
+            return chunk;
+        }
+        case ColumnEncoding::RLE: {
+            if (!type.isIntegral() || !fits(2 * sizeof(uint32_t))) {
+                return std::nullopt;
+            }
+            chunk.run_count_ = load<uint32_t>(data + pos);
+            pos += 2 * sizeof(uint32_t);
+            if (!fits(tdb::align(size_t{chunk.run_count_} * (sizeof(int64_t) + sizeof(uint32_t))))) {
+                return std::nullopt;
+            }
+            chunk.run_values_ = data + pos;
+            chunk.run_ends_ = data + pos + size_t{chunk.run_count_} * sizeof(int64_t);
+
+            // Runs must be ascending and cover all rows
+            uint32_t previous = 0;
+            for (uint32_t run = 0; run < chunk.run_count_; ++run) {
+                uint32_t end = chunk.getRunEnd(run);
+                if (end <= previous) {
+                    return std::nullopt;
+                }
+                previous = end;
+            }
+            if (previous != rowCount) {
+                return std::nullopt;
+            }
+            return chunk;
+        }
+        case ColumnEncoding::FRAME_OF_REFERENCE: {
+            if ((type != DataType::getInt32() && type != DataType::getInt64()) ||
+                !fits(sizeof(int64_t) + 2 * sizeof(uint32_t))) {
+                return std::nullopt;
+            }
+            chunk.reference_ = load<int64_t>(data + pos);
+            chunk.bit_width_ = load<uint32_t>(data + pos + sizeof(int64_t));
+            pos += sizeof(int64_t) + 2 * sizeof(uint32_t);
+            if (chunk.bit_width_ >= 64 || !fits(packedBytes(rowCount, chunk.bit_width_))) {
+                return std::nullopt;
+            }
+            chunk.packed_ = data + pos;
+            return chunk;
+        }
+    }
+    return std::nullopt;
+}
+
+uint64_t EncodedChunk::getCode(int64_t row) const noexcept {
+    return unpackBits(packed_, bit_width_, row);
+}
+
+std::string_view EncodedChunk::getDictionaryValue(uint64_t code) const {
+    if (code >= dictionary_size_) {
+        throw InternalSQLError("Dictionary code " + std::to_string(code) + " out of range");
+    }
+    auto begin = load<uint32_t>(dictionary_offsets_ + code * sizeof(uint32_t));
+    auto end = load<uint32_t>(dictionary_offsets_ + (code + 1) * sizeof(uint32_t));
+    return dictionary_chars_.substr(begin, end - begin);
+}
+
+int64_t EncodedChunk::getRunValue(uint32_t run) const noexcept {
+    return load<int64_t>(run_values_ + size_t{run} * sizeof(int64_t));
+}
+
+uint32_t EncodedChunk::getRunEnd(uint32_t run) const noexcept {
+    return load<uint32_t>(run_ends_ + size_t{run} * sizeof(uint32_t));
+}
+
+// Index of the run containing the row
+uint32_t EncodedChunk::findRun(int64_t row) const noexcept {
+    uint32_t low = 0;
+    uint32_t high = run_count_;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (getRunEnd(middle) <= row) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+int64_t EncodedChunk::getInt(int64_t row) const {
+    switch (encoding_) {
+        case ColumnEncoding::PLAIN:
+            return readPlainInt(type_, values_, row);
+        case ColumnEncoding::RLE:
+            return getRunValue(findRun(row));
+        case ColumnEncoding::FRAME_OF_REFERENCE:
+            return static_cast<int64_t>(static_cast<uint64_t>(reference_) + getCode(row));
+        default:
+            tdb_unreachable("Encoding has no integral values");
+    }
+}
+
+std::string_view EncodedChunk::getString(int64_t row) const {
+    if (encoding_ == ColumnEncoding::DICTIONARY) {
+        return getDictionaryValue(getCode(row));
+    }
+    return readPlainString(values_, chars_, row);
+}
+
+void EncodedChunk::writeRow(int64_t row, ColumnBuffer& out, int64_t index, StringHeap* heap) const {
+    if (isNull(row)) {
+        out.setNull(index);
+        if (type_ == DataType::getString()) {
+            // Don't leave a pointer behind
+            out.writeEntry(index, db_string());
+        }
+        return;
+    }
+
+    out.clearNull(index);
+    switch (type_.getType()) {
+        case DataType::Type::INT32:
+            out.writeEntry(index, static_cast<db_int32>(getInt(row)));
+            break;
+        case DataType::Type::INT64:
+            out.writeEntry(index, static_cast<db_int64>(getInt(row)));
+            break;
+        case DataType::Type::BOOL:
+            out.writeEntry(index, static_cast<db_bool>(getInt(row) != 0));
+            break;
+        case DataType::Type::DOUBLE:
+            out.writeEntry(index, load<db_double>(values_ + static_cast<size_t>(row) * sizeof(db_double)));
+            break;
+        case DataType::Type::STRING:
+            out.writeString(index, getString(row), heap);
+            break;
+        default:
+            tdb_unreachable("Unsupported column type");
+    }
+}
+
+template<is_db_type T>
+static void copyPlainValues(const char* values, int64_t begin, int64_t count, ColumnBuffer& out) {
+    std::memcpy(out.getDataAs<T>().data(), values + static_cast<size_t>(begin) * sizeof(T),
+                static_cast<size_t>(count) * sizeof(T));
+}
+
+template<is_db_type T>
+static void writeIntegral(std::span<T> out, int64_t index, int64_t value) {
+    out[static_cast<size_t>(index)] = static_cast<T>(value);
+}
+
+void EncodedChunk::decode(int64_t begin, int64_t count, ColumnBuffer& out, StringHeap* heap) const {
+    tdb_assert(begin >= 0 && count >= 0 && begin + count <= row_count_, "Rows out of range of the chunk");
+    tdb_assert(out.type == type_, "Column type mismatch");
+
+    NullBitmap bitmap = out.getNullBitmap();
+    if (bitmap.data()) {
+        copyBits(bitmap_, tdb::bitmapBytes(row_count_), begin, bitmap.data(), count);
+    }
+
+    if (encoding_ == ColumnEncoding::PLAIN && type_ != DataType::getString()) {
+        switch (type_.getType()) {
+            case DataType::Type::INT32:
+                copyPlainValues<db_int32>(values_, begin, count, out);
+                break;
+            case DataType::Type::INT64:
+                copyPlainValues<db_int64>(values_, begin, count, out);
+                break;
+            case DataType::Type::DOUBLE:
+                copyPlainValues<db_double>(values_, begin, count, out);
+                break;
+            case DataType::Type::BOOL:
+                copyPlainValues<db_bool>(values_, begin, count, out);
+                break;
+            default:
+                tdb_unreachable("Unsupported column type");
+        }
+    } else if (type_ == DataType::getString()) {
+        for (int64_t i = 0; i < count; ++i) {
+            if (isNull(begin + i)) {
+                out.writeEntry(i, db_string());
+            } else {
+                out.writeString(i, getString(begin + i), heap);
+            }
+        }
+    } else {
+        // Values of NULL rows are decoded as well, their bits are already cleared
+        uint32_t run = encoding_ == ColumnEncoding::RLE ? findRun(begin) : 0;
+        for (int64_t i = 0; i < count; ++i) {
+            int64_t value;
+            if (encoding_ == ColumnEncoding::RLE) {
+                while (getRunEnd(run) <= begin + i) {
+                    ++run;
+                }
+                value = getRunValue(run);
+            } else {
+                value = getInt(begin + i);
+            }
+
+            switch (type_.getType()) {
+                case DataType::Type::INT32:
+                    writeIntegral(out.getDataAs<db_int32>(), i, value);
+                    break;
+                case DataType::Type::INT64:
+                    writeIntegral(out.getDataAs<db_int64>(), i, value);
+                    break;
+                case DataType::Type::BOOL:
+                    out.getDataAs<db_bool>()[static_cast<size_t>(i)] = value != 0;
+                    break;
+                default:
+                    tdb_unreachable("Unsupported column type");
+            }
+        }
+    }
+    out.count = count;
+}
+
+void EncodedChunk::gather(std::span<const int64_t> rows, ColumnBuffer& out, StringHeap* heap) const {
+    tdb_assert(out.type == type_, "Column type mismatch");
+    for (size_t i = 0; i < rows.size(); ++i) {
+        tdb_assert(rows[i] >= 0 && rows[i] < row_count_, "Row {} out of range of the chunk", rows[i]);
+        writeRow(rows[i], out, static_cast<int64_t>(i), heap);
+    }
+    out.count = static_cast<int64_t>(rows.size());
+}
+
+static bool isComparison(CompareOp op) noexcept {
+    switch (op) {
+        case CompareOp::EQUAL:
+        case CompareOp::NOT_EQUAL:
+        case CompareOp::LESS:
+        case CompareOp::LESS_EQUAL:
+        case CompareOp::GREATER:
+        case CompareOp::GREATER_EQUAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool compareValues(CompareOp op, int64_t left, int64_t right) noexcept {
+    switch (op) {
+        case CompareOp::EQUAL: return left == right;
+        case CompareOp::NOT_EQUAL: return left != right;
+        case CompareOp::LESS: return left < right;
+        case CompareOp::LESS_EQUAL: return left <= right;
+        case CompareOp::GREATER: return left > right;
+        case CompareOp::GREATER_EQUAL: return left >= right;
+        default: return false;
+    }
+}
+
+/**
+ * Codes are ordered like the values: below codes are smaller than the constant, and if found the
+ * next one is equal to it. Every comparison then selects a range of codes, or its complement.
+ */
+void EncodedChunk::filterCodes(CompareOp op, uint64_t below, bool found, int64_t begin, int64_t count,
+                               std::vector<uint8_t>& passes) const {
+    uint64_t equalEnd = below + (found ? 1 : 0);
+    uint64_t from = 0;
+    uint64_t to = UINT64_MAX;
+    bool negate = false;
+    switch (op) {
+        case CompareOp::EQUAL:
+            from = below;
+            to = equalEnd;
+            break;
+        case CompareOp::NOT_EQUAL:
+            from = below;
+            to = equalEnd;
+            negate = true;
+            break;
+        case CompareOp::LESS:
+            to = below;
+            break;
+        case CompareOp::LESS_EQUAL:
+            to = equalEnd;
+            break;
+        case CompareOp::GREATER:
+            from = equalEnd;
+            break;
+        case CompareOp::GREATER_EQUAL:
+            from = below;
+            break;
+        default:
+            tdb_unreachable("Not a comparison");
+    }
+
+    for (int64_t i = 0; i < count; ++i) {
+        auto index = static_cast<size_t>(i);
+        if (!passes[index]) {
+            continue;
+        }
+        uint64_t code = getCode(begin + i);
+        bool inRange = code >= from && code < to;
+        if (isNull(begin + i) || inRange == negate) {
+            passes[index] = 0;
+        }
+    }
+}
+
+bool EncodedChunk::filter(CompareOp op, kernels::CompareDomain domain, const ConstantExpr& constant, int64_t begin,
+                          int64_t count, std::vector<uint8_t>& passes) const {
+    tdb_assert(begin >= 0 && count >= 0 && begin + count <= row_count_, "Rows out of range of the chunk");
+    tdb_assert(passes.size() >= static_cast<size_t>(count), "Too few results for the rows");
+    if (!isComparison(op)) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    if (constant.isNull()) {
+        // Comparisons with NULL are never TRUE
+        std::fill_n(passes.begin(), count, 0);
+        return true;
+    }
+
+    bool integralConstant = kernels::isIntegralType(constant.getType());
+    switch (encoding_) {
+        case ColumnEncoding::DICTIONARY: {
+            if (domain != kernels::CompareDomain::STRING || constant.getType() != DataType::getString()) {
+                return false;
+            }
+            std::string_view value = constant.getStringValue();
+            uint32_t low = 0;
+            uint32_t high = dictionary_size_;
+            while (low < high) {
+                uint32_t middle = low + (high - low) / 2;
+                if (getDictionaryValue(middle) < value) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            bool found = low < dictionary_size_ && getDictionaryValue(low) == value;
+            filterCodes(op, low, found, begin, count, passes);
+            return true;
+        }
+        case ColumnEncoding::FRAME_OF_REFERENCE: {
+            if (domain != kernels::CompareDomain::INTEGRAL || !integralConstant) {
+                return false;
+            }
+            int64_t value = constant.getType() == DataType::getBool() ? constant.getBoolValue() : constant.getIntValue();
+            uint64_t maxDelta = (uint64_t{1} << bit_width_) - 1;
+            if (value < reference_) {
+                filterCodes(op, 0, false, begin, count, passes);
+            } else if (uint64_t delta = static_cast<uint64_t>(value) - static_cast<uint64_t>(reference_);
+                       delta > maxDelta) {
+                filterCodes(op, maxDelta + 1, false, begin, count, passes);
+            } else {
+                filterCodes(op, delta, true, begin, count, passes);
+            }
+            return true;
+        }
+        case ColumnEncoding::RLE: {
+            if (domain != kernels::CompareDomain::INTEGRAL || !integralConstant) {
+                return false;
+            }
+            int64_t value = constant.getType() == DataType::getBool() ? constant.getBoolValue() : constant.getIntValue();
+            uint32_t run = findRun(begin);
+            bool runPasses = compareValues(op, getRunValue(run), value);
+            for (int64_t i = 0; i < count; ++i) {
+                if (getRunEnd(run) <= begin + i) {
+                    ++run;
+                    runPasses = compareValues(op, getRunValue(run), value);
+                }
+                if (!runPasses || isNull(begin + i)) {
+                    passes[static_cast<size_t>(i)] = 0;
+                }
+            }
+            return true;
+        }
+        case ColumnEncoding::PLAIN:
+            return false;
+    }
+    return false;
+}
+
+}  // namespace toydb
@@ -1,81 +1,353 @@
 #include "storage/csv_data_file_reader.hpp"
-#include <cstring>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common/logging.hpp"
+#include "common/simd_kernels.hpp"
 #include "common/types.hpp"
 #include "common/assert.hpp"
 
 namespace toydb {
 
 CsvDataFileReader::CsvDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId)
-    : file_path_(filePath), schema_(schema), table_id_(tableId), header_read_(false), eof_(false) {
-    file_.open(filePath);
-    if (!file_.is_open() || !file_.good()) {
+    : file_path_(filePath), schema_(schema), table_id_(tableId), header_read_(false), eof_(false),
+      projection_(schema.getColumnIds()) {
+    resolveColumns();
+
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    struct stat fileStat{};
+    if (fd < 0 || ::fstat(fd, &fileStat) != 0) {
         Logger::error("Failed to open CSV file: {}", filePath.string());
+        if (fd >= 0) {
+            ::close(fd);
+        }
         eof_ = true;
         return;
     }
+
+    size_ = static_cast<size_t>(fileStat.st_size);
+    file_size_ = size_;
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            Logger::error("Failed to map CSV file: {}", filePath.string());
+            size_ = 0;
+        } else {
+            ::madvise(mapping, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(mapping);
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    eof_ = data_ == nullptr;
+}
+
+CsvDataFileReader::CsvDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId,
+                                     CsvByteRange range)
+    : CsvDataFileReader(filePath, schema, tableId) {
+    range_begin_ = std::min(range.begin, file_size_);
+    range_end_ = range.end;
+    ranged_ = true;
+    reset();
+}
+
+CsvDataFileReader::~CsvDataFileReader() {
+    if (data_ && !async_io_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
 }
 
 void CsvDataFileReader::reset() {
-    if (file_.is_open()) {
-        file_.clear();
-        file_.seekg(0, std::ios::beg);
+    header_read_ = ranged_;
+    if (!async_io_) {
+        pos_ = range_begin_;
+        eof_ = data_ == nullptr || pos_ >= getRangeEnd();
+        return;
+    }
+
+    // Read the blocks of the range again, starting with an empty window
+    stream_.reset();
+    stream_ = std::make_unique<AsyncFileReader>(file_path_, range_begin_, *async_io_);
+    if (stream_->isOpen()) {
+        file_size_ = stream_->getFileSize();
+    }
+    window_.clear();
+    window_offset_ = range_begin_;
+    data_ = window_.data();
+    size_ = 0;
+    pos_ = 0;
+    eof_ = !stream_->isOpen() || pos_ >= getRangeEnd();
+}
+
+void CsvDataFileReader::setAsyncIo(const AsyncIoOptions& options) {
+    if (data_ && !async_io_) {
+        ::munmap(const_cast<char*>(data_), size_);
     }
-    header_read_ = false;
-    eof_ = false;
+    async_io_ = options;
+    reset();
 }
 
-// Peek next character in file stream until non linebreak is reached
-static bool hasNonEmptyLine(std::ifstream& file) {
-    if (!file.is_open() || !file.good()) {
+// End of the range as a position in data_
+size_t CsvDataFileReader::getRangeEnd() const noexcept {
+    size_t end = std::min(file_size_, range_end_);
+    return end > window_offset_ ? end - window_offset_ : 0;
+}
+
+// Append the next block of the file to the window, returns false if there is none
+bool CsvDataFileReader::extendWindow() {
+    if (!stream_) {
+        return false;
+    }
+    std::string_view block = stream_->next();
+    if (block.empty()) {
+        // The file ends with the window, also if a read failed
+        file_size_ = window_offset_ + size_;
         return false;
     }
+    window_.append(block);
+    data_ = window_.data();
+    size_ = window_.size();
+    return true;
+}
+
+// Drop the lines before pos_ from the window, no batch refers to them anymore
+void CsvDataFileReader::compactWindow() {
+    window_.erase(0, pos_);
+    window_offset_ += pos_;
+    pos_ = 0;
+    data_ = window_.data();
+    size_ = window_.size();
+}
+
+void CsvDataFileReader::setProjection(const std::vector<ColumnId>& columns) {
+    projection_ = columns;
+    resolveColumns();
+}
 
-    file.clear();
+void CsvDataFileReader::setPredicate(const PredicateExpr* predicate) {
+    predicate_ = predicate;
+    resolveColumns();
+}
 
-    int c;
-    while ((c = file.peek()) != EOF) {
-        if (c == '\n' || c == '\r') {
-            file.get();
+void CsvDataFileReader::resolveColumns() {
+    const auto& columnIds = schema_.getColumnIds();
+    projected_fields_.clear();
+    field_count_ = 0;
+    for (const auto& colId : projection_) {
+        auto it = std::find(columnIds.begin(), columnIds.end(), colId);
+        tdb_assert(it != columnIds.end(), "Projected column {} not found in schema", colId.getId());
+        size_t field = static_cast<size_t>(it - columnIds.begin());
+        projected_fields_.push_back(field);
+        field_count_ = std::max(field_count_, field + 1);
+    }
+
+    predicate_columns_.clear();
+    predicate_field_count_ = 0;
+    predicate_input_.clear();
+    fused_predicate_.reset();
+    if (!predicate_) {
+        return;
+    }
+
+    std::vector<const ColumnRefExpr*> refs;
+    collectColumnRefs(predicate_, refs);
+    for (const ColumnRefExpr* ref : refs) {
+        auto it = std::find(projection_.begin(), projection_.end(), ref->getColumnId());
+        if (it == projection_.end()) {
+            Logger::debug("CsvDataFileReader: predicate column {} is not projected, rows are not filtered",
+                          ref->getColumnId().getName());
+            predicate_columns_.clear();
+            predicate_field_count_ = 0;
+            return;
+        }
+        size_t column = static_cast<size_t>(it - projection_.begin());
+        predicate_columns_.push_back(column);
+        predicate_field_count_ = std::max(predicate_field_count_, projected_fields_[column] + 1);
+    }
+    fused_predicate_ = FusedPredicate::compile(*predicate_);
+}
+
+// Allocate a scratch column for every projected column the predicate references
+void CsvDataFileReader::allocatePredicateInput(int64_t capacity) {
+    predicate_data_.assign(projection_.size(), {});
+    predicate_nulls_.assign(projection_.size(), {});
+    std::vector<ColumnBuffer> columns(projection_.size());
+    for (size_t column : predicate_columns_) {
+        if (!predicate_data_[column].empty()) {
             continue;
-        } else {
-            return true;
         }
+        DataType type = schema_.getColumn(projection_[column])->type;
+        predicate_data_[column].resize(ColumnBuffer::calculateDataSize(capacity, type));
+        predicate_nulls_[column].resize(static_cast<size_t>((capacity + 7) / 8));
+        columns[column] = ColumnBuffer(projection_[column], type, predicate_data_[column].data(), capacity,
+                                       NullBitmap(predicate_nulls_[column].data(), capacity));
+    }
+
+    // A column referenced several times appears at each of its indices
+    predicate_input_.clear();
+    for (size_t column : predicate_columns_) {
+        predicate_input_.addColumn(columns[column]);
     }
+}
 
-    return false;
+// Skip linebreaks until a non-empty line or the end of the file is reached
+void CsvDataFileReader::skipEmptyLines() {
+    do {
+        while (pos_ < size_ && (data_[pos_] == '\n' || data_[pos_] == '\r')) {
+            ++pos_;
+        }
+    } while (pos_ == size_ && pos_ < getRangeEnd() && extendWindow());
+}
+
+// Returns the position after the line break that ends the line containing from. inQuotes is
+// the quote state at from, line breaks inside quotes don't end a line.
+size_t CsvDataFileReader::findNextLine(size_t from, bool inQuotes) const noexcept {
+    const char* p = data_ + from;
+    const char* fileEnd = data_ + size_;
+
+    while (true) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(fileEnd - p)));
+        const char* lineEnd = newline ? newline : fileEnd;
+        for (const char* q = p; (q = static_cast<const char*>(std::memchr(q, '"', static_cast<size_t>(lineEnd - q)))); ++q) {
+            inQuotes = !inQuotes;
+        }
+
+        if (!newline) {
+            return size_;
+        }
+        if (!inQuotes) {
+            return static_cast<size_t>(newline - data_) + 1;
+        }
+        p = newline + 1;
+    }
+}
+
+// Returns the next line without the line break and advances past it
+std::string_view CsvDataFileReader::nextLine() {
+    size_t start = pos_;
+    pos_ = findNextLine(pos_, false);
+    // A line reaching the end of the window may continue in the next block
+    while (pos_ == size_ && extendWindow()) {
+        pos_ = findNextLine(start, false);
+    }
+
+    size_t end = pos_;
+    if (end > start && data_[end - 1] == '\n') {
+        --end;
+    }
+    if (end > start && data_[end - 1] == '\r') {
+        --end;
+    }
+    return std::string_view(data_ + start, end - start);
+}
+
+std::vector<CsvByteRange> CsvDataFileReader::splitRanges(size_t rangeCount) const {
+    tdb_assert(!async_io_, "Ranges are split on the mapping of the file");
+    std::vector<CsvByteRange> ranges;
+    if (!data_ || rangeCount == 0) {
+        return ranges;
+    }
+
+    size_t begin = findNextLine(0, false);  // Skip the header
+    size_t targetSize = std::max<size_t>(1, (size_ - std::min(begin, size_) + rangeCount - 1) / rangeCount);
+
+    while (begin < size_) {
+        size_t split = begin + targetSize;
+        if (split >= size_ || ranges.size() + 1 == rangeCount) {
+            ranges.push_back({begin, size_});
+            break;
+        }
+
+        // begin is a line start outside of quotes, so the quote state at split follows from the quotes in between
+        bool inQuotes = std::count(data_ + begin, data_ + split, '"') % 2 == 1;
+        split = findNextLine(split, inQuotes);
+        ranges.push_back({begin, split});
+        begin = split;
+    }
+
+    return ranges;
 }
 
 bool CsvDataFileReader::hasMore() const noexcept {
-    return !eof_ && file_.is_open() && file_.good();
+    return !eof_;
 }
 
-std::vector<std::string> CsvDataFileReader::parseCSVLine(const std::string& line) {
-    std::vector<std::string> fields;
-    std::string field;
-    bool inQuotes = false;
+// Split the line into fields_, stopping after maxFields fields
+void CsvDataFileReader::parseCSVLine(std::string_view line, size_t maxFields) {
+    fields_.clear();
+    // Quoted fields are never longer than the line, so views into the buffer stay valid
+    quoted_fields_.clear();
+    quoted_fields_.reserve(line.size());
 
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
+    const char* p = line.data();
+    const char* end = p + line.size();
+    // First separator or double quote, with the widest vectors the host supports
+    auto findSpecial = simd::getKernels().findSpecial;
 
-        if (c == '"') {
-            inQuotes = !inQuotes;
-        } else if (c == separator_ && !inQuotes) {
-            fields.push_back(field);
-            field.clear();
+    while (true) {
+        const char* start = p;
+        p = findSpecial(p, end, separator_);
+
+        if (p == end || *p == separator_) {
+            fields_.emplace_back(start, static_cast<size_t>(p - start));
         } else {
-            field += c;
+            // Field contains quotes, copy it without them
+            size_t quotedStart = quoted_fields_.size();
+            bool inQuotes = false;
+            quoted_fields_.append(start, p);
+
+            while (p < end && (inQuotes || *p != separator_)) {
+                if (*p == '"') {
+                    inQuotes = !inQuotes;
+                    ++p;
+                    continue;
+                }
+                const char* next = findSpecial(p + 1, end, separator_);
+                quoted_fields_.append(p, next);
+                p = next;
+            }
+            fields_.emplace_back(quoted_fields_.data() + quotedStart, quoted_fields_.size() - quotedStart);
+        }
+
+        if (p == end || fields_.size() == maxFields) {
+            break;
         }
+        ++p;  // Skip the separator
+    }
+}
+
+template<typename T>
+static bool parseNumber(std::string_view value, T& out) noexcept {
+    const char* first = value.data();
+    const char* last = first + value.size();
+
+    // Accept the same leading characters as std::stoi
+    while (first < last && std::isspace(static_cast<unsigned char>(*first))) {
+        ++first;
+    }
+    if (first < last && *first == '+') {
+        ++first;
     }
-    fields.push_back(field);
 
-    return fields;
+    auto [ptr, ec] = std::from_chars(first, last, out);
+    return ec == std::errc();
 }
 
+static bool equalsIgnoreCase(std::string_view value, std::string_view expected) noexcept {
+    return value.size() == expected.size() &&
+           std::equal(value.begin(), value.end(), expected.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
 
 template<is_db_type T>
-void parseAndWriteValue(const std::string& valueStr, ColumnBuffer& colBuf, int64_t index) {
+void parseAndWriteValue(std::string_view valueStr, ColumnBuffer& colBuf, int64_t index, StringHeap& stringHeap) {
     if (valueStr.empty() || valueStr == "NULL" || valueStr == "null") {
         colBuf.setNull(index);
         return;
@@ -83,58 +355,73 @@ void parseAndWriteValue(const std::string& valueStr, ColumnBuffer& colBuf, int64
 
     colBuf.clearNull(index);
 
-    if constexpr (std::same_as<T, db_int32>) {
-        colBuf.writeEntry(index, static_cast<db_int32>(std::stoi(valueStr)));
-    } else if constexpr (std::same_as<T, db_int64>) {
-        colBuf.writeEntry(index, static_cast<db_int64>(std::stoll(valueStr)));
-    } else if constexpr (std::same_as<T, db_double>) {
-        colBuf.writeEntry(index, static_cast<db_double>(std::stod(valueStr)));
-    } else if constexpr (std::same_as<T, db_bool>) {
-        std::string lower = valueStr;
-        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-        colBuf.writeEntry(index, static_cast<db_bool>(lower == "true"));
+    if constexpr (std::same_as<T, db_bool>) {
+        colBuf.writeEntry(index, static_cast<db_bool>(equalsIgnoreCase(valueStr, "true")));
     } else if constexpr (std::same_as<T, db_string>) {
-        db_string str{};
-        size_t len = std::min(valueStr.length(), size_t(255));
-        std::strncpy(str, valueStr.c_str(), len);
-        str[len] = '\0';
-        colBuf.writeEntry(index, str);
+        // Prefer the column's own heap, so the strings live as long as the batch
+        colBuf.writeString(index, valueStr, colBuf.getStringHeap() ? colBuf.getStringHeap() : &stringHeap);
+    } else {
+        T value{};
+        if (parseNumber(valueStr, value)) {
+            colBuf.writeEntry(index, value);
+        } else {
+            Logger::warn("Invalid {} value in CSV: '{}'", colBuf.type.toString(), valueStr);
+            colBuf.setNull(index);
+        }
+    }
+}
+
+static void writeField(std::string_view field, ColumnBuffer& colBuf, int64_t index, StringHeap& stringHeap) {
+    switch (colBuf.type.getType()) {
+        case DataType::Type::INT32:
+            parseAndWriteValue<db_int32>(field, colBuf, index, stringHeap);
+            break;
+        case DataType::Type::INT64:
+            parseAndWriteValue<db_int64>(field, colBuf, index, stringHeap);
+            break;
+        case DataType::Type::DOUBLE:
+            parseAndWriteValue<db_double>(field, colBuf, index, stringHeap);
+            break;
+        case DataType::Type::BOOL:
+            parseAndWriteValue<db_bool>(field, colBuf, index, stringHeap);
+            break;
+        case DataType::Type::STRING:
+            parseAndWriteValue<db_string>(field, colBuf, index, stringHeap);
+            break;
+        default:
+            tdb_unreachable("Unsupported type");
     }
 }
 
 int64_t CsvDataFileReader::readBatch(RowVector& out, int64_t requestedRows) {
-    if (eof_ || !file_.is_open() || !file_.good()) {
+    if (eof_) {
         return 0;
     }
 
+    if (stream_) {
+        compactWindow();
+    }
+
     if (!header_read_) {
-        std::string headerLine;
-        if (!std::getline(file_, headerLine)) {
-            eof_ = true;
-            return 0;
-        }
+        nextLine();
         header_read_ = true;
     }
 
     // Verify ColumnBuffers exist and have sufficient capacity
-    const auto& columnIds = schema_.getColumnIds();
-    tdb_assert(out.getColumnCount() == static_cast<int64_t>(columnIds.size()),
-        "RowVector column count ({}) does not match schema column count ({})",
-        out.getColumnCount(), columnIds.size());
+    tdb_assert(out.getColumnCount() == static_cast<int64_t>(projection_.size()),
+        "RowVector column count ({}) does not match projected column count ({})",
+        out.getColumnCount(), projection_.size());
 
     std::vector<ColumnBuffer*> columnBuffers;
-    size_t colIdx = 0;
-    for (const auto& colId : columnIds) {
-        [[maybe_unused]] const auto& colMeta = schema_.getColumn(colId);
-        tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
-        tdb_assert(colIdx < static_cast<size_t>(out.getColumnCount()),
-            "Column index {} out of range", colIdx);
+    for (size_t colIdx = 0; colIdx < projection_.size(); ++colIdx) {
+        [[maybe_unused]] const auto& colMeta = schema_.getColumn(projection_[colIdx]);
+        tdb_assert(colMeta, "Column {} not found in schema", projection_[colIdx].getId());
 
         ColumnBuffer& colBuf = out.getColumn(static_cast<int64_t>(colIdx));
 
-        tdb_assert(colBuf.columnId == colId,
+        tdb_assert(colBuf.columnId == projection_[colIdx],
             "Column {} mismatch: expected {}, got {}",
-            colIdx, colId.getId(), colBuf.columnId.getId());
+            colIdx, projection_[colIdx].getId(), colBuf.columnId.getId());
         tdb_assert(colBuf.type == colMeta->type,
             "Column {} type mismatch: expected {}, got {}",
             colIdx, colMeta->type.toString(), colBuf.type.toString());
@@ -143,58 +430,46 @@ int64_t CsvDataFileReader::readBatch(RowVector& out, int64_t requestedRows) {
             colIdx, colBuf.getCapacity(), requestedRows);
 
         columnBuffers.push_back(&colBuf);
-        ++colIdx;
     }
 
+    // Strings of the previous batch are no longer referenced
+    string_heap_.reset();
+
+    // Lines with more fields than the schema are only detected if all fields are split
+    size_t columnCount = schema_.getColumnIds().size();
+    size_t maxFields = field_count_ < columnCount ? field_count_ : columnCount + 1;
+
     int64_t rowsRead = 0;
-    std::string line;
 
-    while (rowsRead < requestedRows && std::getline(file_, line)) {
-        if (line.empty()) {
-            continue;
-        }
+    if (!predicate_columns_.empty()) {
+        rowsRead = readFilteredBatch(columnBuffers, requestedRows, maxFields);
+    } else {
+        while (rowsRead < requestedRows && pos_ < getRangeEnd()) {
+            std::string_view line = nextLine();
+            if (line.empty()) {
+                continue;
+            }
 
-        std::vector<std::string> fields = parseCSVLine(line);
-        if (fields.size() != columnIds.size()) {
-            Logger::warn("CSV line has {} fields, expected {}: {}", fields.size(), columnIds.size(), line);
-            continue;
-        }
+            parseCSVLine(line, maxFields);
+            if (fields_.size() < field_count_ || fields_.size() > columnCount) {
+                Logger::warn("CSV line has {} fields, expected {}: {}", fields_.size(), columnCount, line);
+                continue;
+            }
 
-        colIdx = 0;
-        for (const auto& colId : columnIds) {
-            const auto& colMeta = schema_.getColumn(colId);
-            tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
-
-            ColumnBuffer& colBuf = *columnBuffers[colIdx];
-
-            switch (colMeta->type.getType()) {
-                case DataType::Type::INT32:
-                    parseAndWriteValue<db_int32>(fields[colIdx], colBuf, rowsRead);
-                    break;
-                case DataType::Type::INT64:
-                    parseAndWriteValue<db_int64>(fields[colIdx], colBuf, rowsRead);
-                    break;
-                case DataType::Type::DOUBLE:
-                    parseAndWriteValue<db_double>(fields[colIdx], colBuf, rowsRead);
-                    break;
-                case DataType::Type::BOOL:
-                    parseAndWriteValue<db_bool>(fields[colIdx], colBuf, rowsRead);
-                    break;
-                case DataType::Type::STRING:
-                    parseAndWriteValue<db_string>(fields[colIdx], colBuf, rowsRead);
-                    break;
-                default:
-                    tdb_unreachable("Unsupported type");
+            for (size_t colIdx = 0; colIdx < columnBuffers.size(); ++colIdx) {
+                writeField(fields_[projected_fields_[colIdx]], *columnBuffers[colIdx], rowsRead, string_heap_);
             }
 
-            ++colIdx;
+            ++rowsRead;
         }
+    }
 
-        ++rowsRead;
+    skipEmptyLines();
+    if (pos_ >= getRangeEnd()) {
+        eof_ = true;
     }
 
     if (rowsRead == 0) {
-        eof_ = true;
         return 0;
     }
 
@@ -205,8 +480,82 @@ int64_t CsvDataFileReader::readBatch(RowVector& out, int64_t requestedRows) {
 
     out.setRowCount(rowsRead);
 
-    if (!hasNonEmptyLine(file_)) {
-        eof_ = true;
+    return rowsRead;
+}
+
+/**
+ * Reads chunks of lines until requestedRows rows passed the predicate or the range is exhausted.
+ * The fields the predicate references are parsed into the scratch columns and the predicate is
+ * evaluated on the chunk, then only the lines of the passing rows are split completely and written
+ * to the output columns.
+ */
+int64_t CsvDataFileReader::readFilteredBatch(const std::vector<ColumnBuffer*>& columnBuffers, int64_t requestedRows,
+                                             size_t maxFields) {
+    if (predicate_input_.getColumnCount() == 0 || predicate_input_.getColumn(0).getCapacity() < requestedRows) {
+        allocatePredicateInput(requestedRows);
+    }
+
+    size_t columnCount = schema_.getColumnIds().size();
+    int64_t rowsRead = 0;
+
+    while (rowsRead < requestedRows && pos_ < getRangeEnd()) {
+        // Strings of the previous chunk are no longer referenced
+        predicate_heap_.reset();
+        chunk_lines_.clear();
+
+        int64_t chunkSize = requestedRows - rowsRead;
+        while (static_cast<int64_t>(chunk_lines_.size()) < chunkSize && pos_ < getRangeEnd()) {
+            std::string_view line = nextLine();
+            if (line.empty()) {
+                continue;
+            }
+
+            parseCSVLine(line, predicate_field_count_);
+            if (fields_.size() < predicate_field_count_) {
+                Logger::warn("CSV line has {} fields, expected {}: {}", fields_.size(), columnCount, line);
+                continue;
+            }
+
+            int64_t row = static_cast<int64_t>(chunk_lines_.size());
+            for (int64_t i = 0; i < predicate_input_.getColumnCount(); ++i) {
+                writeField(fields_[projected_fields_[predicate_columns_[static_cast<size_t>(i)]]],
+                           predicate_input_.getColumn(i), row, predicate_heap_);
+            }
+            // The window may grow while the chunk is read, so lines are kept as positions
+            size_t lineBegin = static_cast<size_t>(line.data() - data_);
+            chunk_lines_.push_back({lineBegin, lineBegin + line.size()});
+        }
+
+        int64_t chunkRows = static_cast<int64_t>(chunk_lines_.size());
+        if (chunkRows == 0) {
+            break;
+        }
+        for (int64_t i = 0; i < predicate_input_.getColumnCount(); ++i) {
+            predicate_input_.getColumn(i).count = chunkRows;
+        }
+        predicate_input_.setRowCount(chunkRows);
+
+        if (fused_predicate_) {
+            fused_predicate_->evaluateInto(predicate_input_, predicate_result_);
+        } else {
+            predicate_scratch_.reset();
+            predicate_->evaluateInto(predicate_input_, predicate_result_, predicate_scratch_);
+        }
+        const PredicateResultVector& result = predicate_result_;
+        for (int64_t row = result.nextTrue(0); row < chunkRows; row = result.nextTrue(row + 1)) {
+            const CsvByteRange& lineRange = chunk_lines_[static_cast<size_t>(row)];
+            std::string_view line(data_ + lineRange.begin, lineRange.end - lineRange.begin);
+            parseCSVLine(line, maxFields);
+            if (fields_.size() < field_count_ || fields_.size() > columnCount) {
+                Logger::warn("CSV line has {} fields, expected {}: {}", fields_.size(), columnCount, line);
+                continue;
+            }
+
+            for (size_t colIdx = 0; colIdx < columnBuffers.size(); ++colIdx) {
+                writeField(fields_[projected_fields_[colIdx]], *columnBuffers[colIdx], rowsRead, string_heap_);
+            }
+            ++rowsRead;
+        }
     }
 
     return rowsRead;
@@ -0,0 +1,147 @@
+#include "storage/parallel_scan.hpp"
+#include <algorithm>
+#include "common/logging.hpp"
+#include "common/metrics.hpp"
+
+namespace toydb {
+
+static metrics::Counter& rowsScanned() {
+    static metrics::Counter& counter = metrics::MetricsRegistry::global().counter(
+        "toydb_scan_rows_total", "Rows read from tables, after the readers skipped rows ruled out by predicates");
+    return counter;
+}
+
+ParallelScan::ParallelScan(std::vector<ScanUnit> units, ScanReaderFactory readerFactory,
+                           std::vector<ColumnDescriptor> schema, size_t workerCount, int64_t batchSize)
+    : units_(std::move(units)), reader_factory_(std::move(readerFactory)), schema_(BatchSchema::make(std::move(schema))) {
+    batch_rows_ = std::min(batchSize, BatchAllocator::rowsPerBuffer(schema_->getColumns()));
+
+    // Longest units first, so that no worker starts a large unit when the others are almost done
+    std::stable_sort(units_.begin(), units_.end(),
+                     [](const ScanUnit& a, const ScanUnit& b) { return a.weight > b.weight; });
+
+    workerCount = std::min(std::max<size_t>(workerCount, 1), units_.size());
+
+    Logger::debug("ParallelScan: reading {} units with {} workers", units_.size(), workerCount);
+
+    queue_capacity_ = workerCount * QUEUED_BATCHES_PER_WORKER;
+    active_workers_ = workerCount;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back([this] { runWorker(); });
+    }
+}
+
+ParallelScan::~ParallelScan() {
+    {
+        std::lock_guard lock(mutex_);
+        stopped_ = true;
+    }
+    space_available_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ParallelScan::runWorker() {
+    try {
+        bool stopped = false;
+        for (size_t unit = next_unit_++; unit < units_.size() && !stopped; unit = next_unit_++) {
+            std::unique_ptr<DataFileReader> reader = reader_factory_(units_[unit]);
+            if (!reader) {
+                continue;
+            }
+
+            while (reader->hasMore()) {
+                auto batch = std::make_unique<Batch>(BatchAllocator(&buffer_manager_), RowVector());
+                batch->allocator.allocateBatch(schema_, batch->rows);
+                int64_t rows = reader->readBatch(batch->rows, batch_rows_);
+                if (rows == 0) {
+                    break;
+                }
+                rowsScanned().increment(static_cast<uint64_t>(rows));
+                if (!push(std::move(batch))) {
+                    stopped = true;
+                    break;
+                }
+            }
+        }
+    } catch (...) {
+        std::lock_guard lock(mutex_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        --active_workers_;
+    }
+    batch_ready_.notify_all();
+}
+
+// Returns false if the scan was stopped
+bool ParallelScan::push(std::unique_ptr<Batch> batch) {
+    {
+        std::unique_lock lock(mutex_);
+        space_available_.wait(lock, [this] { return stopped_ || queue_.size() < queue_capacity_; });
+        if (stopped_) {
+            return false;
+        }
+        queue_.push_back(std::move(batch));
+    }
+    batch_ready_.notify_one();
+    return true;
+}
+
+// Waits for the next batch, returns nullptr once all units are exhausted
+std::unique_ptr<ParallelScan::Batch> ParallelScan::pop() {
+    std::unique_ptr<Batch> batch;
+    {
+        std::unique_lock lock(mutex_);
+        batch_ready_.wait(lock, [this] { return !queue_.empty() || active_workers_ == 0 || error_; });
+
+        if (error_) {
+            stopped_ = true;
+            space_available_.notify_all();
+            std::rethrow_exception(error_);
+        }
+        if (queue_.empty()) {
+            return nullptr;
+        }
+
+        batch = std::move(queue_.front());
+        queue_.pop_front();
+    }
+    space_available_.notify_one();
+    return batch;
+}
+
+int64_t ParallelScan::next(RowVector& out) {
+    // Return the buffers of the previous batch
+    current_.reset();
+    out.clear();
+
+    current_ = pop();
+    if (!current_) {
+        return 0;
+    }
+
+    out.assignView(current_->rows);
+    return out.getRowCount();
+}
+
+std::shared_ptr<const RowVector> ParallelScan::nextBatch() {
+    std::shared_ptr<Batch> batch = pop();
+    if (!batch) {
+        return nullptr;
+    }
+    return std::shared_ptr<const RowVector>(batch, &batch->rows);
+}
+
+bool ParallelScan::hasMore() const noexcept {
+    std::lock_guard lock(mutex_);
+    return !queue_.empty() || active_workers_ > 0;
+}
+
+}  // namespace toydb
@@ -0,0 +1,372 @@
+#include "storage/parquet_data_file_reader.hpp"
+#include <algorithm>
+#include <arrow/api.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
+#include "common/assert.hpp"
+#include "common/logging.hpp"
+
+namespace toydb {
+
+static bool isCompatibleType(DataType type, const arrow::DataType& arrowType) {
+    switch (type.getType()) {
+        case DataType::Type::INT32:
+            return arrowType.id() == arrow::Type::INT32;
+        case DataType::Type::INT64:
+            return arrowType.id() == arrow::Type::INT64;
+        case DataType::Type::DOUBLE:
+            return arrowType.id() == arrow::Type::DOUBLE;
+        case DataType::Type::BOOL:
+            return arrowType.id() == arrow::Type::BOOL;
+        case DataType::Type::STRING:
+            return arrowType.id() == arrow::Type::STRING || arrowType.id() == arrow::Type::LARGE_STRING;
+        default:
+            return false;
+    }
+}
+
+template<typename ArrayType, is_db_type T>
+static void copyValues(const arrow::Array& array, int64_t offset, int64_t count, ColumnBuffer& colBuf, int64_t outOffset) {
+    const auto& typed = static_cast<const ArrayType&>(array);
+    for (int64_t i = 0; i < count; ++i) {
+        if (typed.IsNull(offset + i)) {
+            colBuf.setNull(outOffset + i);
+        } else {
+            colBuf.clearNull(outOffset + i);
+            colBuf.writeEntry(outOffset + i, static_cast<T>(typed.Value(offset + i)));
+        }
+    }
+}
+
+template<typename ArrayType>
+static void copyStrings(const arrow::Array& array, int64_t offset, int64_t count, ColumnBuffer& colBuf,
+                        int64_t outOffset, StringHeap& stringHeap) {
+    const auto& typed = static_cast<const ArrayType&>(array);
+    // Prefer the column's own heap, so the strings live as long as the batch
+    StringHeap* heap = colBuf.getStringHeap() ? colBuf.getStringHeap() : &stringHeap;
+    for (int64_t i = 0; i < count; ++i) {
+        if (typed.IsNull(offset + i)) {
+            colBuf.setNull(outOffset + i);
+        } else {
+            colBuf.clearNull(outOffset + i);
+            colBuf.writeString(outOffset + i, typed.GetView(offset + i), heap);
+        }
+    }
+}
+
+static void copyColumn(const arrow::Array& array, int64_t offset, int64_t count, ColumnBuffer& colBuf,
+                       int64_t outOffset, StringHeap& stringHeap) {
+    switch (array.type_id()) {
+        case arrow::Type::INT32:
+            copyValues<arrow::Int32Array, db_int32>(array, offset, count, colBuf, outOffset);
+            break;
+        case arrow::Type::INT64:
+            copyValues<arrow::Int64Array, db_int64>(array, offset, count, colBuf, outOffset);
+            break;
+        case arrow::Type::DOUBLE:
+            copyValues<arrow::DoubleArray, db_double>(array, offset, count, colBuf, outOffset);
+            break;
+        case arrow::Type::BOOL:
+            copyValues<arrow::BooleanArray, db_bool>(array, offset, count, colBuf, outOffset);
+            break;
+        case arrow::Type::STRING:
+            copyStrings<arrow::StringArray>(array, offset, count, colBuf, outOffset, stringHeap);
+            break;
+        case arrow::Type::LARGE_STRING:
+            copyStrings<arrow::LargeStringArray>(array, offset, count, colBuf, outOffset, stringHeap);
+            break;
+        default:
+            tdb_unreachable("Unsupported Arrow type");
+    }
+}
+
+ParquetDataFileReader::ParquetDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId)
+    : file_path_(filePath), schema_(schema), table_id_(tableId), projection_(schema.getColumnIds()) {
+    if (!open()) {
+        reader_.reset();
+        eof_ = true;
+    }
+}
+
+ParquetDataFileReader::~ParquetDataFileReader() = default;
+
+bool ParquetDataFileReader::open() {
+    parquet::arrow::FileReaderBuilder builder;
+    arrow::Status status = builder.OpenFile(file_path_.string());
+    if (!status.ok()) {
+        Logger::error("Failed to open Parquet file {}: {}", file_path_.string(), status.ToString());
+        return false;
+    }
+
+    status = builder.memory_pool(arrow::default_memory_pool())->Build(&reader_);
+    if (!status.ok()) {
+        Logger::error("Failed to create Parquet reader for {}: {}", file_path_.string(), status.ToString());
+        return false;
+    }
+
+    std::shared_ptr<arrow::Schema> fileSchema;
+    status = reader_->GetSchema(&fileSchema);
+    if (!status.ok()) {
+        Logger::error("Failed to read schema of Parquet file {}: {}", file_path_.string(), status.ToString());
+        return false;
+    }
+
+    const parquet::SchemaDescriptor* fileColumns = reader_->parquet_reader()->metadata()->schema();
+    for (const auto& colId : schema_.getColumnIds()) {
+        const auto& colMeta = schema_.getColumn(colId);
+        tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
+
+        auto field = fileSchema->GetFieldByName(colMeta->name);
+        if (!field) {
+            file_columns_.push_back(-1);
+            continue;
+        }
+        if (!isCompatibleType(colMeta->type, *field->type())) {
+            Logger::error("Parquet column {} in {} has type {}, expected {}", colMeta->name, file_path_.string(),
+                          field->type()->ToString(), colMeta->type.toString());
+            return false;
+        }
+        file_columns_.push_back(fileColumns->ColumnIndex(colMeta->name));
+    }
+
+    return true;
+}
+
+void ParquetDataFileReader::setProjection(const std::vector<ColumnId>& columns) {
+    tdb_assert(!started_, "Projection must be set before reading");
+    projection_ = columns;
+}
+
+void ParquetDataFileReader::setPredicate(const PredicateExpr* predicate) {
+    tdb_assert(!started_, "Predicate must be set before reading");
+    predicate_ = predicate;
+}
+
+int ParquetDataFileReader::getRowGroupCount() const noexcept {
+    return reader_ ? reader_->num_row_groups() : 0;
+}
+
+int ParquetDataFileReader::getFileColumn(const ColumnId& columnId) const {
+    const auto& columnIds = schema_.getColumnIds();
+    auto it = std::find(columnIds.begin(), columnIds.end(), columnId);
+    if (it == columnIds.end()) {
+        return -1;
+    }
+    return file_columns_[static_cast<size_t>(it - columnIds.begin())];
+}
+
+std::vector<ColumnStatistics> ParquetDataFileReader::getRowGroupStatistics(int rowGroup) const {
+    auto rowGroupMeta = reader_->parquet_reader()->metadata()->RowGroup(rowGroup);
+    const auto& columnIds = schema_.getColumnIds();
+    std::vector<ColumnStatistics> result(columnIds.size());
+
+    for (size_t i = 0; i < columnIds.size(); ++i) {
+        ColumnStatistics& stats = result[i];
+        stats.type = schema_.getColumn(columnIds[i])->type;
+
+        if (file_columns_[i] < 0) {
+            continue;
+        }
+
+        auto chunk = rowGroupMeta->ColumnChunk(file_columns_[i]);
+        std::shared_ptr<parquet::Statistics> fileStats = chunk->is_stats_set() ? chunk->statistics() : nullptr;
+        if (!fileStats) {
+            continue;
+        }
+
+        stats.rowCount = rowGroupMeta->num_rows();
+        stats.nullCount = fileStats->HasNullCount() ? fileStats->null_count() : 0;
+        if (!fileStats->HasMinMax()) {
+            continue;
+        }
+
+        switch (fileStats->physical_type()) {
+            case parquet::Type::BOOLEAN: {
+                const auto& typed = static_cast<const parquet::BoolStatistics&>(*fileStats);
+                stats.intMin = typed.min();
+                stats.intMax = typed.max();
+                stats.hasMinMax = stats.type == DataType::getBool();
+                break;
+            }
+            case parquet::Type::INT32: {
+                const auto& typed = static_cast<const parquet::Int32Statistics&>(*fileStats);
+                stats.intMin = typed.min();
+                stats.intMax = typed.max();
+                stats.hasMinMax = stats.type == DataType::getInt32();
+                break;
+            }
+            case parquet::Type::INT64: {
+                const auto& typed = static_cast<const parquet::Int64Statistics&>(*fileStats);
+                stats.intMin = typed.min();
+                stats.intMax = typed.max();
+                stats.hasMinMax = stats.type == DataType::getInt64();
+                break;
+            }
+            case parquet::Type::DOUBLE: {
+                const auto& typed = static_cast<const parquet::DoubleStatistics&>(*fileStats);
+                stats.doubleMin = typed.min();
+                stats.doubleMax = typed.max();
+                stats.hasMinMax = stats.type == DataType::getDouble();
+                break;
+            }
+            case parquet::Type::BYTE_ARRAY: {
+                const auto& typed = static_cast<const parquet::ByteArrayStatistics&>(*fileStats);
+                stats.stringMin.assign(reinterpret_cast<const char*>(typed.min().ptr), typed.min().len);
+                stats.stringMax.assign(reinterpret_cast<const char*>(typed.max().ptr), typed.max().len);
+                stats.hasMinMax = stats.type == DataType::getString();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return result;
+}
+
+void ParquetDataFileReader::selectRowGroups() {
+    row_groups_.clear();
+    const auto& columnIds = schema_.getColumnIds();
+
+    for (int rowGroup = 0; rowGroup < getRowGroupCount(); ++rowGroup) {
+        if (predicate_) {
+            std::vector<ColumnStatistics> stats = getRowGroupStatistics(rowGroup);
+            auto lookup = [&](const ColumnId& colId) -> const ColumnStatistics* {
+                auto it = std::find(columnIds.begin(), columnIds.end(), colId);
+                return it == columnIds.end() ? nullptr : &stats[static_cast<size_t>(it - columnIds.begin())];
+            };
+
+            if (!mayMatch(*predicate_, lookup)) {
+                Logger::debug("Skipping row group {} of {}", rowGroup, file_path_.string());
+                continue;
+            }
+        }
+        row_groups_.push_back(rowGroup);
+    }
+}
+
+bool ParquetDataFileReader::startReading() {
+    if (!reader_) {
+        return false;
+    }
+
+    std::vector<int> columns;
+    projected_names_.clear();
+    for (const auto& colId : projection_) {
+        const auto& colMeta = schema_.getColumn(colId);
+        tdb_assert(colMeta, "Projected column {} not found in schema", colId.getId());
+
+        int fileColumn = getFileColumn(colId);
+        if (fileColumn < 0) {
+            Logger::error("Column {} not found in Parquet file {}", colMeta->name, file_path_.string());
+            return false;
+        }
+        columns.push_back(fileColumn);
+        projected_names_.push_back(colMeta->name);
+    }
+
+    selectRowGroups();
+    if (row_groups_.empty() || columns.empty()) {
+        return false;
+    }
+
+    auto batchReader = reader_->GetRecordBatchReader(row_groups_, columns);
+    if (!batchReader.ok()) {
+        Logger::error("Failed to read Parquet file {}: {}", file_path_.string(), batchReader.status().ToString());
+        return false;
+    }
+    batch_reader_ = std::move(batchReader).ValueOrDie();
+
+    return fetchBatch();
+}
+
+bool ParquetDataFileReader::fetchBatch() {
+    batch_.reset();
+    batch_offset_ = 0;
+
+    // Skip empty batches
+    while (!batch_ || batch_->num_rows() == 0) {
+        arrow::Status status = batch_reader_->ReadNext(&batch_);
+        if (!status.ok()) {
+            Logger::error("Failed to read record batch from {}: {}", file_path_.string(), status.ToString());
+            batch_.reset();
+            return false;
+        }
+        if (!batch_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t ParquetDataFileReader::readBatch(RowVector& out, int64_t requestedRows) {
+    if (eof_) {
+        return 0;
+    }
+
+    if (!started_) {
+        started_ = true;
+        if (!startReading()) {
+            eof_ = true;
+            return 0;
+        }
+    }
+
+    // Verify ColumnBuffers exist and have sufficient capacity
+    tdb_assert(out.getColumnCount() == static_cast<int64_t>(projection_.size()),
+        "RowVector column count ({}) does not match projected column count ({})",
+        out.getColumnCount(), projection_.size());
+    for (size_t colIdx = 0; colIdx < projection_.size(); ++colIdx) {
+        [[maybe_unused]] const ColumnBuffer& colBuf = out.getColumn(static_cast<int64_t>(colIdx));
+        tdb_assert(colBuf.columnId == projection_[colIdx],
+            "Column {} mismatch: expected {}, got {}",
+            colIdx, projection_[colIdx].getId(), colBuf.columnId.getId());
+        tdb_assert(colBuf.getCapacity() >= requestedRows,
+            "Column {} capacity ({}) insufficient for requested rows ({})",
+            colIdx, colBuf.getCapacity(), requestedRows);
+    }
+
+    // Strings of the previous batch are no longer referenced
+    string_heap_.reset();
+
+    int64_t rowsRead = 0;
+    while (rowsRead < requestedRows && !eof_) {
+        int64_t count = std::min(requestedRows - rowsRead, batch_->num_rows() - batch_offset_);
+
+        for (size_t colIdx = 0; colIdx < projection_.size(); ++colIdx) {
+            std::shared_ptr<arrow::Array> array = batch_->GetColumnByName(projected_names_[colIdx]);
+            tdb_assert(array, "Column {} missing from record batch", projected_names_[colIdx]);
+            copyColumn(*array, batch_offset_, count, out.getColumn(static_cast<int64_t>(colIdx)), rowsRead,
+                       string_heap_);
+        }
+
+        rowsRead += count;
+        batch_offset_ += count;
+        if (batch_offset_ >= batch_->num_rows() && !fetchBatch()) {
+            eof_ = true;
+        }
+    }
+
+    for (int64_t colIdx = 0; colIdx < out.getColumnCount(); ++colIdx) {
+        out.getColumn(colIdx).count = rowsRead;
+    }
+    out.setRowCount(rowsRead);
+
+    return rowsRead;
+}
+
+bool ParquetDataFileReader::hasMore() const noexcept {
+    return !eof_;
+}
+
+void ParquetDataFileReader::reset() {
+    batch_reader_.reset();
+    batch_.reset();
+    batch_offset_ = 0;
+    started_ = false;
+    eof_ = reader_ == nullptr;
+}
+
+}  // namespace toydb
@@ -0,0 +1,378 @@
+#include "storage/secondary_index.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+#include "common/logging.hpp"
+#include "engine/compare_kernels.hpp"
+#include "storage/parallel_scan.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+namespace fs = std::filesystem;
+
+static constexpr size_t ENTRY_SIZE = sizeof(int64_t) + 2 * sizeof(uint32_t);
+static constexpr size_t TRAILER_SIZE = 2 * sizeof(uint64_t) + sizeof(SecondaryIndex::MAGIC);
+
+/**
+ * @brief Narrow the range to the keys for which `key op value` is TRUE
+ */
+static void restrictRange(IndexRange& range, CompareOp op, int64_t value) {
+    constexpr int64_t MIN = std::numeric_limits<int64_t>::min();
+    constexpr int64_t MAX = std::numeric_limits<int64_t>::max();
+    switch (op) {
+        case CompareOp::EQUAL:
+            range.low = std::max(range.low, value);
+            range.high = std::min(range.high, value);
+            break;
+        case CompareOp::LESS:
+            if (value == MIN) {
+                range = {MAX, MIN};
+            } else {
+                range.high = std::min(range.high, value - 1);
+            }
+            break;
+        case CompareOp::LESS_EQUAL:
+            range.high = std::min(range.high, value);
+            break;
+        case CompareOp::GREATER:
+            if (value == MAX) {
+                range = {MAX, MIN};
+            } else {
+                range.low = std::max(range.low, value + 1);
+            }
+            break;
+        case CompareOp::GREATER_EQUAL:
+            range.low = std::max(range.low, value);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool collectRange(const PredicateExpr& predicate, const ColumnId& column, IndexRange& range) {
+    if (const auto* logical = dynamic_cast<const LogicalExpr*>(&predicate)) {
+        if (logical->getOp() != CompareOp::AND) {
+            return false;
+        }
+        bool left = collectRange(*logical->getLeft(), column, range);
+        bool right = collectRange(*logical->getRight(), column, range);
+        return left || right;
+    }
+
+    const auto* compare = dynamic_cast<const CompareExpr*>(&predicate);
+    if (!compare || kernels::getCompareDomain(compare->getType()) != kernels::CompareDomain::INTEGRAL) {
+        return false;
+    }
+    CompareOp op = compare->getOp();
+    const auto* ref = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+    const auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getRight()));
+    if (!ref) {
+        ref = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+        constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getLeft()));
+        op = kernels::mirrorCompareOp(op);
+    }
+    if (!ref || !constant || constant->isNull() || ref->getColumnId() != column ||
+        !kernels::isIntegralType(constant->getType()) || op == CompareOp::NOT_EQUAL) {
+        return false;
+    }
+    restrictRange(range, op, constant->getIntValue());
+    return true;
+}
+
+std::optional<IndexRange> getIndexRange(const PredicateExpr& predicate, const ColumnId& column) {
+    IndexRange range;
+    if (!collectRange(predicate, column, range)) {
+        return std::nullopt;
+    }
+    return range;
+}
+
+static const BloomFilterExpr* findKeyFilter(const PredicateExpr& predicate, const ColumnId& column) {
+    if (const auto* logical = dynamic_cast<const LogicalExpr*>(&predicate)) {
+        if (logical->getOp() != CompareOp::AND) {
+            return nullptr;
+        }
+        const BloomFilterExpr* left = findKeyFilter(*logical->getLeft(), column);
+        return left ? left : findKeyFilter(*logical->getRight(), column);
+    }
+    const auto* bloom = dynamic_cast<const BloomFilterExpr*>(&predicate);
+    if (!bloom || !bloom->getKeys() || bloom->getKey()->getColumnId() != column) {
+        return nullptr;
+    }
+    return bloom;
+}
+
+std::optional<std::vector<int64_t>> getIndexKeys(const PredicateExpr& predicate, const ColumnId& column) {
+    const BloomFilterExpr* bloom = findKeyFilter(predicate, column);
+    if (!bloom) {
+        return std::nullopt;
+    }
+    IndexRange range = getIndexRange(predicate, column).value_or(IndexRange {});
+    const std::vector<int64_t>& keys = *bloom->getKeys();
+    auto first = std::lower_bound(keys.begin(), keys.end(), range.low);
+    auto last = range.isEmpty() ? first : std::upper_bound(first, keys.end(), range.high);
+    return std::vector<int64_t>(first, last);
+}
+
+static memory::PageCache& pageCache() {
+    static memory::PageCache cache(SecondaryIndex::CACHE_FRAMES);
+    return cache;
+}
+
+const memory::PageCache& SecondaryIndex::getPageCache() {
+    return pageCache();
+}
+
+/**
+ * @brief Id of the pages of a version of an index file in the page cache. Indexes are rebuilt
+ *        into a new file that replaces the old one, whose pages are never read again.
+ */
+static uint32_t getFileId(const struct stat& fileStat) {
+    static std::mutex mutex;
+    static std::map<std::tuple<dev_t, ino_t, off_t, int64_t>, uint32_t> ids;
+    int64_t modified = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1'000'000'000 + fileStat.st_mtim.tv_nsec;
+    std::lock_guard lock(mutex);
+    auto key = std::make_tuple(fileStat.st_dev, fileStat.st_ino, fileStat.st_size, modified);
+    return ids.try_emplace(key, static_cast<uint32_t>(ids.size())).first->second;
+}
+
+SecondaryIndex::~SecondaryIndex() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+bool SecondaryIndex::build(const TableHandle& table, const ColumnId& column, const fs::path& path) {
+    std::vector<ColumnDescriptor> descriptors = table.getColumnDescriptors({column});
+    DataType type = descriptors[0].type;
+    if (type != DataType::getInt32() && type != DataType::getInt64()) {
+        Logger::error("Cannot index column {} of type {}", column.getName(), type.toString());
+        return false;
+    }
+
+    std::vector<Entry> entries;
+    const std::vector<FileEntry>& files = table.getFiles();
+    for (size_t file = 0; file < files.size(); ++file) {
+        auto readerFactory = [&table, &column](const ScanUnit& unit) {
+            auto reader = table.createFileReader(unit.path, unit.range);
+            if (reader) {
+                reader->setProjection({column});
+            }
+            return reader;
+        };
+        // A single unit read by a single worker, batches arrive in the order of the rows
+        ParallelScan scan({{table.resolvePath(files[file].path), std::nullopt, 1, std::nullopt}}, std::move(readerFactory),
+                          descriptors, 1);
+
+        uint32_t row = 0;
+        RowVector batch;
+        while (scan.next(batch) > 0) {
+            const ColumnBuffer& keys = batch.getColumn(0);
+            for (int64_t i = 0; i < batch.getRowCount(); ++i, ++row) {
+                if (keys.isNull(i)) {
+                    continue;
+                }
+                int64_t key = type == DataType::getInt32() ? keys.getDataAs<db_int32>()[static_cast<size_t>(i)]
+                                                           : keys.getDataAs<db_int64>()[static_cast<size_t>(i)];
+                entries.push_back({key, static_cast<uint32_t>(file), row});
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return std::tie(a.key, a.file, a.row) < std::tie(b.key, b.file, b.row);
+    });
+
+    // Written next to the index and renamed over it, so that scans never open a partial index
+    fs::path tmpPath = path.string() + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(MAGIC, sizeof(MAGIC));
+    for (const Entry& entry : entries) {
+        out.write(reinterpret_cast<const char*>(&entry.key), sizeof(entry.key));
+        out.write(reinterpret_cast<const char*>(&entry.file), sizeof(entry.file));
+        out.write(reinterpret_cast<const char*>(&entry.row), sizeof(entry.row));
+    }
+    for (size_t i = 0; i < entries.size(); i += BLOCK_ENTRIES) {
+        out.write(reinterpret_cast<const char*>(&entries[i].key), sizeof(entries[i].key));
+    }
+    uint64_t entryCount = entries.size();
+    uint64_t fileCount = files.size();
+    out.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+    out.write(reinterpret_cast<const char*>(&fileCount), sizeof(fileCount));
+    out.write(MAGIC, sizeof(MAGIC));
+    out.close();
+    if (!out) {
+        Logger::error("Failed to write index {}", tmpPath.string());
+        return false;
+    }
+    std::error_code error;
+    fs::rename(tmpPath, path, error);
+    if (error) {
+        Logger::error("Failed to replace index {}: {}", path.string(), error.message());
+        return false;
+    }
+    Logger::debug("Indexed {} keys of {} in {}", entryCount, column.getName(), path.string());
+    return true;
+}
+
+std::unique_ptr<SecondaryIndex> SecondaryIndex::open(const fs::path& path) {
+    std::unique_ptr<SecondaryIndex> index(new SecondaryIndex(path));
+    index->fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (index->fd_ == -1) {
+        Logger::error("Failed to open index {}: {}", path.string(), std::strerror(errno));
+        return nullptr;
+    }
+
+    struct stat fileStat {};
+    bool statted = fstat(index->fd_, &fileStat) == 0;
+    auto size = static_cast<size_t>(fileStat.st_size);
+    char header[sizeof(MAGIC)];
+    char trailer[TRAILER_SIZE];
+    if (!statted || size < sizeof(MAGIC) + TRAILER_SIZE ||
+        pread(index->fd_, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        pread(index->fd_, trailer, sizeof(trailer), static_cast<off_t>(size - TRAILER_SIZE)) !=
+            static_cast<ssize_t>(sizeof(trailer)) ||
+        std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+        std::memcmp(trailer + 2 * sizeof(uint64_t), MAGIC, sizeof(MAGIC)) != 0) {
+        Logger::error("{} is not an index file", path.string());
+        return nullptr;
+    }
+
+    uint64_t entryCount = 0;
+    uint64_t fileCount = 0;
+    std::memcpy(&entryCount, trailer, sizeof(entryCount));
+    std::memcpy(&fileCount, trailer + sizeof(entryCount), sizeof(fileCount));
+    size_t fenceCount = (entryCount + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES;
+    if (sizeof(MAGIC) + entryCount * ENTRY_SIZE + fenceCount * sizeof(int64_t) + TRAILER_SIZE != size) {
+        Logger::error("Index {} is truncated", path.string());
+        return nullptr;
+    }
+
+    index->memory_.init();
+    index->pages_ =
+        std::make_unique<memory::PageDirectory>(pageCache(), index->memory_, index->fd_, getFileId(fileStat));
+    for (size_t page = 0; page * memory::PageCache::PAGE_SIZE < size; ++page) {
+        index->pages_->addPage(static_cast<memory::Page::ID>(page), page * memory::PageCache::PAGE_SIZE);
+    }
+
+    index->entry_count_ = static_cast<int64_t>(entryCount);
+    index->file_count_ = fileCount;
+    index->fences_.resize(fenceCount);
+    std::span<char> fenceBytes(reinterpret_cast<char*>(index->fences_.data()), fenceCount * sizeof(int64_t));
+    if (!index->read(sizeof(MAGIC) + entryCount * ENTRY_SIZE, fenceBytes)) {
+        Logger::error("Failed to read index {}", path.string());
+        return nullptr;
+    }
+    return index;
+}
+
+std::pair<size_t, size_t> SecondaryIndex::getBlocks(const IndexRange& range) const {
+    if (range.isEmpty() || fences_.empty()) {
+        return {0, 0};
+    }
+    // Keys equal to the first key of a block may end the block before it
+    auto first = std::lower_bound(fences_.begin(), fences_.end(), range.low);
+    size_t firstBlock = first == fences_.begin() ? 0 : static_cast<size_t>(first - fences_.begin()) - 1;
+    auto last = std::upper_bound(fences_.begin(), fences_.end(), range.high);
+    size_t endBlock = static_cast<size_t>(last - fences_.begin());
+    return firstBlock < endBlock ? std::make_pair(firstBlock, endBlock) : std::make_pair(size_t {0}, size_t {0});
+}
+
+std::vector<SecondaryIndex::Entry> SecondaryIndex::readBlocks(size_t first, size_t end) const {
+    size_t begin = first * BLOCK_ENTRIES;
+    size_t stop = std::min(end * BLOCK_ENTRIES, static_cast<size_t>(entry_count_));
+    std::vector<char> bytes((stop - begin) * ENTRY_SIZE);
+    if (!read(sizeof(MAGIC) + begin * ENTRY_SIZE, bytes)) {
+        Logger::error("Failed to read index {}", path_.string());
+        throw std::runtime_error("Failed to read index " + path_.string());
+    }
+
+    std::vector<Entry> entries(stop - begin);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const char* data = bytes.data() + i * ENTRY_SIZE;
+        std::memcpy(&entries[i].key, data, sizeof(entries[i].key));
+        std::memcpy(&entries[i].file, data + sizeof(entries[i].key), sizeof(entries[i].file));
+        std::memcpy(&entries[i].row, data + sizeof(entries[i].key) + sizeof(entries[i].file), sizeof(entries[i].row));
+    }
+    return entries;
+}
+
+std::vector<std::vector<int64_t>> SecondaryIndex::lookup(const IndexRange& range) const {
+    std::vector<std::vector<int64_t>> positions(file_count_);
+    auto [first, end] = getBlocks(range);
+    if (first == end) {
+        return positions;
+    }
+
+    for (const Entry& entry : readBlocks(first, end)) {
+        if (entry.key < range.low) {
+            continue;
+        }
+        if (entry.key > range.high) {
+            break;
+        }
+        if (entry.file < file_count_) {
+            positions[entry.file].push_back(entry.row);
+        }
+    }
+    for (auto& rows : positions) {
+        std::sort(rows.begin(), rows.end());
+    }
+    return positions;
+}
+
+std::vector<std::vector<int64_t>> SecondaryIndex::lookupKeys(std::span<const int64_t> keys) const {
+    std::vector<std::vector<int64_t>> positions(file_count_);
+    for (size_t i = 0; i < keys.size();) {
+        // The keys whose blocks overlap or are adjacent are looked up with a single read
+        auto [first, end] = getBlocks({keys[i], keys[i]});
+        size_t j = i + 1;
+        for (; j < keys.size(); ++j) {
+            auto [keyFirst, keyEnd] = getBlocks({keys[j], keys[j]});
+            if (keyFirst > end) {
+                break;
+            }
+            end = std::max(end, keyEnd);
+        }
+        if (first < end) {
+            for (const Entry& entry : readBlocks(first, end)) {
+                if (entry.file < file_count_ && std::binary_search(keys.begin() + i, keys.begin() + j, entry.key)) {
+                    positions[entry.file].push_back(entry.row);
+                }
+            }
+        }
+        i = j;
+    }
+    for (auto& rows : positions) {
+        std::sort(rows.begin(), rows.end());
+    }
+    return positions;
+}
+
+bool SecondaryIndex::read(size_t offset, std::span<char> out) const {
+    constexpr size_t PAGE_SIZE = memory::PageCache::PAGE_SIZE;
+    size_t done = 0;
+    while (done < out.size()) {
+        size_t position = offset + done;
+        auto page = pages_->getPage(static_cast<memory::Page::ID>(position / PAGE_SIZE));
+        if (!page) {
+            return false;
+        }
+        size_t pageOffset = position % PAGE_SIZE;
+        size_t count = std::min(out.size() - done, PAGE_SIZE - pageOffset);
+        std::memcpy(out.data() + done, static_cast<const char*>(page->data()) + pageOffset, count);
+        done += count;
+    }
+    return true;
+}
+
+}  // namespace toydb
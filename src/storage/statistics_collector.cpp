@@ -0,0 +1,254 @@
+#include "storage/statistics_collector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include "common/assert.hpp"
+#include "common/hash.hpp"
+
+namespace toydb {
+
+StatisticsCollector::StatisticsCollector(std::vector<ColumnDescriptor> columns)
+    : columns_(std::move(columns)), states_(columns_.size()) {
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        states_[i].stats.type = columns_[i].type;
+        states_[i].stats.distinctSketch.emplace();
+    }
+}
+
+/**
+ * @brief Call fn with every selected non-null value of a column, counting the nulls
+ */
+template<is_db_type T, typename Fn>
+static void forEachValue(const RowVector& batch, const ColumnBuffer& col, int64_t& nullCount, Fn&& fn) {
+    std::span<T> values = col.getDataAs<T>();
+    for (int64_t row = batch.nextSelectedRow(0); row < batch.getRowCount(); row = batch.nextSelectedRow(row + 1)) {
+        if (col.isNull(row)) {
+            ++nullCount;
+            continue;
+        }
+        fn(values[static_cast<size_t>(row)]);
+    }
+}
+
+void StatisticsCollector::addSample(ColumnState& state, double value) {
+    ++state.sampled;
+    if (state.sample.size() < SAMPLE_SIZE) {
+        state.sample.push_back(value);
+        return;
+    }
+    // Reservoir sampling: every value ends up in the sample with the same probability
+    std::uniform_int_distribution<int64_t> position(0, state.sampled - 1);
+    int64_t index = position(random_);
+    if (index < static_cast<int64_t>(SAMPLE_SIZE)) {
+        state.sample[static_cast<size_t>(index)] = value;
+    }
+}
+
+void StatisticsCollector::add(const RowVector& batch) {
+    tdb_assert(batch.getColumnCount() == static_cast<int64_t>(columns_.size()),
+               "Batch has {} columns, the statistics collector {}", batch.getColumnCount(), columns_.size());
+    int64_t selected = batch.getSelectedRowCount();
+    rowCount_ += selected;
+
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        const ColumnBuffer& col = batch.getColumn(static_cast<int64_t>(i));
+        ColumnState& state = states_[i];
+        ColumnStatistics& stats = state.stats;
+        stats.rowCount += selected;
+
+        auto addIntegral = [&](int64_t value, bool sample) {
+            if (!stats.hasMinMax) {
+                stats.intMin = stats.intMax = value;
+                stats.hasMinMax = true;
+            }
+            stats.intMin = std::min(stats.intMin, value);
+            stats.intMax = std::max(stats.intMax, value);
+            stats.distinctSketch->addHash(hashInt64(value));
+            if (sample) {
+                addSample(state, static_cast<double>(value));
+            }
+        };
+
+        switch (col.type.getType()) {
+            case DataType::Type::INT32:
+                forEachValue<db_int32>(batch, col, stats.nullCount, [&](db_int32 value) { addIntegral(value, true); });
+                break;
+            case DataType::Type::INT64:
+                forEachValue<db_int64>(batch, col, stats.nullCount, [&](db_int64 value) { addIntegral(value, true); });
+                break;
+            case DataType::Type::BOOL:
+                forEachValue<db_bool>(batch, col, stats.nullCount, [&](db_bool value) { addIntegral(value ? 1 : 0, false); });
+                break;
+            case DataType::Type::DOUBLE:
+                forEachValue<db_double>(batch, col, stats.nullCount, [&](db_double value) {
+                    if (!stats.hasMinMax) {
+                        stats.doubleMin = stats.doubleMax = value;
+                        stats.hasMinMax = true;
+                    }
+                    stats.doubleMin = std::min(stats.doubleMin, value);
+                    stats.doubleMax = std::max(stats.doubleMax, value);
+                    stats.distinctSketch->addHash(hashDouble(value));
+                    addSample(state, value);
+                });
+                break;
+            case DataType::Type::STRING:
+                forEachValue<db_string>(batch, col, stats.nullCount, [&](const db_string& value) {
+                    std::string_view view = value.view();
+                    if (!stats.hasMinMax) {
+                        stats.stringMin = stats.stringMax = std::string(view);
+                        stats.hasMinMax = true;
+                    } else if (view < stats.stringMin) {
+                        stats.stringMin = std::string(view);
+                    } else if (view > stats.stringMax) {
+                        stats.stringMax = std::string(view);
+                    }
+                    stats.distinctSketch->addHash(hashBytes(view.data(), view.size()));
+                });
+                break;
+            default:
+                tdb_unreachable("Unsupported column type for statistics");
+        }
+    }
+}
+
+StatisticsMap StatisticsCollector::finish() const {
+    StatisticsMap result;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        const ColumnState& state = states_[i];
+        ColumnStatistics stats = state.stats;
+
+        int64_t nonNull = stats.rowCount - stats.nullCount;
+        stats.distinctCount = std::min(static_cast<int64_t>(std::llround(stats.distinctSketch->estimate())), nonNull);
+
+        if (!state.sample.empty()) {
+            std::vector<double> sorted = state.sample;
+            std::sort(sorted.begin(), sorted.end());
+            stats.histogram.resize(HISTOGRAM_BUCKETS + 1);
+            for (size_t k = 0; k <= HISTOGRAM_BUCKETS; ++k) {
+                stats.histogram[k] = sorted[k * (sorted.size() - 1) / HISTOGRAM_BUCKETS];
+            }
+            // The sample may have missed the extremes
+            bool isDouble = stats.type == DataType::getDouble();
+            stats.histogram.front() = isDouble ? stats.doubleMin : static_cast<double>(stats.intMin);
+            stats.histogram.back() = isDouble ? stats.doubleMax : static_cast<double>(stats.intMax);
+        }
+
+        result[columns_[i].columnId] = std::move(stats);
+    }
+    return result;
+}
+
+/**
+ * @brief Histogram of the union of the parts: the quantiles of the row-weighted average of their
+ *        distributions, interpolated between the bounds of all parts
+ */
+static std::vector<double> mergeHistograms(const std::vector<const ColumnStatistics*>& parts) {
+    std::vector<const ColumnStatistics*> nonEmpty;
+    std::vector<double> points;
+    double totalValues = 0.0;
+    size_t buckets = 0;
+    for (const ColumnStatistics* part : parts) {
+        if (part->rowCount == part->nullCount) {
+            continue;
+        }
+        if (part->histogram.size() < 2) {
+            return {};
+        }
+        nonEmpty.push_back(part);
+        points.insert(points.end(), part->histogram.begin(), part->histogram.end());
+        totalValues += static_cast<double>(part->rowCount - part->nullCount);
+        buckets = std::max(buckets, part->histogram.size() - 1);
+    }
+    if (nonEmpty.empty()) {
+        return {};
+    }
+    if (nonEmpty.size() == 1) {
+        return nonEmpty[0]->histogram;
+    }
+
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    auto fractionBelow = [&](double value) {
+        double fraction = 0.0;
+        for (const ColumnStatistics* part : nonEmpty) {
+            double weight = static_cast<double>(part->rowCount - part->nullCount) / totalValues;
+            fraction += weight * *part->fractionBelow(value);
+        }
+        return fraction;
+    };
+    std::vector<double> fractions;
+    for (double point : points) {
+        fractions.push_back(fractionBelow(point));
+    }
+
+    std::vector<double> histogram(buckets + 1);
+    histogram.front() = points.front();
+    histogram.back() = points.back();
+    size_t next = 1;
+    for (size_t k = 1; k < buckets; ++k) {
+        double quantile = static_cast<double>(k) / static_cast<double>(buckets);
+        while (next < points.size() - 1 && fractions[next] < quantile) {
+            ++next;
+        }
+        double span = fractions[next] - fractions[next - 1];
+        double position = span > 0.0 ? (quantile - fractions[next - 1]) / span : 0.0;
+        histogram[k] = points[next - 1] + std::clamp(position, 0.0, 1.0) * (points[next] - points[next - 1]);
+    }
+    return histogram;
+}
+
+ColumnStatistics mergeColumnStatistics(const std::vector<const ColumnStatistics*>& parts) {
+    tdb_assert(!parts.empty(), "No statistics to merge");
+    if (parts.size() == 1) {
+        return *parts[0];
+    }
+
+    ColumnStatistics merged;
+    merged.type = parts[0]->type;
+    bool allSketches = true;
+    for (const ColumnStatistics* part : parts) {
+        merged.rowCount += part->rowCount;
+        merged.nullCount += part->nullCount;
+
+        if (part->hasMinMax) {
+            if (!merged.hasMinMax) {
+                merged.intMin = part->intMin;
+                merged.intMax = part->intMax;
+                merged.doubleMin = part->doubleMin;
+                merged.doubleMax = part->doubleMax;
+                merged.stringMin = part->stringMin;
+                merged.stringMax = part->stringMax;
+                merged.hasMinMax = true;
+            } else {
+                merged.intMin = std::min(merged.intMin, part->intMin);
+                merged.intMax = std::max(merged.intMax, part->intMax);
+                merged.doubleMin = std::min(merged.doubleMin, part->doubleMin);
+                merged.doubleMax = std::max(merged.doubleMax, part->doubleMax);
+                merged.stringMin = std::min(merged.stringMin, part->stringMin);
+                merged.stringMax = std::max(merged.stringMax, part->stringMax);
+            }
+        }
+
+        if (!part->distinctSketch) {
+            allSketches = false;
+        } else if (allSketches) {
+            if (!merged.distinctSketch) {
+                merged.distinctSketch = part->distinctSketch;
+            } else {
+                merged.distinctSketch->merge(*part->distinctSketch);
+            }
+        }
+    }
+
+    if (allSketches) {
+        int64_t nonNull = merged.rowCount - merged.nullCount;
+        merged.distinctCount = std::min(static_cast<int64_t>(std::llround(merged.distinctSketch->estimate())), nonNull);
+    } else {
+        merged.distinctSketch.reset();
+    }
+    merged.histogram = mergeHistograms(parts);
+    return merged;
+}
+
+}  // namespace toydb
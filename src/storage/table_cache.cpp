@@ -0,0 +1,229 @@
+#include "storage/table_cache.hpp"
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+#include <system_error>
+#include "common/assert.hpp"
+#include "common/logging.hpp"
+#include "storage/statistics_collector.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+std::optional<FileSignature> FileSignature::of(const std::filesystem::path& path) {
+    std::error_code error;
+    FileSignature signature{path, std::filesystem::file_size(path, error), {}};
+    if (error) {
+        return std::nullopt;
+    }
+    signature.modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    return signature;
+}
+
+CachedTable::CachedTable(std::vector<ColumnDescriptor> columns, std::vector<FileSignature> files)
+    : columns_(std::move(columns)), files_(std::move(files)) {}
+
+void CachedTable::append(const RowVector& batch) {
+    tdb_assert(batch.getColumnCount() == static_cast<int64_t>(columns_.size()),
+               "Batch has {} columns, the cached table {}", batch.getColumnCount(), columns_.size());
+    rows_.append(batch);
+}
+
+void CachedTable::finish() {
+    chunk_statistics_.clear();
+    for (size_t chunk = 0; chunk < rows_.getChunkCount(); ++chunk) {
+        StatisticsCollector collector(columns_);
+        collector.add(rows_.getChunk(chunk));
+        StatisticsMap statistics = collector.finish();
+
+        std::vector<ColumnStatistics>& columns = chunk_statistics_.emplace_back();
+        for (const ColumnDescriptor& column : columns_) {
+            ColumnStatistics& stats = columns.emplace_back(std::move(statistics.at(column.columnId)));
+            // Only min/max are used for pruning, the sketch alone takes kilobytes per chunk
+            stats.distinctSketch.reset();
+            stats.histogram.clear();
+        }
+    }
+}
+
+const std::vector<ColumnStatistics>& CachedTable::getChunkStatistics(size_t chunk) const {
+    tdb_assert(chunk < chunk_statistics_.size(), "Chunk index out of range");
+    return chunk_statistics_[chunk];
+}
+
+int64_t CachedTable::getColumnIndex(const ColumnId& columnId) const noexcept {
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].columnId == columnId) {
+            return static_cast<int64_t>(i);
+        }
+    }
+    return -1;
+}
+
+static bool sameColumns(const std::vector<ColumnDescriptor>& a, const std::vector<ColumnDescriptor>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].columnId != b[i].columnId || a[i].type != b[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TableCache::TableCache(size_t memoryBudget) : memory_budget_(memoryBudget) {}
+
+std::optional<size_t> TableCache::getBudgetFromEnvironment() {
+    const char* value = std::getenv("TOYDB_TABLE_CACHE");
+    if (!value) {
+        return std::nullopt;
+    }
+
+    size_t budget = 0;
+    std::string_view text(value);
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), budget);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        Logger::warn("Ignoring invalid TOYDB_TABLE_CACHE '{}'", text);
+        return std::nullopt;
+    }
+    if (budget == 0) {
+        return std::nullopt;
+    }
+    return budget;
+}
+
+std::shared_ptr<const CachedTable> TableCache::getOrLoad(const TableHandle& table, size_t workerCount) {
+    std::vector<FileSignature> files;
+    for (const FileEntry& file : table.getFiles()) {
+        auto signature = FileSignature::of(table.resolvePath(file.path));
+        if (!signature) {
+            return nullptr;
+        }
+        files.push_back(std::move(*signature));
+    }
+    std::vector<ColumnDescriptor> columns = table.getColumnDescriptors();
+    TableId tableId = table.getTableId();
+
+    {
+        std::lock_guard lock(mutex_);
+        auto it = entries_.find(tableId);
+        if (it != entries_.end()) {
+            const CachedTable& cached = *it->second.table;
+            if (cached.getFiles() == files && sameColumns(cached.getColumns(), columns)) {
+                ++hits_;
+                lru_.splice(lru_.begin(), lru_, it->second.position);
+                return it->second.table;
+            }
+            Logger::debug("TableCache: files or columns of {} changed", tableId.getName());
+            erase(tableId);
+        }
+
+        auto oversized = oversized_.find(tableId);
+        if (oversized != oversized_.end() && oversized->second == files) {
+            return nullptr;
+        }
+        ++misses_;
+    }
+
+    // Loaded without holding the lock, concurrent misses of the same table both read it
+    std::shared_ptr<CachedTable> loaded;
+    try {
+        loaded = load(table, files, workerCount);
+    } catch (const std::exception& e) {
+        // Left to the scan of the files to report
+        Logger::debug("TableCache: failed to load {}: {}", tableId.getName(), e.what());
+        return nullptr;
+    }
+
+    std::lock_guard lock(mutex_);
+    if (!loaded) {
+        Logger::debug("TableCache: {} does not fit into {} bytes", tableId.getName(), memory_budget_);
+        oversized_[tableId] = std::move(files);
+        return nullptr;
+    }
+    oversized_.erase(tableId);
+    insert(tableId, loaded);
+    return loaded;
+}
+
+std::shared_ptr<CachedTable> TableCache::load(const TableHandle& table, std::vector<FileSignature> files,
+                                              size_t workerCount) const {
+    auto cached = std::make_shared<CachedTable>(table.getColumnDescriptors(), std::move(files));
+    auto scan = table.createFileScan(8192, workerCount);
+    RowVector batch;
+    while (scan->next(batch) > 0) {
+        cached->append(batch);
+        if (cached->getMemoryUsage() > memory_budget_) {
+            return nullptr;
+        }
+    }
+    cached->finish();
+
+    Logger::debug("TableCache: loaded {} rows of {} into {} bytes", cached->getRows().getRowCount(),
+                  table.getTableId().getName(), cached->getMemoryUsage());
+    return cached;
+}
+
+void TableCache::insert(const TableId& tableId, std::shared_ptr<const CachedTable> table) {
+    erase(tableId);
+    memory_usage_ += table->getMemoryUsage();
+    lru_.push_front(tableId);
+    entries_[tableId] = {std::move(table), lru_.begin()};
+
+    // The table just loaded fits into the budget by itself
+    while (memory_usage_ > memory_budget_ && lru_.size() > 1) {
+        TableId victim = lru_.back();
+        Logger::debug("TableCache: evicting {}", victim.getName());
+        erase(victim);
+    }
+}
+
+void TableCache::erase(const TableId& tableId) {
+    auto it = entries_.find(tableId);
+    if (it == entries_.end()) {
+        return;
+    }
+    memory_usage_ -= it->second.table->getMemoryUsage();
+    lru_.erase(it->second.position);
+    entries_.erase(it);
+}
+
+void TableCache::invalidate(const TableId& tableId) {
+    std::lock_guard lock(mutex_);
+    erase(tableId);
+    oversized_.erase(tableId);
+}
+
+void TableCache::clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    oversized_.clear();
+    memory_usage_ = 0;
+}
+
+size_t TableCache::getMemoryUsage() const {
+    std::lock_guard lock(mutex_);
+    return memory_usage_;
+}
+
+size_t TableCache::getTableCount() const {
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+int64_t TableCache::getHitCount() const {
+    std::lock_guard lock(mutex_);
+    return hits_;
+}
+
+int64_t TableCache::getMissCount() const {
+    std::lock_guard lock(mutex_);
+    return misses_;
+}
+
+}  // namespace toydb
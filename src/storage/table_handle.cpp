@@ -1,101 +1,381 @@
 #include "storage/table_handle.hpp"
+#include "storage/cached_table_reader.hpp"
 #include "storage/csv_data_file_reader.hpp"
+#include "storage/parquet_data_file_reader.hpp"
+#include "storage/secondary_index.hpp"
+#include "storage/statistics_collector.hpp"
+#include "storage/table_cache.hpp"
+#include "storage/tdb_data_file_reader.hpp"
+#include "common/hash.hpp"
 #include "common/logging.hpp"
+#include "common/metrics.hpp"
+#include <algorithm>
+#include <random>
+#include <system_error>
 
 namespace toydb {
 
 TableHandle::~TableHandle() = default;
 
-std::unique_ptr<DataFileReader> TableHandle::createFileReader(const std::filesystem::path& filePath) {
-    std::vector<ColumnId> columnIds;
-    std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById;
+TableHandle::TableHandle(std::shared_ptr<const TableMetadata> metadata, std::filesystem::path dataDirectory)
+    : metadata_(std::move(metadata)), data_directory_(std::move(dataDirectory)),
+      files_(metadata_, &metadata_->files) {
+    for (const auto& colId : metadata_->schema.getColumnIds()) {
+        auto colMeta = metadata_->schema.getColumn(colId);
+        tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
+        columns_.push_back(*colMeta);
+    }
+}
+
+static std::shared_ptr<const TableMetadata> makeMetadata(TableId tableId, StorageFormat format, const Schema& schema,
+                                                         const std::vector<FileEntry>& files) {
+    auto metadata = std::make_shared<TableMetadata>();
+    metadata->name = tableId.getName();
+    metadata->id = tableId;
+    metadata->format = format;
+    metadata->schema = schema;
+    metadata->files = files;
+    return metadata;
+}
+
+TableHandle::TableHandle(TableId tableId, StorageFormat format, const Schema& schema,
+                         const std::vector<FileEntry>& files)
+    : TableHandle(makeMetadata(tableId, format, schema, files), {}) {}
+
+const std::vector<IndexMetadata>& TableHandle::getIndexes() const noexcept {
+    static const std::vector<IndexMetadata> none;
+    return use_indexes_ ? metadata_->indexes : none;
+}
+
+std::vector<ColumnDescriptor> TableHandle::getColumnDescriptors(const std::vector<ColumnId>& columns) const {
+    std::vector<ColumnDescriptor> descriptors;
+    for (const auto& colId : columns.empty() ? getColumnIds() : columns) {
+        auto colMeta = metadata_->schema.getColumn(colId);
+        tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
+        descriptors.push_back({colId, colMeta->type});
+    }
+    return descriptors;
+}
+
+void TableHandle::sampleFiles(const TableSample& sample) {
+    uint64_t seed = sample.seed.value_or(std::random_device{}());
+    auto files = std::make_shared<std::vector<FileEntry>>();
+    for (const FileEntry& file : *files_) {
+        std::string path = file.path.string();
+        if (sample.keeps(hashCombine(seed, hashBytes(path.data(), path.size())))) {
+            files->push_back(file);
+        }
+    }
+    Logger::debug("TableHandle: sampled {} of {} files of {}", files->size(), files_->size(), metadata_->name);
+    files_ = std::move(files);
+    // Both cover the dropped files as well
+    use_indexes_ = false;
+    table_cache_.reset();
+}
 
-    for (const auto& colMeta : schema_) {
-        std::hash<std::string> colHasher;
-        uint64_t colIdValue = static_cast<uint64_t>(colHasher(colMeta.name));
-        ColumnId colId(colIdValue, colMeta.name, table_id_);
-        columnIds.push_back(colId);
-        columnsById[colId] = colMeta;
+void TableHandle::selectFiles(size_t begin, size_t end) {
+    tdb_assert(begin <= end && end <= files_->size(), "Files [{}, {}) out of range of {} files", begin, end,
+               files_->size());
+    auto first = files_->begin();
+    files_ = std::make_shared<const std::vector<FileEntry>>(first + static_cast<std::ptrdiff_t>(begin),
+                                                            first + static_cast<std::ptrdiff_t>(end));
+    // Both cover the dropped files as well
+    use_indexes_ = false;
+    table_cache_.reset();
+}
+
+std::vector<std::filesystem::path> TableHandle::getFilePaths() const noexcept {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& file : *files_) {
+        paths.push_back(resolvePath(file.path));
     }
+    return paths;
+}
 
-    Schema schema(std::move(columnIds), std::move(columnsById));
+/**
+ * @brief Bytes of the data files of a format handed to readers
+ */
+static metrics::Counter& bytesScanned(StorageFormat format) {
+    auto counter = [](StorageFormat format) -> metrics::Counter& {
+        return metrics::MetricsRegistry::global().counter("toydb_scan_bytes_total", "Bytes of the data files scanned",
+                                                          {{"format", storageFormatToString(format)}});
+    };
+    static metrics::Counter& csv = counter(StorageFormat::CSV);
+    static metrics::Counter& parquet = counter(StorageFormat::PARQUET);
+    static metrics::Counter& tdb = counter(StorageFormat::TDB);
+    switch (format) {
+        case StorageFormat::PARQUET: return parquet;
+        case StorageFormat::TDB: return tdb;
+        default: return csv;
+    }
+}
 
-    switch (format_) {
-        case StorageFormat::CSV:
-            return std::make_unique<CsvDataFileReader>(filePath, schema, table_id_);
+std::unique_ptr<DataFileReader> TableHandle::createFileReader(const std::filesystem::path& filePath,
+                                                              std::optional<CsvByteRange> range) const {
+    // Readers are created when a unit is claimed, so this counts what is actually scanned
+    std::error_code error;
+    size_t bytes = range ? range->end - range->begin : static_cast<size_t>(std::filesystem::file_size(filePath, error));
+    if (!error) {
+        bytesScanned(metadata_->format).increment(bytes);
+    }
+
+    switch (metadata_->format) {
+        case StorageFormat::CSV: {
+            auto reader = range ? std::make_unique<CsvDataFileReader>(filePath, metadata_->schema, metadata_->id, *range)
+                                : std::make_unique<CsvDataFileReader>(filePath, metadata_->schema, metadata_->id);
+            if (auto asyncIo = AsyncIoOptions::fromEnvironment()) {
+                reader->setAsyncIo(*asyncIo);
+            }
+            return reader;
+        }
         case StorageFormat::PARQUET:
-            Logger::error("Parquet format not yet implemented");
-            return nullptr;
+            tdb_assert(!range, "Parquet files can't be read in byte ranges");
+            return std::make_unique<ParquetDataFileReader>(filePath, metadata_->schema, metadata_->id);
+        case StorageFormat::TDB:
+            tdb_assert(!range, "TDB files can't be read in byte ranges");
+            return std::make_unique<TdbDataFileReader>(filePath, metadata_->schema, metadata_->id);
         default:
             Logger::error("Unknown storage format");
             return nullptr;
     }
 }
 
-std::unique_ptr<TableIterator> TableHandle::createIterator(int64_t requestedBatchSize) {
-    return std::make_unique<TableIteratorImpl>(this, requestedBatchSize);
-}
+std::vector<ScanUnit> TableHandle::planScanUnits(size_t workerCount, const PredicateExpr* predicate) const {
+    std::vector<const FileEntry*> files;
+    for (const auto& file : *files_) {
+        auto lookup = [&file](const ColumnId& columnId) -> const ColumnStatistics* {
+            auto it = file.statistics.find(columnId);
+            return it == file.statistics.end() ? nullptr : &it->second;
+        };
+        if (predicate && !file.statistics.empty() && !mayMatch(*predicate, lookup)) {
+            Logger::debug("Skipping {}, its statistics rule out the scan predicate", file.path.string());
+            continue;
+        }
+        files.push_back(&file);
+    }
 
-TableIteratorImpl::TableIteratorImpl(TableHandle* handle, int64_t batchSize)
-    : handle_(handle), batch_size_(batchSize), current_file_index_(0), initialized_(false) {}
+    bool allRowCounts = std::all_of(files.begin(), files.end(),
+                                    [](const FileEntry* file) { return file->row_count.has_value(); });
+    size_t targetUnits = std::max<size_t>(workerCount, 1) * UNITS_PER_WORKER;
 
-void TableIteratorImpl::initialize() {
-    if (initialized_) {
-        return;
-    }
+    std::vector<ScanUnit> units;
+    for (const FileEntry* entry : files) {
+        const FileEntry& file = *entry;
+        std::filesystem::path path = resolvePath(file.path);
+        std::error_code error;
+        size_t bytes = static_cast<size_t>(std::filesystem::file_size(path, error));
+        if (error) {
+            bytes = 0;
+        }
+        int64_t weight = allRowCounts ? *file.row_count : static_cast<int64_t>(bytes);
 
-    for (const auto& filePath : handle_->getFilePaths()) {
-        auto reader = handle_->createFileReader(filePath);
-        if (reader) {
-            readers_.push_back(std::move(reader));
+        size_t rangeCount = 1;
+        if (metadata_->format == StorageFormat::CSV && files.size() < targetUnits) {
+            rangeCount = std::min((targetUnits + files.size() - 1) / files.size(),
+                                  std::max<size_t>(bytes / MIN_RANGE_BYTES, 1));
+        }
+
+        if (rangeCount <= 1) {
+            units.push_back({path, std::nullopt, weight, std::nullopt});
+            continue;
+        }
+
+        CsvDataFileReader reader(path, metadata_->schema, metadata_->id);
+        for (const auto& range : reader.splitRanges(rangeCount)) {
+            double share = static_cast<double>(range.end - range.begin) / static_cast<double>(bytes);
+            units.push_back({path, range, static_cast<int64_t>(static_cast<double>(weight) * share), std::nullopt});
         }
     }
 
-    initialized_ = true;
+    return units;
 }
 
-int64_t TableIteratorImpl::next(RowVector& out) {
-    initialize();
-
-    while (current_file_index_ < readers_.size()) {
-        auto& reader = readers_[current_file_index_];
-        if (!reader->hasMore()) {
-            ++current_file_index_;
+std::optional<std::vector<ScanUnit>> TableHandle::planIndexScanUnits(const PredicateExpr& predicate) const {
+    // Positions of the most selective index
+    std::vector<std::vector<int64_t>> best;
+    int64_t bestHits = 0;
+    const IndexMetadata* bestIndex = nullptr;
+    for (const IndexMetadata& metadata : getIndexes()) {
+        // The keys of a join's runtime filter are looked up one by one instead of their whole range
+        auto keys = getIndexKeys(predicate, metadata.column);
+        auto range = getIndexRange(predicate, metadata.column);
+        if ((!keys && !range) || metadata.fileCount > files_->size()) {
+            continue;
+        }
+        auto index = SecondaryIndex::open(resolvePath(metadata.path));
+        if (!index || index->getFileCount() != metadata.fileCount) {
+            Logger::warn("Ignoring index {} of {}", metadata.path.string(), metadata.column.getName());
             continue;
         }
 
-        int64_t rowsRead = reader->readBatch(out, batch_size_);
-        if (rowsRead > 0) {
-            return rowsRead;
+        std::vector<std::vector<int64_t>> positions = keys ? index->lookupKeys(*keys) : index->lookup(*range);
+        int64_t hits = 0;
+        for (const auto& rows : positions) {
+            hits += static_cast<int64_t>(rows.size());
+        }
+        if (hits * INDEX_SELECTIVITY > index->getEntryCount() || (bestIndex && hits >= bestHits)) {
+            continue;
         }
+        best = std::move(positions);
+        bestHits = hits;
+        bestIndex = &metadata;
+    }
+    if (!bestIndex) {
+        return std::nullopt;
+    }
 
-        ++current_file_index_;
+    std::vector<ScanUnit> units;
+    for (size_t i = 0; i < best.size(); ++i) {
+        if (!best[i].empty()) {
+            auto weight = static_cast<int64_t>(best[i].size());
+            units.push_back({resolvePath((*files_)[i].path), std::nullopt, weight, std::nullopt,
+                             std::make_shared<const std::vector<int64_t>>(std::move(best[i]))});
+        }
+    }
+    // Files appended after the index was built are scanned
+    for (size_t i = bestIndex->fileCount; i < files_->size(); ++i) {
+        const FileEntry& file = (*files_)[i];
+        auto lookup = [&file](const ColumnId& columnId) -> const ColumnStatistics* {
+            auto it = file.statistics.find(columnId);
+            return it == file.statistics.end() ? nullptr : &it->second;
+        };
+        if (file.statistics.empty() || mayMatch(predicate, lookup)) {
+            units.push_back({resolvePath(file.path), std::nullopt, file.row_count.value_or(1), std::nullopt});
+        }
     }
 
-    return 0;
+    static metrics::Counter& indexScans =
+        metrics::MetricsRegistry::global().counter("toydb_index_scans_total", "Scans that read rows found in a secondary index");
+    indexScans.increment();
+    Logger::debug("Index on {} finds {} rows of {}", bestIndex->column.getName(), bestHits, metadata_->name);
+    return units;
 }
 
-bool TableIteratorImpl::hasMore() const noexcept {
-    if (!initialized_) {
-        return !handle_->getFilePaths().empty();
+FileEntry TableHandle::analyzeFile(const FileEntry& file, int64_t batchSize) const {
+    std::vector<ColumnDescriptor> columns = getColumnDescriptors();
+    auto readerFactory = [this](const ScanUnit& unit) { return createFileReader(unit.path, unit.range); };
+    // A single reader thread, so that reading overlaps with computing the statistics
+    ParallelScan scan({{resolvePath(file.path), std::nullopt, 1, std::nullopt}}, std::move(readerFactory), columns, 1, batchSize);
+
+    StatisticsCollector collector(std::move(columns));
+    RowVector batch;
+    while (scan.next(batch) > 0) {
+        collector.add(batch);
     }
 
-    for (size_t i = current_file_index_; i < readers_.size(); ++i) {
-        if (readers_[i]->hasMore()) {
-            return true;
+    FileEntry analyzed = file;
+    analyzed.row_count = collector.getRowCount();
+    analyzed.statistics = collector.finish();
+    return analyzed;
+}
+
+std::unique_ptr<TableIterator> TableHandle::createIterator(int64_t requestedBatchSize, size_t workerCount) {
+    return std::make_unique<TableIteratorImpl>(this, requestedBatchSize, workerCount);
+}
+
+std::unique_ptr<ParallelScan> TableHandle::createScan(int64_t batchSize, size_t workerCount,
+                                                     const std::vector<ColumnId>& projection,
+                                                     const PredicateExpr* predicate) const {
+    if (table_cache_) {
+        if (auto cached = table_cache_->getOrLoad(*this, workerCount)) {
+            return createCachedScan(std::move(cached), batchSize, workerCount, projection, predicate);
         }
     }
+    return createFileScan(batchSize, workerCount, projection, predicate);
+}
+
+std::unique_ptr<ParallelScan> TableHandle::createFileScan(int64_t batchSize, size_t workerCount,
+                                                         const std::vector<ColumnId>& projection,
+                                                         const PredicateExpr* predicate) const {
+    auto readerFactory = [this, projection, predicate](const ScanUnit& unit) {
+        auto reader = createFileReader(unit.path, unit.range);
+        if (reader && !projection.empty()) {
+            reader->setProjection(projection);
+        }
+        if (reader && predicate) {
+            reader->setPredicate(predicate);
+        }
+        if (reader && unit.rows) {
+            // Readers that can't seek read all rows, which the predicate filters as usual
+            reader->setRowPositions(unit.rows);
+        }
+        return reader;
+    };
 
-    return false;
+    std::optional<std::vector<ScanUnit>> units;
+    if (predicate && metadata_->format == StorageFormat::TDB && !getIndexes().empty()) {
+        units = planIndexScanUnits(*predicate);
+    }
+    if (!units) {
+        units = planScanUnits(workerCount, predicate);
+    }
+    return std::make_unique<ParallelScan>(std::move(*units), std::move(readerFactory),
+                                          getColumnDescriptors(projection), workerCount, batchSize);
 }
 
-void TableIteratorImpl::reset() {
-    for (auto& reader : readers_) {
-        if (reader) {
-            reader->reset();
+std::unique_ptr<ParallelScan> TableHandle::createCachedScan(std::shared_ptr<const CachedTable> cached,
+                                                           int64_t batchSize, size_t workerCount,
+                                                           const std::vector<ColumnId>& projection,
+                                                           const PredicateExpr* predicate) const {
+    // Contiguous ranges of chunks, chunks ruled out by the predicate are skipped by the readers
+    const MaterializedInput& rows = cached->getRows();
+    size_t chunkCount = rows.getChunkCount();
+    size_t unitCount = std::min(chunkCount, std::max<size_t>(workerCount, 1) * UNITS_PER_WORKER);
+    std::vector<ScanUnit> units;
+    for (size_t i = 0; i < unitCount; ++i) {
+        ChunkRange chunks{chunkCount * i / unitCount, chunkCount * (i + 1) / unitCount};
+        int64_t weight = static_cast<int64_t>(chunks.end - chunks.begin) * rows.getChunkCapacity();
+        units.push_back({{}, std::nullopt, weight, chunks});
+    }
+
+    auto readerFactory = [this, cached = std::move(cached), projection, predicate](const ScanUnit& unit) {
+        auto reader = std::make_unique<CachedTableReader>(cached, *unit.chunks, metadata_->schema);
+        if (!projection.empty()) {
+            reader->setProjection(projection);
+        }
+        if (predicate) {
+            reader->setPredicate(predicate);
         }
+        return reader;
+    };
+    return std::make_unique<ParallelScan>(std::move(units), std::move(readerFactory), getColumnDescriptors(projection),
+                                          workerCount, batchSize);
+}
+
+TableIteratorImpl::TableIteratorImpl(TableHandle* handle, int64_t batchSize, size_t workerCount)
+    : handle_(handle), batch_size_(batchSize), worker_count_(workerCount) {}
+
+void TableIteratorImpl::initialize() {
+    if (scan_) {
+        return;
     }
-    current_file_index_ = 0;
+
+    scan_ = handle_->createScan(batch_size_, worker_count_, projection_, predicate_);
+}
+
+int64_t TableIteratorImpl::next(RowVector& out) {
+    initialize();
+    return scan_->next(out);
+}
+
+bool TableIteratorImpl::hasMore() const noexcept {
+    if (!scan_) {
+        return !handle_->getFiles().empty();
+    }
+    return scan_->hasMore();
+}
+
+void TableIteratorImpl::reset() {
+    // Stops the workers, the next call to next() starts over
+    scan_.reset();
+}
+
+void TableIteratorImpl::setProjection(std::vector<ColumnId> columns) {
+    projection_ = std::move(columns);
+}
+
+void TableIteratorImpl::setPredicate(const PredicateExpr* predicate) {
+    predicate_ = predicate;
 }
 
 }  // namespace toydb
@@ -0,0 +1,120 @@
+#include "storage/table_writer.hpp"
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include "common/errors.hpp"
+#include "common/logging.hpp"
+#include "engine/arrow_export.hpp"
+#include "storage/file_sync.hpp"
+#include "storage/statistics_collector.hpp"
+#include "storage/tdb_file.hpp"
+
+namespace toydb {
+
+namespace fs = std::filesystem;
+
+TableWriter::TableWriter(Catalog* catalog, const TableId& tableId) : catalog_(catalog), buffer_(&bufferManager_) {
+    auto table = catalog_->getTableHandle(tableId);
+    if (!table) {
+        throw SQLRuntimeException("Unknown table " + tableId.getName());
+    }
+    table_ = std::move(*table);
+    if (table_->getFormat() == StorageFormat::CSV) {
+        throw SQLRuntimeException("Cannot insert into CSV table " + tableId.getName());
+    }
+}
+
+void TableWriter::append(const RowVector& batch) {
+    tdb_assert(batch.getColumnCount() == static_cast<int64_t>(table_->getColumnIds().size()),
+               "Batch has {} columns, the table {}", batch.getColumnCount(), table_->getColumnIds().size());
+    buffer_.append(batch);
+}
+
+bool TableWriter::writeTdb(const fs::path& path) const {
+    std::vector<tdb::ColumnInfo> columns;
+    for (const ColumnMetadata& column : table_->getSchema()) {
+        columns.push_back({column.name, column.type});
+    }
+    TdbFileWriter writer(path, std::move(columns));
+    for (size_t i = 0; i < buffer_.getChunkCount(); ++i) {
+        writer.append(buffer_.getChunk(i));
+    }
+    return writer.finish();
+}
+
+static bool checkParquet(const arrow::Status& status, const fs::path& path) {
+    if (!status.ok()) {
+        Logger::error("Failed to write Parquet file {}: {}", path.string(), status.ToString());
+        return false;
+    }
+    return true;
+}
+
+bool TableWriter::writeParquet(const fs::path& path) const {
+    // The buffered chunks own their memory until the file is closed, no need to copy them
+    std::shared_ptr<arrow::Schema> schema = toArrowSchema(*buffer_.getChunk(0).getSchema());
+
+    auto out = arrow::io::FileOutputStream::Open(path.string());
+    if (!checkParquet(out.status(), path)) {
+        return false;
+    }
+    auto writer = parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), *out);
+    if (!checkParquet(writer.status(), path)) {
+        return false;
+    }
+    for (size_t i = 0; i < buffer_.getChunkCount(); ++i) {
+        auto batch = toRecordBatch(schema, buffer_.getChunk(i), ArrowBufferMode::WRAP);
+        if (!checkParquet((*writer)->WriteRecordBatch(*batch), path)) {
+            return false;
+        }
+    }
+    return checkParquet((*writer)->Close(), path) && checkParquet((*out)->Close(), path);
+}
+
+std::optional<FileEntry> TableWriter::writeFile(const fs::path& path, bool sync) {
+    bool written = table_->getFormat() == StorageFormat::TDB ? writeTdb(path) : writeParquet(path);
+    if (!written || (sync && !syncPath(path))) {
+        Logger::error("Failed to write {} rows to {}", buffer_.getRowCount(), path.string());
+        std::error_code error;
+        fs::remove(path, error);
+        return std::nullopt;
+    }
+
+    // Like ANALYZE would, so that the merged statistics of analyzed tables stay up to date
+    StatisticsCollector collector(table_->getColumnDescriptors());
+    for (size_t i = 0; i < buffer_.getChunkCount(); ++i) {
+        collector.add(buffer_.getChunk(i));
+    }
+    FileEntry file;
+    file.path = path;
+    file.row_count = collector.getRowCount();
+    file.statistics = collector.finish();
+
+    Logger::debug("Wrote {} rows to {}", buffer_.getRowCount(), path.string());
+    buffer_.clear();
+    return file;
+}
+
+std::expected<void, CatalogError> TableWriter::flush() {
+    if (buffer_.getRowCount() == 0) {
+        return {};
+    }
+
+    auto path = catalog_->createFilePath(table_->getTableId());
+    if (!path) {
+        return std::unexpected(path.error());
+    }
+    auto file = writeFile(*path, true);
+    if (!file) {
+        return std::unexpected(CatalogError::WRITE_FAILED);
+    }
+
+    auto added = catalog_->addFiles(table_->getTableId(), {std::move(*file)});
+    if (!added) {
+        std::error_code error;
+        fs::remove(*path, error);
+    }
+    return added;
+}
+
+}  // namespace toydb
@@ -0,0 +1,372 @@
+#include "storage/tdb_data_file_reader.hpp"
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstring>
+#include "common/assert.hpp"
+#include "common/logging.hpp"
+
+namespace toydb {
+
+TdbDataFileReader::TdbDataFileReader(const std::filesystem::path& filePath, const Schema& schema, TableId tableId)
+    : file_path_(filePath), schema_(schema), table_id_(tableId), projection_(schema.getColumnIds()) {
+    memory_.init();
+    if (!open()) {
+        footer_.reset();
+    }
+    eof_ = !footer_;
+}
+
+TdbDataFileReader::~TdbDataFileReader() {
+    memory::MemoryManager::unmap(region_);
+}
+
+bool TdbDataFileReader::open() {
+    auto region = memory_.mapFile(file_path_.string());
+    if (!region) {
+        Logger::error("Failed to map TDB file {}", file_path_.string());
+        return false;
+    }
+    region_ = *region;
+
+    const char* data = static_cast<const char*>(region_.data);
+    size_t size = region_.size;
+    uint64_t footerSize = 0;
+    if (size >= tdb::HEADER_SIZE + tdb::TRAILER_SIZE) {
+        std::memcpy(&footerSize, data + size - tdb::TRAILER_SIZE, sizeof(footerSize));
+    }
+    uint32_t version = 0;
+    if (size >= tdb::HEADER_SIZE) {
+        std::memcpy(&version, data + sizeof(tdb::MAGIC), sizeof(version));
+    }
+    if (size < tdb::HEADER_SIZE + tdb::TRAILER_SIZE || std::memcmp(data, tdb::MAGIC, sizeof(tdb::MAGIC)) != 0 ||
+        std::memcmp(data + size - sizeof(tdb::MAGIC), tdb::MAGIC, sizeof(tdb::MAGIC)) != 0 ||
+        version != tdb::VERSION || footerSize > size - tdb::HEADER_SIZE - tdb::TRAILER_SIZE) {
+        Logger::error("{} is not a TDB file", file_path_.string());
+        return false;
+    }
+
+    const char* footer = data + size - tdb::TRAILER_SIZE - footerSize;
+    footer_ = tdb::Footer::decode({footer, static_cast<size_t>(footerSize)});
+    if (!footer_) {
+        Logger::error("Failed to read the footer of TDB file {}", file_path_.string());
+        return false;
+    }
+
+    // Chunks must lie between the header and the footer
+    auto chunksEnd = static_cast<uint64_t>(footer - data);
+    chunks_.clear();
+    row_group_starts_.clear();
+    int64_t rowGroupStart = 0;
+    for (const tdb::RowGroupInfo& rowGroup : footer_->rowGroups) {
+        row_group_starts_.push_back(rowGroupStart);
+        rowGroupStart += rowGroup.rowCount;
+        std::vector<EncodedChunk>& chunks = chunks_.emplace_back();
+        for (size_t i = 0; i < rowGroup.chunks.size(); ++i) {
+            const tdb::ChunkInfo& chunk = rowGroup.chunks[i];
+            std::optional<EncodedChunk> encoded;
+            if (chunk.offset >= tdb::HEADER_SIZE && chunk.offset % 8 == 0 && chunk.offset <= chunksEnd &&
+                chunk.size <= chunksEnd - chunk.offset) {
+                encoded = EncodedChunk::open(chunk.encoding, footer_->columns[i].type, data + chunk.offset,
+                                             static_cast<size_t>(chunk.size), rowGroup.rowCount);
+            }
+            if (!encoded) {
+                Logger::error("Invalid chunk in TDB file {}", file_path_.string());
+                return false;
+            }
+            chunks.push_back(*encoded);
+        }
+    }
+
+    for (const auto& colId : schema_.getColumnIds()) {
+        const auto& colMeta = schema_.getColumn(colId);
+        tdb_assert(colMeta, "Column {} not found in schema", colId.getId());
+
+        auto it = std::find_if(footer_->columns.begin(), footer_->columns.end(),
+                               [&](const tdb::ColumnInfo& column) { return column.name == colMeta->name; });
+        if (it == footer_->columns.end()) {
+            file_columns_.push_back(-1);
+            continue;
+        }
+        if (it->type != colMeta->type) {
+            Logger::error("TDB column {} in {} has type {}, expected {}", colMeta->name, file_path_.string(),
+                          it->type.toString(), colMeta->type.toString());
+            return false;
+        }
+        file_columns_.push_back(static_cast<int>(it - footer_->columns.begin()));
+    }
+
+    return true;
+}
+
+void TdbDataFileReader::setProjection(const std::vector<ColumnId>& columns) {
+    tdb_assert(!started_, "Projection must be set before reading");
+    projection_ = columns;
+}
+
+void TdbDataFileReader::setPredicate(const PredicateExpr* predicate) {
+    tdb_assert(!started_, "Predicate must be set before reading");
+    predicate_ = predicate;
+}
+
+bool TdbDataFileReader::setRowPositions(std::shared_ptr<const std::vector<int64_t>> positions) {
+    tdb_assert(!started_, "Row positions must be set before reading");
+    positions_ = std::move(positions);
+    return true;
+}
+
+int TdbDataFileReader::getRowGroupCount() const noexcept {
+    return footer_ ? static_cast<int>(footer_->rowGroups.size()) : 0;
+}
+
+int TdbDataFileReader::getFileColumn(const ColumnId& columnId) const {
+    const auto& columnIds = schema_.getColumnIds();
+    auto it = std::find(columnIds.begin(), columnIds.end(), columnId);
+    if (it == columnIds.end()) {
+        return -1;
+    }
+    return file_columns_[static_cast<size_t>(it - columnIds.begin())];
+}
+
+void TdbDataFileReader::selectRowGroups() {
+    row_groups_.clear();
+    for (int rowGroup = 0; rowGroup < getRowGroupCount(); ++rowGroup) {
+        const tdb::RowGroupInfo& info = footer_->rowGroups[static_cast<size_t>(rowGroup)];
+        if (info.rowCount == 0) {
+            continue;
+        }
+        if (positions_) {
+            int64_t start = row_group_starts_[static_cast<size_t>(rowGroup)];
+            auto next = std::lower_bound(positions_->begin(), positions_->end(), start);
+            if (next == positions_->end() || *next >= start + info.rowCount) {
+                continue;
+            }
+        }
+        if (predicate_) {
+            auto lookup = [&](const ColumnId& colId) -> const ColumnStatistics* {
+                int fileColumn = getFileColumn(colId);
+                return fileColumn < 0 ? nullptr : &info.chunks[static_cast<size_t>(fileColumn)].statistics;
+            };
+            if (!mayMatch(*predicate_, lookup)) {
+                Logger::debug("Skipping row group {} of {}", rowGroup, file_path_.string());
+                continue;
+            }
+        }
+        row_groups_.push_back(rowGroup);
+    }
+}
+
+bool TdbDataFileReader::startReading() {
+    if (!footer_) {
+        return false;
+    }
+
+    projected_columns_.clear();
+    for (const auto& colId : projection_) {
+        int fileColumn = getFileColumn(colId);
+        if (fileColumn < 0) {
+            Logger::error("Column {} not found in TDB file {}", colId.getName(), file_path_.string());
+            return false;
+        }
+        projected_columns_.push_back(fileColumn);
+    }
+
+    filters_.clear();
+    if (predicate_) {
+        collectFilters(*predicate_);
+    }
+
+    selectRowGroups();
+    row_group_index_ = 0;
+    row_offset_ = 0;
+    if (row_groups_.empty() || projected_columns_.empty()) {
+        return false;
+    }
+    prefetchRowGroup();
+    return true;
+}
+
+// Ask the kernel to read the projected chunks of the current row group ahead
+void TdbDataFileReader::prefetchRowGroup() {
+    const tdb::RowGroupInfo& rowGroup = footer_->rowGroups[static_cast<size_t>(row_groups_[row_group_index_])];
+    auto* base = static_cast<char*>(region_.data);
+    for (int fileColumn : projected_columns_) {
+        const tdb::ChunkInfo& chunk = rowGroup.chunks[static_cast<size_t>(fileColumn)];
+        size_t begin = memory_.alignToPageSize(chunk.offset);
+        ::madvise(base + begin, chunk.offset + chunk.size - begin, MADV_WILLNEED);
+    }
+}
+
+// Comparisons of a column with a constant that every row read must satisfy
+void TdbDataFileReader::collectFilters(const PredicateExpr& predicate) {
+    if (const auto* logical = dynamic_cast<const LogicalExpr*>(&predicate)) {
+        if (logical->getOp() == CompareOp::AND) {
+            collectFilters(*logical->getLeft());
+            collectFilters(*logical->getRight());
+        }
+        return;
+    }
+
+    const auto* compare = dynamic_cast<const CompareExpr*>(&predicate);
+    if (!compare) {
+        return;
+    }
+    CompareOp op = compare->getOp();
+    const auto* column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getLeft()));
+    const auto* constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getRight()));
+    if (!column || !constant) {
+        column = dynamic_cast<const ColumnRefExpr*>(detail::unwrapCast(compare->getRight()));
+        constant = dynamic_cast<const ConstantExpr*>(detail::unwrapCast(compare->getLeft()));
+        op = kernels::mirrorCompareOp(op);
+    }
+    if (!column || !constant) {
+        return;
+    }
+    int fileColumn = getFileColumn(column->getColumnId());
+    if (fileColumn >= 0) {
+        filters_.push_back({static_cast<size_t>(fileColumn), op, kernels::getCompareDomain(compare->getType()),
+                            constant});
+    }
+}
+
+bool TdbDataFileReader::zoneMayMatch(size_t rowGroup, size_t zone) const {
+    const tdb::RowGroupInfo& info = footer_->rowGroups[rowGroup];
+    auto lookup = [&](const ColumnId& colId) -> const ColumnStatistics* {
+        int fileColumn = getFileColumn(colId);
+        return fileColumn < 0 ? nullptr : &info.chunks[static_cast<size_t>(fileColumn)].zones[zone];
+    };
+    return mayMatch(*predicate_, lookup);
+}
+
+void TdbDataFileReader::advanceRows(int64_t rows) {
+    row_offset_ += rows;
+    if (row_offset_ == footer_->rowGroups[static_cast<size_t>(row_groups_[row_group_index_])].rowCount) {
+        row_offset_ = 0;
+        if (++row_group_index_ == row_groups_.size()) {
+            eof_ = true;
+        } else {
+            prefetchRowGroup();
+        }
+    }
+}
+
+int64_t TdbDataFileReader::readBatch(RowVector& out, int64_t requestedRows) {
+    if (eof_) {
+        return 0;
+    }
+
+    if (!started_) {
+        started_ = true;
+        if (!startReading()) {
+            eof_ = true;
+            return 0;
+        }
+    }
+
+    tdb_assert(out.getColumnCount() == static_cast<int64_t>(projection_.size()),
+        "RowVector column count ({}) does not match projected column count ({})",
+        out.getColumnCount(), projection_.size());
+    for (size_t colIdx = 0; colIdx < projection_.size(); ++colIdx) {
+        [[maybe_unused]] const ColumnBuffer& colBuf = out.getColumn(static_cast<int64_t>(colIdx));
+        tdb_assert(colBuf.columnId == projection_[colIdx],
+            "Column {} mismatch: expected {}, got {}",
+            colIdx, projection_[colIdx].getId(), colBuf.columnId.getId());
+        tdb_assert(colBuf.getCapacity() >= requestedRows,
+            "Column {} capacity ({}) insufficient for requested rows ({})",
+            colIdx, colBuf.getCapacity(), requestedRows);
+    }
+
+    // Strings of the previous batch are no longer referenced
+    string_heap_.reset();
+
+    int64_t count = 0;
+    while (count == 0 && !eof_) {
+        size_t rowGroup = static_cast<size_t>(row_groups_[row_group_index_]);
+        const std::vector<EncodedChunk>& chunks = chunks_[rowGroup];
+        int64_t rowCount = footer_->rowGroups[rowGroup].rowCount;
+        int64_t start = row_group_starts_[rowGroup];
+
+        // Jump to the next row position, the rest of the row group is skipped if it has none
+        std::vector<int64_t>::const_iterator firstPosition;
+        if (positions_) {
+            firstPosition = std::lower_bound(positions_->begin(), positions_->end(), start + row_offset_);
+            if (firstPosition == positions_->end() || *firstPosition >= start + rowCount) {
+                advanceRows(rowCount - row_offset_);
+                continue;
+            }
+            row_offset_ = *firstPosition - start;
+        }
+
+        // Batches don't cross zones, zones whose min/max rule out the predicate are skipped
+        int64_t zone = row_offset_ / footer_->zoneRows;
+        int64_t zoneEnd = std::min(rowCount, (zone + 1) * footer_->zoneRows);
+        if (predicate_ && !zoneMayMatch(rowGroup, static_cast<size_t>(zone))) {
+            ++skipped_zones_;
+            advanceRows(zoneEnd - row_offset_);
+            continue;
+        }
+        int64_t window = std::min(requestedRows, zoneEnd - row_offset_);
+        std::vector<int64_t>::const_iterator lastPosition;
+        if (positions_) {
+            lastPosition = std::lower_bound(firstPosition, positions_->end(), start + row_offset_ + window);
+        }
+
+        // Rows for which a comparison is not TRUE are not decoded
+        selected_rows_.clear();
+        bool filtered = false;
+        passes_.assign(static_cast<size_t>(window), 1);
+        for (const EncodedFilter& filter : filters_) {
+            filtered |= chunks[filter.fileColumn].filter(filter.op, filter.domain, *filter.constant, row_offset_,
+                                                         window, passes_);
+        }
+        if (positions_) {
+            for (auto it = firstPosition; it != lastPosition; ++it) {
+                if (passes_[static_cast<size_t>(*it - start - row_offset_)]) {
+                    selected_rows_.push_back(*it - start);
+                }
+            }
+            filtered = true;
+        } else if (filtered) {
+            for (int64_t i = 0; i < window; ++i) {
+                if (passes_[static_cast<size_t>(i)]) {
+                    selected_rows_.push_back(row_offset_ + i);
+                }
+            }
+            filtered_rows_ += window - static_cast<int64_t>(selected_rows_.size());
+        }
+        count = filtered ? static_cast<int64_t>(selected_rows_.size()) : window;
+
+        for (size_t colIdx = 0; colIdx < projected_columns_.size() && count > 0; ++colIdx) {
+            ColumnBuffer& column = out.getColumn(static_cast<int64_t>(colIdx));
+            const EncodedChunk& chunk = chunks[static_cast<size_t>(projected_columns_[colIdx])];
+            StringHeap* heap = column.getStringHeap() ? column.getStringHeap() : &string_heap_;
+            if (count == window) {
+                chunk.decode(row_offset_, window, column, heap);
+            } else {
+                chunk.gather(selected_rows_, column, heap);
+            }
+        }
+
+        advanceRows(window);
+    }
+
+    for (int64_t colIdx = 0; colIdx < out.getColumnCount(); ++colIdx) {
+        out.getColumn(colIdx).count = count;
+    }
+    out.setRowCount(count);
+    return count;
+}
+
+bool TdbDataFileReader::hasMore() const noexcept {
+    return !eof_;
+}
+
+void TdbDataFileReader::reset() {
+    row_group_index_ = 0;
+    row_offset_ = 0;
+    filtered_rows_ = 0;
+    skipped_zones_ = 0;
+    started_ = false;
+    eof_ = !footer_;
+}
+
+}  // namespace toydb
@@ -0,0 +1,413 @@
+#include "storage/tdb_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include "common/assert.hpp"
+#include "common/logging.hpp"
+#include "storage/statistics_collector.hpp"
+#include "storage/table_handle.hpp"
+
+namespace toydb {
+
+namespace tdb {
+
+template<typename T>
+static void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void putString(std::string& out, const std::string& value) {
+    put(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+/**
+ * @brief Reads the values written by put, failing instead of reading past the end
+ */
+class FooterCursor {
+public:
+    explicit FooterCursor(std::span<const char> bytes) : bytes_(bytes) {}
+
+    template<typename T>
+    bool get(T& value) {
+        if (bytes_.size() - pos_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, bytes_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        uint32_t size = 0;
+        if (!get(size) || bytes_.size() - pos_ < size) {
+            return false;
+        }
+        value.assign(bytes_.data() + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    bool atEnd() const noexcept { return pos_ == bytes_.size(); }
+
+private:
+    std::span<const char> bytes_;
+    size_t pos_ = 0;
+};
+
+static bool isSupportedType(uint8_t type) {
+    switch (static_cast<DataType::Type>(type)) {
+        case DataType::Type::INT32:
+        case DataType::Type::INT64:
+        case DataType::Type::DOUBLE:
+        case DataType::Type::BOOL:
+        case DataType::Type::STRING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void encodeStatistics(std::string& out, const ColumnStatistics& stats) {
+    put(out, stats.rowCount);
+    put(out, stats.nullCount);
+    put(out, static_cast<uint8_t>(stats.hasMinMax));
+    switch (stats.type.getType()) {
+        case DataType::Type::DOUBLE:
+            put(out, stats.doubleMin);
+            put(out, stats.doubleMax);
+            break;
+        case DataType::Type::STRING:
+            putString(out, stats.stringMin);
+            putString(out, stats.stringMax);
+            break;
+        default:
+            put(out, stats.intMin);
+            put(out, stats.intMax);
+            break;
+    }
+}
+
+static bool decodeStatistics(FooterCursor& cursor, ColumnStatistics& stats) {
+    uint8_t hasMinMax = 0;
+    if (!cursor.get(stats.rowCount) || !cursor.get(stats.nullCount) || !cursor.get(hasMinMax)) {
+        return false;
+    }
+    stats.hasMinMax = hasMinMax != 0;
+    switch (stats.type.getType()) {
+        case DataType::Type::DOUBLE:
+            return cursor.get(stats.doubleMin) && cursor.get(stats.doubleMax);
+        case DataType::Type::STRING:
+            return cursor.getString(stats.stringMin) && cursor.getString(stats.stringMax);
+        default:
+            return cursor.get(stats.intMin) && cursor.get(stats.intMax);
+    }
+}
+
+std::string Footer::encode() const {
+    std::string out;
+    put(out, static_cast<uint32_t>(columns.size()));
+    for (const ColumnInfo& column : columns) {
+        putString(out, column.name);
+        put(out, static_cast<uint8_t>(column.type.getType()));
+    }
+    put(out, zoneRows);
+
+    put(out, static_cast<uint32_t>(rowGroups.size()));
+    for (const RowGroupInfo& rowGroup : rowGroups) {
+        tdb_assert(rowGroup.chunks.size() == columns.size(), "Row group has {} chunks for {} columns",
+                   rowGroup.chunks.size(), columns.size());
+        put(out, rowGroup.rowCount);
+        for (const ChunkInfo& chunk : rowGroup.chunks) {
+            put(out, chunk.offset);
+            put(out, chunk.size);
+            put(out, static_cast<uint8_t>(chunk.encoding));
+            encodeStatistics(out, chunk.statistics);
+            tdb_assert(static_cast<int64_t>(chunk.zones.size()) == (rowGroup.rowCount + zoneRows - 1) / zoneRows,
+                       "Chunk has {} zones for {} rows", chunk.zones.size(), rowGroup.rowCount);
+            for (const ColumnStatistics& zone : chunk.zones) {
+                encodeStatistics(out, zone);
+            }
+        }
+    }
+    return out;
+}
+
+std::optional<Footer> Footer::decode(std::span<const char> bytes) {
+    FooterCursor cursor(bytes);
+    Footer footer;
+
+    uint32_t columnCount = 0;
+    if (!cursor.get(columnCount)) {
+        return std::nullopt;
+    }
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        ColumnInfo column;
+        uint8_t type = 0;
+        if (!cursor.getString(column.name) || !cursor.get(type) || !isSupportedType(type)) {
+            return std::nullopt;
+        }
+        column.type = DataType(static_cast<DataType::Type>(type));
+        footer.columns.push_back(std::move(column));
+    }
+
+    if (!cursor.get(footer.zoneRows) || footer.zoneRows <= 0) {
+        return std::nullopt;
+    }
+
+    uint32_t rowGroupCount = 0;
+    if (!cursor.get(rowGroupCount)) {
+        return std::nullopt;
+    }
+    for (uint32_t i = 0; i < rowGroupCount; ++i) {
+        RowGroupInfo rowGroup;
+        if (!cursor.get(rowGroup.rowCount) || rowGroup.rowCount < 0) {
+            return std::nullopt;
+        }
+        for (const ColumnInfo& column : footer.columns) {
+            ChunkInfo chunk;
+            chunk.statistics.type = column.type;
+            uint8_t encoding = 0;
+            if (!cursor.get(chunk.offset) || !cursor.get(chunk.size) || !cursor.get(encoding) ||
+                encoding > static_cast<uint8_t>(ColumnEncoding::FRAME_OF_REFERENCE) ||
+                !decodeStatistics(cursor, chunk.statistics)) {
+                return std::nullopt;
+            }
+            chunk.encoding = static_cast<ColumnEncoding>(encoding);
+            int64_t zoneCount = (rowGroup.rowCount + footer.zoneRows - 1) / footer.zoneRows;
+            for (int64_t zone = 0; zone < zoneCount; ++zone) {
+                ColumnStatistics& stats = chunk.zones.emplace_back();
+                stats.type = column.type;
+                if (!decodeStatistics(cursor, stats)) {
+                    return std::nullopt;
+                }
+            }
+            rowGroup.chunks.push_back(std::move(chunk));
+        }
+        footer.rowGroups.push_back(std::move(rowGroup));
+    }
+
+    if (!cursor.atEnd()) {
+        return std::nullopt;
+    }
+    return footer;
+}
+
+}  // namespace tdb
+
+TdbFileWriter::TdbFileWriter(const std::filesystem::path& path, std::vector<tdb::ColumnInfo> columns,
+                             int64_t rowGroupRows, int64_t zoneRows)
+    : path_(path), out_(path, std::ios::binary | std::ios::trunc), row_group_rows_(rowGroupRows) {
+    tdb_assert(rowGroupRows > 0 && zoneRows > 0, "Row groups and zones must hold at least one row");
+    footer_.columns = std::move(columns);
+    footer_.zoneRows = zoneRows;
+    states_.resize(footer_.columns.size());
+    resetStates();
+
+    write(tdb::MAGIC, sizeof(tdb::MAGIC));
+    write(&tdb::VERSION, sizeof(tdb::VERSION));
+}
+
+void TdbFileWriter::resetStates() {
+    for (size_t i = 0; i < states_.size(); ++i) {
+        ColumnState& state = states_[i];
+        DataType type = footer_.columns[i].type;
+        // All rows start out null
+        state.bitmap.assign(tdb::bitmapBytes(row_group_rows_), 0);
+        state.values.assign(ColumnBuffer::calculateDataSize(row_group_rows_, type), 0);
+        state.chars.clear();
+        state.zones.clear();
+        state.zone = ColumnStatistics{};
+        state.zone.type = type;
+    }
+    buffered_rows_ = 0;
+    zone_start_ = 0;
+}
+
+void TdbFileWriter::finishZone() {
+    for (ColumnState& state : states_) {
+        state.zone.rowCount = buffered_rows_ - zone_start_;
+        state.zones.push_back(std::move(state.zone));
+        state.zone = ColumnStatistics{};
+        state.zone.type = state.zones.back().type;
+    }
+    zone_start_ = buffered_rows_;
+}
+
+template<typename T>
+static void updateMinMax(T& min, T& max, const T& value, bool first) {
+    if (first || value < min) {
+        min = value;
+    }
+    if (first || value > max) {
+        max = value;
+    }
+}
+
+void TdbFileWriter::appendValue(ColumnState& state, const ColumnBuffer& column, int64_t row) {
+    ColumnStatistics& stats = state.zone;
+    if (column.isNull(row)) {
+        ++stats.nullCount;
+        return;
+    }
+
+    auto index = static_cast<size_t>(buffered_rows_);
+    state.bitmap[index / 8] |= static_cast<uint8_t>(1 << (index % 8));
+    bool first = !stats.hasMinMax;
+    stats.hasMinMax = true;
+    char* slot = state.values.data() + index * static_cast<size_t>(column.type.getSize());
+
+    switch (column.type.getType()) {
+        case DataType::Type::INT32: {
+            db_int32 value = column.getEntry<db_int32>(row);
+            std::memcpy(slot, &value, sizeof(value));
+            updateMinMax<int64_t>(stats.intMin, stats.intMax, value, first);
+            break;
+        }
+        case DataType::Type::INT64: {
+            db_int64 value = column.getEntry<db_int64>(row);
+            std::memcpy(slot, &value, sizeof(value));
+            updateMinMax<int64_t>(stats.intMin, stats.intMax, value, first);
+            break;
+        }
+        case DataType::Type::DOUBLE: {
+            db_double value = column.getEntry<db_double>(row);
+            std::memcpy(slot, &value, sizeof(value));
+            updateMinMax(stats.doubleMin, stats.doubleMax, value, first);
+            break;
+        }
+        case DataType::Type::BOOL: {
+            db_bool value = column.getEntry<db_bool>(row);
+            std::memcpy(slot, &value, sizeof(value));
+            updateMinMax<int64_t>(stats.intMin, stats.intMax, value, first);
+            break;
+        }
+        case DataType::Type::STRING: {
+            const db_string& value = column.getEntry<db_string>(row);
+            std::memcpy(slot, &value, sizeof(value));
+            if (!value.isInline()) {
+                // The pointer after the prefix becomes the offset of the characters
+                uint64_t offset = state.chars.size();
+                state.chars.append(value.data(), value.size());
+                std::memcpy(slot + sizeof(uint32_t) + db_string::PREFIX_LENGTH, &offset, sizeof(offset));
+            }
+            std::string_view view = value.view();
+            if (first || view < stats.stringMin) {
+                stats.stringMin = view;
+            }
+            if (first || view > stats.stringMax) {
+                stats.stringMax = view;
+            }
+            break;
+        }
+        default:
+            tdb_unreachable("Unsupported column type");
+    }
+}
+
+void TdbFileWriter::append(const RowVector& batch) {
+    tdb_assert(batch.getColumnCount() == static_cast<int64_t>(states_.size()),
+               "Batch has {} columns, the file {}", batch.getColumnCount(), states_.size());
+    for (size_t i = 0; i < states_.size(); ++i) {
+        tdb_assert(batch.getColumn(static_cast<int64_t>(i)).type == footer_.columns[i].type,
+                   "Column {} of the batch does not have the type of the file column", i);
+    }
+
+    batch.forEachSelectedRow([&](int64_t row) {
+        for (size_t i = 0; i < states_.size(); ++i) {
+            appendValue(states_[i], batch.getColumn(static_cast<int64_t>(i)), row);
+        }
+        ++buffered_rows_;
+        ++row_count_;
+        if (buffered_rows_ == row_group_rows_) {
+            flushRowGroup();
+        } else if (buffered_rows_ - zone_start_ == footer_.zoneRows) {
+            finishZone();
+        }
+    });
+}
+
+void TdbFileWriter::flushRowGroup() {
+    if (buffered_rows_ == 0) {
+        return;
+    }
+    if (zone_start_ < buffered_rows_) {
+        finishZone();
+    }
+
+    tdb::RowGroupInfo rowGroup;
+    rowGroup.rowCount = buffered_rows_;
+    for (size_t i = 0; i < states_.size(); ++i) {
+        ColumnState& state = states_[i];
+        tdb::ChunkInfo chunk;
+        chunk.offset = offset_;
+
+        PlainChunk plain{footer_.columns[i].type, buffered_rows_, state.bitmap.data(), state.values.data(),
+                         state.chars};
+        encoded_.clear();
+        chunk.encoding = encodeChunk(plain, encoded_);
+        write(encoded_.data(), encoded_.size());
+
+        chunk.size = offset_ - chunk.offset;
+        std::vector<const ColumnStatistics*> zones;
+        for (const ColumnStatistics& zone : state.zones) {
+            zones.push_back(&zone);
+        }
+        chunk.statistics = mergeColumnStatistics(zones);
+        chunk.zones = std::move(state.zones);
+        rowGroup.chunks.push_back(std::move(chunk));
+    }
+    footer_.rowGroups.push_back(std::move(rowGroup));
+    resetStates();
+}
+
+void TdbFileWriter::write(const void* data, size_t size) {
+    if (failed_ || size == 0) {
+        return;
+    }
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out_) {
+        Logger::error("Failed to write TDB file {}", path_.string());
+        failed_ = true;
+        return;
+    }
+    offset_ += size;
+}
+
+bool TdbFileWriter::finish() {
+    flushRowGroup();
+
+    std::string footer = footer_.encode();
+    uint64_t footerSize = footer.size();
+    write(footer.data(), footer.size());
+    write(&footerSize, sizeof(footerSize));
+    write(tdb::MAGIC, sizeof(tdb::MAGIC));
+
+    out_.close();
+    if (!out_) {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool convertToTdb(const TableHandle& table, const std::filesystem::path& path) {
+    std::vector<tdb::ColumnInfo> columns;
+    for (const ColumnMetadata& column : table.getSchema()) {
+        columns.push_back({column.name, column.type});
+    }
+    TdbFileWriter writer(path, std::move(columns));
+
+    auto scan = table.createScan(8192, 1);
+    RowVector batch;
+    while (scan->next(batch) > 0) {
+        writer.append(batch);
+    }
+
+    if (!writer.finish()) {
+        return false;
+    }
+    Logger::info("Converted table {} with {} rows to {}", table.getTableId().getName(), writer.getRowCount(),
+                 path.string());
+    return true;
+}
+
+}  // namespace toydb
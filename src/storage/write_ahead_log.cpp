@@ -0,0 +1,254 @@
+#include "storage/write_ahead_log.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include "common/hash.hpp"
+#include "common/logging.hpp"
+#include "common/metrics.hpp"
+
+namespace toydb {
+
+std::string walSyncPolicyToString(WalSyncPolicy policy) noexcept {
+    switch (policy) {
+        case WalSyncPolicy::FSYNC:
+            return "fsync";
+        case WalSyncPolicy::INTERVAL:
+            return "interval";
+        case WalSyncPolicy::NONE:
+            return "none";
+        default:
+            return "unknown";
+    }
+}
+
+std::optional<WalSyncPolicy> walSyncPolicyFromString(std::string_view s) noexcept {
+    if (s == "fsync") {
+        return WalSyncPolicy::FSYNC;
+    } else if (s == "interval") {
+        return WalSyncPolicy::INTERVAL;
+    } else if (s == "none") {
+        return WalSyncPolicy::NONE;
+    } else {
+        return std::nullopt;
+    }
+}
+
+std::optional<WalOptions> WalOptions::fromEnvironment() {
+    const char* value = std::getenv("TOYDB_WAL");
+    if (!value || std::string_view(value) == "off") {
+        return std::nullopt;
+    }
+
+    auto policy = walSyncPolicyFromString(value);
+    if (!policy) {
+        Logger::warn("Ignoring invalid TOYDB_WAL '{}'", value);
+        return std::nullopt;
+    }
+    WalOptions options;
+    options.syncPolicy = *policy;
+    return options;
+}
+
+static metrics::Counter& walCommits() {
+    static metrics::Counter& counter = metrics::MetricsRegistry::global().counter(
+        "toydb_wal_commits_total", "Commits waiting for records of the write-ahead log");
+    return counter;
+}
+
+static metrics::Counter& walSyncs() {
+    static metrics::Counter& counter =
+        metrics::MetricsRegistry::global().counter("toydb_wal_syncs_total", "Syncs of the write-ahead log");
+    return counter;
+}
+
+static constexpr size_t RECORD_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint64_t);
+
+WriteAheadLog::WriteAheadLog(std::filesystem::path path, WalOptions options)
+    : path_(std::move(path)), options_(options), lock_(path_.string() + ".lock") {}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    progress_.notify_all();
+    if (syncThread_.joinable()) {
+        syncThread_.join();
+    }
+
+    if (fd_ == -1) {
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    progress_.wait(lock, [this] { return !writing_; });
+    if (!failed_ && (!buffer_.empty() || syncedLsn_ < writtenLsn_)) {
+        writeBuffered(lock, true);
+    }
+    close(fd_);
+}
+
+bool WriteAheadLog::open() {
+    if (!lock_.lock()) {
+        Logger::error("Write-ahead log {} is in use by another process", path_.string());
+        return false;
+    }
+    fd_ = ::open(path_.c_str(), O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        Logger::error("Failed to open write-ahead log {}: {}", path_.string(), std::strerror(errno));
+        return false;
+    }
+
+    std::error_code error;
+    size_ = static_cast<size_t>(std::filesystem::file_size(path_, error));
+    if (options_.syncPolicy == WalSyncPolicy::INTERVAL) {
+        syncThread_ = std::thread([this] { runSyncThread(); });
+    }
+    return true;
+}
+
+std::vector<std::string> WriteAheadLog::readRecords() const {
+    std::ifstream in(path_, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<std::string> records;
+    size_t offset = 0;
+    while (bytes.size() - offset >= RECORD_HEADER_SIZE) {
+        uint32_t size = 0;
+        uint64_t checksum = 0;
+        std::memcpy(&size, bytes.data() + offset, sizeof(size));
+        std::memcpy(&checksum, bytes.data() + offset + sizeof(size), sizeof(checksum));
+        if (bytes.size() - offset - RECORD_HEADER_SIZE < size) {
+            break;
+        }
+        const char* payload = bytes.data() + offset + RECORD_HEADER_SIZE;
+        if (hashBytes(payload, size) != checksum) {
+            break;
+        }
+        records.emplace_back(payload, size);
+        offset += RECORD_HEADER_SIZE + size;
+    }
+    if (offset != bytes.size()) {
+        Logger::warn("Ignoring {} bytes of a torn record at the end of {}", bytes.size() - offset, path_.string());
+    }
+    return records;
+}
+
+WriteAheadLog::Lsn WriteAheadLog::append(std::string_view payload) {
+    auto size = static_cast<uint32_t>(payload.size());
+    uint64_t checksum = hashBytes(payload.data(), payload.size());
+
+    std::lock_guard lock(mutex_);
+    buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    buffer_.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    buffer_.append(payload);
+    return nextLsn_++;
+}
+
+bool WriteAheadLog::commit(Lsn lsn) {
+    walCommits().increment();
+    bool sync = options_.syncPolicy == WalSyncPolicy::FSYNC;
+    std::unique_lock lock(mutex_);
+    while (!failed_ && (sync ? syncedLsn_ : writtenLsn_) < lsn) {
+        if (writing_) {
+            progress_.wait(lock);
+        } else {
+            writeBuffered(lock, sync);
+        }
+    }
+    return (sync ? syncedLsn_ : writtenLsn_) >= lsn;
+}
+
+void WriteAheadLog::writeBuffered(std::unique_lock<std::mutex>& lock, bool sync) {
+    writing_ = true;
+    std::string bytes = std::move(buffer_);
+    buffer_.clear();
+    Lsn last = nextLsn_ - 1;
+
+    lock.unlock();
+    if (sync && options_.beforeSync) {
+        options_.beforeSync();
+    }
+    bool written = writeAll(bytes) && (!sync || fdatasync(fd_) == 0);
+    lock.lock();
+
+    writing_ = false;
+    if (!written) {
+        Logger::error("Failed to write write-ahead log {}: {}", path_.string(), std::strerror(errno));
+        failed_ = true;
+    } else {
+        writtenLsn_ = last;
+        size_ += bytes.size();
+        if (sync) {
+            syncedLsn_ = last;
+            ++syncCount_;
+            walSyncs().increment();
+        }
+    }
+    progress_.notify_all();
+}
+
+bool WriteAheadLog::writeAll(std::string_view bytes) const {
+    while (!bytes.empty()) {
+        ssize_t written = write(fd_, bytes.data(), bytes.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+void WriteAheadLog::runSyncThread() {
+    std::unique_lock lock(mutex_);
+    while (!stopping_) {
+        progress_.wait_for(lock, options_.syncInterval, [this] { return stopping_; });
+        if (stopping_ || failed_ || syncedLsn_ == writtenLsn_) {
+            continue;
+        }
+
+        // Records written from now on are synced in the next round
+        Lsn written = writtenLsn_;
+        lock.unlock();
+        bool synced = fdatasync(fd_) == 0;
+        lock.lock();
+
+        if (!synced) {
+            Logger::error("Failed to sync write-ahead log {}: {}", path_.string(), std::strerror(errno));
+            failed_ = true;
+        } else {
+            syncedLsn_ = std::max(syncedLsn_, written);
+            ++syncCount_;
+            walSyncs().increment();
+        }
+    }
+}
+
+bool WriteAheadLog::truncate() {
+    std::unique_lock lock(mutex_);
+    progress_.wait(lock, [this] { return !writing_; });
+    if (ftruncate(fd_, 0) != 0 || fdatasync(fd_) != 0) {
+        Logger::error("Failed to truncate write-ahead log {}: {}", path_.string(), std::strerror(errno));
+        return false;
+    }
+    size_ = 0;
+    return true;
+}
+
+size_t WriteAheadLog::getSize() const {
+    std::lock_guard lock(mutex_);
+    return size_;
+}
+
+uint64_t WriteAheadLog::getSyncCount() const {
+    std::lock_guard lock(mutex_);
+    return syncCount_;
+}
+
+}  // namespace toydb
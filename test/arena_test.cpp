@@ -0,0 +1,52 @@
+#include <string>
+#include <vector>
+#include "common/arena.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+
+TEST(ArenaTest, AllocatesAligned) {
+    Arena arena;
+    auto* c = arena.make<char>('a');
+    auto* d = arena.make<double>(1.5);
+    auto* i = arena.make<int64_t>(42);
+
+    EXPECT_EQ(*c, 'a');
+    EXPECT_EQ(*d, 1.5);
+    EXPECT_EQ(*i, 42);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(i) % alignof(int64_t), 0u);
+    EXPECT_EQ(arena.getBlockCount(), 1u);
+}
+
+// Test that objects larger than a block get their own block
+TEST(ArenaTest, LargeObjects) {
+    Arena arena;
+    arena.make<int>(1);
+    auto* large = static_cast<char*>(arena.allocate(10000, 8));
+    large[9999] = 'x';
+    EXPECT_EQ(arena.getBlockCount(), 2u);
+
+    // The large block is full, small objects start a new one
+    arena.make<int>(2);
+    EXPECT_EQ(arena.getBlockCount(), 3u);
+}
+
+TEST(ArenaTest, DestroysObjectsInReverseOrder) {
+    std::vector<int> destroyed;
+    struct Tracked {
+        std::vector<int>* destroyed;
+        int id;
+        ~Tracked() {
+            destroyed->push_back(id);
+        }
+    };
+
+    {
+        Arena arena;
+        arena.make<Tracked>(&destroyed, 1);
+        arena.make<std::string>("a string that is too long for the small string buffer");
+        arena.make<Tracked>(&destroyed, 2);
+    }
+    EXPECT_EQ(destroyed, (std::vector<int> {2, 1}));
+}
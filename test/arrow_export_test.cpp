@@ -0,0 +1,97 @@
+#include <arrow/api.h>
+#include <filesystem>
+#include <memory>
+#include "engine/arrow_export.hpp"
+#include "engine/predicate_result.hpp"
+#include "gtest/gtest.h"
+#include "planner/physical_planner.hpp"
+#include "planner/prepared_statement.hpp"
+#include "storage/catalog.hpp"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+namespace fs = std::filesystem;
+
+class ArrowExportTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage_;
+    // Row 2 of the id column is NULL
+    uint8_t idValidity_[1] = {0b11111011};
+
+    RowVector makeBatch() {
+        RowVector batch;
+        ColumnBuffer id = storage_.createIntColumn({10, 20, 30, 40}, 1, "id");
+        id = ColumnBuffer(id.columnId, id.type, const_cast<void*>(id.getData()), 4, NullBitmap(idValidity_, 4));
+        id.count = 4;
+        batch.addColumn(id);
+        batch.addColumn(storage_.createStringColumn({"a", "b", "c", "d"}, 2, "name"));
+        batch.setRowCount(4);
+        return batch;
+    }
+};
+
+// Test that fixed-width columns point at the batch's values and validity bitmap
+TEST_F(ArrowExportTest, WrapsFixedWidthColumns) {
+    RowVector batch = makeBatch();
+    auto schema = toArrowSchema(*batch.getSchema());
+    ASSERT_EQ(schema->num_fields(), 2);
+    EXPECT_EQ(schema->field(0)->name(), "id");
+    EXPECT_TRUE(schema->field(0)->type()->Equals(arrow::int64()));
+    EXPECT_TRUE(schema->field(1)->type()->Equals(arrow::utf8()));
+
+    auto recordBatch = toRecordBatch(schema, batch, ArrowBufferMode::WRAP);
+    ASSERT_TRUE(recordBatch->ValidateFull().ok());
+    const auto& ids = static_cast<const arrow::Int64Array&>(*recordBatch->column(0));
+    EXPECT_EQ(ids.values()->data(), batch.getColumn(0).getData());
+    EXPECT_EQ(ids.null_bitmap_data(), idValidity_);
+    EXPECT_EQ(ids.Value(1), 20);
+    EXPECT_TRUE(ids.IsNull(2));
+    EXPECT_EQ(ids.null_count(), 1);
+
+    const auto& names = static_cast<const arrow::StringArray&>(*recordBatch->column(1));
+    EXPECT_EQ(names.GetView(3), "d");
+}
+
+TEST_F(ArrowExportTest, CopiesFixedWidthColumns) {
+    RowVector batch = makeBatch();
+    auto recordBatch = toRecordBatch(toArrowSchema(*batch.getSchema()), batch, ArrowBufferMode::COPY);
+    const auto& ids = static_cast<const arrow::Int64Array&>(*recordBatch->column(0));
+    EXPECT_NE(ids.values()->data(), batch.getColumn(0).getData());
+    EXPECT_EQ(ids.Value(3), 40);
+    EXPECT_TRUE(ids.IsNull(2));
+}
+
+// Test that only the selected rows are converted
+TEST_F(ArrowExportTest, BuildsSelectedRows) {
+    RowVector batch = makeBatch();
+    PredicateResultVector selection(4);
+    selection.setTrue(2);
+    selection.setTrue(3);
+    batch.setSelection(&selection);
+
+    auto recordBatch = toRecordBatch(toArrowSchema(*batch.getSchema()), batch, ArrowBufferMode::WRAP);
+    ASSERT_EQ(recordBatch->num_rows(), 2);
+    const auto& ids = static_cast<const arrow::Int64Array&>(*recordBatch->column(0));
+    EXPECT_TRUE(ids.IsNull(0));
+    EXPECT_EQ(ids.Value(1), 40);
+    EXPECT_EQ(static_cast<const arrow::StringArray&>(*recordBatch->column(1)).GetView(0), "c");
+}
+
+TEST_F(ArrowExportTest, ReadsPlan) {
+    JsonCatalog catalog(fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json");
+    PlanCache cache(&catalog);
+    auto statement = cache.prepare("SELECT id, user_id FROM orders WHERE id > 4");
+    ASSERT_TRUE(statement.has_value());
+    PhysicalPlanner planner(&catalog, 2);
+
+    auto reader = makeRecordBatchReader(statement->createPlan(planner));
+    ASSERT_EQ(reader->schema()->num_fields(), 2);
+    auto table = reader->ToTable();
+    ASSERT_TRUE(table.ok()) << table.status().ToString();
+    EXPECT_EQ((*table)->num_rows(), 6);
+
+    // Batches stay valid after the plan moved on
+    auto ids = std::static_pointer_cast<arrow::Int64Array>((*table)->column(0)->chunk(0));
+    EXPECT_EQ(ids->Value(0), 5);
+}
@@ -0,0 +1,88 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "storage/async_io.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class AsyncIoTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path path_;
+    std::string content_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "async_io_test";
+        fs::create_directories(tempDir_);
+
+        // Not a multiple of the block size, so the last block is short
+        for (int i = 0; content_.size() < 50000; ++i) {
+            content_ += "line " + std::to_string(i) + "\n";
+        }
+        path_ = tempDir_ / "data.txt";
+        std::ofstream(path_, std::ios::binary) << content_;
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    // Read the file from offset and compare with its content
+    void checkRead(IoBackend backend, uint64_t offset) {
+        AsyncIoOptions options;
+        options.blockSize = 4096;
+        options.depth = 3;
+        options.backend = backend;
+        AsyncFileReader reader(path_, offset, options);
+        ASSERT_TRUE(reader.isOpen());
+        EXPECT_EQ(reader.getFileSize(), content_.size());
+
+        std::string read;
+        size_t blocks = 0;
+        for (std::string_view block = reader.next(); !block.empty(); block = reader.next()) {
+            EXPECT_LE(block.size(), 4096u);
+            read.append(block);
+            ++blocks;
+        }
+        EXPECT_FALSE(reader.hasFailed());
+        EXPECT_EQ(blocks, (content_.size() - offset + 4095) / 4096);
+        EXPECT_EQ(read, content_.substr(offset));
+        // The end stays the end
+        EXPECT_TRUE(reader.next().empty());
+    }
+};
+
+// Test that the thread pool backend returns the blocks of the file in order
+TEST_F(AsyncIoTest, ThreadPool) {
+    checkRead(IoBackend::THREAD_POOL, 0);
+    checkRead(IoBackend::THREAD_POOL, 1234);
+}
+
+// Test that the io_uring backend returns the blocks of the file in order, where the kernel allows io_uring
+TEST_F(AsyncIoTest, IoUring) {
+    if (!IoQueue::create(4, IoBackend::IO_URING)) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    checkRead(IoBackend::IO_URING, 0);
+    checkRead(IoBackend::IO_URING, 1234);
+    EXPECT_EQ(AsyncFileReader(path_, 0, {4096, 2, IoBackend::IO_URING}).getBackend(), IoBackend::IO_URING);
+}
+
+// Test that reading past the end or a missing file returns no blocks
+TEST_F(AsyncIoTest, EndAndMissingFile) {
+    AsyncFileReader pastEnd(path_, content_.size() + 10);
+    EXPECT_TRUE(pastEnd.next().empty());
+    EXPECT_FALSE(pastEnd.hasFailed());
+
+    // A reader destroyed with reads in flight waits for them
+    {
+        AsyncFileReader abandoned(path_, 0, {1024, 8, IoBackend::AUTO});
+        EXPECT_FALSE(abandoned.next().empty());
+    }
+
+    AsyncFileReader missing(tempDir_ / "missing.txt", 0);
+    EXPECT_FALSE(missing.isOpen());
+    EXPECT_TRUE(missing.next().empty());
+}
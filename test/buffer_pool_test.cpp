@@ -0,0 +1,134 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "common/errors.hpp"
+#include "engine/buffer_pool.hpp"
+#include "engine/memory.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+using namespace toydb::memory;
+
+class BufferPoolTest : public ::testing::Test {
+protected:
+    static constexpr size_t KB = 1024;
+};
+
+// Test that requests are rounded up to the next size class
+TEST_F(BufferPoolTest, SizeClasses) {
+    EXPECT_EQ(BufferPool::getSizeClass(1), 0u);
+    EXPECT_EQ(BufferPool::getSizeClass(64 * KB), 0u);
+    EXPECT_EQ(BufferPool::getSizeClass(64 * KB + 1), 1u);
+    EXPECT_EQ(BufferPool::getSizeClass(BufferPool::MAX_BUFFER_SIZE), BufferPool::SIZE_CLASS_COUNT - 1);
+
+    BufferPool pool(16 * 1024 * KB);
+    BufferPool::Buffer buffer = pool.allocate(100 * KB);
+    EXPECT_EQ(buffer.size(), 128 * KB);
+    std::memset(buffer.data, 1, buffer.size());
+    EXPECT_EQ(pool.getUsedBytes(), 128 * KB);
+    pool.release(buffer);
+    EXPECT_EQ(pool.getUsedBytes(), 0u);
+}
+
+// Test that released buffers are reused and only returned to the OS by trim
+TEST_F(BufferPoolTest, ReuseAndTrim) {
+    BufferPool pool(16 * 1024 * KB);
+    BufferPool::Buffer first = pool.allocate();
+    void* data = first.data;
+    pool.release(first);
+
+    BufferPool::Buffer second = pool.allocate();
+    EXPECT_EQ(second.data, data);
+    pool.release(second);
+
+    EXPECT_EQ(pool.getReservedBytes(), 64 * KB);
+    pool.trim();
+    EXPECT_EQ(pool.getReservedBytes(), 0u);
+}
+
+// Test that the pool never maps more than its budget, frees cached buffers to stay within it,
+// and reports pressure close to it
+TEST_F(BufferPoolTest, MemoryBudget) {
+    BufferPool pool(1024 * KB);
+
+    // Cached buffers of another size class make room for new ones
+    std::vector<BufferPool::Buffer> large;
+    for (int i = 0; i < 8; ++i) {
+        large.push_back(pool.allocate(128 * KB));
+    }
+    for (const BufferPool::Buffer& buffer : large) {
+        pool.release(buffer);
+    }
+
+    std::vector<BufferPool::Buffer> buffers;
+    for (int i = 0; i < 16; ++i) {
+        buffers.push_back(pool.allocate());
+    }
+    EXPECT_LE(pool.getReservedBytes(), pool.getMemoryBudget());
+    EXPECT_TRUE(pool.isUnderPressure());
+
+    EXPECT_FALSE(pool.tryAllocate().has_value());
+    EXPECT_THROW(pool.allocate(), MemoryBudgetExceededError);
+
+    pool.release(buffers.back());
+    buffers.pop_back();
+    buffers.push_back(pool.allocate());
+
+    for (const BufferPool::Buffer& buffer : buffers) {
+        pool.release(buffer);
+    }
+    EXPECT_FALSE(pool.isUnderPressure());
+}
+
+// Test that the buffer manager tracks the bytes it holds and asks to spill under pressure
+TEST_F(BufferPoolTest, BufferManager) {
+    BufferPool pool(32 * 1024 * KB);
+    BufferManager manager(&pool);
+    {
+        auto small = manager.allocate();
+        auto large = manager.allocate(BufferPool::MAX_BUFFER_SIZE);
+        EXPECT_EQ(small.size(), 64 * KB);
+        EXPECT_EQ(manager.getAllocatedBytes(), 64 * KB + BufferPool::MAX_BUFFER_SIZE);
+        EXPECT_FALSE(manager.shouldSpill(manager.getAllocatedBytes(), 256 * 1024 * KB));
+        EXPECT_TRUE(manager.shouldSpill(manager.getAllocatedBytes(), 1024 * KB));
+
+        std::vector<BufferManager::BufferHandle> handles;
+        while (auto handle = manager.tryAllocate()) {
+            handles.push_back(std::move(*handle));
+        }
+        EXPECT_TRUE(manager.isUnderPressure());
+        EXPECT_TRUE(manager.shouldSpill(manager.getAllocatedBytes(), 256 * 1024 * KB));
+    }
+    EXPECT_EQ(manager.getAllocatedBytes(), 0u);
+    EXPECT_EQ(pool.getUsedBytes(), 0u);
+}
+
+// Test that threads allocating and releasing concurrently keep the accounting consistent
+TEST_F(BufferPoolTest, ConcurrentAllocations) {
+    BufferPool pool(64 * 1024 * KB);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&pool, t] {
+            std::vector<BufferPool::Buffer> held;
+            for (int i = 0; i < 1000; ++i) {
+                held.push_back(pool.allocate(static_cast<size_t>((i + t) % 4 + 1) * 64 * KB));
+                static_cast<char*>(held.back().data)[0] = static_cast<char>(i);
+                if (held.size() > 4) {
+                    pool.release(held.front());
+                    held.erase(held.begin());
+                }
+            }
+            for (const BufferPool::Buffer& buffer : held) {
+                pool.release(buffer);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(pool.getUsedBytes(), 0u);
+    EXPECT_LE(pool.getReservedBytes(), pool.getMemoryBudget());
+    pool.trim();
+    EXPECT_EQ(pool.getReservedBytes(), 0u);
+}
@@ -1,10 +1,14 @@
 #include "storage/catalog.hpp"
 #include "storage/csv_data_file_reader.hpp"
+#include "storage/table_handle.hpp"
 #include "engine/physical_operator.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/pipeline_executor.hpp"
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <set>
 #include <vector>
 
 using namespace toydb;
@@ -160,7 +164,7 @@ protected:
                 EXPECT_TRUE(col.isNull(rowIndex)) << "Row " << rowIndex << " column " << col.columnId.getName() << " should be NULL";
             } else {
                 EXPECT_FALSE(col.isNull(rowIndex)) << "Row " << rowIndex << " column " << col.columnId.getName() << " should not be NULL";
-                EXPECT_STREQ(col.getEntry<db_string>(rowIndex), expectedValue.c_str())
+                EXPECT_EQ(col.getEntry<db_string>(rowIndex).view(), expectedValue)
                     << "Row " << rowIndex << " column " << col.columnId.getName() << " value mismatch";
             }
         };
@@ -506,6 +510,305 @@ TEST_F(CatalogTest, CsvReaderBatchReading) {
     EXPECT_GT(batchCount, 1);  // Should require multiple batches
 }
 
+// Test quoted fields, CRLF line endings, long strings and invalid numbers
+TEST_F(CatalogTest, CsvReaderQuotedFieldsAndLineEndings) {
+    std::string longName(300, 'x');
+    fs::path csvPath = createTempCSV(
+        "id,name,score\r\n"
+        "1,\"Doe, Jane\",1.5\r\n"
+        "\r\n"
+        "2,\"say \"\"hi\"\"\",-2e3\r\n"
+        "+3," + longName + ",abc\n"
+        "4,a\"b,c\",7");
+
+    TableId tableId(1, "test");
+    ColumnId idCol(1, "id", tableId);
+    ColumnId nameCol(2, "name", tableId);
+    ColumnId scoreCol(3, "score", tableId);
+
+    std::vector<ColumnId> columnIds = {idCol, nameCol, scoreCol};
+    std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById;
+    columnsById[idCol] = ColumnMetadata{"id", DataType::getInt32(), false};
+    columnsById[nameCol] = ColumnMetadata{"name", DataType::getString(), false};
+    columnsById[scoreCol] = ColumnMetadata{"score", DataType::getDouble(), true};
+
+    Schema schema(std::move(columnIds), std::move(columnsById));
+
+    CsvDataFileReader reader(csvPath, schema, tableId);
+
+    RowVector rowVec = createRowVectorForSchema(schema, 10);
+    int64_t rowsRead = reader.readBatch(rowVec, 10);
+    ASSERT_EQ(rowsRead, 4);
+    EXPECT_FALSE(reader.hasMore());
+
+    const ColumnBuffer& ids = rowVec.getColumn(0);
+    const ColumnBuffer& names = rowVec.getColumn(1);
+    const ColumnBuffer& scores = rowVec.getColumn(2);
+
+    EXPECT_EQ(ids.getEntry<db_int32>(2), 3);
+    EXPECT_EQ(names.getEntry<db_string>(0).view(), "Doe, Jane");
+    EXPECT_EQ(names.getEntry<db_string>(1).view(), "say hi");
+    EXPECT_EQ(names.getEntry<db_string>(2).view(), longName);
+    EXPECT_EQ(names.getEntry<db_string>(3).view(), "ab,c");
+
+    EXPECT_DOUBLE_EQ(scores.getEntry<db_double>(0), 1.5);
+    EXPECT_DOUBLE_EQ(scores.getEntry<db_double>(1), -2000.0);
+    EXPECT_TRUE(scores.isNull(2));  // Invalid numbers are read as NULL
+    EXPECT_DOUBLE_EQ(scores.getEntry<db_double>(3), 7.0);
+}
+
+// Test that the CSV reader only parses projected columns and skips rows failing a pushed down predicate
+TEST_F(CatalogTest, CsvReaderProjectionAndPredicate) {
+    fs::path csvPath = testDataDir_ / "users.csv";
+    Schema schema = buildUsersSchema();
+    TableId tableId(11699830787864871553ULL, "users");
+    ColumnId nameCol = schema.getColumnIds()[1];
+    ColumnId ageCol = schema.getColumnIds()[3];
+
+    CsvDataFileReader reader(csvPath, schema, tableId);
+    reader.setProjection({ageCol, nameCol});
+
+    CompareExpr predicate(CompareOp::GREATER, DataType::getInt32(),
+                          std::make_unique<ColumnRefExpr>(ageCol, DataType::getInt32()),
+                          std::make_unique<ConstantExpr>(DataType::getInt32(), int64_t{30}));
+    predicate.initializeIndexMap();
+    reader.setPredicate(&predicate);
+
+    Schema projected;
+    projected.addColumn(ageCol, *schema.getColumn(ageCol));
+    projected.addColumn(nameCol, *schema.getColumn(nameCol));
+    RowVector rowVec = createRowVectorForSchema(projected, 10);
+
+    int64_t rowsRead = reader.readBatch(rowVec, 10);
+    ASSERT_EQ(rowsRead, 6);
+    EXPECT_FALSE(reader.hasMore());
+
+    verifyRowData(rowVec, 0, {
+        {"age", makeInt32Verifier(0, 35)},
+        {"name", makeStringVerifier(0, "Bob Smith")}
+    });
+    verifyRowData(rowVec, 5, {
+        {"age", makeInt32Verifier(5, 33)},
+        {"name", makeStringVerifier(5, "Jane Doe")}
+    });
+}
+
+// Helper for the parallel scan tests: a CSV file with rows "id,note" where every 7th note contains a quoted line break
+static Schema buildNotesSchema(TableId tableId) {
+    ColumnId idCol(1, "id", tableId);
+    ColumnId noteCol(2, "note", tableId);
+
+    std::vector<ColumnId> columnIds = {idCol, noteCol};
+    std::unordered_map<ColumnId, ColumnMetadata, ColumnIdHash> columnsById;
+    columnsById[idCol] = ColumnMetadata{"id", DataType::getInt64(), false};
+    columnsById[noteCol] = ColumnMetadata{"note", DataType::getString(), false};
+    return Schema(std::move(columnIds), std::move(columnsById));
+}
+
+static std::string buildNotesCSV(int64_t rowCount) {
+    std::string content = "id,note\n";
+    for (int64_t i = 0; i < rowCount; ++i) {
+        content += std::to_string(i) + (i % 7 == 0 ? ",\"line one\nline two\"\n" : ",plain note\n");
+    }
+    return content;
+}
+
+// Test that byte ranges start at line boundaries, also around quoted line breaks
+TEST_F(CatalogTest, CsvReaderSplitRanges) {
+    const int64_t rowCount = 5000;
+    fs::path csvPath = createTempCSV(buildNotesCSV(rowCount));
+    TableId tableId(1, "notes");
+    Schema schema = buildNotesSchema(tableId);
+
+    CsvDataFileReader reader(csvPath, schema, tableId);
+    std::vector<CsvByteRange> ranges = reader.splitRanges(16);
+    ASSERT_GT(ranges.size(), 1u);
+    EXPECT_LE(ranges.size(), 16u);
+    EXPECT_EQ(ranges.back().end, fs::file_size(csvPath));
+
+    int64_t totalRows = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (i > 0) {
+            EXPECT_EQ(ranges[i].begin, ranges[i - 1].end);
+        }
+
+        CsvDataFileReader rangeReader(csvPath, schema, tableId, ranges[i]);
+        RowVector rowVec = createRowVectorForSchema(schema, 1000);
+        while (int64_t rowsRead = rangeReader.readBatch(rowVec, 1000)) {
+            const ColumnBuffer& ids = rowVec.getColumn(0);
+            const ColumnBuffer& notes = rowVec.getColumn(1);
+            for (int64_t row = 0; row < rowsRead; ++row) {
+                int64_t id = ids.getEntry<db_int64>(row);
+                EXPECT_EQ(notes.getEntry<db_string>(row).view(), id % 7 == 0 ? "line one\nline two" : "plain note");
+            }
+            totalRows += rowsRead;
+        }
+    }
+    EXPECT_EQ(totalRows, rowCount);
+}
+
+// Test that a selective predicate is evaluated on chunks of lines and only the passing rows are materialized
+TEST_F(CatalogTest, CsvReaderLateMaterialization) {
+    const int64_t rowCount = 5000;
+    fs::path csvPath = createTempCSV(buildNotesCSV(rowCount));
+    TableId tableId(1, "notes");
+    Schema schema = buildNotesSchema(tableId);
+    ColumnId idCol = schema.getColumnIds()[0];
+    ColumnId noteCol = schema.getColumnIds()[1];
+
+    // note = 'line one\nline two' OR id >= 4990, the notes are quoted
+    LogicalExpr predicate(CompareOp::OR,
+        std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getString(),
+            std::make_unique<ColumnRefExpr>(noteCol, DataType::getString()),
+            std::make_unique<ConstantExpr>(DataType::getString(), std::string("line one\nline two"))),
+        std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{4990})));
+    predicate.initializeIndexMap();
+
+    CsvDataFileReader reader(csvPath, schema, tableId);
+    reader.setPredicate(&predicate);
+
+    std::vector<int64_t> ids;
+    RowVector rowVec = createRowVectorForSchema(schema, 64);
+    while (int64_t rowsRead = reader.readBatch(rowVec, 64)) {
+        EXPECT_TRUE(rowsRead == 64 || !reader.hasMore());
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            int64_t id = rowVec.getColumn(0).getEntry<db_int64>(row);
+            EXPECT_EQ(rowVec.getColumn(1).getEntry<db_string>(row).view(), id % 7 == 0 ? "line one\nline two" : "plain note");
+            ids.push_back(id);
+        }
+    }
+
+    std::vector<int64_t> expected;
+    for (int64_t id = 0; id < rowCount; ++id) {
+        if (id % 7 == 0 || id >= 4990) {
+            expected.push_back(id);
+        }
+    }
+    EXPECT_EQ(ids, expected);
+}
+
+// Test that ranges read with asynchronous block reads return the same rows as from the mapping, with lines and quoted line breaks crossing blocks
+TEST_F(CatalogTest, CsvReaderAsyncIo) {
+    const int64_t rowCount = 5000;
+    fs::path csvPath = createTempCSV(buildNotesCSV(rowCount));
+    TableId tableId(1, "notes");
+    Schema schema = buildNotesSchema(tableId);
+    ColumnId idCol = schema.getColumnIds()[0];
+
+    // Blocks much smaller than a batch, so the window grows while a batch is read
+    AsyncIoOptions options;
+    options.blockSize = 256;
+    options.depth = 3;
+    options.backend = IoBackend::THREAD_POOL;
+
+    CsvDataFileReader planner(csvPath, schema, tableId);
+    std::vector<int64_t> ids;
+    for (const CsvByteRange& range : planner.splitRanges(4)) {
+        CsvDataFileReader reader(csvPath, schema, tableId, range);
+        reader.setAsyncIo(options);
+        RowVector rowVec = createRowVectorForSchema(schema, 1000);
+        while (int64_t rowsRead = reader.readBatch(rowVec, 1000)) {
+            for (int64_t row = 0; row < rowsRead; ++row) {
+                int64_t id = rowVec.getColumn(0).getEntry<db_int64>(row);
+                EXPECT_EQ(rowVec.getColumn(1).getEntry<db_string>(row).view(),
+                          id % 7 == 0 ? "line one\nline two" : "plain note");
+                ids.push_back(id);
+            }
+        }
+    }
+    ASSERT_EQ(ids.size(), static_cast<size_t>(rowCount));
+    for (int64_t id = 0; id < rowCount; ++id) {
+        EXPECT_EQ(ids[static_cast<size_t>(id)], id);
+    }
+
+    // Lines of a chunk stay valid while later lines extend the window
+    CompareExpr predicate(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                          std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                          std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{4000}));
+    predicate.initializeIndexMap();
+    CsvDataFileReader reader(csvPath, schema, tableId);
+    reader.setPredicate(&predicate);
+    reader.setAsyncIo(options);
+    int64_t passed = 0;
+    RowVector rowVec = createRowVectorForSchema(schema, 500);
+    while (int64_t rowsRead = reader.readBatch(rowVec, 500)) {
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            EXPECT_EQ(rowVec.getColumn(0).getEntry<db_int64>(row), 4000 + passed++);
+        }
+    }
+    EXPECT_EQ(passed, 1000);
+
+    // Reset reads the blocks again
+    reader.reset();
+    EXPECT_EQ(reader.readBatch(rowVec, 500), 500);
+    EXPECT_EQ(rowVec.getColumn(0).getEntry<db_int64>(0), 4000);
+}
+
+// Collect the ids of all rows returned by a table iterator, checking the notes written by buildNotesCSV
+static std::set<int64_t> collectNoteIds(TableIterator& iterator) {
+    std::set<int64_t> ids;
+    RowVector batch;
+    while (int64_t rowsRead = iterator.next(batch)) {
+        EXPECT_EQ(batch.getColumnCount(), 2);
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            int64_t id = batch.getColumn(0).getEntry<db_int64>(row);
+            EXPECT_TRUE(ids.insert(id).second) << "Row " << id << " returned twice";
+            EXPECT_EQ(batch.getColumn(1).getEntry<db_string>(row).view(),
+                      id % 7 == 0 ? "line one\nline two" : "plain note");
+        }
+    }
+    return ids;
+}
+
+// Test that a single large CSV file is split into ranges read in parallel, returning every row exactly once
+TEST_F(CatalogTest, ParallelCsvScan) {
+    const int64_t rowCount = 20000;
+    fs::path csvPath = createTempCSV(buildNotesCSV(rowCount));
+
+    TableHandle handle(TableId(1, "notes"), StorageFormat::CSV, buildNotesSchema(TableId(1, "notes")), {FileEntry{csvPath, std::nullopt}});
+    EXPECT_GT(handle.planScanUnits(4).size(), 1u);
+
+    auto iterator = handle.createIterator(1024, 4);
+    std::set<int64_t> ids = collectNoteIds(*iterator);
+    EXPECT_EQ(static_cast<int64_t>(ids.size()), rowCount);
+    EXPECT_FALSE(iterator->hasMore());
+
+    // Reset starts over
+    iterator->reset();
+    EXPECT_EQ(static_cast<int64_t>(collectNoteIds(*iterator).size()), rowCount);
+}
+
+// Test that tables with several files are weighted by row count and read completely
+TEST_F(CatalogTest, MultiFileTable) {
+    std::vector<FileEntry> files;
+    std::vector<int64_t> rowCounts = {10, 300, 2000};
+    for (size_t i = 0; i < rowCounts.size(); ++i) {
+        fs::path path = tempDir_ / ("part" + std::to_string(i) + ".csv");
+        std::string content = "id,note\n";
+        for (int64_t row = 0; row < rowCounts[i]; ++row) {
+            int64_t id = static_cast<int64_t>(i) * 10000 + row;
+            content += std::to_string(id) + (id % 7 == 0 ? ",\"line one\nline two\"\n" : ",plain note\n");
+        }
+        std::ofstream(path) << content;
+        files.push_back({path, rowCounts[i]});
+    }
+
+    TableHandle handle(TableId(1, "notes"), StorageFormat::CSV, buildNotesSchema(TableId(1, "notes")), files);
+
+    // Files smaller than the minimum range size are not split
+    std::vector<ScanUnit> units = handle.planScanUnits(0);
+    ASSERT_EQ(units.size(), 3u);
+    EXPECT_EQ(units[2].weight, 2000);
+    EXPECT_FALSE(units[0].range.has_value());
+
+    auto iterator = handle.createIterator(256, 2);
+    std::set<int64_t> ids = collectNoteIds(*iterator);
+    EXPECT_EQ(ids.size(), 2310u);
+    EXPECT_TRUE(ids.contains(20000 + 1999));
+}
+
 TEST_F(CatalogTest, EmptyManifest) {
     fs::path emptyManifest = createTempManifest("{}");
     JsonCatalogManifest manifest(emptyManifest);
@@ -555,3 +858,141 @@ TEST_F(CatalogTest, NonExistentCSV) {
     int64_t rowsRead = reader.readBatch(rowVec, 10);
     EXPECT_EQ(rowsRead, 0);
 }
+
+// Test that a table scan feeds a morsel-driven pipeline without copying its batches
+TEST_F(CatalogTest, TableScanAsMorselSource) {
+    const int64_t rowCount = 20000;
+    fs::path csvPath = createTempCSV(buildNotesCSV(rowCount));
+    TableHandle handle(TableId(1, "notes"), StorageFormat::CSV, buildNotesSchema(TableId(1, "notes")), {FileEntry{csvPath, std::nullopt}});
+
+    auto scan = handle.createScan(2048, 2);
+    memory::BufferManager bufferManager;
+    MaterializeSink sink(&bufferManager);
+
+    Pipeline pipeline;
+    pipeline.source = scan.get();
+    pipeline.sink = &sink;
+    PipelineExecutor executor(4, 512);
+    executor.run(pipeline);
+
+    // The sink copied the long strings, they outlive the scan batches
+    scan.reset();
+    std::set<int64_t> ids;
+    for (const MaterializedInput* part : sink.getParts()) {
+        for (size_t c = 0; c < part->getChunkCount(); ++c) {
+            const RowVector& chunk = part->getChunk(c);
+            for (int64_t row = 0; row < chunk.getRowCount(); ++row) {
+                int64_t id = chunk.getColumn(0).getEntry<db_int64>(row);
+                EXPECT_TRUE(ids.insert(id).second);
+                EXPECT_EQ(chunk.getColumn(1).getEntry<db_string>(row).view(),
+                          id % 7 == 0 ? "line one\nline two" : "plain note");
+            }
+        }
+    }
+    EXPECT_EQ(static_cast<int64_t>(ids.size()), rowCount);
+}
+
+// Test that ANALYZE records exact row counts and per-file statistics that survive reloading the manifest and prune files
+TEST_F(CatalogTest, AnalyzeTablePersistsStatistics) {
+    std::string files;
+    for (int64_t part = 0; part < 3; ++part) {
+        std::string content = "id,note\n";
+        for (int64_t row = 0; row < 100; ++row) {
+            content += std::to_string(part * 1000 + row) + ",plain note\n";
+        }
+        std::ofstream(tempDir_ / ("part" + std::to_string(part) + ".csv")) << content;
+        files += std::string(part > 0 ? "," : "") + "{\"path\": \"part" + std::to_string(part) + ".csv\"}";
+    }
+    fs::path manifestPath = createTempManifest(R"({
+        "generated_at": "2026-01-12T00:00:00Z",
+        "tables": [{
+            "name": "notes", "id": 7, "id_name": "notes", "format": "csv",
+            "schema": [
+                {"name": "id", "type": "INT64", "nullable": false},
+                {"name": "note", "type": "STRING", "nullable": false}
+            ],
+            "files": [)" + files + R"(]
+        }]
+    })");
+
+    TableId tableId;
+    {
+        JsonCatalog catalog(manifestPath);
+        tableId = *catalog.getTableIdByName("notes");
+        EXPECT_FALSE(catalog.getRowCount(tableId).has_value());
+        ASSERT_TRUE(catalog.analyzeTable(tableId).has_value());
+        EXPECT_EQ(catalog.getRowCount(tableId), 300);
+    }
+
+    JsonCatalog catalog(manifestPath);
+    EXPECT_EQ(catalog.getRowCount(tableId), 300);
+    ColumnId idCol = *catalog.resolveColumn(tableId, "id");
+    auto stats = catalog.getColumnStatistics(idCol);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->intMin, 0);
+    EXPECT_EQ(stats->intMax, 2099);
+    EXPECT_NEAR(static_cast<double>(*stats->distinctCount), 300.0, 30.0);
+    EXPECT_FALSE(stats->histogram.empty());
+
+    // Fields the catalog doesn't know are kept when the manifest is rewritten
+    json root;
+    std::ifstream(manifestPath) >> root;
+    EXPECT_EQ(root.at("generated_at"), "2026-01-12T00:00:00Z");
+    EXPECT_EQ(root.at("tables")[0].at("files")[1].at("stats").at("id").at("min"), 1000);
+
+    auto handle = catalog.getTableHandle(tableId);
+    ASSERT_TRUE(handle.has_value());
+    CompareExpr predicate(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+        std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), 2000L));
+    std::vector<ScanUnit> units = (*handle)->planScanUnits(1, &predicate);
+    ASSERT_EQ(units.size(), 1u);
+    EXPECT_EQ(units[0].path.filename(), "part2.csv");
+    EXPECT_EQ((*handle)->planScanUnits(1).size(), 3u);
+}
+
+// Test that reloading the manifest only replaces the metadata of the tables that changed on disk
+TEST_F(CatalogTest, ReloadReplacesChangedTables) {
+    auto manifest = [](const std::string& ordersFiles, bool withItems) {
+        return R"({"tables": [{
+            "name": "users", "id": 1, "id_name": "users", "format": "csv",
+            "schema": [{"name": "id", "type": "INT64"}],
+            "files": [{"path": "users.csv", "row_count": 10}]
+        }, {
+            "name": "orders", "id": 2, "id_name": "orders", "format": "csv",
+            "schema": [{"name": "id", "type": "INT64"}],
+            "files": [)" + ordersFiles + R"(]
+        })" + std::string(withItems ? R"(, {
+            "name": "items", "id": 3, "id_name": "items", "format": "csv",
+            "schema": [{"name": "id", "type": "INT64"}], "files": []
+        })" : "") + "]}";
+    };
+    fs::path manifestPath = createTempManifest(manifest(R"({"path": "orders.csv", "row_count": 5})", false));
+
+    JsonCatalog catalog(manifestPath);
+    auto before = catalog.getSnapshot();
+    TableId users = *catalog.getTableIdByName("users");
+    TableId orders = *catalog.getTableIdByName("orders");
+
+    // Unchanged manifest, nothing to publish
+    ASSERT_TRUE(catalog.reload().has_value());
+    EXPECT_EQ(catalog.getSnapshot(), before);
+
+    createTempManifest(manifest(R"({"path": "orders.csv", "row_count": 5}, {"path": "more.csv", "row_count": 7})", true));
+    ASSERT_TRUE(catalog.reload().has_value());
+    auto after = catalog.getSnapshot();
+    EXPECT_GT(after->version, before->version);
+    EXPECT_EQ(after->tables.at(users), before->tables.at(users));
+    EXPECT_NE(after->tables.at(orders), before->tables.at(orders));
+    EXPECT_EQ(catalog.getRowCount(orders), 12);
+    EXPECT_TRUE(catalog.getTableIdByName("items").has_value());
+
+    // Readers holding the previous snapshot still see the previous tables
+    EXPECT_EQ(before->findTable(orders)->getRowCount(), 5);
+    EXPECT_EQ(before->tableIds.count("items"), 0u);
+
+    // An invalid manifest keeps the current state
+    createTempManifest("{ invalid");
+    EXPECT_FALSE(catalog.reload().has_value());
+    EXPECT_EQ(catalog.getSnapshot(), after);
+}
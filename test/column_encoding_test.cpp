@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "storage/column_encoding.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+
+class ColumnEncodingTest : public ::testing::Test {
+protected:
+    static constexpr int64_t ROWS = 1000;
+
+    memory::BufferManager bufferManager_;
+    BatchAllocator allocator_{&bufferManager_};
+    ColumnId columnId_{1, "value"};
+    std::string encoded_;
+
+    // Encode the rows of the column, which must not contain long strings
+    template<is_db_type T>
+    std::optional<EncodedChunk> encode(ColumnBuffer& column, ColumnEncoding expected) {
+        PlainChunk plain{column.type, ROWS, column.getNullBitmap().data(),
+                         reinterpret_cast<const char*>(column.getDataAs<T>().data()), {}};
+        encoded_.clear();
+        EXPECT_EQ(encodeChunk(plain, encoded_), expected);
+        EXPECT_EQ(encoded_.size() % 8, 0u);
+        return EncodedChunk::open(expected, column.type, encoded_.data(), encoded_.size(), ROWS);
+    }
+
+    // Rows in [begin, begin + count) that pass the filter
+    static std::vector<int64_t> filterRows(const EncodedChunk& chunk, CompareOp op, kernels::CompareDomain domain,
+                                           const ConstantExpr& constant, int64_t begin, int64_t count) {
+        std::vector<uint8_t> passes(static_cast<size_t>(count), 1);
+        EXPECT_TRUE(chunk.filter(op, domain, constant, begin, count, passes));
+        std::vector<int64_t> rows;
+        for (int64_t i = 0; i < count; ++i) {
+            if (passes[static_cast<size_t>(i)]) {
+                rows.push_back(begin + i);
+            }
+        }
+        return rows;
+    }
+};
+
+// Test that a narrow range of integers is stored as frame of reference, and decoded, gathered and filtered on the deltas
+TEST_F(ColumnEncodingTest, FrameOfReference) {
+    ColumnBuffer column = allocator_.allocateColumn(columnId_, DataType::getInt64());
+    for (int64_t row = 0; row < ROWS; ++row) {
+        column.writeEntry<db_int64>(row, 1000 + (row * 7) % 50);
+        if (row % 11 == 0) {
+            column.setNull(row);
+        }
+    }
+    auto chunk = encode<db_int64>(column, ColumnEncoding::FRAME_OF_REFERENCE);
+    ASSERT_TRUE(chunk);
+
+    ColumnBuffer out = allocator_.allocateColumn(columnId_, DataType::getInt64());
+    chunk->decode(100, 200, out, nullptr);
+    for (int64_t i = 0; i < 200; ++i) {
+        int64_t row = 100 + i;
+        EXPECT_EQ(out.isNull(i), row % 11 == 0);
+        if (row % 11 != 0) {
+            EXPECT_EQ(out.getEntry<db_int64>(i), 1000 + (row * 7) % 50);
+        }
+    }
+
+    std::vector<int64_t> rows = {999, 3, 11, 500};
+    chunk->gather(rows, out, nullptr);
+    EXPECT_EQ(out.count, 4);
+    EXPECT_EQ(out.getEntry<db_int64>(0), 1000 + (999 * 7) % 50);
+    EXPECT_EQ(out.getEntry<db_int64>(1), 1021);
+    EXPECT_TRUE(out.isNull(2));
+
+    auto integral = kernels::CompareDomain::INTEGRAL;
+    std::vector<int64_t> expected;
+    for (int64_t row = 10; row < 510; ++row) {
+        if (row % 11 != 0 && 1000 + (row * 7) % 50 >= 1040) {
+            expected.push_back(row);
+        }
+    }
+    EXPECT_EQ(filterRows(*chunk, CompareOp::GREATER_EQUAL, integral, ConstantExpr(DataType::getInt64(), int64_t{1040}),
+                         10, 500),
+              expected);
+
+    // Constants outside of the range of the chunk
+    EXPECT_TRUE(filterRows(*chunk, CompareOp::LESS, integral, ConstantExpr(DataType::getInt32(), int64_t{5}), 0, ROWS)
+                    .empty());
+    EXPECT_EQ(filterRows(*chunk, CompareOp::NOT_EQUAL, integral, ConstantExpr(DataType::getInt64(), int64_t{5000}), 0,
+                         ROWS)
+                  .size(),
+              static_cast<size_t>(ROWS - (ROWS + 10) / 11));
+    EXPECT_TRUE(filterRows(*chunk, CompareOp::EQUAL, integral, ConstantExpr(), 0, ROWS).empty());
+
+    // Comparisons in another domain are left to the caller
+    std::vector<uint8_t> passes(ROWS, 1);
+    EXPECT_FALSE(chunk->filter(CompareOp::LESS, kernels::CompareDomain::DOUBLE,
+                               ConstantExpr(DataType::getDouble(), 1020.5), 0, ROWS, passes));
+    EXPECT_EQ(std::count(passes.begin(), passes.end(), 1), ROWS);
+}
+
+// Test that long runs are stored run-length encoded and comparisons are evaluated per run
+TEST_F(ColumnEncodingTest, RunLength) {
+    ColumnBuffer column = allocator_.allocateColumn(columnId_, DataType::getInt32());
+    for (int64_t row = 0; row < ROWS; ++row) {
+        column.writeEntry<db_int32>(row, static_cast<db_int32>(row / 100) * 1000000);
+        if (row % 250 == 0) {
+            column.setNull(row);
+        }
+    }
+    auto chunk = encode<db_int32>(column, ColumnEncoding::RLE);
+    ASSERT_TRUE(chunk);
+
+    ColumnBuffer out = allocator_.allocateColumn(columnId_, DataType::getInt32());
+    chunk->decode(50, 300, out, nullptr);
+    for (int64_t i = 0; i < 300; ++i) {
+        int64_t row = 50 + i;
+        EXPECT_EQ(out.isNull(i), row % 250 == 0);
+        if (row % 250 != 0) {
+            EXPECT_EQ(out.getEntry<db_int32>(i), (row / 100) * 1000000);
+        }
+    }
+
+    std::vector<int64_t> expected;
+    for (int64_t row = 150; row < 400; ++row) {
+        if (row % 250 != 0) {
+            expected.push_back(row);
+        }
+    }
+    EXPECT_EQ(filterRows(*chunk, CompareOp::LESS_EQUAL, kernels::CompareDomain::INTEGRAL,
+                         ConstantExpr(DataType::getInt32(), int64_t{3000000}), 150, 700),
+              expected);
+}
+
+// Test that low-cardinality strings are dictionary encoded and compared on the codes
+TEST_F(ColumnEncodingTest, Dictionary) {
+    ColumnBuffer column = allocator_.allocateColumn(columnId_, DataType::getString());
+    auto cityFor = [](int64_t row) { return "city" + std::to_string(row % 8); };
+    for (int64_t row = 0; row < ROWS; ++row) {
+        column.writeString(row, cityFor(row));
+        if (row % 9 == 0) {
+            column.setNull(row);
+        }
+    }
+    auto chunk = encode<db_string>(column, ColumnEncoding::DICTIONARY);
+    ASSERT_TRUE(chunk);
+
+    ColumnBuffer out = allocator_.allocateColumn(columnId_, DataType::getString());
+    chunk->decode(0, ROWS, out, out.getStringHeap());
+    for (int64_t row = 0; row < ROWS; ++row) {
+        EXPECT_EQ(out.isNull(row), row % 9 == 0);
+        if (row % 9 != 0) {
+            EXPECT_EQ(out.getEntry<db_string>(row).view(), cityFor(row));
+        }
+    }
+
+    auto strings = kernels::CompareDomain::STRING;
+    auto count = [&](CompareOp op, const std::string& value) {
+        return filterRows(*chunk, op, strings, ConstantExpr(DataType::getString(), value), 0, ROWS).size();
+    };
+    auto expected = [&](auto matches) {
+        size_t rows = 0;
+        for (int64_t row = 0; row < ROWS; ++row) {
+            rows += row % 9 != 0 && matches(cityFor(row)) ? 1 : 0;
+        }
+        return rows;
+    };
+    EXPECT_EQ(count(CompareOp::EQUAL, "city3"), expected([](const std::string& city) { return city == "city3"; }));
+    EXPECT_EQ(count(CompareOp::LESS, "city2"), expected([](const std::string& city) { return city < "city2"; }));
+    EXPECT_EQ(count(CompareOp::GREATER, "city25"), expected([](const std::string& city) { return city > "city25"; }));
+    EXPECT_EQ(count(CompareOp::NOT_EQUAL, "city9"), expected([](const std::string&) { return true; }));
+    EXPECT_EQ(count(CompareOp::EQUAL, "missing"), 0u);
+}
+
+// Test that values without a cheaper encoding stay plain and are not filtered
+TEST_F(ColumnEncodingTest, Plain) {
+    ColumnBuffer column = allocator_.allocateColumn(columnId_, DataType::getDouble());
+    for (int64_t row = 0; row < ROWS; ++row) {
+        column.writeEntry<db_double>(row, static_cast<double>(row) / 3);
+    }
+    auto chunk = encode<db_double>(column, ColumnEncoding::PLAIN);
+    ASSERT_TRUE(chunk);
+
+    ColumnBuffer out = allocator_.allocateColumn(columnId_, DataType::getDouble());
+    chunk->decode(7, 100, out, nullptr);
+    EXPECT_EQ(out.getEntry<db_double>(0), 7.0 / 3);
+    EXPECT_EQ(out.getEntry<db_double>(99), 106.0 / 3);
+
+    std::vector<uint8_t> passes(ROWS, 1);
+    EXPECT_FALSE(chunk->filter(CompareOp::LESS, kernels::CompareDomain::DOUBLE,
+                               ConstantExpr(DataType::getDouble(), 10.0), 0, ROWS, passes));
+
+    // Truncated chunks are rejected
+    EXPECT_FALSE(EncodedChunk::open(ColumnEncoding::PLAIN, DataType::getDouble(), encoded_.data(), 64, ROWS));
+    EXPECT_FALSE(EncodedChunk::open(ColumnEncoding::RLE, DataType::getDouble(), encoded_.data(), encoded_.size(), ROWS));
+}
@@ -0,0 +1,204 @@
+#include <memory>
+#include <unordered_map>
+#include "gtest/gtest.h"
+#include "common/hash.hpp"
+#include "engine/predicate_expr.hpp"
+#include "storage/column_statistics.hpp"
+#include "storage/statistics_collector.hpp"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+
+class ColumnStatisticsTest : public ::testing::Test {
+protected:
+    ColumnId intCol{1, "id"};
+    ColumnId doubleCol{2, "price"};
+    ColumnId stringCol{3, "city"};
+    std::unordered_map<ColumnId, ColumnStatistics, ColumnIdHash> stats;
+
+    void SetUp() override {
+        ColumnStatistics ids{DataType::getInt64(), 100, 0};
+        ids.hasMinMax = true;
+        ids.intMin = 10;
+        ids.intMax = 20;
+        stats[intCol] = ids;
+
+        ColumnStatistics prices{DataType::getDouble(), 100, 5};
+        prices.hasMinMax = true;
+        prices.doubleMin = 1.5;
+        prices.doubleMax = 9.5;
+        stats[doubleCol] = prices;
+
+        ColumnStatistics cities{DataType::getString(), 100, 0};
+        cities.hasMinMax = true;
+        cities.stringMin = "Berlin";
+        cities.stringMax = "Munich";
+        stats[stringCol] = cities;
+    }
+
+    bool check(const PredicateExpr& predicate) {
+        return mayMatch(predicate, [this](const ColumnId& colId) -> const ColumnStatistics* {
+            auto it = stats.find(colId);
+            return it == stats.end() ? nullptr : &it->second;
+        });
+    }
+
+    std::unique_ptr<PredicateExpr> compareInt(CompareOp op, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(intCol, DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+};
+
+// Test pruning of integer comparisons against the min/max range
+TEST_F(ColumnStatisticsTest, IntegerRanges) {
+    EXPECT_TRUE(check(*compareInt(CompareOp::EQUAL, 15)));
+    EXPECT_FALSE(check(*compareInt(CompareOp::EQUAL, 21)));
+    EXPECT_TRUE(check(*compareInt(CompareOp::LESS, 11)));
+    EXPECT_FALSE(check(*compareInt(CompareOp::LESS, 10)));
+    EXPECT_TRUE(check(*compareInt(CompareOp::LESS_EQUAL, 10)));
+    EXPECT_FALSE(check(*compareInt(CompareOp::GREATER, 20)));
+    EXPECT_TRUE(check(*compareInt(CompareOp::GREATER_EQUAL, 20)));
+    EXPECT_TRUE(check(*compareInt(CompareOp::NOT_EQUAL, 15)));
+
+    // Constant on the left: 25 < id
+    CompareExpr mirrored(CompareOp::LESS, DataType::getInt64(),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), 25L),
+        std::make_unique<ColumnRefExpr>(intCol, DataType::getInt64()));
+    EXPECT_FALSE(check(mirrored));
+}
+
+// Test pruning of double and string comparisons
+TEST_F(ColumnStatisticsTest, DoubleAndStringRanges) {
+    CompareExpr cheap(CompareOp::LESS, DataType::getDouble(),
+        std::make_unique<ColumnRefExpr>(doubleCol, DataType::getDouble()),
+        std::make_unique<ConstantExpr>(DataType::getDouble(), 1.0));
+    EXPECT_FALSE(check(cheap));
+
+    // Integer column compared as double
+    CompareExpr widened(CompareOp::GREATER, DataType::getDouble(),
+        std::make_unique<CastExpr>(DataType::getDouble(), std::make_unique<ColumnRefExpr>(intCol, DataType::getInt64())),
+        std::make_unique<ConstantExpr>(DataType::getDouble(), 19.5));
+    EXPECT_TRUE(check(widened));
+
+    CompareExpr paris(CompareOp::EQUAL, DataType::getString(),
+        std::make_unique<ColumnRefExpr>(stringCol, DataType::getString()),
+        std::make_unique<ConstantExpr>(DataType::getString(), std::string("Paris")));
+    EXPECT_FALSE(check(paris));
+
+    CompareExpr bonn(CompareOp::EQUAL, DataType::getString(),
+        std::make_unique<ColumnRefExpr>(stringCol, DataType::getString()),
+        std::make_unique<ConstantExpr>(DataType::getString(), std::string("Bonn")));
+    EXPECT_TRUE(check(bonn));
+}
+
+// Test AND/OR combinations and cases that can't be pruned
+TEST_F(ColumnStatisticsTest, LogicalCombinationsAndUnknowns) {
+    LogicalExpr conjunction(CompareOp::AND, compareInt(CompareOp::GREATER, 12), compareInt(CompareOp::LESS, 5));
+    EXPECT_FALSE(check(conjunction));
+
+    LogicalExpr disjunction(CompareOp::OR, compareInt(CompareOp::GREATER, 12), compareInt(CompareOp::LESS, 5));
+    EXPECT_TRUE(check(disjunction));
+
+    // Columns without statistics are never pruned
+    CompareExpr unknown(CompareOp::EQUAL, DataType::getInt64(),
+        std::make_unique<ColumnRefExpr>(ColumnId(42, "other"), DataType::getInt64()),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), 1L));
+    EXPECT_TRUE(check(unknown));
+
+    // Comparisons with NULL never match
+    CompareExpr withNull(CompareOp::EQUAL, DataType::getInt64(),
+        std::make_unique<ColumnRefExpr>(intCol, DataType::getInt64()),
+        std::make_unique<ConstantExpr>());
+    EXPECT_FALSE(check(withNull));
+
+    // Neither do comparisons on columns that are entirely NULL
+    stats[intCol].nullCount = stats[intCol].rowCount;
+    EXPECT_FALSE(check(*compareInt(CompareOp::EQUAL, 15)));
+}
+
+// Test that HyperLogLog sketches estimate distinct counts, merge and survive serialization
+TEST_F(ColumnStatisticsTest, HyperLogLogEstimates) {
+    HyperLogLog all;
+    HyperLogLog low;
+    HyperLogLog high;
+    for (int64_t i = 0; i < 50000; ++i) {
+        uint64_t hash = hashInt64(i);
+        all.addHash(hash);
+        all.addHash(hash);
+        (i < 25000 ? low : high).addHash(hash);
+    }
+    EXPECT_NEAR(all.estimate(), 50000.0, 5000.0);
+
+    low.merge(high);
+    EXPECT_DOUBLE_EQ(low.estimate(), all.estimate());
+
+    auto restored = HyperLogLog::fromHex(all.toHex());
+    ASSERT_TRUE(restored.has_value());
+    EXPECT_EQ(restored->toHex(), all.toHex());
+    EXPECT_FALSE(HyperLogLog::fromHex("zz").has_value());
+
+    // Small counts are estimated by linear counting
+    HyperLogLog small;
+    for (int64_t i = 0; i < 100; ++i) {
+        small.addHash(hashInt64(i));
+    }
+    EXPECT_NEAR(small.estimate(), 100.0, 5.0);
+}
+
+// Test collecting statistics of skewed data and merging the statistics of two halves
+TEST_F(ColumnStatisticsTest, CollectAndMerge) {
+    // 90% of the values are below 100, the rest between 1900 and 2000
+    std::vector<int64_t> values;
+    std::vector<std::string> cities;
+    for (int64_t i = 0; i < 1000; ++i) {
+        values.push_back(i < 900 ? i % 100 : 1000 + i);
+        cities.push_back("city" + std::to_string(i % 10));
+    }
+
+    ColumnId valueCol(1, "value");
+    ColumnId cityCol(2, "city");
+    std::vector<ColumnDescriptor> columns = {{valueCol, DataType::getInt64()}, {cityCol, DataType::getString()}};
+
+    test::ColumnBufferStorage storage;
+    auto makeBatch = [&](size_t begin, size_t end) {
+        RowVector batch;
+        batch.addColumn(storage.createIntColumn({values.begin() + begin, values.begin() + end}, 1, "value"));
+        batch.addColumn(storage.createStringColumn({cities.begin() + begin, cities.begin() + end}, 2, "city"));
+        return batch;
+    };
+
+    StatisticsCollector whole(columns);
+    whole.add(makeBatch(0, 1000));
+    StatisticsMap result = whole.finish();
+    EXPECT_EQ(whole.getRowCount(), 1000);
+
+    const ColumnStatistics& valueStats = result.at(valueCol);
+    EXPECT_EQ(valueStats.rowCount, 1000);
+    EXPECT_EQ(valueStats.nullCount, 0);
+    EXPECT_EQ(valueStats.intMin, 0);
+    EXPECT_EQ(valueStats.intMax, 1999);
+    EXPECT_NEAR(static_cast<double>(*valueStats.distinctCount), 200.0, 20.0);
+    ASSERT_EQ(valueStats.histogram.size(), StatisticsCollector::HISTOGRAM_BUCKETS + 1);
+    EXPECT_NEAR(*valueStats.fractionBelow(100.0), 0.9, 0.05);
+
+    const ColumnStatistics& cityStats = result.at(cityCol);
+    EXPECT_EQ(cityStats.stringMin, "city0");
+    EXPECT_EQ(cityStats.stringMax, "city9");
+    EXPECT_EQ(*cityStats.distinctCount, 10);
+    EXPECT_TRUE(cityStats.histogram.empty());
+
+    StatisticsCollector first(columns);
+    first.add(makeBatch(0, 500));
+    StatisticsCollector second(columns);
+    second.add(makeBatch(500, 1000));
+    StatisticsMap firstResult = first.finish();
+    StatisticsMap secondResult = second.finish();
+
+    ColumnStatistics merged = mergeColumnStatistics({&firstResult.at(valueCol), &secondResult.at(valueCol)});
+    EXPECT_EQ(merged.rowCount, 1000);
+    EXPECT_EQ(merged.intMin, 0);
+    EXPECT_EQ(merged.intMax, 1999);
+    EXPECT_EQ(*merged.distinctCount, *valueStats.distinctCount);
+    EXPECT_NEAR(*merged.fractionBelow(100.0), 0.9, 0.05);
+}
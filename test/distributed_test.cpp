@@ -0,0 +1,225 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "common/errors.hpp"
+#include "engine/exchange.hpp"
+#include "gtest/gtest.h"
+#include "planner/physical_planner.hpp"
+#include "planner/plan_fragment.hpp"
+#include "server/cluster.hpp"
+#include "server/query_server.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+
+using namespace toydb;
+using namespace toydb::server;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Runs every fragment workerCount times against the same catalog, as if each of the
+ *        workers held a copy of all files
+ */
+class LocalDispatcher : public FragmentDispatcher {
+private:
+    class BufferedStream : public FragmentStream {
+    private:
+        std::vector<std::string> payloads_;
+        size_t next_ = 0;
+
+    public:
+        explicit BufferedStream(std::vector<std::string> payloads) : payloads_(std::move(payloads)) {}
+
+        bool next(std::string& payload) override {
+            if (next_ == payloads_.size()) {
+                return false;
+            }
+            payload = std::move(payloads_[next_++]);
+            return true;
+        }
+    };
+
+    Catalog* catalog_;
+    size_t workerCount_;
+
+public:
+    size_t dispatchCount = 0;
+
+    LocalDispatcher(Catalog* catalog, size_t workerCount) : catalog_(catalog), workerCount_(workerCount) {}
+
+    std::unique_ptr<FragmentStream> dispatch(const std::string& fragment) override {
+        ++dispatchCount;
+        std::vector<std::string> payloads;
+        Session worker(catalog_);
+        for (size_t i = 0; i < workerCount_; ++i) {
+            worker.executeFragment(fragment, [&payloads](std::string_view payload) { payloads.emplace_back(payload); });
+        }
+        return std::make_unique<BufferedStream>(std::move(payloads));
+    }
+};
+
+class DistributedTest : public ::testing::Test {
+protected:
+    std::unique_ptr<JsonCatalog> catalog_;
+
+    void SetUp() override {
+        catalog_ = std::make_unique<JsonCatalog>(manifestPath());
+    }
+
+    static fs::path manifestPath() {
+        return fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json";
+    }
+
+    ColumnId column(const std::string& table, const std::string& name) {
+        auto tableId = catalog_->getTableIdByName(table);
+        EXPECT_TRUE(tableId.has_value());
+        auto colId = catalog_->resolveColumn(*tableId, name);
+        EXPECT_TRUE(colId.has_value());
+        return *colId;
+    }
+
+    // The value in the last line of the CSV result of a query with a single column
+    static std::string scalar(Session& session, const std::string& sql) {
+        session.setResultFormat(ResultFormat::CSV);
+        std::string data;
+        session.execute(sql, [&data](std::string_view bytes) { data.append(bytes); });
+        while (!data.empty() && data.back() == '\n') {
+            data.pop_back();
+        }
+        return data.substr(data.rfind('\n') + 1);
+    }
+
+    static int64_t rowCount(Session& session, const std::string& sql) {
+        return session.execute(sql, [](std::string_view) {}).value_or(-1);
+    }
+};
+
+// Test that a fragment decoded against the catalog encodes to the same bytes
+TEST_F(DistributedTest, EncodesPlanFragments) {
+    std::vector<ColumnId> columns {column("orders", "id"), column("orders", "user_id"), column("orders", "status")};
+    auto scan = std::make_shared<TableScanOp>(columns, TableSample {SampleMethod::BERNOULLI, 50.0, 7});
+    auto filter = std::make_shared<FilterOp>(std::make_unique<LogicalExpr>(
+        CompareOp::AND,
+        std::make_unique<CompareExpr>(CompareOp::LESS, DataType::getInt64(),
+                                      std::make_unique<ColumnRefExpr>(columns[0], DataType::getInt64()),
+                                      std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t {4})),
+        std::make_unique<CompareExpr>(CompareOp::NOT_EQUAL, DataType::getString(),
+                                      std::make_unique<ColumnRefExpr>(columns[2], DataType::getString()),
+                                      std::make_unique<ConstantExpr>(DataType::getString(), std::string("open")))));
+    filter->addChild(scan);
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId> {columns[0], columns[1]});
+    projection->addChild(filter);
+    ASSERT_TRUE(PlanFragment::canDistribute(projection.get()));
+
+    std::optional<PlanFragment> fragment = PlanFragment::fromPlan(projection.get(), {columns[1]});
+    ASSERT_TRUE(fragment.has_value());
+    fragment->aggregate({{columns[1], DataType::getInt64()}},
+                        {{AggregateFunction::SUM, columns[0], DataType::getInt64(), ColumnId(1, "total")}});
+    std::string encoded = fragment->encode();
+
+    PlanFragment decoded = PlanFragment::decode(encoded, *catalog_);
+    ASSERT_EQ(decoded.columns.size(), 1u);
+    EXPECT_EQ(decoded.columns[0], columns[1]);
+    ASSERT_NE(decoded.predicate, nullptr);
+    ASSERT_TRUE(decoded.sample.has_value());
+    EXPECT_EQ(decoded.sample->seed, 7u);
+    ASSERT_EQ(decoded.aggregates.size(), 1u);
+    EXPECT_EQ(decoded.aggregates[0].input, columns[0]);
+    EXPECT_EQ(decoded.aggregates[0].output.getName(), "total");
+    EXPECT_EQ(decoded.encode(), encoded);
+
+    EXPECT_THROW(PlanFragment::decode(encoded.substr(0, encoded.size() - 1), *catalog_), SQLRuntimeException);
+    EXPECT_THROW(PlanFragment::decode(encoded + "x", *catalog_), SQLRuntimeException);
+    EXPECT_THROW(PlanFragment::decode("", *catalog_), SQLRuntimeException);
+
+    // Joins and aggregates run on the coordinator
+    auto join = std::make_shared<CrossProductOp>();
+    join->addChild(scan);
+    join->addChild(scan);
+    EXPECT_FALSE(PlanFragment::canDistribute(join.get()));
+}
+
+// Test that scans, filters and aggregates read the tables of every worker, and joins combine them
+TEST_F(DistributedTest, RunsQueriesOnWorkers) {
+    Session local(catalog_.get());
+    LocalDispatcher dispatcher(catalog_.get(), 2);
+    Session coordinator(catalog_.get(), nullptr, nullptr, nullptr, &dispatcher);
+
+    EXPECT_EQ(scalar(coordinator, "SELECT COUNT(*) FROM orders"), "20");
+    EXPECT_EQ(scalar(coordinator, "SELECT SUM(id) FROM orders WHERE id <= 3"), "12");
+    EXPECT_EQ(scalar(coordinator, "SELECT MAX(user_id) FROM orders"), scalar(local, "SELECT MAX(user_id) FROM orders"));
+    EXPECT_EQ(rowCount(coordinator, "SELECT id, status FROM orders WHERE id < 4"), 6);
+
+    int64_t pairs = rowCount(local, "SELECT orders.id FROM orders, users WHERE orders.user_id = users.id");
+    EXPECT_EQ(rowCount(coordinator, "SELECT orders.id FROM orders, users WHERE orders.user_id = users.id"),
+              4 * pairs);
+    EXPECT_GT(dispatcher.dispatchCount, 0u);
+}
+
+class ClusterTest : public DistributedTest {
+protected:
+    std::vector<std::unique_ptr<JsonCatalog>> workerCatalogs_;
+    std::vector<std::unique_ptr<QueryServer>> workers_;
+    std::vector<std::thread> loops_;
+
+    void startWorkers(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            ServerOptions options;
+            options.port = 0;
+            options.workerCount = 2;
+            workerCatalogs_.push_back(std::make_unique<JsonCatalog>(manifestPath()));
+            workers_.push_back(std::make_unique<QueryServer>(workerCatalogs_.back().get(), options));
+            loops_.emplace_back([server = workers_.back().get()] { server->run(); });
+        }
+    }
+
+    std::vector<WorkerAddress> addresses() const {
+        std::vector<WorkerAddress> addresses;
+        for (const auto& worker : workers_) {
+            addresses.push_back({"127.0.0.1", worker->getPort()});
+        }
+        return addresses;
+    }
+
+    void TearDown() override {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->stop();
+            loops_[i].join();
+        }
+        workers_.clear();
+    }
+};
+
+// Test a coordinator reading the tables of two QueryServers over the network
+TEST_F(ClusterTest, GathersFromWorkers) {
+    startWorkers(2);
+    ClusterDispatcher dispatcher(addresses(), 1);
+    Session coordinator(catalog_.get(), nullptr, nullptr, nullptr, &dispatcher);
+
+    EXPECT_EQ(scalar(coordinator, "SELECT COUNT(*) FROM orders"), "20");
+    EXPECT_EQ(rowCount(coordinator, "SELECT id, user_id FROM orders WHERE id > 8"), 4);
+    EXPECT_EQ(scalar(coordinator, "SELECT COUNT(*) FROM users WHERE id <= 5"), "10");
+}
+
+TEST_F(ClusterTest, ReportsUnreachableWorkers) {
+    startWorkers(1);
+    std::vector<WorkerAddress> workers = addresses();
+    // Nothing listens on the port of a stopped server
+    startWorkers(1);
+    uint16_t stoppedPort = workers_.back()->getPort();
+    workers_.back()->stop();
+    loops_.back().join();
+    workers_.pop_back();
+    loops_.pop_back();
+    workers.push_back({"127.0.0.1", stoppedPort});
+
+    ClusterDispatcher dispatcher(workers);
+    Session coordinator(catalog_.get(), nullptr, nullptr, nullptr, &dispatcher);
+    EXPECT_THROW(rowCount(coordinator, "SELECT id FROM orders"), SQLRuntimeException);
+
+    EXPECT_EQ(WorkerAddress::parse("10.0.0.1:5433")->port, 5433);
+    EXPECT_FALSE(WorkerAddress::parse("10.0.0.1").has_value());
+    EXPECT_FALSE(WorkerAddress::parse("10.0.0.1:port").has_value());
+}
@@ -0,0 +1,169 @@
+#include <memory>
+#include "engine/filter.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/nested_loop_join.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/projection.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class FilterTest : public ::testing::Test {
+   protected:
+    // Predicate: col <op> value
+    std::unique_ptr<PredicateExpr> compare(CompareOp op, uint64_t colId, const std::string& name, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(ColumnId(colId, name), DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+};
+
+// Test that a selective filter produces a selection vector without touching the columns
+TEST_F(FilterTest, SparseSelection) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 1000)).build();
+    FilterExec filter(input.get(), compare(CompareOp::LESS, 0, "col0", 100));
+    filter.initialize();
+
+    RowVector output;
+    int64_t resultCount = filter.next(output);
+
+    EXPECT_EQ(resultCount, 100);
+    EXPECT_EQ(output.getRowCount(), 1000);
+    EXPECT_EQ(output.getSelectedRowCount(), 100);
+    ASSERT_TRUE(output.hasSelection());
+    EXPECT_TRUE(output.getSelection()->hasSelectionVector());
+
+    int64_t expected = 0;
+    output.forEachSelectedRow([&](int64_t row) {
+        EXPECT_EQ(output.getColumn(0).getEntry<db_int64>(row), expected++);
+    });
+    EXPECT_EQ(expected, 100);
+
+    RowVector end;
+    EXPECT_EQ(filter.next(end), 0);
+}
+
+// Test that a filter passing most rows keeps the bitmask representation
+TEST_F(FilterTest, DenseSelection) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 1000)).build();
+    FilterExec filter(input.get(), compare(CompareOp::GREATER_EQUAL, 0, "col0", 100));
+    filter.initialize();
+
+    RowVector output;
+    EXPECT_EQ(filter.next(output), 900);
+    ASSERT_TRUE(output.hasSelection());
+    EXPECT_FALSE(output.getSelection()->hasSelectionVector());
+    EXPECT_FALSE(output.isRowSelected(99));
+    EXPECT_TRUE(output.isRowSelected(100));
+    EXPECT_EQ(output.nextSelectedRow(0), 100);
+}
+
+// Test that batches without matches are skipped and batches where all rows match are forwarded unchanged
+TEST_F(FilterTest, EmptyAndFullBatches) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", intSequence(0, 300))
+        .withBatchSizes({100, 100, 100})
+        .build();
+    FilterExec filter(input.get(), compare(CompareOp::GREATER_EQUAL, 0, "col0", 150));
+    filter.initialize();
+
+    RowVector first;
+    EXPECT_EQ(filter.next(first), 50);
+    EXPECT_TRUE(first.hasSelection());
+
+    RowVector second;
+    EXPECT_EQ(filter.next(second), 100);
+    EXPECT_FALSE(second.hasSelection());
+
+    RowVector end;
+    EXPECT_EQ(filter.next(end), 0);
+}
+
+// Test stacked filters combine their selections
+TEST_F(FilterTest, StackedFilters) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 1000)).build();
+    FilterExec lower(input.get(), compare(CompareOp::GREATER_EQUAL, 0, "col0", 100));
+    FilterExec upper(&lower, compare(CompareOp::LESS, 0, "col0", 110));
+    upper.initialize();
+
+    EXPECT_EQ(drainOperator(upper), 10);
+}
+
+// Test that joins skip the unselected rows of filtered inputs
+TEST_F(FilterTest, JoinsConsumeSelection) {
+    ColumnBufferStorage storage;
+
+    // Build side filtered to [0, 50), probe side filtered to [25, 1000)
+    auto buildInput = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 1000)).build();
+    auto probeInput = MockOperatorBuilder(&storage)
+        .addInt64Column(1, "col1", intSequence(0, 1000))
+        .withBatchSizes({10, 500, 490})
+        .build();
+
+    FilterExec buildFilter(buildInput.get(), compare(CompareOp::LESS, 0, "col0", 50));
+    FilterExec probeFilter(probeInput.get(), compare(CompareOp::GREATER_EQUAL, 1, "col1", 25));
+
+    HashJoinExec hashJoin(&buildFilter, &probeFilter,
+                          std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64()),
+                          std::make_unique<ColumnRefExpr>(ColumnId(1, "col1"), DataType::getInt64()),
+                          JoinType::RIGHT);
+    hashJoin.initialize();
+    EXPECT_EQ(drainOperator(hashJoin), 975);
+
+    buildFilter.initialize();
+    probeFilter.initialize();
+    NestedLoopJoinExec nestedLoopJoin(&buildFilter, &probeFilter,
+        std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64()),
+            std::make_unique<ColumnRefExpr>(ColumnId(1, "col1"), DataType::getInt64())));
+    nestedLoopJoin.initialize();
+    EXPECT_EQ(drainOperator(nestedLoopJoin), 25);
+}
+
+// Test that a batch reused across calls stays bound to the operator's schema and keeps its storage
+TEST_F(FilterTest, ReusedOutputBatch) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", intSequence(0, 300))
+        .addInt64Column(1, "col1", intSequence(0, 300))
+        .withBatchSizes({100, 100, 100})
+        .build();
+    FilterExec filter(input.get(), compare(CompareOp::GREATER_EQUAL, 0, "col0", 50));
+    ProjectionExec projection(&filter, {ColumnId(1, "col1")});
+    projection.initialize();
+
+    RowVector output;
+    ASSERT_EQ(projection.next(output), 50);
+    std::shared_ptr<const BatchSchema> schema = output.getSchema();
+    const ColumnBuffer* columns = output.getColumns().data();
+    ASSERT_EQ(schema->getColumnCount(), 1);
+    EXPECT_EQ(output.getColumnIndex(ColumnId(1, "col1")), 0);
+    EXPECT_EQ(output.getColumnIndex(ColumnId(0, "col0")), -1);
+
+    for (int64_t expected : {int64_t{100}, int64_t{200}}) {
+        ASSERT_EQ(projection.next(output), 100);
+        EXPECT_EQ(output.getSchema(), schema);
+        EXPECT_EQ(output.getColumns().data(), columns);
+        EXPECT_EQ(output.getColumn(0).getEntry<db_int64>(0), expected);
+    }
+
+    // A view shares the columns without copying their data
+    RowVector view = output.view();
+    EXPECT_EQ(view.getSchema(), schema);
+    EXPECT_EQ(view.getColumn(0).getDataAs<db_int64>().data(), output.getColumn(0).getDataAs<db_int64>().data());
+
+    EXPECT_EQ(projection.next(output), 0);
+    EXPECT_EQ(output.getColumnCount(), 0);
+}
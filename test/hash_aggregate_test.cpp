@@ -0,0 +1,467 @@
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/hash_aggregate.hpp"
+#include "engine/morsel.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class HashAggregateTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage;
+    memory::BufferManager bufferManager;
+
+    static AggregateSpec aggregate(AggregateFunction function, uint64_t inputId, DataType inputType, const std::string& name) {
+        return {function, ColumnId(inputId, "col" + std::to_string(inputId)), inputType, ColumnId(100 + inputId, name)};
+    }
+
+    static AggregateSpec countStar() {
+        return {AggregateFunction::COUNT_STAR, ColumnId(), DataType::getInt64(), ColumnId(99, "count")};
+    }
+
+    struct IntGroup {
+        int64_t countStar = 0;
+        int64_t sum = 0;
+        int64_t min = 0;
+        int64_t max = 0;
+        double avg = 0;
+    };
+
+    // Aggregates of a single int64 input column, grouped by an int64 key column
+    static std::vector<AggregateSpec> intAggregates() {
+        return {
+            countStar(),
+            aggregate(AggregateFunction::SUM, 1, DataType::getInt64(), "sum"),
+            aggregate(AggregateFunction::MIN, 1, DataType::getInt64(), "min"),
+            aggregate(AggregateFunction::MAX, 1, DataType::getInt64(), "max"),
+            aggregate(AggregateFunction::AVG, 1, DataType::getInt64(), "avg"),
+        };
+    }
+
+    static std::vector<ColumnDescriptor> intKey() {
+        return {{ColumnId(0, "col0"), DataType::getInt64()}};
+    }
+
+    // Emit all results of the output of intAggregates() grouped by intKey()
+    static std::map<int64_t, IntGroup> collectIntGroups(AggregateHashTable& table) {
+        std::map<int64_t, IntGroup> groups;
+        while (true) {
+            RowVector batch;
+            int64_t count = table.emit(batch);
+            if (count == 0) {
+                break;
+            }
+            EXPECT_EQ(batch.getColumnCount(), 6);
+            for (int64_t row = 0; row < count; ++row) {
+                int64_t key = batch.getColumn(0).getEntry<db_int64>(row);
+                EXPECT_FALSE(groups.contains(key)) << "Group " << key << " emitted twice";
+                groups[key] = {
+                    batch.getColumn(1).getEntry<db_int64>(row),
+                    batch.getColumn(2).getEntry<db_int64>(row),
+                    batch.getColumn(3).getEntry<db_int64>(row),
+                    batch.getColumn(4).getEntry<db_int64>(row),
+                    batch.getColumn(5).getEntry<db_double>(row),
+                };
+            }
+        }
+        return groups;
+    }
+
+    static std::map<int64_t, IntGroup> expectedIntGroups(const std::vector<int64_t>& keys, const std::vector<int64_t>& values) {
+        std::map<int64_t, IntGroup> groups;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto [it, inserted] = groups.try_emplace(keys[i]);
+            IntGroup& group = it->second;
+            if (inserted) {
+                group.min = values[i];
+                group.max = values[i];
+            }
+            ++group.countStar;
+            group.sum += values[i];
+            group.min = std::min(group.min, values[i]);
+            group.max = std::max(group.max, values[i]);
+        }
+        for (auto& [_, group] : groups) {
+            group.avg = static_cast<double>(group.sum) / static_cast<double>(group.countStar);
+        }
+        return groups;
+    }
+
+    static void expectGroupsEqual(const std::map<int64_t, IntGroup>& actual, const std::map<int64_t, IntGroup>& expected) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (const auto& [key, group] : expected) {
+            auto it = actual.find(key);
+            ASSERT_NE(it, actual.end()) << "Missing group " << key;
+            EXPECT_EQ(it->second.countStar, group.countStar) << "Group " << key;
+            EXPECT_EQ(it->second.sum, group.sum) << "Group " << key;
+            EXPECT_EQ(it->second.min, group.min) << "Group " << key;
+            EXPECT_EQ(it->second.max, group.max) << "Group " << key;
+            EXPECT_DOUBLE_EQ(it->second.avg, group.avg) << "Group " << key;
+        }
+    }
+};
+
+// Test SUM, COUNT(*), MIN, MAX and AVG per group over several batches
+TEST_F(HashAggregateTest, GroupedAggregates) {
+    std::vector<int64_t> keys = randomInts(0, 50, 10000);
+    std::vector<int64_t> values = randomInts(-1000, 1000, 10000, 7);
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", keys)
+        .addInt64Column(1, "col1", values)
+        .withBatchSizes({3000, 3000, 4000})
+        .build();
+
+    HashAggregateExec aggregateExec(input.get(), intKey(), intAggregates());
+    aggregateExec.initialize();
+
+    RowVector batch;
+    ASSERT_GT(aggregateExec.next(batch), 0);
+    EXPECT_EQ(aggregateExec.getTable().getGroupCount(), 50);
+    EXPECT_EQ(aggregateExec.getTable().getSpillCount(), 0);
+
+    // The first batch holds all 50 groups, the table emits nothing more afterwards
+    std::map<int64_t, IntGroup> groups;
+    for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+        groups[batch.getColumn(0).getEntry<db_int64>(row)] = {
+            batch.getColumn(1).getEntry<db_int64>(row),
+            batch.getColumn(2).getEntry<db_int64>(row),
+            batch.getColumn(3).getEntry<db_int64>(row),
+            batch.getColumn(4).getEntry<db_int64>(row),
+            batch.getColumn(5).getEntry<db_double>(row),
+        };
+    }
+    RowVector end;
+    EXPECT_EQ(aggregateExec.next(end), 0);
+
+    expectGroupsEqual(groups, expectedIntGroups(keys, values));
+}
+
+// Test that an aggregation without groups produces one row for an empty input
+TEST_F(HashAggregateTest, GlobalAggregateOnEmptyInput) {
+    auto input = std::make_unique<MockOperator>(&storage, std::vector<RowVector>{});
+    std::vector<AggregateSpec> aggregates = {
+        countStar(),
+        aggregate(AggregateFunction::SUM, 1, DataType::getInt64(), "sum"),
+        aggregate(AggregateFunction::MAX, 1, DataType::getInt64(), "max"),
+    };
+
+    HashAggregateExec aggregateExec(input.get(), {}, aggregates);
+    aggregateExec.initialize();
+
+    RowVector batch;
+    ASSERT_EQ(aggregateExec.next(batch), 1);
+    EXPECT_EQ(batch.getColumn(0).getEntry<db_int64>(0), 0);
+    EXPECT_TRUE(batch.getColumn(1).isNull(0));
+    EXPECT_TRUE(batch.getColumn(2).isNull(0));
+
+    RowVector end;
+    EXPECT_EQ(aggregateExec.next(end), 0);
+}
+
+// Test string keys, NULL keys forming their own group, and aggregates ignoring NULL inputs
+TEST_F(HashAggregateTest, NullsAndStrings) {
+    std::vector<ColumnDescriptor> schema = {
+        {ColumnId(0, "col0"), DataType::getString()},
+        {ColumnId(1, "col1"), DataType::getInt64()},
+    };
+    const std::string longKey = "a key longer than the inline length";
+
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch = allocator.allocateBatch(schema);
+    ColumnBuffer& keyCol = batch.getColumn(0);
+    ColumnBuffer& valueCol = batch.getColumn(1);
+
+    keyCol.writeString(0, "apple");
+    valueCol.writeEntry<db_int64>(0, 1);
+    keyCol.setNull(1);
+    valueCol.writeEntry<db_int64>(1, 2);
+    keyCol.writeString(2, longKey);
+    valueCol.setNull(2);
+    keyCol.writeString(3, "apple");
+    valueCol.writeEntry<db_int64>(3, 3);
+    keyCol.setNull(4);
+    valueCol.writeEntry<db_int64>(4, 4);
+    keyCol.writeString(5, longKey);
+    valueCol.setNull(5);
+    keyCol.count = 6;
+    valueCol.count = 6;
+    batch.setRowCount(6);
+
+    std::vector<AggregateSpec> aggregates = {
+        countStar(),
+        aggregate(AggregateFunction::COUNT, 1, DataType::getInt64(), "count"),
+        aggregate(AggregateFunction::SUM, 1, DataType::getInt64(), "sum"),
+    };
+    AggregateHashTable table({schema[0]}, aggregates, &bufferManager);
+    table.consume(batch);
+    EXPECT_EQ(table.getGroupCount(), 3);
+
+    RowVector result;
+    ASSERT_EQ(table.emit(result), 3);
+
+    bool sawNull = false;
+    for (int64_t row = 0; row < 3; ++row) {
+        const ColumnBuffer& key = result.getColumn(0);
+        int64_t countStarValue = result.getColumn(1).getEntry<db_int64>(row);
+        int64_t countValue = result.getColumn(2).getEntry<db_int64>(row);
+
+        if (key.isNull(row)) {
+            sawNull = true;
+            EXPECT_EQ(countStarValue, 2);
+            EXPECT_EQ(countValue, 2);
+            EXPECT_EQ(result.getColumn(3).getEntry<db_int64>(row), 6);
+        } else if (key.getEntry<db_string>(row).view() == "apple") {
+            EXPECT_EQ(countStarValue, 2);
+            EXPECT_EQ(countValue, 2);
+            EXPECT_EQ(result.getColumn(3).getEntry<db_int64>(row), 4);
+        } else {
+            EXPECT_EQ(key.getEntry<db_string>(row).view(), longKey);
+            EXPECT_EQ(countStarValue, 2);
+            EXPECT_EQ(countValue, 0);
+            EXPECT_TRUE(result.getColumn(3).isNull(row));
+        }
+    }
+    EXPECT_TRUE(sawNull);
+
+    // MIN and MAX over strings, without groups
+    AggregateHashTable minMax({}, {
+        aggregate(AggregateFunction::MIN, 0, DataType::getString(), "min"),
+        aggregate(AggregateFunction::MAX, 0, DataType::getString(), "max"),
+    }, &bufferManager);
+    minMax.consume(batch);
+    ASSERT_EQ(minMax.emit(result), 1);
+    EXPECT_EQ(result.getColumn(0).getEntry<db_string>(0).view(), longKey);
+    EXPECT_EQ(result.getColumn(1).getEntry<db_string>(0).view(), "apple");
+}
+
+// Test that a table over its memory budget spills and still produces every group exactly once
+TEST_F(HashAggregateTest, SpillsOverMemoryBudget) {
+    // Every key appears in two batches, so partial states of the same group end up on disk twice
+    std::vector<int64_t> keys = intSequence(0, 20000);
+    std::vector<int64_t> shuffled = randomInts(0, 20000, 20000, 3);
+    keys.insert(keys.end(), shuffled.begin(), shuffled.end());
+    std::vector<int64_t> values = randomInts(0, 100, 40000, 5);
+
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", keys)
+        .addInt64Column(1, "col1", values)
+        .withBatchSizes(std::vector<int64_t>(20, 2000))
+        .build();
+
+    HashAggregateExec aggregateExec(input.get(), intKey(), intAggregates(), 256 * 1024);
+    aggregateExec.initialize();
+
+    std::map<int64_t, IntGroup> groups;
+    while (true) {
+        RowVector batch;
+        int64_t count = aggregateExec.next(batch);
+        if (count == 0) {
+            break;
+        }
+        for (int64_t row = 0; row < count; ++row) {
+            int64_t key = batch.getColumn(0).getEntry<db_int64>(row);
+            EXPECT_FALSE(groups.contains(key)) << "Group " << key << " emitted twice";
+            groups[key] = {
+                batch.getColumn(1).getEntry<db_int64>(row),
+                batch.getColumn(2).getEntry<db_int64>(row),
+                batch.getColumn(3).getEntry<db_int64>(row),
+                batch.getColumn(4).getEntry<db_int64>(row),
+                batch.getColumn(5).getEntry<db_double>(row),
+            };
+        }
+    }
+
+    EXPECT_GT(aggregateExec.getTable().getSpillCount(), 0);
+    expectGroupsEqual(groups, expectedIntGroups(keys, values));
+}
+
+// Test per-worker partial aggregates merged by the sink of a parallel pipeline, in memory and spilled
+TEST_F(HashAggregateTest, ParallelSink) {
+    std::vector<int64_t> keys = randomInts(0, 5000, 50000);
+    std::vector<int64_t> values = randomInts(-50, 50, 50000, 11);
+    std::map<int64_t, IntGroup> expected = expectedIntGroups(keys, values);
+
+    for (size_t memoryBudget : {AggregateHashTable::DEFAULT_MEMORY_BUDGET, size_t{64 * 1024}}) {
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", keys)
+            .addInt64Column(1, "col1", values)
+            .withBatchSizes(std::vector<int64_t>(10, 5000))
+            .build();
+        OperatorMorselSource source(input.get(), &bufferManager);
+        HashAggregateSink sink(intKey(), intAggregates(), memoryBudget);
+
+        Pipeline pipeline;
+        pipeline.source = &source;
+        pipeline.sink = &sink;
+
+        PipelineExecutor executor(4, 256);
+        executor.run(pipeline);
+
+        AggregateHashTable& table = sink.getResult();
+        bool spilled = table.getSpillCount() > 0;
+        EXPECT_EQ(spilled, memoryBudget != AggregateHashTable::DEFAULT_MEMORY_BUDGET);
+        expectGroupsEqual(collectIntGroups(table), expected);
+    }
+}
+
+// Test partial states exported by the tables of two nodes, one of them spilled, merged by a third
+TEST_F(HashAggregateTest, MergesPartialStates) {
+    std::vector<int64_t> keys = randomInts(0, 5000, 40000);
+    std::vector<int64_t> values = randomInts(-50, 50, 40000, 13);
+    std::map<int64_t, IntGroup> expected = expectedIntGroups(keys, values);
+
+    std::vector<std::string> chunks;
+    for (size_t node = 0; node < 2; ++node) {
+        std::vector<int64_t> nodeKeys(keys.begin() + node * 20000, keys.begin() + (node + 1) * 20000);
+        std::vector<int64_t> nodeValues(values.begin() + node * 20000, values.begin() + (node + 1) * 20000);
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", nodeKeys)
+            .addInt64Column(1, "col1", nodeValues)
+            .withBatchSizes(std::vector<int64_t>(4, 5000))
+            .build();
+
+        AggregateHashTable table(intKey(), intAggregates(), &bufferManager,
+                                 node == 0 ? AggregateHashTable::DEFAULT_MEMORY_BUDGET : 64 * 1024);
+        input->initialize();
+        RowVector batch;
+        while (input->next(batch) > 0) {
+            table.consume(batch);
+        }
+        EXPECT_EQ(table.getSpillCount() > 0, node == 1);
+
+        int64_t exported = table.exportPartialStates([&chunks](std::string_view chunk) { chunks.emplace_back(chunk); },
+                                                     4096);
+        EXPECT_EQ(exported, static_cast<int64_t>(expectedIntGroups(nodeKeys, nodeValues).size()));
+    }
+    EXPECT_GT(chunks.size(), 2u);
+
+    AggregateHashTable coordinator(intKey(), intAggregates(), &bufferManager, 64 * 1024);
+    for (const std::string& chunk : chunks) {
+        coordinator.mergePartialStates(chunk);
+    }
+    EXPECT_GT(coordinator.getSpillCount(), 0);
+    expectGroupsEqual(collectIntGroups(coordinator), expected);
+
+    AggregateHashTable truncated(intKey(), intAggregates(), &bufferManager);
+    EXPECT_THROW(truncated.mergePartialStates(std::string_view(chunks.front()).substr(0, 13)), SQLRuntimeException);
+}
+
+// Test that an integer SUM overflowing while consuming rows or merging partial states fails
+TEST_F(HashAggregateTest, SumOverflow) {
+    constexpr int64_t max = std::numeric_limits<int64_t>::max();
+    std::vector<AggregateSpec> sum {aggregate(AggregateFunction::SUM, 1, DataType::getInt64(), "sum")};
+    auto consumeAll = [&](AggregateHashTable& table, const std::vector<int64_t>& values) {
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", std::vector<int64_t>(values.size(), 1))
+            .addInt64Column(1, "col1", values)
+            .build();
+        input->initialize();
+        RowVector batch;
+        while (input->next(batch) > 0) {
+            table.consume(batch);
+        }
+    };
+
+    // Sums up to the maximum are exact
+    AggregateHashTable exact(intKey(), sum, &bufferManager);
+    consumeAll(exact, {max - 1, 1, -max, max});
+    RowVector batch;
+    ASSERT_EQ(exact.emit(batch), 1);
+    EXPECT_EQ(batch.getColumn(1).getEntry<db_int64>(0), max);
+
+    AggregateHashTable overflowing(intKey(), sum, &bufferManager);
+    EXPECT_THROW(consumeAll(overflowing, {max - 1, 2}), SQLRuntimeException);
+
+    std::vector<std::string> chunks;
+    for (int64_t value : {max - 10, int64_t {11}}) {
+        AggregateHashTable node(intKey(), sum, &bufferManager);
+        consumeAll(node, {value});
+        node.exportPartialStates([&chunks](std::string_view chunk) { chunks.emplace_back(chunk); }, 4096);
+    }
+    AggregateHashTable coordinator(intKey(), sum, &bufferManager);
+    coordinator.mergePartialStates(chunks[0]);
+    EXPECT_THROW(coordinator.mergePartialStates(chunks[1]), SQLRuntimeException);
+}
+
+// Test APPROX_COUNT_DISTINCT and APPROX_QUANTILE per group, in memory, spilled and merged across workers
+TEST_F(HashAggregateTest, ApproximateAggregates) {
+    // Group k gets the values k, k + 64, k + 128, ..., 625 distinct values each, every value twice
+    std::vector<int64_t> values = intSequence(0, 40000);
+    values.insert(values.end(), values.begin(), values.end());
+    std::vector<int64_t> keys;
+    for (int64_t value : values) {
+        keys.push_back(value % 64);
+    }
+
+    AggregateSpec median = aggregate(AggregateFunction::APPROX_QUANTILE, 1, DataType::getInt64(), "median");
+    AggregateSpec p90 = aggregate(AggregateFunction::APPROX_QUANTILE, 1, DataType::getInt64(), "p90");
+    p90.quantile = 0.9;
+    std::vector<AggregateSpec> aggregates = {
+        aggregate(AggregateFunction::APPROX_COUNT_DISTINCT, 1, DataType::getInt64(), "distinct"),
+        median,
+        p90,
+    };
+
+    auto expectEstimates = [](const std::function<int64_t(RowVector&)>& next) {
+        size_t groupCount = 0;
+        while (true) {
+            RowVector batch;
+            int64_t count = next(batch);
+            if (count == 0) {
+                break;
+            }
+            for (int64_t row = 0; row < count; ++row) {
+                auto key = static_cast<double>(batch.getColumn(0).getEntry<db_int64>(row));
+                EXPECT_NEAR(static_cast<double>(batch.getColumn(1).getEntry<db_int64>(row)), 625.0, 60.0) << "Group " << key;
+                // The rank error of the sketches is below 1% of the 40000 values
+                EXPECT_NEAR(batch.getColumn(2).getEntry<db_double>(row), 20000.0 + key, 800.0) << "Group " << key;
+                EXPECT_NEAR(batch.getColumn(3).getEntry<db_double>(row), 36000.0 + key, 800.0) << "Group " << key;
+                ++groupCount;
+            }
+        }
+        EXPECT_EQ(groupCount, 64u);
+    };
+
+    for (size_t memoryBudget : {AggregateHashTable::DEFAULT_MEMORY_BUDGET, size_t{64 * 1024}}) {
+        bool spill = memoryBudget != AggregateHashTable::DEFAULT_MEMORY_BUDGET;
+
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", keys)
+            .addInt64Column(1, "col1", values)
+            .withBatchSizes(std::vector<int64_t>(40, 2000))
+            .build();
+        HashAggregateExec aggregateExec(input.get(), intKey(), aggregates, memoryBudget);
+        aggregateExec.initialize();
+        expectEstimates([&](RowVector& batch) { return aggregateExec.next(batch); });
+        EXPECT_EQ(aggregateExec.getTable().getSpillCount() > 0, spill);
+
+        auto parallelInput = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", keys)
+            .addInt64Column(1, "col1", values)
+            .withBatchSizes(std::vector<int64_t>(40, 2000))
+            .build();
+        OperatorMorselSource source(parallelInput.get(), &bufferManager);
+        HashAggregateSink sink(intKey(), aggregates, memoryBudget);
+
+        Pipeline pipeline;
+        pipeline.source = &source;
+        pipeline.sink = &sink;
+
+        PipelineExecutor executor(4, 256);
+        executor.run(pipeline);
+
+        AggregateHashTable& table = sink.getResult();
+        EXPECT_EQ(table.getSpillCount() > 0, spill);
+        expectEstimates([&](RowVector& batch) { return table.emit(batch); });
+    }
+}
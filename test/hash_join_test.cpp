@@ -0,0 +1,477 @@
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include "engine/filter.hpp"
+#include "common/metrics.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/radix_hash_join.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+/**
+ * @brief Passes the batches of its input through, applying the runtime filter pushed into it
+ */
+class RuntimeFilterProbe : public PhysicalOperator {
+private:
+    PhysicalOperator* input_;
+    std::optional<BatchFilter> filter_;
+
+public:
+    int64_t passedRows = 0;
+
+    explicit RuntimeFilterProbe(PhysicalOperator* input) : input_(input) {}
+
+    bool hasFilter() const noexcept {
+        return filter_.has_value();
+    }
+
+    void initialize() override {
+        input_->initialize();
+    }
+
+    bool pushRuntimeFilter(const PredicateExpr& filter) override {
+        filter_.emplace(filter.clone());
+        filter_->initialize();
+        return true;
+    }
+
+    int64_t next(RowVector& out) override {
+        int64_t count = input_->next(out);
+        if (count > 0 && filter_) {
+            count = filter_->apply(out);
+        }
+        passedRows += count;
+        return count;
+    }
+};
+
+class HashJoinTest : public ::testing::Test {
+   protected:
+    std::unique_ptr<ColumnRefExpr> intKey(uint64_t id, const std::string& name) {
+        return std::make_unique<ColumnRefExpr>(ColumnId(id, name), DataType::getInt64());
+    }
+
+    std::unique_ptr<ColumnRefExpr> doubleKey(uint64_t id, const std::string& name) {
+        return std::make_unique<ColumnRefExpr>(ColumnId(id, name), DataType::getDouble());
+    }
+
+    // Collect (build value, probe value) pairs of a join over two int64 columns. NULL is mapped to -1.
+    std::multimap<int64_t, int64_t> collectPairs(PhysicalOperator& join) {
+        std::multimap<int64_t, int64_t> pairs;
+        while (true) {
+            RowVector batch;
+            int64_t count = join.next(batch);
+            if (count == 0) {
+                break;
+            }
+            EXPECT_EQ(batch.getColumnCount(), 2);
+            const ColumnBuffer& left = batch.getColumn(0);
+            const ColumnBuffer& right = batch.getColumn(1);
+            for (int64_t i = 0; i < count; ++i) {
+                int64_t l = left.isNull(i) ? -1 : left.getEntry<db_int64>(i);
+                int64_t r = right.isNull(i) ? -1 : right.getEntry<db_int64>(i);
+                pairs.emplace(l, r);
+            }
+        }
+        return pairs;
+    }
+};
+
+// Test basic hash join on a single key column
+TEST_F(HashJoinTest, BasicEqualityJoin) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {2, 3, 4}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    auto pairs = collectPairs(join);
+
+    std::multimap<int64_t, int64_t> expected = {{2, 2}, {3, 3}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test that the output contains the build columns followed by the probe columns
+TEST_F(HashJoinTest, OutputSchema) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "id", {1, 2})
+        .addDoubleColumn(1, "price", {1.5, 2.5})
+        .build();
+    auto rightOp = MockOperatorBuilder(&storage)
+        .addInt64Column(2, "order_id", {2, 2, 1})
+        .build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "id"), intKey(2, "order_id"));
+    join.initialize();
+
+    RowVector output;
+    int64_t resultCount = join.next(output);
+
+    ASSERT_EQ(resultCount, 3);
+    ASSERT_EQ(output.getColumnCount(), 3);
+    EXPECT_EQ(output.getColumn(0).columnId, ColumnId(0, "id"));
+    EXPECT_EQ(output.getColumn(1).columnId, ColumnId(1, "price"));
+    EXPECT_EQ(output.getColumn(2).columnId, ColumnId(2, "order_id"));
+
+    for (int64_t i = 0; i < resultCount; ++i) {
+        int64_t id = output.getColumn(0).getEntry<db_int64>(i);
+        EXPECT_EQ(id, output.getColumn(2).getEntry<db_int64>(i));
+        EXPECT_DOUBLE_EQ(output.getColumn(1).getEntry<db_double>(i), id == 1 ? 1.5 : 2.5);
+    }
+
+    RowVector end;
+    EXPECT_EQ(join.next(end), 0);
+}
+
+// Test join with duplicate keys on both sides
+TEST_F(HashJoinTest, DuplicateKeys) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1, 1, 1, 3}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    // 2 build rows x 3 probe rows for key 1, 1 x 1 for key 3
+    EXPECT_EQ(drainOperator(join), 7);
+}
+
+// Test join with no matching keys
+TEST_F(HashJoinTest, NoMatches) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {4, 5, 6}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    EXPECT_EQ(drainOperator(join), 0);
+}
+
+// Test join with empty inputs
+TEST_F(HashJoinTest, EmptyInputs) {
+    ColumnBufferStorage storage;
+
+    auto emptyBuild = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {}).build();
+    auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1, 2}).build();
+    HashJoinExec emptyBuildJoin(emptyBuild.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"));
+    emptyBuildJoin.initialize();
+    EXPECT_EQ(drainOperator(emptyBuildJoin), 0);
+
+    auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2}).build();
+    auto emptyProbe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {}).build();
+    HashJoinExec emptyProbeJoin(build.get(), emptyProbe.get(), intKey(0, "col0"), intKey(1, "col1"));
+    emptyProbeJoin.initialize();
+    EXPECT_EQ(drainOperator(emptyProbeJoin), 0);
+}
+
+// Test join where both inputs arrive in multiple batches
+TEST_F(HashJoinTest, MultipleBatches) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", intSequence(0, 1000))
+        .withBatchSizes({100, 300, 250, 350})
+        .build();
+    auto rightOp = MockOperatorBuilder(&storage)
+        .addInt64Column(1, "col1", randomInts(0, 1999, 3000))
+        .withBatchSizes({1000, 1, 999, 1000})
+        .build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    int64_t expected = 0;
+    for (int64_t value : randomInts(0, 1999, 3000)) {
+        if (value < 1000) {
+            ++expected;
+        }
+    }
+
+    EXPECT_EQ(drainOperator(join), expected);
+}
+
+// Test that a result larger than one output batch is split across calls to next()
+TEST_F(HashJoinTest, OutputSpansMultipleBatches) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", std::vector<int64_t>(100, 7)).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", std::vector<int64_t>(1000, 7)).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    int64_t batches = 0;
+    int64_t total = 0;
+    while (true) {
+        RowVector batch;
+        int64_t count = join.next(batch);
+        if (count == 0) {
+            break;
+        }
+        EXPECT_EQ(batch.getRowCount(), count);
+        total += count;
+        ++batches;
+    }
+
+    EXPECT_EQ(total, 100000);
+    EXPECT_GT(batches, 1);
+}
+
+// Test left outer join: unmatched build rows have NULL probe columns
+TEST_F(HashJoinTest, LeftJoin) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {2, 2, 4}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::LEFT);
+    join.initialize();
+
+    auto pairs = collectPairs(join);
+
+    std::multimap<int64_t, int64_t> expected = {{1, -1}, {2, 2}, {2, 2}, {3, -1}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test right outer join: unmatched probe rows have NULL build columns
+TEST_F(HashJoinTest, RightJoin) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage)
+        .addInt64Column(1, "col1", {2, 5, 3, 6})
+        .withBatchSizes({1, 3})
+        .build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::RIGHT);
+    join.initialize();
+
+    auto pairs = collectPairs(join);
+
+    std::multimap<int64_t, int64_t> expected = {{-1, 5}, {-1, 6}, {2, 2}, {3, 3}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test full outer join
+TEST_F(HashJoinTest, FullOuterJoin) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {2, 3}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::FULL_OUTER);
+    join.initialize();
+
+    auto pairs = collectPairs(join);
+
+    std::multimap<int64_t, int64_t> expected = {{-1, 3}, {1, -1}, {2, 2}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test outer joins against an empty input
+TEST_F(HashJoinTest, OuterJoinWithEmptyInput) {
+    ColumnBufferStorage storage;
+
+    auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2}).build();
+    auto emptyProbe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {}).build();
+    HashJoinExec leftJoin(build.get(), emptyProbe.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::LEFT);
+    leftJoin.initialize();
+    EXPECT_EQ(drainOperator(leftJoin), 2);
+
+    auto emptyBuild = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {}).build();
+    auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1, 2, 3}).build();
+    HashJoinExec rightJoin(emptyBuild.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::RIGHT);
+    rightJoin.initialize();
+    EXPECT_EQ(drainOperator(rightJoin), 3);
+}
+
+// Test join on double keys, and on a double key against an integer key
+TEST_F(HashJoinTest, DoubleKeys) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addDoubleColumn(0, "col0", {1.0, 2.5, -0.0}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addDoubleColumn(1, "col1", {2.5, 0.0, 3.0}).build();
+
+    HashJoinExec join(leftOp.get(), rightOp.get(), doubleKey(0, "col0"), doubleKey(1, "col1"));
+    join.initialize();
+    EXPECT_EQ(drainOperator(join), 2);
+
+    auto doubleOp = MockOperatorBuilder(&storage).addDoubleColumn(0, "col0", {1.0, 2.5}).build();
+    auto intOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1, 2}).build();
+
+    HashJoinExec mixedJoin(doubleOp.get(), intOp.get(), doubleKey(0, "col0"), intKey(1, "col1"));
+    mixedJoin.initialize();
+    EXPECT_EQ(drainOperator(mixedJoin), 1);
+}
+
+// Test that unsupported join configurations are rejected
+TEST_F(HashJoinTest, InvalidJoins) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1}).build();
+
+    EXPECT_THROW(HashJoinExec(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::CROSS),
+                 InternalSQLError);
+
+    auto stringKey = std::make_unique<ColumnRefExpr>(ColumnId(1, "col1"), DataType::getString());
+    EXPECT_THROW(HashJoinExec(leftOp.get(), rightOp.get(), intKey(0, "col0"), std::move(stringKey)),
+                 InternalSQLError);
+}
+
+// Test that the runtime filter of the build keys drops probe rows without a partner, but no matches
+TEST_F(HashJoinTest, RuntimeFilterDropsProbeRows) {
+    ColumnBufferStorage storage;
+
+    std::vector<int64_t> buildKeys;
+    for (int64_t i = 0; i < 1000; ++i) {
+        buildKeys.push_back(i * 100);
+    }
+    std::vector<int64_t> probeKeys;
+    for (int64_t i = 0; i < 100000; ++i) {
+        probeKeys.push_back(i);
+    }
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", buildKeys).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", probeKeys).build();
+    RuntimeFilterProbe probe(rightOp.get());
+
+    HashJoinExec join(leftOp.get(), &probe, intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    auto pairs = collectPairs(join);
+    EXPECT_EQ(pairs.size(), 1000u);
+    for (const auto& [build, probeKey] : pairs) {
+        EXPECT_EQ(build, probeKey);
+    }
+
+    // The Bloom filter lets through less than 1% of the rows without a partner
+    ASSERT_TRUE(probe.hasFilter());
+    EXPECT_GE(probe.passedRows, 1000);
+    EXPECT_LT(probe.passedRows, 2000);
+}
+
+// Test that no runtime filter is pushed if the probe rows are preserved
+TEST_F(HashJoinTest, NoRuntimeFilterForPreservedProbe) {
+    ColumnBufferStorage storage;
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2, 3}).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {2, 5, 3, 6}).build();
+    RuntimeFilterProbe probe(rightOp.get());
+
+    HashJoinExec join(leftOp.get(), &probe, intKey(0, "col0"), intKey(1, "col1"), JoinType::RIGHT);
+    join.initialize();
+
+    EXPECT_EQ(drainOperator(join), 4);
+    EXPECT_FALSE(probe.hasFilter());
+}
+
+// Test that the radix join produces the same rows as the hash join, for every join type
+TEST_F(HashJoinTest, RadixJoinMatchesHashJoin) {
+    ColumnBufferStorage storage;
+
+    for (JoinType joinType : {JoinType::INNER, JoinType::LEFT, JoinType::RIGHT, JoinType::FULL_OUTER}) {
+        auto makeBuild = [&] {
+            return MockOperatorBuilder(&storage)
+                .addInt64Column(0, "col0", randomInts(0, 5000, 20000))
+                .withBatchSizes({5000, 5000, 5000, 5000})
+                .build();
+        };
+        auto makeProbe = [&] {
+            return MockOperatorBuilder(&storage).addInt64Column(1, "col1", randomInts(2500, 7500, 30000, 7)).build();
+        };
+
+        auto build = makeBuild();
+        auto probe = makeProbe();
+        HashJoinExec hashJoin(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), joinType);
+        hashJoin.initialize();
+
+        auto radixBuild = makeBuild();
+        auto radixProbe = makeProbe();
+        RadixHashJoinExec radixJoin(radixBuild.get(), radixProbe.get(), intKey(0, "col0"), intKey(1, "col1"),
+                                    joinType, 4);
+        radixJoin.initialize();
+
+        // Rows arrive in a different order, also for equal build values
+        using PairSet = std::multiset<std::pair<int64_t, int64_t>>;
+        auto radixPairs = collectPairs(radixJoin);
+        auto hashPairs = collectPairs(hashJoin);
+        EXPECT_EQ(PairSet(radixPairs.begin(), radixPairs.end()), PairSet(hashPairs.begin(), hashPairs.end()));
+    }
+}
+
+// Test that partitions larger than the L2 target are split by further passes
+TEST_F(HashJoinTest, RadixJoinLargeBuild) {
+    ColumnBufferStorage storage;
+
+    // About 20 bytes per encoded row, so the partitions exceed PARTITION_TARGET_BYTES
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 2000000)).build();
+    auto rightOp = MockOperatorBuilder(&storage).addInt64Column(1, "col1", randomInts(0, 3999999, 100000)).build();
+
+    RadixHashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::INNER, 4);
+    join.initialize();
+
+    int64_t expected = 0;
+    for (int64_t value : randomInts(0, 3999999, 100000)) {
+        if (value < 2000000) {
+            ++expected;
+        }
+    }
+
+    auto pairs = collectPairs(join);
+    EXPECT_EQ(static_cast<int64_t>(pairs.size()), expected);
+    for (const auto& [build, probe] : pairs) {
+        EXPECT_EQ(build, probe);
+    }
+}
+
+// Test that partitions exceeding the memory budget are spilled and joined from disk
+TEST_F(HashJoinTest, RadixJoinSpills) {
+    ColumnBufferStorage storage;
+
+    metrics::Counter& spilledBytes = metrics::MetricsRegistry::global().counter(
+        "toydb_spill_bytes_total", "Bytes written to spill files", {{"operator", "join"}});
+    uint64_t spilledBefore = spilledBytes.get();
+
+    auto leftOp = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 200000)).build();
+    auto rightOp = MockOperatorBuilder(&storage)
+        .addInt64Column(1, "col1", intSequence(100000, 200000))
+        .withBatchSizes({50000, 50000, 50000, 50000})
+        .build();
+
+    RadixHashJoinExec join(leftOp.get(), rightOp.get(), intKey(0, "col0"), intKey(1, "col1"), JoinType::FULL_OUTER,
+                           2, 1024 * 1024);
+    join.initialize();
+
+    int64_t matched = 0;
+    int64_t buildOnly = 0;
+    int64_t probeOnly = 0;
+    for (const auto& [build, probe] : collectPairs(join)) {
+        if (build == -1) {
+            ++probeOnly;
+        } else if (probe == -1) {
+            ++buildOnly;
+        } else {
+            EXPECT_EQ(build, probe);
+            ++matched;
+        }
+    }
+    EXPECT_EQ(matched, 100000);
+    EXPECT_EQ(buildOnly, 100000);
+    EXPECT_EQ(probeOnly, 100000);
+    EXPECT_GT(spilledBytes.get(), spilledBefore);
+}
@@ -448,10 +448,6 @@ TEST_F(InterpreterTest, AmbiguousColumnError) {
         {"amount", DataType::getDouble()}
     });
 
-    // TODO: Parser doesn't support multiple tables yet
-    // Once parser supports multiple tables, replace this with:
-    // Parser parser("SELECT id FROM users, orders");
-
     // Manually construct AST with multiple tables
     auto selectFrom = std::make_unique<ast::SelectFrom>();
     selectFrom->columns.emplace_back("id");
@@ -459,16 +455,12 @@ TEST_F(InterpreterTest, AmbiguousColumnError) {
     selectFrom->tables.emplace_back(ast::Table("users"));
     selectFrom->tables.emplace_back(ast::Table("orders"));
 
-    ast::QueryAST ast(selectFrom.release());
+    ast::QueryAST ast(selectFrom.get());
 
     // Should throw an exception due to ambiguous column
-    /*
     EXPECT_THROW({
         auto plan = interpreter_->interpret(ast);
     }, UnresolvedColumnException);
-    */
-
-    // TODO: throws NotYetImplementedError at the moment
 }
 
 TEST_F(InterpreterTest, AmbiguousColumnResolvedWithQualified) {
@@ -478,11 +470,7 @@ TEST_F(InterpreterTest, AmbiguousColumnResolvedWithQualified) {
         {"amount", DataType::getDouble()}
     });
 
-    // TODO: Interpreter doesn't support multiple tables yet
-    // Once multiple tables are supported, this should succeed
-    // Parser parser("SELECT users.id, orders.id FROM users, orders");
-
-    // Manually construct AST with qualified references (parser supports qualified, but not multiple tables)
+    // Manually construct AST with qualified references
     auto selectFrom = std::make_unique<ast::SelectFrom>();
     selectFrom->columns.emplace_back("users", "id", "");
     selectFrom->columns.emplace_back("orders", "id", "");
@@ -490,9 +478,23 @@ TEST_F(InterpreterTest, AmbiguousColumnResolvedWithQualified) {
     selectFrom->tables.emplace_back(ast::Table("users"));
     selectFrom->tables.emplace_back(ast::Table("orders"));
 
-    ast::QueryAST ast(selectFrom.release());
+    ast::QueryAST ast(selectFrom.get());
+
+    auto plan = interpreter_->interpret(ast);
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
 
-    // TODO: Implement this, currently it fails
+    // Tables are combined in FROM order
+    auto* projection = expectProjectionRoot(*plan);
+    ASSERT_EQ(projection->getColumns().size(), 2u);
+    auto* crossProduct = dynamic_cast<CrossProductOp*>(projection->getChild(0).get());
+    ASSERT_NE(crossProduct, nullptr);
+    auto* usersScan = dynamic_cast<TableScanOp*>(crossProduct->getChild(0).get());
+    auto* ordersScan = dynamic_cast<TableScanOp*>(crossProduct->getChild(1).get());
+    ASSERT_NE(usersScan, nullptr);
+    ASSERT_NE(ordersScan, nullptr);
+    EXPECT_EQ(usersScan->getColumns()[0].getTableId().getName(), "users");
+    EXPECT_EQ(ordersScan->getColumns()[0].getTableId().getName(), "orders");
+    EXPECT_NE(projection->getColumns()[0], projection->getColumns()[1]);
 }
 
 TEST_F(InterpreterTest, SelectStarNoProjection) {
@@ -590,3 +592,180 @@ TEST_F(InterpreterTest, InvalidTableQualifierInWhere) {
         auto plan = interpreter_->interpret(*result.value());
     }, UnresolvedColumnException);
 }
+
+TEST_F(InterpreterTest, SelectWithGroupBy) {
+    Parser parser("SELECT COUNT(*) AS n, age, AVG(id) FROM users WHERE id > 1 GROUP BY age");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    // The projection restores the order of the selected columns
+    auto* projection = dynamic_cast<ProjectionOp*>(plan->getRoot());
+    ASSERT_NE(projection, nullptr);
+    const auto& columns = projection->getColumns();
+    ASSERT_EQ(columns.size(), 3);
+    EXPECT_EQ(columns[0].getName(), "n");
+    EXPECT_EQ(columns[1].getName(), "age");
+    EXPECT_EQ(columns[2].getName(), "AVG(id)");
+
+    auto* aggregate = dynamic_cast<AggregateOp*>(projection->getChild(0).get());
+    ASSERT_NE(aggregate, nullptr);
+    ASSERT_EQ(aggregate->getGroupBy().size(), 1);
+    EXPECT_EQ(aggregate->getGroupBy()[0].columnId.getName(), "age");
+
+    const auto& aggregates = aggregate->getAggregates();
+    ASSERT_EQ(aggregates.size(), 2);
+    EXPECT_EQ(aggregates[0].function, AggregateFunction::COUNT_STAR);
+    EXPECT_EQ(aggregates[1].function, AggregateFunction::AVG);
+    EXPECT_EQ(aggregates[1].input.getName(), "id");
+    EXPECT_EQ(aggregates[1].getResultType(), DataType::getDouble());
+    EXPECT_EQ(columns[0], aggregates[0].output);
+
+    EXPECT_NE(dynamic_cast<FilterOp*>(aggregate->getChild(0).get()), nullptr);
+}
+
+TEST_F(InterpreterTest, GroupByErrors) {
+    // Selected columns must be grouped or aggregated
+    Parser ungrouped("SELECT name, COUNT(*) FROM users GROUP BY age");
+    auto result = ungrouped.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+    EXPECT_THROW(interpreter_->interpret(*result.value()), UnresolvedColumnException);
+
+    Parser sumOfStrings("SELECT SUM(name) FROM users");
+    result = sumOfStrings.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+    EXPECT_THROW(interpreter_->interpret(*result.value()), InternalSQLError);
+}
+
+TEST_F(InterpreterTest, SelectWithOrderBy) {
+    Parser parser("SELECT name FROM users ORDER BY age DESC");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    // The sort column does not have to be selected, so the sort is below the projection
+    auto* projection = dynamic_cast<ProjectionOp*>(plan->getRoot());
+    ASSERT_NE(projection, nullptr);
+    auto* sort = dynamic_cast<SortOp*>(projection->getChild(0).get());
+    ASSERT_NE(sort, nullptr);
+    ASSERT_EQ(sort->getKeys().size(), 1);
+    EXPECT_EQ(sort->getKeys()[0].column.getName(), "age");
+    EXPECT_EQ(sort->getKeys()[0].type, DataType::getInt32());
+    EXPECT_FALSE(sort->getKeys()[0].ascending);
+}
+
+TEST_F(InterpreterTest, OrderByAggregate) {
+    Parser parser("SELECT age, COUNT(*) AS n FROM users GROUP BY age ORDER BY n");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    auto* sort = dynamic_cast<SortOp*>(plan->getRoot()->getChild(0).get());
+    ASSERT_NE(sort, nullptr);
+    EXPECT_EQ(sort->getKeys()[0].column.getName(), "n");
+    EXPECT_EQ(sort->getKeys()[0].type, DataType::getInt64());
+    EXPECT_NE(dynamic_cast<AggregateOp*>(sort->getChild(0).get()), nullptr);
+
+    // Only group columns and aggregates exist above the aggregation
+    Parser ungrouped("SELECT age, COUNT(*) FROM users GROUP BY age ORDER BY name");
+    result = ungrouped.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+    EXPECT_THROW(interpreter_->interpret(*result.value()), UnresolvedColumnException);
+}
+
+TEST_F(InterpreterTest, SelectWithLimit) {
+    // A sort followed by a limit becomes a top-n
+    Parser parser("SELECT name FROM users ORDER BY age LIMIT 5");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    auto* projection = dynamic_cast<ProjectionOp*>(plan->getRoot());
+    ASSERT_NE(projection, nullptr);
+    auto* topN = dynamic_cast<TopNOp*>(projection->getChild(0).get());
+    ASSERT_NE(topN, nullptr);
+    EXPECT_EQ(topN->getLimit(), 5);
+    ASSERT_EQ(topN->getKeys().size(), 1);
+    EXPECT_EQ(topN->getKeys()[0].column.getName(), "age");
+    EXPECT_NE(dynamic_cast<TableScanOp*>(topN->getChild(0).get()), nullptr);
+
+    Parser unordered("SELECT name FROM users LIMIT 3");
+    result = unordered.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+    auto* limit = dynamic_cast<LimitOp*>(plan->getRoot()->getChild(0).get());
+    ASSERT_NE(limit, nullptr);
+    EXPECT_EQ(limit->getLimit(), 3);
+}
+
+TEST_F(InterpreterTest, ComputedColumns) {
+    Parser parser("SELECT id, age * 2 + 1.5 AS score, UPPER(name) || '!' FROM users");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    auto* projection = dynamic_cast<ProjectionOp*>(plan->getRoot());
+    ASSERT_NE(projection, nullptr);
+    const auto& columns = projection->getColumns();
+    ASSERT_EQ(columns.size(), 3);
+    EXPECT_EQ(columns[0].getName(), "id");
+    EXPECT_EQ(projection->getExpression(0), nullptr);
+
+    // Operands are cast to their common type
+    EXPECT_EQ(columns[1].getName(), "score");
+    ASSERT_NE(projection->getExpression(1), nullptr);
+    EXPECT_EQ(projection->getExpression(1)->getType(), DataType::getDouble());
+    EXPECT_EQ(projection->getExpression(1)->toString(), "(CAST((age * 2) AS DOUBLE) + 1.5)");
+
+    EXPECT_EQ(columns[2].getName(), "CONCAT(UPPER(name), '!')");
+    EXPECT_EQ(projection->getExpression(2)->getType(), DataType::getString());
+    EXPECT_NE(columns[1], columns[2]);
+}
+
+TEST_F(InterpreterTest, AggregateOfComputedColumn) {
+    Parser parser("SELECT age, SUM(id * age) AS total FROM users GROUP BY age");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+
+    auto plan = interpreter_->interpret(*result.value());
+    ASSERT_TRUE(plan.has_value()) << "Failed to interpret query";
+
+    // The argument is computed below the aggregation
+    auto* aggregate = dynamic_cast<AggregateOp*>(plan->getRoot()->getChild(0).get());
+    ASSERT_NE(aggregate, nullptr);
+    const AggregateSpec& sum = aggregate->getAggregates()[0];
+    EXPECT_EQ(sum.inputType, DataType::getInt32());
+    EXPECT_EQ(sum.input.getName(), "id * age");
+
+    auto* projection = dynamic_cast<ProjectionOp*>(aggregate->getChild(0).get());
+    ASSERT_NE(projection, nullptr);
+    EXPECT_EQ(projection->getColumns().back(), sum.input);
+    EXPECT_NE(projection->getExpression(projection->getColumns().size() - 1), nullptr);
+}
+
+TEST_F(InterpreterTest, ComputedColumnErrors) {
+    auto interpret = [&](const std::string& query) {
+        Parser parser(query);
+        auto result = parser.parseQuery();
+        EXPECT_TRUE(result.has_value()) << "Failed to parse query. Error: " << result.error();
+        return interpreter_->interpret(*result.value());
+    };
+    EXPECT_THROW(interpret("SELECT name + 1 FROM users"), InternalSQLError);
+    EXPECT_THROW(interpret("SELECT NULL FROM users"), InternalSQLError);
+    EXPECT_THROW(interpret("SELECT CAST(name AS INTEGER) + id > 1 FROM users"), NotYetImplementedError);
+    EXPECT_THROW(interpret("SELECT age + 1, COUNT(*) FROM users GROUP BY age"), NotYetImplementedError);
+    EXPECT_THROW(interpret("SELECT id FROM users WHERE COUNT(*) > 1"), InternalSQLError);
+    EXPECT_THROW(interpret("SELECT CAST('abc' AS INTEGER) FROM users"), SQLRuntimeException);
+}
@@ -0,0 +1,286 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "planner/join_order_optimizer.hpp"
+#include "planner/physical_planner.hpp"
+#include "storage/catalog.hpp"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+// A star schema: sales references customers, products and stores
+static const char* STAR_MANIFEST = R"({
+  "tables": [
+    {
+      "name": "sales", "id": 1, "id_name": "sales", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64"},
+        {"name": "customer_id", "type": "INT64", "stats": {"distinct_count": 100000}},
+        {"name": "product_id", "type": "INT64", "stats": {"distinct_count": 1000}},
+        {"name": "store_id", "type": "INT64", "stats": {"distinct_count": 10}}
+      ],
+      "files": [{"path": "sales_1.csv", "row_count": 600000}, {"path": "sales_2.csv", "row_count": 400000}]
+    },
+    {
+      "name": "customers", "id": 2, "id_name": "customers", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64", "stats": {"distinct_count": 100000, "min": 1, "max": 100000}},
+        {"name": "region", "type": "INT64", "stats": {"distinct_count": 10, "null_fraction": 0.2, "min": 1, "max": 10}}
+      ],
+      "files": [{"path": "customers.csv", "row_count": 100000}]
+    },
+    {
+      "name": "products", "id": 3, "id_name": "products", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64"},
+        {"name": "category", "type": "INT64", "stats": {"distinct_count": 50}}
+      ],
+      "files": [{"path": "products.csv", "row_count": 1000}]
+    },
+    {
+      "name": "stores", "id": 4, "id_name": "stores", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64"},
+        {"name": "country", "type": "INT64"}
+      ],
+      "files": [{"path": "stores.csv", "row_count": 10}]
+    }
+  ]
+})";
+
+class JoinOrderOptimizerTest : public ::testing::Test {
+   protected:
+    fs::path tempDir_;
+    std::unique_ptr<JsonCatalog> catalog_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "join_order_optimizer_test";
+        fs::create_directories(tempDir_);
+        std::ofstream(tempDir_ / "manifest.json") << STAR_MANIFEST;
+        catalog_ = std::make_unique<JsonCatalog>(tempDir_ / "manifest.json");
+    }
+
+    void TearDown() override {
+        if (fs::exists(tempDir_)) {
+            fs::remove_all(tempDir_);
+        }
+    }
+
+    ColumnId column(const std::string& table, const std::string& name) {
+        auto tableId = catalog_->getTableIdByName(table);
+        EXPECT_TRUE(tableId.has_value());
+        auto colId = catalog_->resolveColumn(*tableId, name);
+        EXPECT_TRUE(colId.has_value());
+        return *colId;
+    }
+
+    std::shared_ptr<TableScanOp> scan(const std::string& table) {
+        auto tableId = catalog_->getTableIdByName(table);
+        auto handle = catalog_->getTableHandle(*tableId);
+        return std::make_shared<TableScanOp>((*handle)->getColumnIds());
+    }
+
+    static std::unique_ptr<PredicateExpr> equals(const ColumnId& left, const ColumnId& right) {
+        return std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(left, DataType::getInt64()),
+                                             std::make_unique<ColumnRefExpr>(right, DataType::getInt64()));
+    }
+
+    static std::unique_ptr<PredicateExpr> compare(CompareOp op, const ColumnId& col, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(col, DataType::getInt64()),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+
+    static std::unique_ptr<PredicateExpr> conjunction(std::vector<std::unique_ptr<PredicateExpr>> conjuncts) {
+        std::unique_ptr<PredicateExpr> result = std::move(conjuncts[0]);
+        for (size_t i = 1; i < conjuncts.size(); ++i) {
+            result = std::make_unique<LogicalExpr>(CompareOp::AND, std::move(result), std::move(conjuncts[i]));
+        }
+        return result;
+    }
+
+    // Cross products of the tables in FROM order with the WHERE clause above, as the interpreter plans them
+    std::shared_ptr<LogicalOperator> fromWhere(const std::vector<std::string>& tables,
+                                               std::unique_ptr<PredicateExpr> where) {
+        std::shared_ptr<LogicalOperator> current = scan(tables[0]);
+        for (size_t i = 1; i < tables.size(); ++i) {
+            auto crossProduct = std::make_shared<CrossProductOp>();
+            crossProduct->addChild(current);
+            crossProduct->addChild(scan(tables[i]));
+            current = crossProduct;
+        }
+        auto filter = std::make_shared<FilterOp>(std::move(where));
+        filter->addChild(current);
+        return filter;
+    }
+
+    static void collect(const LogicalOperator* op, std::vector<const JoinOp*>& joins, int& crossProducts) {
+        if (auto* join = dynamic_cast<const JoinOp*>(op)) {
+            joins.push_back(join);
+        }
+        if (dynamic_cast<const CrossProductOp*>(op)) {
+            ++crossProducts;
+        }
+        for (const auto& child : op->getChildren()) {
+            collect(child.get(), joins, crossProducts);
+        }
+    }
+
+    static std::set<std::string> tablesOf(const LogicalOperator* op) {
+        std::set<std::string> tables;
+        if (auto* scan = dynamic_cast<const TableScanOp*>(op)) {
+            tables.insert(scan->getColumns()[0].getTableId().getName());
+        }
+        for (const auto& child : op->getChildren()) {
+            auto childTables = tablesOf(child.get());
+            tables.insert(childTables.begin(), childTables.end());
+        }
+        return tables;
+    }
+};
+
+// Test that the catalog provides row counts and the column statistics of the manifest
+TEST_F(JoinOrderOptimizerTest, CatalogStatistics) {
+    EXPECT_EQ(catalog_->getRowCount(*catalog_->getTableIdByName("sales")), 1000000);
+
+    auto region = catalog_->getColumnStatistics(column("customers", "region"));
+    ASSERT_TRUE(region.has_value());
+    EXPECT_EQ(region->distinctCount, 10);
+    EXPECT_EQ(region->rowCount, 100000);
+    EXPECT_EQ(region->nullCount, 20000);
+    EXPECT_TRUE(region->hasMinMax);
+    EXPECT_EQ(region->intMin, 1);
+    EXPECT_EQ(region->intMax, 10);
+
+    EXPECT_FALSE(catalog_->getColumnStatistics(column("stores", "country")).has_value());
+}
+
+// Test that filter cardinalities are estimated from distinct counts, null fractions and min/max
+TEST_F(JoinOrderOptimizerTest, EstimatesFilterCardinality) {
+    JoinOrderOptimizer optimizer(catalog_.get());
+
+    FilterOp equality(compare(CompareOp::EQUAL, column("customers", "region"), 3));
+    equality.addChild(scan("customers"));
+    EXPECT_NEAR(optimizer.estimateCardinality(&equality), 100000 * 0.1 * 0.8, 1.0);
+
+    FilterOp range(compare(CompareOp::LESS, column("customers", "id"), 25001));
+    range.addChild(scan("customers"));
+    EXPECT_NEAR(optimizer.estimateCardinality(&range), 25000, 10.0);
+
+    // Outside of the min/max range nothing matches
+    FilterOp outside(compare(CompareOp::EQUAL, column("customers", "region"), 42));
+    outside.addChild(scan("customers"));
+    EXPECT_EQ(optimizer.estimateCardinality(&outside), 1.0);
+}
+
+// Test that the most selective join of a star join is done first, with the smaller input as build side
+TEST_F(JoinOrderOptimizerTest, OrdersStarJoin) {
+    std::vector<std::unique_ptr<PredicateExpr>> where;
+    where.push_back(equals(column("sales", "customer_id"), column("customers", "id")));
+    where.push_back(equals(column("sales", "store_id"), column("stores", "id")));
+    where.push_back(equals(column("sales", "product_id"), column("products", "id")));
+    where.push_back(compare(CompareOp::EQUAL, column("products", "category"), 7));
+    auto root = fromWhere({"customers", "stores", "sales", "products"}, conjunction(std::move(where)));
+
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{column("sales", "id")});
+    projection->addChild(root);
+    LogicalQueryPlan plan(projection);
+
+    JoinOrderOptimizer optimizer(catalog_.get());
+    optimizer.optimize(plan);
+
+    std::vector<const JoinOp*> joins;
+    int crossProducts = 0;
+    collect(plan.getRoot(), joins, crossProducts);
+    EXPECT_EQ(crossProducts, 0);
+    ASSERT_EQ(joins.size(), 3u);
+
+    for (const JoinOp* join : joins) {
+        auto* condition = dynamic_cast<const CompareExpr*>(join->getCondition());
+        ASSERT_NE(condition, nullptr);
+        EXPECT_EQ(condition->getOp(), CompareOp::EQUAL);
+        EXPECT_LE(optimizer.estimateCardinality(join->getChild(0).get()),
+                  optimizer.estimateCardinality(join->getChild(1).get()));
+    }
+
+    // The filtered products are joined with sales first and build the hash table
+    const JoinOp* lowest = joins.back();
+    EXPECT_EQ(tablesOf(lowest), (std::set<std::string>{"sales", "products"}));
+    auto* productFilter = dynamic_cast<const FilterOp*>(lowest->getChild(0).get());
+    ASSERT_NE(productFilter, nullptr);
+    EXPECT_NE(dynamic_cast<const TableScanOp*>(productFilter->getChild(0).get()), nullptr);
+}
+
+// Test that tables without a join condition between them are not joined with a cross product
+TEST_F(JoinOrderOptimizerTest, AvoidsCrossProducts) {
+    std::vector<std::unique_ptr<PredicateExpr>> where;
+    where.push_back(equals(column("sales", "customer_id"), column("customers", "id")));
+    where.push_back(equals(column("sales", "store_id"), column("stores", "id")));
+    LogicalQueryPlan plan(fromWhere({"customers", "stores", "sales"}, conjunction(std::move(where))));
+    std::vector<ColumnId> columns = getOutputColumnList(plan.getRoot());
+
+    JoinOrderOptimizer optimizer(catalog_.get());
+    optimizer.optimize(plan);
+
+    std::vector<const JoinOp*> joins;
+    int crossProducts = 0;
+    collect(plan.getRoot(), joins, crossProducts);
+    EXPECT_EQ(crossProducts, 0);
+    EXPECT_EQ(joins.size(), 2u);
+
+    // Without a projection above the joins, the columns keep their FROM order
+    EXPECT_EQ(getOutputColumnList(plan.getRoot()), columns);
+}
+
+// Test that a reordered plan produces the same rows as the original one
+TEST_F(JoinOrderOptimizerTest, ReorderedPlanProducesSameRows) {
+    JsonCatalog catalog(fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json");
+    auto usersId = catalog.getTableIdByName("users");
+    auto ordersId = catalog.getTableIdByName("orders");
+    ColumnId userId = *catalog.resolveColumn(*usersId, "id");
+    ColumnId orderId = *catalog.resolveColumn(*ordersId, "id");
+    ColumnId orderUserId = *catalog.resolveColumn(*ordersId, "user_id");
+
+    auto makePlan = [&]() {
+        auto crossProduct = std::make_shared<CrossProductOp>();
+        crossProduct->addChild(std::make_shared<TableScanOp>((*catalog.getTableHandle(*ordersId))->getColumnIds()));
+        crossProduct->addChild(std::make_shared<TableScanOp>((*catalog.getTableHandle(*usersId))->getColumnIds()));
+        std::vector<std::unique_ptr<PredicateExpr>> where;
+        where.push_back(equals(orderUserId, userId));
+        where.push_back(compare(CompareOp::LESS, userId, 4));
+        auto filter = std::make_shared<FilterOp>(conjunction(std::move(where)));
+        filter->addChild(crossProduct);
+        auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{orderId, userId});
+        projection->addChild(filter);
+        return LogicalQueryPlan(projection);
+    };
+
+    auto run = [&](const LogicalQueryPlan& logicalPlan) {
+        PhysicalPlanner planner(&catalog, 8192, 1);
+        PhysicalQueryPlan plan = planner.plan(logicalPlan);
+        std::multiset<std::pair<int64_t, int64_t>> rows;
+        PhysicalOperator* root = plan.getRoot();
+        root->initialize();
+        RowVector batch;
+        while (root->next(batch) > 0) {
+            for (int64_t row = batch.nextSelectedRow(0); row < batch.getRowCount(); row = batch.nextSelectedRow(row + 1)) {
+                rows.emplace(batch.getColumn(0).getEntry<db_int64>(row), batch.getColumn(1).getEntry<db_int64>(row));
+            }
+        }
+        return rows;
+    };
+
+    LogicalQueryPlan original = makePlan();
+    LogicalQueryPlan optimized = makePlan();
+    JoinOrderOptimizer(&catalog).optimize(optimized);
+
+    auto expected = run(original);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(run(optimized), expected);
+}
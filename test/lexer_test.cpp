@@ -153,3 +153,22 @@ TEST(LexerTest, DoubleLiteralValues) {
 
     ASSERT_TRUE(ts.next().type == TokenType::EndOfFile);
 }
+
+// Test that identifiers and strings point into the query instead of copying it
+TEST(LexerTest, TokensViewQuery) {
+    std::string input = "SeLeCt name FROM 'quoted'";
+    TokenStream ts{input};
+
+    Token token1 = ts.next();
+    ASSERT_EQ(token1.type, TokenType::IdentifierType);
+    ASSERT_EQ(token1.getString(), "SeLeCt");
+    ASSERT_EQ(token1.getString().data(), input.data());
+
+    ASSERT_EQ(ts.next().getString().data(), input.data() + 7);
+    ASSERT_TRUE(ts.next().type == TokenType::KeyFrom);
+
+    Token token4 = ts.next();
+    ASSERT_EQ(token4.type, TokenType::StringLiteral);
+    ASSERT_EQ(token4.getString(), "quoted");
+    ASSERT_EQ(token4.getString().data(), input.data() + 18);
+}
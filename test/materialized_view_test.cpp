@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "common/errors.hpp"
+#include "planner/materialized_view.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class MaterializedViewTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path manifestPath_;
+    std::string output_;
+
+    static constexpr const char* CITY_TOTALS =
+        "SELECT users.city, SUM(orders.amount), COUNT(*) FROM orders, users WHERE orders.user_id = users.id "
+        "GROUP BY users.city";
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "materialized_view_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+        manifestPath_ = tempDir_ / "manifest.json";
+        std::ofstream(manifestPath_) << R"({
+            "tables": [{
+                "name": "orders", "id": 1, "id_name": "orders", "format": "tdb",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "user_id", "type": "INT64", "nullable": false},
+                    {"name": "amount", "type": "INT64", "nullable": false},
+                    {"name": "status", "type": "STRING", "nullable": false}
+                ],
+                "files": []
+            }, {
+                "name": "users", "id": 2, "id_name": "users", "format": "tdb",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "city", "type": "STRING", "nullable": false}
+                ],
+                "files": []
+            }]
+        })";
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    std::optional<int64_t> execute(server::Session& session, const std::string& sql) {
+        output_.clear();
+        return session.execute(sql, [this](std::string_view text) { output_ += text; });
+    }
+
+    // The CSV rows of a query without the header, sorted
+    std::vector<std::string> rows(server::Session& session, const std::string& sql) {
+        session.setResultFormat(ResultFormat::CSV);
+        execute(session, sql);
+        std::vector<std::string> lines;
+        std::istringstream in(output_);
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) {
+                lines.push_back(line);
+            }
+        }
+        if (!lines.empty()) {
+            lines.erase(lines.begin());
+        }
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    bool answeredFromView(server::Session& session, const std::string& sql, const std::string& view) {
+        execute(session, "EXPLAIN " + sql);
+        return output_.find("MaterializedViewScan[" + view + "]") != std::string::npos;
+    }
+
+    size_t viewFileCount() const {
+        return std::count_if(fs::directory_iterator(tempDir_), fs::directory_iterator(),
+                             [](const fs::directory_entry& entry) { return entry.path().extension() == ".mv"; });
+    }
+};
+
+// Test that an aggregate of a join picks up rows inserted into either table
+TEST_F(MaterializedViewTest, MaintainsAggregateOfJoin) {
+    {
+        JsonCatalog catalog(manifestPath_);
+        server::Session session(&catalog);
+        execute(session, "INSERT INTO users VALUES (1, 'berlin'), (2, 'paris')");
+        execute(session, "INSERT INTO orders VALUES (1, 1, 10, 'open'), (2, 1, 5, 'paid'), (3, 2, 7, 'open')");
+
+        execute(session, std::string("CREATE MATERIALIZED VIEW city_totals AS ") + CITY_TOTALS);
+        EXPECT_EQ(output_, "Created materialized view city_totals\n");
+        EXPECT_TRUE(answeredFromView(session, CITY_TOTALS, "city_totals"));
+        EXPECT_EQ(rows(session, CITY_TOTALS), (std::vector<std::string> {"berlin,15,2", "paris,7,1"}));
+
+        // The new order of an old user, and the new order of a new user
+        execute(session, "INSERT INTO orders VALUES (4, 2, 3, 'paid')");
+        execute(session, "INSERT INTO users VALUES (3, 'rome')");
+        execute(session, "INSERT INTO orders VALUES (5, 3, 1, 'open')");
+        EXPECT_EQ(rows(session, CITY_TOTALS), (std::vector<std::string> {"berlin,15,2", "paris,10,2", "rome,1,1"}));
+
+        std::vector<MaterializedViewMetadata> views = catalog.listMaterializedViews();
+        ASSERT_EQ(views.size(), 1u);
+        EXPECT_EQ(views[0].fileCounts.at("orders"), 3u);
+        EXPECT_EQ(views[0].fileCounts.at("users"), 2u);
+        EXPECT_EQ(viewFileCount(), 1u);
+    }
+
+    // The view is persisted in the manifest
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    EXPECT_TRUE(answeredFromView(session, CITY_TOTALS, "city_totals"));
+    EXPECT_EQ(rows(session, "select users.city, sum(orders.amount), count(*) from orders, users\n"
+                            "where orders.user_id = users.id group by users.city;"),
+              (std::vector<std::string> {"berlin,15,2", "paris,10,2", "rome,1,1"}));
+}
+
+TEST_F(MaterializedViewTest, MaintainsRowsAndEmptyTables) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    const std::string openOrders = "SELECT id, amount FROM orders WHERE status = 'open'";
+    const std::string orderCount = "SELECT COUNT(*) FROM orders";
+
+    execute(session, "CREATE MATERIALIZED VIEW order_count AS " + orderCount);
+    EXPECT_EQ(rows(session, orderCount), std::vector<std::string> {"0"});
+
+    execute(session, "INSERT INTO orders VALUES (1, 1, 10, 'open'), (2, 1, 5, 'paid')");
+    execute(session, "CREATE MATERIALIZED VIEW open_orders AS " + openOrders);
+    EXPECT_EQ(rows(session, openOrders), std::vector<std::string> {"1,10"});
+
+    execute(session, "INSERT INTO orders VALUES (3, 2, 7, 'open'), (4, 2, 1, 'open')");
+    EXPECT_TRUE(answeredFromView(session, openOrders, "open_orders"));
+    EXPECT_EQ(rows(session, openOrders), (std::vector<std::string> {"1,10", "3,7", "4,1"}));
+    EXPECT_EQ(rows(session, orderCount), std::vector<std::string> {"4"});
+    EXPECT_EQ(viewFileCount(), 2u);
+
+    // Other queries read the tables
+    EXPECT_FALSE(answeredFromView(session, "SELECT id FROM orders", "open_orders"));
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE status = 'paid'"), 1);
+}
+
+TEST_F(MaterializedViewTest, RejectsUnsupportedQueries) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    EXPECT_THROW(execute(session, "CREATE MATERIALIZED VIEW sorted AS SELECT id FROM orders ORDER BY id"),
+                 NotYetImplementedError);
+    EXPECT_THROW(execute(session, "CREATE MATERIALIZED VIEW sampled AS SELECT id FROM orders TABLESAMPLE BERNOULLI (10)"),
+                 NotYetImplementedError);
+
+    execute(session, "CREATE MATERIALIZED VIEW ids AS SELECT id FROM orders");
+    EXPECT_THROW(execute(session, "CREATE MATERIALIZED VIEW ids AS SELECT user_id FROM orders"), SQLRuntimeException);
+    EXPECT_TRUE(catalog.listMaterializedViews().size() == 1);
+
+    EXPECT_EQ(MaterializedViewManager::normalizeQuery("explain  select id from orders;"), "SELECT id FROM orders");
+    EXPECT_EQ(MaterializedViewManager::normalizeQuery("CREATE MATERIALIZED VIEW v AS SELECT id FROM orders"),
+              "SELECT id FROM orders");
+}
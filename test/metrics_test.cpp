@@ -0,0 +1,91 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/metrics.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+using namespace toydb::metrics;
+
+// Test that increments from many threads on different shards are all counted
+TEST(MetricsTest, CounterSumsShards) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.increment();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    counter.increment(5);
+    EXPECT_EQ(counter.get(), 80005u);
+}
+
+TEST(MetricsTest, HistogramBuckets) {
+    Histogram histogram({1.0, 2.0, 4.0});
+    for (double value : {0.5, 1.0, 1.5, 3.0, 3.5, 10.0}) {
+        histogram.observe(value);
+    }
+
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.buckets, (std::vector<uint64_t> {2, 1, 2, 1}));
+    EXPECT_EQ(snapshot.count, 6u);
+    EXPECT_DOUBLE_EQ(snapshot.sum, 19.5);
+
+    // Rank 3 is the only value of the second bucket
+    EXPECT_DOUBLE_EQ(snapshot.quantile(0.5), 2.0);
+    EXPECT_DOUBLE_EQ(snapshot.quantile(0.25), 0.75);
+    // Values above the last bound report the bound
+    EXPECT_DOUBLE_EQ(snapshot.quantile(1.0), 4.0);
+    EXPECT_DOUBLE_EQ(Histogram({1.0}).snapshot().quantile(0.5), 0.0);
+
+    EXPECT_EQ(Histogram::exponentialBounds(0.5, 2.0, 4), (std::vector<double> {0.5, 1.0, 2.0, 4.0}));
+}
+
+// Test that registering a name and labels again returns the same metric
+TEST(MetricsTest, RegistryReturnsExisting) {
+    MetricsRegistry registry;
+    Counter& csv = registry.counter("bytes_total", "Bytes", {{"format", "csv"}});
+    Counter& tdb = registry.counter("bytes_total", "Bytes", {{"format", "tdb"}});
+    EXPECT_NE(&csv, &tdb);
+    EXPECT_EQ(&csv, &registry.counter("bytes_total", "Bytes", {{"format", "csv"}}));
+
+    Histogram& latency = registry.histogram("latency_seconds", "Latency", {1.0});
+    EXPECT_EQ(&latency, &registry.histogram("latency_seconds", "Latency", {2.0}));
+}
+
+TEST(MetricsTest, ExportPrometheus) {
+    MetricsRegistry registry;
+    registry.counter("bytes_total", "Bytes read", {{"format", "csv"}}).increment(10);
+    registry.counter("bytes_total", "Bytes read", {{"format", "tdb"}}).increment(3);
+    registry.gauge("used_bytes", "Bytes in use", [] { return 42.0; });
+    Histogram& latency = registry.histogram("latency_seconds", "Latency", {0.5, 1.0});
+    latency.observe(0.25);
+    latency.observe(2.0);
+
+    EXPECT_EQ(registry.exportPrometheus(),
+              "# HELP bytes_total Bytes read\n"
+              "# TYPE bytes_total counter\n"
+              "bytes_total{format=\"csv\"} 10\n"
+              "bytes_total{format=\"tdb\"} 3\n"
+              "# HELP used_bytes Bytes in use\n"
+              "# TYPE used_bytes gauge\n"
+              "used_bytes 42\n"
+              "# HELP latency_seconds Latency\n"
+              "# TYPE latency_seconds histogram\n"
+              "latency_seconds_bucket{le=\"0.5\"} 1\n"
+              "latency_seconds_bucket{le=\"1\"} 1\n"
+              "latency_seconds_bucket{le=\"+Inf\"} 2\n"
+              "latency_seconds_sum 2.25\n"
+              "latency_seconds_count 2\n");
+}
+
+TEST(MetricsTest, EscapesLabelValues) {
+    MetricsRegistry registry;
+    registry.counter("files_total", "Files", {{"path", "a\"b\\c"}}).increment();
+    EXPECT_NE(registry.exportPrometheus().find("files_total{path=\"a\\\"b\\\\c\"} 1\n"), std::string::npos);
+}
@@ -1,4 +1,5 @@
 #include <memory>
+#include "common/metrics.hpp"
 #include "engine/nested_loop_join.hpp"
 #include "engine/predicate_expr.hpp"
 #include "gtest/gtest.h"
@@ -51,8 +52,7 @@ TEST_F(NestedLoopJoinTest, BasicEqualityJoin) {
 
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [1, 2, 3], Right: [2, 3, 4]
     // Matches: left[1]=2 matches right[0]=2, left[2]=3 matches right[1]=3
@@ -84,8 +84,7 @@ TEST_F(NestedLoopJoinTest, GreaterThanJoin) {
 
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [5, 10, 15], Right: [3, 8, 12]
     // Matches: (5>3), (5>8=false), (5>12=false), (10>3), (10>8), (10>12=false), (15>3), (15>8), (15>12)
@@ -128,8 +127,7 @@ TEST_F(NestedLoopJoinTest, ComplexPredicateJoin) {
 
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [(1,10), (2,20), (3,30)], Right: [2, 3, 4]
     // Predicate: (left.col0 = right.col0) AND (left.col1 > 15)
@@ -164,8 +162,7 @@ TEST_F(NestedLoopJoinTest, NoMatches) {
 
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Should have 0 matches
     EXPECT_EQ(resultCount, 0);
@@ -194,8 +191,7 @@ TEST_F(NestedLoopJoinTest, EmptyRightTable) {
 
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Should return 0 when right is empty
     EXPECT_EQ(resultCount, 0);
@@ -225,8 +221,7 @@ TEST_F(NestedLoopJoinTest, LargeDataEqualityJoin) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Overlap: left[500..999] matches right[0..499] = 500 matches
     EXPECT_EQ(resultCount, 500);
@@ -259,8 +254,7 @@ TEST_F(NestedLoopJoinTest, LargeDataMultiBatchLeft) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left batches: [0-199], [200-399], [400-599], [600-799], [800-999]
     // Right: [500-999]
@@ -296,8 +290,7 @@ TEST_F(NestedLoopJoinTest, LargeDataMultiBatchRight) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [0-999], Right batches: [500-699], [700-899], [900-1099], [1100-1299], [1300-1499]
     // Matches: left[500-699] with right batch 1[0-199] = 200, left[700-899] with right batch 2[0-199] = 200, left[900-999] with right batch 3[0-99] = 100
@@ -329,8 +322,7 @@ TEST_F(NestedLoopJoinTest, LargeDataGreaterThanJoin) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [100-199], Right: [0-149]
     // For each left value: matches all right values < left value
@@ -356,7 +348,7 @@ TEST_F(NestedLoopJoinTest, VeryLargeDataMultiBatchBothSides) {
     ColumnBufferStorage storage;
 
     // Left: [0, 1, 2, ..., 4999] split into 10 batches of 500
-    std::vector<int64_t> leftData = createSequence(0, 1000);
+    std::vector<int64_t> leftData = createSequence(0, 5000);
     auto leftOpPtr = MockOperatorBuilder(&storage)
                          .addInt64Column(0, "col0", leftData)
                          .withBatchSizes({550, 550, 550, 1000, 550, 550, 550, 200, 500})
@@ -381,8 +373,7 @@ TEST_F(NestedLoopJoinTest, VeryLargeDataMultiBatchBothSides) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // Left: [0-4999], Right: [2000-4999]
     // Overlap: left[2000-4999] matches right[0-2999] = 3000 matches
@@ -413,9 +404,39 @@ TEST_F(NestedLoopJoinTest, LargeDataNoMatches) {
     NestedLoopJoinExec join(leftOp, rightOp, std::move(predicate));
     join.initialize();
 
-    RowVector output;
-    int64_t resultCount = join.next(output);
+    int64_t resultCount = drainOperator(join);
 
     // No overlap, should have 0 matches
     EXPECT_EQ(resultCount, 0);
 }
+
+// Test that a build input over the memory budget is joined block by block with the spilled probe input
+TEST_F(NestedLoopJoinTest, SpillsBuildInputOverBudget) {
+    ColumnBufferStorage storage;
+
+    metrics::Counter& spilledBytes = metrics::MetricsRegistry::global().counter(
+        "toydb_spill_bytes_total", "Bytes written to spill files", {{"operator", "join"}});
+    uint64_t spilledBefore = spilledBytes.get();
+
+    auto leftOpPtr = MockOperatorBuilder(&storage)
+                         .addInt64Column(0, "col0", createSequence(0, 1000))
+                         .withBatchSizes({200, 200, 200, 200, 200})
+                         .build();
+    auto rightOpPtr = MockOperatorBuilder(&storage)
+                          .addInt64Column(1, "col1", createSequence(0, 1000))
+                          .withBatchSizes({100, 400, 500})
+                          .build();
+
+    auto leftCol = std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64());
+    auto rightCol = std::make_unique<ColumnRefExpr>(ColumnId(1, "col1"), DataType::getInt64());
+    auto predicate =
+        std::make_unique<CompareExpr>(CompareOp::LESS, DataType::getInt64(), std::move(leftCol), std::move(rightCol));
+
+    // Every block holds a single batch of the build input
+    NestedLoopJoinExec join(leftOpPtr.get(), rightOpPtr.get(), std::move(predicate), 1);
+    join.initialize();
+
+    // Pairs with left < right
+    EXPECT_EQ(drainOperator(join), 1000 * 999 / 2);
+    EXPECT_GT(spilledBytes.get(), spilledBefore);
+}
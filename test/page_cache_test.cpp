@@ -0,0 +1,162 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "engine/memory.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+using namespace toydb::memory;
+namespace fs = std::filesystem;
+
+class PageCacheTest : public ::testing::Test {
+protected:
+    static constexpr size_t PAGE_SIZE = PageCache::PAGE_SIZE;
+
+    // Fill the frame with the key, counting the loads
+    std::atomic<int> loads{0};
+
+    PageCache::LoadFn loader(PageCache::Key key) {
+        return [this, key](void* frame, size_t size) {
+            ++loads;
+            std::memset(frame, static_cast<int>(key), size);
+            return true;
+        };
+    }
+
+    static char firstByte(const PageCache::PageHandle& handle) {
+        return static_cast<const char*>(handle.data())[0];
+    }
+};
+
+// Test that cached pages are served without loading them again
+TEST_F(PageCacheTest, Hits) {
+    PageCache cache(4);
+    {
+        auto page = cache.pin(1, loader(1));
+        ASSERT_TRUE(page.has_value());
+        EXPECT_EQ(firstByte(*page), 1);
+    }
+    auto page = cache.pin(1, loader(1));
+    ASSERT_TRUE(page.has_value());
+    EXPECT_EQ(firstByte(*page), 1);
+
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(cache.getHitCount(), 1);
+    EXPECT_EQ(cache.getMissCount(), 1);
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2));
+}
+
+// Test that unpinned pages are evicted once all frames are used, and pinned pages never are
+TEST_F(PageCacheTest, EvictsUnpinnedPages) {
+    PageCache cache(2);
+    auto pinned = cache.pin(1, loader(1));
+    ASSERT_TRUE(pinned.has_value());
+    {
+        auto page = cache.pin(2, loader(2));
+        ASSERT_TRUE(page.has_value());
+    }
+
+    auto third = cache.pin(3, loader(3));
+    ASSERT_TRUE(third.has_value());
+    EXPECT_EQ(firstByte(*third), 3);
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2));
+    EXPECT_EQ(cache.getEvictionCount(), 1);
+
+    // Both frames are pinned now
+    auto fourth = cache.pin(4, loader(4));
+    ASSERT_FALSE(fourth.has_value());
+    EXPECT_EQ(fourth.error(), MemoryError::NO_FREE_FRAME);
+
+    third->release();
+    fourth = cache.pin(4, loader(4));
+    ASSERT_TRUE(fourth.has_value());
+    EXPECT_EQ(firstByte(*pinned), 1);
+}
+
+// Test that a failed load is reported and does not leave the page cached
+TEST_F(PageCacheTest, FailedLoad) {
+    PageCache cache(1);
+    auto page = cache.pin(7, [](void*, size_t) { return false; });
+    ASSERT_FALSE(page.has_value());
+    EXPECT_EQ(page.error(), MemoryError::READ_FAILED);
+    EXPECT_FALSE(cache.contains(7));
+
+    page = cache.pin(7, loader(7));
+    ASSERT_TRUE(page.has_value());
+    EXPECT_EQ(firstByte(*page), 7);
+}
+
+// Test that threads pinning the same pages load every page once
+TEST_F(PageCacheTest, ConcurrentPins) {
+    PageCache cache(16);
+    std::vector<std::thread> threads;
+    std::atomic<int> wrongPages{0};
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                PageCache::Key key = static_cast<PageCache::Key>(i % 8 + 1);
+                auto page = cache.pin(key, loader(key));
+                if (!page || firstByte(*page) != static_cast<char>(key)) {
+                    ++wrongPages;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(wrongPages, 0);
+    EXPECT_EQ(loads, 8);
+}
+
+// Test that a page directory reads the pages of a file through the cache
+TEST_F(PageCacheTest, PageDirectory) {
+    fs::path path = fs::temp_directory_path() / ("tdb_page_directory_" + std::to_string(getpid()));
+    MemoryManager memory;
+    memory.init();
+    {
+        auto region = memory.mapNewFile(path.string(), 2 * PAGE_SIZE + 100);
+        ASSERT_TRUE(region.has_value());
+        auto* bytes = static_cast<char*>(region->data);
+        std::memset(bytes, 'a', PAGE_SIZE);
+        std::memset(bytes + PAGE_SIZE, 'b', PAGE_SIZE);
+        std::memset(bytes + 2 * PAGE_SIZE, 'c', 100);
+        munmap(region->data, region->size);
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_NE(fd, -1);
+    PageCache cache(2);
+    PageDirectory directory(cache, memory, fd, 1);
+    for (Page::ID id = 0; id < 3; ++id) {
+        directory.addPage(id, id * PAGE_SIZE);
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        auto first = directory.getPage(1);
+        ASSERT_TRUE(first.has_value());
+        EXPECT_EQ(static_cast<const char*>(first->data())[0], 'b');
+    }
+    EXPECT_EQ(cache.getHitCount(), 1);
+
+    // The last page is shorter, the rest of the frame is zeroed
+    auto last = directory.getPage(2);
+    ASSERT_TRUE(last.has_value());
+    const char* bytes = static_cast<const char*>(last->data());
+    EXPECT_EQ(bytes[99], 'c');
+    EXPECT_EQ(bytes[100], '\0');
+
+    EXPECT_EQ(directory.getPage(3).error(), MemoryError::UNKNOWN_PAGE);
+
+    close(fd);
+    fs::remove(path);
+}
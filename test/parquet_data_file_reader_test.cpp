@@ -0,0 +1,153 @@
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/predicate_expr.hpp"
+#include "storage/catalog.hpp"
+#include "storage/parquet_data_file_reader.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class ParquetDataFileReaderTest : public ::testing::Test {
+protected:
+    static constexpr int64_t ROW_COUNT = 250;
+    static constexpr int64_t ROW_GROUP_SIZE = 100;
+
+    fs::path tempDir_;
+    fs::path path_;
+    TableId tableId_{1, "events"};
+    ColumnId id_{1, "id", tableId_};
+    ColumnId score_{2, "score", tableId_};
+    ColumnId note_{3, "note", tableId_};
+    Schema schema_;
+    memory::BufferManager bufferManager_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "parquet_data_file_reader_test";
+        fs::create_directories(tempDir_);
+        path_ = tempDir_ / "events.parquet";
+
+        schema_.addColumn(id_, {"id", DataType::getInt64(), false});
+        schema_.addColumn(score_, {"score", DataType::getInt32(), true});
+        schema_.addColumn(note_, {"note", DataType::getString(), true});
+        writeFile();
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    static std::string noteFor(int64_t id) {
+        return id % 3 == 0 ? "note " + std::to_string(id) + " with a long text" : "n" + std::to_string(id);
+    }
+
+    // Rows with ids [0, ROW_COUNT) in row groups of ROW_GROUP_SIZE, every 5th score and every 7th note is NULL
+    void writeFile() {
+        arrow::Int64Builder ids;
+        arrow::Int32Builder scores;
+        arrow::StringBuilder notes;
+        for (int64_t id = 0; id < ROW_COUNT; ++id) {
+            ASSERT_TRUE(ids.Append(id).ok());
+            ASSERT_TRUE((id % 5 == 0 ? scores.AppendNull() : scores.Append(static_cast<int32_t>(id % 100))).ok());
+            ASSERT_TRUE((id % 7 == 0 ? notes.AppendNull() : notes.Append(noteFor(id))).ok());
+        }
+        std::shared_ptr<arrow::Array> idArray;
+        std::shared_ptr<arrow::Array> scoreArray;
+        std::shared_ptr<arrow::Array> noteArray;
+        ASSERT_TRUE(ids.Finish(&idArray).ok());
+        ASSERT_TRUE(scores.Finish(&scoreArray).ok());
+        ASSERT_TRUE(notes.Finish(&noteArray).ok());
+
+        auto schema = arrow::schema({arrow::field("id", arrow::int64(), false), arrow::field("score", arrow::int32()),
+                                     arrow::field("note", arrow::utf8())});
+        auto table = arrow::Table::Make(schema, {idArray, scoreArray, noteArray});
+
+        auto out = arrow::io::FileOutputStream::Open(path_.string());
+        ASSERT_TRUE(out.ok());
+        ASSERT_TRUE(parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), *out, ROW_GROUP_SIZE).ok());
+        ASSERT_TRUE((*out)->Close().ok());
+    }
+
+    RowVector allocateBatch(BatchAllocator& allocator, const std::vector<ColumnId>& columns) {
+        std::vector<ColumnDescriptor> descriptors;
+        for (const ColumnId& colId : columns) {
+            descriptors.push_back({colId, schema_.getColumn(colId)->type});
+        }
+        return allocator.allocateBatch(descriptors);
+    }
+
+    std::unique_ptr<CompareExpr> idAtLeast(int64_t value) {
+        auto predicate = std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                                                       std::make_unique<ColumnRefExpr>(id_, DataType::getInt64()),
+                                                       std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+        predicate->initializeIndexMap();
+        return predicate;
+    }
+};
+
+// Test that the projected columns are read in the projection's order with their NULLs, in batches not aligned to the row groups
+TEST_F(ParquetDataFileReaderTest, ProjectionAndNulls) {
+    ParquetDataFileReader reader(path_, schema_, tableId_);
+    EXPECT_EQ(reader.getRowGroupCount(), 3);
+    reader.setProjection({note_, score_});
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator, {note_, score_});
+    int64_t id = 0;
+    while (int64_t rowsRead = reader.readBatch(batch, 30)) {
+        ASSERT_LE(rowsRead, 30);
+        ASSERT_EQ(batch.getColumnCount(), 2);
+        for (int64_t row = 0; row < rowsRead; ++row, ++id) {
+            const ColumnBuffer& notes = batch.getColumn(0);
+            const ColumnBuffer& scores = batch.getColumn(1);
+            EXPECT_EQ(notes.isNull(row), id % 7 == 0) << id;
+            if (id % 7 != 0) {
+                EXPECT_EQ(notes.getEntry<db_string>(row).view(), noteFor(id));
+            }
+            EXPECT_EQ(scores.isNull(row), id % 5 == 0) << id;
+            if (id % 5 != 0) {
+                EXPECT_EQ(scores.getEntry<db_int32>(row), id % 100);
+            }
+        }
+    }
+    EXPECT_EQ(id, ROW_COUNT);
+    EXPECT_FALSE(reader.hasMore());
+    EXPECT_EQ(reader.getSelectedRowGroups(), (std::vector<int> {0, 1, 2}));
+}
+
+// Test that row groups whose statistics rule out the predicate are skipped, the others are read whole
+TEST_F(ParquetDataFileReaderTest, PrunesRowGroups) {
+    auto predicate = idAtLeast(220);
+    ParquetDataFileReader reader(path_, schema_, tableId_);
+    reader.setProjection({id_});
+    reader.setPredicate(predicate.get());
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator, {id_});
+    std::vector<int64_t> ids;
+    while (int64_t rowsRead = reader.readBatch(batch, 64)) {
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            ids.push_back(batch.getColumn(0).getEntry<db_int64>(row));
+        }
+    }
+    EXPECT_EQ(reader.getSelectedRowGroups(), std::vector<int> {2});
+    ASSERT_EQ(ids.size(), static_cast<size_t>(ROW_COUNT - 2 * ROW_GROUP_SIZE));
+    EXPECT_EQ(ids.front(), 2 * ROW_GROUP_SIZE);
+    EXPECT_EQ(ids.back(), ROW_COUNT - 1);
+
+    // No row group can match
+    auto none = idAtLeast(ROW_COUNT);
+    ParquetDataFileReader pruned(path_, schema_, tableId_);
+    pruned.setProjection({id_});
+    pruned.setPredicate(none.get());
+    EXPECT_EQ(pruned.readBatch(batch, 64), 0);
+    EXPECT_TRUE(pruned.getSelectedRowGroups().empty());
+    EXPECT_FALSE(pruned.hasMore());
+}
@@ -2,6 +2,7 @@
 #include "test_helpers.hpp"
 #include <gtest/gtest.h>
 #include <string>
+#include <sstream>
 #include <memory>
 #include <source_location>
 #include <cctype>
@@ -13,6 +14,9 @@ using namespace toydb::test;
 
 class ParserTest : public ::testing::Test {
    protected:
+    // Owns the nodes of the expected ASTs
+    Arena arena_;
+
     void SetUp() override {}
 
     void TearDown() override {}
@@ -45,27 +49,27 @@ class ParserTest : public ::testing::Test {
     }
 
     // Helper functions to create AST nodes
-    std::unique_ptr<ConstantString> makeLiteral(const std::string& value) {
-        return std::make_unique<ConstantString>(value);
+    ConstantString* makeLiteral(const std::string& value) {
+        return arena_.make<ConstantString>(value);
     }
 
-    std::unique_ptr<ColumnRef> ident(const std::string& name) {
-        return std::make_unique<ColumnRef>(name);
+    ColumnRef* ident(const std::string& name) {
+        return arena_.make<ColumnRef>(name);
     }
 
-    std::unique_ptr<ColumnRef> qualifiedIdent(const std::string& table, const std::string& column) {
-        return std::make_unique<ColumnRef>(table, column, "");
+    ColumnRef* qualifiedIdent(const std::string& table, const std::string& column) {
+        return arena_.make<ColumnRef>(table, column, "");
     }
 
-    std::unique_ptr<ConstantInt> makeIntLiteral(int64_t value, bool isInt64 = false) {
-        return std::make_unique<ConstantInt>(value, isInt64);
+    ConstantInt* makeIntLiteral(int64_t value, bool isInt64 = false) {
+        return arena_.make<ConstantInt>(value, isInt64);
     }
 
-    std::unique_ptr<ConstantBool> makeBoolLiteral(bool value) {
-        return std::make_unique<ConstantBool>(value);
+    ConstantBool* makeBoolLiteral(bool value) {
+        return arena_.make<ConstantBool>(value);
     }
 
-    std::unique_ptr<Expression> makeExpression(const std::string& value) {
+    Expression* makeExpression(const std::string& value) {
         // Try to parse as integer, otherwise treat as string
         try {
             size_t pos = 0;
@@ -88,58 +92,58 @@ class ParserTest : public ::testing::Test {
         return makeLiteral(value);
     }
 
-    std::vector<std::unique_ptr<Expression>> makeRow(std::initializer_list<std::string> values) {
-        std::vector<std::unique_ptr<Expression>> row;
+    std::vector<Expression*> makeRow(std::initializer_list<std::string> values) {
+        std::vector<Expression*> row;
         for (const auto& value : values) {
             row.push_back(makeExpression(value));
         }
         return row;
     }
 
-    std::unique_ptr<Insert> makeInsertInto(const std::string& tableName,
+    Insert* makeInsertInto(const std::string& tableName,
                                           std::initializer_list<std::string> columnNames,
-                                          std::vector<std::vector<std::unique_ptr<Expression>>> rows) {
-        auto insert = std::make_unique<Insert>(tableName);
+                                          std::vector<std::vector<Expression*>> rows) {
+        auto insert = arena_.make<Insert>(tableName);
         insert->columnNames.assign(columnNames.begin(), columnNames.end());
         insert->values = std::move(rows);
         return insert;
     }
 
-    std::unique_ptr<Insert> makeInsertInto(const std::string& tableName,
-                                          std::vector<std::vector<std::unique_ptr<Expression>>> rows) {
-        auto insert = std::make_unique<Insert>(tableName);
+    Insert* makeInsertInto(const std::string& tableName,
+                                          std::vector<std::vector<Expression*>> rows) {
+        auto insert = arena_.make<Insert>(tableName);
         insert->values = std::move(rows);
         return insert;
     }
 
-    std::unique_ptr<Condition> makeCondition(CompareOp op,
-                                             std::unique_ptr<Expression> left,
-                                             std::unique_ptr<Expression> right = nullptr) {
-        auto cond = std::make_unique<Condition>();
+    Condition* makeCondition(CompareOp op,
+                                             Expression* left,
+                                             Expression* right = nullptr) {
+        auto cond = arena_.make<Condition>();
         cond->op = op;
         cond->left = std::move(left);
         cond->right = std::move(right);
         return cond;
     }
 
-    std::unique_ptr<Update> makeUpdate(const std::string& tableName,
-                                      std::vector<std::pair<std::string, std::unique_ptr<Expression>>> assignments,
-                                      std::unique_ptr<Expression> where = nullptr) {
-        auto update = std::make_unique<Update>(tableName);
+    Update* makeUpdate(const std::string& tableName,
+                                      std::vector<std::pair<std::string, Expression*>> assignments,
+                                      Expression* where = nullptr) {
+        auto update = arena_.make<Update>(tableName);
         update->assignments = std::move(assignments);
         update->where = std::move(where);
         return update;
     }
 
-    std::unique_ptr<Delete> makeDelete(const std::string& tableName, std::unique_ptr<Expression> where = nullptr) {
-        auto deleteStmt = std::make_unique<Delete>(tableName);
+    Delete* makeDelete(const std::string& tableName, Expression* where = nullptr) {
+        auto deleteStmt = arena_.make<Delete>(tableName);
         deleteStmt->where = std::move(where);
         return deleteStmt;
     }
 
-    std::unique_ptr<CreateTable> makeCreateTable(const std::string& tableName,
+    CreateTable* makeCreateTable(const std::string& tableName,
                                                 std::vector<std::pair<std::string, DataType>> columns) {
-        auto createTable = std::make_unique<CreateTable>(tableName);
+        auto createTable = arena_.make<CreateTable>(tableName);
         for (auto& [name, type] : columns) {
             createTable->columns.emplace_back(name, type);
         }
@@ -149,75 +153,75 @@ class ParserTest : public ::testing::Test {
     // Comparison condition helpers - create binary comparison conditions
     // Left side is always an identifier (parsed as ColumnRef by parser)
     // Right side can be string or int
-    std::unique_ptr<Condition> eq(const std::string& left, const std::string& right) {
+    Condition* eq(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::EQUAL, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> eq(const std::string& left, int64_t right) {
+    Condition* eq(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::EQUAL, ident(left), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> eqQualified(const std::string& table, const std::string& column, int64_t right) {
+    Condition* eqQualified(const std::string& table, const std::string& column, int64_t right) {
         return makeCondition(CompareOp::EQUAL, qualifiedIdent(table, column), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> gtQualified(const std::string& table, const std::string& column, int64_t right) {
+    Condition* gtQualified(const std::string& table, const std::string& column, int64_t right) {
         return makeCondition(CompareOp::GREATER, qualifiedIdent(table, column), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> ne(const std::string& left, const std::string& right) {
+    Condition* ne(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::NOT_EQUAL, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> ne(const std::string& left, int64_t right) {
+    Condition* ne(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::NOT_EQUAL, ident(left), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> gt(const std::string& left, const std::string& right) {
+    Condition* gt(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::GREATER, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> gt(const std::string& left, int64_t right) {
+    Condition* gt(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::GREATER, ident(left), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> lt(const std::string& left, const std::string& right) {
+    Condition* lt(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::LESS, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> lt(const std::string& left, int64_t right) {
+    Condition* lt(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::LESS, ident(left), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> gte(const std::string& left, const std::string& right) {
+    Condition* gte(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::GREATER_EQUAL, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> gte(const std::string& left, int64_t right) {
+    Condition* gte(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::GREATER_EQUAL, ident(left), makeIntLiteral(right, false));
     }
 
-    std::unique_ptr<Condition> lte(const std::string& left, const std::string& right) {
+    Condition* lte(const std::string& left, const std::string& right) {
         return makeCondition(CompareOp::LESS_EQUAL, ident(left), makeExpression(right));
     }
 
-    std::unique_ptr<Condition> lte(const std::string& left, int64_t right) {
+    Condition* lte(const std::string& left, int64_t right) {
         return makeCondition(CompareOp::LESS_EQUAL, ident(left), makeIntLiteral(right, false));
     }
 
     // Logical condition helpers - chain AND/OR conditions
-    std::unique_ptr<Condition> andCond(std::unique_ptr<Condition> left, std::unique_ptr<Condition> right) {
+    Condition* andCond(Condition* left, Condition* right) {
         return makeCondition(CompareOp::AND, std::move(left), std::move(right));
     }
 
-    std::unique_ptr<Condition> orCond(std::unique_ptr<Condition> left, std::unique_ptr<Condition> right) {
+    Condition* orCond(Condition* left, Condition* right) {
         return makeCondition(CompareOp::OR, std::move(left), std::move(right));
     }
 
     // Helper to create UPDATE assignments from initializer list
-    std::vector<std::pair<std::string, std::unique_ptr<Expression>>> makeAssignments(
+    std::vector<std::pair<std::string, Expression*>> makeAssignments(
         std::initializer_list<std::pair<std::string, std::string>> pairs) {
-        std::vector<std::pair<std::string, std::unique_ptr<Expression>>> assignments;
+        std::vector<std::pair<std::string, Expression*>> assignments;
         for (const auto& [col, val] : pairs) {
             assignments.emplace_back(col, makeExpression(val));
         }
@@ -225,9 +229,9 @@ class ParserTest : public ::testing::Test {
     }
 
     // Helper to create multiple rows for INSERT
-    std::vector<std::vector<std::unique_ptr<Expression>>> makeRows(
+    std::vector<std::vector<Expression*>> makeRows(
         std::initializer_list<std::initializer_list<std::string>> rowLists) {
-        std::vector<std::vector<std::unique_ptr<Expression>>> rows;
+        std::vector<std::vector<Expression*>> rows;
         for (const auto& rowList : rowLists) {
             rows.push_back(makeRow(rowList));
         }
@@ -240,10 +244,10 @@ TEST_F(ParserTest, Insert) {
     // False (capital F) is parsed as an identifier (ColumnRef), not a boolean literal
     // Only "false" and "FALSE" are recognized as boolean keywords
     auto insert = makeInsertInto("booleans", {"id"}, {});
-    std::vector<std::unique_ptr<Expression>> row;
+    std::vector<Expression*> row;
     row.push_back(ident("False"));
     insert->values.push_back(std::move(row));
-    QueryAST expected(insert.release());
+    QueryAST expected(insert);
     testSuccessfulParse("INSERT INTO booleans (id) VALUES (False);", expected);
 }
 
@@ -251,31 +255,31 @@ TEST_F(ParserTest, InsertWithColumns) {
     // True (capital T) is parsed as an identifier (ColumnRef), not a boolean literal
     // Only "true" and "TRUE" are recognized as boolean keywords
     auto insert = makeInsertInto("users", {"id", "name", "age", "is_male"}, {});
-    std::vector<std::unique_ptr<Expression>> row;
+    std::vector<Expression*> row;
     row.push_back(makeIntLiteral(1, false));
     row.push_back(makeLiteral("John"));
     row.push_back(makeIntLiteral(0, false));
     row.push_back(ident("True"));
     insert->values.push_back(std::move(row));
-    QueryAST expected(insert.release());
+    QueryAST expected(insert);
     testSuccessfulParse("INSERT INTO users (id, name, age, is_male) VALUES (1, 'John', 0, True)", expected);
 }
 
 TEST_F(ParserTest, InsertWithSemicolon) {
     auto insert = makeInsertInto("users", {"id", "name"}, makeRows({{"99", "David"}}));
-    QueryAST expected(insert.release());
+    QueryAST expected(insert);
     testSuccessfulParse("INSERT INTO users (id, name) VALUES (99, 'David');", expected);
 }
 
 TEST_F(ParserTest, InsertWithoutColumns) {
     auto insert = makeInsertInto("users", makeRows({{"1", "John", "30"}}));
-    QueryAST expected(insert.release());
+    QueryAST expected(insert);
     testSuccessfulParse("INSERT INTO users VALUES (1, 'John', 30)", expected);
 }
 
 TEST_F(ParserTest, InsertMultipleRows) {
     auto insert = makeInsertInto("users", {"id", "name"}, makeRows({{"1", "John Doe"}, {"2", "Jane"}}));
-    QueryAST expected(insert.release());
+    QueryAST expected(insert);
     testSuccessfulParse("INSERT INTO users (id, name) VALUES (1, 'John Doe'), (2, 'Jane')", expected);
 }
 
@@ -304,21 +308,21 @@ TEST_F(ParserTest, InsertTooManyValues) {
 // UPDATE tests
 TEST_F(ParserTest, UpdateWithWhere) {
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}), eq("id", 1));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse("UPDATE users SET name = 'John', age = 30 WHERE id = 1", expected);
 }
 
 TEST_F(ParserTest, UpdateWithWhere2) {
     auto where = andCond(eq("id", 1), eq("age", 12));
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}), std::move(where));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse("UPDATE users SET name = 'John', age = 30 WHERE id = 1 AND age = 12", expected);
 }
 
 TEST_F(ParserTest, UpdateWithWhere3) {
     auto where = orCond(eq("id", 1), eq("name", "Bob"));
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}), std::move(where));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse("UPDATE users SET name = 'John', age = 30 WHERE id = 1 OR name = 'Bob'", expected);
 }
 
@@ -329,7 +333,7 @@ TEST_F(ParserTest, UpdateWithWhere4) {
         gt("id", 4)
     );
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}), std::move(where));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse(
         "UPDATE users SET name = 'John', age = 30 WHERE id <= 1 OR (id = 2 OR id = 3) OR (id > 4)", expected);
 }
@@ -341,14 +345,14 @@ TEST_F(ParserTest, UpdateWithWhere5) {
         gt("age", 23)
     );
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}), std::move(where));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse(
         "UPDATE users SET name = 'John', age = 30 WHERE (id != 1 OR id <= 5) AND (age > 23)", expected);
 }
 
 TEST_F(ParserTest, UpdateWithoutWhere) {
     auto update = makeUpdate("users", makeAssignments({{"name", "John"}, {"age", "30"}}));
-    QueryAST expected(update.release());
+    QueryAST expected(update);
     testSuccessfulParse("UPDATE users SET name = 'John', age = 30", expected);
 }
 
@@ -363,13 +367,13 @@ TEST_F(ParserTest, UpdateMissingSet) {
 // DELETE tests
 TEST_F(ParserTest, DeleteWithWhere) {
     auto deleteStmt = makeDelete("users", eq("id", 1));
-    QueryAST expected(deleteStmt.release());
+    QueryAST expected(deleteStmt);
     testSuccessfulParse("DELETE FROM users WHERE id = 1", expected);
 }
 
 TEST_F(ParserTest, DeleteWithoutWhere) {
     auto deleteStmt = makeDelete("users");
-    QueryAST expected(deleteStmt.release());
+    QueryAST expected(deleteStmt);
     testSuccessfulParse("DELETE FROM users", expected);
 }
 
@@ -390,14 +394,14 @@ TEST_F(ParserTest, CreateTable) {
         {"active", DataType::getBool()}
     };
     auto createTable = makeCreateTable("users", std::move(columns));
-    QueryAST expected(createTable.release());
+    QueryAST expected(createTable);
     testSuccessfulParse("CREATE TABLE users (id INTEGER, name CHAR, age INTEGER, active BOOL)", expected);
 }
 
 TEST_F(ParserTest, CreateTableSingleColumn) {
     std::vector<std::pair<std::string, DataType>> columns = {{"id", DataType::getInt32()}};
     auto createTable = makeCreateTable("users", std::move(columns));
-    QueryAST expected(createTable.release());
+    QueryAST expected(createTable);
     testSuccessfulParse("CREATE TABLE users (id INTEGER)", expected);
 }
 
@@ -413,43 +417,63 @@ TEST_F(ParserTest, CreateTableInvalidDataType) {
     testFailedParse("CREATE TABLE users (id INVALID)", "Unknown data type");
 }
 
+TEST_F(ParserTest, CreateIndex) {
+    QueryAST expected(arena_.make<CreateIndex>("orders", "user_id"));
+    testSuccessfulParse("CREATE INDEX ON orders (user_id)", expected);
+    testSuccessfulParse("create index on orders(user_id);", expected);
+    testFailedParse("CREATE INDEX orders (user_id)", "Expected ON table");
+    testFailedParse("CREATE INDEX ON orders", "Expected indexed column");
+}
+
+TEST_F(ParserTest, CreateMaterializedView) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("status");
+    select->tables.emplace_back(Table("orders"));
+    QueryAST expected(arena_.make<CreateMaterializedView>("open_orders", select));
+    testSuccessfulParse("CREATE MATERIALIZED VIEW open_orders AS SELECT status FROM orders", expected);
+    testSuccessfulParse("create materialized view open_orders as select status from orders;", expected);
+    testFailedParse("CREATE MATERIALIZED open_orders AS SELECT status FROM orders", "Expected VIEW after MATERIALIZED");
+    testFailedParse("CREATE MATERIALIZED VIEW open_orders SELECT status FROM orders", "Expected AS query");
+    testFailedParse("CREATE MATERIALIZED VIEW open_orders AS orders", "Expected SELECT statement");
+}
+
 TEST_F(ParserTest, EmptyQuery) {
     testFailedParse("", "Unsupported query type");
 }
 
 TEST_F(ParserTest, QualifiedColumnInSelect) {
-    auto select = std::make_unique<SelectFrom>();
+    auto select = arena_.make<SelectFrom>();
     select->columns.emplace_back("users", "id", "");
     select->tables.emplace_back(Table("users"));
-    QueryAST expected(select.release());
+    QueryAST expected(select);
     testSuccessfulParse("SELECT users.id FROM users", expected);
 }
 
 TEST_F(ParserTest, QualifiedColumnMultipleInSelect) {
-    auto select = std::make_unique<SelectFrom>();
+    auto select = arena_.make<SelectFrom>();
     select->columns.emplace_back("users", "id", "");
     select->columns.emplace_back("users", "name", "");
     select->tables.emplace_back(Table("users"));
-    QueryAST expected(select.release());
+    QueryAST expected(select);
     testSuccessfulParse("SELECT users.id, users.name FROM users", expected);
 }
 
 TEST_F(ParserTest, QualifiedColumnInSelectAndWhere) {
-    auto select = std::make_unique<SelectFrom>();
+    auto select = arena_.make<SelectFrom>();
     select->columns.emplace_back("users", "id", "");
     select->columns.emplace_back("users", "name", "");
     select->tables.emplace_back(Table("users"));
     select->where = gtQualified("users", "age", 20);
-    QueryAST expected(select.release());
+    QueryAST expected(select);
     testSuccessfulParse("SELECT users.id, users.name FROM users WHERE users.age > 20", expected);
 }
 
 TEST_F(ParserTest, MixedQualifiedAndUnqualified) {
-    auto select = std::make_unique<SelectFrom>();
+    auto select = arena_.make<SelectFrom>();
     select->columns.emplace_back("users", "id", "");
     select->columns.emplace_back("name");
     select->tables.emplace_back(Table("users"));
-    QueryAST expected(select.release());
+    QueryAST expected(select);
     testSuccessfulParse("SELECT users.id, name FROM users", expected);
 }
 
@@ -459,11 +483,269 @@ TEST_F(ParserTest, MultiplePeriodsError) {
 }
 
 TEST_F(ParserTest, QualifiedColumnWithComparison) {
-    auto select = std::make_unique<SelectFrom>();
+    auto select = arena_.make<SelectFrom>();
     select->columns.emplace_back("users", "id", "");
     select->tables.emplace_back(Table("users"));
     auto condition = makeCondition(CompareOp::GREATER, qualifiedIdent("users", "age"), makeIntLiteral(20, false));
     select->where = std::move(condition);
-    QueryAST expected(select.release());
+    QueryAST expected(select);
     testSuccessfulParse("SELECT users.id FROM users WHERE users.age > 20", expected);
 }
+
+TEST_F(ParserTest, SelectAggregates) {
+    auto select = arena_.make<SelectFrom>();
+    ColumnRef countStar("*");
+    countStar.aggregate = AggregateFunction::COUNT_STAR;
+    ColumnRef sum("users", "age", "total");
+    sum.aggregate = AggregateFunction::SUM;
+    ColumnRef max("name");
+    max.aggregate = AggregateFunction::MAX;
+    select->columns.push_back(countStar);
+    select->columns.push_back(sum);
+    select->columns.push_back(max);
+    select->tables.emplace_back(Table("users"));
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT COUNT(*), sum(users.age) AS total, Max(name) FROM users", expected);
+}
+
+TEST_F(ParserTest, SelectGroupBy) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("name");
+    ColumnRef avg("age");
+    avg.aggregate = AggregateFunction::AVG;
+    select->columns.push_back(avg);
+    select->tables.emplace_back(Table("users"));
+    select->where = gtQualified("users", "age", 20);
+    select->groupBy.emplace_back("name");
+    select->groupBy.emplace_back("users", "id", "");
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT name, AVG(age) FROM users WHERE users.age > 20 GROUP BY name, users.id", expected);
+}
+
+TEST_F(ParserTest, AggregateErrors) {
+    testFailedParse("SELECT MEDIAN(age) FROM users", "Unknown function");
+    testFailedParse("SELECT SUM(*) FROM users", "SUM(*) is not supported");
+    testFailedParse("SELECT COUNT(age FROM users", "Expected )");
+    testFailedParse("SELECT name FROM users GROUP name", "Expected BY after GROUP");
+}
+
+TEST_F(ParserTest, ApproximateAggregates) {
+    auto select = arena_.make<SelectFrom>();
+    ColumnRef distinct("name");
+    distinct.aggregate = AggregateFunction::APPROX_COUNT_DISTINCT;
+    ColumnRef p90("users", "age", "p90");
+    p90.aggregate = AggregateFunction::APPROX_QUANTILE;
+    p90.quantile = 0.9;
+    ColumnRef maximum("age");
+    maximum.aggregate = AggregateFunction::APPROX_QUANTILE;
+    maximum.quantile = 1.0;
+    select->columns.push_back(distinct);
+    select->columns.push_back(p90);
+    select->columns.push_back(maximum);
+    select->tables.emplace_back(Table("users"));
+    QueryAST expected(select);
+    testSuccessfulParse(
+        "SELECT approx_count_distinct(name), APPROX_QUANTILE(users.age, 0.9) AS p90, APPROX_QUANTILE(age, 1) FROM users",
+        expected);
+
+    EXPECT_EQ(p90.getExpressionString(), "APPROX_QUANTILE(users.age, 0.9)");
+
+    testFailedParse("SELECT APPROX_QUANTILE(age) FROM users", "Expected , fraction");
+    testFailedParse("SELECT APPROX_QUANTILE(age, 1.5) FROM users", "between 0 and 1");
+    testFailedParse("SELECT APPROX_QUANTILE(age, name) FROM users", "Expected quantile fraction");
+}
+
+TEST_F(ParserTest, TableSample) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    Table users("users", "u");
+    users.sample = TableSample{SampleMethod::BERNOULLI, 10.0, std::nullopt};
+    Table orders("orders");
+    orders.sample = TableSample{SampleMethod::SYSTEM, 2.5, 42};
+    select->tables.push_back(users);
+    select->tables.push_back(orders);
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT id FROM users AS u TABLESAMPLE BERNOULLI (10), orders tablesample system (2.5) REPEATABLE (42)",
+                        expected);
+
+    std::ostringstream printed;
+    printed << orders;
+    EXPECT_EQ(printed.str(), "orders TABLESAMPLE SYSTEM (2.5) REPEATABLE (42)");
+
+    testFailedParse("SELECT id FROM users TABLESAMPLE RESERVOIR (10)", "Unknown sampling method");
+    testFailedParse("SELECT id FROM users TABLESAMPLE BERNOULLI (101)", "between 0 and 100");
+    testFailedParse("SELECT id FROM users TABLESAMPLE BERNOULLI 10", "Expected ( after BERNOULLI");
+    testFailedParse("SELECT id FROM users TABLESAMPLE SYSTEM (10) REPEATABLE (1.5)", "Expected seed after REPEATABLE");
+}
+
+TEST_F(ParserTest, SelectOrderBy) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    select->tables.emplace_back(Table("users"));
+    select->orderBy.emplace("users", "age", "");
+    select->orderByDescending = true;
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT id FROM users ORDER BY users.age DESC", expected);
+
+    auto ascending = arena_.make<SelectFrom>();
+    ascending->columns.emplace_back("name");
+    ascending->tables.emplace_back(Table("users"));
+    ascending->groupBy.emplace_back("name");
+    ascending->orderBy.emplace("name");
+    QueryAST expectedAscending(ascending);
+    testSuccessfulParse("SELECT name FROM users GROUP BY name ORDER BY name ASC", expectedAscending);
+
+    testFailedParse("SELECT id FROM users ORDER age", "Expected BY after ORDER");
+}
+
+TEST_F(ParserTest, SelectLimit) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    select->tables.emplace_back(Table("users"));
+    select->orderBy.emplace("age");
+    select->limit = 10;
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT id FROM users ORDER BY age LIMIT 10", expected);
+
+    auto unordered = arena_.make<SelectFrom>();
+    unordered->columns.emplace_back("id");
+    unordered->tables.emplace_back(Table("users"));
+    unordered->limit = 0;
+    QueryAST expectedUnordered(unordered);
+    testSuccessfulParse("SELECT id FROM users LIMIT 0", expectedUnordered);
+
+    testFailedParse("SELECT id FROM users LIMIT age", "Expected row count after LIMIT");
+    testFailedParse("SELECT id FROM users LIMIT 1.5", "Expected row count after LIMIT");
+}
+
+TEST_F(ParserTest, Analyze) {
+    QueryAST expected(arena_.make<Analyze>("users"));
+    testSuccessfulParse("ANALYZE users", expected);
+    testSuccessfulParse("analyze users;", expected);
+    testFailedParse("ANALYZE", "Expected table name");
+}
+
+TEST_F(ParserTest, Explain) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    select->tables.emplace_back(Table("users"));
+    QueryAST expected(arena_.make<Explain>(false, select));
+    testSuccessfulParse("EXPLAIN SELECT id FROM users", expected);
+
+    select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    select->tables.emplace_back(Table("users"));
+    QueryAST expectedAnalyze(arena_.make<Explain>(true, select));
+    testSuccessfulParse("explain analyze SELECT id FROM users;", expectedAnalyze);
+
+    testFailedParse("EXPLAIN ANALYZE users", "Expected SELECT statement");
+    testFailedParse("EXPLAIN", "Expected SELECT statement");
+}
+
+TEST_F(ParserTest, Parameters) {
+    auto select = arena_.make<SelectFrom>();
+    select->columns.emplace_back("id");
+    select->tables.emplace_back(Table("users"));
+    select->where = andCond(makeCondition(CompareOp::EQUAL, ident("id"), arena_.make<Parameter>(0)),
+                            makeCondition(CompareOp::GREATER, arena_.make<Parameter>(1), ident("age")));
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT id FROM users WHERE id = ? AND ? > age", expected);
+    testFailedParse("SELECT id FROM users WHERE id = ? ?", "Expected end of query");
+
+    Parser parser("DELETE FROM users WHERE id = ? OR name = ?;");
+    auto result = parser.parseQuery();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result.value()->parameterCount, 2u);
+}
+
+TEST_F(ParserTest, ArithmeticExpressions) {
+    auto select = arena_.make<SelectFrom>();
+    ColumnRef total("price * quantity", "total");
+    total.expression = arena_.make<Arithmetic>(ArithmeticOp::MULTIPLY, ident("price"), ident("quantity"));
+    select->columns.push_back(total);
+    // Multiplication binds tighter, operators of the same precedence are left-associative
+    auto* sum = arena_.make<Arithmetic>(
+        ArithmeticOp::SUBTRACT,
+        arena_.make<Arithmetic>(ArithmeticOp::ADD, ident("a"),
+                                arena_.make<Arithmetic>(ArithmeticOp::MULTIPLY, ident("b"), makeIntLiteral(2))),
+        ident("c"));
+    ColumnRef sumColumn("(a + (b * 2)) - c");
+    sumColumn.expression = sum;
+    select->columns.push_back(sumColumn);
+    ColumnRef negated("0 - x");
+    negated.expression = arena_.make<Arithmetic>(ArithmeticOp::SUBTRACT, makeIntLiteral(0), ident("x"));
+    select->columns.push_back(negated);
+    ColumnRef remainder("(a + b) % c");
+    remainder.expression = arena_.make<Arithmetic>(
+        ArithmeticOp::MODULO, arena_.make<Arithmetic>(ArithmeticOp::ADD, ident("a"), ident("b")), ident("c"));
+    select->columns.push_back(remainder);
+    select->tables.emplace_back(Table("t"));
+    select->where = makeCondition(CompareOp::GREATER,
+                                  arena_.make<Arithmetic>(ArithmeticOp::ADD, ident("a"), makeIntLiteral(1)),
+                                  arena_.make<Arithmetic>(ArithmeticOp::DIVIDE, ident("b"), makeIntLiteral(2)));
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT price * quantity AS total, a + b * 2 - c, -x, (a + b) % c FROM t WHERE a + 1 > b / 2",
+                        expected);
+
+    // The lexer reads -1 as a literal, which is an addition after an operand
+    auto minusLiteral = arena_.make<SelectFrom>();
+    ColumnRef difference("a + -1");
+    difference.expression = arena_.make<Arithmetic>(ArithmeticOp::ADD, ident("a"), makeIntLiteral(-1));
+    minusLiteral->columns.push_back(difference);
+    minusLiteral->tables.emplace_back(Table("t"));
+    QueryAST expectedMinusLiteral(minusLiteral);
+    testSuccessfulParse("SELECT a -1 FROM t", expectedMinusLiteral);
+
+    testFailedParse("SELECT a + FROM t", "Expected term");
+    testFailedParse("SELECT (a + b FROM t", "Expected closing parenthesis");
+}
+
+TEST_F(ParserTest, FunctionsAndCasts) {
+    auto select = arena_.make<SelectFrom>();
+    ColumnRef upper("UPPER(name)");
+    upper.expression = arena_.make<FunctionCall>(ScalarFunction::UPPER, std::vector<Expression*>{ident("name")});
+    select->columns.push_back(upper);
+    ColumnRef substr("SUBSTR(name, 2, 3)", "prefix");
+    substr.expression = arena_.make<FunctionCall>(
+        ScalarFunction::SUBSTR, std::vector<Expression*>{ident("name"), makeIntLiteral(2), makeIntLiteral(3)});
+    select->columns.push_back(substr);
+    // || is a CONCAT of its two operands
+    ColumnRef concat("CONCAT(CONCAT(first, ' '), last)");
+    concat.expression = arena_.make<FunctionCall>(
+        ScalarFunction::CONCAT,
+        std::vector<Expression*>{
+            arena_.make<FunctionCall>(ScalarFunction::CONCAT, std::vector<Expression*>{ident("first"), makeLiteral(" ")}),
+            ident("last")});
+    select->columns.push_back(concat);
+    ColumnRef cast("CAST(age AS BIGINT)");
+    cast.expression = arena_.make<Cast>(ident("age"), DataType::getInt64());
+    select->columns.push_back(cast);
+    select->tables.emplace_back(Table("users"));
+    QueryAST expected(select);
+    testSuccessfulParse(
+        "SELECT upper(name), SUBSTR(name, 2, 3) AS prefix, first || ' ' || last, CAST(age AS BIGINT) FROM users",
+        expected);
+
+    testFailedParse("SELECT UPPER(a, b) FROM t", "Wrong number of arguments for UPPER");
+    testFailedParse("SELECT SUBSTR(a) FROM t", "Wrong number of arguments for SUBSTR");
+    testFailedParse("SELECT REVERSE(a) FROM t", "Unknown function REVERSE");
+    testFailedParse("SELECT CAST(a INTEGER) FROM t", "Expected AS");
+}
+
+TEST_F(ParserTest, AggregateOfExpression) {
+    auto select = arena_.make<SelectFrom>();
+    ColumnRef revenue("", "price * quantity", "revenue");
+    revenue.aggregate = AggregateFunction::SUM;
+    revenue.expression = arena_.make<Arithmetic>(ArithmeticOp::MULTIPLY, ident("price"), ident("quantity"));
+    select->columns.push_back(revenue);
+    // A plain column argument is not computed
+    ColumnRef maxAge("users", "age", "");
+    maxAge.aggregate = AggregateFunction::MAX;
+    select->columns.push_back(maxAge);
+    select->tables.emplace_back(Table("users"));
+    QueryAST expected(select);
+    testSuccessfulParse("SELECT SUM(price * quantity) AS revenue, MAX((users.age)) FROM users", expected);
+    EXPECT_EQ(revenue.getExpressionString(), "SUM(price * quantity)");
+
+    testFailedParse("SELECT SUM(COUNT(a)) FROM t", "Aggregate calls cannot be nested");
+}
@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/errors.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/exchange.hpp"
+#include "engine/filter.hpp"
+#include "engine/hash_aggregate.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/nested_loop_join.hpp"
+#include "engine/projection.hpp"
+#include "engine/sort_merge_join.hpp"
+#include "engine/table_scan.hpp"
+#include "engine/top_n.hpp"
+#include "gtest/gtest.h"
+#include "planner/explain.hpp"
+#include "planner/physical_planner.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_writer.hpp"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Runs every fragment once against the local catalog, as a cluster of a single worker
+ */
+class LocalFragmentDispatcher : public FragmentDispatcher {
+private:
+    class BufferedStream : public FragmentStream {
+    private:
+        std::vector<std::string> payloads_;
+        size_t next_ = 0;
+
+    public:
+        explicit BufferedStream(std::vector<std::string> payloads) : payloads_(std::move(payloads)) {}
+
+        bool next(std::string& payload) override {
+            if (next_ == payloads_.size()) {
+                return false;
+            }
+            payload = std::move(payloads_[next_++]);
+            return true;
+        }
+    };
+
+    Catalog* catalog_;
+
+public:
+    explicit LocalFragmentDispatcher(Catalog* catalog) : catalog_(catalog) {}
+
+    std::unique_ptr<FragmentStream> dispatch(const std::string& fragment) override {
+        std::vector<std::string> payloads;
+        server::Session(catalog_).executeFragment(
+            fragment, [&payloads](std::string_view payload) { payloads.emplace_back(payload); });
+        return std::make_unique<BufferedStream>(std::move(payloads));
+    }
+};
+
+class PhysicalPlannerTest : public ::testing::Test {
+   protected:
+    std::unique_ptr<JsonCatalog> catalog_;
+
+    void SetUp() override {
+        catalog_ = std::make_unique<JsonCatalog>(fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json");
+    }
+
+    ColumnId column(const std::string& table, const std::string& name) {
+        auto tableId = catalog_->getTableIdByName(table);
+        EXPECT_TRUE(tableId.has_value());
+        auto colId = catalog_->resolveColumn(*tableId, name);
+        EXPECT_TRUE(colId.has_value());
+        return *colId;
+    }
+
+    std::shared_ptr<TableScanOp> scan(const std::string& table) {
+        std::vector<ColumnId> columns;
+        auto tableId = catalog_->getTableIdByName(table);
+        auto handle = catalog_->getTableHandle(*tableId);
+        for (const ColumnMetadata& meta : (*handle)->getSchema()) {
+            columns.push_back(column(table, meta.name));
+        }
+        return std::make_shared<TableScanOp>(std::move(columns));
+    }
+
+    std::unique_ptr<PredicateExpr> compare(CompareOp op, const ColumnId& col, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(col, DataType::getInt64()),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+
+    // Collect the selected rows of a plan as pairs of the first two int64 columns
+    std::multiset<std::pair<int64_t, int64_t>> collectPairs(PhysicalQueryPlan& plan) {
+        std::multiset<std::pair<int64_t, int64_t>> pairs;
+        PhysicalOperator* root = plan.getRoot();
+        root->initialize();
+        RowVector batch;
+        while (root->next(batch) > 0) {
+            EXPECT_EQ(batch.getColumnCount(), 2);
+            for (int64_t row = batch.nextSelectedRow(0); row < batch.getRowCount(); row = batch.nextSelectedRow(row + 1)) {
+                pairs.emplace(batch.getColumn(0).getEntry<db_int64>(row), batch.getColumn(1).getEntry<db_int64>(row));
+            }
+        }
+        return pairs;
+    }
+};
+
+// Test that a filter directly above a scan is fused into it and unused columns are not produced
+TEST_F(PhysicalPlannerTest, FusesFilterIntoScan) {
+    ColumnId id = column("orders", "id");
+    ColumnId userId = column("orders", "user_id");
+
+    auto filter = std::make_shared<FilterOp>(compare(CompareOp::LESS, id, 4));
+    filter->addChild(scan("orders"));
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{id, userId});
+    projection->addChild(filter);
+
+    PhysicalPlanner planner(catalog_.get(), 8192, 1);
+    PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(projection));
+
+    auto* root = dynamic_cast<ProjectionExec*>(plan.getRoot());
+    ASSERT_NE(root, nullptr);
+
+    auto pairs = collectPairs(plan);
+    std::multiset<std::pair<int64_t, int64_t>> expected = {{1, 1}, {2, 2}, {3, 3}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test that the scan only produces the columns referenced above it
+TEST_F(PhysicalPlannerTest, PrunesScanColumns) {
+    ColumnId id = column("orders", "id");
+    ColumnId userId = column("orders", "user_id");
+
+    auto filter = std::make_shared<FilterOp>(compare(CompareOp::EQUAL, userId, 1));
+    filter->addChild(scan("orders"));
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{id});
+    projection->addChild(filter);
+
+    PhysicalPlanner planner(catalog_.get(), 8192, 1);
+    PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(projection));
+
+    auto* root = dynamic_cast<ProjectionExec*>(plan.getRoot());
+    ASSERT_NE(root, nullptr);
+    root->initialize();
+
+    RowVector batch;
+    ASSERT_GT(root->next(batch), 0);
+    EXPECT_EQ(batch.getColumnCount(), 1);
+    EXPECT_EQ(batch.getColumn(0).columnId, id);
+}
+
+// Test that a sampled scan keeps a subset of the rows, the same one for the same seed
+TEST_F(PhysicalPlannerTest, SamplesScan) {
+    ColumnId id = column("orders", "id");
+    ColumnId userId = column("orders", "user_id");
+
+    auto sampled = [&](SampleMethod method, double percent, std::optional<uint64_t> seed) {
+        auto tableScan = scan("orders");
+        auto sampledScan = std::make_shared<TableScanOp>(tableScan->getColumns(), TableSample{method, percent, seed});
+        auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{id, userId});
+        projection->addChild(sampledScan);
+
+        PhysicalPlanner planner(catalog_.get(), 2, 1);
+        PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(projection));
+        return collectPairs(plan);
+    };
+
+    auto all = sampled(SampleMethod::BERNOULLI, 100.0, std::nullopt);
+    ASSERT_FALSE(all.empty());
+    EXPECT_TRUE(sampled(SampleMethod::BERNOULLI, 0.0, std::nullopt).empty());
+    EXPECT_TRUE(sampled(SampleMethod::SYSTEM, 0.0, std::nullopt).empty());
+    EXPECT_EQ(sampled(SampleMethod::SYSTEM, 100.0, std::nullopt), all);
+
+    for (SampleMethod method : {SampleMethod::BERNOULLI, SampleMethod::SYSTEM}) {
+        auto half = sampled(method, 50.0, 7);
+        EXPECT_LE(half.size(), all.size());
+        EXPECT_TRUE(std::includes(all.begin(), all.end(), half.begin(), half.end()));
+        EXPECT_EQ(sampled(method, 50.0, 7), half);
+    }
+}
+
+// Test that an equality between columns of both inputs is planned as a hash join
+TEST_F(PhysicalPlannerTest, PlansEquiJoinAsHashJoin) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderUserId = column("orders", "user_id");
+
+    auto condition = std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                   std::make_unique<ColumnRefExpr>(orderUserId, DataType::getInt64()),
+                                                   std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()));
+    auto join = std::make_shared<JoinOp>(JoinType::INNER, std::move(condition));
+    join->addChild(scan("users"));
+    join->addChild(scan("orders"));
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{userId, orderUserId});
+    projection->addChild(join);
+
+    PhysicalPlanner planner(catalog_.get(), 8192, 1);
+    PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(projection));
+
+    auto* root = dynamic_cast<ProjectionExec*>(plan.getRoot());
+    ASSERT_NE(root, nullptr);
+
+    auto pairs = collectPairs(plan);
+    EXPECT_EQ(pairs.size(), 10u);
+    for (const auto& [user, order] : pairs) {
+        EXPECT_EQ(user, order);
+    }
+}
+
+// Test that joins without an equality condition fall back to a nested loop join
+TEST_F(PhysicalPlannerTest, PlansThetaJoinAsNestedLoopJoin) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderId = column("orders", "id");
+
+    auto condition = std::make_unique<CompareExpr>(CompareOp::GREATER, DataType::getInt64(),
+                                                   std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()),
+                                                   std::make_unique<ColumnRefExpr>(orderId, DataType::getInt64()));
+    auto join = std::make_shared<JoinOp>(JoinType::INNER, std::move(condition));
+
+    auto userFilter = std::make_shared<FilterOp>(compare(CompareOp::LESS, userId, 4));
+    userFilter->addChild(scan("users"));
+    join->addChild(userFilter);
+    join->addChild(scan("orders"));
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{userId, orderId});
+    projection->addChild(join);
+
+    PhysicalPlanner planner(catalog_.get(), 8192, 1);
+    PhysicalQueryPlan plan = planner.plan(LogicalQueryPlan(projection));
+
+    auto pairs = collectPairs(plan);
+    std::multiset<std::pair<int64_t, int64_t>> expected = {{2, 1}, {3, 1}, {3, 2}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test that joins of inputs sorted on their keys merge them, for equalities and range comparisons
+TEST_F(PhysicalPlannerTest, PlansSortedJoinAsSortMergeJoin) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderId = column("orders", "id");
+    ColumnId orderUserId = column("orders", "user_id");
+
+    // The input reduced to the key column, sorted on it unless sorted is false
+    auto keyOnly = [](const ColumnId& key, std::shared_ptr<LogicalOperator> input, bool sorted = true) {
+        std::shared_ptr<LogicalOperator> result = std::make_shared<ProjectionOp>(std::vector<ColumnId>{key});
+        result->addChild(std::move(input));
+        if (sorted) {
+            auto sort = std::make_shared<SortOp>(std::vector<SortKey>{{key, DataType::getInt64(), true}});
+            sort->addChild(std::move(result));
+            result = std::move(sort);
+        }
+        return result;
+    };
+    auto plan = [&](CompareOp op, const ColumnId& left, const ColumnId& right, std::shared_ptr<LogicalOperator> users,
+                    std::shared_ptr<LogicalOperator> orders) {
+        auto condition = std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                                       std::make_unique<ColumnRefExpr>(right, DataType::getInt64()),
+                                                       std::make_unique<ColumnRefExpr>(left, DataType::getInt64()));
+        auto join = std::make_shared<JoinOp>(JoinType::INNER, std::move(condition));
+        join->addChild(std::move(users));
+        join->addChild(std::move(orders));
+
+        PhysicalPlanner planner(catalog_.get(), 8192, 1);
+        return planner.plan(LogicalQueryPlan(join));
+    };
+
+    PhysicalQueryPlan equiJoin = plan(CompareOp::EQUAL, userId, orderUserId, keyOnly(userId, scan("users")),
+                                      keyOnly(orderUserId, scan("orders")));
+    EXPECT_NE(dynamic_cast<SortMergeJoinExec*>(equiJoin.getRoot()), nullptr);
+    auto pairs = collectPairs(equiJoin);
+    EXPECT_EQ(pairs.size(), 10u);
+    for (const auto& [user, order] : pairs) {
+        EXPECT_EQ(user, order);
+    }
+
+    // orders.id < users.id, written with the probe column first
+    auto userFilter = std::make_shared<FilterOp>(compare(CompareOp::LESS, userId, 4));
+    userFilter->addChild(scan("users"));
+    PhysicalQueryPlan rangeJoin = plan(CompareOp::LESS, userId, orderId, keyOnly(userId, userFilter),
+                                       keyOnly(orderId, scan("orders")));
+    EXPECT_NE(dynamic_cast<SortMergeJoinExec*>(rangeJoin.getRoot()), nullptr);
+    std::multiset<std::pair<int64_t, int64_t>> expected = {{2, 1}, {3, 1}, {3, 2}};
+    EXPECT_EQ(collectPairs(rangeJoin), expected);
+
+    // Without the order of the probe input the join stays a hash join
+    PhysicalQueryPlan unsorted = plan(CompareOp::EQUAL, userId, orderUserId, keyOnly(userId, scan("users")),
+                                      keyOnly(orderUserId, scan("orders"), false));
+    EXPECT_NE(dynamic_cast<HashJoinExec*>(unsorted.getRoot()), nullptr);
+}
+
+// Test that a hash join pushes a filter of its build keys into the probe scan, which drops the
+// probe rows without a join partner
+TEST_F(PhysicalPlannerTest, PushesRuntimeFilterIntoProbeScan) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderId = column("orders", "id");
+    ColumnId orderUserId = column("orders", "user_id");
+
+    auto users = catalog_->getTableHandle(*catalog_->getTableIdByName("users"));
+    auto orders = catalog_->getTableHandle(*catalog_->getTableIdByName("orders"));
+    ASSERT_TRUE(users.has_value());
+    ASSERT_TRUE(orders.has_value());
+
+    auto userPredicate = std::make_unique<LogicalExpr>(CompareOp::OR, compare(CompareOp::EQUAL, userId, 2),
+                                                       compare(CompareOp::EQUAL, userId, 7));
+    TableScanExec userScan((*users)->createIterator(8192, 1), {userId}, std::move(userPredicate));
+    TableScanExec orderScan((*orders)->createIterator(8192, 1), {orderUserId, orderId});
+    HashJoinExec join(&userScan, &orderScan, std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()),
+                      std::make_unique<ColumnRefExpr>(orderUserId, DataType::getInt64()));
+    join.initialize();
+    EXPECT_FALSE(orderScan.hasPredicate());
+
+    std::multiset<std::pair<int64_t, int64_t>> pairs;
+    RowVector batch;
+    while (join.next(batch) > 0) {
+        ASSERT_EQ(batch.getColumnCount(), 3);
+        batch.forEachSelectedRow([&](int64_t row) {
+            pairs.emplace(batch.getColumn(0).getEntry<db_int64>(row), batch.getColumn(2).getEntry<db_int64>(row));
+        });
+    }
+
+    EXPECT_TRUE(orderScan.hasPredicate());
+    std::multiset<std::pair<int64_t, int64_t>> expected = {{2, 2}, {2, 8}, {7, 9}};
+    EXPECT_EQ(pairs, expected);
+}
+
+// Test that with profiling every operator gets a profile, which EXPLAIN ANALYZE prints below
+// the logical operator
+TEST_F(PhysicalPlannerTest, ProfilesEveryOperator) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderUserId = column("orders", "user_id");
+
+    auto condition = std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                   std::make_unique<ColumnRefExpr>(orderUserId, DataType::getInt64()),
+                                                   std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()));
+    auto join = std::make_shared<JoinOp>(JoinType::INNER, std::move(condition));
+    auto userScan = scan("users");
+    join->addChild(userScan);
+    join->addChild(scan("orders"));
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{userId, orderUserId});
+    projection->addChild(join);
+    LogicalQueryPlan logicalPlan(projection);
+
+    PhysicalPlanner planner(catalog_.get(), 8192, 1);
+    planner.setProfiling(true);
+    PhysicalQueryPlan plan = planner.plan(logicalPlan);
+    EXPECT_EQ(collectPairs(plan).size(), 10u);
+
+    const OperatorProfile* projectionProfile = plan.getProfile(projection.get());
+    const OperatorProfile* joinProfile = plan.getProfile(join.get());
+    const OperatorProfile* scanProfile = plan.getProfile(userScan.get());
+    ASSERT_NE(projectionProfile, nullptr);
+    ASSERT_NE(joinProfile, nullptr);
+    ASSERT_NE(scanProfile, nullptr);
+
+    EXPECT_EQ(projectionProfile->rowsOut, 10);
+    EXPECT_EQ(projectionProfile->batches, 1);
+    EXPECT_EQ(projectionProfile->calls, 2);
+    EXPECT_EQ(joinProfile->rowsOut, 10);
+    EXPECT_GT(joinProfile->bytesAllocated, 0u);
+    EXPECT_EQ(scanProfile->rowsOut, 10);
+    EXPECT_GE(projectionProfile->wallTime, joinProfile->wallTime);
+
+    std::string explained = explainPlan(logicalPlan, plan);
+    EXPECT_NE(explained.find("Projection["), std::string::npos);
+    EXPECT_NE(explained.find("-> Join[INNER, condition]  (rows in=20, rows out=10"), std::string::npos);
+
+    // Without profiling the operators run unwrapped
+    planner.setProfiling(false);
+    PhysicalQueryPlan unprofiled = planner.plan(logicalPlan);
+    EXPECT_NE(dynamic_cast<ProjectionExec*>(unprofiled.getRoot()), nullptr);
+    EXPECT_EQ(unprofiled.getProfile(projection.get()), nullptr);
+}
+
+// Test that aggregates and top-ns of small inputs stay on a single thread, also if the inputs are
+// gathered from a cluster, and produce the same rows as without a cluster
+TEST_F(PhysicalPlannerTest, KeepsSmallGatheredInputsSingleThreaded) {
+    ColumnId userId = column("users", "id");
+    ColumnId orderId = column("orders", "id");
+    ColumnId orderUserId = column("orders", "user_id");
+
+    auto join = std::make_shared<JoinOp>(
+        JoinType::INNER, std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                       std::make_unique<ColumnRefExpr>(orderUserId, DataType::getInt64()),
+                                                       std::make_unique<ColumnRefExpr>(userId, DataType::getInt64())));
+    join->addChild(scan("users"));
+    join->addChild(scan("orders"));
+    auto aggregate = std::make_shared<AggregateOp>(
+        std::vector<ColumnDescriptor> {{orderUserId, DataType::getInt64()}},
+        std::vector<AggregateSpec> {{AggregateFunction::SUM, orderId, DataType::getInt64(), ColumnId(1, "total")}});
+    aggregate->addChild(join);
+    auto topN = std::make_shared<TopNOp>(std::vector<SortKey> {{orderId, DataType::getInt64(), false}}, 3);
+    topN->addChild(join);
+
+    LocalFragmentDispatcher dispatcher(catalog_.get());
+    PhysicalPlanner gathered(catalog_.get(), 8192, 4);
+    gathered.setDispatcher(&dispatcher);
+    PhysicalPlanner local(catalog_.get(), 8192, 4);
+
+    PhysicalQueryPlan gatheredAggregate = gathered.plan(LogicalQueryPlan(aggregate));
+    PhysicalQueryPlan localAggregate = local.plan(LogicalQueryPlan(aggregate));
+    ASSERT_NE(dynamic_cast<HashAggregateExec*>(gatheredAggregate.getRoot()), nullptr);
+    ASSERT_NE(dynamic_cast<HashAggregateExec*>(localAggregate.getRoot()), nullptr);
+    auto groups = collectPairs(gatheredAggregate);
+    EXPECT_FALSE(groups.empty());
+    EXPECT_EQ(groups, collectPairs(localAggregate));
+
+    PhysicalQueryPlan gatheredTopN = gathered.plan(LogicalQueryPlan(topN));
+    ASSERT_NE(dynamic_cast<TopNExec*>(gatheredTopN.getRoot()), nullptr);
+    EXPECT_EQ(gatheredTopN.run(), 3);
+}
+
+// Test that joins of gathered inputs too large for the coordinator to receive are refused
+TEST_F(PhysicalPlannerTest, RefusesJoinsOfLargeGatheredInputs) {
+    // The files are never read, planning only looks at their row counts
+    fs::path tempDir = fs::temp_directory_path() / "tdb_tests" / "physical_planner_gather_test";
+    fs::create_directories(tempDir);
+    std::ofstream(tempDir / "manifest.json") << R"({
+        "tables": [{
+            "name": "events", "id": 1, "id_name": "events", "format": "csv",
+            "schema": [{"name": "user_id", "type": "INT64", "nullable": false}],
+            "files": [{"path": "events.csv", "row_count": 20000000}]
+        }, {
+            "name": "people", "id": 2, "id_name": "people", "format": "csv",
+            "schema": [{"name": "id", "type": "INT64", "nullable": false}],
+            "files": [{"path": "people.csv", "row_count": 10}]
+        }]
+    })";
+    catalog_ = std::make_unique<JsonCatalog>(tempDir / "manifest.json");
+
+    ColumnId userId = column("events", "user_id");
+    ColumnId id = column("people", "id");
+    auto join = std::make_shared<JoinOp>(
+        JoinType::INNER, std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                       std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()),
+                                                       std::make_unique<ColumnRefExpr>(id, DataType::getInt64())));
+    join->addChild(scan("people"));
+    join->addChild(scan("events"));
+
+    LocalFragmentDispatcher dispatcher(catalog_.get());
+    PhysicalPlanner gathered(catalog_.get(), 8192, 4);
+    gathered.setDispatcher(&dispatcher);
+    EXPECT_THROW(gathered.plan(LogicalQueryPlan(join)), NotYetImplementedError);
+
+    // Read locally, the join is planned as usual
+    PhysicalPlanner local(catalog_.get(), 8192, 4);
+    EXPECT_NO_THROW(local.plan(LogicalQueryPlan(join)));
+
+    catalog_.reset();
+    fs::remove_all(tempDir);
+}
+
+/**
+ * @brief Plans over a TDB table large enough to be aggregated on several workers
+ */
+class ParallelPlannerTest : public PhysicalPlannerTest {
+protected:
+    static constexpr int64_t ROW_COUNT = 120'000;
+    static constexpr int64_t GROUP_COUNT = 10;
+
+    fs::path tempDir_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "physical_planner_test";
+        fs::create_directories(tempDir_);
+        std::ofstream(tempDir_ / "manifest.json") << R"({
+            "tables": [{
+                "name": "events", "id": 1, "id_name": "events", "format": "tdb",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "grp", "type": "INT64", "nullable": false}
+                ],
+                "files": []
+            }]
+        })";
+        catalog_ = std::make_unique<JsonCatalog>(tempDir_ / "manifest.json");
+
+        // Rows with ids in [0, ROW_COUNT), grp is the id modulo GROUP_COUNT
+        constexpr int64_t BATCH_SIZE = 1000;
+        ColumnId id = column("events", "id");
+        ColumnId grp = column("events", "grp");
+        memory::BufferManager bufferManager;
+        TableWriter writer(catalog_.get(), id.getTableId());
+        for (int64_t from = 0; from < ROW_COUNT; from += BATCH_SIZE) {
+            BatchAllocator allocator(&bufferManager);
+            RowVector batch = allocator.allocateBatch({{id, DataType::getInt64()}, {grp, DataType::getInt64()}});
+            for (int64_t row = 0; row < BATCH_SIZE; ++row) {
+                batch.getColumn(0).writeEntry<db_int64>(row, from + row);
+                batch.getColumn(1).writeEntry<db_int64>(row, (from + row) % GROUP_COUNT);
+            }
+            batch.setRowCount(BATCH_SIZE);
+            writer.append(batch);
+        }
+        ASSERT_TRUE(writer.flush().has_value());
+        ASSERT_EQ(catalog_->getRowCount(id.getTableId()), ROW_COUNT);
+    }
+
+    void TearDown() override {
+        catalog_.reset();
+        fs::remove_all(tempDir_);
+    }
+};
+
+// Test that with several workers, aggregates and top-ns of large scans run as parallel pipelines
+// that read the table on the workers, and produce the same rows as on a single thread
+TEST_F(ParallelPlannerTest, ScansOnWorkers) {
+    ColumnId id = column("events", "id");
+    ColumnId grp = column("events", "grp");
+
+    auto filter = std::make_shared<FilterOp>(compare(CompareOp::GREATER_EQUAL, id, 1000));
+    filter->addChild(scan("events"));
+    auto aggregate = std::make_shared<AggregateOp>(
+        std::vector<ColumnDescriptor> {{grp, DataType::getInt64()}},
+        std::vector<AggregateSpec> {{AggregateFunction::SUM, id, DataType::getInt64(), ColumnId(1, "total")}});
+    aggregate->addChild(filter);
+
+    PhysicalPlanner parallel(catalog_.get(), 8192, 4);
+    PhysicalPlanner sequential(catalog_.get(), 8192, 1);
+
+    PhysicalQueryPlan parallelAggregate = parallel.plan(LogicalQueryPlan(aggregate));
+    PhysicalQueryPlan sequentialAggregate = sequential.plan(LogicalQueryPlan(aggregate));
+    auto* aggregateExec = dynamic_cast<ParallelHashAggregateExec*>(parallelAggregate.getRoot());
+    ASSERT_NE(aggregateExec, nullptr);
+    EXPECT_EQ(aggregateExec->getWorkerCount(), 4u);
+    EXPECT_TRUE(aggregateExec->hasSource());
+    ASSERT_NE(dynamic_cast<HashAggregateExec*>(sequentialAggregate.getRoot()), nullptr);
+    auto groups = collectPairs(parallelAggregate);
+    EXPECT_EQ(groups.size(), static_cast<size_t>(GROUP_COUNT));
+    EXPECT_EQ(groups, collectPairs(sequentialAggregate));
+
+    // The filter and the projection run on the workers, above the scan
+    auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId> {grp, id});
+    projection->addChild(filter);
+    auto topN = std::make_shared<TopNOp>(std::vector<SortKey> {{id, DataType::getInt64(), false}}, 3);
+    topN->addChild(projection);
+
+    PhysicalQueryPlan parallelTopN = parallel.plan(LogicalQueryPlan(topN));
+    PhysicalQueryPlan sequentialTopN = sequential.plan(LogicalQueryPlan(topN));
+    auto* topNExec = dynamic_cast<ParallelTopNExec*>(parallelTopN.getRoot());
+    ASSERT_NE(topNExec, nullptr);
+    EXPECT_TRUE(topNExec->hasSource());
+    ASSERT_NE(dynamic_cast<TopNExec*>(sequentialTopN.getRoot()), nullptr);
+    std::multiset<std::pair<int64_t, int64_t>> expected = {{9, ROW_COUNT - 1}, {8, ROW_COUNT - 2}, {7, ROW_COUNT - 3}};
+    EXPECT_EQ(collectPairs(parallelTopN), expected);
+    EXPECT_EQ(collectPairs(sequentialTopN), expected);
+}
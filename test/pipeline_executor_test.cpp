@@ -0,0 +1,243 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "common/data_strucures/lock_free_queue.hpp"
+#include "engine/filter.hpp"
+#include "engine/morsel.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "engine/predicate_expr.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+namespace {
+
+// Passes batches through, sleeping for every batch to make workers slow
+class SlowExec : public PhysicalOperator {
+    PhysicalOperator* input_;
+
+public:
+    explicit SlowExec(PhysicalOperator* input) : input_(input) {}
+
+    void initialize() override { input_->initialize(); }
+
+    int64_t next(RowVector& out) override {
+        int64_t count = input_->next(out);
+        if (count > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return count;
+    }
+};
+
+class ThrowingExec : public PhysicalOperator {
+    PhysicalOperator* input_;
+
+public:
+    explicit ThrowingExec(PhysicalOperator* input) : input_(input) {}
+
+    void initialize() override { input_->initialize(); }
+
+    int64_t next(RowVector& out) override {
+        if (input_->next(out) > 0) {
+            throw std::runtime_error("operator failed");
+        }
+        return 0;
+    }
+};
+
+}  // namespace
+
+class PipelineExecutorTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage;
+    memory::BufferManager bufferManager;
+
+    std::unique_ptr<PredicateExpr> compare(CompareOp op, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+
+    // Values of the first column of all materialized parts
+    static std::vector<int64_t> collectValues(const MaterializeSink& sink) {
+        std::vector<int64_t> values;
+        for (const MaterializedInput* part : sink.getParts()) {
+            for (size_t c = 0; c < part->getChunkCount(); ++c) {
+                const RowVector& chunk = part->getChunk(c);
+                for (int64_t row = 0; row < chunk.getRowCount(); ++row) {
+                    values.push_back(chunk.getColumn(0).getEntry<db_int64>(row));
+                }
+            }
+        }
+        return values;
+    }
+};
+
+// Test that values pushed by several producers are popped exactly once by several consumers
+TEST_F(PipelineExecutorTest, LockFreeQueueConcurrentProducersAndConsumers) {
+    LockFreeQueue<int64_t> queue(64);
+    EXPECT_EQ(queue.getCapacity(), 64u);
+
+    const int64_t perProducer = 5000;
+    std::atomic<int64_t> popped = 0;
+    std::atomic<int64_t> sum = 0;
+    std::vector<std::thread> threads;
+
+    for (int64_t producer = 0; producer < 2; ++producer) {
+        threads.emplace_back([&queue, producer] {
+            for (int64_t i = 0; i < perProducer; ++i) {
+                int64_t value = producer * perProducer + i;
+                while (!queue.tryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int consumer = 0; consumer < 2; ++consumer) {
+        threads.emplace_back([&] {
+            int64_t value;
+            while (popped.load() < 2 * perProducer) {
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int64_t expected = (2 * perProducer) * (2 * perProducer - 1) / 2;
+    EXPECT_EQ(sum.load(), expected);
+
+    int64_t value;
+    EXPECT_FALSE(queue.tryPop(value));
+}
+
+// Test a filter pipeline running on several workers against the serial result
+TEST_F(PipelineExecutorTest, FilterPipeline) {
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", intSequence(0, 100000))
+        .withBatchSizes(std::vector<int64_t>(20, 5000))
+        .build();
+    OperatorMorselSource source(input.get(), &bufferManager);
+    MaterializeSink sink(&bufferManager);
+
+    Pipeline pipeline;
+    pipeline.source = &source;
+    pipeline.factory = [this](PhysicalOperator* scan, OperatorChain& chain) -> PhysicalOperator* {
+        return chain.add<FilterExec>(scan, compare(CompareOp::LESS, 30000));
+    };
+    pipeline.sink = &sink;
+
+    PipelineExecutor executor(4, 256);
+    executor.run(pipeline);
+
+    std::vector<int64_t> values = collectValues(sink);
+    EXPECT_EQ(sink.getRowCount(), 30000);
+    ASSERT_EQ(values.size(), 30000u);
+
+    std::set<int64_t> distinct(values.begin(), values.end());
+    EXPECT_EQ(distinct.size(), 30000u);
+    EXPECT_EQ(*distinct.rbegin(), 29999);
+}
+
+// Test that pipelines run after their dependencies and can read their materialized output
+TEST_F(PipelineExecutorTest, DependentPipelines) {
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", intSequence(0, 10000))
+        .withBatchSizes({4000, 4000, 2000})
+        .build();
+    OperatorMorselSource source(input.get(), &bufferManager);
+    MaterializeSink buildSink(&bufferManager);
+
+    Pipeline build;
+    build.source = &source;
+    build.factory = [this](PhysicalOperator* scan, OperatorChain& chain) -> PhysicalOperator* {
+        return chain.add<FilterExec>(scan, compare(CompareOp::GREATER_EQUAL, 2500));
+    };
+    build.sink = &buildSink;
+
+    // The source of the second pipeline only knows its parts once the first one finished
+    std::unique_ptr<MaterializedMorselSource> buildOutput;
+    struct LazySource : MorselSource {
+        MaterializeSink* sink;
+        std::unique_ptr<MaterializedMorselSource>* source;
+
+        std::shared_ptr<const RowVector> nextBatch() override {
+            if (!*source) {
+                *source = std::make_unique<MaterializedMorselSource>(sink->getParts());
+            }
+            return (*source)->nextBatch();
+        }
+    } lazySource;
+    lazySource.sink = &buildSink;
+    lazySource.source = &buildOutput;
+
+    MaterializeSink probeSink(&bufferManager);
+    Pipeline probe;
+    probe.source = &lazySource;
+    probe.factory = [this](PhysicalOperator* scan, OperatorChain& chain) -> PhysicalOperator* {
+        return chain.add<FilterExec>(scan, compare(CompareOp::LESS, 5000));
+    };
+    probe.sink = &probeSink;
+    probe.dependencies = {&build};
+
+    PipelineExecutor executor(3, 512);
+    executor.run({&probe, &build});
+
+    EXPECT_EQ(buildSink.getRowCount(), 7500);
+    std::vector<int64_t> values = collectValues(probeSink);
+    ASSERT_EQ(values.size(), 2500u);
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), int64_t{0}), (2500 + 4999) * 2500 / 2);
+}
+
+// Test that idle workers steal the morsels of a worker that fetched the only batch
+TEST_F(PipelineExecutorTest, WorkStealing) {
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 4096)).build();
+    OperatorMorselSource source(input.get(), &bufferManager);
+    MaterializeSink sink(&bufferManager);
+
+    Pipeline pipeline;
+    pipeline.source = &source;
+    pipeline.factory = [](PhysicalOperator* scan, OperatorChain& chain) -> PhysicalOperator* {
+        return chain.add<SlowExec>(scan);
+    };
+    pipeline.sink = &sink;
+
+    PipelineExecutor executor(4, 64);
+    executor.run(pipeline);
+
+    EXPECT_EQ(sink.getRowCount(), 4096);
+    EXPECT_GT(executor.getStolenMorselCount(), 0);
+    EXPECT_GT(sink.getParts().size(), 1u);
+}
+
+// Test that an exception of a worker cancels the pipeline and reaches the caller
+TEST_F(PipelineExecutorTest, WorkerExceptionIsRethrown) {
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 10000)).build();
+    OperatorMorselSource source(input.get(), &bufferManager);
+    MaterializeSink sink(&bufferManager);
+
+    Pipeline pipeline;
+    pipeline.source = &source;
+    pipeline.factory = [](PhysicalOperator* scan, OperatorChain& chain) -> PhysicalOperator* {
+        return chain.add<ThrowingExec>(scan);
+    };
+    pipeline.sink = &sink;
+
+    PipelineExecutor executor(4, 64);
+    EXPECT_THROW(executor.run(pipeline), std::runtime_error);
+}
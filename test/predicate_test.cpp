@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "engine/predicate_result.hpp"
+#include "engine/fused_predicate.hpp"
 #include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
 #include <memory>
 
 using namespace toydb;
@@ -31,6 +33,94 @@ TEST_F(PredicateTest, BitmaskResultBasic) {
     EXPECT_EQ(result.count(), 2);
 }
 
+// Test three-valued AND, OR and NOT for all combinations, spread over multiple words
+TEST_F(PredicateTest, BitmaskResultThreeValuedLogic) {
+    const PredicateValue values[] = {PredicateValue::TRUE, PredicateValue::FALSE, PredicateValue::NULL_VALUE};
+    constexpr int64_t rowCount = 150;
+
+    BitmaskResult left(rowCount);
+    BitmaskResult right(rowCount);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        left.set(i, values[i % 3]);
+        right.set(i, values[(i / 3) % 3]);
+    }
+
+    BitmaskResult andResult = left;
+    andResult.combineAnd(right);
+    BitmaskResult orResult = left;
+    orResult.combineOr(right);
+    BitmaskResult notResult = left;
+    notResult.negate();
+
+    int64_t expectedAndCount = 0;
+    for (int64_t i = 0; i < rowCount; ++i) {
+        PredicateValue l = left.get(i);
+        PredicateValue r = right.get(i);
+
+        PredicateValue expectedAnd = (l == PredicateValue::FALSE || r == PredicateValue::FALSE) ? PredicateValue::FALSE
+                                   : (l == PredicateValue::NULL_VALUE || r == PredicateValue::NULL_VALUE) ? PredicateValue::NULL_VALUE
+                                   : PredicateValue::TRUE;
+        PredicateValue expectedOr = (l == PredicateValue::TRUE || r == PredicateValue::TRUE) ? PredicateValue::TRUE
+                                  : (l == PredicateValue::NULL_VALUE || r == PredicateValue::NULL_VALUE) ? PredicateValue::NULL_VALUE
+                                  : PredicateValue::FALSE;
+        PredicateValue expectedNot = l == PredicateValue::NULL_VALUE ? PredicateValue::NULL_VALUE
+                                   : l == PredicateValue::TRUE ? PredicateValue::FALSE : PredicateValue::TRUE;
+
+        EXPECT_EQ(andResult.get(i), expectedAnd) << "row " << i;
+        EXPECT_EQ(orResult.get(i), expectedOr) << "row " << i;
+        EXPECT_EQ(notResult.get(i), expectedNot) << "row " << i;
+        expectedAndCount += expectedAnd == PredicateValue::TRUE;
+    }
+
+    EXPECT_EQ(andResult.count(), expectedAndCount);
+    EXPECT_EQ(left.count(), 50);
+    EXPECT_EQ(notResult.count(), 50);
+
+    // setAll must not set bits past the end, which would be counted
+    BitmaskResult all(rowCount);
+    all.setAll(PredicateValue::TRUE);
+    EXPECT_EQ(all.count(), rowCount);
+    all.negate();
+    EXPECT_EQ(all.count(), 0);
+    all.setAll(PredicateValue::FALSE);
+    all.negate();
+    EXPECT_EQ(all.count(), rowCount);
+}
+
+// Test conversion of a sparse result to a selection vector
+TEST_F(PredicateTest, SelectionVectorRepresentation) {
+    PredicateResultVector result(300);
+    result.setAll(PredicateValue::FALSE);
+    for (int64_t row : {3, 64, 65, 200, 299}) {
+        result.setTrue(row);
+    }
+    result.setNull(100);
+
+    EXPECT_EQ(result.nextTrue(0), 3);
+    EXPECT_EQ(result.nextTrue(4), 64);
+    EXPECT_EQ(result.nextTrue(66), 200);
+    EXPECT_EQ(result.nextTrue(300), 300);
+
+    EXPECT_FALSE(result.hasSelectionVector());
+    EXPECT_TRUE(result.adaptRepresentation());
+    ASSERT_TRUE(result.hasSelectionVector());
+
+    const SelectionVector& selection = result.getSelectionVector();
+    ASSERT_EQ(selection.size(), 5);
+    EXPECT_EQ(selection[0], 3);
+    EXPECT_EQ(selection[1], 64);
+    EXPECT_EQ(selection[4], 299);
+    EXPECT_EQ(result.count(), 5);
+
+    // Dense results keep the bitmask, modifications drop the selection vector
+    PredicateResultVector dense(100);
+    dense.setAll(PredicateValue::TRUE);
+    EXPECT_FALSE(dense.adaptRepresentation());
+    result.setTrue(0);
+    EXPECT_FALSE(result.hasSelectionVector());
+    EXPECT_EQ(result.count(), 6);
+}
+
 // Test PredicateResult wrapper
 TEST_F(PredicateTest, PredicateResultWrapper) {
     PredicateResultVector result(5);
@@ -371,3 +461,369 @@ TEST_F(PredicateTest, ComplexNestedPredicateWithColumnIndexMap) {
     EXPECT_EQ(result.get(4), PredicateValue::TRUE);
 }
 
+
+// Test that the batch kernels agree with row evaluation across multiple words, for every operator,
+// with NULLs on both sides and with the constant on either side
+TEST_F(PredicateTest, CompareExprBatchMatchesRowEvaluation) {
+    constexpr int64_t rowCount = 200;
+    static std::vector<int64_t> leftData(rowCount);
+    static std::vector<int64_t> rightData(rowCount);
+    static std::vector<uint8_t> leftBitmap((rowCount + 7) / 8);
+    static std::vector<uint8_t> rightBitmap((rowCount + 7) / 8);
+
+    ColumnId leftId(0, "left");
+    ColumnId rightId(1, "right");
+    ColumnBuffer leftCol(leftId, DataType::getInt64(), leftData.data(), rowCount, NullBitmap(leftBitmap.data(), rowCount));
+    ColumnBuffer rightCol(rightId, DataType::getInt64(), rightData.data(), rowCount, NullBitmap(rightBitmap.data(), rowCount));
+    for (int64_t i = 0; i < rowCount; ++i) {
+        leftCol.writeEntry<db_int64>(i, i % 17);
+        rightCol.writeEntry<db_int64>(i, i % 5 * 3);
+        if (i % 7 == 0) leftCol.setNull(i); else leftCol.clearNull(i);
+        if (i % 11 == 0) rightCol.setNull(i); else rightCol.clearNull(i);
+    }
+
+    RowVector buffer;
+    buffer.addColumn(leftCol);
+    buffer.addColumn(rightCol);
+    buffer.setRowCount(rowCount);
+
+    for (CompareOp op : {CompareOp::EQUAL, CompareOp::NOT_EQUAL, CompareOp::GREATER, CompareOp::LESS,
+                         CompareOp::GREATER_EQUAL, CompareOp::LESS_EQUAL}) {
+        std::vector<std::unique_ptr<CompareExpr>> exprs;
+        exprs.push_back(std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(leftId, DataType::getInt64()),
+            std::make_unique<ColumnRefExpr>(rightId, DataType::getInt64())));
+        exprs.push_back(std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(leftId, DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), 8L)));
+        exprs.push_back(std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), 8L),
+            std::make_unique<ColumnRefExpr>(leftId, DataType::getInt64())));
+
+        for (auto& expr : exprs) {
+            expr->initializeIndexMap();
+            PredicateResultVector result = expr->evaluate(buffer);
+            ASSERT_EQ(result.size(), rowCount);
+            for (int64_t i = 0; i < rowCount; ++i) {
+                ASSERT_EQ(result.get(i), expr->evaluateRow(buffer, i)) << "op " << toString(op) << ", row " << i;
+            }
+        }
+    }
+}
+
+// Test comparisons between operands of different types, as produced by the interpreter with casts
+TEST_F(PredicateTest, CompareExprMixedTypes) {
+    static std::vector<int32_t> intData = {1, 2, 3, 4};
+    static std::vector<double> doubleData = {0.5, 2.0, 3.5, 4.0};
+
+    ColumnId intId(0, "ints");
+    ColumnId doubleId(1, "doubles");
+    ColumnBuffer intCol(intId, DataType::getInt32(), intData.data(), 4);
+    intCol.count = 4;
+    ColumnBuffer doubleCol(doubleId, DataType::getDouble(), doubleData.data(), 4);
+    doubleCol.count = 4;
+
+    RowVector buffer;
+    buffer.addColumn(intCol);
+    buffer.addColumn(doubleCol);
+    buffer.setRowCount(4);
+
+    // CAST(ints AS DOUBLE) = doubles
+    CompareExpr equal(CompareOp::EQUAL, DataType::getDouble(),
+        std::make_unique<CastExpr>(DataType::getDouble(), std::make_unique<ColumnRefExpr>(intId, DataType::getInt32())),
+        std::make_unique<ColumnRefExpr>(doubleId, DataType::getDouble()));
+    equal.initializeIndexMap();
+
+    PredicateResultVector result = equal.evaluate(buffer);
+    EXPECT_EQ(result.get(0), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(1), PredicateValue::TRUE);
+    EXPECT_EQ(result.get(2), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(3), PredicateValue::TRUE);
+    EXPECT_EQ(result.count(), 2);
+
+    // CAST(ints AS INT64) >= 3
+    CompareExpr greaterEqual(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+        std::make_unique<CastExpr>(DataType::getInt64(), std::make_unique<ColumnRefExpr>(intId, DataType::getInt32())),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), 3L));
+    greaterEqual.initializeIndexMap();
+    EXPECT_EQ(greaterEqual.evaluate(buffer).count(), 2);
+}
+
+// Test string comparisons
+TEST_F(PredicateTest, CompareExprStrings) {
+    static std::vector<db_string> stringData(3);
+    ColumnId colId(0, "city");
+    ColumnBuffer col(colId, DataType::getString(), stringData.data(), 3);
+    for (const auto& [i, value] : std::vector<std::pair<int64_t, std::string>>{{0, "Berlin"}, {1, "Munich"}, {2, "Bonn"}}) {
+        col.writeString(i, value);
+    }
+
+    RowVector buffer;
+    buffer.addColumn(col);
+    buffer.setRowCount(3);
+
+    CompareExpr less(CompareOp::LESS, DataType::getString(),
+        std::make_unique<ColumnRefExpr>(colId, DataType::getString()),
+        std::make_unique<ConstantExpr>(DataType::getString(), std::string("C")));
+    less.initializeIndexMap();
+
+    PredicateResultVector result = less.evaluate(buffer);
+    EXPECT_EQ(result.get(0), PredicateValue::TRUE);
+    EXPECT_EQ(result.get(1), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(2), PredicateValue::TRUE);
+}
+
+// Test comparisons of strings longer than the inline length and sharing a prefix
+TEST_F(PredicateTest, CompareExprLongStrings) {
+    static std::vector<db_string> stringData(4);
+    StringHeap heap;
+    ColumnId colId(0, "email");
+    ColumnBuffer col(colId, DataType::getString(), stringData.data(), 4);
+    col.setStringHeap(&heap);
+    std::vector<std::string> values = {
+        "alice.johnson@email.com", "alice.johnson@email.org", "alice", "bob.smith@email.com"};
+    for (size_t i = 0; i < values.size(); ++i) {
+        col.writeString(static_cast<int64_t>(i), values[i]);
+    }
+
+    EXPECT_FALSE(col.getEntry<db_string>(0).isInline());
+    EXPECT_TRUE(col.getEntry<db_string>(2).isInline());
+    EXPECT_EQ(col.getEntry<db_string>(1).view(), values[1]);
+
+    RowVector buffer;
+    buffer.addColumn(col);
+    buffer.setRowCount(4);
+
+    std::string constant = "alice.johnson@email.com";
+    CompareExpr equal(CompareOp::EQUAL, DataType::getString(),
+        std::make_unique<ColumnRefExpr>(colId, DataType::getString()),
+        std::make_unique<ConstantExpr>(DataType::getString(), constant));
+    equal.initializeIndexMap();
+
+    PredicateResultVector result = equal.evaluate(buffer);
+    EXPECT_EQ(result.get(0), PredicateValue::TRUE);
+    EXPECT_EQ(result.get(1), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(2), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(3), PredicateValue::FALSE);
+
+    CompareExpr greater(CompareOp::GREATER, DataType::getString(),
+        std::make_unique<ColumnRefExpr>(colId, DataType::getString()),
+        std::make_unique<ConstantExpr>(DataType::getString(), constant));
+    greater.initializeIndexMap();
+
+    result = greater.evaluate(buffer);
+    EXPECT_EQ(result.get(0), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(1), PredicateValue::TRUE);
+    EXPECT_EQ(result.get(2), PredicateValue::FALSE);
+    EXPECT_EQ(result.get(3), PredicateValue::TRUE);
+
+    for (int64_t row = 0; row < 4; ++row) {
+        EXPECT_EQ(greater.evaluateRow(buffer, row), result.get(row)) << "Row " << row;
+    }
+}
+
+// Test that fused conjunctions select exactly the rows for which the predicate tree is TRUE, with
+// NULLs, casts, constants on either side and an input selection
+TEST_F(PredicateTest, FusedPredicateMatchesTree) {
+    constexpr int64_t rowCount = 200;
+    static std::vector<int32_t> intData(rowCount);
+    static std::vector<double> doubleData(rowCount);
+    static std::vector<db_string> stringData(rowCount);
+    static std::vector<uint8_t> intBitmap((rowCount + 7) / 8);
+
+    ColumnId intId(0, "ints");
+    ColumnId doubleId(1, "doubles");
+    ColumnId stringId(2, "strings");
+    ColumnBuffer intCol(intId, DataType::getInt32(), intData.data(), rowCount, NullBitmap(intBitmap.data(), rowCount));
+    ColumnBuffer doubleCol(doubleId, DataType::getDouble(), doubleData.data(), rowCount);
+    ColumnBuffer stringCol(stringId, DataType::getString(), stringData.data(), rowCount);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        intCol.writeEntry<db_int32>(i, static_cast<int32_t>(i % 13));
+        if (i % 9 == 0) intCol.setNull(i); else intCol.clearNull(i);
+        doubleCol.writeEntry<db_double>(i, static_cast<double>(i) / 4);
+        stringCol.writeString(i, i % 3 == 0 ? "berlin" : "munich");
+    }
+    intCol.count = doubleCol.count = stringCol.count = rowCount;
+
+    auto ints = [&] { return std::make_unique<CastExpr>(DataType::getInt64(), std::make_unique<ColumnRefExpr>(intId, DataType::getInt32())); };
+    auto doubles = [&] { return std::make_unique<ColumnRefExpr>(doubleId, DataType::getDouble()); };
+    auto strings = [&] { return std::make_unique<ColumnRefExpr>(stringId, DataType::getString()); };
+    auto conjunction = [](std::unique_ptr<PredicateExpr> left, std::unique_ptr<PredicateExpr> right) {
+        return std::make_unique<LogicalExpr>(CompareOp::AND, std::move(left), std::move(right));
+    };
+
+    std::vector<std::unique_ptr<PredicateExpr>> predicates;
+    predicates.push_back(std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(), ints(),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{4})));
+    predicates.push_back(conjunction(
+        std::make_unique<CompareExpr>(CompareOp::LESS, DataType::getInt64(),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{2}), ints()),
+        std::make_unique<CompareExpr>(CompareOp::LESS_EQUAL, DataType::getDouble(), doubles(),
+            std::make_unique<ConstantExpr>(DataType::getDouble(), 30.5))));
+    predicates.push_back(conjunction(
+        conjunction(
+            std::make_unique<CompareExpr>(CompareOp::NOT_EQUAL, DataType::getString(), strings(),
+                std::make_unique<ConstantExpr>(DataType::getString(), std::string("berlin"))),
+            std::make_unique<CompareExpr>(CompareOp::GREATER, DataType::getDouble(), doubles(),
+                std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{10}))),
+        std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(), ints(),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{5}))));
+
+    PredicateResultVector selection(rowCount);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        selection.set(i, i % 2 == 0 ? PredicateValue::TRUE : PredicateValue::FALSE);
+    }
+
+    for (auto& predicate : predicates) {
+        predicate->initializeIndexMap();
+        std::vector<const ColumnRefExpr*> refs;
+        collectColumnRefs(predicate.get(), refs);
+        RowVector input;
+        for (const ColumnRefExpr* ref : refs) {
+            input.addColumn(ref->getColumnId() == intId ? intCol : ref->getColumnId() == doubleId ? doubleCol : stringCol);
+        }
+        input.setRowCount(rowCount);
+
+        auto fused = FusedPredicate::compile(*predicate);
+        ASSERT_TRUE(fused.has_value());
+
+        PredicateResultVector expected = predicate->evaluate(input);
+        PredicateResultVector all;
+        PredicateResultVector selected;
+        fused->evaluateInto(input, all);
+        fused->evaluateInto(input, selected, &selection);
+        for (int64_t i = 0; i < rowCount; ++i) {
+            bool isTrue = expected.get(i) == PredicateValue::TRUE;
+            ASSERT_EQ(all.get(i), isTrue ? PredicateValue::TRUE : PredicateValue::FALSE) << "Row " << i;
+            ASSERT_EQ(selected.get(i) == PredicateValue::TRUE, isTrue && i % 2 == 0) << "Row " << i;
+        }
+    }
+
+    LogicalExpr disjunction(CompareOp::OR,
+        std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(), ints(),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{1})),
+        std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(), ints(),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{2})));
+    disjunction.initializeIndexMap();
+    EXPECT_FALSE(FusedPredicate::compile(disjunction).has_value());
+
+    CompareExpr columns(CompareOp::LESS, DataType::getDouble(), doubles(),
+        std::make_unique<CastExpr>(DataType::getDouble(), std::make_unique<ColumnRefExpr>(intId, DataType::getInt32())));
+    columns.initializeIndexMap();
+    EXPECT_FALSE(FusedPredicate::compile(columns).has_value());
+}
+
+// Test that evaluating into the same result and scratch reuses their storage across batches
+TEST_F(PredicateTest, EvaluateIntoReusesBuffers) {
+    constexpr int64_t rowCount = 300;
+    static std::vector<int64_t> data(rowCount);
+    ColumnId colId(0, "a");
+    ColumnBuffer col(colId, DataType::getInt64(), data.data(), rowCount);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        col.writeEntry<db_int64>(i, i);
+    }
+    col.count = rowCount;
+
+    auto compare = [&](CompareOp op, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(colId, DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    };
+    // (a < 100 OR a > 150) AND a <> 42
+    LogicalExpr predicate(CompareOp::AND,
+        std::make_unique<LogicalExpr>(CompareOp::OR, compare(CompareOp::LESS, 100), compare(CompareOp::GREATER, 150)),
+        compare(CompareOp::NOT_EQUAL, 42));
+    predicate.initializeIndexMap();
+
+    PredicateResultVector out;
+    PredicateScratch scratch;
+    const uint64_t* words = nullptr;
+    for (int64_t batchRows : {rowCount, int64_t{100}, int64_t{1}, rowCount}) {
+        // One input column per column reference
+        RowVector input;
+        for (int i = 0; i < 3; ++i) {
+            input.addColumn(col);
+        }
+        input.setRowCount(batchRows);
+
+        scratch.reset();
+        predicate.evaluateInto(input, out, scratch);
+        ASSERT_EQ(out.size(), batchRows);
+        PredicateResultVector expected = predicate.evaluate(input);
+        for (int64_t i = 0; i < batchRows; ++i) {
+            ASSERT_EQ(out.get(i), expected.get(i)) << "Row " << i;
+        }
+
+        // One scratch result per logical operator, allocated by the first batch only
+        EXPECT_EQ(scratch.getResultCount(), 2u);
+        if (!words) {
+            words = out.getTrueWords();
+        }
+        EXPECT_EQ(out.getTrueWords(), words);
+    }
+}
+
+// Test that AND and OR skip the rows their left operand decided and match full evaluation
+TEST_F(PredicateTest, LogicalExprShortCircuits) {
+    constexpr int64_t rowCount = 1000;
+    static std::vector<int64_t> aData(rowCount);
+    static std::vector<int64_t> bData(rowCount);
+    static std::vector<uint8_t> aBitmap((rowCount + 7) / 8);
+    ColumnId aId(0, "a");
+    ColumnId bId(1, "b");
+    ColumnBuffer aCol(aId, DataType::getInt64(), aData.data(), rowCount, NullBitmap(aBitmap.data(), rowCount));
+    ColumnBuffer bCol(bId, DataType::getInt64(), bData.data(), rowCount);
+    for (int64_t i = 0; i < rowCount; ++i) {
+        aCol.writeEntry<db_int64>(i, i);
+        if (i % 7 == 3) aCol.setNull(i); else aCol.clearNull(i);
+        bCol.writeEntry<db_int64>(i, i % 5);
+    }
+    aCol.count = bCol.count = rowCount;
+    RowVector input;
+    input.addColumn(aCol);
+    input.addColumn(bCol);
+    input.setRowCount(rowCount);
+
+    auto compare = [](CompareOp op, const ColumnId& column, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+            std::make_unique<ColumnRefExpr>(column, DataType::getInt64()),
+            std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    };
+    auto value = [](bool isNull, bool isTrue) {
+        return isNull ? PredicateValue::NULL_VALUE : isTrue ? PredicateValue::TRUE : PredicateValue::FALSE;
+    };
+
+    // The right operand is evaluated row by row, over the whole batch, and not at all
+    for (int64_t limit : {int64_t{20}, int64_t{500}, int64_t{-1}}) {
+        LogicalExpr conjunction(CompareOp::AND, compare(CompareOp::LESS, aId, limit), compare(CompareOp::EQUAL, bId, 2));
+        LogicalExpr disjunction(CompareOp::OR, compare(CompareOp::GREATER_EQUAL, aId, rowCount - limit),
+                                compare(CompareOp::EQUAL, bId, 2));
+        conjunction.initializeIndexMap();
+        disjunction.initializeIndexMap();
+
+        PredicateResultVector andResult = conjunction.evaluate(input);
+        PredicateResultVector orResult = disjunction.evaluate(input);
+        for (int64_t i = 0; i < rowCount; ++i) {
+            bool aNull = aCol.isNull(i);
+            PredicateValue less = value(aNull, i < limit);
+            PredicateValue greater = value(aNull, i >= rowCount - limit);
+            PredicateValue equal = value(false, i % 5 == 2);
+
+            PredicateValue expectedAnd = less == PredicateValue::FALSE || equal == PredicateValue::FALSE
+                                             ? PredicateValue::FALSE
+                                             : value(less == PredicateValue::NULL_VALUE, true);
+            PredicateValue expectedOr = greater == PredicateValue::TRUE || equal == PredicateValue::TRUE
+                                            ? PredicateValue::TRUE
+                                            : value(greater == PredicateValue::NULL_VALUE, false);
+            ASSERT_EQ(andResult.get(i), expectedAnd) << "Row " << i << ", limit " << limit;
+            ASSERT_EQ(orResult.get(i), expectedOr) << "Row " << i << ", limit " << limit;
+            ASSERT_EQ(conjunction.evaluateRow(input, i), expectedAnd) << "Row " << i;
+            ASSERT_EQ(disjunction.evaluateRow(input, i), expectedOr) << "Row " << i;
+        }
+    }
+
+    // Boolean constants are predicates of their value
+    PredicateResultVector result = ConstantExpr(DataType::getBool(), false).evaluate(input);
+    EXPECT_EQ(result.count(), 0);
+    EXPECT_EQ(ConstantExpr(DataType::getBool(), true).evaluate(input).count(), rowCount);
+}
@@ -0,0 +1,162 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "common/errors.hpp"
+#include "planner/physical_planner.hpp"
+#include "planner/prepared_statement.hpp"
+#include "storage/catalog.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class PreparedStatementTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path manifestPath_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "prepared_statement_test";
+        fs::create_directories(tempDir_);
+
+        // 100 orders, ids 0..99, every fourth in the east region
+        std::ofstream out(tempDir_ / "orders.csv");
+        out << "id,quantity,price,region\n";
+        for (int64_t id = 0; id < 100; ++id) {
+            out << id << "," << id % 7 << "," << static_cast<double>(id) / 2 << "," << (id % 4 == 0 ? "east" : "west")
+                << "\n";
+        }
+        out.close();
+
+        manifestPath_ = tempDir_ / "manifest.json";
+        std::ofstream(manifestPath_) << R"({"tables": [{
+            "name": "orders", "id": 1, "id_name": "orders", "format": "csv",
+            "schema": [
+                {"name": "id", "type": "INT64", "nullable": false},
+                {"name": "quantity", "type": "INT32", "nullable": false},
+                {"name": "price", "type": "DOUBLE", "nullable": false},
+                {"name": "region", "type": "STRING", "nullable": false}
+            ],
+            "files": [{"path": "orders.csv"}]
+        }]})";
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    static int64_t countRows(Catalog& catalog, const PreparedStatement& statement) {
+        PhysicalPlanner planner(&catalog, 8192, 2);
+        PhysicalQueryPlan plan = statement.createPlan(planner);
+        PhysicalOperator* root = plan.getRoot();
+        root->initialize();
+        int64_t rows = 0;
+        RowVector batch;
+        while (int64_t count = root->next(batch)) {
+            rows += count;
+        }
+        return rows;
+    }
+};
+
+// Test that a statement can be executed repeatedly with different values bound to its parameters
+TEST_F(PreparedStatementTest, ExecutesWithBoundValues) {
+    JsonCatalog catalog(manifestPath_);
+    PlanCache cache(&catalog);
+    auto statement = cache.prepare("SELECT id FROM orders WHERE id >= ? AND region = ? AND price < ?");
+    ASSERT_TRUE(statement.has_value()) << statement.error();
+    ASSERT_EQ(statement->getParameterCount(), 3u);
+    EXPECT_EQ(statement->getParameterType(0), DataType::getInt64());
+    EXPECT_EQ(statement->getParameterType(1), DataType::getString());
+    EXPECT_EQ(statement->getParameterType(2), DataType::getDouble());
+
+    statement->bind(0, int64_t{40});
+    statement->bind(1, std::string("east"));
+    statement->bind(2, 100.0);
+    EXPECT_EQ(countRows(catalog, *statement), 15);
+
+    statement->bind(0, int64_t{0});
+    statement->bind(1, std::string("west"));
+    statement->bind(2, int64_t{10});
+    EXPECT_EQ(countRows(catalog, *statement), 15);
+
+    auto reversed = cache.prepare("SELECT id FROM orders WHERE ? > quantity");
+    ASSERT_TRUE(reversed.has_value());
+    EXPECT_EQ(reversed->getParameterType(0), DataType::getInt32());
+    reversed->bind(0, int64_t{1});
+    EXPECT_EQ(countRows(catalog, *reversed), 15);
+}
+
+// Test that queries differing only in whitespace, keyword case and a trailing ';' share a plan
+TEST_F(PreparedStatementTest, ReusesCachedPlans) {
+    EXPECT_EQ(PlanCache::normalize("select  id\nFROM orders where id = ? ;"), "SELECT id FROM orders WHERE id = ?");
+    EXPECT_EQ(PlanCache::normalize("SELECT id FROM orders WHERE price = 0.1"),
+              "SELECT id FROM orders WHERE price = 0.1");
+    EXPECT_NE(PlanCache::normalize("SELECT id FROM orders WHERE price = 0.1234567"),
+              PlanCache::normalize("SELECT id FROM orders WHERE price = 0.1234568"));
+
+    JsonCatalog catalog(manifestPath_);
+    PlanCache cache(&catalog, 2);
+    auto first = cache.prepare("SELECT id FROM orders WHERE id = ?");
+    auto second = cache.prepare("select id from orders where id = ?;");
+    ASSERT_TRUE(first.has_value() && second.has_value());
+    EXPECT_EQ(&first->getCachedPlan(), &second->getCachedPlan());
+    EXPECT_EQ(cache.getMissCount(), 1);
+    EXPECT_EQ(cache.getHitCount(), 1);
+
+    // Bindings belong to the statement, not the shared plan
+    first->bind(0, int64_t{3});
+    second->bind(0, int64_t{200});
+    EXPECT_EQ(countRows(catalog, *first), 1);
+    EXPECT_EQ(countRows(catalog, *second), 0);
+
+    ASSERT_TRUE(cache.prepare("SELECT id FROM orders WHERE quantity = ?").has_value());
+    ASSERT_TRUE(cache.prepare("SELECT id FROM orders WHERE price = ?").has_value());
+    EXPECT_EQ(cache.size(), 2u);
+    ASSERT_TRUE(cache.prepare("SELECT id FROM orders WHERE id = ?").has_value());
+    EXPECT_EQ(cache.getMissCount(), 4);
+}
+
+// Test that plans built against an older version of the catalog are replanned
+TEST_F(PreparedStatementTest, ReplansAfterCatalogChange) {
+    JsonCatalog catalog(manifestPath_);
+    PlanCache cache(&catalog);
+    auto before = cache.prepare("SELECT id FROM orders WHERE quantity < ?");
+    ASSERT_TRUE(before.has_value());
+
+    TableId tableId = *catalog.getTableIdByName("orders");
+    ASSERT_TRUE(catalog.analyzeTable(tableId).has_value());
+    auto after = cache.prepare("SELECT id FROM orders WHERE quantity < ?");
+    ASSERT_TRUE(after.has_value());
+    EXPECT_NE(&before->getCachedPlan(), &after->getCachedPlan());
+    EXPECT_EQ(after->getCachedPlan().getCatalogVersion(), catalog.getVersion());
+    EXPECT_EQ(cache.getMissCount(), 2);
+
+    // The statement prepared before still executes with its plan
+    before->bind(0, int64_t{1});
+    EXPECT_EQ(countRows(catalog, *before), 15);
+}
+
+// Test that values of the wrong type, unbound parameters and untyped parameters are rejected
+TEST_F(PreparedStatementTest, Errors) {
+    JsonCatalog catalog(manifestPath_);
+    PlanCache cache(&catalog);
+    auto statement = cache.prepare("SELECT id FROM orders WHERE quantity = ? AND region = ?");
+    ASSERT_TRUE(statement.has_value());
+
+    EXPECT_THROW(statement->bind(0, std::string("1")), SQLRuntimeException);
+    EXPECT_THROW(statement->bind(0, int64_t{1} << 40), SQLRuntimeException);
+    EXPECT_THROW(statement->bind(1, true), SQLRuntimeException);
+    EXPECT_THROW(statement->bind(2, int64_t{1}), SQLRuntimeException);
+
+    statement->bind(0, int64_t{1});
+    PhysicalPlanner planner(&catalog);
+    EXPECT_THROW(statement->createPlan(planner), SQLRuntimeException);
+    statement->bind(1, std::string("east"));
+    statement->clearBindings();
+    EXPECT_THROW(statement->createPlan(planner), SQLRuntimeException);
+
+    EXPECT_THROW(cache.prepare("SELECT id FROM orders WHERE ? = ?"), InternalSQLError);
+    EXPECT_FALSE(cache.prepare("SELECT id FROM orders WHERE id = ? ?").has_value());
+}
@@ -0,0 +1,164 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/errors.hpp"
+#include "gtest/gtest.h"
+#include "server/protocol.hpp"
+#include "server/query_server.hpp"
+#include "storage/catalog.hpp"
+
+using namespace toydb;
+using namespace toydb::server;
+namespace fs = std::filesystem;
+
+// Test that messages split at any byte are decoded once complete
+TEST(ProtocolTest, DecodesSplitMessages) {
+    std::string bytes;
+    encodeMessage(MessageType::QUERY, "SELECT id FROM orders", bytes);
+    encodeMessage(MessageType::COMPLETE, "", bytes);
+    ASSERT_EQ(bytes.size(), 2 * MESSAGE_HEADER_SIZE + 21);
+
+    MessageDecoder decoder;
+    std::vector<Message> messages;
+    for (char byte : bytes) {
+        decoder.feed(&byte, 1);
+        while (auto message = decoder.next()) {
+            messages.push_back(std::move(*message));
+        }
+    }
+
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0].type, MessageType::QUERY);
+    EXPECT_EQ(messages[0].payload, "SELECT id FROM orders");
+    EXPECT_EQ(messages[1].type, MessageType::COMPLETE);
+    EXPECT_EQ(messages[1].payload, "");
+}
+
+TEST(ProtocolTest, RejectsInvalidMessages) {
+    MessageDecoder unknown;
+    unknown.feed("X\0\0\0\0", MESSAGE_HEADER_SIZE);
+    EXPECT_THROW(unknown.next(), ProtocolError);
+
+    MessageDecoder oversized;
+    oversized.feed("Q\xff\xff\xff\xff", MESSAGE_HEADER_SIZE);
+    EXPECT_THROW(oversized.next(), ProtocolError);
+}
+
+// Test that grants are admitted up to the limit, and always if nothing runs
+TEST(AdmissionControllerTest, LimitsGrantedMemory) {
+    AdmissionController admission(100);
+    EXPECT_TRUE(admission.tryAdmit(40));
+    EXPECT_TRUE(admission.tryAdmit(40));
+    EXPECT_FALSE(admission.tryAdmit(40));
+    EXPECT_EQ(admission.getGrantedBytes(), 80u);
+    EXPECT_EQ(admission.getRunningQueries(), 2u);
+
+    admission.release(40);
+    EXPECT_TRUE(admission.tryAdmit(40));
+    admission.release(40);
+    admission.release(40);
+
+    EXPECT_TRUE(admission.tryAdmit(1000));
+    EXPECT_FALSE(admission.tryAdmit(1));
+    admission.release(1000);
+    EXPECT_EQ(admission.getGrantedBytes(), 0u);
+}
+
+class QueryServerTest : public ::testing::Test {
+protected:
+    std::unique_ptr<JsonCatalog> catalog_;
+    std::unique_ptr<QueryServer> server_;
+    std::thread loop_;
+
+    void start(const ServerOptions& options) {
+        catalog_ = std::make_unique<JsonCatalog>(fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json");
+        server_ = std::make_unique<QueryServer>(catalog_.get(), options);
+        loop_ = std::thread([this] { server_->run(); });
+    }
+
+    void TearDown() override {
+        if (server_) {
+            server_->stop();
+            loop_.join();
+            server_.reset();
+        }
+    }
+
+    static ServerOptions options(size_t workerCount) {
+        ServerOptions options;
+        options.port = 0;
+        options.workerCount = workerCount;
+        return options;
+    }
+};
+
+TEST_F(QueryServerTest, RunsQueries) {
+    start(options(2));
+    QueryClient client("127.0.0.1", server_->getPort());
+
+    QueryClient::Result result = client.query("SELECT id, user_id FROM orders WHERE id < 4");
+    EXPECT_EQ(result.rowCount, 3);
+    EXPECT_FALSE(result.data.empty());
+
+    result = client.query("EXPLAIN SELECT id FROM orders");
+    EXPECT_FALSE(result.rowCount.has_value());
+    EXPECT_NE(result.data.find("Scan"), std::string::npos);
+
+    // The connection stays usable after an error
+    EXPECT_THROW(client.query("SELECT FROM"), SQLException);
+    EXPECT_THROW(client.query("SELECT id FROM missing"), SQLException);
+    EXPECT_EQ(client.query("SELECT id FROM orders").rowCount, 10);
+}
+
+// Test that many clients are served concurrently by few workers and share the plan cache
+TEST_F(QueryServerTest, ServesConcurrentClients) {
+    ServerOptions serverOptions = options(2);
+    // Only one query is admitted at a time, the others wait
+    serverOptions.queryMemory = 1024;
+    serverOptions.memoryLimit = 1024;
+    start(serverOptions);
+
+    std::vector<std::thread> clients;
+    std::vector<int64_t> rowCounts(8, 0);
+    for (size_t i = 0; i < rowCounts.size(); ++i) {
+        clients.emplace_back([this, i, &rowCounts] {
+            QueryClient client("127.0.0.1", server_->getPort());
+            for (int query = 0; query < 10; ++query) {
+                rowCounts[i] += client.query("SELECT id FROM orders WHERE id <= 5").rowCount.value_or(0);
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    for (int64_t rowCount : rowCounts) {
+        EXPECT_EQ(rowCount, 50);
+    }
+    EXPECT_EQ(server_->getPlanCache().getMissCount(), 1);
+}
+
+// Test that a client disconnecting doesn't affect the others
+TEST_F(QueryServerTest, SurvivesDisconnects) {
+    start(options(1));
+    {
+        QueryClient client("127.0.0.1", server_->getPort());
+        client.query("SELECT id FROM orders");
+    }
+    QueryClient client("127.0.0.1", server_->getPort());
+    EXPECT_EQ(client.query("SELECT id FROM orders WHERE id > 8").rowCount, 2);
+}
+
+TEST_F(QueryServerTest, StreamsChosenFormat) {
+    start(options(1));
+    QueryClient client("127.0.0.1", server_->getPort());
+
+    client.setResultFormat(ResultFormat::CSV);
+    QueryClient::Result result = client.query("SELECT id, user_id FROM orders WHERE id <= 3");
+    EXPECT_EQ(result.rowCount, 3);
+    EXPECT_EQ(result.data, "id,user_id\n1,1\n2,2\n3,3\n");
+
+    EXPECT_THROW(client.setResultFormat(static_cast<ResultFormat>(42)), SQLException);
+}
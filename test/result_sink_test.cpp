@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "engine/predicate_result.hpp"
+#include "engine/result_sink.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+
+class ResultSinkTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage_;
+    // Row 1 of the amount column is NULL
+    uint8_t amountValidity_[1] = {0b11111101};
+    std::string output_;
+    int flushes_ = 0;
+
+    RowVector makeBatch() {
+        RowVector batch;
+        batch.addColumn(storage_.createIntColumn({1, 2, 3, 4}, 1, "id"));
+        ColumnBuffer amount = storage_.createDoubleColumn({1.5, 0.0, -2.25, 1e20}, 2, "amount");
+        amount = ColumnBuffer(amount.columnId, amount.type, const_cast<void*>(amount.getData()), 4,
+                              NullBitmap(amountValidity_, 4));
+        amount.count = 4;
+        batch.addColumn(amount);
+        batch.addColumn(storage_.createStringColumn({"plain", "with,comma", "say \"hi\"", "a long string over the inline length"}, 3, "name"));
+        batch.setRowCount(4);
+        return batch;
+    }
+
+    ByteWriter writer() {
+        return [this](std::string_view bytes) {
+            output_ += bytes;
+            flushes_++;
+        };
+    }
+
+    template<typename T>
+    T read(size_t& offset) {
+        T value;
+        std::memcpy(&value, output_.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+};
+
+TEST_F(ResultSinkTest, Csv) {
+    RowVector batch = makeBatch();
+    CsvResultSink sink(writer());
+    sink.write(batch);
+    sink.write(batch.view());
+    sink.finish();
+
+    std::string rows =
+        "1,1.5,plain\n"
+        "2,,\"with,comma\"\n"
+        "3,-2.25,\"say \"\"hi\"\"\"\n"
+        "4,1e+20,a long string over the inline length\n";
+    EXPECT_EQ(output_, "id,amount,name\n" + rows + rows);
+    // Small results are flushed once
+    EXPECT_EQ(flushes_, 1);
+}
+
+// Test that only selected rows are encoded
+TEST_F(ResultSinkTest, CsvSkipsUnselectedRows) {
+    RowVector batch = makeBatch();
+    PredicateResultVector selection(4);
+    selection.setTrue(1);
+    selection.setTrue(3);
+    batch.setSelection(&selection);
+
+    CsvResultSink sink(writer());
+    sink.write(batch);
+    sink.finish();
+    EXPECT_EQ(output_, "id,amount,name\n2,,\"with,comma\"\n4,1e+20,a long string over the inline length\n");
+}
+
+// Test that the buffer is handed to the writer whenever it is full, not only at the end
+TEST_F(ResultSinkTest, FlushesWhileWriting) {
+    RowVector batch = makeBatch();
+    CsvResultSink sink(writer(), 64);
+    for (int i = 0; i < 10; ++i) {
+        sink.write(batch);
+    }
+    EXPECT_GE(flushes_, 10);
+    sink.finish();
+    EXPECT_EQ(std::count(output_.begin(), output_.end(), '\n'), 41);
+}
+
+TEST_F(ResultSinkTest, Binary) {
+    RowVector batch = makeBatch();
+    PredicateResultVector selection(4);
+    selection.setTrue(0);
+    selection.setTrue(1);
+    selection.setTrue(2);
+    batch.setSelection(&selection);
+
+    BinaryResultSink sink(writer());
+    sink.write(batch);
+    sink.finish();
+
+    size_t offset = 0;
+    ASSERT_EQ(read<uint32_t>(offset), 3u);
+    std::vector<std::pair<uint8_t, std::string>> columns;
+    for (int i = 0; i < 3; ++i) {
+        uint8_t type = read<uint8_t>(offset);
+        uint32_t length = read<uint32_t>(offset);
+        columns.emplace_back(type, output_.substr(offset, length));
+        offset += length;
+    }
+    EXPECT_EQ(columns[0], std::make_pair(static_cast<uint8_t>(DataType::Type::INT64), std::string("id")));
+    EXPECT_EQ(columns[2], std::make_pair(static_cast<uint8_t>(DataType::Type::STRING), std::string("name")));
+
+    ASSERT_EQ(read<uint32_t>(offset), 3u);
+    EXPECT_EQ(read<uint8_t>(offset) & 0b111, 0b111);
+    EXPECT_EQ(read<int64_t>(offset), 1);
+    EXPECT_EQ(read<int64_t>(offset), 2);
+    EXPECT_EQ(read<int64_t>(offset), 3);
+
+    EXPECT_EQ(read<uint8_t>(offset) & 0b111, 0b101);
+    EXPECT_EQ(read<double>(offset), 1.5);
+    read<double>(offset);
+    EXPECT_EQ(read<double>(offset), -2.25);
+
+    EXPECT_EQ(read<uint8_t>(offset) & 0b111, 0b111);
+    for (std::string expected : {"plain", "with,comma", "say \"hi\""}) {
+        uint32_t length = read<uint32_t>(offset);
+        EXPECT_EQ(output_.substr(offset, length), expected);
+        offset += length;
+    }
+
+    EXPECT_EQ(read<uint32_t>(offset), 0u);
+    EXPECT_EQ(offset, output_.size());
+}
+
+// Test that an Arrow stream is written: a schema message, a batch message and the end marker
+TEST_F(ResultSinkTest, ArrowStream) {
+    RowVector batch = makeBatch();
+    ArrowResultSink sink(writer());
+    sink.write(batch);
+    sink.finish();
+
+    ASSERT_GT(output_.size(), 16u);
+    size_t offset = 0;
+    EXPECT_EQ(read<uint32_t>(offset), 0xFFFFFFFFu);
+    EXPECT_EQ(output_.substr(output_.size() - 8), std::string("\xff\xff\xff\xff\0\0\0\0", 8));
+    EXPECT_NE(output_.find("amount"), std::string::npos);
+}
+
+TEST_F(ResultSinkTest, EmptyResult) {
+    CsvResultSink sink(writer());
+    sink.finish();
+    EXPECT_EQ(output_, "");
+    EXPECT_EQ(flushes_, 0);
+}
+
+TEST_F(ResultSinkTest, ParsesFormats) {
+    EXPECT_EQ(parseResultFormat("CSV"), ResultFormat::CSV);
+    EXPECT_EQ(parseResultFormat("arrow"), ResultFormat::ARROW);
+    EXPECT_EQ(parseResultFormat("xml"), std::nullopt);
+    for (ResultFormat format : {ResultFormat::TABLE, ResultFormat::CSV, ResultFormat::ARROW, ResultFormat::BINARY}) {
+        EXPECT_EQ(parseResultFormat(resultFormatToString(format)), format);
+    }
+}
@@ -0,0 +1,331 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "planner/physical_planner.hpp"
+#include "planner/rule_based_optimizer.hpp"
+#include "storage/catalog.hpp"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+static const char* MANIFEST = R"({
+  "tables": [
+    {
+      "name": "customers", "id": 1, "id_name": "customers", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64", "stats": {"distinct_count": 100000, "min": 1, "max": 100000}},
+        {"name": "region", "type": "INT64", "stats": {"distinct_count": 10, "min": 1, "max": 10}},
+        {"name": "name", "type": "STRING"}
+      ],
+      "files": [{"path": "customers.csv", "row_count": 100000}]
+    },
+    {
+      "name": "sales", "id": 2, "id_name": "sales", "format": "csv",
+      "schema": [
+        {"name": "customer_id", "type": "INT64", "stats": {"distinct_count": 100000}},
+        {"name": "store_id", "type": "INT64", "stats": {"distinct_count": 10}},
+        {"name": "amount", "type": "INT64"}
+      ],
+      "files": [{"path": "sales.csv", "row_count": 1000000}]
+    },
+    {
+      "name": "stores", "id": 3, "id_name": "stores", "format": "csv",
+      "schema": [
+        {"name": "id", "type": "INT64"},
+        {"name": "country", "type": "INT64"}
+      ],
+      "files": [{"path": "stores.csv", "row_count": 10}]
+    }
+  ]
+})";
+
+class RuleBasedOptimizerTest : public ::testing::Test {
+   protected:
+    fs::path tempDir_;
+    std::unique_ptr<JsonCatalog> catalog_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "rule_based_optimizer_test";
+        fs::create_directories(tempDir_);
+        std::ofstream(tempDir_ / "manifest.json") << MANIFEST;
+        catalog_ = std::make_unique<JsonCatalog>(tempDir_ / "manifest.json");
+    }
+
+    void TearDown() override {
+        if (fs::exists(tempDir_)) {
+            fs::remove_all(tempDir_);
+        }
+    }
+
+    ColumnId column(const std::string& table, const std::string& name) {
+        auto tableId = catalog_->getTableIdByName(table);
+        EXPECT_TRUE(tableId.has_value());
+        auto colId = catalog_->resolveColumn(*tableId, name);
+        EXPECT_TRUE(colId.has_value());
+        return *colId;
+    }
+
+    std::shared_ptr<TableScanOp> scan(const std::string& table) {
+        auto tableId = catalog_->getTableIdByName(table);
+        auto handle = catalog_->getTableHandle(*tableId);
+        return std::make_shared<TableScanOp>((*handle)->getColumnIds());
+    }
+
+    static std::unique_ptr<PredicateExpr> equals(const ColumnId& left, const ColumnId& right) {
+        return std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(left, DataType::getInt64()),
+                                             std::make_unique<ColumnRefExpr>(right, DataType::getInt64()));
+    }
+
+    static std::unique_ptr<PredicateExpr> compare(CompareOp op, const ColumnId& col, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(col, DataType::getInt64()),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    }
+
+    static std::unique_ptr<PredicateExpr> constants(CompareOp op, int64_t left, int64_t right) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), left),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), right));
+    }
+
+    static std::unique_ptr<PredicateExpr> logical(CompareOp op, std::unique_ptr<PredicateExpr> left,
+                                                  std::unique_ptr<PredicateExpr> right) {
+        return std::make_unique<LogicalExpr>(op, std::move(left), std::move(right));
+    }
+
+    static std::shared_ptr<LogicalOperator> join(std::shared_ptr<LogicalOperator> left,
+                                                 std::shared_ptr<LogicalOperator> right) {
+        auto crossProduct = std::make_shared<CrossProductOp>();
+        crossProduct->addChild(std::move(left));
+        crossProduct->addChild(std::move(right));
+        return crossProduct;
+    }
+
+    static std::shared_ptr<LogicalOperator> filter(std::shared_ptr<LogicalOperator> input,
+                                                   std::unique_ptr<PredicateExpr> predicate) {
+        auto filterOp = std::make_shared<FilterOp>(std::move(predicate));
+        filterOp->addChild(std::move(input));
+        return filterOp;
+    }
+
+    // The columns referenced by each conjunct of a predicate
+    static std::vector<std::set<std::string>> conjunctColumns(const PredicateExpr* predicate) {
+        std::vector<std::unique_ptr<PredicateExpr>> conjuncts;
+        splitConjuncts(predicate, conjuncts);
+        std::vector<std::set<std::string>> result;
+        for (const auto& conjunct : conjuncts) {
+            std::vector<const ColumnRefExpr*> refs;
+            collectColumnRefs(conjunct.get(), refs);
+            std::set<std::string> columns;
+            for (const ColumnRefExpr* ref : refs) {
+                columns.insert(ref->getColumnId().getTableId().getName() + "." + ref->getColumnId().getName());
+            }
+            result.push_back(columns);
+        }
+        return result;
+    }
+};
+
+// Test that constant comparisons and comparisons with NULL are folded away
+TEST_F(RuleBasedOptimizerTest, SimplifiesConstants) {
+    ColumnId region = column("customers", "region");
+
+    // 1 = 1 AND region = 3
+    auto simplified = RuleBasedOptimizer::simplify(
+        logical(CompareOp::AND, constants(CompareOp::EQUAL, 1, 1), compare(CompareOp::EQUAL, region, 3)));
+    auto* compareExpr = dynamic_cast<const CompareExpr*>(simplified.get());
+    ASSERT_NE(compareExpr, nullptr);
+    EXPECT_EQ(compareExpr->getOp(), CompareOp::EQUAL);
+
+    auto expectConstant = [](const std::unique_ptr<PredicateExpr>& predicate, bool value) {
+        auto* constant = dynamic_cast<const ConstantExpr*>(predicate.get());
+        ASSERT_NE(constant, nullptr);
+        EXPECT_EQ(constant->getType(), DataType::getBool());
+        EXPECT_EQ(constant->getBoolValue(), value);
+    };
+
+    // region = NULL is never TRUE, neither is 2 > 3 OR NULL
+    auto nullCompare = std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                     std::make_unique<ColumnRefExpr>(region, DataType::getInt64()),
+                                                     std::make_unique<ConstantExpr>());
+    expectConstant(RuleBasedOptimizer::simplify(std::move(nullCompare)), false);
+    expectConstant(RuleBasedOptimizer::simplify(
+                       logical(CompareOp::OR, constants(CompareOp::GREATER, 2, 3), std::make_unique<ConstantExpr>())),
+                   false);
+
+    // region < 5 OR 1 < 2 is always TRUE, region < 5 AND 2 <= 1 never
+    expectConstant(RuleBasedOptimizer::simplify(logical(CompareOp::OR, compare(CompareOp::LESS, region, 5),
+                                                        constants(CompareOp::LESS, 1, 2))),
+                   true);
+    expectConstant(RuleBasedOptimizer::simplify(logical(CompareOp::AND, compare(CompareOp::LESS, region, 5),
+                                                        constants(CompareOp::LESS_EQUAL, 2, 1))),
+                   false);
+
+    // Parameters are only known when the plan runs
+    auto parameter = std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                   std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{0}),
+                                                   ConstantExpr::parameter(0, DataType::getInt64()));
+    EXPECT_NE(dynamic_cast<const CompareExpr*>(RuleBasedOptimizer::simplify(std::move(parameter)).get()), nullptr);
+}
+
+// Test that the operands deciding most rows at the least cost are evaluated first
+TEST_F(RuleBasedOptimizerTest, ReordersOperands) {
+    RuleBasedOptimizer optimizer(catalog_.get());
+    ColumnId id = column("customers", "id");
+    ColumnId region = column("customers", "region");
+    ColumnId name = column("customers", "name");
+
+    // In an AND, id < 1001 removes 99% of the rows, region <> 3 only 10%
+    auto conjunction = optimizer.reorder(
+        logical(CompareOp::AND, compare(CompareOp::NOT_EQUAL, region, 3), compare(CompareOp::LESS, id, 1001)));
+    auto* first = dynamic_cast<const CompareExpr*>(dynamic_cast<const LogicalExpr*>(conjunction.get())->getLeft());
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->getOp(), CompareOp::LESS);
+
+    // In an OR, id > 1000 accepts 99% of the rows, region = 3 only 10%
+    auto disjunction = optimizer.reorder(
+        logical(CompareOp::OR, compare(CompareOp::EQUAL, region, 3), compare(CompareOp::GREATER, id, 1000)));
+    first = dynamic_cast<const CompareExpr*>(dynamic_cast<const LogicalExpr*>(disjunction.get())->getLeft());
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->getOp(), CompareOp::GREATER);
+
+    // Nested ANDs are flattened, string comparisons are expensive and go last
+    auto strings = std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getString(),
+                                                 std::make_unique<ColumnRefExpr>(name, DataType::getString()),
+                                                 std::make_unique<ConstantExpr>(DataType::getString(), std::string("x")));
+    auto nested = optimizer.reorder(logical(CompareOp::AND, std::move(strings),
+                                            logical(CompareOp::AND, compare(CompareOp::EQUAL, region, 3),
+                                                    compare(CompareOp::GREATER, id, 10))));
+    EXPECT_EQ(conjunctColumns(nested.get()),
+              (std::vector<std::set<std::string>>{{"customers.region"}, {"customers.name"}, {"customers.id"}}));
+    EXPECT_LT(optimizer.estimateCost(compare(CompareOp::EQUAL, region, 3).get()),
+              optimizer.estimateCost(equals(id, region).get()));
+}
+
+// Test that conjuncts are pushed below cross products to the scans of the tables they reference
+TEST_F(RuleBasedOptimizerTest, PushesFiltersBelowCrossProducts) {
+    std::vector<std::unique_ptr<PredicateExpr>> where;
+    where.push_back(equals(column("sales", "store_id"), column("stores", "id")));
+    where.push_back(compare(CompareOp::EQUAL, column("stores", "country"), 1));
+    where.push_back(constants(CompareOp::EQUAL, 1, 1));
+    where.push_back(compare(CompareOp::EQUAL, column("customers", "region"), 2));
+    auto root = filter(join(join(scan("customers"), scan("stores")), scan("sales")), combineConjuncts(std::move(where)));
+    LogicalQueryPlan plan(root);
+    std::vector<ColumnId> columns = getOutputColumnList(plan.getRoot());
+
+    RuleBasedOptimizer(catalog_.get()).optimize(plan);
+    EXPECT_EQ(getOutputColumnList(plan.getRoot()), columns);
+
+    // Only the join conjunct stays above the cross products
+    auto* top = dynamic_cast<const FilterOp*>(plan.getRoot());
+    ASSERT_NE(top, nullptr);
+    EXPECT_EQ(conjunctColumns(top->getPredicate()),
+              (std::vector<std::set<std::string>>{{"sales.store_id", "stores.id"}}));
+
+    const LogicalOperator* inner = top->getChild(0)->getChild(0).get();
+    ASSERT_NE(dynamic_cast<const CrossProductOp*>(inner), nullptr);
+    auto* customers = dynamic_cast<const FilterOp*>(inner->getChild(0).get());
+    auto* stores = dynamic_cast<const FilterOp*>(inner->getChild(1).get());
+    ASSERT_NE(customers, nullptr);
+    ASSERT_NE(stores, nullptr);
+    EXPECT_EQ(conjunctColumns(customers->getPredicate()), (std::vector<std::set<std::string>>{{"customers.region"}}));
+    EXPECT_EQ(conjunctColumns(stores->getPredicate()), (std::vector<std::set<std::string>>{{"stores.country"}}));
+    EXPECT_NE(dynamic_cast<const TableScanOp*>(customers->getChild(0).get()), nullptr);
+    EXPECT_NE(dynamic_cast<const TableScanOp*>(top->getChild(0)->getChild(1).get()), nullptr);
+}
+
+// Test that filters are not pushed into the side of an outer join whose unmatched rows it keeps
+TEST_F(RuleBasedOptimizerTest, PushesFiltersIntoOuterJoins) {
+    ColumnId customerId = column("customers", "id");
+    auto condition = logical(CompareOp::AND, equals(customerId, column("sales", "customer_id")),
+                             compare(CompareOp::EQUAL, column("sales", "store_id"), 3));
+    auto leftJoin = std::make_shared<JoinOp>(JoinType::LEFT, std::move(condition));
+    leftJoin->addChild(scan("customers"));
+    leftJoin->addChild(scan("sales"));
+    LogicalQueryPlan plan(filter(leftJoin, logical(CompareOp::AND, compare(CompareOp::EQUAL, column("customers", "region"), 2),
+                                                   compare(CompareOp::GREATER, column("sales", "amount"), 100))));
+
+    RuleBasedOptimizer(catalog_.get()).optimize(plan);
+
+    // A filter on the NULL-extended side stays above the join
+    auto* top = dynamic_cast<const FilterOp*>(plan.getRoot());
+    ASSERT_NE(top, nullptr);
+    EXPECT_EQ(conjunctColumns(top->getPredicate()), (std::vector<std::set<std::string>>{{"sales.amount"}}));
+
+    // The equality is left as the condition of the hash join, the other conjunct filters the sales
+    auto* joinOp = dynamic_cast<const JoinOp*>(top->getChild(0).get());
+    ASSERT_NE(joinOp, nullptr);
+    EXPECT_EQ(joinOp->getJoinType(), JoinType::LEFT);
+    EXPECT_NE(dynamic_cast<const CompareExpr*>(joinOp->getCondition()), nullptr);
+    auto* customers = dynamic_cast<const FilterOp*>(joinOp->getChild(0).get());
+    auto* sales = dynamic_cast<const FilterOp*>(joinOp->getChild(1).get());
+    ASSERT_NE(customers, nullptr);
+    ASSERT_NE(sales, nullptr);
+    EXPECT_EQ(conjunctColumns(customers->getPredicate()), (std::vector<std::set<std::string>>{{"customers.region"}}));
+    EXPECT_EQ(conjunctColumns(sales->getPredicate()), (std::vector<std::set<std::string>>{{"sales.store_id"}}));
+}
+
+// Test that an optimized plan produces the same rows as the original one
+TEST_F(RuleBasedOptimizerTest, OptimizedPlanProducesSameRows) {
+    JsonCatalog catalog(fs::path(__FILE__).parent_path() / "data" / "tdb_manifest.json");
+    auto usersId = catalog.getTableIdByName("users");
+    auto ordersId = catalog.getTableIdByName("orders");
+    ColumnId userId = *catalog.resolveColumn(*usersId, "id");
+    ColumnId orderId = *catalog.resolveColumn(*ordersId, "id");
+    ColumnId orderUserId = *catalog.resolveColumn(*ordersId, "user_id");
+
+    auto makePlan = [&]() {
+        // (users.id < 4 OR 2 < 1) AND orders.user_id = users.id AND (orders.id > 2 OR users.id = NULL)
+        auto where = logical(
+            CompareOp::AND,
+            logical(CompareOp::AND,
+                    logical(CompareOp::OR, compare(CompareOp::LESS, userId, 4), constants(CompareOp::LESS, 2, 1)),
+                    equals(orderUserId, userId)),
+            logical(CompareOp::OR, compare(CompareOp::GREATER, orderId, 2),
+                    std::make_unique<CompareExpr>(CompareOp::EQUAL, DataType::getInt64(),
+                                                  std::make_unique<ColumnRefExpr>(userId, DataType::getInt64()),
+                                                  std::make_unique<ConstantExpr>())));
+        auto root = filter(join(std::make_shared<TableScanOp>((*catalog.getTableHandle(*ordersId))->getColumnIds()),
+                                std::make_shared<TableScanOp>((*catalog.getTableHandle(*usersId))->getColumnIds())),
+                           std::move(where));
+        auto projection = std::make_shared<ProjectionOp>(std::vector<ColumnId>{orderId, userId});
+        projection->addChild(root);
+        return LogicalQueryPlan(projection);
+    };
+
+    auto run = [&](const LogicalQueryPlan& logicalPlan) {
+        PhysicalPlanner planner(&catalog, 8192, 1);
+        PhysicalQueryPlan plan = planner.plan(logicalPlan);
+        std::multiset<std::pair<int64_t, int64_t>> rows;
+        PhysicalOperator* root = plan.getRoot();
+        root->initialize();
+        RowVector batch;
+        while (root->next(batch) > 0) {
+            for (int64_t row = batch.nextSelectedRow(0); row < batch.getRowCount(); row = batch.nextSelectedRow(row + 1)) {
+                rows.emplace(batch.getColumn(0).getEntry<db_int64>(row), batch.getColumn(1).getEntry<db_int64>(row));
+            }
+        }
+        return rows;
+    };
+
+    LogicalQueryPlan original = makePlan();
+    LogicalQueryPlan optimized = makePlan();
+    RuleBasedOptimizer(&catalog).optimize(optimized);
+
+    // Both single-table conjuncts reach the scans
+    auto* top = dynamic_cast<const FilterOp*>(optimized.getRoot()->getChild(0).get());
+    ASSERT_NE(top, nullptr);
+    ASSERT_NE(dynamic_cast<const CrossProductOp*>(top->getChild(0).get()), nullptr);
+    EXPECT_NE(dynamic_cast<const FilterOp*>(top->getChild(0)->getChild(0).get()), nullptr);
+    EXPECT_NE(dynamic_cast<const FilterOp*>(top->getChild(0)->getChild(1).get()), nullptr);
+
+    auto expected = run(original);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(run(optimized), expected);
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <string>
+#include <vector>
+#include "common/errors.hpp"
+#include "common/metrics.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "storage/secondary_index.hpp"
+#include "storage/table_handle.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class SecondaryIndexTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path manifestPath_;
+    std::string output_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "secondary_index_test";
+        fs::remove_all(tempDir_);
+        fs::create_directories(tempDir_);
+        manifestPath_ = tempDir_ / "manifest.json";
+        std::ofstream(manifestPath_) << R"({
+            "tables": [{
+                "name": "orders", "id": 1, "id_name": "orders", "format": "tdb",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "user_id", "type": "INT32", "nullable": true},
+                    {"name": "amount", "type": "DOUBLE", "nullable": true}
+                ],
+                "files": []
+            }, {
+                "name": "users", "id": 2, "id_name": "users", "format": "tdb",
+                "schema": [{"name": "id", "type": "INT64", "nullable": false}],
+                "files": []
+            }]
+        })";
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    std::optional<int64_t> execute(server::Session& session, const std::string& sql) {
+        output_.clear();
+        return session.execute(sql, [this](std::string_view text) { output_ += text; });
+    }
+
+    /**
+     * @brief Insert rows [first, first + count) as one file, order i belongs to user i % 100
+     */
+    void insertOrders(server::Session& session, int first, int count) {
+        std::string sql = "INSERT INTO orders VALUES ";
+        for (int i = first; i < first + count; ++i) {
+            sql += (i == first ? "(" : ", (") + std::to_string(i) + ", " + std::to_string(i % 100) + ", 1.5)";
+        }
+        execute(session, sql);
+    }
+};
+
+TEST_F(SecondaryIndexTest, IndexedLookups) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    insertOrders(session, 0, 1000);
+    insertOrders(session, 1000, 1000);
+
+    EXPECT_EQ(execute(session, "CREATE INDEX ON orders (user_id)"), std::nullopt);
+    EXPECT_EQ(output_, "Created index on orders.user_id\n");
+
+    metrics::Counter& indexScans = metrics::MetricsRegistry::global().counter(
+        "toydb_index_scans_total", "Scans that read rows found in a secondary index");
+    uint64_t scans = indexScans.get();
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id = 7"), 20);
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE 7 = user_id AND amount > 1"), 20);
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id >= 5 AND user_id < 7"), 40);
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id > 98"), 20);
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id = 1000"), 0);
+    EXPECT_EQ(indexScans.get(), scans + 5);
+
+    // Too many matches to be worth the index
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id < 50"), 1000);
+    EXPECT_EQ(indexScans.get(), scans + 5);
+
+    // Files appended after the index was built are scanned
+    execute(session, "INSERT INTO orders VALUES (5000, 7, 2.5), (5001, 8, 2.5)");
+    EXPECT_EQ(execute(session, "SELECT id FROM orders WHERE user_id = 7"), 21);
+}
+
+TEST_F(SecondaryIndexTest, IndexIsPersisted) {
+    {
+        JsonCatalog catalog(manifestPath_);
+        server::Session session(&catalog);
+        insertOrders(session, 0, 1000);
+        execute(session, "CREATE INDEX ON orders (user_id)");
+
+        EXPECT_THROW(execute(session, "CREATE INDEX ON orders (amount)"), SQLRuntimeException);
+        EXPECT_THROW(execute(session, "CREATE INDEX ON orders (missing)"), UnresolvedColumnException);
+        EXPECT_THROW(execute(session, "CREATE INDEX ON missing (id)"), SQLRuntimeException);
+    }
+
+    JsonCatalog catalog(manifestPath_);
+    TableId tableId = *catalog.getTableIdByName("orders");
+    ColumnId userId = *catalog.resolveColumn(tableId, "user_id");
+    auto handle = catalog.getTableHandle(tableId);
+    ASSERT_TRUE(handle.has_value());
+    ASSERT_EQ((*handle)->getIndexes().size(), 1u);
+    EXPECT_EQ((*handle)->getIndexes()[0].column, userId);
+    EXPECT_EQ((*handle)->resolvePath((*handle)->getIndexes()[0].path), tempDir_ / "orders-user_id.idx");
+    EXPECT_EQ((*handle)->getIndexes()[0].fileCount, 1u);
+
+    auto index = SecondaryIndex::open(tempDir_ / "orders-user_id.idx");
+    ASSERT_NE(index, nullptr);
+    EXPECT_EQ(index->getEntryCount(), 1000);
+    EXPECT_EQ(index->getFileCount(), 1u);
+
+    auto positions = index->lookup({42, 43});
+    ASSERT_EQ(positions.size(), 1u);
+    std::vector<int64_t> expected;
+    for (int64_t row = 0; row < 1000; ++row) {
+        if (row % 100 == 42 || row % 100 == 43) {
+            expected.push_back(row);
+        }
+    }
+    EXPECT_EQ(positions[0], expected);
+    EXPECT_TRUE(index->lookup({43, 42})[0].empty());
+}
+
+TEST_F(SecondaryIndexTest, IndexRange) {
+    JsonCatalog catalog(manifestPath_);
+    TableId tableId = *catalog.getTableIdByName("orders");
+    ColumnId userId = *catalog.resolveColumn(tableId, "user_id");
+    ColumnId id = *catalog.resolveColumn(tableId, "id");
+
+    auto compare = [](CompareOp op, const ColumnId& column, int64_t value) {
+        return std::make_unique<CompareExpr>(op, DataType::getInt64(),
+                                             std::make_unique<ColumnRefExpr>(column, DataType::getInt64()),
+                                             std::make_unique<ConstantExpr>(DataType::getInt64(), value));
+    };
+
+    LogicalExpr conjunction(CompareOp::AND, compare(CompareOp::GREATER, userId, 10),
+                            std::make_unique<LogicalExpr>(CompareOp::AND, compare(CompareOp::LESS_EQUAL, userId, 20),
+                                                          compare(CompareOp::EQUAL, id, 3)));
+    auto range = getIndexRange(conjunction, userId);
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->low, 11);
+    EXPECT_EQ(range->high, 20);
+    EXPECT_EQ(getIndexRange(conjunction, id)->low, 3);
+
+    LogicalExpr disjunction(CompareOp::OR, compare(CompareOp::EQUAL, userId, 1), compare(CompareOp::EQUAL, userId, 2));
+    EXPECT_FALSE(getIndexRange(disjunction, userId).has_value());
+    EXPECT_FALSE(getIndexRange(*compare(CompareOp::NOT_EQUAL, userId, 1), userId).has_value());
+    EXPECT_TRUE(getIndexRange(*compare(CompareOp::GREATER, userId, std::numeric_limits<int64_t>::max()), userId)->isEmpty());
+}
+
+// Test that a hash join looks the keys of its build side up in the index of the probe key,
+// although their range covers most of the probe rows
+TEST_F(SecondaryIndexTest, JoinLooksUpBuildKeys) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    insertOrders(session, 0, 1000);
+    insertOrders(session, 1000, 1000);
+    execute(session, "CREATE INDEX ON orders (user_id)");
+    execute(session, "INSERT INTO users VALUES (3), (97)");
+
+    metrics::Counter& indexScans = metrics::MetricsRegistry::global().counter(
+        "toydb_index_scans_total", "Scans that read rows found in a secondary index");
+    uint64_t scans = indexScans.get();
+    EXPECT_EQ(execute(session, "SELECT orders.id FROM orders, users WHERE orders.user_id = users.id"), 40);
+    EXPECT_EQ(indexScans.get(), scans + 1);
+
+    auto index = SecondaryIndex::open(tempDir_ / "orders-user_id.idx");
+    ASSERT_NE(index, nullptr);
+    std::vector<int64_t> keys = {3, 97};
+    auto positions = index->lookupKeys(keys);
+    ASSERT_EQ(positions.size(), 2u);
+    for (size_t file = 0; file < positions.size(); ++file) {
+        std::vector<int64_t> expected = index->lookup({3, 3})[file];
+        for (int64_t row : index->lookup({97, 97})[file]) {
+            expected.push_back(row);
+        }
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(positions[file], expected);
+        EXPECT_EQ(expected.size(), 20u);
+    }
+    std::vector<int64_t> missing = {-5, 1000};
+    EXPECT_TRUE(index->lookupKeys(missing)[0].empty());
+
+    // The keys of the filter are restricted to the range of the other conjuncts
+    TableId tableId = *catalog.getTableIdByName("orders");
+    ColumnId userId = *catalog.resolveColumn(tableId, "user_id");
+    auto bloom = std::make_shared<BlockedBloomFilter>(3);
+    auto bloomKeys = std::make_shared<const std::vector<int64_t>>(std::vector<int64_t> {1, 5, 9});
+    LogicalExpr predicate(
+        CompareOp::AND,
+        std::make_unique<CompareExpr>(CompareOp::LESS_EQUAL, DataType::getInt64(),
+                                      std::make_unique<ColumnRefExpr>(userId, DataType::getInt32()),
+                                      std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t {5})),
+        std::make_unique<BloomFilterExpr>(std::make_unique<ColumnRefExpr>(userId, DataType::getInt32()),
+                                          JoinKeyDomain::INTEGRAL, bloom, bloomKeys));
+    EXPECT_EQ(getIndexKeys(predicate, userId), (std::vector<int64_t> {1, 5}));
+    EXPECT_FALSE(getIndexKeys(*predicate.getLeft(), userId).has_value());
+}
+
+// Test that ANALYZE running next to CREATE INDEX doesn't drop the index it didn't see
+TEST_F(SecondaryIndexTest, AnalyzeWhileIndexing) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    insertOrders(session, 0, 1000);
+    insertOrders(session, 1000, 1000);
+    TableId tableId = *catalog.getTableIdByName("orders");
+    ColumnId id = *catalog.resolveColumn(tableId, "id");
+    ColumnId userId = *catalog.resolveColumn(tableId, "user_id");
+
+    auto analyzed = std::async(std::launch::async, [&catalog, &tableId] {
+        for (int i = 0; i < 20; ++i) {
+            if (!catalog.analyzeTable(tableId)) {
+                return false;
+            }
+        }
+        return true;
+    });
+    EXPECT_TRUE(catalog.createIndex(id).has_value());
+    EXPECT_TRUE(catalog.createIndex(userId).has_value());
+    EXPECT_TRUE(analyzed.get());
+
+    auto handle = catalog.getTableHandle(tableId);
+    ASSERT_TRUE(handle.has_value());
+    EXPECT_EQ((*handle)->getIndexes().size(), 2u);
+    EXPECT_EQ(catalog.getRowCount(tableId), 2000);
+    EXPECT_TRUE(catalog.getColumnStatistics(userId).has_value());
+
+    // Both survive a reload of the manifest
+    JsonCatalog reloaded(manifestPath_);
+    EXPECT_EQ((*reloaded.getTableHandle(tableId))->getIndexes().size(), 2u);
+    EXPECT_EQ(reloaded.getRowCount(tableId), 2000);
+}
+
+// Test that lookups are served from the page cache across opens, but not from the pages of a replaced index
+TEST_F(SecondaryIndexTest, LookupsAreCached) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    insertOrders(session, 0, 1000);
+    execute(session, "CREATE INDEX ON orders (user_id)");
+
+    const memory::PageCache& cache = SecondaryIndex::getPageCache();
+    fs::path path = tempDir_ / "orders-user_id.idx";
+    EXPECT_EQ(SecondaryIndex::open(path)->lookup({42, 42})[0].size(), 10u);
+    int64_t misses = cache.getMissCount();
+    int64_t hits = cache.getHitCount();
+    EXPECT_EQ(SecondaryIndex::open(path)->lookup({42, 42})[0].size(), 10u);
+    EXPECT_EQ(cache.getMissCount(), misses);
+    EXPECT_GT(cache.getHitCount(), hits);
+
+    insertOrders(session, 1000, 1000);
+    execute(session, "CREATE INDEX ON orders (user_id)");
+    auto rebuilt = SecondaryIndex::open(path);
+    ASSERT_NE(rebuilt, nullptr);
+    EXPECT_EQ(rebuilt->getFileCount(), 2u);
+    EXPECT_EQ(rebuilt->lookup({42, 42})[1].size(), 10u);
+}
@@ -0,0 +1,191 @@
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/cpu_features.hpp"
+#include "common/hash.hpp"
+#include "common/simd_kernels.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+using namespace toydb::simd;
+
+namespace {
+
+constexpr CompareOp COMPARE_OPS[] = {CompareOp::EQUAL, CompareOp::NOT_EQUAL, CompareOp::GREATER,
+                                     CompareOp::LESS, CompareOp::GREATER_EQUAL, CompareOp::LESS_EQUAL};
+
+// The vectorized levels the host supports, every one must match the scalar kernels
+std::vector<const KernelTable*> getSupportedKernels() {
+    std::vector<const KernelTable*> tables;
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON}) {
+        if (const KernelTable* kernels = getKernels(level)) {
+            tables.push_back(kernels);
+        }
+    }
+    return tables;
+}
+
+const KernelTable& getScalarKernels() {
+    const KernelTable* kernels = getKernels(SimdLevel::SCALAR);
+    EXPECT_NE(kernels, nullptr);
+    return *kernels;
+}
+
+}  // namespace
+
+TEST(SimdKernelsTest, SelectsSupportedLevel) {
+    EXPECT_TRUE(isSupported(SimdLevel::SCALAR));
+    EXPECT_TRUE(isSupported(detectSimdLevel()));
+    EXPECT_EQ(getKernels(detectSimdLevel())->level, detectSimdLevel());
+
+    const KernelTable& kernels = getKernels();
+    if (!std::getenv("TOYDB_SIMD")) {
+        EXPECT_EQ(kernels.level, detectSimdLevel());
+    }
+
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON}) {
+        EXPECT_EQ(parseSimdLevel(toString(level)), level);
+        if (const KernelTable* table = getKernels(level)) {
+            EXPECT_EQ(table->level, level);
+        }
+    }
+    EXPECT_EQ(parseSimdLevel("sse2"), std::nullopt);
+}
+
+TEST(SimdKernelsTest, ComparisonsMatchScalar) {
+    std::mt19937_64 rng(42);
+    std::vector<int64_t> int64s(64);
+    std::vector<int32_t> int32s(64);
+    std::vector<double> doubles(64);
+    for (size_t i = 0; i < 64; ++i) {
+        int64s[i] = static_cast<int64_t>(rng() % 7) - 3;
+        int32s[i] = static_cast<int32_t>(rng() % 7) - 3;
+        doubles[i] = static_cast<double>(rng() % 7) - 3.0;
+    }
+    int64s[5] = std::numeric_limits<int64_t>::min();
+    int64s[6] = std::numeric_limits<int64_t>::max();
+    int32s[7] = std::numeric_limits<int32_t>::min();
+    doubles[8] = std::numeric_limits<double>::quiet_NaN();
+    doubles[9] = -0.0;
+
+    const KernelTable& scalar = getScalarKernels();
+    for (const KernelTable* kernels : getSupportedKernels()) {
+        for (CompareOp op : COMPARE_OPS) {
+            auto index = static_cast<size_t>(op);
+            // Every tail length, and constants outside the int32_t range
+            for (int64_t count = 0; count <= 64; ++count) {
+                for (int64_t constant : {int64_t{-1}, int64_t{0}, int64_t{2}, int64_t{1} << 40, -(int64_t{1} << 40)}) {
+                    EXPECT_EQ(kernels->compareInt64[index](int64s.data(), constant, count),
+                              scalar.compareInt64[index](int64s.data(), constant, count))
+                        << toString(kernels->level) << " op " << index << " count " << count;
+                    EXPECT_EQ(kernels->compareInt32[index](int32s.data(), constant, count),
+                              scalar.compareInt32[index](int32s.data(), constant, count))
+                        << toString(kernels->level) << " op " << index << " count " << count;
+                }
+                for (double constant : {0.0, 1.5, std::numeric_limits<double>::quiet_NaN()}) {
+                    EXPECT_EQ(kernels->compareDouble[index](doubles.data(), constant, count),
+                              scalar.compareDouble[index](doubles.data(), constant, count))
+                        << toString(kernels->level) << " op " << index << " count " << count;
+                }
+            }
+        }
+    }
+
+    // The scalar kernels themselves, e.g. NaN is only unequal
+    EXPECT_EQ(scalar.compareDouble[static_cast<size_t>(CompareOp::NOT_EQUAL)](doubles.data() + 8, 1.0, 1), 1u);
+    EXPECT_EQ(scalar.compareDouble[static_cast<size_t>(CompareOp::LESS_EQUAL)](doubles.data() + 8, 1.0, 1), 0u);
+    EXPECT_EQ(scalar.compareDouble[static_cast<size_t>(CompareOp::EQUAL)](doubles.data() + 9, 0.0, 1), 1u);
+    EXPECT_EQ(scalar.compareInt32[static_cast<size_t>(CompareOp::LESS)](int32s.data(), int64_t{1} << 40, 64),
+              ~uint64_t{0});
+}
+
+TEST(SimdKernelsTest, CombinatorsMatchScalar) {
+    std::mt19937_64 rng(7);
+    constexpr int64_t words = 13;
+    std::vector<uint64_t> trueA(words), nullA(words), trueB(words), nullB(words);
+    for (int64_t w = 0; w < words; ++w) {
+        // Keep the invariant that a NULL row's true bit is zero
+        nullA[w] = rng();
+        trueA[w] = rng() & ~nullA[w];
+        nullB[w] = rng();
+        trueB[w] = rng() & ~nullB[w];
+    }
+
+    const KernelTable& scalar = getScalarKernels();
+    for (const KernelTable* kernels : getSupportedKernels()) {
+        for (CombineWordsFn KernelTable::*combine : {&KernelTable::combineAnd, &KernelTable::combineOr}) {
+            std::vector<uint64_t> expectedTrue = trueA, expectedNull = nullA;
+            std::vector<uint64_t> actualTrue = trueA, actualNull = nullA;
+            (scalar.*combine)(expectedTrue.data(), expectedNull.data(), trueB.data(), nullB.data(), words);
+            (kernels->*combine)(actualTrue.data(), actualNull.data(), trueB.data(), nullB.data(), words);
+            EXPECT_EQ(actualTrue, expectedTrue) << toString(kernels->level);
+            EXPECT_EQ(actualNull, expectedNull) << toString(kernels->level);
+        }
+    }
+
+    // One row of each pair of values: FALSE, TRUE, NULL for A and B
+    uint64_t ta = 0b000'111'000, na = 0b111'000'000, tb = 0b010'010'010, nb = 0b100'100'100;
+    uint64_t t = ta, n = na;
+    scalar::combineAnd(t, n, tb, nb);
+    EXPECT_EQ(t, 0b000'010'000u);
+    EXPECT_EQ(n, 0b110'100'000u);
+    t = ta, n = na;
+    scalar::combineOr(t, n, tb, nb);
+    EXPECT_EQ(t, 0b010'111'010u);
+    EXPECT_EQ(n, 0b101'000'100u);
+}
+
+TEST(SimdKernelsTest, FindSpecialMatchesScalar) {
+    const KernelTable& scalar = getScalarKernels();
+    for (const KernelTable* kernels : getSupportedKernels()) {
+        // The special character at every position of lines of every length around the vector widths
+        for (size_t length = 0; length <= 150; ++length) {
+            std::string line(length, 'x');
+            const char* end = line.data() + line.size();
+            EXPECT_EQ(kernels->findSpecial(line.data(), end, ','), end) << toString(kernels->level);
+            for (size_t pos = 0; pos < length; ++pos) {
+                for (char special : {',', '"'}) {
+                    line[pos] = special;
+                    EXPECT_EQ(kernels->findSpecial(line.data(), end, ','), scalar.findSpecial(line.data(), end, ','))
+                        << toString(kernels->level) << " length " << length << " pos " << pos;
+                    EXPECT_EQ(kernels->findSpecial(line.data(), end, ','), line.data() + pos);
+                    line[pos] = 'x';
+                }
+            }
+        }
+    }
+
+    // Other separators, and bytes with the high bit set
+    std::string line = "\xff\x80;abc|def\"";
+    const char* end = line.data() + line.size();
+    for (const KernelTable* kernels : getSupportedKernels()) {
+        EXPECT_EQ(kernels->findSpecial(line.data(), end, '|'), line.data() + 6);
+        EXPECT_EQ(kernels->findSpecial(line.data(), end, ';'), line.data() + 2);
+        EXPECT_EQ(kernels->findSpecial(line.data(), end, '\t'), line.data() + 10);
+    }
+}
+
+TEST(SimdKernelsTest, HashesMatchScalar) {
+    std::vector<int64_t> values;
+    for (int64_t i = -50; i < 50; ++i) {
+        values.push_back(i * 0x9e3779b97f4a7c15LL);
+    }
+    values.push_back(std::numeric_limits<int64_t>::min());
+    values.push_back(std::numeric_limits<int64_t>::max());
+
+    for (const KernelTable* kernels : getSupportedKernels()) {
+        for (int64_t count : {int64_t{0}, int64_t{1}, int64_t{7}, int64_t{64}, static_cast<int64_t>(values.size())}) {
+            std::vector<uint64_t> hashes(static_cast<size_t>(count) + 1, 0);
+            kernels->hashInt64(values.data(), count, hashes.data());
+            for (int64_t i = 0; i < count; ++i) {
+                EXPECT_EQ(hashes[static_cast<size_t>(i)], hashInt64(values[static_cast<size_t>(i)]))
+                    << toString(kernels->level) << " value " << values[static_cast<size_t>(i)];
+            }
+            // Nothing is written past count
+            EXPECT_EQ(hashes.back(), 0u);
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+#include "engine/filter.hpp"
+#include "engine/hash_join.hpp"
+#include "engine/nested_loop_join.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/sort_merge_join.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class SortMergeJoinTest : public ::testing::Test {
+   protected:
+    using PairSet = std::multiset<std::pair<int64_t, int64_t>>;
+
+    std::unique_ptr<ColumnRefExpr> intKey(uint64_t id, const std::string& name) {
+        return std::make_unique<ColumnRefExpr>(ColumnId(id, name), DataType::getInt64());
+    }
+
+    // Collect (build value, probe value) pairs of a join over two int64 columns. NULL is mapped to -1.
+    PairSet collectPairs(PhysicalOperator& join) {
+        PairSet pairs;
+        while (true) {
+            RowVector batch;
+            int64_t count = join.next(batch);
+            if (count == 0) {
+                break;
+            }
+            EXPECT_EQ(batch.getColumnCount(), 2);
+            const ColumnBuffer& left = batch.getColumn(0);
+            const ColumnBuffer& right = batch.getColumn(1);
+            batch.forEachSelectedRow([&](int64_t row) {
+                int64_t l = left.isNull(row) ? -1 : left.getEntry<db_int64>(row);
+                int64_t r = right.isNull(row) ? -1 : right.getEntry<db_int64>(row);
+                pairs.emplace(l, r);
+            });
+        }
+        return pairs;
+    }
+};
+
+// Test that equi-joins of all types match the hash join, with key groups spanning input batches
+TEST_F(SortMergeJoinTest, EquiJoinMatchesHashJoin) {
+    std::vector<int64_t> buildKeys = {1, 2, 2, 2, 3, 5, 7, 7};
+    std::vector<int64_t> probeKeys = {0, 2, 2, 3, 4, 7, 8, 9};
+
+    for (JoinType joinType : {JoinType::INNER, JoinType::LEFT, JoinType::RIGHT, JoinType::FULL_OUTER}) {
+        ColumnBufferStorage storage;
+        auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", buildKeys).withBatchSizes({2, 3, 3}).build();
+        auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", probeKeys).withBatchSizes({1, 2, 5}).build();
+        SortMergeJoinExec merge(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::EQUAL,
+                                joinType);
+        merge.initialize();
+
+        auto hashBuild = MockOperatorBuilder(&storage).addInt64Column(0, "col0", buildKeys).build();
+        auto hashProbe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", probeKeys).build();
+        HashJoinExec hash(hashBuild.get(), hashProbe.get(), intKey(0, "col0"), intKey(1, "col1"), joinType);
+        hash.initialize();
+
+        EXPECT_EQ(collectPairs(merge), collectPairs(hash)) << "join type " << static_cast<int>(joinType);
+    }
+}
+
+// Test that range joins match the nested loop join for every comparison
+TEST_F(SortMergeJoinTest, RangeJoinMatchesNestedLoopJoin) {
+    std::vector<int64_t> buildKeys = {1, 3, 3, 5, 8, 8};
+    std::vector<int64_t> probeKeys = {0, 2, 3, 3, 6, 9};
+
+    for (CompareOp op : {CompareOp::LESS, CompareOp::LESS_EQUAL, CompareOp::GREATER, CompareOp::GREATER_EQUAL}) {
+        ColumnBufferStorage storage;
+        auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", buildKeys).withBatchSizes({4, 2}).build();
+        auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", probeKeys).withBatchSizes({1, 5}).build();
+        SortMergeJoinExec merge(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), op);
+        merge.initialize();
+
+        auto loopBuild = MockOperatorBuilder(&storage).addInt64Column(0, "col0", buildKeys).build();
+        auto loopProbe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", probeKeys).build();
+        auto condition = std::make_unique<CompareExpr>(op, DataType::getInt64(), intKey(0, "col0"), intKey(1, "col1"));
+        NestedLoopJoinExec loop(loopBuild.get(), loopProbe.get(), std::move(condition));
+        loop.initialize();
+
+        EXPECT_EQ(collectPairs(merge), collectPairs(loop)) << "comparison " << toString(op);
+    }
+}
+
+// Test that unselected rows of a filtered input are skipped
+TEST_F(SortMergeJoinTest, SkipsUnselectedRows) {
+    ColumnBufferStorage storage;
+
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, 10)).build();
+    auto predicate = std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(), intKey(0, "col0"),
+                                                   std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{6}));
+    FilterExec build(input.get(), std::move(predicate));
+    auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {2, 6, 9, 12}).build();
+
+    SortMergeJoinExec join(&build, probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::EQUAL, JoinType::LEFT);
+    join.initialize();
+
+    PairSet expected = {{6, 6}, {7, -1}, {8, -1}, {9, 9}};
+    EXPECT_EQ(collectPairs(join), expected);
+}
+
+// Test that a group larger than one output batch is split across calls to next()
+TEST_F(SortMergeJoinTest, OutputSpansMultipleBatches) {
+    ColumnBufferStorage storage;
+
+    auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", std::vector<int64_t>(100, 7)).build();
+    auto probe = MockOperatorBuilder(&storage)
+        .addInt64Column(1, "col1", std::vector<int64_t>(1000, 7))
+        .withBatchSizes({300, 700})
+        .build();
+
+    SortMergeJoinExec join(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"));
+    join.initialize();
+
+    int64_t batches = 0;
+    int64_t total = 0;
+    while (true) {
+        RowVector batch;
+        int64_t count = join.next(batch);
+        if (count == 0) {
+            break;
+        }
+        total += count;
+        ++batches;
+    }
+
+    EXPECT_EQ(total, 100000);
+    EXPECT_GT(batches, 1);
+}
+
+// Test that a LEFT join of an empty probe input keeps every build row
+TEST_F(SortMergeJoinTest, OuterJoinWithEmptyInput) {
+    ColumnBufferStorage storage;
+
+    auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1, 2}).build();
+    auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {}).build();
+
+    SortMergeJoinExec join(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::EQUAL,
+                           JoinType::LEFT);
+    join.initialize();
+
+    PairSet expected = {{1, -1}, {2, -1}};
+    EXPECT_EQ(collectPairs(join), expected);
+}
+
+// Test that unsupported join configurations are rejected
+TEST_F(SortMergeJoinTest, InvalidJoins) {
+    ColumnBufferStorage storage;
+
+    auto build = MockOperatorBuilder(&storage).addInt64Column(0, "col0", {1}).build();
+    auto probe = MockOperatorBuilder(&storage).addInt64Column(1, "col1", {1}).build();
+
+    EXPECT_THROW(SortMergeJoinExec(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::LESS,
+                                   JoinType::LEFT),
+                 InternalSQLError);
+    EXPECT_THROW(SortMergeJoinExec(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::NOT_EQUAL),
+                 InternalSQLError);
+    EXPECT_THROW(SortMergeJoinExec(build.get(), probe.get(), intKey(0, "col0"), intKey(1, "col1"), CompareOp::EQUAL,
+                                   JoinType::CROSS),
+                 InternalSQLError);
+}
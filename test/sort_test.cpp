@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
+#include "common/data_strucures/loser_tree.hpp"
+#include "engine/batch_allocator.hpp"
+#include "engine/sort.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class SortTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage;
+    memory::BufferManager bufferManager;
+
+    static SortKey intKey(bool ascending = true) {
+        return {ColumnId(0, "col0"), DataType::getInt64(), ascending};
+    }
+
+    // Rows of (col0, col1) of an operator over two int64 columns
+    static std::vector<std::pair<int64_t, int64_t>> collectPairs(PhysicalOperator& op) {
+        std::vector<std::pair<int64_t, int64_t>> rows;
+        while (true) {
+            RowVector batch;
+            int64_t count = op.next(batch);
+            if (count == 0) {
+                break;
+            }
+            for (int64_t row = 0; row < count; ++row) {
+                rows.emplace_back(batch.getColumn(0).getEntry<db_int64>(row), batch.getColumn(1).getEntry<db_int64>(row));
+            }
+        }
+        return rows;
+    }
+
+    // col1 is derived from col0, so it can be checked after sorting
+    static std::vector<int64_t> payloadOf(const std::vector<int64_t>& keys) {
+        std::vector<int64_t> payload;
+        for (int64_t key : keys) {
+            payload.push_back(key * 3 + 1);
+        }
+        return payload;
+    }
+
+    static void expectSorted(const std::vector<std::pair<int64_t, int64_t>>& rows, std::vector<int64_t> keys, bool ascending) {
+        ASSERT_EQ(rows.size(), keys.size());
+        std::sort(keys.begin(), keys.end());
+        if (!ascending) {
+            std::reverse(keys.begin(), keys.end());
+        }
+        for (size_t i = 0; i < rows.size(); ++i) {
+            ASSERT_EQ(rows[i].first, keys[i]) << "Row " << i;
+            ASSERT_EQ(rows[i].second, keys[i] * 3 + 1) << "Row " << i;
+        }
+    }
+};
+
+// Test that the loser tree merges sorted sequences, including empty ones
+TEST_F(SortTest, LoserTreeMerge) {
+    std::vector<std::vector<int>> sources = {{1, 4, 9}, {}, {2, 3, 10, 11}, {0}, {5, 6, 7, 8}};
+    std::vector<size_t> positions(sources.size(), 0);
+
+    auto less = [&](size_t a, size_t b) {
+        bool aDone = positions[a] == sources[a].size();
+        bool bDone = positions[b] == sources[b].size();
+        if (aDone || bDone) {
+            return !aDone;
+        }
+        return sources[a][positions[a]] < sources[b][positions[b]];
+    };
+    LoserTree<decltype(less)> tree(sources.size(), less);
+
+    std::vector<int> merged;
+    while (positions[tree.top()] < sources[tree.top()].size()) {
+        merged.push_back(sources[tree.top()][positions[tree.top()]++]);
+        tree.replay();
+    }
+
+    std::vector<int> expected(12);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(merged, expected);
+}
+
+// Test sorting in memory, ascending and descending, with negative keys and duplicates
+TEST_F(SortTest, InMemory) {
+    std::vector<int64_t> keys = randomInts(-500, 500, 5000);
+    for (bool ascending : {true, false}) {
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", keys)
+            .addInt64Column(1, "col1", payloadOf(keys))
+            .withBatchSizes({1000, 1500, 2500})
+            .build();
+
+        SortExec sort(input.get(), {intKey(ascending)});
+        sort.initialize();
+        expectSorted(collectPairs(sort), keys, ascending);
+        EXPECT_EQ(sort.getSpilledRunCount(), 0u);
+    }
+}
+
+// Test doubles, strings and the placement of NULLs
+TEST_F(SortTest, TypesAndNulls) {
+    std::vector<ColumnDescriptor> schema = {
+        {ColumnId(0, "col0"), DataType::getString()},
+        {ColumnId(1, "col1"), DataType::getDouble()},
+    };
+    std::vector<std::optional<std::string>> strings = {
+        "pear", std::nullopt, "apple", "a much longer string than inline", "", std::string("a\0b", 3), "b",
+    };
+    std::vector<std::optional<double>> doubles = {2.5, -1.0, std::nullopt, -0.0, 0.0, -1e300, 1e-300};
+
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch = allocator.allocateBatch(schema);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        auto row = static_cast<int64_t>(i);
+        strings[i] ? batch.getColumn(0).writeString(row, *strings[i]) : batch.getColumn(0).setNull(row);
+        doubles[i] ? batch.getColumn(1).writeEntry<db_double>(row, *doubles[i]) : batch.getColumn(1).setNull(row);
+    }
+    batch.getColumn(0).count = static_cast<int64_t>(strings.size());
+    batch.getColumn(1).count = static_cast<int64_t>(strings.size());
+    batch.setRowCount(static_cast<int64_t>(strings.size()));
+
+    // The output is only valid while the operator exists
+    auto sortBy = [&](SortKey key, auto&& check) {
+        std::vector<RowVector> batches;
+        batches.push_back(batch.view());
+        MockOperator input(&storage, std::move(batches));
+        SortExec sort(&input, {key});
+        sort.initialize();
+        RowVector out;
+        ASSERT_EQ(sort.next(out), static_cast<int64_t>(strings.size()));
+        check(out);
+    };
+
+    sortBy({ColumnId(0, "col0"), DataType::getString(), true}, [](const RowVector& out) {
+        std::vector<std::string> expected = {"", std::string("a\0b", 3), "a much longer string than inline", "apple", "b", "pear"};
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(out.getColumn(0).getEntry<db_string>(static_cast<int64_t>(i)).view(), expected[i]) << "Row " << i;
+        }
+        EXPECT_TRUE(out.getColumn(0).isNull(static_cast<int64_t>(expected.size())));
+    });
+
+    sortBy({ColumnId(1, "col1"), DataType::getDouble(), false}, [](const RowVector& out) {
+        const ColumnBuffer& col = out.getColumn(1);
+        EXPECT_TRUE(col.isNull(0));
+        EXPECT_EQ(col.getEntry<db_double>(1), 2.5);
+        EXPECT_EQ(col.getEntry<db_double>(2), 1e-300);
+        EXPECT_EQ(col.getEntry<db_double>(3), 0.0);
+        EXPECT_EQ(col.getEntry<db_double>(4), 0.0);
+        EXPECT_EQ(col.getEntry<db_double>(5), -1.0);
+        EXPECT_EQ(col.getEntry<db_double>(6), -1e300);
+        EXPECT_EQ(out.getColumn(0).getEntry<db_string>(6).view(), std::string("a\0b", 3));
+    });
+}
+
+// Test that runs over the memory budget are spilled and merged, with fewer runs than the
+// merge fan-in and with enough runs to require an intermediate merge pass
+TEST_F(SortTest, ExternalSort) {
+    std::vector<int64_t> keys = randomInts(-1000000, 1000000, 100000, 9);
+    for (size_t memoryBudget : {size_t{1024 * 1024}, size_t{1}}) {
+        auto input = MockOperatorBuilder(&storage)
+            .addInt64Column(0, "col0", keys)
+            .addInt64Column(1, "col1", payloadOf(keys))
+            .withBatchSizes(std::vector<int64_t>(100, 1000))
+            .build();
+
+        SortExec sort(input.get(), {intKey()}, memoryBudget);
+        sort.initialize();
+        expectSorted(collectPairs(sort), keys, true);
+
+        EXPECT_GT(sort.getSpilledRunCount(), 1u);
+        if (memoryBudget == 1) {
+            EXPECT_GT(sort.getSpilledRunCount(), SortExec::MERGE_FAN_IN);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/predicate_result.hpp"
+#include "engine/spill.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+
+class SpillTest : public ::testing::Test {
+protected:
+    memory::BufferManager bufferManager;
+};
+
+// Test that bytes written in pieces of any size are read back across block boundaries
+TEST_F(SpillTest, RoundTripsBytesAcrossBlocks) {
+    SpillFile file("test");
+    std::string data;
+    for (size_t i = 0; data.size() < 3 * SpillFile::BLOCK_SIZE + 123; ++i) {
+        data += std::to_string(i) + ",";
+    }
+    for (size_t pos = 0; pos < data.size(); pos += 1000) {
+        file.write(std::string_view(data).substr(pos, 1000));
+    }
+    EXPECT_EQ(file.getSize(), data.size());
+
+    auto reader = file.openReader();
+    std::string read(data.size(), '\0');
+    for (size_t pos = 0; pos < data.size(); pos += 777) {
+        size_t n = std::min<size_t>(777, data.size() - pos);
+        ASSERT_TRUE(reader->read(read.data() + pos, n));
+    }
+    EXPECT_EQ(read, data);
+    char c = 0;
+    EXPECT_FALSE(reader->read(&c, 1));
+
+    // Bytes appended after reading are seen by the next reader
+    file.write("tail");
+    reader = file.openReader();
+    std::string blocks;
+    for (std::string_view block = reader->nextBlock(); !block.empty(); block = reader->nextBlock()) {
+        blocks += block;
+    }
+    EXPECT_EQ(blocks, data + "tail");
+}
+
+// Test that the selected rows of batches round-trip with NULLs and long strings
+TEST_F(SpillTest, RoundTripsBatches) {
+    std::vector<ColumnDescriptor> schema = {
+        {ColumnId(0, "col0"), DataType::getInt64()},
+        {ColumnId(1, "col1"), DataType::getString()},
+        {ColumnId(2, "col2"), DataType::getDouble()},
+    };
+    std::vector<std::optional<std::string>> strings = {"a", std::nullopt, "a much longer string than inline", "", "b"};
+
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch = allocator.allocateBatch(schema);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        auto row = static_cast<int64_t>(i);
+        i == 3 ? batch.getColumn(0).setNull(row) : batch.getColumn(0).writeEntry<db_int64>(row, row * 10);
+        strings[i] ? batch.getColumn(1).writeString(row, *strings[i]) : batch.getColumn(1).setNull(row);
+        batch.getColumn(2).writeEntry<db_double>(row, 0.5 * static_cast<double>(row));
+    }
+    for (int64_t col = 0; col < batch.getColumnCount(); ++col) {
+        batch.getColumn(col).count = static_cast<int64_t>(strings.size());
+    }
+    batch.setRowCount(static_cast<int64_t>(strings.size()));
+
+    SpillFile file("test");
+    file.writeBatch(batch);
+
+    PredicateResultVector selection(static_cast<int64_t>(strings.size()));
+    selection.setTrue(1);
+    selection.setTrue(2);
+    selection.setTrue(3);
+    RowVector filtered = batch.view();
+    filtered.setSelection(&selection);
+    file.writeBatch(filtered);
+
+    auto reader = file.openReader();
+    BatchAllocator readAllocator(&bufferManager);
+    RowVector out;
+    ASSERT_EQ(reader->readBatch(batch.getSchema(), readAllocator, out), 5);
+    for (int64_t row = 0; row < 5; ++row) {
+        auto i = static_cast<size_t>(row);
+        EXPECT_EQ(out.getColumn(0).isNull(row), row == 3);
+        if (row != 3) {
+            EXPECT_EQ(out.getColumn(0).getEntry<db_int64>(row), row * 10);
+        }
+        ASSERT_EQ(out.getColumn(1).isNull(row), !strings[i]);
+        if (strings[i]) {
+            EXPECT_EQ(out.getColumn(1).getEntry<db_string>(row).view(), *strings[i]);
+        }
+        EXPECT_EQ(out.getColumn(2).getEntry<db_double>(row), 0.5 * static_cast<double>(row));
+    }
+
+    ASSERT_EQ(reader->readBatch(batch.getSchema(), readAllocator, out), 3);
+    EXPECT_FALSE(out.hasSelection());
+    EXPECT_TRUE(out.getColumn(1).isNull(0));
+    EXPECT_EQ(out.getColumn(1).getEntry<db_string>(1).view(), "a much longer string than inline");
+    EXPECT_TRUE(out.getColumn(0).isNull(2));
+    EXPECT_EQ(out.getColumn(0).getEntry<db_int64>(1), 20);
+
+    EXPECT_EQ(reader->readBatch(batch.getSchema(), readAllocator, out), 0);
+}
+
+// Test that the file is removed with the SpillFile
+TEST_F(SpillTest, RemovesFile) {
+    std::filesystem::path path;
+    {
+        SpillFile file("test");
+        file.write("data");
+        file.flush();
+        path = file.getPath();
+        EXPECT_TRUE(std::filesystem::exists(path));
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
@@ -0,0 +1,157 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include "engine/predicate_expr.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_cache.hpp"
+#include "storage/table_handle.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class TableCacheTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path manifestPath_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "table_cache_test";
+        fs::create_directories(tempDir_);
+
+        std::string tables;
+        for (const std::string name : {"notes", "events"}) {
+            writeTable(name, 20000);
+            tables += std::string(tables.empty() ? "" : ",") + R"({
+                "name": ")" + name + R"(", "id": )" + std::to_string(tables.empty() ? 1 : 2) + R"(, "id_name": ")" + name +
+                R"(", "format": "csv",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "note", "type": "STRING", "nullable": true}
+                ],
+                "files": [{"path": ")" + name + R"(.csv"}]
+            })";
+        }
+        manifestPath_ = tempDir_ / "manifest.json";
+        std::ofstream(manifestPath_) << R"({"tables": [)" + tables + "]}";
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    // Rows with ids in [0, rows), the notes of every third row are long strings and of every tenth NULL
+    void writeTable(const std::string& name, int64_t rows) {
+        std::ofstream out(tempDir_ / (name + ".csv"));
+        out << "id,note\n";
+        for (int64_t id = 0; id < rows; ++id) {
+            out << id << "," << (id % 10 == 0 ? "" : expectedNote(id)) << "\n";
+        }
+    }
+
+    static std::string expectedNote(int64_t id) {
+        return id % 3 == 0 ? "a note that is too long to be inlined " + std::to_string(id) : "short";
+    }
+
+    // Scan the table and check the notes of its rows
+    static std::set<int64_t> scanIds(Catalog& catalog, const std::string& name,
+                                     const PredicateExpr* predicate = nullptr) {
+        auto handle = catalog.getTableHandle(*catalog.getTableIdByName(name));
+        EXPECT_TRUE(handle.has_value());
+        auto scan = (*handle)->createScan(4096, 2, {}, predicate);
+
+        std::set<int64_t> ids;
+        RowVector batch;
+        while (int64_t rows = scan->next(batch)) {
+            for (int64_t row = 0; row < rows; ++row) {
+                int64_t id = batch.getColumn(0).getEntry<db_int64>(row);
+                EXPECT_TRUE(ids.insert(id).second);
+                const ColumnBuffer& notes = batch.getColumn(1);
+                EXPECT_EQ(notes.isNull(row), id % 10 == 0);
+                if (id % 10 != 0) {
+                    EXPECT_EQ(notes.getEntry<db_string>(row).view(), expectedNote(id));
+                }
+            }
+        }
+        return ids;
+    }
+};
+
+// Test that the first scan loads the table and later scans read the cached rows, skipping chunks ruled out by the predicate
+TEST_F(TableCacheTest, ScansReadCachedRows) {
+    JsonCatalog catalog(manifestPath_);
+    catalog.enableTableCache(size_t{64} * 1024 * 1024);
+    TableCache* cache = catalog.getTableCache();
+    ASSERT_NE(cache, nullptr);
+
+    EXPECT_EQ(scanIds(catalog, "notes").size(), 20000u);
+    EXPECT_EQ(cache->getMissCount(), 1);
+    EXPECT_EQ(cache->getTableCount(), 1u);
+    EXPECT_GT(cache->getMemoryUsage(), 0u);
+
+    EXPECT_EQ(scanIds(catalog, "notes").size(), 20000u);
+    EXPECT_EQ(cache->getHitCount(), 1);
+
+    TableId tableId = *catalog.getTableIdByName("notes");
+    ColumnId idCol = *catalog.resolveColumn(tableId, "id");
+    CompareExpr predicate(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                          std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                          std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{19000}));
+    predicate.initializeIndexMap();
+    std::set<int64_t> ids = scanIds(catalog, "notes", &predicate);
+    EXPECT_TRUE(ids.contains(19999));
+    EXPECT_LT(ids.size(), 20000u);
+    EXPECT_EQ(cache->getHitCount(), 2);
+}
+
+// Test that rewriting a file or analyzing the table reloads its rows
+TEST_F(TableCacheTest, Invalidation) {
+    JsonCatalog catalog(manifestPath_);
+    catalog.enableTableCache(size_t{64} * 1024 * 1024);
+    TableCache* cache = catalog.getTableCache();
+
+    EXPECT_EQ(scanIds(catalog, "notes").size(), 20000u);
+    writeTable("notes", 15000);
+    EXPECT_EQ(scanIds(catalog, "notes").size(), 15000u);
+    EXPECT_EQ(cache->getMissCount(), 2);
+    EXPECT_EQ(cache->getTableCount(), 1u);
+
+    TableId tableId = *catalog.getTableIdByName("notes");
+    ASSERT_TRUE(catalog.analyzeTable(tableId).has_value());
+    EXPECT_EQ(cache->getTableCount(), 0u);
+    EXPECT_EQ(scanIds(catalog, "notes").size(), 15000u);
+    EXPECT_EQ(cache->getMissCount(), 3);
+}
+
+// Test that the least recently used table is evicted to stay within the budget, and tables larger than it are not cached
+TEST_F(TableCacheTest, Eviction) {
+    size_t tableBytes;
+    {
+        JsonCatalog catalog(manifestPath_);
+        catalog.enableTableCache(size_t{64} * 1024 * 1024);
+        scanIds(catalog, "notes");
+        tableBytes = catalog.getTableCache()->getMemoryUsage();
+    }
+
+    JsonCatalog catalog(manifestPath_);
+    catalog.enableTableCache(tableBytes * 3 / 2);
+    TableCache* cache = catalog.getTableCache();
+    scanIds(catalog, "notes");
+    scanIds(catalog, "events");
+    EXPECT_EQ(cache->getTableCount(), 1u);
+    EXPECT_LE(cache->getMemoryUsage(), cache->getMemoryBudget());
+
+    scanIds(catalog, "events");
+    EXPECT_EQ(cache->getHitCount(), 1);
+    scanIds(catalog, "notes");
+    EXPECT_EQ(cache->getMissCount(), 3);
+
+    JsonCatalog small(manifestPath_);
+    small.enableTableCache(tableBytes / 2);
+    EXPECT_EQ(scanIds(small, "notes").size(), 20000u);
+    EXPECT_EQ(scanIds(small, "notes").size(), 20000u);
+    EXPECT_EQ(small.getTableCache()->getTableCount(), 0u);
+    EXPECT_EQ(small.getTableCache()->getMissCount(), 1);
+}
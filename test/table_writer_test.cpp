@@ -0,0 +1,217 @@
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "common/errors.hpp"
+#include "server/insert_log.hpp"
+#include "server/session.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_writer.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Fails to add files while failAddFiles is set, as if the manifest could not be written
+ */
+class FailingCatalog : public JsonCatalog {
+public:
+    bool failAddFiles = false;
+
+    using JsonCatalog::JsonCatalog;
+
+    std::expected<void, CatalogError> addFiles(const TableId& tableId, std::vector<FileEntry> files) override {
+        if (failAddFiles) {
+            return std::unexpected(CatalogError::WRITE_FAILED);
+        }
+        return JsonCatalog::addFiles(tableId, std::move(files));
+    }
+};
+
+class TableWriterTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path manifestPath_;
+    std::string output_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "table_writer_test";
+        fs::create_directories(tempDir_);
+        manifestPath_ = tempDir_ / "manifest.json";
+        std::ofstream(manifestPath_) << R"({
+            "tables": [{
+                "name": "events", "id": 1, "id_name": "events", "format": "tdb",
+                "schema": [
+                    {"name": "id", "type": "INT64", "nullable": false},
+                    {"name": "note", "type": "STRING", "nullable": true},
+                    {"name": "score", "type": "DOUBLE", "nullable": true}
+                ],
+                "files": []
+            }, {
+                "name": "lines", "id": 2, "id_name": "lines", "format": "csv",
+                "schema": [{"name": "id", "type": "INT64", "nullable": false}],
+                "files": []
+            }]
+        })";
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    std::optional<int64_t> execute(server::Session& session, const std::string& sql) {
+        output_.clear();
+        return session.execute(sql, [this](std::string_view text) { output_ += text; });
+    }
+};
+
+TEST_F(TableWriterTest, InsertAddsFile) {
+    {
+        JsonCatalog catalog(manifestPath_);
+        server::Session session(&catalog);
+        uint64_t version = catalog.getVersion();
+
+        EXPECT_EQ(execute(session, "INSERT INTO events VALUES (1, 'first', 1.5), (2, NULL, 2)"), std::nullopt);
+        EXPECT_EQ(output_, "Inserted 2 rows into events\n");
+        EXPECT_GT(catalog.getVersion(), version);
+
+        EXPECT_EQ(execute(session, "INSERT INTO events (score, id) VALUES (0.5, 3)"), std::nullopt);
+        EXPECT_EQ(execute(session, "SELECT id FROM events WHERE score > 1"), 2);
+        EXPECT_EQ(execute(session, "SELECT id FROM events WHERE id < 3"), 2);
+    }
+
+    // Every INSERT wrote one file, both are in the manifest with their row counts and statistics
+    JsonCatalog catalog(manifestPath_);
+    TableId tableId = *catalog.getTableIdByName("events");
+    EXPECT_EQ(catalog.getRowCount(tableId), 3);
+    auto stats = catalog.getColumnStatistics(*catalog.resolveColumn(tableId, "id"));
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->intMin, 1);
+    EXPECT_EQ(stats->intMax, 3);
+
+    auto handle = catalog.getTableHandle(tableId);
+    ASSERT_TRUE(handle.has_value());
+    ASSERT_EQ((*handle)->getFiles().size(), 2u);
+    EXPECT_EQ((*handle)->getFiles()[0].path, fs::path("events-0.tdb"));
+    EXPECT_EQ((*handle)->getFilePaths()[1], tempDir_ / "events-1.tdb");
+}
+
+// Test that rows of a statement spanning several batches end up in a single file
+TEST_F(TableWriterTest, InsertManyRows) {
+    std::string sql = "INSERT INTO events (id) VALUES (0)";
+    for (int64_t id = 1; id < 20000; ++id) {
+        sql += ", (" + std::to_string(id) + ")";
+    }
+
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+    execute(session, sql);
+    EXPECT_EQ(output_, "Inserted 20000 rows into events\n");
+
+    TableId tableId = *catalog.getTableIdByName("events");
+    EXPECT_EQ(catalog.getRowCount(tableId), 20000);
+    EXPECT_EQ((*catalog.getTableHandle(tableId))->getFiles().size(), 1u);
+    EXPECT_EQ(execute(session, "SELECT id FROM events WHERE id >= 19990"), 10);
+}
+
+// Test that invalid rows are rejected before anything is written
+TEST_F(TableWriterTest, RejectsInvalidRows) {
+    JsonCatalog catalog(manifestPath_);
+    server::Session session(&catalog);
+
+    EXPECT_THROW(execute(session, "INSERT INTO events (note) VALUES ('no id')"), SQLRuntimeException);
+    EXPECT_THROW(execute(session, "INSERT INTO events VALUES (1, 'a', 'not a number')"), SQLRuntimeException);
+    EXPECT_THROW(execute(session, "INSERT INTO events VALUES (1, 'a')"), SQLRuntimeException);
+    EXPECT_THROW(execute(session, "INSERT INTO events (id, missing) VALUES (1, 2)"), UnresolvedColumnException);
+    EXPECT_THROW(execute(session, "INSERT INTO unknown VALUES (1)"), UnresolvedColumnException);
+    EXPECT_THROW(execute(session, "INSERT INTO lines VALUES (1)"), SQLRuntimeException);
+
+    EXPECT_EQ(catalog.getRowCount(*catalog.getTableIdByName("events")), 0);
+    EXPECT_FALSE(fs::exists(tempDir_ / "events-0.tdb"));
+}
+
+// Test that logged INSERTs are written again by the recovery, as after a crash that lost their files
+TEST_F(TableWriterTest, RecoverInsertsFromLog) {
+    fs::path logPath = tempDir_ / "manifest.json.wal";
+    {
+        JsonCatalog catalog(manifestPath_);
+        auto log = std::make_unique<WriteAheadLog>(logPath);
+        ASSERT_TRUE(log->open());
+        server::InsertLog insertLog(&catalog, nullptr, std::move(log));
+        ASSERT_TRUE(insertLog.recover());
+        server::Session session(&catalog, nullptr, nullptr, &insertLog);
+
+        execute(session, "INSERT INTO events VALUES (1, 'first', 1.5), (2, NULL, 2)");
+        EXPECT_EQ(output_, "Inserted 2 rows into events\n");
+        execute(session, "INSERT INTO events (id) VALUES (3)");
+        EXPECT_GT(insertLog.getLog().getSize(), 0u);
+    }
+    fs::remove(tempDir_ / "events-1.tdb");
+
+    JsonCatalog catalog(manifestPath_);
+    auto log = std::make_unique<WriteAheadLog>(logPath);
+    ASSERT_TRUE(log->open());
+    server::InsertLog insertLog(&catalog, nullptr, std::move(log));
+    ASSERT_TRUE(insertLog.recover());
+    EXPECT_EQ(insertLog.getLog().getSize(), 0u);
+
+    server::Session session(&catalog, nullptr, nullptr, &insertLog);
+    EXPECT_EQ(execute(session, "SELECT id FROM events WHERE id > 0"), 3);
+    TableId tableId = *catalog.getTableIdByName("events");
+    EXPECT_EQ((*catalog.getTableHandle(tableId))->getFiles().size(), 2u);
+}
+
+// Test that the file of a logged INSERT the catalog failed to add is added by the next checkpoint,
+// which keeps the log until then
+TEST_F(TableWriterTest, CheckpointAddsLoggedFiles) {
+    fs::path logPath = tempDir_ / "manifest.json.wal";
+    {
+        FailingCatalog catalog(manifestPath_);
+        auto log = std::make_unique<WriteAheadLog>(logPath);
+        ASSERT_TRUE(log->open());
+        server::InsertLog insertLog(&catalog, nullptr, std::move(log));
+        ASSERT_TRUE(insertLog.recover());
+        server::Session session(&catalog, nullptr, nullptr, &insertLog);
+        TableId tableId = *catalog.getTableIdByName("events");
+
+        catalog.failAddFiles = true;
+        EXPECT_THROW(execute(session, "INSERT INTO events VALUES (1, 'first', 1.5), (2, NULL, 2)"), SQLRuntimeException);
+        EXPECT_EQ(catalog.getRowCount(tableId), 0);
+        EXPECT_FALSE(insertLog.checkpoint());
+        EXPECT_GT(insertLog.getLog().getSize(), 0u);
+
+        catalog.failAddFiles = false;
+        EXPECT_TRUE(insertLog.checkpoint());
+        EXPECT_EQ(insertLog.getLog().getSize(), 0u);
+        EXPECT_EQ(catalog.getRowCount(tableId), 2);
+        EXPECT_EQ(execute(session, "SELECT id FROM events WHERE id > 0"), 2);
+    }
+
+    // The checkpoint synced the manifest listing the file
+    JsonCatalog catalog(manifestPath_);
+    EXPECT_EQ(catalog.getRowCount(*catalog.getTableIdByName("events")), 2);
+}
+
+// Test that queries read the catalog while a writer of another session holds the catalog lock
+TEST_F(TableWriterTest, QueriesDoNotWaitForWriters) {
+    JsonCatalog catalog(manifestPath_);
+    std::shared_mutex catalogMutex;
+    server::Session writer(&catalog, nullptr, &catalogMutex);
+    execute(writer, "INSERT INTO events VALUES (1, 'first', 1.5), (2, NULL, 2)");
+
+    std::unique_lock lock(catalogMutex);
+    auto rowCount = std::async(std::launch::async, [&catalog, &catalogMutex] {
+        server::Session reader(&catalog, nullptr, &catalogMutex);
+        return reader.execute("SELECT id FROM events WHERE id > 0", [](std::string_view) {});
+    });
+    bool finished = rowCount.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    lock.unlock();
+    EXPECT_TRUE(finished);
+    EXPECT_EQ(rowCount.get(), 2);
+}
@@ -0,0 +1,304 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/memory.hpp"
+#include "engine/predicate_expr.hpp"
+#include "storage/catalog.hpp"
+#include "storage/table_handle.hpp"
+#include "storage/tdb_data_file_reader.hpp"
+#include "storage/tdb_file.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class TdbFileTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    TableId tableId_{1, "events"};
+    Schema schema_;
+    memory::BufferManager bufferManager_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "tdb_file_test";
+        fs::create_directories(tempDir_);
+
+        std::vector<std::pair<std::string, DataType>> columns = {{"id", DataType::getInt64()},
+                                                                 {"score", DataType::getInt32()},
+                                                                 {"ratio", DataType::getDouble()},
+                                                                 {"flag", DataType::getBool()},
+                                                                 {"note", DataType::getString()}};
+        for (size_t i = 0; i < columns.size(); ++i) {
+            schema_.addColumn(ColumnId(i + 1, columns[i].first, tableId_), {columns[i].first, columns[i].second});
+        }
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+
+    std::vector<tdb::ColumnInfo> getColumns() const {
+        std::vector<tdb::ColumnInfo> columns;
+        for (const ColumnId& colId : schema_.getColumnIds()) {
+            columns.push_back({colId.getName(), schema_.getColumn(colId)->type});
+        }
+        return columns;
+    }
+
+    std::vector<ColumnDescriptor> getDescriptors() const {
+        std::vector<ColumnDescriptor> descriptors;
+        for (const ColumnId& colId : schema_.getColumnIds()) {
+            descriptors.push_back({colId, schema_.getColumn(colId)->type});
+        }
+        return descriptors;
+    }
+
+    static std::string noteFor(int64_t id) {
+        return id % 3 == 0 ? "note " + std::to_string(id) + " with a long text" : "n" + std::to_string(id);
+    }
+
+    // Every 5th score and every 7th note is NULL
+    void writeRows(TdbFileWriter& writer, int64_t from, int64_t to) {
+        BatchAllocator allocator(&bufferManager_);
+        RowVector batch = allocator.allocateBatch(getDescriptors());
+        for (int64_t id = from; id < to; ++id) {
+            int64_t row = id - from;
+            batch.getColumn(0).writeEntry<db_int64>(row, id);
+            batch.getColumn(1).writeEntry<db_int32>(row, static_cast<db_int32>(id % 100));
+            if (id % 5 == 0) {
+                batch.getColumn(1).setNull(row);
+            }
+            batch.getColumn(2).writeEntry<db_double>(row, static_cast<double>(id) / 4);
+            batch.getColumn(3).writeEntry<db_bool>(row, id % 2 == 0);
+            batch.getColumn(4).writeString(row, noteFor(id));
+            if (id % 7 == 0) {
+                batch.getColumn(4).setNull(row);
+            }
+        }
+        batch.setRowCount(to - from);
+        writer.append(batch);
+    }
+
+    RowVector allocateBatch(BatchAllocator& allocator) {
+        return allocator.allocateBatch(getDescriptors());
+    }
+
+    // Check the rows written by writeRows
+    static void checkRow(const RowVector& batch, int64_t row) {
+        int64_t id = batch.getColumn(0).getEntry<db_int64>(row);
+        EXPECT_EQ(batch.getColumn(1).isNull(row), id % 5 == 0) << id;
+        if (id % 5 != 0) {
+            EXPECT_EQ(batch.getColumn(1).getEntry<db_int32>(row), id % 100);
+        }
+        EXPECT_EQ(batch.getColumn(2).getEntry<db_double>(row), static_cast<double>(id) / 4);
+        EXPECT_EQ(batch.getColumn(3).getEntry<db_bool>(row), id % 2 == 0);
+        EXPECT_EQ(batch.getColumn(4).isNull(row), id % 7 == 0) << id;
+        if (id % 7 != 0) {
+            EXPECT_EQ(batch.getColumn(4).getEntry<db_string>(row).view(), noteFor(id));
+        }
+    }
+};
+
+// Test that rows written to a TDB file are read back with their values and NULLs, in batches not aligned to the row groups
+TEST_F(TdbFileTest, RoundTrip) {
+    fs::path path = tempDir_ / "events.tdb";
+    TdbFileWriter writer(path, getColumns(), 100);
+    writeRows(writer, 0, 250);
+    writeRows(writer, 250, 330);
+    ASSERT_TRUE(writer.finish());
+    EXPECT_EQ(writer.getRowCount(), 330);
+
+    TdbDataFileReader reader(path, schema_, tableId_);
+    EXPECT_EQ(reader.getRowGroupCount(), 4);
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator);
+    int64_t expectedId = 0;
+    while (int64_t rowsRead = reader.readBatch(batch, 30)) {
+        EXPECT_LE(rowsRead, 30);
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            EXPECT_EQ(batch.getColumn(0).getEntry<db_int64>(row), expectedId++);
+            checkRow(batch, row);
+        }
+    }
+    EXPECT_EQ(expectedId, 330);
+    EXPECT_FALSE(reader.hasMore());
+
+    // Reset starts over
+    reader.reset();
+    EXPECT_EQ(reader.readBatch(batch, 1000), 100);
+    EXPECT_EQ(batch.getColumn(0).getEntry<db_int64>(0), 0);
+}
+
+// Test that only the projected columns are read and row groups ruled out by the predicate are skipped
+TEST_F(TdbFileTest, ProjectionAndPruning) {
+    fs::path path = tempDir_ / "events.tdb";
+    TdbFileWriter writer(path, getColumns(), 100);
+    writeRows(writer, 0, 400);
+    ASSERT_TRUE(writer.finish());
+
+    ColumnId idCol = schema_.getColumnIds()[0];
+    ColumnId noteCol = schema_.getColumnIds()[4];
+    CompareExpr predicate(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                          std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                          std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{250}));
+    predicate.initializeIndexMap();
+
+    TdbDataFileReader reader(path, schema_, tableId_);
+    reader.setProjection({noteCol, idCol});
+    reader.setPredicate(&predicate);
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch;
+    batch.addColumn(allocator.allocateColumn(noteCol, DataType::getString()));
+    batch.addColumn(allocator.allocateColumn(idCol, DataType::getInt64()));
+
+    std::vector<int64_t> ids;
+    while (int64_t rowsRead = reader.readBatch(batch, 1024)) {
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            int64_t id = batch.getColumn(1).getEntry<db_int64>(row);
+            ids.push_back(id);
+            if (id % 7 != 0) {
+                EXPECT_EQ(batch.getColumn(0).getEntry<db_string>(row).view(), noteFor(id));
+            }
+        }
+    }
+    EXPECT_EQ(reader.getSelectedRowGroups(), (std::vector<int>{2, 3}));
+    // Rows of row group 2 below 250 are filtered on the encoded ids
+    ASSERT_EQ(ids.size(), 150u);
+    EXPECT_EQ(ids.front(), 250);
+    EXPECT_EQ(ids.back(), 399);
+}
+
+// Test that comparisons on encoded chunks drop the rows that don't match before they are decoded
+TEST_F(TdbFileTest, FilterEncodedChunks) {
+    fs::path path = tempDir_ / "events.tdb";
+    TdbFileWriter writer(path, getColumns(), 100);
+    writeRows(writer, 0, 400);
+    ASSERT_TRUE(writer.finish());
+
+    // 150 <= id AND 170 > id
+    ColumnId idCol = schema_.getColumnIds()[0];
+    LogicalExpr predicate(CompareOp::AND,
+                          std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                                                        std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                                                        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{150})),
+                          std::make_unique<CompareExpr>(CompareOp::GREATER, DataType::getInt64(),
+                                                        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{170}),
+                                                        std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64())));
+    predicate.initializeIndexMap();
+
+    TdbDataFileReader reader(path, schema_, tableId_);
+    reader.setPredicate(&predicate);
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator);
+    std::vector<int64_t> ids;
+    while (int64_t rowsRead = reader.readBatch(batch, 30)) {
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            ids.push_back(batch.getColumn(0).getEntry<db_int64>(row));
+            checkRow(batch, row);
+        }
+    }
+    EXPECT_EQ(reader.getSelectedRowGroups(), (std::vector<int>{1}));
+    ASSERT_EQ(ids.size(), 20u);
+    EXPECT_EQ(ids.front(), 150);
+    EXPECT_EQ(ids.back(), 169);
+    EXPECT_EQ(reader.getFilteredRowCount(), 80);
+}
+
+// Test that zones whose min/max rule out the predicate are skipped within a row group
+TEST_F(TdbFileTest, ZoneMaps) {
+    fs::path path = tempDir_ / "events.tdb";
+    TdbFileWriter writer(path, getColumns(), 100, 25);
+    writeRows(writer, 0, 400);
+    ASSERT_TRUE(writer.finish());
+
+    // id >= 160 AND id < 180
+    ColumnId idCol = schema_.getColumnIds()[0];
+    LogicalExpr predicate(CompareOp::AND,
+                          std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+                                                        std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                                                        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{160})),
+                          std::make_unique<CompareExpr>(CompareOp::LESS, DataType::getInt64(),
+                                                        std::make_unique<ColumnRefExpr>(idCol, DataType::getInt64()),
+                                                        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{180})));
+    predicate.initializeIndexMap();
+
+    TdbDataFileReader reader(path, schema_, tableId_);
+    reader.setPredicate(&predicate);
+
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator);
+    std::vector<int64_t> ids;
+    while (int64_t rowsRead = reader.readBatch(batch, 1024)) {
+        EXPECT_LE(rowsRead, 25);
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            ids.push_back(batch.getColumn(0).getEntry<db_int64>(row));
+            checkRow(batch, row);
+        }
+    }
+    EXPECT_EQ(reader.getSelectedRowGroups(), (std::vector<int>{1}));
+    // Only the zones [150, 175) and [175, 200) are read
+    EXPECT_EQ(reader.getSkippedZoneCount(), 2);
+    EXPECT_EQ(reader.getFilteredRowCount(), 30);
+    ASSERT_EQ(ids.size(), 20u);
+    EXPECT_EQ(ids.front(), 160);
+    EXPECT_EQ(ids.back(), 179);
+}
+
+// Test that a CSV table converted to a TDB file is scanned with the same rows
+TEST_F(TdbFileTest, ConvertTable) {
+    fs::path csvPath = tempDir_ / "events.csv";
+    {
+        std::ofstream csv(csvPath);
+        csv << "id,score,ratio,flag,note\n";
+        for (int64_t id = 0; id < 1000; ++id) {
+            csv << id << "," << (id % 5 == 0 ? "" : std::to_string(id % 100)) << "," << static_cast<double>(id) / 4
+                << "," << (id % 2 == 0 ? "true" : "false") << "," << (id % 7 == 0 ? "" : noteFor(id)) << "\n";
+        }
+    }
+    TableHandle csvTable(tableId_, StorageFormat::CSV, schema_, {FileEntry{csvPath, std::nullopt, {}}});
+
+    fs::path tdbPath = tempDir_ / "events.tdb";
+    ASSERT_TRUE(convertToTdb(csvTable, tdbPath));
+
+    TableHandle tdbTable(tableId_, StorageFormat::TDB, schema_, {FileEntry{tdbPath, std::nullopt, {}}});
+    auto iterator = tdbTable.createIterator(256, 2);
+    std::vector<bool> seen(1000, false);
+    RowVector batch;
+    while (int64_t rowsRead = iterator->next(batch)) {
+        for (int64_t row = 0; row < rowsRead; ++row) {
+            int64_t id = batch.getColumn(0).getEntry<db_int64>(row);
+            ASSERT_TRUE(id >= 0 && id < 1000);
+            EXPECT_FALSE(seen[static_cast<size_t>(id)]);
+            seen[static_cast<size_t>(id)] = true;
+            checkRow(batch, row);
+        }
+    }
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), true), 1000);
+}
+
+// Test that files that are not valid TDB files are reported as empty
+TEST_F(TdbFileTest, InvalidFiles) {
+    fs::path path = tempDir_ / "broken.tdb";
+    std::ofstream(path) << "id,score\n1,2\n";
+    TdbDataFileReader notTdb(path, schema_, tableId_);
+    EXPECT_FALSE(notTdb.hasMore());
+
+    // A writer that was not finished leaves no footer
+    {
+        TdbFileWriter writer(path, getColumns(), 100);
+        writeRows(writer, 0, 150);
+    }
+    TdbDataFileReader unfinished(path, schema_, tableId_);
+    EXPECT_FALSE(unfinished.hasMore());
+
+    TdbDataFileReader missing(tempDir_ / "missing.tdb", schema_, tableId_);
+    EXPECT_FALSE(missing.hasMore());
+    BatchAllocator allocator(&bufferManager_);
+    RowVector batch = allocateBatch(allocator);
+    EXPECT_EQ(missing.readBatch(batch, 10), 0);
+}
@@ -29,8 +29,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare Insert nodes
-    if (auto* expInsert = dynamic_cast<const Insert*>(expected)) {
-        auto* actInsert = dynamic_cast<const Insert*>(actual);
+    if (auto* expInsert = as<Insert>(expected)) {
+        auto* actInsert = as<Insert>(actual);
         if (!actInsert) {
             toydb::Logger::error("AST mismatch at {}: expected Insert but got different type",
                                  path);
@@ -76,7 +76,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
             for (size_t j = 0; j < expInsert->values[i].size(); ++j) {
                 std::stringstream valuePath;
                 valuePath << path << ".values[" << i << "][" << j << "]";
-                if (!compareASTNodes(expInsert->values[i][j].get(), actInsert->values[i][j].get(),
+                if (!compareASTNodes(expInsert->values[i][j], actInsert->values[i][j],
                                      valuePath.str())) {
                     return false;
                 }
@@ -87,8 +87,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare Update nodes
-    if (auto* expUpdate = dynamic_cast<const Update*>(expected)) {
-        auto* actUpdate = dynamic_cast<const Update*>(actual);
+    if (auto* expUpdate = as<Update>(expected)) {
+        auto* actUpdate = as<Update>(actual);
         if (!actUpdate) {
             toydb::Logger::error("AST mismatch at {}: expected Update but got different type",
                                  path);
@@ -118,8 +118,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
 
             std::stringstream assignPath;
             assignPath << path << ".assignments[" << i << "].value";
-            if (!compareASTNodes(expUpdate->assignments[i].second.get(),
-                                 actUpdate->assignments[i].second.get(), assignPath.str())) {
+            if (!compareASTNodes(expUpdate->assignments[i].second,
+                                 actUpdate->assignments[i].second, assignPath.str())) {
                 return false;
             }
         }
@@ -131,7 +131,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expUpdate->where) {
-            if (!compareASTNodes(expUpdate->where.get(), actUpdate->where.get(), path + ".where")) {
+            if (!compareASTNodes(expUpdate->where, actUpdate->where, path + ".where")) {
                 return false;
             }
         }
@@ -140,8 +140,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare Delete nodes
-    if (auto* expDelete = dynamic_cast<const Delete*>(expected)) {
-        auto* actDelete = dynamic_cast<const Delete*>(actual);
+    if (auto* expDelete = as<Delete>(expected)) {
+        auto* actDelete = as<Delete>(actual);
         if (!actDelete) {
             toydb::Logger::error("AST mismatch at {}: expected Delete but got different type",
                                  path);
@@ -161,7 +161,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expDelete->where) {
-            if (!compareASTNodes(expDelete->where.get(), actDelete->where.get(), path + ".where")) {
+            if (!compareASTNodes(expDelete->where, actDelete->where, path + ".where")) {
                 return false;
             }
         }
@@ -169,9 +169,81 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         return true;
     }
 
-    // Compare CreateTable nodes
-    if (auto* expCreate = dynamic_cast<const CreateTable*>(expected)) {
-        auto* actCreate = dynamic_cast<const CreateTable*>(actual);
+    // Compare Analyze nodes
+    if (auto* expAnalyze = as<Analyze>(expected)) {
+        auto* actAnalyze = as<Analyze>(actual);
+        if (!actAnalyze) {
+            toydb::Logger::error("AST mismatch at {}: expected Analyze but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expAnalyze->tableName != actAnalyze->tableName) {
+            toydb::Logger::error("AST mismatch at {}.tableName: expected '{}' but got '{}'", path,
+                                 expAnalyze->tableName, actAnalyze->tableName);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Compare CreateIndex nodes
+    if (auto* expIndex = as<CreateIndex>(expected)) {
+        auto* actIndex = as<CreateIndex>(actual);
+        if (!actIndex) {
+            toydb::Logger::error("AST mismatch at {}: expected CreateIndex but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expIndex->tableName != actIndex->tableName || expIndex->columnName != actIndex->columnName) {
+            toydb::Logger::error("AST mismatch at {}: expected index on {}.{} but got {}.{}", path,
+                                 expIndex->tableName, expIndex->columnName, actIndex->tableName,
+                                 actIndex->columnName);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Compare Explain nodes
+    if (auto* expExplain = as<Explain>(expected)) {
+        auto* actExplain = as<Explain>(actual);
+        if (!actExplain) {
+            toydb::Logger::error("AST mismatch at {}: expected Explain but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expExplain->analyze != actExplain->analyze) {
+            toydb::Logger::error("AST mismatch at {}.analyze: expected {} but got {}", path,
+                                 expExplain->analyze, actExplain->analyze);
+            return false;
+        }
+
+        return compareASTNodes(expExplain->query, actExplain->query, path + ".query");
+    }
+
+    // Compare CreateMaterializedView nodes
+    if (auto* expView = as<CreateMaterializedView>(expected)) {
+        auto* actView = as<CreateMaterializedView>(actual);
+        if (!actView) {
+            toydb::Logger::error("AST mismatch at {}: expected CreateMaterializedView but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expView->name != actView->name) {
+            toydb::Logger::error("AST mismatch at {}.name: expected '{}' but got '{}'", path, expView->name,
+                                 actView->name);
+            return false;
+        }
+
+        return compareASTNodes(expView->query, actView->query, path + ".query");
+    }
+
+    if (auto* expCreate = as<CreateTable>(expected)) {
+        auto* actCreate = as<CreateTable>(actual);
         if (!actCreate) {
             toydb::Logger::error("AST mismatch at {}: expected CreateTable but got different type",
                                  path);
@@ -210,8 +282,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare ConstantString nodes
-    if (auto* expConstString = dynamic_cast<const ConstantString*>(expected)) {
-        auto* actConstString = dynamic_cast<const ConstantString*>(actual);
+    if (auto* expConstString = as<ConstantString>(expected)) {
+        auto* actConstString = as<ConstantString>(actual);
         if (!actConstString) {
             toydb::Logger::error("AST mismatch at {}: expected ConstantString but got different type",
                                  path);
@@ -227,9 +299,27 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         return true;
     }
 
+    // Compare Parameter nodes
+    if (auto* expParameter = as<Parameter>(expected)) {
+        auto* actParameter = as<Parameter>(actual);
+        if (!actParameter) {
+            toydb::Logger::error("AST mismatch at {}: expected Parameter but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expParameter->index != actParameter->index) {
+            toydb::Logger::error("AST mismatch at {}.index: expected {} but got {}", path,
+                                 expParameter->index, actParameter->index);
+            return false;
+        }
+
+        return true;
+    }
+
     // Compare ConstantInt nodes
-    if (auto* expConstInt = dynamic_cast<const ConstantInt*>(expected)) {
-        auto* actConstInt = dynamic_cast<const ConstantInt*>(actual);
+    if (auto* expConstInt = as<ConstantInt>(expected)) {
+        auto* actConstInt = as<ConstantInt>(actual);
         if (!actConstInt) {
             toydb::Logger::error("AST mismatch at {}: expected ConstantInt but got different type",
                                  path);
@@ -246,8 +336,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare ConstantDouble nodes
-    if (auto* expConstDouble = dynamic_cast<const ConstantDouble*>(expected)) {
-        auto* actConstDouble = dynamic_cast<const ConstantDouble*>(actual);
+    if (auto* expConstDouble = as<ConstantDouble>(expected)) {
+        auto* actConstDouble = as<ConstantDouble>(actual);
         if (!actConstDouble) {
             toydb::Logger::error("AST mismatch at {}: expected ConstantDouble but got different type",
                                  path);
@@ -264,8 +354,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare ConstantBool nodes
-    if (auto* expConstBool = dynamic_cast<const ConstantBool*>(expected)) {
-        auto* actConstBool = dynamic_cast<const ConstantBool*>(actual);
+    if (auto* expConstBool = as<ConstantBool>(expected)) {
+        auto* actConstBool = as<ConstantBool>(actual);
         if (!actConstBool) {
             toydb::Logger::error("AST mismatch at {}: expected ConstantBool but got different type",
                                  path);
@@ -282,8 +372,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare ConstantNull nodes
-    if (dynamic_cast<const ConstantNull*>(expected)) {
-        if (!dynamic_cast<const ConstantNull*>(actual)) {
+    if (as<ConstantNull>(expected)) {
+        if (!as<ConstantNull>(actual)) {
             toydb::Logger::error("AST mismatch at {}: expected ConstantNull but got different type",
                                  path);
             return false;
@@ -292,8 +382,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare Condition nodes
-    if (auto* expCondition = dynamic_cast<const Condition*>(expected)) {
-        auto* actCondition = dynamic_cast<const Condition*>(actual);
+    if (auto* expCondition = as<Condition>(expected)) {
+        auto* actCondition = as<Condition>(actual);
         if (!actCondition) {
             toydb::Logger::error("AST mismatch at {}: expected Condition but got different type",
                                  path);
@@ -311,7 +401,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expCondition->left) {
-            if (!compareASTNodes(expCondition->left.get(), actCondition->left.get(),
+            if (!compareASTNodes(expCondition->left, actCondition->left,
                                  path + ".left")) {
                 return false;
             }
@@ -324,7 +414,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expCondition->right) {
-            if (!compareASTNodes(expCondition->right.get(), actCondition->right.get(),
+            if (!compareASTNodes(expCondition->right, actCondition->right,
                                  path + ".right")) {
                 return false;
             }
@@ -334,8 +424,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare Column nodes
-    if (auto* expColumn = dynamic_cast<const ColumnRef*>(expected)) {
-        auto* actColumn = dynamic_cast<const ColumnRef*>(actual);
+    if (auto* expColumn = as<ColumnRef>(expected)) {
+        auto* actColumn = as<ColumnRef>(actual);
         if (!actColumn) {
             toydb::Logger::error("AST mismatch at {}: expected Column but got different type",
                                  path);
@@ -360,12 +450,95 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
             return false;
         }
 
+        if (expColumn->aggregate != actColumn->aggregate || expColumn->quantile != actColumn->quantile) {
+            toydb::Logger::error("AST mismatch at {}.aggregate: expected '{}' but got '{}'", path,
+                                 expColumn->getExpressionString(), actColumn->getExpressionString());
+            return false;
+        }
+
+        if ((expColumn->expression == nullptr) != (actColumn->expression == nullptr)) {
+            toydb::Logger::error("AST mismatch at {}.expression: one is null and the other is not", path);
+            return false;
+        }
+
+        if (expColumn->expression &&
+            !compareASTNodes(expColumn->expression, actColumn->expression, path + ".expression")) {
+            return false;
+        }
+
         return true;
     }
 
+    // Compare Arithmetic nodes
+    if (auto* expArithmetic = as<Arithmetic>(expected)) {
+        auto* actArithmetic = as<Arithmetic>(actual);
+        if (!actArithmetic) {
+            toydb::Logger::error("AST mismatch at {}: expected Arithmetic but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expArithmetic->op != actArithmetic->op) {
+            toydb::Logger::error("AST mismatch at {}.op: expected {} but got {}", path,
+                                 toydb::toString(expArithmetic->op), toydb::toString(actArithmetic->op));
+            return false;
+        }
+
+        return compareASTNodes(expArithmetic->left, actArithmetic->left, path + ".left") &&
+               compareASTNodes(expArithmetic->right, actArithmetic->right, path + ".right");
+    }
+
+    // Compare FunctionCall nodes
+    if (auto* expCall = as<FunctionCall>(expected)) {
+        auto* actCall = as<FunctionCall>(actual);
+        if (!actCall) {
+            toydb::Logger::error("AST mismatch at {}: expected FunctionCall but got different type",
+                                 path);
+            return false;
+        }
+
+        if (expCall->function != actCall->function) {
+            toydb::Logger::error("AST mismatch at {}.function: expected {} but got {}", path,
+                                 toydb::toString(expCall->function), toydb::toString(actCall->function));
+            return false;
+        }
+
+        if (expCall->arguments.size() != actCall->arguments.size()) {
+            toydb::Logger::error("AST mismatch at {}.arguments: expected {} but got {}", path,
+                                 expCall->arguments.size(), actCall->arguments.size());
+            return false;
+        }
+
+        for (size_t i = 0; i < expCall->arguments.size(); ++i) {
+            if (!compareASTNodes(expCall->arguments[i], actCall->arguments[i],
+                                 path + ".arguments[" + std::to_string(i) + "]")) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Compare Cast nodes
+    if (auto* expCast = as<Cast>(expected)) {
+        auto* actCast = as<Cast>(actual);
+        if (!actCast) {
+            toydb::Logger::error("AST mismatch at {}: expected Cast but got different type", path);
+            return false;
+        }
+
+        if (expCast->type != actCast->type) {
+            toydb::Logger::error("AST mismatch at {}.type: expected {} but got {}", path,
+                                 expCast->type.toString(), actCast->type.toString());
+            return false;
+        }
+
+        return compareASTNodes(expCast->expression, actCast->expression, path + ".expression");
+    }
+
     // Compare Table nodes
-    if (auto* expTable = dynamic_cast<const Table*>(expected)) {
-        auto* actTable = dynamic_cast<const Table*>(actual);
+    if (auto* expTable = as<Table>(expected)) {
+        auto* actTable = as<Table>(actual);
         if (!actTable) {
             toydb::Logger::error("AST mismatch at {}: expected Table but got different type", path);
             return false;
@@ -383,12 +556,17 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
             return false;
         }
 
+        if (expTable->sample != actTable->sample) {
+            toydb::Logger::error("AST mismatch at {}.sample of table '{}'", path, expTable->name);
+            return false;
+        }
+
         return true;
     }
 
     // Compare TableExpr nodes
-    if (auto* expTableExpr = dynamic_cast<const TableExpr*>(expected)) {
-        auto* actTableExpr = dynamic_cast<const TableExpr*>(actual);
+    if (auto* expTableExpr = as<TableExpr>(expected)) {
+        auto* actTableExpr = as<TableExpr>(actual);
         if (!actTableExpr) {
             toydb::Logger::error("AST mismatch at {}: expected TableExpr but got different type",
                                  path);
@@ -405,7 +583,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expTableExpr->join) {
-            if (!compareASTNodes(expTableExpr->join.get(), actTableExpr->join.get(),
+            if (!compareASTNodes(expTableExpr->join, actTableExpr->join,
                                  path + ".join")) {
                 return false;
             }
@@ -418,7 +596,7 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expTableExpr->condition) {
-            if (!compareASTNodes(expTableExpr->condition.get(), actTableExpr->condition.get(),
+            if (!compareASTNodes(expTableExpr->condition, actTableExpr->condition,
                                  path + ".condition")) {
                 return false;
             }
@@ -428,8 +606,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare ColumnDefinition nodes
-    if (auto* expColDef = dynamic_cast<const ColumnDefinition*>(expected)) {
-        auto* actColDef = dynamic_cast<const ColumnDefinition*>(actual);
+    if (auto* expColDef = as<ColumnDefinition>(expected)) {
+        auto* actColDef = as<ColumnDefinition>(actual);
         if (!actColDef) {
             toydb::Logger::error(
                 "AST mismatch at {}: expected ColumnDefinition but got different type", path);
@@ -452,8 +630,8 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
     }
 
     // Compare SelectFrom nodes
-    if (auto* expSelect = dynamic_cast<const SelectFrom*>(expected)) {
-        auto* actSelect = dynamic_cast<const SelectFrom*>(actual);
+    if (auto* expSelect = as<SelectFrom>(expected)) {
+        auto* actSelect = as<SelectFrom>(actual);
         if (!actSelect) {
             toydb::Logger::error("AST mismatch at {}: expected SelectFrom but got different type", path);
             return false;
@@ -505,11 +683,48 @@ bool compareASTNodes(const toydb::ast::ASTNode* expected, const toydb::ast::ASTN
         }
 
         if (expSelect->where) {
-            if (!compareASTNodes(expSelect->where.get(), actSelect->where.get(), path + ".where")) {
+            if (!compareASTNodes(expSelect->where, actSelect->where, path + ".where")) {
+                return false;
+            }
+        }
+
+        if (expSelect->groupBy.size() != actSelect->groupBy.size()) {
+            toydb::Logger::error("AST mismatch at {}.groupBy: expected {} columns but got {}", path,
+                                 expSelect->groupBy.size(), actSelect->groupBy.size());
+            return false;
+        }
+
+        for (size_t i = 0; i < expSelect->groupBy.size(); ++i) {
+            std::stringstream groupPath;
+            groupPath << path << ".groupBy[" << i << "]";
+            if (!compareASTNodes(&expSelect->groupBy[i], &actSelect->groupBy[i], groupPath.str())) {
+                return false;
+            }
+        }
+
+        if (expSelect->orderBy.has_value() != actSelect->orderBy.has_value()) {
+            toydb::Logger::error("AST mismatch at {}.orderBy: one is set and the other is not", path);
+            return false;
+        }
+
+        if (expSelect->orderBy) {
+            if (!compareASTNodes(&*expSelect->orderBy, &*actSelect->orderBy, path + ".orderBy")) {
                 return false;
             }
         }
 
+        if (expSelect->orderByDescending != actSelect->orderByDescending) {
+            toydb::Logger::error("AST mismatch at {}.orderByDescending: expected {} but got {}", path,
+                                 expSelect->orderByDescending, actSelect->orderByDescending);
+            return false;
+        }
+
+        if (expSelect->limit != actSelect->limit) {
+            toydb::Logger::error("AST mismatch at {}.limit: expected {} but got {}", path,
+                                 expSelect->limit.value_or(-1), actSelect->limit.value_or(-1));
+            return false;
+        }
+
         return true;
     }
 
@@ -525,7 +740,7 @@ bool compareQueryAST(const toydb::ast::QueryAST& expected, const toydb::ast::Que
     }
 
     if (expected.query_) {
-        return compareASTNodes(expected.query_.get(), actual.query_.get(), "root");
+        return compareASTNodes(expected.query_, actual.query_, "root");
     }
 
     return true;
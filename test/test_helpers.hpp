@@ -3,6 +3,7 @@
 #include "engine/physical_operator.hpp"
 #include "planner/logical_operator.hpp"
 #include "engine/predicate_expr.hpp"
+#include "engine/string_heap.hpp"
 #include "common/errors.hpp"
 #include "common/types.hpp"
 #include "parser/query_ast.hpp"
@@ -36,6 +37,8 @@ private:
     std::vector<std::vector<int64_t>> int64Storage_;
     std::vector<std::vector<double>> doubleStorage_;
     std::vector<std::vector<std::string>> stringStorage_;
+    std::vector<std::vector<db_string>> dbStringStorage_;
+    StringHeap stringHeap_;
 
 public:
     ColumnBufferStorage() = default;
@@ -75,10 +78,17 @@ public:
 
     ColumnBuffer createStringColumn(const std::vector<std::string>& values, uint64_t colId, const std::string& colName) {
         stringStorage_.push_back(values);
+        dbStringStorage_.emplace_back(values.size());
 
-        // TODO: Implement proper string column buffer creation
-        // This requires fixed-size storage per string element
-        throw NotYetImplementedError("String column creation");
+        ColumnId columnId(colId, colName);
+        void* data = dbStringStorage_.back().data();
+        int64_t capacity = static_cast<int64_t>(values.size());
+        ColumnBuffer col(columnId, DataType::getString(), data, capacity);
+        for (size_t i = 0; i < values.size(); ++i) {
+            col.writeString(static_cast<int64_t>(i), values[i], &stringHeap_);
+        }
+
+        return col;
     }
 };
 
@@ -305,16 +315,30 @@ public:
         }
 
         const RowVector& batch = batches_[currentBatchIndex_];
-        for (int64_t i = 0; i < batch.getColumnCount(); ++i) {
-            out.addColumn(batch.getColumn(i));
-        }
-        out.setRowCount(batch.getRowCount());
+        out.assignView(batch);
 
         currentBatchIndex_++;
         return batch.getRowCount();
     }
 };
 
+/**
+ * @brief Call next() on the operator until it is exhausted
+ * @return Total number of rows produced
+ */
+inline int64_t drainOperator(PhysicalOperator& op) {
+    int64_t total = 0;
+    while (true) {
+        RowVector batch;
+        int64_t count = op.next(batch);
+        if (count == 0) {
+            break;
+        }
+        total += count;
+    }
+    return total;
+}
+
 inline std::unique_ptr<PhysicalOperator> MockOperatorBuilder::build() {
     // Build batches from sequence data
     std::vector<RowVector> batches;
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "engine/filter.hpp"
+#include "engine/limit.hpp"
+#include "engine/morsel.hpp"
+#include "engine/pipeline_executor.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/top_n.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class TopNTest : public ::testing::Test {
+protected:
+    ColumnBufferStorage storage;
+    memory::BufferManager bufferManager;
+
+    static SortKey intKey(bool ascending = true) {
+        return {ColumnId(0, "col0"), DataType::getInt64(), ascending};
+    }
+
+    // Counts the calls to next() of its input
+    class CountingOperator : public PhysicalOperator {
+    public:
+        PhysicalOperator* input;
+        int64_t calls = 0;
+
+        explicit CountingOperator(PhysicalOperator* input) : input(input) {}
+
+        void initialize() override {
+            input->initialize();
+        }
+
+        int64_t next(RowVector& out) override {
+            ++calls;
+            return input->next(out);
+        }
+    };
+
+    // Selected values of col0 produced by the operator
+    static std::vector<int64_t> collectKeys(PhysicalOperator& op) {
+        std::vector<int64_t> keys;
+        while (true) {
+            RowVector batch;
+            if (op.next(batch) == 0) {
+                break;
+            }
+            batch.forEachSelectedRow([&](int64_t row) {
+                keys.push_back(batch.getColumn(0).getEntry<db_int64>(row));
+            });
+        }
+        return keys;
+    }
+
+    // The first limit keys in sort order
+    static std::vector<int64_t> firstKeys(std::vector<int64_t> keys, size_t limit, bool ascending) {
+        std::sort(keys.begin(), keys.end());
+        if (!ascending) {
+            std::reverse(keys.begin(), keys.end());
+        }
+        keys.resize(std::min(limit, keys.size()));
+        return keys;
+    }
+};
+
+// Test that the top-n of random keys with duplicates matches a full sort, including the payload
+TEST_F(TopNTest, MatchesSort) {
+    std::vector<int64_t> keys = randomInts(-1000, 1000, 20000);
+    std::vector<int64_t> payload;
+    for (int64_t key : keys) {
+        payload.push_back(key * 3 + 1);
+    }
+
+    for (bool ascending : {true, false}) {
+        for (int64_t limit : {0, 1, 10, 5000, 30000}) {
+            auto input = MockOperatorBuilder(&storage)
+                .addInt64Column(0, "col0", keys)
+                .addInt64Column(1, "col1", payload)
+                .withBatchSizes({5000, 7000, 8000})
+                .build();
+
+            TopNExec topN(input.get(), {intKey(ascending)}, limit);
+            topN.initialize();
+
+            std::vector<int64_t> actual;
+            while (true) {
+                RowVector batch;
+                int64_t count = topN.next(batch);
+                if (count == 0) {
+                    break;
+                }
+                for (int64_t row = 0; row < count; ++row) {
+                    int64_t key = batch.getColumn(0).getEntry<db_int64>(row);
+                    ASSERT_EQ(batch.getColumn(1).getEntry<db_int64>(row), key * 3 + 1);
+                    actual.push_back(key);
+                }
+            }
+            EXPECT_EQ(actual, firstKeys(keys, static_cast<size_t>(limit), ascending)) << "Limit " << limit;
+        }
+    }
+}
+
+// Test that strings and NULLs survive the heap, NULLs sort last
+TEST_F(TopNTest, StringsAndNulls) {
+    std::vector<ColumnDescriptor> schema = {{ColumnId(0, "col0"), DataType::getString()}};
+    std::vector<std::optional<std::string>> strings = {
+        "pear", std::nullopt, "a much longer string than inline", "apple", std::nullopt, "b",
+    };
+
+    BatchAllocator allocator(&bufferManager);
+    RowVector batch = allocator.allocateBatch(schema);
+    for (size_t i = 0; i < strings.size(); ++i) {
+        auto row = static_cast<int64_t>(i);
+        strings[i] ? batch.getColumn(0).writeString(row, *strings[i]) : batch.getColumn(0).setNull(row);
+    }
+    batch.getColumn(0).count = static_cast<int64_t>(strings.size());
+    batch.setRowCount(static_cast<int64_t>(strings.size()));
+
+    std::vector<RowVector> batches;
+    batches.push_back(batch.view());
+    MockOperator input(&storage, std::move(batches));
+    TopNExec topN(&input, {{ColumnId(0, "col0"), DataType::getString(), true}}, 5);
+    topN.initialize();
+
+    RowVector out;
+    ASSERT_EQ(topN.next(out), 5);
+    const ColumnBuffer& col = out.getColumn(0);
+    EXPECT_EQ(col.getEntry<db_string>(0).view(), "a much longer string than inline");
+    EXPECT_EQ(col.getEntry<db_string>(1).view(), "apple");
+    EXPECT_EQ(col.getEntry<db_string>(2).view(), "b");
+    EXPECT_EQ(col.getEntry<db_string>(3).view(), "pear");
+    EXPECT_TRUE(col.isNull(4));
+    EXPECT_EQ(topN.next(out), 0);
+}
+
+// Test per-worker heaps merged by the sink of a parallel pipeline
+TEST_F(TopNTest, ParallelSink) {
+    std::vector<int64_t> keys = randomInts(-1000000, 1000000, 50000, 5);
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", keys)
+        .withBatchSizes(std::vector<int64_t>(10, 5000))
+        .build();
+    OperatorMorselSource source(input.get(), &bufferManager);
+    TopNSink sink({intKey(false)}, 100);
+
+    Pipeline pipeline;
+    pipeline.source = &source;
+    pipeline.sink = &sink;
+
+    PipelineExecutor executor(4, 256);
+    executor.run(pipeline);
+
+    TopNHeap& heap = sink.getResult();
+    EXPECT_EQ(heap.getRowCount(), 100);
+
+    std::vector<int64_t> actual;
+    RowVector batch;
+    while (heap.emit(batch) > 0) {
+        for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+            actual.push_back(batch.getColumn(0).getEntry<db_int64>(row));
+        }
+    }
+    EXPECT_EQ(actual, firstKeys(keys, 100, false));
+}
+
+// Test that a limit cuts the batch crossing it and does not pull more input afterwards
+TEST_F(TopNTest, Limit) {
+    std::vector<int64_t> keys(1000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = static_cast<int64_t>(i);
+    }
+
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", keys)
+        .withBatchSizes(std::vector<int64_t>(10, 100))
+        .build();
+    CountingOperator counting(input.get());
+    LimitExec limit(&counting, 250);
+    limit.initialize();
+
+    std::vector<int64_t> expected(keys.begin(), keys.begin() + 250);
+    EXPECT_EQ(collectKeys(limit), expected);
+    EXPECT_EQ(counting.calls, 3);
+}
+
+// Test a limit over a filter, where the batch crossing the limit has a selection
+TEST_F(TopNTest, LimitWithSelection) {
+    std::vector<int64_t> keys(1000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = static_cast<int64_t>(i);
+    }
+
+    auto input = MockOperatorBuilder(&storage)
+        .addInt64Column(0, "col0", keys)
+        .withBatchSizes(std::vector<int64_t>(4, 250))
+        .build();
+    FilterExec filter(input.get(), std::make_unique<CompareExpr>(CompareOp::GREATER_EQUAL, DataType::getInt64(),
+        std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64()),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{100})));
+    LimitExec limit(&filter, 300);
+    limit.initialize();
+
+    std::vector<int64_t> expected;
+    for (int64_t key = 100; key < 400; ++key) {
+        expected.push_back(key);
+    }
+    EXPECT_EQ(collectKeys(limit), expected);
+}
@@ -0,0 +1,299 @@
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "engine/batch_allocator.hpp"
+#include "engine/filter.hpp"
+#include "engine/memory.hpp"
+#include "engine/predicate_expr.hpp"
+#include "engine/predicate_result.hpp"
+#include "engine/projection.hpp"
+#include "engine/value_expr.hpp"
+#include "gtest/gtest.h"
+#include "test_helpers.hpp"
+
+using namespace toydb;
+using namespace toydb::test;
+using namespace toydb::test::data_helpers;
+
+class ValueExprTest : public ::testing::Test {
+protected:
+    memory::BufferManager bufferManager;
+    BatchAllocator allocator{&bufferManager};
+
+    // Column of the values, NULL where a value is missing
+    template<typename T>
+    ColumnBuffer makeColumn(uint64_t id, DataType type, const std::vector<std::optional<T>>& values) {
+        ColumnBuffer column = allocator.allocateColumn(ColumnId(id, "col" + std::to_string(id)), type);
+        for (size_t i = 0; i < values.size(); ++i) {
+            auto row = static_cast<int64_t>(i);
+            if (!values[i]) {
+                column.setNull(row);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                column.writeString(row, *values[i]);
+            } else {
+                column.writeEntry<T>(row, *values[i]);
+            }
+        }
+        column.count = static_cast<int64_t>(values.size());
+        return column;
+    }
+
+    RowVector makeBatch(const std::vector<ColumnBuffer>& columns) {
+        RowVector batch;
+        for (const ColumnBuffer& column : columns) {
+            batch.addColumn(column);
+        }
+        batch.setRowCount(columns.front().count);
+        return batch;
+    }
+
+    std::unique_ptr<ValueExpr> column(uint64_t id, DataType type) {
+        return std::make_unique<ColumnValueExpr>(ColumnId(id, "col" + std::to_string(id)), type);
+    }
+
+    template<typename T>
+    std::vector<std::optional<T>> evaluate(ValueExpr& expr, const RowVector& batch) {
+        expr.bind(*batch.getSchema());
+        ColumnBuffer result = expr.evaluate(batch, allocator);
+        EXPECT_EQ(result.type, expr.getType());
+        std::vector<std::optional<T>> values;
+        for (int64_t row = 0; row < batch.getRowCount(); ++row) {
+            if (result.isNull(row)) {
+                values.emplace_back();
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                values.emplace_back(result.getEntry<db_string>(row).view());
+            } else {
+                values.emplace_back(result.getEntry<T>(row));
+            }
+        }
+        return values;
+    }
+};
+
+// Test the operators on columns and constants, with NULLs propagating
+TEST_F(ValueExprTest, IntegerArithmetic) {
+    RowVector batch = makeBatch({
+        makeColumn<db_int64>(0, DataType::getInt64(), {1, 7, std::nullopt, -7}),
+        makeColumn<db_int64>(1, DataType::getInt64(), {10, 2, 30, std::nullopt}),
+    });
+    using Values = std::vector<std::optional<db_int64>>;
+    auto int64 = [](int64_t value) { return std::make_unique<ConstantValueExpr>(DataType::getInt64(), value); };
+
+    ArithmeticExpr sum(ArithmeticOp::ADD, column(0, DataType::getInt64()), column(1, DataType::getInt64()));
+    EXPECT_EQ(evaluate<db_int64>(sum, batch), (Values{11, 9, std::nullopt, std::nullopt}));
+
+    ArithmeticExpr product(ArithmeticOp::MULTIPLY, column(0, DataType::getInt64()), int64(3));
+    EXPECT_EQ(evaluate<db_int64>(product, batch), (Values{3, 21, std::nullopt, -21}));
+
+    ArithmeticExpr difference(ArithmeticOp::SUBTRACT, int64(100), column(0, DataType::getInt64()));
+    EXPECT_EQ(evaluate<db_int64>(difference, batch), (Values{99, 93, std::nullopt, 107}));
+
+    // Division truncates, the remainder has the sign of the dividend
+    ArithmeticExpr quotient(ArithmeticOp::DIVIDE, column(0, DataType::getInt64()), int64(2));
+    EXPECT_EQ(evaluate<db_int64>(quotient, batch), (Values{0, 3, std::nullopt, -3}));
+    ArithmeticExpr remainder(ArithmeticOp::MODULO, column(0, DataType::getInt64()), int64(3));
+    EXPECT_EQ(evaluate<db_int64>(remainder, batch), (Values{1, 1, std::nullopt, -1}));
+
+    ArithmeticExpr withNull(ArithmeticOp::ADD, column(0, DataType::getInt64()),
+                            std::make_unique<ConstantValueExpr>(DataType::getInt64()));
+    EXPECT_EQ(evaluate<db_int64>(withNull, batch), (Values(4, std::nullopt)));
+
+    EXPECT_EQ(sum.toString(), "(col0 + col1)");
+    EXPECT_THROW(ArithmeticExpr(ArithmeticOp::ADD, column(0, DataType::getInt64()), column(2, DataType::getInt32())),
+                 InternalSQLError);
+    EXPECT_THROW(ArithmeticExpr(ArithmeticOp::ADD, column(2, DataType::getString()), column(3, DataType::getString())),
+                 InternalSQLError);
+}
+
+// Test that overflow and division by zero fail the query, unless the row is NULL or not selected
+TEST_F(ValueExprTest, IntegerErrors) {
+    constexpr int32_t max = std::numeric_limits<int32_t>::max();
+    RowVector batch = makeBatch({
+        makeColumn<db_int32>(0, DataType::getInt32(), {max, 1, max}),
+        makeColumn<db_int32>(1, DataType::getInt32(), {1, 0, std::nullopt}),
+    });
+
+    ArithmeticExpr sum(ArithmeticOp::ADD, column(0, DataType::getInt32()), column(1, DataType::getInt32()));
+    EXPECT_THROW(evaluate<db_int32>(sum, batch), SQLRuntimeException);
+    ArithmeticExpr quotient(ArithmeticOp::DIVIDE, column(0, DataType::getInt32()), column(1, DataType::getInt32()));
+    EXPECT_THROW(evaluate<db_int32>(quotient, batch), SQLRuntimeException);
+
+    PredicateResultVector selection(3);
+    selection.setTrue(1);
+    batch.setSelection(&selection);
+    auto sums = evaluate<db_int32>(sum, batch);
+    EXPECT_EQ(sums[1], 1);
+    EXPECT_EQ(sums[2], std::nullopt);
+
+    selection.reset(3);
+    selection.setTrue(0);
+    auto quotients = evaluate<db_int32>(quotient, batch);
+    EXPECT_EQ(quotients[0], max);
+
+    // The minimum divided by -1 does not fit, its remainder does
+    constexpr int64_t min = std::numeric_limits<int64_t>::min();
+    RowVector minimum = makeBatch({makeColumn<db_int64>(0, DataType::getInt64(), {min})});
+    auto minusOne = std::make_unique<ConstantValueExpr>(DataType::getInt64(), int64_t{-1});
+    ArithmeticExpr remainder(ArithmeticOp::MODULO, column(0, DataType::getInt64()), minusOne->clone());
+    EXPECT_EQ(evaluate<db_int64>(remainder, minimum), (std::vector<std::optional<db_int64>>{0}));
+    ArithmeticExpr negated(ArithmeticOp::DIVIDE, column(0, DataType::getInt64()), std::move(minusOne));
+    EXPECT_THROW(evaluate<db_int64>(negated, minimum), SQLRuntimeException);
+}
+
+TEST_F(ValueExprTest, DoubleArithmetic) {
+    RowVector batch = makeBatch({makeColumn<db_double>(0, DataType::getDouble(), {1.5, -4.0, std::nullopt})});
+    using Values = std::vector<std::optional<db_double>>;
+    auto constant = [](double value) { return std::make_unique<ConstantValueExpr>(DataType::getDouble(), value); };
+
+    ArithmeticExpr product(ArithmeticOp::MULTIPLY, column(0, DataType::getDouble()), constant(2.0));
+    EXPECT_EQ(evaluate<db_double>(product, batch), (Values{3.0, -8.0, std::nullopt}));
+    ArithmeticExpr remainder(ArithmeticOp::MODULO, column(0, DataType::getDouble()), constant(1.0));
+    EXPECT_EQ(evaluate<db_double>(remainder, batch), (Values{0.5, -0.0, std::nullopt}));
+
+    ArithmeticExpr quotient(ArithmeticOp::DIVIDE, column(0, DataType::getDouble()), constant(0.0));
+    EXPECT_THROW(evaluate<db_double>(quotient, batch), SQLRuntimeException);
+}
+
+TEST_F(ValueExprTest, Casts) {
+    RowVector batch = makeBatch({
+        makeColumn<db_double>(0, DataType::getDouble(), {2.5, -1.5, 3e10}),
+        makeColumn<std::string>(1, DataType::getString(), {"12", " -3 ", "x"}),
+        makeColumn<db_int32>(2, DataType::getInt32(), {0, 42, std::nullopt}),
+    });
+    PredicateResultVector selection(3);
+    selection.setTrue(0);
+    selection.setTrue(1);
+
+    // Doubles are rounded to the nearest integer, ties to even
+    CastValueExpr toInt(column(0, DataType::getDouble()), DataType::getInt32());
+    EXPECT_THROW(evaluate<db_int32>(toInt, batch), SQLRuntimeException);
+    CastValueExpr parsed(column(1, DataType::getString()), DataType::getInt64());
+    EXPECT_THROW(evaluate<db_int64>(parsed, batch), SQLRuntimeException);
+
+    batch.setSelection(&selection);
+    auto ints = evaluate<db_int32>(toInt, batch);
+    EXPECT_EQ(ints[0], 2);
+    EXPECT_EQ(ints[1], -2);
+    auto parsedValues = evaluate<db_int64>(parsed, batch);
+    EXPECT_EQ(parsedValues[0], 12);
+    EXPECT_EQ(parsedValues[1], -3);
+
+    CastValueExpr formatted(column(2, DataType::getInt32()), DataType::getString());
+    EXPECT_EQ(evaluate<std::string>(formatted, batch), (std::vector<std::optional<std::string>>{"0", "42", std::nullopt}));
+    CastValueExpr toBool(column(2, DataType::getInt32()), DataType::getBool());
+    EXPECT_EQ(evaluate<db_bool>(toBool, batch), (std::vector<std::optional<db_bool>>{false, true, std::nullopt}));
+    CastValueExpr doubleToString(column(0, DataType::getDouble()), DataType::getString());
+    EXPECT_EQ(evaluate<std::string>(doubleToString, batch)[0], "2.5");
+
+    EXPECT_FALSE(CastValueExpr::canCast(DataType::getBool(), DataType::getDouble()));
+    EXPECT_TRUE(CastValueExpr::canCast(DataType::getNullConst(), DataType::getBool()));
+    EXPECT_THROW(CastValueExpr(column(3, DataType::getBool()), DataType::getDouble()), InternalSQLError);
+}
+
+// Test that casts of constants are folded into constants
+TEST_F(ValueExprTest, FoldsConstantCasts) {
+    auto folded = makeCast(std::make_unique<ConstantValueExpr>(DataType::getString(), std::string("TRUE")),
+                           DataType::getBool());
+    auto* constant = dynamic_cast<ConstantValueExpr*>(folded.get());
+    ASSERT_NE(constant, nullptr);
+    EXPECT_EQ(constant->getType(), DataType::getBool());
+    EXPECT_TRUE(constant->getValue<db_bool>());
+
+    auto widened = makeCast(std::make_unique<ConstantValueExpr>(DataType::getInt32(), int64_t{7}), DataType::getDouble());
+    EXPECT_EQ(widened->toString(), "7");
+    EXPECT_EQ(dynamic_cast<ConstantValueExpr&>(*widened).getValue<db_double>(), 7.0);
+
+    auto typedNull = makeCast(std::make_unique<ConstantValueExpr>(), DataType::getString());
+    EXPECT_EQ(typedNull->getType(), DataType::getString());
+    EXPECT_TRUE(dynamic_cast<ConstantValueExpr&>(*typedNull).isNull());
+
+    auto cast = makeCast(column(0, DataType::getInt32()), DataType::getInt64());
+    EXPECT_NE(dynamic_cast<CastValueExpr*>(cast.get()), nullptr);
+    EXPECT_EQ(makeCast(column(0, DataType::getInt32()), DataType::getInt32())->toString(), "col0");
+
+    EXPECT_THROW(makeCast(std::make_unique<ConstantValueExpr>(DataType::getString(), std::string("abc")),
+                          DataType::getInt32()),
+                 SQLRuntimeException);
+}
+
+TEST_F(ValueExprTest, StringFunctions) {
+    using Values = std::vector<std::optional<std::string>>;
+    RowVector batch = makeBatch({
+        makeColumn<std::string>(0, DataType::getString(), {"Hello", "a rather long string", std::nullopt, ""}),
+    });
+    auto text = [&] { return column(0, DataType::getString()); };
+    auto int64 = [](int64_t value) { return std::make_unique<ConstantValueExpr>(DataType::getInt64(), value); };
+    auto arguments = [](auto... args) {
+        std::vector<std::unique_ptr<ValueExpr>> result;
+        (result.push_back(std::move(args)), ...);
+        return result;
+    };
+
+    FunctionExpr upper(ScalarFunction::UPPER, arguments(text()));
+    EXPECT_EQ(evaluate<std::string>(upper, batch), (Values{"HELLO", "A RATHER LONG STRING", std::nullopt, ""}));
+    FunctionExpr lower(ScalarFunction::LOWER, arguments(text()));
+    EXPECT_EQ(evaluate<std::string>(lower, batch)[0], "hello");
+    FunctionExpr length(ScalarFunction::LENGTH, arguments(text()));
+    EXPECT_EQ(evaluate<db_int64>(length, batch), (std::vector<std::optional<db_int64>>{5, 20, std::nullopt, 0}));
+
+    // Positions before the start count towards the length
+    FunctionExpr prefix(ScalarFunction::SUBSTR, arguments(text(), int64(0), int64(3)));
+    EXPECT_EQ(evaluate<std::string>(prefix, batch), (Values{"He", "a ", std::nullopt, ""}));
+    FunctionExpr suffix(ScalarFunction::SUBSTR, arguments(text(), int64(3)));
+    EXPECT_EQ(evaluate<std::string>(suffix, batch), (Values{"llo", "rather long string", std::nullopt, ""}));
+    FunctionExpr negative(ScalarFunction::SUBSTR, arguments(text(), int64(1), int64(-1)));
+    EXPECT_THROW(evaluate<std::string>(negative, batch), SQLRuntimeException);
+
+    FunctionExpr concat(ScalarFunction::CONCAT,
+                        arguments(text(), std::make_unique<ConstantValueExpr>(DataType::getString(), std::string("!")),
+                                  text()));
+    EXPECT_EQ(evaluate<std::string>(concat, batch),
+              (Values{"Hello!Hello", "a rather long string!a rather long string", std::nullopt, "!"}));
+    EXPECT_EQ(concat.toString(), "CONCAT(col0, '!', col0)");
+
+    EXPECT_THROW(FunctionExpr(ScalarFunction::UPPER, arguments(column(1, DataType::getInt64()))), InternalSQLError);
+    EXPECT_THROW(FunctionExpr(ScalarFunction::SUBSTR, arguments(text())), InternalSQLError);
+}
+
+// Test that batches with more rows than an expression can compute at once are emitted in slices,
+// keeping their selection
+TEST_F(ValueExprTest, ProjectionSlicesLargeBatches) {
+    ColumnBufferStorage storage;
+    constexpr int64_t rowCount = 20000;
+    auto input = MockOperatorBuilder(&storage).addInt64Column(0, "col0", intSequence(0, rowCount)).build();
+    auto predicate = std::make_unique<CompareExpr>(
+        CompareOp::GREATER_EQUAL, DataType::getInt64(),
+        std::make_unique<ColumnRefExpr>(ColumnId(0, "col0"), DataType::getInt64()),
+        std::make_unique<ConstantExpr>(DataType::getInt64(), int64_t{100}));
+    FilterExec filter(input.get(), std::move(predicate));
+
+    std::vector<std::unique_ptr<ValueExpr>> expressions;
+    expressions.push_back(nullptr);
+    expressions.push_back(std::make_unique<ArithmeticExpr>(
+        ArithmeticOp::MULTIPLY, makeCast(column(0, DataType::getInt64()), DataType::getDouble()),
+        std::make_unique<ConstantValueExpr>(DataType::getDouble(), 0.5)));
+    ColumnId half(1, "half");
+    ProjectionExec projection(&filter, {ColumnId(0, "col0"), half}, std::move(expressions));
+    projection.initialize();
+
+    int64_t batches = 0;
+    int64_t total = 0;
+    RowVector batch;
+    while (int64_t count = projection.next(batch)) {
+        ++batches;
+        total += count;
+        EXPECT_EQ(count, batch.getSelectedRowCount());
+        EXPECT_LE(batch.getRowCount(), BatchAllocator::rowsPerBuffer(DataType::getDouble()));
+        ASSERT_EQ(batch.getColumn(1).columnId, half);
+        batch.forEachSelectedRow([&](int64_t row) {
+            int64_t value = batch.getColumn(0).getEntry<db_int64>(row);
+            ASSERT_GE(value, 100);
+            ASSERT_EQ(batch.getColumn(1).getEntry<db_double>(row), static_cast<double>(value) * 0.5);
+        });
+    }
+    EXPECT_EQ(total, rowCount - 100);
+    EXPECT_GT(batches, 2);
+}
@@ -0,0 +1,123 @@
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "storage/write_ahead_log.hpp"
+#include "gtest/gtest.h"
+
+using namespace toydb;
+namespace fs = std::filesystem;
+
+class WriteAheadLogTest : public ::testing::Test {
+protected:
+    fs::path tempDir_;
+    fs::path logPath_;
+
+    void SetUp() override {
+        tempDir_ = fs::temp_directory_path() / "tdb_tests" / "write_ahead_log_test";
+        fs::create_directories(tempDir_);
+        logPath_ = tempDir_ / "test.wal";
+        fs::remove(logPath_);
+    }
+
+    void TearDown() override {
+        fs::remove_all(tempDir_);
+    }
+};
+
+TEST_F(WriteAheadLogTest, RecordsRoundTrip) {
+    {
+        WriteAheadLog log(logPath_);
+        ASSERT_TRUE(log.open());
+        EXPECT_EQ(log.append("first"), 1u);
+        auto lsn = log.append(std::string(1000, 'x'));
+        EXPECT_TRUE(log.commit(lsn));
+        EXPECT_EQ(log.getSyncCount(), 1u);
+
+        // Committed records are synced already
+        EXPECT_TRUE(log.commit(1));
+        EXPECT_EQ(log.getSyncCount(), 1u);
+        log.append("last");
+    }
+
+    // Buffered records are written when the log is closed
+    WriteAheadLog log(logPath_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.readRecords(), (std::vector<std::string> {"first", std::string(1000, 'x'), "last"}));
+
+    EXPECT_TRUE(log.truncate());
+    EXPECT_EQ(log.getSize(), 0u);
+    EXPECT_TRUE(log.readRecords().empty());
+}
+
+TEST_F(WriteAheadLogTest, IgnoresTornRecord) {
+    {
+        WriteAheadLog log(logPath_);
+        ASSERT_TRUE(log.open());
+        EXPECT_TRUE(log.commit(log.append("complete")));
+        EXPECT_TRUE(log.commit(log.append("torn record")));
+    }
+    fs::resize_file(logPath_, fs::file_size(logPath_) - 3);
+
+    WriteAheadLog log(logPath_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.readRecords(), std::vector<std::string> {"complete"});
+}
+
+TEST_F(WriteAheadLogTest, OnlyOneProcess) {
+    WriteAheadLog log(logPath_);
+    ASSERT_TRUE(log.open());
+    WriteAheadLog other(logPath_);
+    EXPECT_FALSE(other.open());
+}
+
+// Test that commits queued behind a sync share the next one
+TEST_F(WriteAheadLogTest, GroupCommit) {
+    constexpr int THREADS = 8;
+    std::latch appended(THREADS);
+    std::once_flag first;
+    WalOptions options;
+    // The first leader syncs once all records are appended, which then wait for a single sync
+    options.beforeSync = [&] { std::call_once(first, [&] { appended.wait(); }); };
+    WriteAheadLog log(logPath_, options);
+    ASSERT_TRUE(log.open());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&log, &appended, t] {
+            WriteAheadLog::Lsn lsn = log.append(std::to_string(t));
+            appended.count_down();
+            EXPECT_TRUE(log.commit(lsn));
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(log.readRecords().size(), static_cast<size_t>(THREADS));
+    EXPECT_GE(log.getSyncCount(), 1u);
+    EXPECT_LE(log.getSyncCount(), 2u);
+    EXPECT_LT(log.getSyncCount(), static_cast<uint64_t>(THREADS));
+}
+
+TEST_F(WriteAheadLogTest, SyncPolicies) {
+    EXPECT_EQ(walSyncPolicyFromString("interval"), WalSyncPolicy::INTERVAL);
+    EXPECT_EQ(walSyncPolicyFromString("sometimes"), std::nullopt);
+    EXPECT_EQ(walSyncPolicyToString(WalSyncPolicy::NONE), "none");
+
+    WalOptions options;
+    options.syncPolicy = WalSyncPolicy::INTERVAL;
+    options.syncInterval = std::chrono::milliseconds(1);
+    WriteAheadLog log(logPath_, options);
+    ASSERT_TRUE(log.open());
+
+    // The commit only waits for the write, the sync thread syncs it soon after
+    EXPECT_TRUE(log.commit(log.append("record")));
+    for (int i = 0; i < 1000 && log.getSyncCount() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(log.getSyncCount(), 1u);
+}